@@ -43,6 +43,15 @@ defined in linker script */
 .word  _sbss
 /* end address for the .bss section. defined in linker script */
 .word  _ebss
+/* start address for the initialization values of the .ccmram section. defined in linker script */
+.word  _siccmram
+/* start and end addresses of the .ccmram, .ccmbss and .dmabss sections. defined in linker script */
+.word  _sccmram
+.word  _eccmram
+.word  _sccmbss
+.word  _eccmbss
+.word  _sdmabss
+.word  _edmabss
 /* stack used for SystemInit_ExtMemCtl; always internal RAM used */
 
 /**
@@ -93,6 +102,51 @@ FillZerobss:
 LoopFillZerobss:
   cmp r2, r4
   bcc FillZerobss
+
+/* Copy the ccmram initializers from flash to CCM-RAM. The stack is in CCM-RAM too, above these sections */
+  ldr r0, =_sccmram
+  ldr r1, =_eccmram
+  ldr r2, =_siccmram
+  movs r3, #0
+  b LoopCopyCcmramInit
+
+CopyCcmramInit:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyCcmramInit:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyCcmramInit
+
+/* Zero fill the ccmbss segment. */
+  ldr r2, =_sccmbss
+  ldr r4, =_eccmbss
+  movs r3, #0
+  b LoopFillZeroCcmbss
+
+FillZeroCcmbss:
+  str  r3, [r2]
+  adds r2, r2, #4
+
+LoopFillZeroCcmbss:
+  cmp r2, r4
+  bcc FillZeroCcmbss
+
+/* Zero fill the dmabss segment. */
+  ldr r2, =_sdmabss
+  ldr r4, =_edmabss
+  movs r3, #0
+  b LoopFillZeroDmabss
+
+FillZeroDmabss:
+  str  r3, [r2]
+  adds r2, r2, #4
+
+LoopFillZeroDmabss:
+  cmp r2, r4
+  bcc FillZeroDmabss
   
 /* Call static constructors */
     bl __libc_init_array
@@ -5,34 +5,103 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
+../Drivers/API/Src/API_adaptive.c \
+../Drivers/API/Src/API_alarm.c \
 ../Drivers/API/Src/API_app.c \
 ../Drivers/API/Src/API_bme280.c \
 ../Drivers/API/Src/API_bme280_port.c \
+../Drivers/API/Src/API_bus.c \
 ../Drivers/API/Src/API_clock_date.c \
+../Drivers/API/Src/API_codec.c \
 ../Drivers/API/Src/API_delay.c \
+../Drivers/API/Src/API_derived.c \
+../Drivers/API/Src/API_fault.c \
+../Drivers/API/Src/API_filter.c \
 ../Drivers/API/Src/API_lcd.c \
 ../Drivers/API/Src/API_lcd_port.c \
-../Drivers/API/Src/API_uart.c 
+../Drivers/API/Src/API_log.c \
+../Drivers/API/Src/API_log_port.c \
+../Drivers/API/Src/API_mem.c \
+../Drivers/API/Src/API_report.c \
+../Drivers/API/Src/API_sampler.c \
+../Drivers/API/Src/API_sampler_port.c \
+../Drivers/API/Src/API_sdcard.c \
+../Drivers/API/Src/API_sdcard_port.c \
+../Drivers/API/Src/API_sdlog.c \
+../Drivers/API/Src/API_stack.c \
+../Drivers/API/Src/API_stats.c \
+../Drivers/API/Src/API_timestamp.c \
+../Drivers/API/Src/API_uart.c \
+../Drivers/API/Src/API_udp.c \
+../Drivers/API/Src/API_udp_port.c \
+../Drivers/API/Src/API_usb_cdc.c \
+../Drivers/API/Src/API_usb_cdc_port.c 
 
 OBJS += \
+./Drivers/API/Src/API_adaptive.o \
+./Drivers/API/Src/API_alarm.o \
 ./Drivers/API/Src/API_app.o \
 ./Drivers/API/Src/API_bme280.o \
 ./Drivers/API/Src/API_bme280_port.o \
+./Drivers/API/Src/API_bus.o \
 ./Drivers/API/Src/API_clock_date.o \
+./Drivers/API/Src/API_codec.o \
 ./Drivers/API/Src/API_delay.o \
+./Drivers/API/Src/API_derived.o \
+./Drivers/API/Src/API_fault.o \
+./Drivers/API/Src/API_filter.o \
 ./Drivers/API/Src/API_lcd.o \
 ./Drivers/API/Src/API_lcd_port.o \
-./Drivers/API/Src/API_uart.o 
+./Drivers/API/Src/API_log.o \
+./Drivers/API/Src/API_log_port.o \
+./Drivers/API/Src/API_mem.o \
+./Drivers/API/Src/API_report.o \
+./Drivers/API/Src/API_sampler.o \
+./Drivers/API/Src/API_sampler_port.o \
+./Drivers/API/Src/API_sdcard.o \
+./Drivers/API/Src/API_sdcard_port.o \
+./Drivers/API/Src/API_sdlog.o \
+./Drivers/API/Src/API_stack.o \
+./Drivers/API/Src/API_stats.o \
+./Drivers/API/Src/API_timestamp.o \
+./Drivers/API/Src/API_uart.o \
+./Drivers/API/Src/API_udp.o \
+./Drivers/API/Src/API_udp_port.o \
+./Drivers/API/Src/API_usb_cdc.o \
+./Drivers/API/Src/API_usb_cdc_port.o 
 
 C_DEPS += \
+./Drivers/API/Src/API_adaptive.d \
+./Drivers/API/Src/API_alarm.d \
 ./Drivers/API/Src/API_app.d \
 ./Drivers/API/Src/API_bme280.d \
 ./Drivers/API/Src/API_bme280_port.d \
+./Drivers/API/Src/API_bus.d \
 ./Drivers/API/Src/API_clock_date.d \
+./Drivers/API/Src/API_codec.d \
 ./Drivers/API/Src/API_delay.d \
+./Drivers/API/Src/API_derived.d \
+./Drivers/API/Src/API_fault.d \
+./Drivers/API/Src/API_filter.d \
 ./Drivers/API/Src/API_lcd.d \
 ./Drivers/API/Src/API_lcd_port.d \
-./Drivers/API/Src/API_uart.d 
+./Drivers/API/Src/API_log.d \
+./Drivers/API/Src/API_log_port.d \
+./Drivers/API/Src/API_mem.d \
+./Drivers/API/Src/API_report.d \
+./Drivers/API/Src/API_sampler.d \
+./Drivers/API/Src/API_sampler_port.d \
+./Drivers/API/Src/API_sdcard.d \
+./Drivers/API/Src/API_sdcard_port.d \
+./Drivers/API/Src/API_sdlog.d \
+./Drivers/API/Src/API_stack.d \
+./Drivers/API/Src/API_stats.d \
+./Drivers/API/Src/API_timestamp.d \
+./Drivers/API/Src/API_uart.d \
+./Drivers/API/Src/API_udp.d \
+./Drivers/API/Src/API_udp_port.d \
+./Drivers/API/Src/API_usb_cdc.d \
+./Drivers/API/Src/API_usb_cdc_port.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -42,7 +111,7 @@ Drivers/API/Src/%.o Drivers/API/Src/%.su Drivers/API/Src/%.cyclo: ../Drivers/API
 clean: clean-Drivers-2f-API-2f-Src
 
 clean-Drivers-2f-API-2f-Src:
-	-$(RM) ./Drivers/API/Src/API_app.cyclo ./Drivers/API/Src/API_app.d ./Drivers/API/Src/API_app.o ./Drivers/API/Src/API_app.su ./Drivers/API/Src/API_bme280.cyclo ./Drivers/API/Src/API_bme280.d ./Drivers/API/Src/API_bme280.o ./Drivers/API/Src/API_bme280.su ./Drivers/API/Src/API_bme280_port.cyclo ./Drivers/API/Src/API_bme280_port.d ./Drivers/API/Src/API_bme280_port.o ./Drivers/API/Src/API_bme280_port.su ./Drivers/API/Src/API_clock_date.cyclo ./Drivers/API/Src/API_clock_date.d ./Drivers/API/Src/API_clock_date.o ./Drivers/API/Src/API_clock_date.su ./Drivers/API/Src/API_delay.cyclo ./Drivers/API/Src/API_delay.d ./Drivers/API/Src/API_delay.o ./Drivers/API/Src/API_delay.su ./Drivers/API/Src/API_lcd.cyclo ./Drivers/API/Src/API_lcd.d ./Drivers/API/Src/API_lcd.o ./Drivers/API/Src/API_lcd.su ./Drivers/API/Src/API_lcd_port.cyclo ./Drivers/API/Src/API_lcd_port.d ./Drivers/API/Src/API_lcd_port.o ./Drivers/API/Src/API_lcd_port.su ./Drivers/API/Src/API_uart.cyclo ./Drivers/API/Src/API_uart.d ./Drivers/API/Src/API_uart.o ./Drivers/API/Src/API_uart.su
+	-$(RM) ./Drivers/API/Src/API_adaptive.cyclo ./Drivers/API/Src/API_adaptive.d ./Drivers/API/Src/API_adaptive.o ./Drivers/API/Src/API_adaptive.su ./Drivers/API/Src/API_alarm.cyclo ./Drivers/API/Src/API_alarm.d ./Drivers/API/Src/API_alarm.o ./Drivers/API/Src/API_alarm.su ./Drivers/API/Src/API_app.cyclo ./Drivers/API/Src/API_app.d ./Drivers/API/Src/API_app.o ./Drivers/API/Src/API_app.su ./Drivers/API/Src/API_bme280.cyclo ./Drivers/API/Src/API_bme280.d ./Drivers/API/Src/API_bme280.o ./Drivers/API/Src/API_bme280.su ./Drivers/API/Src/API_bme280_port.cyclo ./Drivers/API/Src/API_bme280_port.d ./Drivers/API/Src/API_bme280_port.o ./Drivers/API/Src/API_bme280_port.su ./Drivers/API/Src/API_bus.cyclo ./Drivers/API/Src/API_bus.d ./Drivers/API/Src/API_bus.o ./Drivers/API/Src/API_bus.su ./Drivers/API/Src/API_clock_date.cyclo ./Drivers/API/Src/API_clock_date.d ./Drivers/API/Src/API_clock_date.o ./Drivers/API/Src/API_clock_date.su ./Drivers/API/Src/API_codec.cyclo ./Drivers/API/Src/API_codec.d ./Drivers/API/Src/API_codec.o ./Drivers/API/Src/API_codec.su ./Drivers/API/Src/API_delay.cyclo ./Drivers/API/Src/API_delay.d ./Drivers/API/Src/API_delay.o ./Drivers/API/Src/API_delay.su ./Drivers/API/Src/API_derived.cyclo ./Drivers/API/Src/API_derived.d ./Drivers/API/Src/API_derived.o ./Drivers/API/Src/API_derived.su ./Drivers/API/Src/API_fault.cyclo ./Drivers/API/Src/API_fault.d ./Drivers/API/Src/API_fault.o ./Drivers/API/Src/API_fault.su ./Drivers/API/Src/API_filter.cyclo ./Drivers/API/Src/API_filter.d ./Drivers/API/Src/API_filter.o ./Drivers/API/Src/API_filter.su ./Drivers/API/Src/API_lcd.cyclo ./Drivers/API/Src/API_lcd.d ./Drivers/API/Src/API_lcd.o ./Drivers/API/Src/API_lcd.su ./Drivers/API/Src/API_lcd_port.cyclo ./Drivers/API/Src/API_lcd_port.d ./Drivers/API/Src/API_lcd_port.o ./Drivers/API/Src/API_lcd_port.su ./Drivers/API/Src/API_log.cyclo ./Drivers/API/Src/API_log.d ./Drivers/API/Src/API_log.o ./Drivers/API/Src/API_log.su ./Drivers/API/Src/API_log_port.cyclo ./Drivers/API/Src/API_log_port.d ./Drivers/API/Src/API_log_port.o ./Drivers/API/Src/API_log_port.su ./Drivers/API/Src/API_mem.cyclo ./Drivers/API/Src/API_mem.d ./Drivers/API/Src/API_mem.o ./Drivers/API/Src/API_mem.su ./Drivers/API/Src/API_report.cyclo ./Drivers/API/Src/API_report.d ./Drivers/API/Src/API_report.o ./Drivers/API/Src/API_report.su ./Drivers/API/Src/API_sampler.cyclo ./Drivers/API/Src/API_sampler.d ./Drivers/API/Src/API_sampler.o ./Drivers/API/Src/API_sampler.su ./Drivers/API/Src/API_sampler_port.cyclo ./Drivers/API/Src/API_sampler_port.d ./Drivers/API/Src/API_sampler_port.o ./Drivers/API/Src/API_sampler_port.su ./Drivers/API/Src/API_sdcard.cyclo ./Drivers/API/Src/API_sdcard.d ./Drivers/API/Src/API_sdcard.o ./Drivers/API/Src/API_sdcard.su ./Drivers/API/Src/API_sdcard_port.cyclo ./Drivers/API/Src/API_sdcard_port.d ./Drivers/API/Src/API_sdcard_port.o ./Drivers/API/Src/API_sdcard_port.su ./Drivers/API/Src/API_sdlog.cyclo ./Drivers/API/Src/API_sdlog.d ./Drivers/API/Src/API_sdlog.o ./Drivers/API/Src/API_sdlog.su ./Drivers/API/Src/API_stack.cyclo ./Drivers/API/Src/API_stack.d ./Drivers/API/Src/API_stack.o ./Drivers/API/Src/API_stack.su ./Drivers/API/Src/API_stats.cyclo ./Drivers/API/Src/API_stats.d ./Drivers/API/Src/API_stats.o ./Drivers/API/Src/API_stats.su ./Drivers/API/Src/API_timestamp.cyclo ./Drivers/API/Src/API_timestamp.d ./Drivers/API/Src/API_timestamp.o ./Drivers/API/Src/API_timestamp.su ./Drivers/API/Src/API_uart.cyclo ./Drivers/API/Src/API_uart.d ./Drivers/API/Src/API_uart.o ./Drivers/API/Src/API_uart.su ./Drivers/API/Src/API_udp.cyclo ./Drivers/API/Src/API_udp.d ./Drivers/API/Src/API_udp.o ./Drivers/API/Src/API_udp.su ./Drivers/API/Src/API_udp_port.cyclo ./Drivers/API/Src/API_udp_port.d ./Drivers/API/Src/API_udp_port.o ./Drivers/API/Src/API_udp_port.su ./Drivers/API/Src/API_usb_cdc.cyclo ./Drivers/API/Src/API_usb_cdc.d ./Drivers/API/Src/API_usb_cdc.o ./Drivers/API/Src/API_usb_cdc.su ./Drivers/API/Src/API_usb_cdc_port.cyclo ./Drivers/API/Src/API_usb_cdc_port.d ./Drivers/API/Src/API_usb_cdc_port.o ./Drivers/API/Src/API_usb_cdc_port.su
 
 .PHONY: clean-Drivers-2f-API-2f-Src
 
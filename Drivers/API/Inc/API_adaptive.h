@@ -0,0 +1,102 @@
+#ifndef API_INC_API_ADAPTIVE_H_
+#define API_INC_API_ADAPTIVE_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Adaptive sampling period. The period moves on a ladder of powers of two from the shortest to the longest
+ * configured period: minPeriodUs, 2 x minPeriodUs, 4 x minPeriodUs... capped at maxPeriodUs.
+ *
+ * Each filtered sample gives every channel an urgency from 0 to 1: its rate of change against rateFullPerMin,
+ * and its distance to the nearest alarm limit against proximityBand. The highest urgency picks the nearest step,
+ * 1 being the shortest period, so an urgency below half a step still allows the longest one. A shorter target
+ * is taken at once; a longer one is approached one step (twice the period) per holdMs during which nothing
+ * called for the current step, so a flat signal backs off exponentially.
+ */
+
+/* Exported constants --------------------------------------------------------*/
+
+// The slope is measured against a reference renewed at most this often, to keep quantisation noise out
+#define ADAPTIVE_RATE_MIN_SPAN_MS 10000U
+#define ADAPTIVE_MS_PER_MINUTE 60000.0f
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Channels that drive the sampling period.
+ */
+typedef enum
+{
+  ADAPTIVE_CHANNEL_TEMPERATURE, // Degrees Celsius
+  ADAPTIVE_CHANNEL_HUMIDITY,    // %RH
+  ADAPTIVE_CHANNEL_COUNT,
+} adaptiveChannel_t;
+
+/**
+ * @brief Sensitivity of one channel.
+ */
+typedef struct
+{
+  float rateFullPerMin; // |d value / dt| per minute that calls for the shortest period, 0 ignores the rate
+  float proximityBand;  // Distance to an alarm limit below which the period shortens, 0 ignores the limits
+} adaptiveChannelConfig_t;
+
+/**
+ * @brief Runtime configuration of the controller.
+ */
+typedef struct
+{
+  uint32_t minPeriodUs; // Shortest period, also the period at start
+  uint32_t maxPeriodUs; // Longest period, reached after a long enough flat signal
+  uint32_t holdMs;      // Flat time before each step towards a longer period
+  adaptiveChannelConfig_t channel[ADAPTIVE_CHANNEL_COUNT];
+} adaptiveConfig_t;
+
+/**
+ * @brief One channel of a filtered sample.
+ */
+typedef struct
+{
+  float value;  // Sample value in the channel's unit
+  float margin; // Distance to the nearest alarm limit, 0 past it
+} adaptiveInput_t;
+
+/**
+ * @brief Controller state and counters since API_ADAPTIVE_Init.
+ */
+typedef struct
+{
+  uint32_t periodUs; // Current period
+  uint8_t step;      // Current step, 0 for the shortest period
+  uint8_t steps;     // Longest step, maxPeriodUs
+  uint32_t speedUps; // Moves to a shorter period
+  uint32_t backOffs; // Moves to a longer period
+} adaptiveStatus_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Installs a configuration and restarts at the shortest period.
+ * @param  config: Configuration to copy.
+ * @retval bool: false if the periods are zero or out of order, the previous configuration is kept.
+ */
+bool API_ADAPTIVE_Init(const adaptiveConfig_t *config);
+
+/**
+ * @brief  Feeds one filtered sample and returns the period to sample at from now on.
+ * @param  inputs: One input per channel, indexed by adaptiveChannel_t.
+ * @param  nowMs: Sample time in milliseconds (monotonic, wrap-safe).
+ * @retval uint32_t: Sampling period in microseconds.
+ */
+uint32_t API_ADAPTIVE_Update(const adaptiveInput_t inputs[ADAPTIVE_CHANNEL_COUNT], uint32_t nowMs);
+
+/**
+ * @brief  Returns the current period and the step counters.
+ * @param  None
+ * @retval adaptiveStatus_t: Status.
+ */
+adaptiveStatus_t API_ADAPTIVE_GetStatus(void);
+
+#endif /* API_INC_API_ADAPTIVE_H_ */
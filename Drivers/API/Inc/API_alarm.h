@@ -0,0 +1,122 @@
+#ifndef API_INC_API_ALARM_H_
+#define API_INC_API_ALARM_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <float.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+// Limit values that never trip, used to disable one side of a channel
+#define ALARM_LIMIT_DISABLED_HIGH FLT_MAX
+#define ALARM_LIMIT_DISABLED_LOW (-FLT_MAX)
+
+// Rate-of-change is measured between reference samples at least this far apart, to keep quantisation noise out
+#define ALARM_RATE_MIN_INTERVAL_MS 10000U
+#define ALARM_MS_PER_MINUTE 60000.0f
+
+// Rate limit value that disables the rate-of-change alarm
+#define ALARM_RATE_DISABLED 0.0f
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Channels monitored by the alarm engine.
+ */
+typedef enum
+{
+  ALARM_CHANNEL_TEMPERATURE, // Degrees Celsius
+  ALARM_CHANNEL_HUMIDITY,    // %RH
+  ALARM_CHANNEL_PRESSURE,    // hPa, disabled by default: the BME280 driver does not compensate pressure yet
+  ALARM_CHANNEL_COUNT,
+} alarmChannel_t;
+
+/**
+ * @brief Alarm severity levels, ordered so that a higher value is more severe.
+ */
+typedef enum
+{
+  ALARM_SEVERITY_NONE,     // Value within limits
+  ALARM_SEVERITY_WARNING,  // First limit crossed or rate-of-change exceeded
+  ALARM_SEVERITY_CRITICAL, // Second limit crossed
+  ALARM_SEVERITY_COUNT,
+} alarmSeverity_t;
+
+/**
+ * @brief Runtime configuration of one channel.
+ *        Limits are indexed by severity; the ALARM_SEVERITY_NONE entry is ignored.
+ */
+typedef struct
+{
+  bool enabled;
+  float highLimit[ALARM_SEVERITY_COUNT]; // Raise the level when value > highLimit
+  float lowLimit[ALARM_SEVERITY_COUNT];  // Raise the level when value < lowLimit
+  float hysteresis;                      // Band the value must clear by before a level drops
+  uint32_t dwellMs;                      // Time a new level must persist before it is reported
+  float rateLimitPerMin;                 // |d value / dt| per minute that raises a warning, ALARM_RATE_DISABLED to turn off
+} alarmConfig_t;
+
+/**
+ * @brief Transition reported by API_ALARM_Update.
+ */
+typedef struct
+{
+  alarmChannel_t channel;
+  alarmSeverity_t previous;
+  alarmSeverity_t current;
+  float value;     // Sample that committed the transition
+  bool rateAlarm;  // True if the rate-of-change condition is active
+} alarmEvent_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Resets every channel to ALARM_SEVERITY_NONE and disables it.
+ * @param  None
+ * @retval None
+ */
+void API_ALARM_Init(void);
+
+/**
+ * @brief  Installs a channel configuration at runtime. The channel's state is reset.
+ * @param  channel: Channel to configure.
+ * @param  config: Configuration to copy.
+ * @retval bool: true on success, false if the channel or the configuration is invalid.
+ */
+bool API_ALARM_Configure(alarmChannel_t channel, const alarmConfig_t *config);
+
+/**
+ * @brief  Feeds one sample to a channel and evaluates its limits, hysteresis, dwell time and rate.
+ * @param  channel: Channel the sample belongs to.
+ * @param  value: Sample value in the channel's unit.
+ * @param  nowMs: Sample time in milliseconds (monotonic, wrap-safe).
+ * @param  event: Filled when the committed severity changes.
+ * @retval bool: true if a transition was committed, false otherwise.
+ */
+bool API_ALARM_Update(alarmChannel_t channel, float value, uint32_t nowMs, alarmEvent_t *event);
+
+/**
+ * @brief  Returns the committed severity of a channel.
+ * @param  channel: Channel to query.
+ * @retval alarmSeverity_t: Current severity, ALARM_SEVERITY_NONE for an invalid channel.
+ */
+alarmSeverity_t API_ALARM_GetSeverity(alarmChannel_t channel);
+
+/**
+ * @brief  Returns the highest committed severity across all channels.
+ * @param  None
+ * @retval alarmSeverity_t: Highest severity.
+ */
+alarmSeverity_t API_ALARM_GetHighestSeverity(void);
+
+/**
+ * @brief  Returns how far a value lies inside the warning limits of a channel.
+ * @param  channel: Channel to query.
+ * @param  value: Value in the channel's unit.
+ * @retval float: Distance to the nearest warning limit, 0 at or past it, ALARM_LIMIT_DISABLED_HIGH for a
+ *         disabled or invalid channel.
+ */
+float API_ALARM_GetMargin(alarmChannel_t channel, float value);
+
+#endif /* API_INC_API_ALARM_H_ */
@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 
 #include "stm32f4xx_hal.h"        /* <- HAL include */
 #include "stm32f4xx_nucleo_144.h" /* <- BSP include */
@@ -13,10 +15,126 @@
 
 #include "API_bme280.h"
 #include "API_clock_date.h"
+#include "API_alarm.h"
+#include "API_report.h"
+#include "API_filter.h"
+#include "API_stats.h"
+#include "API_log.h"
+#include "API_sdlog.h"
+#include "API_usb_cdc.h"
+#include "API_udp.h"
+#include "API_codec.h"
+#include "API_mem.h"
+#include "API_section.h"
+#include "API_stack.h"
+#include "API_bus.h"
+#include "API_sampler.h"
+#include "API_adaptive.h"
+#include "API_derived.h"
+#include "API_fault.h"
 
-/* APP FSM logic define parameters -------------------------------------------*/
+/* APP alarm define parameters -----------------------------------------------*/
 
-#define THRESHOLD_TEMP 22 // Temperature threshold in degrees Celsius for state change
+// Temperature limits in degrees Celsius
+#define APP_TEMP_WARNING_HIGH 22.0f  // Former THRESHOLD_TEMP
+#define APP_TEMP_CRITICAL_HIGH 30.0f
+#define APP_TEMP_WARNING_LOW 10.0f
+#define APP_TEMP_CRITICAL_LOW 5.0f
+#define APP_TEMP_HYSTERESIS 0.5f     // Degrees Celsius below/above a limit before the level clears
+#define APP_TEMP_DWELL_MS 1000U      // A new level must persist this long before it is reported
+#define APP_TEMP_RATE_LIMIT 2.0f     // Degrees Celsius per minute
+
+// Humidity limits in %RH
+#define APP_HUM_WARNING_HIGH 70.0f
+#define APP_HUM_CRITICAL_HIGH 85.0f
+#define APP_HUM_WARNING_LOW 20.0f
+#define APP_HUM_CRITICAL_LOW 10.0f
+#define APP_HUM_HYSTERESIS 2.0f
+#define APP_HUM_DWELL_MS 2000U
+#define APP_HUM_RATE_LIMIT 10.0f     // %RH per minute
+
+/* APP filter define parameters ----------------------------------------------*/
+
+// At the full rate raw samples arrive every SAMPLER_PERIOD_US (50 ms); outputs every APP_FILTER_DECIMATION samples (200 ms)
+#define APP_FILTER_MEDIAN_WINDOW 5 // Median-of-5 spike rejector
+#define APP_FILTER_DECIMATION 4    // Moving-average decimation ratio
+#define APP_FILTER_EMA_SHIFT 2     // EMA coefficient 1/4 on the decimated stream
+#define APP_FILTER_MEDIAN_SLOW 3   // Median once a long period has left no decimation or EMA to take off
+
+/* APP adaptive sampling define parameters ---------------------------------*/
+
+// The period is SAMPLER_PERIOD_US while a channel moves or nears a warning limit, and doubles after every
+// APP_RATE_HOLD_MS of flat signal up to APP_RATE_MAX_PERIOD_US. The filter stages count samples: each doubling
+// takes a halving off the decimation, then off the EMA time constant, so the filter lag stays near the full rate's.
+#define APP_RATE_MIN_PERIOD_US SAMPLER_PERIOD_US
+#define APP_RATE_MAX_PERIOD_US 1600000U // 5 doublings: a filtered output every 1.6 s
+#define APP_RATE_HOLD_MS 10000U
+#define APP_TEMP_RATE_FULL 1.0f         // Degrees Celsius per minute that calls for the shortest period
+#define APP_TEMP_PROXIMITY 1.0f         // Degrees Celsius from a warning limit where the period starts to shorten
+#define APP_HUM_RATE_FULL 5.0f          // %RH per minute
+#define APP_HUM_PROXIMITY 5.0f          // %RH
+
+/* APP telemetry define parameters -------------------------------------------*/
+
+#define APP_REPORT_BY_EXCEPTION 1      // 1: send a channel only when it changes (or on heartbeat), 0: send every cycle
+#define APP_REPORT_HEARTBEAT_MS 60000U // Maximum time a channel stays silent on the UART, and the diagnostics period
+#define APP_TEMP_DEADBAND 0.1f         // Degrees Celsius
+#define APP_HUM_DEADBAND 0.5f          // %RH
+
+/* APP derived channels define parameters ------------------------------------*/
+
+#define APP_DERIVED_TELEMETRY 1 // 1: each text report adds "Derived dew n.nn C abs n.nn g/m3 heat n.nn C", 0: never computed
+
+/* APP sensor fault define parameters ----------------------------------------*/
+
+// Each fault and each recovery of the BME280 sends "Sensor fault <type>: recovering" or "Sensor recovered after n ms"
+// and sets LED3 on the fault, clears it on the recovery.
+// Invalid samples stay in the raw streams, marked with their fault.
+
+/* APP compressed telemetry define parameters --------------------------------*/
+
+#define APP_UART_COMPRESSED 0        // 1: send every sample as delta/varint blocks ("Z:<base64>" lines), 0: text lines
+#define APP_CODEC_CHANNELS 2         // Temperature and humidity, hundredths
+#define APP_CODEC_BLOCK_SAMPLES 25   // Samples per block, 5 s at the filter output rate
+#define APP_CODEC_HEADER_SIZE 1      // Sample count byte at the start of each block
+#define APP_CODEC_PACKET_SIZE 128    // Block buffer, a steady signal needs ~3.5 bytes per sample
+#define APP_CODEC_LINE_SIZE (2 + CODEC_BASE64_SIZE(APP_CODEC_PACKET_SIZE) + 3) // "Z:" + base64 + "\r\n" + '\0'
+
+/* APP statistics define parameters ------------------------------------------*/
+
+// Quantile histogram ranges, STATS_HISTOGRAM_BUCKETS buckets each
+#define APP_STATS_TEMP_LOWEST (-10.0f) // Degrees Celsius, covers -10 to 54 C
+#define APP_STATS_TEMP_BUCKET 0.5f
+#define APP_STATS_HUM_LOWEST 0.0f      // %RH, covers 0 to 128 %RH
+#define APP_STATS_HUM_BUCKET 1.0f
+#define APP_STATS_MSG_SIZE 128         // Longest statistics line sent over UART
+
+/* APP flash log define parameters -------------------------------------------*/
+
+#define APP_LOG_INTERVAL_MS 10000U // One record every 10 s, a 32-record staging block is flushed every ~5 min
+
+/* APP SD card log define parameters ----------------------------------------*/
+
+// Every filtered sample (200 ms at the full rate) is appended: a 62-record block every ~12 s, a 64-block stream every ~13 min.
+// The card is written from the super loop one operation at a time and never waited on.
+
+/* APP USB telemetry define parameters -------------------------------------*/
+
+// Every UART telemetry line is mirrored to the USB CDC port once a host opens it (DTR set)
+#define APP_USB_RAW_STREAM 1     // 1: every raw sensor sample also goes to USB as "R:<ms>,<T 0.01 C>,<H Q22.10>",
+                                 // an invalid one as "F:<ms>,<fault>"
+#define APP_USB_RAW_LINE_SIZE 40 // Longest raw sample line
+
+/* APP Ethernet UDP telemetry define parameters ----------------------------*/
+
+// Every raw sensor sample is published in batches once the Ethernet link is up. The collector defaults to the
+// subnet broadcast: set its MAC and IP to unicast to it instead (static ARP, nothing is resolved on the wire).
+#define APP_UDP_COLLECTOR_MAC {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}
+#define APP_UDP_COLLECTOR_IP {192, 168, 1, 255}
+#define APP_UDP_BOARD_IP {192, 168, 1, 50}
+#define APP_UDP_COLLECTOR_PORT 5005U
+#define APP_UDP_BOARD_PORT 5005U
+#define APP_UDP_BATCH_RECORDS 20U // Records per datagram: one datagram per second at the full raw rate
 
 /* APP LCD display define parameters -----------------------------------------*/
 
@@ -33,32 +151,22 @@
 #define DECIMAL 10                // Decimal base for integer to string conversion
 #define ZEROVAL 0                 // Value representing zero, used in initialization
 #define FRACTIONAL_MULTIPLIER 100 // Multiplier for converting fractional part of float to integer
-
-/* Enumerations --------------------------------------------------------------*/
-
-/**
- * @brief Enumeration for temperature states.
- * TEMP_NORMAL: Temperature is within normal range.
- * TEMP_ALARM: Temperature exceeds the defined threshold.
- */
-typedef enum
-{
-  TEMP_NORMAL, // Normal temperature state
-  TEMP_ALARM,  // Alarm temperature state
-} tempState_t;
+#define US_PER_MS 1000U           // Microseconds per millisecond
+#define MS_PER_MINUTE 60000U      // Milliseconds per minute
+#define PERCENT 100.0f            // Ratio to percent
 
 /* Function Prototypes -------------------------------------------------------*/
 
 /**
  * @brief Initializes the application components and prepares the system for operation.
- *        This function initializes the clock, FSM, BME280 sensor, UART, and LCD.
+ *        This function initializes the clock, alarm engine, BME280 sensor, UART, and LCD.
  * @retval None
  */
 void APP_init(void);
 
 /**
  * @brief Main update function for the application. This function handles sensor data acquisition,
- *        LCD updates, sensor data display, and FSM updates.
+ *        LCD updates, sensor data display, and alarm evaluation.
  * @retval None
  */
 void APP_update(void);
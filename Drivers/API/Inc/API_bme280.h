@@ -9,8 +9,6 @@
 #include "stm32f4xx_hal.h"        /* <- HAL include */
 #include "stm32f4xx_nucleo_144.h" /* <- BSP include */
 
-#include "API_bme280_port.h" /* <- BME280 port include */
-
 /* Exported constants --------------------------------------------------------*/
 
 // GPIO Pin and Port for Chip Select (CS) line
@@ -22,10 +20,10 @@
 #define WRITE_CMD_BIT 0x7F // Command bit for write operation (Most Significant Bit = 0) | Applies mask 0x7F = 0b01111111 -> Most Significant Bit (bit number 7) = 0
 
 // Delay values for BME280 communication
-#define BME280_HAL_DELAY 100 // ms
+#define BME280_HAL_DELAY 100 // ms, start-up after the soft reset at boot (datasheet: 2 ms)
 
-// Timeout for SPI transmit/receive operations
-#define SPI_TX_RX_TIMEOUT 1000 // ms
+// Timeout for SPI transmit/receive operations: a transfer takes microseconds, so this only bounds a dead bus
+#define SPI_TX_RX_TIMEOUT 10 // ms
 
 // Register addresses for BME280 sensor data and configuration
 #define PRESSURE_MSB_REG 0xF7  // Register address for the most significant byte of pressure data
@@ -34,13 +32,14 @@
 #define CHIP_ID_REG 0xD0     // Register address for reading the BME280 chip ID
 #define CHIP_ID_BLOCK_SIZE 1 // Size of the chip ID block to be read in bytes
 
+#define BME280_BUS_IDLE_LEVEL 0xFF // MISO idles high: every byte of a read reads this with no sensor on the bus
+
 // GPIO Pin states for CS line
 #define PinStateLow 0
 #define PinStateHigh 1
 
-// Number of LED blinks to indicate successful or error reception of sensor data
+// Number of LED blinks to indicate successful reception of sensor data (DEBUG_BME280)
 #define NumOkRxBlinks 2
-#define NumErrorRxBlinks 2
 
 // Size of the command to be written to a register (in bytes)
 #define CMD_WRITE_SIZE 1 // bytes
@@ -51,6 +50,7 @@ The “reset” register contains the soft reset word reset[7:0]. If the value 0
 the device is reset using the complete power-on-reset procedure. Writing other values than 0xB6 has
 no effect. The readout value is always 0x00.*/
 #define BME280_RESET_REG 0xE0 // Register address for performing a soft reset on the sensor
+#define BME280_RESET_WORD 0xB6 // Soft reset word
 
 /*
 5.4.3 Register 0xF2 “ctrl_hum”
@@ -77,14 +77,14 @@ register only become effective after a write operation to “ctrl_meas”.*/
 #define DIG_T3_MSB_INDEX 5
 
 // Indices for accessing humidity calibration data bytes in the calibration data buffers
-#define DIG_H1_INDEX 24
+#define DIG_H1_INDEX 25 // 0xA1, the last byte of the first block
 #define DIG_H2_LSB_INDEX 0
 #define DIG_H2_MSB_INDEX 1
 #define DIG_H3_INDEX 2
 #define DIG_H4_MSB_INDEX 3
 #define DIG_H4_LSB_INDEX 4
-#define DIG_H5_MSB_INDEX 4
-#define DIG_H5_LSB_INDEX 5
+#define DIG_H5_MSB_INDEX 5 // 0xE6 holds dig_H5[11:4]
+#define DIG_H5_LSB_INDEX 4 // 0xE5[7:4] holds dig_H5[3:0]
 #define DIG_H6_INDEX 6
 
 // Indices for accessing temperature and humidity data bytes in the sensor's output data buffer
@@ -108,34 +108,81 @@ register only become effective after a write operation to “ctrl_meas”.*/
 // BME280 chip ID
 #define BME280_CHIP_ID 0x60
 
+// Plausibility of a read
+#define BME280_TEMP_ADC_SKIPPED 0x80000 // Temperature result of a skipped measurement, and its reset value: no conversion since the last reset
+#define BME280_TEMPERATURE_MIN (-4000)  // Operating range in 0.01 DegC, datasheet table 1
+#define BME280_TEMPERATURE_MAX 8500
+
 /* Exported types ------------------------------------------------------------*/
 
-/* Exported variables -------------------------------------------------------*/
+/**
+ * @brief Outcome of a sensor operation.
+ */
+typedef enum
+{
+  BME280_OK,
+  BME280_ERROR_BUS,   // SPI timeout or error, or nothing driving MISO: every byte reads the idle level
+  BME280_ERROR_ID,    // A device answers with another chip ID
+  BME280_ERROR_RANGE, // Skipped measurement, or a temperature outside the operating range
+} bme280Status_t;
+
+/**
+ * @brief Last compensated sample in the datasheet's fixed-point formats, for integer processing stages.
+ */
+typedef struct
+{
+  int32_t temperature;     // Temperature in 0.01 DegC, "5123" equals 51.23 DegC
+  uint32_t humidity;       // Humidity in %RH as Q22.10, "47445" equals 47445/1024 = 46.333 %RH
+  uint32_t adcTemperature; // Raw 20-bit result it was compensated from
+  uint32_t adcHumidity;    // Raw 16-bit result
+} bme280Sample_t;
+
+/* Port include, after the constants its inline definitions use ------------*/
 
-// Here we declare temperature and humidity as extern to make them accessible in other source files (API_fsm.c).
-extern float bme280_temperature, bme280_humidity;
+#include "API_bme280_port.h" /* <- BME280 port include */
 
 /* Exported functions ------------------------------------------------------- */
 
 /**
- * @brief  Initializes the BME280 sensor by configuring its control registers and reading calibration parameters.
+ * @brief  Resets the sensor, waits for its start-up, then configures it. Blocking: call at boot only.
  * @param  None
- * @retval None
+ * @retval bme280Status_t: BME280_OK, or the reason the sensor is not configured.
  */
-void API_BME280_Init(void);
+bme280Status_t API_BME280_Init(void);
 
 /**
- * @brief  Reads raw temperature and humidity data from the BME280 sensor and applies compensation formulas.
+ * @brief  Writes the soft reset word: the sensor restarts with its power-on settings, asleep. Does not wait.
+ * @param  None
+ * @retval bme280Status_t: BME280_OK, or BME280_ERROR_BUS.
+ */
+bme280Status_t API_BME280_SoftReset(void);
+
+/**
+ * @brief  Checks the chip ID, reads the calibration parameters and writes the control registers. Does not wait.
  * @param  None
- * @retval uint8_t: Returns 0 if the read operation is successful, 1 if an error occurs.
+ * @retval bme280Status_t: BME280_OK, BME280_ERROR_BUS or BME280_ERROR_ID.
  */
-extern uint8_t API_BME280_ReadAndProcess(void);
+bme280Status_t API_BME280_Configure(void);
 
 /**
- * @brief  Error handler for BME280 operations, enters an infinite loop in case of an error.
+ * @brief  Reads raw temperature and humidity data from the BME280 sensor and applies compensation formulas.
  * @param  None
+ * @retval bme280Status_t: BME280_OK if a sample was compensated, or why not.
+ */
+bme280Status_t API_BME280_ReadAndProcess(void);
+
+/**
+ * @brief  Compensates a burst read from 0xF7 to 0xFE taken outside the driver, by the timed sampler's DMA.
+ * @param  const uint8_t *burst: RAW_OUTPUT_DATA_SIZE bytes, 0xF7 first.
+ * @retval bme280Status_t: BME280_OK if the burst was compensated, or why not.
+ */
+bme280Status_t API_BME280_ProcessBurst(const uint8_t *burst);
+
+/**
+ * @brief  Copies the last sample compensated by API_BME280_ReadAndProcess or API_BME280_ProcessBurst.
+ * @param  bme280Sample_t *sample: Receives the sample.
  * @retval None
  */
-void API_BME280_ErrorHandler(void);
+void API_BME280_GetSample(bme280Sample_t *sample);
 
 #endif /* API_INC_DRIVER_BME280_H_ */
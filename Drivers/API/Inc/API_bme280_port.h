@@ -2,8 +2,11 @@
 #define API_INC_API_BME280_PORT_H_
 
 /* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+
 #include "stm32f4xx_hal.h"        /* <- HAL include */
 #include "stm32f4xx_nucleo_144.h" /* <- BSP include */
+#include "API_port.h"             /* <- Port binding */
 #include "API_bme280.h"           /* <- BME280 driver include */
 
 /* SPI handler declaration */
@@ -17,31 +20,92 @@ extern SPI_HandleTypeDef hspi1;
  * @param  uint8_t reg: The register address in the BME280 sensor to write to.
  * @param  uint8_t *data: Pointer to the data buffer that holds the data to be written.
  * @param  uint16_t size: The size of the data buffer in bytes.
- * @retval None
+ * @retval bool: false if the SPI failed or timed out.
  */
-void BME280_HAL_SPI_Write(uint8_t reg, uint8_t *data, uint16_t size);
+API_PORT_FUNC bool BME280_HAL_SPI_Write(uint8_t reg, uint8_t *data, uint16_t size);
 
 /**
  * @brief  Read data from the BME280 sensor via SPI.
  * @param  uint8_t reg: The register address in the BME280 sensor to read from.
  * @param  uint8_t *data: Pointer to the data buffer where the read data will be stored.
  * @param  uint16_t size: The size of the data buffer in bytes.
+ * @retval bool: false if the SPI failed or timed out.
+ */
+API_PORT_FUNC bool BME280_HAL_SPI_Read(uint8_t reg, uint8_t *data, uint16_t size);
+
+/**
+ *  @brief  Provides a delay for a specified number of milliseconds.
+ * @param  delay: The amount of time, in milliseconds, to delay.
  * @retval None
  */
-void BME280_HAL_SPI_Read(uint8_t reg, uint8_t *data, uint16_t size);
+API_PORT_FUNC void BME280_HAL_Delay(uint32_t delay);
+
+/**
+ * @brief  Toggles the state of the specified LED.
+ * @param  Led: Specifies the LED to be toggled. This parameter can be one of the LED identifiers defined in the board support package (BSP), such as `LED2`, `LED3`, etc.
+ * @retval None
+ */
+API_PORT_FUNC void BME280_HAL_Blink(Led_TypeDef Led);
+
+/* Port Function Definitions ------------------------------------------------ */
+
+// Inlined into the driver, or compiled once by API_bme280_port.c when the port is bound at link time
+#if API_PORT_STATIC_INLINE || defined(API_BME280_PORT_IMPLEMENTATION)
+
+/**
+ * @brief  Write data to the BME280 sensor via SPI.
+ * @param  uint8_t reg: The register address in the BME280 sensor to write to.
+ * @param  uint8_t *data: Pointer to the data buffer that holds the data to be written.
+ * @param  uint16_t size: The size of the data buffer in bytes.
+ * @retval bool: false if the SPI failed or timed out.
+ */
+API_PORT_FUNC bool BME280_HAL_SPI_Write(uint8_t reg, uint8_t *data, uint16_t size)
+{
+  uint8_t regAddress = reg & WRITE_CMD_BIT; // Apply the write command mask.
+  HAL_GPIO_WritePin(CS_GPIO_Port, CS_Pin, PinStateLow);
+  bool ok = HAL_SPI_Transmit(&hspi1, &regAddress, sizeof(regAddress), SPI_TX_RX_TIMEOUT) == HAL_OK &&
+            HAL_SPI_Transmit(&hspi1, data, size, SPI_TX_RX_TIMEOUT) == HAL_OK;
+  HAL_GPIO_WritePin(CS_GPIO_Port, CS_Pin, PinStateHigh);
+  return ok;
+}
+
+/**
+ * @brief  Read data from the BME280 sensor via SPI.
+ * @param  uint8_t reg: The register address in the BME280 sensor to read from.
+ * @param  uint8_t *data: Pointer to the data buffer where the read data will be stored.
+ * @param  uint16_t size: The size of the data buffer in bytes.
+ * @retval bool: false if the SPI failed or timed out.
+ */
+API_PORT_FUNC bool BME280_HAL_SPI_Read(uint8_t reg, uint8_t *data, uint16_t size)
+{
+  uint8_t regAddress = reg | READ_CMD_BIT; // Apply the read command mask.
+  HAL_GPIO_WritePin(CS_GPIO_Port, CS_Pin, PinStateLow);
+  bool ok = HAL_SPI_Transmit(&hspi1, &regAddress, sizeof(regAddress), SPI_TX_RX_TIMEOUT) == HAL_OK &&
+            HAL_SPI_Receive(&hspi1, data, size, SPI_TX_RX_TIMEOUT) == HAL_OK;
+  HAL_GPIO_WritePin(CS_GPIO_Port, CS_Pin, PinStateHigh);
+  return ok;
+}
 
 /**
  *  @brief  Provides a delay for a specified number of milliseconds.
  * @param  delay: The amount of time, in milliseconds, to delay.
  * @retval None
  */
-void BME280_HAL_Delay(uint32_t delay);
+API_PORT_FUNC void BME280_HAL_Delay(uint32_t delay)
+{
+  HAL_Delay(delay);
+}
 
 /**
  * @brief  Toggles the state of the specified LED.
  * @param  Led: Specifies the LED to be toggled. This parameter can be one of the LED identifiers defined in the board support package (BSP), such as `LED2`, `LED3`, etc.
  * @retval None
  */
-void BME280_HAL_Blink(Led_TypeDef Led);
+API_PORT_FUNC void BME280_HAL_Blink(Led_TypeDef Led)
+{
+  BSP_LED_Toggle(Led);
+}
+
+#endif /* API_PORT_STATIC_INLINE || API_BME280_PORT_IMPLEMENTATION */
 
 #endif /* API_INC_API_BME280_PORT_H_ */
@@ -0,0 +1,169 @@
+#ifndef API_INC_API_BUS_H_
+#define API_INC_API_BUS_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "API_alarm.h"
+#include "API_fault.h"
+#include "API_spsc.h"
+
+/*
+ * Publish/subscribe bus between the producers (sensor, filter, RTC wakeup, alarm engine) and their
+ * consumers (LCD, UART, logs, USB, UDP), without allocation.
+ *
+ * Every subscription owns a bounded queue of BUS_QUEUE_DEPTH messages, declared by the consumer. A topic
+ * has exactly one publishing context, the main loop or one interrupt, so each queue is an API_SPSC ring:
+ * publishing and receiving are lock-free, and an interrupt can publish while the main loop reads. A full queue refuses the message for that subscription only; the publisher never waits.
+ *
+ * Every topic numbers its messages. A subscription expects the number after the last one it received, so
+ * a gap tells it how many messages it missed because its queue was full.
+ *
+ * Consumers run from API_BUS_Dispatch, each at its own period, in the order they subscribed. A handler
+ * that publishes feeds the subscriptions after it in the same pass.
+ */
+
+/* Exported constants --------------------------------------------------------*/
+
+#define BUS_QUEUE_DEPTH 8U // Messages per subscription, a power of two
+
+/* Exported types ------------------------------------------------------------*/
+
+typedef enum
+{
+  BUS_TOPIC_RAW_SAMPLE, // Compensated sensor sample or its fault, every read. Main loop
+  BUS_TOPIC_SAMPLE,     // Filtered sample, every APP_FILTER_DECIMATION reads. Main loop
+  BUS_TOPIC_TIME,       // RTC second rollover. RTC wakeup interrupt
+  BUS_TOPIC_ALARM,      // Committed alarm transition. Main loop
+  BUS_TOPIC_COUNT
+} busTopic_t;
+
+/**
+ * @brief Sensor sample in the BME280 fixed-point formats, published for every read: an invalid one carries its fault.
+ */
+typedef struct
+{
+  int32_t temperature; // 0.01 C
+  uint32_t humidity;   // %RH Q22.10
+  faultType_t fault;   // FAULT_TYPE_NONE for a valid sample, otherwise the values are 0
+  uint64_t time;       // RTC time of the read, timestampMs_t
+} busRawSample_t;
+
+/**
+ * @brief Filtered sample.
+ */
+typedef struct
+{
+  float temperature; // C
+  float humidity;    // %RH
+  uint64_t time;     // RTC time of the last raw sample in it, timestampMs_t
+} busSample_t;
+
+/**
+ * @brief Message: header and the payload of its topic.
+ */
+typedef struct
+{
+  busTopic_t topic;
+  uint32_t sequence; // Per topic, from 1
+  uint32_t tick;     // Publication time in ms
+  union
+  {
+    busRawSample_t raw;
+    busSample_t sample;
+    alarmEvent_t alarm;
+  };
+} busMessage_t;
+
+/**
+ * @brief Consumer callback, run by API_BUS_Dispatch for each queued message.
+ */
+typedef void (*busHandler_t)(const busMessage_t *message);
+
+/**
+ * @brief Subscription to one topic, owned by the consumer: static storage, never freed.
+ */
+typedef struct busSubscription
+{
+  busTopic_t topic;
+  busHandler_t handler;     // NULL for a subscription read with API_BUS_Receive
+  uint32_t periodMs;        // Minimum time between two dispatches, 0 for every pass
+  uint32_t lastDispatchMs;
+  uint32_t expected;        // Sequence of the next message
+  uint32_t missed;          // Messages skipped, seen as sequence gaps
+  spscQueue_t queue;        // Over slots
+  busMessage_t slots[BUS_QUEUE_DEPTH];
+  struct busSubscription *next;     // Next subscription of the same topic
+  struct busSubscription *nextAll;  // Next subscription in dispatch order
+} busSubscription_t;
+
+/**
+ * @brief Publication counters of a topic.
+ */
+typedef struct
+{
+  uint32_t published; // Messages published
+  uint32_t refused;   // Deliveries refused by a full queue, one per subscription
+} busTopicStats_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Removes every subscription and restarts the sequence numbers. Call before the publishers start.
+ * @param  None
+ * @retval None
+ */
+void API_BUS_Init(void);
+
+/**
+ * @brief  Subscribes to a topic. Call from the main loop, before or after the publisher starts: the
+ *         subscription is linked once complete.
+ * @param  busSubscription_t *subscription: Consumer-owned storage, initialised here.
+ * @param  busTopic_t topic: Topic.
+ * @param  busHandler_t handler: Run by API_BUS_Dispatch, NULL to read with API_BUS_Receive.
+ * @param  uint32_t periodMs: Minimum time between two dispatches, 0 for every pass.
+ * @retval bool: false if the topic is invalid or the subscription already linked.
+ */
+bool API_BUS_Subscribe(busSubscription_t *subscription, busTopic_t topic, busHandler_t handler, uint32_t periodMs);
+
+/**
+ * @brief  Numbers a message and queues a copy for every subscription of its topic. Never waits. Only the
+ *         context that owns the topic may call it.
+ * @param  busTopic_t topic: Topic.
+ * @param  busMessage_t *message: Payload in; header (topic, sequence) filled in. The tick is the caller's.
+ * @retval bool: true if every subscription took the message.
+ */
+bool API_BUS_Publish(busTopic_t topic, busMessage_t *message);
+
+/**
+ * @brief  Takes the oldest queued message of a subscription and accounts for the messages missed before it.
+ * @param  busSubscription_t *subscription: Subscription.
+ * @param  busMessage_t *message: Receives the message.
+ * @retval bool: false if the queue is empty.
+ */
+bool API_BUS_Receive(busSubscription_t *subscription, busMessage_t *message);
+
+/**
+ * @brief  Runs the handler of every due subscription on each of its queued messages, in subscription order.
+ *         Call from the main loop.
+ * @param  uint32_t now: Current tick in ms.
+ * @retval None
+ */
+void API_BUS_Dispatch(uint32_t now);
+
+/**
+ * @brief  Returns the publication counters of a topic.
+ * @param  busTopic_t topic: Topic.
+ * @retval busTopicStats_t: Counters, zero for an invalid topic.
+ */
+busTopicStats_t API_BUS_GetTopicStats(busTopic_t topic);
+
+/**
+ * @brief  Returns the messages missed by all subscriptions together.
+ * @param  None
+ * @retval uint32_t: Missed messages.
+ */
+uint32_t API_BUS_GetMissed(void);
+
+#endif /* API_INC_API_BUS_H_ */
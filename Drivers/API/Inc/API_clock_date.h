@@ -1,17 +1,49 @@
 #ifndef API_INC_API_CLOCK_DATE_H_
 #define API_INC_API_CLOCK_DATE_H_
 
+#include <stdint.h>
+#include <stdbool.h>
+
 #include "stm32f4xx_hal.h"
 #include "stm32f4xx_nucleo_144.h" /* <- BSP include */
 
-// Global variables for storing RTC time and date settings
-extern RTC_TimeTypeDef sTime;
-extern RTC_DateTypeDef sDate;
+#include "API_bus.h"
+
+/* Exported constants --------------------------------------------------------*/
+
+// RTC wakeup timer configuration, clocked from ck_spre (1 Hz) so the event fires on every second rollover.
+// Same as the RTC WakeUp settings in SPI_test.ioc, where the RTC_WKUP interrupt is enabled at priority 15
+#define CLOCK_WAKEUP_CLOCK RTC_WAKEUPCLOCK_CK_SPRE_16BITS
+#define CLOCK_WAKEUP_COUNTER 0 // Wakeup period = (CLOCK_WAKEUP_COUNTER + 1) seconds
+
+// Prescalers giving ck_spre = LSE / ((ASYNCH + 1) * (SYNCH + 1)) = 1 Hz, as set in SPI_test.ioc (RTC clocked from the
+// 32.768 kHz LSE crystal, X2 on the Nucleo-144)
+#define CLOCK_RTC_ASYNCH_PREDIV 127 // 32768 Hz / 128 = 256 Hz
+#define CLOCK_RTC_SYNCH_PREDIV 255  // 256 Hz / 256 = 1 Hz
+
+// Backup-domain marker telling a warm boot that the RTC calendar is already running and valid
+#define CLOCK_BKP_VALID_REG RTC_BKP_DR0
+#define CLOCK_BKP_VALID_MAGIC 0x32F2
+
+// Drift trim applied through smooth calibration on a cold boot, in ppm (positive = RTC runs fast)
+#ifndef CLOCK_RTC_DRIFT_TRIM_PPM
+#define CLOCK_RTC_DRIFT_TRIM_PPM 0
+#endif
+#define CLOCK_CALIB_PULSES_PER_PPM_X1000 1049 // 2^20 RTCCLK cycles per 32 s window -> 1.048576 pulses per ppm
+#define CLOCK_CALIB_PLUS_PULSES 512           // Pulses inserted when CALP is set
+#define CLOCK_CALIB_MAX_MINUS_PULSES 511      // CALM field width is 9 bits
+
+// Time unit conversion
+#define CLOCK_MS_PER_SECOND 1000U
+
 extern RTC_HandleTypeDef hrtc;
 
 /* Exported functions ------------------------------------------------------- */
+bool ClockIsCalendarValid(void);
+void ClockResume(void);
 void ClockInit(void);
-void ClockUpdateTimeDate(void);
+void ClockSetDriftTrim(int32_t trimPpm);
+void ClockGetTimeDate(RTC_TimeTypeDef *time, RTC_DateTypeDef *date);
 void Clock_Error_Handler(void);
 
 #endif /* API_INC_API_CLOCK_DATE_H_ */
@@ -0,0 +1,77 @@
+#ifndef API_INC_API_CODEC_H_
+#define API_INC_API_CODEC_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+#define CODEC_MAX_CHANNELS 4U
+#define CODEC_VARINT_MAX_SIZE 5U // A 32-bit value takes at most 5 groups of 7 bits
+#define CODEC_MAX_SAMPLE_SIZE(channels) (CODEC_VARINT_MAX_SIZE * (1U + (channels)))
+
+#define CODEC_BASE64_SIZE(bytes) ((((bytes) + 2U) / 3U) * 4U) // Encoded length, without terminator
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Encoder or decoder state of one sample series. A block starts at API_CODEC_Reset and is
+ *        decodable on its own: the first sample is absolute, the second carries the first time delta,
+ *        the next ones a delta-of-delta timestamp. Values are always deltas from the previous sample.
+ *        Every number is zig-zag mapped and written as a little-endian base-128 varint.
+ */
+typedef struct
+{
+  uint8_t channels;
+  uint16_t count;                        // Samples encoded or decoded since the last reset
+  uint32_t prevTimestamp;
+  int32_t prevTimeDelta;
+  int32_t prevValues[CODEC_MAX_CHANNELS];
+} codecState_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Starts a new block. The next sample is encoded in full.
+ * @param  state: Codec state.
+ * @param  channels: Values per sample (<= CODEC_MAX_CHANNELS).
+ * @retval bool: true on success, false if the channel count is invalid.
+ */
+bool API_CODEC_Reset(codecState_t *state, uint8_t channels);
+
+/**
+ * @brief  Encodes one sample at the end of a buffer.
+ * @param  state: Encoder state.
+ * @param  timestamp: Sample time, in any monotonic unit.
+ * @param  values: state->channels fixed-point values.
+ * @param  out: Destination buffer.
+ * @param  size: Free bytes in the destination buffer.
+ * @retval uint16_t: Bytes written, 0 if the buffer is too small (the state is then left unchanged).
+ */
+uint16_t API_CODEC_EncodeSample(codecState_t *state, uint32_t timestamp, const int32_t *values, uint8_t *out,
+                                uint16_t size);
+
+/**
+ * @brief  Decodes one sample.
+ * @param  state: Decoder state, reset at the same block boundaries as the encoder.
+ * @param  in: Encoded bytes.
+ * @param  size: Available encoded bytes.
+ * @param  timestamp: Decoded sample time.
+ * @param  values: Decoded values, state->channels entries.
+ * @retval uint16_t: Bytes consumed, 0 on truncated input.
+ */
+uint16_t API_CODEC_DecodeSample(codecState_t *state, const uint8_t *in, uint16_t size, uint32_t *timestamp,
+                                int32_t *values);
+
+/**
+ * @brief  Encodes bytes as null-terminated base64 text, to carry a block on a text link.
+ * @param  in: Bytes to encode.
+ * @param  length: Number of bytes.
+ * @param  out: Destination string.
+ * @param  size: Destination size, at least CODEC_BASE64_SIZE(length) + 1.
+ * @retval uint16_t: Characters written, 0 if the destination is too small.
+ */
+uint16_t API_CODEC_ToBase64(const uint8_t *in, uint16_t length, char *out, uint16_t size);
+
+#endif /* API_INC_API_CODEC_H_ */
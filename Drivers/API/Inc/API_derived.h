@@ -0,0 +1,95 @@
+#ifndef API_INC_API_DERIVED_H_
+#define API_INC_API_DERIVED_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Derived humidity channels from a fixed-point sample (temperature in 0.01 C, humidity in %RH Q22.10, as the
+ * BME280 compensation gives them), in integer arithmetic: no floating point, no log or exp.
+ *
+ * - Saturation vapour pressure: the Magnus formula (b = 17.62, c = 243.12 C) tabulated every DERIVED_TABLE_STEP_C
+ *   from DERIVED_TABLE_LOWEST_C to DERIVED_TABLE_HIGHEST_C, interpolated with Newton's quadratic term: the
+ *   linear chord alone is 2e-4 off at 85 C.
+ * - Dew point: the same table read backwards at the vapour pressure RH x es(T), which is the Magnus dew point:
+ *   a binary search for the segment, its chord, then one Newton step. It saturates at the ends of the table.
+ * - Absolute humidity: water vapour as an ideal gas, e / (Rv x T).
+ * - Heat index: the NWS algorithm, Steadman's simple formula below 80 F and the Rothfusz regression with its
+ *   low and high humidity adjustments above, with the temperature kept exact in 1/500 F.
+ *
+ * The channels are lazy: nothing is computed until a consumer asks for one, and each is computed once per
+ * sample. The results, and the vapour pressure they share, are cached against the sample sequence number.
+ *
+ * Error bounds against the same formulas in double precision, over -40 to 85 C and 0 to 100 %RH, measured by
+ * Sim/Src/sim_derivedbench.c: the rounding of the result, one unit in the last place.
+ */
+
+/* Exported constants --------------------------------------------------------*/
+
+#define DERIVED_TABLE_LOWEST_C (-60)
+#define DERIVED_TABLE_HIGHEST_C 90
+#define DERIVED_TABLE_STEP_C 1
+
+#define DERIVED_DEW_POINT_MAX_ERROR 1U         // 0.01 C
+#define DERIVED_ABSOLUTE_HUMIDITY_MAX_ERROR 1U // 0.01 g/m3
+#define DERIVED_HEAT_INDEX_MAX_ERROR 1U        // 0.01 C
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Derived channels.
+ */
+typedef enum
+{
+  DERIVED_CHANNEL_DEW_POINT,         // 0.01 C
+  DERIVED_CHANNEL_ABSOLUTE_HUMIDITY, // 0.01 g/m3
+  DERIVED_CHANNEL_HEAT_INDEX,        // 0.01 C
+  DERIVED_CHANNEL_COUNT,
+} derivedChannel_t;
+
+/**
+ * @brief Sample the channels are derived from.
+ */
+typedef struct
+{
+  uint32_t sequence;   // Identifies the sample, 0 never matches the cache: computed on every call
+  int32_t temperature; // 0.01 C
+  uint32_t humidity;   // %RH Q22.10
+} derivedSample_t;
+
+/**
+ * @brief Requests since API_DERIVED_Init.
+ */
+typedef struct
+{
+  uint32_t computed; // Channel values computed
+  uint32_t reused;   // Channel values taken from the cache
+} derivedStats_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Empties the cache and clears the counters.
+ * @param  None
+ * @retval None
+ */
+void API_DERIVED_Init(void);
+
+/**
+ * @brief  Returns one derived channel of a sample, computed on the first request for that sample.
+ * @param  sample: Sample.
+ * @param  channel: Channel.
+ * @param  value: Receives the value in the channel's unit.
+ * @retval bool: false if an argument is invalid.
+ */
+bool API_DERIVED_Get(const derivedSample_t *sample, derivedChannel_t channel, int32_t *value);
+
+/**
+ * @brief  Returns the request counters.
+ * @param  None
+ * @retval derivedStats_t: Counters.
+ */
+derivedStats_t API_DERIVED_GetStats(void);
+
+#endif /* API_INC_API_DERIVED_H_ */
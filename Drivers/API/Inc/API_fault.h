@@ -0,0 +1,120 @@
+#ifndef API_INC_API_FAULT_H_
+#define API_INC_API_FAULT_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "API_bme280.h"
+
+/*
+ * BME280 fault manager. Every read goes through API_FAULT_CheckRead, which classifies it:
+ *
+ * - bus: nothing drives MISO (all bytes 0xFF), or the SPI reported an error or the sampler aborted a hung read;
+ * - id: a device answers with another chip ID;
+ * - range: a skipped measurement (the sensor was reset behind our back and sleeps) or a temperature outside
+ *   the operating range;
+ * - stuck: both raw results unchanged for FAULT_STUCK_MS and at least FAULT_STUCK_MIN_READS reads, which the
+ *   ADC noise never allows on a converting sensor.
+ *
+ * A faulty read is never used, the caller marks its sample invalid. FAULT_TRIP_READS faulty reads in a row (one
+ * for stuck, already a long observation) start a recovery, run by API_FAULT_Process one step per call so that
+ * nothing waits: soft reset, FAULT_RESET_SETTLE_MS of start-up, chip ID check, calibration and configuration,
+ * then FAULT_VERIFY_READS good reads. Until the last of them every read is invalid, FAULT_TYPE_RECOVERY, and only
+ * failures after the configuration are judged: the reads of the first conversion are discarded, a faulty read
+ * after them fails the attempt.
+ * A failed attempt waits a back-off that doubles from FAULT_BACKOFF_MIN_MS to FAULT_BACKOFF_MAX_MS before the
+ * next one, so a missing sensor costs one short SPI exchange every few seconds.
+ *
+ * SPI1 is shared with the SD card and the sampler's DMA: each recovery step takes it with API_SAMPLER_AcquireBus,
+ * and waits for the next call if it is busy.
+ */
+
+/* Exported constants --------------------------------------------------------*/
+
+#define FAULT_TRIP_READS 3U            // Faulty reads in a row that start a recovery
+#define FAULT_STUCK_MS 30000U          // Unchanged raw results for this long...
+#define FAULT_STUCK_MIN_READS 8U       // ...over at least this many reads is a stuck sensor
+#define FAULT_RESET_SETTLE_MS 10U      // Start-up after the soft reset, 2 ms in the datasheet
+#define FAULT_FIRST_CONVERSION_MS 100U // First result after the configuration: 16x oversampling of T and H, IIR
+#define FAULT_VERIFY_READS 2U          // Good reads after the configuration that end a recovery
+#define FAULT_BACKOFF_MIN_MS 100U      // Wait after the first failed attempt, doubled after each
+#define FAULT_BACKOFF_MAX_MS 10000U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Verdict on a read, and cause of a recovery.
+ */
+typedef enum
+{
+  FAULT_TYPE_NONE,     // Valid read
+  FAULT_TYPE_BUS,      // No answer or SPI failure
+  FAULT_TYPE_ID,       // Wrong chip ID
+  FAULT_TYPE_STUCK,    // Raw results frozen
+  FAULT_TYPE_RANGE,    // Skipped measurement or implausible result
+  FAULT_TYPE_RECOVERY, // Read during a recovery, before the sensor is verified
+  FAULT_TYPE_COUNT,
+} faultType_t;
+
+/**
+ * @brief Recovery state.
+ */
+typedef enum
+{
+  FAULT_STATE_OK,        // Sensor running
+  FAULT_STATE_RESET,     // Soft reset to write
+  FAULT_STATE_CONFIGURE, // Start-up, then ID check and configuration
+  FAULT_STATE_VERIFY,    // Configured, waiting for FAULT_VERIFY_READS good reads
+  FAULT_STATE_BACKOFF,   // Attempt failed, waiting before the next one
+} faultState_t;
+
+/**
+ * @brief Recovery state and counters since API_FAULT_Init.
+ */
+typedef struct
+{
+  faultState_t state;
+  faultType_t lastFault;            // Cause of the last recovery or failed attempt, FAULT_TYPE_NONE before any
+  uint32_t reads[FAULT_TYPE_COUNT]; // Reads per verdict, [FAULT_TYPE_NONE] the valid ones; sampler failures included
+  uint32_t resets;                  // Soft resets written
+  uint32_t attempts;                // Recovery attempts that failed
+  uint32_t recoveries;              // Recoveries completed
+  uint32_t backoffMs;               // Wait after the next failed attempt
+} faultStatus_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Starts the fault manager from the result of the boot initialisation.
+ * @param  bme280Status_t bootStatus: Result of API_BME280_Init, a failure starts with a back-off.
+ * @param  uint32_t nowMs: Time in ms.
+ * @retval None
+ */
+void API_FAULT_Init(bme280Status_t bootStatus, uint32_t nowMs);
+
+/**
+ * @brief  Classifies a read and advances the recovery with it.
+ * @param  bme280Status_t readStatus: Result of the read.
+ * @param  const bme280Sample_t *sample: Sample compensated by the read, used only if readStatus is BME280_OK.
+ * @param  uint32_t nowMs: Read time in ms.
+ * @retval faultType_t: FAULT_TYPE_NONE if the sample is valid, otherwise why it is not.
+ */
+faultType_t API_FAULT_CheckRead(bme280Status_t readStatus, const bme280Sample_t *sample, uint32_t nowMs);
+
+/**
+ * @brief  Counts the sampler's failed and aborted reads as bus faults and runs one recovery step. Never waits.
+ *         Call from the main loop.
+ * @param  uint32_t nowMs: Time in ms.
+ * @retval None
+ */
+void API_FAULT_Process(uint32_t nowMs);
+
+/**
+ * @brief  Returns the recovery state and the counters.
+ * @param  None
+ * @retval faultStatus_t: Status.
+ */
+faultStatus_t API_FAULT_GetStatus(void);
+
+#endif /* API_INC_API_FAULT_H_ */
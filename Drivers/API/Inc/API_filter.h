@@ -0,0 +1,70 @@
+#ifndef API_INC_API_FILTER_H_
+#define API_INC_API_FILTER_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+// Compile-time buffer sizes, every channel reserves this much RAM whatever its runtime configuration
+#define FILTER_MEDIAN_MAX_WINDOW 7 // Largest median-of-N spike rejector (odd)
+#define FILTER_MAX_DECIMATION 16   // Largest decimation ratio of the moving-average decimator
+#define FILTER_MAX_EMA_SHIFT 8     // Smallest EMA coefficient is 1 / 2^FILTER_MAX_EMA_SHIFT
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Runtime configuration of a filter channel. Stages run in order median -> decimator -> EMA.
+ */
+typedef struct
+{
+  uint8_t medianWindow; // Odd window of the median stage, 1 disables it (<= FILTER_MEDIAN_MAX_WINDOW)
+  uint8_t decimation;   // Raw samples averaged into each output, 1 disables it (<= FILTER_MAX_DECIMATION)
+  uint8_t emaShift;     // EMA coefficient alpha = 1 / 2^emaShift, 0 disables it (<= FILTER_MAX_EMA_SHIFT)
+} filterConfig_t;
+
+/**
+ * @brief State of one filter channel. All arithmetic is fixed point on the caller's integer unit.
+ */
+typedef struct
+{
+  filterConfig_t config;
+  int32_t medianRing[FILTER_MEDIAN_MAX_WINDOW]; // Circular buffer of the last raw samples
+  uint8_t medianHead;
+  uint8_t medianCount;
+  int32_t decimatorSum;  // Running sum of the current decimation block
+  uint8_t decimatorCount;
+  int32_t emaState;      // EMA output scaled by 2^emaShift to keep the fractional bits
+  bool emaPrimed;
+} filterChannel_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Initializes a filter channel with a configuration. Out-of-range fields are clamped.
+ * @param  channel: Channel state to initialize.
+ * @param  config: Stage configuration.
+ * @retval None
+ */
+void API_FILTER_Init(filterChannel_t *channel, const filterConfig_t *config);
+
+/**
+ * @brief  Changes the configuration of a running channel without a restart: the median keeps its newest samples,
+ *         the EMA keeps its output, the decimator starts a new block. Out-of-range fields are clamped.
+ * @param  channel: Channel state.
+ * @param  config: New stage configuration.
+ * @retval None
+ */
+void API_FILTER_Reconfigure(filterChannel_t *channel, const filterConfig_t *config);
+
+/**
+ * @brief  Feeds one raw sample and produces a filtered output once per decimation block.
+ * @param  channel: Channel state.
+ * @param  raw: Raw sample in fixed point.
+ * @param  output: Filtered sample, written only when the function returns true.
+ * @retval bool: true when a new decimated output is available.
+ */
+bool API_FILTER_Push(filterChannel_t *channel, int32_t raw, int32_t *output);
+
+#endif /* API_INC_API_FILTER_H_ */
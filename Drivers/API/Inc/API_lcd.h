@@ -7,8 +7,6 @@
 #include "stm32f4xx_hal.h"
 #include "stm32f4xx_nucleo_144.h"
 
-#include "API_lcd_port.h"
-
 /* Constants ----------------------------------------------------------------*/
 
 // LCD control and data mode flags
@@ -77,6 +75,10 @@
 #define BCD_LOW_NIBBLE_MASK 0x0F  // Mask to extract the low nibble (lower 4 bits)
 #define BCD_HIGH_NIBBLE_SHIFT 4   // Number of bits to shift the high nibble to the right
 
+/* Port include, after the constants its inline definitions use ------------*/
+
+#include "API_lcd_port.h"
+
 /* Public API Functions ----------------------------------------------------- */
 
 _Bool API_LCD_Initialize(void);
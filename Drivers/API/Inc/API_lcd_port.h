@@ -1,18 +1,56 @@
-#include <stdio.h>
-#include <stdbool.h>
-
-#include "stm32f4xx_hal.h"        /* <- HAL include */
-#include "stm32f4xx_nucleo_144.h" /* <- BSP include */
-#include "API_lcd.h"              /* <- LCD driver include */
-
-#define LCD_WRITE_CMD 1
-
-/* I2C handler declaration */
-
-extern I2C_HandleTypeDef hi2c1;
-
-/* Exported functions ------------------------------------------------------- */
-
-void LCD_HAL_I2C_Write(uint8_t valor);
-void LCD_HAL_Delay(uint32_t delay);
-void LCD_HAL_Blink(Led_TypeDef Led);
+#ifndef API_INC_API_LCD_PORT_H_
+#define API_INC_API_LCD_PORT_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "stm32f4xx_hal.h"        /* <- HAL include */
+#include "stm32f4xx_nucleo_144.h" /* <- BSP include */
+#include "API_port.h"             /* <- Port binding */
+#include "API_lcd.h"              /* <- LCD driver include */
+
+#define LCD_WRITE_CMD 1
+
+/* I2C handler declaration */
+
+extern I2C_HandleTypeDef hi2c1;
+
+/* Exported functions ------------------------------------------------------- */
+
+API_PORT_FUNC void LCD_HAL_I2C_Write(uint8_t valor);
+API_PORT_FUNC void LCD_HAL_Delay(uint32_t delay);
+API_PORT_FUNC void LCD_HAL_Blink(Led_TypeDef Led);
+
+/* Port Function Definitions ------------------------------------------------ */
+
+// Inlined into every driver, or compiled once by API_lcd_port.c when the port is bound at link time
+#if API_PORT_STATIC_INLINE || defined(API_LCD_PORT_IMPLEMENTATION)
+
+API_PORT_FUNC void LCD_HAL_I2C_Write(uint8_t valor)
+{
+  HAL_I2C_Master_Transmit(&hi2c1, LCD_I2C_ADDRESS << LCD_WRITE_CMD, &valor, sizeof(valor), HAL_MAX_DELAY);
+}
+
+/**
+ *  @brief  Provides a delay for a specified number of milliseconds.
+ * @param  delay: The amount of time, in milliseconds, to delay.
+ * @retval None
+ */
+API_PORT_FUNC void LCD_HAL_Delay(uint32_t delay)
+{
+  HAL_Delay(delay);
+}
+
+/**
+ * @brief  Toggles the state of the specified LED.
+ * @param  Led: Specifies the LED to be toggled. This parameter can be one of the LED identifiers defined in the board support package (BSP), such as `LED2`, `LED3`, etc.
+ * @retval None
+ */
+API_PORT_FUNC void LCD_HAL_Blink(Led_TypeDef Led)
+{
+  BSP_LED_Toggle(Led);
+}
+
+#endif /* API_PORT_STATIC_INLINE || API_LCD_PORT_IMPLEMENTATION */
+
+#endif /* API_INC_API_LCD_PORT_H_ */
@@ -0,0 +1,103 @@
+#ifndef API_INC_API_LOG_H_
+#define API_INC_API_LOG_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "API_timestamp.h"
+#include "API_log_port.h"
+
+/* Exported constants --------------------------------------------------------*/
+
+// Sector header: magic, sequence number and its complement, written right after the erase
+#define LOG_SECTOR_MAGIC 0x314C4F47UL // "GOL1" little-endian
+#define LOG_SECTOR_HEADER_SIZE 12U
+
+// Block header word: magic | body length in words << 8 | record count << 16 | CRC-8 of the body << 24
+#define LOG_BLOCK_MAGIC 0xA5U
+#define LOG_BLOCK_HEADER_SIZE 4U
+
+// RAM staging block, written to flash in one go when full or when a delta does not fit
+#define LOG_BLOCK_MAX_RECORDS 32U
+#define LOG_BLOCK_BASE_SIZE 8U  // First record, absolute: timestamp (4), temperature (2), humidity (2)
+#define LOG_BLOCK_DELTA_SIZE 3U // Next records: seconds since previous (1), temperature delta (1), humidity delta (1)
+#define LOG_BLOCK_MAX_BODY_SIZE (LOG_BLOCK_BASE_SIZE + (LOG_BLOCK_MAX_RECORDS - 1U) * LOG_BLOCK_DELTA_SIZE)
+#define LOG_BLOCK_MAX_BODY_WORDS ((LOG_BLOCK_MAX_BODY_SIZE + 3U) / 4U)
+
+// Next sector is erased in the background once the head sector is this full (percent)
+#define LOG_PREERASE_THRESHOLD_PERCENT 75U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief One logged sample. Values are fixed point in hundredths of their unit.
+ */
+typedef struct
+{
+  timestamp_t timestamp; // Seconds since 2000-01-01, records must be appended in time order
+  int16_t temperature;   // Hundredths of a degree Celsius
+  uint16_t humidity;     // Hundredths of %RH
+} logRecord_t;
+
+/**
+ * @brief Recovery and wear counters.
+ */
+typedef struct
+{
+  uint32_t blocks;      // Valid blocks found at boot plus blocks written since
+  uint32_t tornBlocks;  // Blocks skipped because their CRC failed (interrupted write)
+  uint32_t erases;      // Sector erases since boot
+  uint32_t dropped;     // Records lost because the staging block could not be flushed
+  uint32_t headSequence;
+} logStatus_t;
+
+/**
+ * @brief Visitor called by API_LOG_ReadRange for each record, in time order.
+ * @retval bool: false to stop the iteration.
+ */
+typedef bool (*logVisitor_t)(const logRecord_t *record, void *context);
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Scans the log area and resumes appending after the last complete block.
+ *         An empty or unrecognised area is formatted.
+ * @param  None
+ * @retval bool: true if the log is ready, false on a flash error.
+ */
+bool API_LOG_Init(void);
+
+/**
+ * @brief  Appends a record to the RAM staging block, flushing the block first if it is full
+ *         or if the record cannot be delta-encoded against the previous one.
+ * @param  record: Record to append.
+ * @retval bool: true if the record was staged, false if it was dropped.
+ */
+bool API_LOG_Append(const logRecord_t *record);
+
+/**
+ * @brief  Writes the staging block to flash. Deferred while a background erase is running.
+ * @param  None
+ * @retval bool: true if the staging block is empty afterwards.
+ */
+bool API_LOG_Flush(void);
+
+/**
+ * @brief  Visits the logged records with from <= timestamp <= to, oldest first, including the staged ones.
+ * @param  from: First timestamp of the range.
+ * @param  to: Last timestamp of the range.
+ * @param  visitor: Called for each record.
+ * @param  context: Passed to the visitor.
+ * @retval uint32_t: Number of records visited.
+ */
+uint32_t API_LOG_ReadRange(timestamp_t from, timestamp_t to, logVisitor_t visitor, void *context);
+
+/**
+ * @brief  Returns the recovery and wear counters.
+ * @param  None
+ * @retval logStatus_t: Counters.
+ */
+logStatus_t API_LOG_GetStatus(void);
+
+#endif /* API_INC_API_LOG_H_ */
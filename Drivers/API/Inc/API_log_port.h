@@ -0,0 +1,66 @@
+#ifndef API_INC_API_LOG_PORT_H_
+#define API_INC_API_LOG_PORT_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f4xx_hal.h" /* <- HAL include */
+
+/* Exported constants --------------------------------------------------------*/
+
+// Flash geometry of the area reserved in STM32F429ZITX_FLASH.ld (LOGFLASH), keep both in sync
+#define LOG_FLASH_FIRST_SECTOR FLASH_SECTOR_20 // First HAL sector number of the area
+#define LOG_FLASH_SECTOR_COUNT 4U              // Sectors 20-23
+#define LOG_FLASH_SECTOR_SIZE 0x20000UL        // 128 KB each
+#define LOG_FLASH_ERASED_WORD 0xFFFFFFFFUL     // Content of an erased word
+
+#define LOG_FLASH_IRQ_PRIORITY 0x0F // Lowest priority, the erase completion is not time critical. Same as FLASH_IRQn in SPI_test.ioc
+
+/* Linker symbol, start of the reserved area */
+
+extern uint32_t _slogflash[];
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Enables the flash interrupt used by background sector erases.
+ * @param  None
+ * @retval None
+ */
+void LOG_HAL_Init(void);
+
+/**
+ * @brief  Erases one sector of the log area.
+ * @param  uint8_t sector: Sector index inside the log area (0 .. LOG_FLASH_SECTOR_COUNT - 1).
+ * @param  bool background: true to start an interrupt-driven erase and return at once, false to wait for it.
+ * @retval bool: true if the erase completed (blocking) or started (background), false on error.
+ */
+bool LOG_HAL_EraseSector(uint8_t sector, bool background);
+
+/**
+ * @brief  Tells whether a background erase is still running.
+ * @param  None
+ * @retval bool: true while the flash controller is busy with an erase.
+ */
+bool LOG_HAL_IsEraseBusy(void);
+
+/**
+ * @brief  Programs consecutive 32-bit words. The target words must be erased.
+ * @param  uint8_t sector: Sector index inside the log area.
+ * @param  uint32_t offset: Byte offset inside the sector, word aligned.
+ * @param  const uint32_t *words: Words to program.
+ * @param  uint16_t count: Number of words.
+ * @retval bool: true on success, false on error.
+ */
+bool LOG_HAL_Program(uint8_t sector, uint32_t offset, const uint32_t *words, uint16_t count);
+
+/**
+ * @brief  Returns a read pointer into the memory-mapped log area.
+ * @param  uint8_t sector: Sector index inside the log area.
+ * @param  uint32_t offset: Byte offset inside the sector.
+ * @retval const uint8_t *: Address of the byte.
+ */
+const uint8_t *LOG_HAL_Read(uint8_t sector, uint32_t offset);
+
+#endif /* API_INC_API_LOG_PORT_H_ */
@@ -0,0 +1,109 @@
+#ifndef API_INC_API_MEM_H_
+#define API_INC_API_MEM_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+// Capacities, fixed at compile time: the whole budget is static .bss and shows in the map file
+#define MEM_ALIGN 8U                  // Alignment of every pool block
+
+// Telemetry lines built on demand: same size as APP_STATS_MSG_SIZE, the longest UART line. The main loop builds
+// and sends one line at a time, the second block only lets a leaked block show in the high-water mark before a
+// line is lost
+#define MEM_MESSAGE_BLOCK_SIZE 128U
+#define MEM_MESSAGE_BLOCK_COUNT 2U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Fixed-block pools. Every block of a pool has the same size, so alloc and free are O(1) and never fragment.
+ */
+typedef enum
+{
+  MEM_POOL_MESSAGE,
+  MEM_POOL_COUNT,
+} memPool_t;
+
+/**
+ * @brief Occupancy of a pool (in blocks) or of the C library heap (in bytes).
+ */
+typedef struct
+{
+  uint32_t capacity;
+  uint32_t used;
+  uint32_t highWater; // Largest "used" seen since API_MEM_Init
+  uint32_t failures;  // Requests refused: exhausted, sealed, or invalid/double free
+} memStats_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Empties every pool and unseals the heap. Call once, before any allocation.
+ * @param  None
+ * @retval None
+ */
+void API_MEM_Init(void);
+
+/**
+ * @brief  Ends initialisation: later C library heap requests (_sbrk) fail.
+ * @param  None
+ * @retval None
+ */
+void API_MEM_Seal(void);
+
+/**
+ * @brief  Tells whether API_MEM_Seal was called.
+ * @param  None
+ * @retval bool: true once sealed.
+ */
+bool API_MEM_IsSealed(void);
+
+/**
+ * @brief  Takes a block from a pool. O(1), interrupt safe.
+ * @param  pool: Pool to allocate from.
+ * @retval void *: Block of the pool's block size, NULL if the pool is exhausted.
+ */
+void *API_MEM_PoolAlloc(memPool_t pool);
+
+/**
+ * @brief  Returns a block to its pool. O(1), interrupt safe.
+ * @param  pool: Pool the block was taken from.
+ * @param  block: Block returned by API_MEM_PoolAlloc on the same pool.
+ * @retval bool: true on success, false (and a failure counted) for a foreign, misaligned or already free block.
+ */
+bool API_MEM_PoolFree(memPool_t pool, void *block);
+
+/**
+ * @brief  Returns the block size of a pool.
+ * @param  pool: Pool.
+ * @retval uint16_t: Bytes per block, 0 for an invalid pool.
+ */
+uint16_t API_MEM_PoolBlockSize(memPool_t pool);
+
+/**
+ * @brief  Reads the statistics of a pool.
+ * @param  pool: Pool.
+ * @param  stats: Filled with the pool occupancy in blocks.
+ * @retval bool: true on success, false for an invalid pool.
+ */
+bool API_MEM_GetPoolStats(memPool_t pool, memStats_t *stats);
+
+/**
+ * @brief  Accounts a C library heap request, called from _sbrk.
+ * @param  increment: Bytes requested.
+ * @retval bool: true to grant it, false to refuse it (after API_MEM_Seal).
+ */
+bool API_MEM_HeapRequest(ptrdiff_t increment);
+
+/**
+ * @brief  Reads the C library heap statistics: bytes obtained through _sbrk and requests refused after the seal.
+ * @param  stats: Filled with the heap usage in bytes (capacity 0: bounded by the linker script, not by this module).
+ * @retval None
+ */
+void API_MEM_GetHeapStats(memStats_t *stats);
+
+#endif /* API_INC_API_MEM_H_ */
@@ -0,0 +1,31 @@
+#ifndef API_INC_API_PORT_H_
+#define API_INC_API_PORT_H_
+
+/*
+ * Compile-time binding of the bus driver ports (API_bme280_port.h, API_lcd_port.h).
+ *
+ * API_PORT_STATIC_INLINE = 1: the port functions are defined static inline in the port headers,
+ *   so each driver is compiled against its bus and a port call costs exactly the HAL call it wraps.
+ * API_PORT_STATIC_INLINE = 0: the port functions are ordinary external functions, defined in the
+ *   *_port.c files or, in the host simulation, by the virtual peripherals (link-time selection).
+ *
+ * Override from the build (-DAPI_PORT_STATIC_INLINE=0), never per file: all translation units of
+ * one image must agree.
+ */
+
+/* Exported constants --------------------------------------------------------*/
+
+#ifndef API_PORT_STATIC_INLINE
+#define API_PORT_STATIC_INLINE 1 // Target default: drivers inlined onto the HAL
+#endif
+
+/* Exported macro ------------------------------------------------------------*/
+
+// Storage class of the port functions, on both their prototypes and their definitions
+#if API_PORT_STATIC_INLINE
+#define API_PORT_FUNC static inline __attribute__((always_inline))
+#else
+#define API_PORT_FUNC
+#endif
+
+#endif /* API_INC_API_PORT_H_ */
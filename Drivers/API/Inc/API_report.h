@@ -0,0 +1,101 @@
+#ifndef API_INC_API_REPORT_H_
+#define API_INC_API_REPORT_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Telemetry channels subject to report-by-exception.
+ */
+typedef enum
+{
+  REPORT_CHANNEL_TEMPERATURE,
+  REPORT_CHANNEL_HUMIDITY,
+  REPORT_CHANNEL_COUNT,
+} reportChannel_t;
+
+/**
+ * @brief Outcome of evaluating a sample, tells the caller whether and why to send it.
+ */
+typedef enum
+{
+  REPORT_SUPPRESSED, // Within the deadband of the last sent value and the heartbeat is not due
+  REPORT_CHANGE,     // Moved by at least the deadband since the last sent value
+  REPORT_HEARTBEAT,  // Nothing changed but the maximum silent interval elapsed
+  REPORT_EVENT,      // Forced by a state-change event (or first sample, or exception mode off)
+} reportReason_t;
+
+/**
+ * @brief Sent/suppressed counters of one channel.
+ */
+typedef struct
+{
+  uint32_t sent;
+  uint32_t suppressed;
+} reportCounters_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Resets all channels and counters and sets the heartbeat interval.
+ * @param  heartbeatMs: Maximum time between two reports of the same channel.
+ * @retval None
+ */
+void API_REPORT_Init(uint32_t heartbeatMs);
+
+/**
+ * @brief  Enables or disables report-by-exception. When disabled every sample is reported.
+ * @param  enabled: true to suppress unchanged samples.
+ * @retval None
+ */
+void API_REPORT_SetExceptionMode(bool enabled);
+
+/**
+ * @brief  Sets the heartbeat (maximum silent) interval.
+ * @param  heartbeatMs: Interval in milliseconds.
+ * @retval None
+ */
+void API_REPORT_SetHeartbeat(uint32_t heartbeatMs);
+
+/**
+ * @brief  Sets the deadband of a channel, in the channel's unit.
+ * @param  channel: Channel to configure.
+ * @param  deadband: Minimum change from the last sent value that triggers a report.
+ * @retval None
+ */
+void API_REPORT_SetDeadband(reportChannel_t channel, float deadband);
+
+/**
+ * @brief  Forces the next evaluation of every channel to report, used on state-change events.
+ * @param  None
+ * @retval None
+ */
+void API_REPORT_ForceNext(void);
+
+/**
+ * @brief  Decides whether a sample has to be sent and updates the channel's counters.
+ * @param  channel: Channel the sample belongs to.
+ * @param  value: Sample value.
+ * @param  nowMs: Sample time in milliseconds.
+ * @retval reportReason_t: REPORT_SUPPRESSED if the sample must not be sent, the send reason otherwise.
+ */
+reportReason_t API_REPORT_Evaluate(reportChannel_t channel, float value, uint32_t nowMs);
+
+/**
+ * @brief  Returns the counters of a channel.
+ * @param  channel: Channel to query.
+ * @retval reportCounters_t: Sent and suppressed report counts.
+ */
+reportCounters_t API_REPORT_GetCounters(reportChannel_t channel);
+
+/**
+ * @brief  Returns the counters summed over all channels.
+ * @param  None
+ * @retval reportCounters_t: Total sent and suppressed report counts.
+ */
+reportCounters_t API_REPORT_GetTotals(void);
+
+#endif /* API_INC_API_REPORT_H_ */
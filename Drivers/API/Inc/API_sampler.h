@@ -0,0 +1,149 @@
+#ifndef API_INC_API_SAMPLER_H_
+#define API_INC_API_SAMPLER_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "API_bme280.h"
+#include "API_spsc.h"
+
+/*
+ * Timer-triggered BME280 acquisition. A hardware timer interrupt starts each burst read from 0xF7 as an SPI
+ * DMA transfer, so the sample instants follow the timer, not the main loop: LCD, UART and SD card time only
+ * delays when the samples are processed, never when they are taken.
+ *
+ * The DMA writes straight into a slot claimed from an API_SPSC ring, stamped with the tick of the read start,
+ * and the completion interrupt commits it. The main loop takes the reads in order with API_SAMPLER_Read. A trigger that
+ * finds the ring full drops its sample. One that finds the previous read still running after SAMPLER_READ_TIMEOUT_DIV
+ * of a period takes it as hung, a DMA that will never complete: the transfer is aborted and counted as a timeout, so
+ * a lost completion interrupt costs one sample instead of the acquisition. A read younger than that is an overrun.
+ *
+ * SPI1 is shared with the SD card. The main loop holds the bus with API_SAMPLER_AcquireBus for each SD card
+ * operation; a trigger that falls inside one is deferred and the read starts from API_SAMPLER_ReleaseBus.
+ *
+ * Every read start is stamped with the core cycle counter. The interval between two consecutive starts,
+ * against the period, gives the sampling jitter: minimum, maximum and RMS per reporting window.
+ *
+ * API_SAMPLER_SetPeriod changes the period while running, without stopping the timer: the interval running
+ * completes, the next one has the new period. The intervals around a change are left out of the jitter.
+ */
+
+/* Exported constants --------------------------------------------------------*/
+
+#define SAMPLER_PERIOD_US 50000U // 20 Hz, the shortest period and the rate the filter stage is designed for
+#define SAMPLER_QUEUE_DEPTH 32U  // Reads waiting for the main loop, a power of two: 1.6 s, the diagnostics lines at 9600 baud
+#define SAMPLER_FRAME_SIZE (RAW_OUTPUT_DATA_SIZE + 1U) // Address byte, then the burst
+#define SAMPLER_NS_PER_US 1000U
+#define SAMPLER_READ_TIMEOUT_DIV 2U // A read still running half a period after its start is hung: it takes microseconds
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Completed read: start time and the burst from 0xF7.
+ */
+typedef struct
+{
+  uint32_t tick;                      // Read start in ms
+  uint8_t data[RAW_OUTPUT_DATA_SIZE]; // 0xF7 to 0xFE
+} samplerRead_t;
+
+/**
+ * @brief Acquisition counters since API_SAMPLER_Init.
+ */
+typedef struct
+{
+  bool running;
+  uint32_t periodUs;  // Period of the interval running
+  uint32_t reads;     // Reads completed
+  uint32_t deferred;  // Triggers delayed by an SD card operation on SPI1
+  uint32_t overruns;  // Triggers lost: a second one while SPI1 is held, or one during a read just started
+  uint32_t dropped;   // Triggers that found the ring full
+  uint32_t errors;    // Reads failed by the SPI or DMA
+  uint32_t timeouts;  // Hung reads aborted by the next trigger
+} samplerStatus_t;
+
+/**
+ * @brief Deviation of the intervals between read starts from the period, over one reporting window.
+ */
+typedef struct
+{
+  uint32_t intervals; // Intervals measured, 0 if the window is empty
+  int32_t minNs;      // Shortest interval minus the period
+  int32_t maxNs;      // Longest interval minus the period
+  uint32_t rmsNs;     // RMS of the deviations
+} samplerJitter_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Configures the timer, the SPI DMA streams and the cycle counter. Call once the BME280 is initialised.
+ * @param  uint32_t periodUs: Sampling period.
+ * @retval bool: true on success.
+ */
+bool API_SAMPLER_Init(uint32_t periodUs);
+
+/**
+ * @brief  Starts the timer: the first read is triggered one period later.
+ * @param  None
+ * @retval None
+ */
+void API_SAMPLER_Start(void);
+
+/**
+ * @brief  Changes the sampling period from the next timer update on.
+ * @param  uint32_t periodUs: Sampling period, a multiple of SAMPLER_HAL_US_PER_COUNT up to SAMPLER_HAL_PERIOD_MAX_US.
+ * @retval bool: false if the period is out of range or the sampler is not initialised, the period is unchanged.
+ */
+bool API_SAMPLER_SetPeriod(uint32_t periodUs);
+
+/**
+ * @brief  Takes the oldest completed read. Call from the main loop.
+ * @param  samplerRead_t *read: Receives the read.
+ * @retval bool: false if no read is waiting.
+ */
+bool API_SAMPLER_Read(samplerRead_t *read);
+
+/**
+ * @brief  Takes SPI1 for the main loop, for one SD card operation. Triggers from now on are deferred.
+ * @param  None
+ * @retval bool: false while a read is running: try again on the next pass.
+ */
+bool API_SAMPLER_AcquireBus(void);
+
+/**
+ * @brief  Gives SPI1 back and starts the read deferred meanwhile, if any.
+ * @param  None
+ * @retval None
+ */
+void API_SAMPLER_ReleaseBus(void);
+
+/**
+ * @brief  Returns the acquisition counters.
+ * @param  None
+ * @retval samplerStatus_t: Counters.
+ */
+samplerStatus_t API_SAMPLER_GetStatus(void);
+
+/**
+ * @brief  Returns the jitter of the intervals measured since the last call and starts a new window.
+ * @param  None
+ * @retval samplerJitter_t: Jitter of the window.
+ */
+samplerJitter_t API_SAMPLER_TakeJitter(void);
+
+/**
+ * @brief  Timer update interrupt: starts a read, or defers or counts it, or aborts a hung one. Called by the port.
+ * @param  None
+ * @retval None
+ */
+void API_SAMPLER_OnTrigger(void);
+
+/**
+ * @brief  SPI DMA completion interrupt: releases the sensor and commits the read. Called by the port.
+ * @param  bool ok: false if the SPI or DMA reported an error.
+ * @retval None
+ */
+void API_SAMPLER_OnReadDone(bool ok);
+
+#endif /* API_INC_API_SAMPLER_H_ */
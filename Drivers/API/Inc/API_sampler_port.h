@@ -0,0 +1,88 @@
+#ifndef API_INC_API_SAMPLER_PORT_H_
+#define API_INC_API_SAMPLER_PORT_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f4xx_hal.h" /* <- HAL include */
+
+/* Exported constants --------------------------------------------------------*/
+
+// TIM6 counts at 10 kHz, as set in SPI_test.ioc: prescaler 8399 on the 84 MHz APB1 timer clock.
+// TIM6 and the SPI1 DMA streams interrupt at priority 4, above the UART: the trigger latency is the sampling jitter
+#define SAMPLER_HAL_US_PER_COUNT 100U
+#define SAMPLER_HAL_PERIOD_MAX_US (65536U * SAMPLER_HAL_US_PER_COUNT) // 16-bit reload: 6.5536 s
+
+/* Handles of the generated code (main.c) */
+
+extern TIM_HandleTypeDef htim6;
+extern DMA_HandleTypeDef hdma_spi1_rx;
+extern DMA_HandleTypeDef hdma_spi1_tx;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Links the SPI1 DMA streams to hspi1, loads the TIM6 period and starts the DWT cycle counter. TIM6,
+ *         the SPI1 DMA streams and their interrupts are configured by the generated code (MX_TIM6_Init,
+ *         MX_DMA_Init, HAL_SPI_MspInit). Runs after the SD card port init, which links them to its own handle.
+ *         The timer is left stopped.
+ * @param  uint32_t periodUs: Update period, a multiple of SAMPLER_HAL_US_PER_COUNT up to SAMPLER_HAL_PERIOD_MAX_US.
+ * @retval bool: true on success.
+ */
+bool SAMPLER_HAL_Init(uint32_t periodUs);
+
+/**
+ * @brief  Changes the update period through the preloaded reload register: the interval running completes
+ *         with the old period, the one after the next update uses the new one.
+ * @param  uint32_t periodUs: Update period, as for SAMPLER_HAL_Init.
+ * @retval None
+ */
+void SAMPLER_HAL_SetPeriod(uint32_t periodUs);
+
+/**
+ * @brief  Starts TIM6. Each update calls API_SAMPLER_OnTrigger.
+ * @param  None
+ * @retval None
+ */
+void SAMPLER_HAL_Start(void);
+
+/**
+ * @brief  Selects the BME280 and starts a full-duplex DMA transfer on SPI1. API_SAMPLER_OnReadDone reports the end.
+ * @param  const uint8_t *tx: Bytes to send, untouched until completion.
+ * @param  uint8_t *rx: Receive buffer in SRAM (API_DMA_BSS), untouched until completion.
+ * @param  uint16_t size: Bytes.
+ * @retval bool: true if the transfer started.
+ */
+bool SAMPLER_HAL_StartRead(const uint8_t *tx, uint8_t *rx, uint16_t size);
+
+/**
+ * @brief  Deselects the BME280 at the end of a transfer.
+ * @param  None
+ * @retval None
+ */
+void SAMPLER_HAL_EndRead(void);
+
+/**
+ * @brief  Aborts a transfer that never completed: stops both DMA streams and SPI1 and deselects the BME280.
+ *         No callback follows.
+ * @param  None
+ * @retval None
+ */
+void SAMPLER_HAL_AbortRead(void);
+
+/**
+ * @brief  Reads the core cycle counter.
+ * @param  None
+ * @retval uint32_t: Cycles, wrapping at 2^32.
+ */
+uint32_t SAMPLER_HAL_GetCycles(void);
+
+/**
+ * @brief  Returns the cycle counter rate.
+ * @param  None
+ * @retval uint32_t: Cycles per microsecond.
+ */
+uint32_t SAMPLER_HAL_GetCyclesPerUs(void);
+
+#endif /* API_INC_API_SAMPLER_PORT_H_ */
@@ -0,0 +1,141 @@
+#ifndef API_INC_API_SDCARD_H_
+#define API_INC_API_SDCARD_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+#define SDCARD_BLOCK_SIZE 512U // Bytes per block, fixed in SPI mode (CMD16 for standard capacity cards)
+
+// SPI-mode commands (physical layer simplified specification, 7.3.1)
+#define SDCARD_CMD0_GO_IDLE_STATE 0U
+#define SDCARD_CMD8_SEND_IF_COND 8U
+#define SDCARD_CMD9_SEND_CSD 9U
+#define SDCARD_CMD16_SET_BLOCKLEN 16U
+#define SDCARD_CMD17_READ_SINGLE_BLOCK 17U
+#define SDCARD_CMD24_WRITE_BLOCK 24U
+#define SDCARD_CMD25_WRITE_MULTIPLE_BLOCK 25U
+#define SDCARD_CMD55_APP_CMD 55U
+#define SDCARD_CMD58_READ_OCR 58U
+#define SDCARD_ACMD23_SET_WR_BLK_ERASE_COUNT 23U
+#define SDCARD_ACMD41_SD_SEND_OP_COND 41U
+
+#define SDCARD_CMD_START 0x40U        // Start and transmission bits of a command frame
+#define SDCARD_CMD0_CRC 0x95U         // Valid CRC7 and end bit of CMD0(0), CRC is checked before SPI mode
+#define SDCARD_CMD8_CRC 0x87U         // Valid CRC7 and end bit of CMD8(0x1AA)
+#define SDCARD_CMD_CRC_DUMMY 0x01U    // End bit only, CRC is off in SPI mode
+#define SDCARD_CMD8_PATTERN 0x000001AAUL // 2.7-3.6 V and check pattern 0xAA
+#define SDCARD_ACMD41_HCS 0x40000000UL   // Host supports high capacity cards
+#define SDCARD_OCR_CCS 0x40000000UL      // Card capacity status: block addressing
+
+// R1 response bits
+#define SDCARD_R1_IDLE 0x01U
+#define SDCARD_R1_ILLEGAL_COMMAND 0x04U
+#define SDCARD_R1_INVALID 0x80U // Bit 7 is always 0 in a response, 0xFF means no response yet
+
+// Data tokens and responses
+#define SDCARD_TOKEN_START_BLOCK 0xFEU        // Single block read/write and multiple block read
+#define SDCARD_TOKEN_START_MULTI_WRITE 0xFCU  // Each block of a CMD25 stream
+#define SDCARD_TOKEN_STOP_MULTI_WRITE 0xFDU   // Ends a CMD25 stream
+#define SDCARD_DATA_RESPONSE_MASK 0x1FU
+#define SDCARD_DATA_ACCEPTED 0x05U
+#define SDCARD_IDLE_BYTE 0xFFU                // MOSI idle level, MISO when the card is ready
+#define SDCARD_BUSY_BYTE 0x00U                // MISO held low while the card programs
+
+// Bounded waits of the blocking operations, all outside the sample loop
+#define SDCARD_RESPONSE_BYTES 10U    // NCR: a response arrives within 8 bytes
+#define SDCARD_INIT_TIMEOUT_MS 1000U // ACMD41 loop, the card may take up to 1 s to leave idle
+#define SDCARD_READ_TIMEOUT_MS 100U  // Start token of a read
+#define SDCARD_BUSY_TIMEOUT_MS 500U  // Programming of a block or a stream stop
+#define SDCARD_CMD0_RETRIES 10U
+
+/* Exported types ------------------------------------------------------------*/
+
+typedef enum
+{
+  SDCARD_TYPE_NONE, // No card, or identification failed
+  SDCARD_TYPE_SDSC, // Standard capacity, byte addressing (version 1.x or 2.0)
+  SDCARD_TYPE_SDHC, // High or extended capacity, block addressing
+} sdcardType_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Identifies the card and switches it to SPI mode data transfer: CMD0, CMD8, ACMD41, CMD58, CMD9.
+ *         Blocking, up to SDCARD_INIT_TIMEOUT_MS: call at init only.
+ * @param  None
+ * @retval bool: true if a card is ready.
+ */
+bool API_SDCARD_Init(void);
+
+/**
+ * @brief  Returns the identified card type.
+ * @param  None
+ * @retval sdcardType_t: Card type, SDCARD_TYPE_NONE before a successful API_SDCARD_Init.
+ */
+sdcardType_t API_SDCARD_GetType(void);
+
+/**
+ * @brief  Returns the card capacity read from the CSD register.
+ * @param  None
+ * @retval uint32_t: Number of SDCARD_BLOCK_SIZE blocks.
+ */
+uint32_t API_SDCARD_GetBlockCount(void);
+
+/**
+ * @brief  Reads one block. Blocking until the data arrives: for init and recovery.
+ * @param  block: Block number.
+ * @param  data: Destination, SDCARD_BLOCK_SIZE bytes.
+ * @retval bool: true on success.
+ */
+bool API_SDCARD_ReadBlock(uint32_t block, uint8_t *data);
+
+/**
+ * @brief  Writes one block with CMD24. Returns once the card accepted the data, while it programs:
+ *         poll API_SDCARD_IsBusy before the next operation.
+ * @param  block: Block number.
+ * @param  data: SDCARD_BLOCK_SIZE bytes.
+ * @retval bool: true if the card accepted the block.
+ */
+bool API_SDCARD_WriteBlock(uint32_t block, const uint8_t *data);
+
+/**
+ * @brief  Opens a multiple block write (CMD25), pre-erasing count blocks (ACMD23) so the card can program them
+ *         in one go. The card must not be busy.
+ * @param  block: First block number.
+ * @param  count: Number of blocks announced, the stream may be stopped earlier.
+ * @retval bool: true if the stream is open.
+ */
+bool API_SDCARD_StartStream(uint32_t block, uint32_t count);
+
+/**
+ * @brief  Sends the next block of an open stream. Returns once the card accepted the data, while it programs.
+ * @param  data: SDCARD_BLOCK_SIZE bytes.
+ * @retval bool: true if the card accepted the block.
+ */
+bool API_SDCARD_StreamBlock(const uint8_t *data);
+
+/**
+ * @brief  Ends an open stream with the stop token. The card then programs the last block: poll API_SDCARD_IsBusy.
+ * @param  None
+ * @retval bool: true on success.
+ */
+bool API_SDCARD_StopStream(void);
+
+/**
+ * @brief  Polls the card with a single byte: it holds MISO low while programming.
+ * @param  None
+ * @retval bool: true while the card is busy.
+ */
+bool API_SDCARD_IsBusy(void);
+
+/**
+ * @brief  Waits until the card has finished programming. Blocking: for init and shutdown.
+ * @param  timeout: Milliseconds.
+ * @retval bool: true if the card is ready.
+ */
+bool API_SDCARD_WaitReady(uint32_t timeout);
+
+#endif /* API_INC_API_SDCARD_H_ */
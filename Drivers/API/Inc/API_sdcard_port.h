@@ -0,0 +1,155 @@
+#ifndef API_INC_API_SDCARD_PORT_H_
+#define API_INC_API_SDCARD_PORT_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "stm32f4xx_hal.h"        /* <- HAL include */
+#include "stm32f4xx_nucleo_144.h" /* <- BSP include, Adafruit shield SD link */
+#include "API_port.h"             /* <- Port binding */
+#include "API_sdcard.h"           /* <- SD card driver include */
+
+/* Exported constants --------------------------------------------------------*/
+
+#define SDCARD_PORT_CHUNK_SIZE 32U // Writes are sent in chunks through a small receive scratch buffer
+
+/* BSP SD link (stm32f4xx_nucleo_144.c), not exported by the BSP header */
+
+extern void SD_IO_Init(void);
+extern void SD_IO_CSState(uint8_t state);
+extern void SD_IO_WriteReadData(const uint8_t *DataIn, uint8_t *DataOut, uint16_t DataLength);
+extern uint8_t SD_IO_WriteByte(uint8_t Data);
+
+/* SPI1 is shared: the BME280 runs it in mode 0 at PCLK2/256 (hspi1), the SD link in mode 3 at PCLK2/8.
+ * SD_IO_Init also routes MOSI to PA7 (shield D11); PB5 keeps carrying it to the BME280. */
+
+extern SPI_HandleTypeDef hspi1;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Configures the SD link (CS pin, SPI1 in SD mode), sends the 80 wake-up clocks, then gives SPI1 back
+ *         to the BME280 configuration.
+ * @param  None
+ * @retval None
+ */
+API_PORT_FUNC void SDCARD_HAL_Init(void);
+
+/**
+ * @brief  Switches SPI1 to the SD configuration and pulls the card CS low.
+ * @param  None
+ * @retval None
+ */
+API_PORT_FUNC void SDCARD_HAL_Select(void);
+
+/**
+ * @brief  Releases CS, clocks one byte so the card frees MISO, and restores the previous SPI1 configuration.
+ * @param  None
+ * @retval None
+ */
+API_PORT_FUNC void SDCARD_HAL_Deselect(void);
+
+/**
+ * @brief  Exchanges one byte.
+ * @param  uint8_t value: Byte to send.
+ * @retval uint8_t: Byte received.
+ */
+API_PORT_FUNC uint8_t SDCARD_HAL_Exchange(uint8_t value);
+
+/**
+ * @brief  Sends bytes, discarding what the card returns.
+ * @param  const uint8_t *data: Bytes to send.
+ * @param  uint16_t size: Number of bytes.
+ * @retval None
+ */
+API_PORT_FUNC void SDCARD_HAL_Write(const uint8_t *data, uint16_t size);
+
+/**
+ * @brief  Receives bytes, sending the idle level 0xFF.
+ * @param  uint8_t *data: Destination.
+ * @param  uint16_t size: Number of bytes.
+ * @retval None
+ */
+API_PORT_FUNC void SDCARD_HAL_Read(uint8_t *data, uint16_t size);
+
+/**
+ * @brief  Millisecond tick for the bounded waits.
+ * @param  None
+ * @retval uint32_t: Tick in milliseconds.
+ */
+API_PORT_FUNC uint32_t SDCARD_HAL_GetTick(void);
+
+/* Port Function Definitions ------------------------------------------------ */
+
+// Inlined into the driver, or compiled once by API_sdcard_port.c when the port is bound at link time
+#if API_PORT_STATIC_INLINE || defined(API_SDCARD_PORT_IMPLEMENTATION)
+
+// CR1 of SPI1 in the SD configuration, captured after SD_IO_Init, and of the configuration it interrupts
+static uint32_t sdcardSpiCr1;
+static uint32_t sdcardSavedCr1;
+
+/**
+ * @brief  Replaces the SPI1 configuration with SPE cleared: the HAL enables the peripheral again at the next transfer.
+ * @param  uint32_t cr1: CR1 value to install.
+ * @retval None
+ */
+static inline void sdcardSetCr1(uint32_t cr1)
+{
+  NUCLEO_SPIx->CR1 &= ~SPI_CR1_SPE;
+  NUCLEO_SPIx->CR1 = cr1 & ~SPI_CR1_SPE;
+}
+
+API_PORT_FUNC void SDCARD_HAL_Init(void)
+{
+  SD_IO_Init();
+  sdcardSpiCr1 = NUCLEO_SPIx->CR1;
+  HAL_SPI_Init(&hspi1);
+}
+
+API_PORT_FUNC void SDCARD_HAL_Select(void)
+{
+  sdcardSavedCr1 = NUCLEO_SPIx->CR1;
+  sdcardSetCr1(sdcardSpiCr1);
+  SD_IO_CSState(0);
+}
+
+API_PORT_FUNC void SDCARD_HAL_Deselect(void)
+{
+  SD_IO_CSState(1);
+  SD_IO_WriteByte(SDCARD_IDLE_BYTE);
+  sdcardSetCr1(sdcardSavedCr1);
+}
+
+API_PORT_FUNC uint8_t SDCARD_HAL_Exchange(uint8_t value)
+{
+  return SD_IO_WriteByte(value);
+}
+
+API_PORT_FUNC void SDCARD_HAL_Write(const uint8_t *data, uint16_t size)
+{
+  uint8_t scratch[SDCARD_PORT_CHUNK_SIZE];
+
+  while (size > 0U)
+  {
+    uint16_t chunk = (size < SDCARD_PORT_CHUNK_SIZE) ? size : SDCARD_PORT_CHUNK_SIZE;
+    SD_IO_WriteReadData(data, scratch, chunk);
+    data += chunk;
+    size -= chunk;
+  }
+}
+
+API_PORT_FUNC void SDCARD_HAL_Read(uint8_t *data, uint16_t size)
+{
+  // Full duplex in place: byte i is loaded for transmission before received byte i overwrites it
+  memset(data, SDCARD_IDLE_BYTE, size);
+  SD_IO_WriteReadData(data, data, size);
+}
+
+API_PORT_FUNC uint32_t SDCARD_HAL_GetTick(void)
+{
+  return HAL_GetTick();
+}
+
+#endif /* API_PORT_STATIC_INLINE || API_SDCARD_PORT_IMPLEMENTATION */
+
+#endif /* API_INC_API_SDCARD_PORT_H_ */
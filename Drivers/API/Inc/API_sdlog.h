@@ -0,0 +1,102 @@
+#ifndef API_INC_API_SDLOG_H_
+#define API_INC_API_SDLOG_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "API_log.h"    /* <- logRecord_t */
+#include "API_sdcard.h"
+
+/*
+ * Append-only sample log on the raw SD card (no filesystem: block 0 onwards is overwritten).
+ *
+ * Block SDLOG_INDEX_BLOCK is the index: region identity and number of committed data blocks.
+ * Data blocks follow it in order, each a self-checking 16-byte header and up to
+ * SDLOG_RECORDS_PER_BLOCK records, all little-endian:
+ *   magic (2) | record count (2) | volume (4) | sequence, the data block index (4) | CRC-32 (4) | records
+ * The CRC covers the header with its CRC field zeroed and the records.
+ *
+ * Records fill one of two RAM block buffers while the other is written, as part of a multiple block
+ * write of up to SDLOG_STREAM_BLOCKS blocks. The index is rewritten after each stream, so at boot the
+ * blocks beyond it are validated (volume, sequence, CRC) and adopted, and nothing written before a
+ * reset or power loss is lost except the blocks still in RAM.
+ */
+
+/* Exported constants --------------------------------------------------------*/
+
+#define SDLOG_INDEX_BLOCK 0U                          // Card block holding the index
+#define SDLOG_FIRST_DATA_BLOCK (SDLOG_INDEX_BLOCK + 1U)
+#define SDLOG_INDEX_MAGIC 0x31494453UL                // "SDI1" little-endian
+#define SDLOG_INDEX_VERSION 1U
+#define SDLOG_BLOCK_MAGIC 0x4C53U                     // "SL" little-endian
+#define SDLOG_BLOCK_HEADER_SIZE 16U
+#define SDLOG_RECORD_SIZE 8U                          // Timestamp (4), temperature (2), humidity (2)
+#define SDLOG_RECORDS_PER_BLOCK ((SDCARD_BLOCK_SIZE - SDLOG_BLOCK_HEADER_SIZE) / SDLOG_RECORD_SIZE) // 62
+#define SDLOG_BUFFER_COUNT 2U                         // Block buffers: one filling, one being written
+
+#define SDLOG_STREAM_BLOCKS 64U   // Blocks per multiple block write, the index is rewritten after each one
+#define SDLOG_RECOVERY_SCAN SDLOG_STREAM_BLOCKS // Blocks beyond the index checked at boot
+#define SDLOG_MAX_ERRORS 8U       // Consecutive write failures before the card is considered removed
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Capacity, progress and loss counters.
+ */
+typedef struct
+{
+  bool ready;          // Card identified and index valid, records are accepted
+  uint32_t capacity;   // Data blocks in the region
+  uint32_t blocks;     // Data blocks written, committed or not
+  uint32_t records;    // Records in those blocks
+  uint32_t pending;    // Records in RAM, not yet on the card
+  uint32_t dropped;    // Records lost while a card is in use: both buffers full, region full or card given up
+  uint32_t recovered;  // Blocks beyond the index adopted at boot
+  uint32_t errors;     // Failed card operations, retried
+  uint32_t busyPolls;  // API_SDLOG_Process calls that found the card programming
+  uint32_t busWaits;   // API_SDLOG_Process calls that found SPI1 in a sensor read
+} sdlogStatus_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Identifies the card, reads the index and adopts the valid blocks written after it.
+ *         A card without a valid index is formatted. Blocking: call at init only.
+ * @param  None
+ * @retval bool: true if the log is ready.
+ */
+bool API_SDLOG_Init(void);
+
+/**
+ * @brief  Copies a record into the filling block buffer. Never touches the card: constant time.
+ * @param  record: Record to append.
+ * @retval bool: true if the record was buffered, false if it was dropped or no card is ready.
+ */
+bool API_SDLOG_Append(const logRecord_t *record);
+
+/**
+ * @brief  Advances the card writes by at most one operation: returns at once while the card is programming
+ *         or a timed sensor read holds SPI1, otherwise sends one block, opens or closes a stream, or rewrites
+ *         the index. Call from the main loop.
+ * @param  None
+ * @retval None
+ */
+void API_SDLOG_Process(void);
+
+/**
+ * @brief  Queues the partly filled block buffer and requests the stream end and the index update.
+ *         The work itself is done by API_SDLOG_Process.
+ * @param  None
+ * @retval bool: true once every appended record is committed by the index.
+ */
+bool API_SDLOG_Flush(void);
+
+/**
+ * @brief  Returns the log counters.
+ * @param  None
+ * @retval sdlogStatus_t: Counters.
+ */
+sdlogStatus_t API_SDLOG_GetStatus(void);
+
+#endif /* API_INC_API_SDLOG_H_ */
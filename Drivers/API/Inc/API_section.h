@@ -0,0 +1,39 @@
+#ifndef API_INC_API_SECTION_H_
+#define API_INC_API_SECTION_H_
+
+/*
+ * Memory placement of static data (see the .ccmram, .ccmbss and .dmabss sections of the linker scripts).
+ *
+ * CCMRAM (0x10000000, 64 KB) sits on the D-bus of the core only: zero wait states and no contention
+ * with the DMA and other bus masters, but unreachable by DMA. The main stack lives at its top.
+ * SRAM1/2 (0x20000000, 192 KB) is shared with DMA: any buffer a DMA stream reads or writes goes there.
+ *
+ * API_CCM_BSS  CPU-only state and scratch buffers, zero-initialised by the startup code.
+ * API_CCM_DATA CPU-only variables with an initialiser, copied from flash by the startup code.
+ * API_DMA_BSS  DMA buffers, kept in SRAM1/2 and word aligned, zero-initialised by the startup code.
+ *
+ * Never put anything handed to a DMA stream, directly or through a pointer, in CCM: that includes
+ * locals, since the stack is in CCM too. The attribute goes before the declaration, so it applies
+ * to every declarator:
+ *   API_CCM_BSS static int16_t dig_T2, dig_T3;
+ */
+
+/* Exported constants --------------------------------------------------------*/
+
+#ifndef API_SECTION_PLACEMENT
+#define API_SECTION_PLACEMENT 1 // 0: default sections, for hosts without the target linker script
+#endif
+
+/* Exported macro ------------------------------------------------------------*/
+
+#if API_SECTION_PLACEMENT
+#define API_CCM_BSS __attribute__((section(".ccmbss")))
+#define API_CCM_DATA __attribute__((section(".ccmram")))
+#define API_DMA_BSS __attribute__((section(".dmabss"), aligned(4)))
+#else
+#define API_CCM_BSS
+#define API_CCM_DATA
+#define API_DMA_BSS __attribute__((aligned(4)))
+#endif
+
+#endif /* API_INC_API_SECTION_H_ */
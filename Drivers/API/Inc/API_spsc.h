@@ -0,0 +1,274 @@
+#ifndef API_INC_API_SPSC_H_
+#define API_INC_API_SPSC_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+
+/*
+ * Lock-free single-producer/single-consumer ring of fixed-size elements, header only.
+ *
+ * One context pushes, an interrupt or the main loop, and one other context pops. Each side writes only its
+ * own index. The producer writes the element, then moves head with a release store. The consumer reads
+ * the element, then moves tail with a release store. Each side reads the other's index with an acquire
+ * load. On the Cortex-M4 these are plain LDR/STR ordered by a DMB: no LDREX/STREX retry loop and no
+ * interrupt masking, so the ring also works between two interrupts of different priorities.
+ *
+ * The indices run free and wrap at 2^32. The capacity is a power of two, so a slot is index & mask and the
+ * fill level is head - tail. Each side keeps a copy of the other's index and reloads it only when the copy
+ * says full or empty: the other side's line is read once per batch, not once per element.
+ *
+ * The producer index, the consumer index and the read-only fields are each aligned on SPSC_CACHE_LINE.
+ * The Cortex-M4 has no data cache, so the target keeps word alignment and no padding. A host running the
+ * two sides on threads sets its cache line size, so they stop invalidating each other's line (false sharing).
+ *
+ * Elements are copied in and out (push/pop, one or a batch) or written and read in place (claim/commit):
+ * a claim returns the contiguous slots up to the end of the storage, the commit publishes those used.
+ */
+
+/* Exported constants --------------------------------------------------------*/
+
+#ifndef SPSC_CACHE_LINE
+#define SPSC_CACHE_LINE sizeof(void *) // No data cache on the Cortex-M4: natural alignment, 4 B. 64 for host threads
+#endif
+
+#define SPSC_MAX_CAPACITY 0x80000000UL // Fill level must stay below the index range
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Ring state. The storage is the caller's: capacity * elementSize bytes, static, never freed.
+ */
+typedef struct
+{
+  _Alignas(SPSC_CACHE_LINE) _Atomic uint32_t head; // Next slot to write, stored by the producer only
+  uint32_t tailCache;                              // Producer's copy of tail
+
+  _Alignas(SPSC_CACHE_LINE) _Atomic uint32_t tail; // Next slot to read, stored by the consumer only
+  uint32_t headCache;                              // Consumer's copy of head
+
+  _Alignas(SPSC_CACHE_LINE) uint8_t *storage;      // Read-only after API_SPSC_Init
+  uint32_t mask;                                   // Capacity - 1
+  uint32_t elementSize;                            // Bytes
+} spscQueue_t;
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Producer side: slots free for up to wanted elements, reloading tail only if the copy falls short.
+ * @param  spscQueue_t *queue: Ring.
+ * @param  uint32_t head: Producer index.
+ * @param  uint32_t wanted: Elements the producer would write.
+ * @retval uint32_t: Free slots, at most wanted.
+ */
+static inline uint32_t spscWritable(spscQueue_t *queue, uint32_t head, uint32_t wanted)
+{
+  uint32_t capacity = queue->mask + 1U;
+  uint32_t free = capacity - (head - queue->tailCache);
+
+  if (free < wanted)
+  {
+    queue->tailCache = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    free = capacity - (head - queue->tailCache);
+  }
+
+  return (free < wanted) ? free : wanted;
+}
+
+/**
+ * @brief  Consumer side: elements ready, up to wanted, reloading head only if the copy falls short.
+ * @param  spscQueue_t *queue: Ring.
+ * @param  uint32_t tail: Consumer index.
+ * @param  uint32_t wanted: Elements the consumer would read.
+ * @retval uint32_t: Ready elements, at most wanted.
+ */
+static inline uint32_t spscReadable(spscQueue_t *queue, uint32_t tail, uint32_t wanted)
+{
+  uint32_t ready = queue->headCache - tail;
+
+  if (ready < wanted)
+  {
+    queue->headCache = atomic_load_explicit(&queue->head, memory_order_acquire);
+    ready = queue->headCache - tail;
+  }
+
+  return (ready < wanted) ? ready : wanted;
+}
+
+/**
+ * @brief  Contiguous slots from an index to the end of the storage, at most count.
+ * @param  const spscQueue_t *queue: Ring.
+ * @param  uint32_t index: Free-running index.
+ * @param  uint32_t count: Slots wanted.
+ * @retval uint32_t: Slots before the wrap.
+ */
+static inline uint32_t spscContiguous(const spscQueue_t *queue, uint32_t index, uint32_t count)
+{
+  uint32_t toEnd = queue->mask + 1U - (index & queue->mask);
+
+  return (count < toEnd) ? count : toEnd;
+}
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Empties the ring and binds it to its storage. Call before either side runs.
+ * @param  spscQueue_t *queue: Ring.
+ * @param  void *storage: capacity * elementSize bytes.
+ * @param  uint32_t capacity: Elements, a power of two up to SPSC_MAX_CAPACITY.
+ * @param  uint32_t elementSize: Bytes per element.
+ * @retval bool: false if the capacity is not a power of two or the element size is 0.
+ */
+static inline bool API_SPSC_Init(spscQueue_t *queue, void *storage, uint32_t capacity, uint32_t elementSize)
+{
+  if (capacity == 0U || capacity > SPSC_MAX_CAPACITY || (capacity & (capacity - 1U)) != 0U || elementSize == 0U)
+  {
+    return false;
+  }
+
+  atomic_init(&queue->head, 0U);
+  atomic_init(&queue->tail, 0U);
+  queue->tailCache = 0U;
+  queue->headCache = 0U;
+  queue->storage = (uint8_t *)storage;
+  queue->mask = capacity - 1U;
+  queue->elementSize = elementSize;
+
+  return true;
+}
+
+/**
+ * @brief  Producer: copies up to count elements in and publishes them together. Never waits.
+ * @param  spscQueue_t *queue: Ring.
+ * @param  const void *elements: count elements.
+ * @param  uint32_t count: Elements to push.
+ * @retval uint32_t: Elements pushed, fewer than count if the ring filled up.
+ */
+static inline uint32_t API_SPSC_PushBatch(spscQueue_t *queue, const void *elements, uint32_t count)
+{
+  uint32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  uint32_t pushed = spscWritable(queue, head, count);
+  uint32_t first = spscContiguous(queue, head, pushed);
+  uint32_t size = queue->elementSize;
+
+  memcpy(queue->storage + (head & queue->mask) * size, elements, first * size);
+  memcpy(queue->storage, (const uint8_t *)elements + first * size, (pushed - first) * size);
+  atomic_store_explicit(&queue->head, head + pushed, memory_order_release);
+
+  return pushed;
+}
+
+/**
+ * @brief  Producer: copies one element in. Never waits.
+ * @param  spscQueue_t *queue: Ring.
+ * @param  const void *element: Element.
+ * @retval bool: false if the ring is full.
+ */
+static inline bool API_SPSC_Push(spscQueue_t *queue, const void *element)
+{
+  return API_SPSC_PushBatch(queue, element, 1U) == 1U;
+}
+
+/**
+ * @brief  Producer: reserves free slots to write in place, up to the end of the storage.
+ * @param  spscQueue_t *queue: Ring.
+ * @param  uint32_t *count: Slots wanted in, slots granted out.
+ * @retval void *: First granted slot, NULL if none.
+ */
+static inline void *API_SPSC_ClaimWrite(spscQueue_t *queue, uint32_t *count)
+{
+  uint32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+  *count = spscContiguous(queue, head, spscWritable(queue, head, *count));
+
+  return (*count == 0U) ? NULL : queue->storage + (head & queue->mask) * queue->elementSize;
+}
+
+/**
+ * @brief  Producer: publishes the first count slots of the last claim, once written.
+ * @param  spscQueue_t *queue: Ring.
+ * @param  uint32_t count: Slots written, at most the count granted.
+ * @retval None
+ */
+static inline void API_SPSC_CommitWrite(spscQueue_t *queue, uint32_t count)
+{
+  uint32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+  atomic_store_explicit(&queue->head, head + count, memory_order_release);
+}
+
+/**
+ * @brief  Consumer: copies up to count elements out and hands their slots back together.
+ * @param  spscQueue_t *queue: Ring.
+ * @param  void *elements: Room for count elements.
+ * @param  uint32_t count: Elements wanted.
+ * @retval uint32_t: Elements popped, fewer than count if the ring ran empty.
+ */
+static inline uint32_t API_SPSC_PopBatch(spscQueue_t *queue, void *elements, uint32_t count)
+{
+  uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  uint32_t popped = spscReadable(queue, tail, count);
+  uint32_t first = spscContiguous(queue, tail, popped);
+  uint32_t size = queue->elementSize;
+
+  memcpy(elements, queue->storage + (tail & queue->mask) * size, first * size);
+  memcpy((uint8_t *)elements + first * size, queue->storage, (popped - first) * size);
+  atomic_store_explicit(&queue->tail, tail + popped, memory_order_release);
+
+  return popped;
+}
+
+/**
+ * @brief  Consumer: copies one element out.
+ * @param  spscQueue_t *queue: Ring.
+ * @param  void *element: Receives the element.
+ * @retval bool: false if the ring is empty.
+ */
+static inline bool API_SPSC_Pop(spscQueue_t *queue, void *element)
+{
+  return API_SPSC_PopBatch(queue, element, 1U) == 1U;
+}
+
+/**
+ * @brief  Consumer: gives the ready elements to read in place, up to the end of the storage.
+ * @param  spscQueue_t *queue: Ring.
+ * @param  uint32_t *count: Elements wanted in, elements granted out.
+ * @retval const void *: First granted element, NULL if none.
+ */
+static inline const void *API_SPSC_ClaimRead(spscQueue_t *queue, uint32_t *count)
+{
+  uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+  *count = spscContiguous(queue, tail, spscReadable(queue, tail, *count));
+
+  return (*count == 0U) ? NULL : queue->storage + (tail & queue->mask) * queue->elementSize;
+}
+
+/**
+ * @brief  Consumer: hands back the first count slots of the last claim, once read.
+ * @param  spscQueue_t *queue: Ring.
+ * @param  uint32_t count: Elements read, at most the count granted.
+ * @retval None
+ */
+static inline void API_SPSC_CommitRead(spscQueue_t *queue, uint32_t count)
+{
+  uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+  atomic_store_explicit(&queue->tail, tail + count, memory_order_release);
+}
+
+/**
+ * @brief  Fill level, a snapshot: either side may have moved since.
+ * @param  spscQueue_t *queue: Ring.
+ * @retval uint32_t: Elements queued.
+ */
+static inline uint32_t API_SPSC_Count(spscQueue_t *queue)
+{
+  uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+  return atomic_load_explicit(&queue->head, memory_order_acquire) - tail;
+}
+
+#endif /* API_INC_API_SPSC_H_ */
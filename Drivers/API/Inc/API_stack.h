@@ -0,0 +1,42 @@
+#ifndef API_INC_API_STACK_H_
+#define API_INC_API_STACK_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+#define STACK_PAINT_PATTERN 0xA5A5A5A5UL // Fill word of the never-used part of the main stack
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Measured use of the main stack, to compare with the static worst case of Tools/stack_budget.py.
+ */
+typedef struct
+{
+  uint32_t budget;   // Reserved by the linker script (_Min_Stack_Size), bytes
+  uint32_t capacity; // Free CCM the stack can actually grow into before hitting .ccmbss, bytes
+  uint32_t peak;     // Deepest use since API_STACK_Paint, bytes
+} stackUsage_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Fills the stack area below the current stack pointer with STACK_PAINT_PATTERN.
+ *         Call first thing in main: whatever is above the stack pointer then counts as used.
+ * @param  None
+ * @retval None
+ */
+void API_STACK_Paint(void);
+
+/**
+ * @brief  Measures the high-water mark: the lowest word no longer holding the pattern.
+ *         Scans the free area from the bottom up, well under a millisecond for the whole CCM.
+ * @param  usage: Filled with the budget, capacity and peak.
+ * @retval bool: true while the peak is within the budget.
+ */
+bool API_STACK_GetUsage(stackUsage_t *usage);
+
+#endif /* API_INC_API_STACK_H_ */
@@ -0,0 +1,97 @@
+#ifndef API_INC_API_STATS_H_
+#define API_INC_API_STATS_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+// Each window is a ring of fixed-length slots; a sample costs O(1) and RAM does not grow with the window length
+#define STATS_1MIN_SLOT_MS 1000U      // 1-minute window: 60 slots of 1 s
+#define STATS_1MIN_SLOTS 60U
+#define STATS_1HOUR_SLOT_MS 60000U    // 1-hour window: 60 slots of 1 min
+#define STATS_1HOUR_SLOTS 60U
+#define STATS_24HOUR_SLOT_MS 900000U  // 24-hour window: 96 slots of 15 min
+#define STATS_24HOUR_SLOTS 96U
+
+// Quantile histogram resolution, per channel and window. The histogram counts closed slots by their mean, not the
+// raw samples: the quantiles are those of the slot means, near the raw ones on the 1 s slots of the 1-minute window
+// but narrower than the raw spread on the 1-hour and 24-hour windows
+#define STATS_HISTOGRAM_BUCKETS 128U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Channels aggregated by the statistics engine.
+ */
+typedef enum
+{
+  STATS_CHANNEL_TEMPERATURE, // Degrees Celsius
+  STATS_CHANNEL_HUMIDITY,    // %RH
+  STATS_CHANNEL_COUNT,
+} statsChannel_t;
+
+/**
+ * @brief Rolling windows kept for every channel.
+ */
+typedef enum
+{
+  STATS_WINDOW_1MIN,
+  STATS_WINDOW_1HOUR,
+  STATS_WINDOW_24HOUR,
+  STATS_WINDOW_COUNT,
+} statsWindow_t;
+
+/**
+ * @brief Statistics of one channel over one window. Fields other than count are valid only if count > 0.
+ */
+typedef struct
+{
+  uint32_t count;  // Samples in the window
+  float mean;
+  float stddev;    // Sample standard deviation, 0 with fewer than two samples
+  float min;
+  float max;
+  float slotP50;   // Median of the slot means, each weighted by its sample count
+  float slotP95;   // 95th percentile of the slot means, each weighted by its sample count
+} statsSummary_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Clears every window of every channel. Histograms default to 0 + 1.0 per bucket.
+ * @param  None
+ * @retval None
+ */
+void API_STATS_Init(void);
+
+/**
+ * @brief  Sets the value range covered by a channel's quantile histograms and clears the channel.
+ *         Values outside [lowest, lowest + STATS_HISTOGRAM_BUCKETS * bucketWidth) fall into the edge buckets.
+ * @param  channel: Channel to configure.
+ * @param  lowest: Lower edge of the first bucket.
+ * @param  bucketWidth: Width of each bucket, in the channel's unit.
+ * @retval bool: true on success, false if the channel or the width is invalid.
+ */
+bool API_STATS_ConfigureHistogram(statsChannel_t channel, float lowest, float bucketWidth);
+
+/**
+ * @brief  Adds one sample to every window of a channel.
+ * @param  channel: Channel the sample belongs to.
+ * @param  value: Sample value.
+ * @param  nowMs: Sample time in milliseconds (monotonic, wrap-safe).
+ * @retval None
+ */
+void API_STATS_Push(statsChannel_t channel, float value, uint32_t nowMs);
+
+/**
+ * @brief  Computes the statistics of a channel over a window, as of the last pushed sample.
+ * @param  channel: Channel to query.
+ * @param  window: Window to query.
+ * @param  summary: Filled with the window statistics.
+ * @retval bool: true if the window holds at least one sample.
+ */
+bool API_STATS_GetSummary(statsChannel_t channel, statsWindow_t window, statsSummary_t *summary);
+
+#endif /* API_INC_API_STATS_H_ */
@@ -0,0 +1,67 @@
+#ifndef API_INC_API_TIMESTAMP_H_
+#define API_INC_API_TIMESTAMP_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f4xx_hal.h" /* <- HAL include */
+
+#include "API_clock_date.h"
+
+/* Exported constants --------------------------------------------------------*/
+
+// Epoch origin is 2000-01-01 00:00:00, the first instant the RTC's two-digit year can represent
+#define TIMESTAMP_EPOCH_YEAR 2000
+#define TIMESTAMP_EPOCH_WEEKDAY RTC_WEEKDAY_SATURDAY // 2000-01-01 was a Saturday
+
+#define TIMESTAMP_SECONDS_PER_DAY 86400UL
+#define TIMESTAMP_SECONDS_PER_HOUR 3600UL
+#define TIMESTAMP_SECONDS_PER_MINUTE 60UL
+#define TIMESTAMP_MS_PER_SECOND 1000ULL
+
+#define TIMESTAMP_DAYS_PER_YEAR 365U
+#define TIMESTAMP_DAYS_PER_LEAP_CYCLE 1461U // 4 * 365 + 1, every 4th year is leap within 2000..2099
+#define TIMESTAMP_DAYS_PER_WEEK 7U
+#define TIMESTAMP_MONTHS_PER_YEAR 12U
+#define TIMESTAMP_MAX_DAYS_PER_MONTH 31U
+
+/* Exported types ------------------------------------------------------------*/
+
+typedef uint32_t timestamp_t;    // Seconds since the epoch origin
+typedef uint64_t timestampMs_t;  // Milliseconds since the epoch origin
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Converts a BCD RTC time/date pair into seconds since 2000-01-01.
+ * @param  time: Pointer to the BCD-encoded RTC time.
+ * @param  date: Pointer to the BCD-encoded RTC date.
+ * @retval timestamp_t: Seconds since the epoch origin.
+ */
+timestamp_t API_TIMESTAMP_FromRTC(const RTC_TimeTypeDef *time, const RTC_DateTypeDef *date);
+
+/**
+ * @brief  Converts seconds since 2000-01-01 back into a BCD RTC time/date pair (weekday included).
+ * @param  timestamp: Seconds since the epoch origin.
+ * @param  time: Pointer to the BCD-encoded RTC time to fill.
+ * @param  date: Pointer to the BCD-encoded RTC date to fill.
+ * @retval None
+ */
+void API_TIMESTAMP_ToRTC(timestamp_t timestamp, RTC_TimeTypeDef *time, RTC_DateTypeDef *date);
+
+/**
+ * @brief  Returns the current RTC time as milliseconds since 2000-01-01, using RTC_SSR for the fraction.
+ * @param  None
+ * @retval timestampMs_t: Milliseconds since the epoch origin.
+ */
+timestampMs_t API_TIMESTAMP_NowMs(void);
+
+/**
+ * @brief  Returns the current RTC time as seconds since 2000-01-01.
+ * @param  None
+ * @retval timestamp_t: Seconds since the epoch origin.
+ */
+timestamp_t API_TIMESTAMP_Now(void);
+
+#endif /* API_INC_API_TIMESTAMP_H_ */
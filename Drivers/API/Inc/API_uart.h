@@ -6,15 +6,62 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "stm32f4xx_hal.h" /* <- HAL include */
 
+/*
+ * USART3 to the ST-LINK virtual COM port: 8-bit words with odd parity (7 data bits), 1 stop bit.
+ *
+ * The link boots at UART_BOOT_BAUD. Received bytes go through the RXNE interrupt into a ring read by
+ * uartProcess, which runs the line commands:
+ *   "BAUD?"    current rate, BRR, actual rate and its error for PCLK1
+ *   "BAUD <n>" switch to a rate of UART_BAUD_RATES: the reply goes out at the old rate, then the host has
+ *              UART_CONFIRM_TIMEOUT_MS to send "OK" at the new one, or the old rate comes back
+ * A host at an unknown rate is found by auto-baud: after UART_AUTOBAUD_ERRORS errored bytes in a row the
+ * rates are tried in turn until UART_AUTOBAUD_SYNC clean '\r' arrive in a row, the host sending '\r'
+ * repeatedly. The USART has no auto-baud hardware, the errors are the only clue.
+ */
+
 /* Exported types ------------------------------------------------------------*/
 #ifndef BOOL_TYPE_DEFINITIOON_
 #define BOOL_TYPE_DEFINITIOON_
 typedef bool bool_t;
 #endif // BOOL_TYPE_DEFINITIOON_
 
+/**
+ * @brief Divider of a baud rate on USART3 and the rate it really gives.
+ */
+typedef struct
+{
+  uint32_t requested;
+  uint32_t brr;        // BRR register value, 16x oversampling
+  uint32_t actual;     // PCLK1 / BRR
+  int32_t errorCenti;  // (actual - requested) / requested, in 0.01 %
+} uartBaudInfo_t;
+
+typedef enum
+{
+  UART_LINK_FIXED,      // Running at an agreed rate
+  UART_LINK_CONFIRMING, // New rate set, waiting for the host's "OK"
+  UART_LINK_HUNTING     // Auto-baud: trying the rates in turn
+} uartLinkState_t;
+
+/**
+ * @brief Line rate and receive counters.
+ */
+typedef struct
+{
+  uint32_t baudRate;
+  uartLinkState_t state;
+  uint32_t rxBytes;     // Bytes read from the ring, errored ones included
+  uint32_t rxErrors;    // Parity, framing or noise errors
+  uint32_t rxDropped;   // Lost to a full ring or a USART overrun
+  uint32_t switches;    // Confirmed rate changes
+  uint32_t rollbacks;   // Rate changes not confirmed in time
+  uint32_t autobauds;   // Rates found by auto-baud
+} uartStatus_t;
+
 /* Exported constants --------------------------------------------------------*/
 #define MAXbUFFER 256
 #define TxTIMEOUT 5000
@@ -34,6 +81,22 @@ typedef bool bool_t;
 #define USARTx_RX_PIN GPIO_PIN_9
 #define USARTx_RX_GPIO_PORT GPIOD
 #define USARTx_RX_AF GPIO_AF7_USART3
+#define USARTx_IRQn USART3_IRQn
+
+/* Definition for the line rate */
+#define UART_BOOT_BAUD 9600U
+#define UART_BAUD_RATES {9600U, 19200U, 38400U, 57600U, 115200U, 230400U, 460800U, 921600U}
+#define UART_BAUD_RATE_COUNT 8U
+#define UART_MAX_ERROR_CENTI 200      // Rates further than 2.00 % from the request are refused
+#define UART_CONFIRM_TIMEOUT_MS 2000U // Time for the host to confirm a new rate
+#define UART_AUTOBAUD_ERRORS 4U       // Errored bytes in a row that start the auto-baud hunt
+#define UART_AUTOBAUD_SYNC 2U         // Clean '\r' in a row that lock a rate
+#define UART_AUTOBAUD_SETTLE_MS 2U    // Bytes ignored after a rate change: longer than a character at 9600
+#define UART_AUTOBAUD_TIMEOUT_MS 5000U
+
+#define UART_RX_BUFFER_SIZE 64U // Received bytes between two uartProcess calls
+#define UART_COMMAND_SIZE 24U   // Longest command line, terminator included
+#define UART_IRQ_PRIORITY 0x05  // Above USB: a byte every 11 us at 921600. Same as USART3_IRQn in SPI_test.ioc
 
 /* Exported functions ------------------------------------------------------- */
 bool_t uartInit(void);
@@ -41,4 +104,40 @@ void uartSendString(uint8_t *pstring);
 void uartSendStringSize(uint8_t *pstring, uint16_t size);
 void uartReceiveStringSize(uint8_t *pstring, uint16_t size);
 int uartReceiveStringAndParseDate(uint8_t *pstring, uint16_t size, RTC_TimeTypeDef *sTime, RTC_DateTypeDef *sDate);
+
+/**
+ * @brief  Switches USART3 to another rate at once, without confirmation. Waits for nothing: call between
+ *         transmissions.
+ * @param  uint32_t baudRate: One of UART_BAUD_RATES.
+ * @retval bool_t: true if the rate is supported and within UART_MAX_ERROR_CENTI for PCLK1.
+ */
+bool_t uartSetBaudRate(uint32_t baudRate);
+
+/**
+ * @brief  Computes the divider the HAL programs for a rate and the rate it gives with the current PCLK1.
+ * @param  uint32_t baudRate: Requested rate.
+ * @retval uartBaudInfo_t: Divider, actual rate and error.
+ */
+uartBaudInfo_t uartGetBaudInfo(uint32_t baudRate);
+
+/**
+ * @brief  Runs the received command lines, the confirmation timeout and the auto-baud hunt. Call from the main loop.
+ * @param  uint32_t now: Current tick in ms.
+ * @retval None
+ */
+void uartProcess(uint32_t now);
+
+/**
+ * @brief  USART3 interrupt: moves the received byte and its error flags into the ring.
+ * @param  None
+ * @retval None
+ */
+void uartIrqHandler(void);
+
+/**
+ * @brief  Returns the line rate and receive counters.
+ * @param  None
+ * @retval uartStatus_t: Counters.
+ */
+uartStatus_t uartGetStatus(void);
 #endif /* API_INC_API_UART_H_ */
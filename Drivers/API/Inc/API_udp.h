@@ -0,0 +1,130 @@
+#ifndef API_INC_API_UDP_H_
+#define API_INC_API_UDP_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Transmit-only UDP/IPv4 publisher on the Ethernet MAC: no ARP, no IP stack, nothing received.
+ *
+ * Each datagram is one Ethernet II frame, all header fields big-endian:
+ *   Ethernet (14) | IPv4, no options (20) | UDP (8) | payload
+ * The destination MAC is static: the collector's (a static ARP entry) or broadcast. The 42 header bytes
+ * are written once per frame buffer by API_UDP_Init. Per datagram only the IP total length, the IP
+ * identification and the UDP length change, and the IP header checksum is updated from its previous
+ * value (RFC 1624) instead of summed again.
+ *
+ * Records are written straight into the payload of the filling frame buffer, and the port hands that
+ * buffer to an ETH DMA transmit descriptor as it is: the batch is never copied. The UDP checksum is
+ * summed as the records are written, so sealing a frame costs a few additions.
+ *
+ * Payload, little-endian like the SD card log:
+ *   magic (2) | version (1) | record count (1) | sequence, the datagram number (4) | records
+ * Record: tick in ms (4) | temperature in 0.01 C (4) | humidity in %RH Q22.10 (4)
+ * An invalid sample has humidity UDP_HUMIDITY_INVALID and its faultType_t in place of the temperature.
+ */
+
+/* Exported constants --------------------------------------------------------*/
+
+#define UDP_MAC_SIZE 6U
+#define UDP_IP_SIZE 4U
+
+#define UDP_ETH_HEADER_SIZE 14U
+#define UDP_IP_HEADER_SIZE 20U
+#define UDP_UDP_HEADER_SIZE 8U
+#define UDP_HEADERS_SIZE (UDP_ETH_HEADER_SIZE + UDP_IP_HEADER_SIZE + UDP_UDP_HEADER_SIZE) // 42
+#define UDP_MAX_FRAME_SIZE 1514U                                     // Without the FCS, appended by the MAC
+#define UDP_MAX_PAYLOAD_SIZE (UDP_MAX_FRAME_SIZE - UDP_HEADERS_SIZE) // 1472, no IP fragmentation
+
+#define UDP_PAYLOAD_MAGIC 0x5455U // "UT" little-endian
+#define UDP_PAYLOAD_VERSION 1U
+#define UDP_PAYLOAD_HEADER_SIZE 8U
+#define UDP_RECORD_SIZE 12U
+#define UDP_MAX_RECORDS ((UDP_MAX_PAYLOAD_SIZE - UDP_PAYLOAD_HEADER_SIZE) / UDP_RECORD_SIZE) // 122
+#define UDP_HUMIDITY_INVALID 0xFFFFFFFFU // Humidity of an invalid sample record, never a Q22.10 %RH
+
+#define UDP_FRAME_COUNT 4U          // Frame buffers, one per ETH DMA transmit descriptor
+#define UDP_FRAME_BUFFER_SIZE 1516U // UDP_MAX_FRAME_SIZE rounded up to whole words
+#define UDP_LINK_POLL_MS 1000U      // PHY link status read interval
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Addresses and batching of the datagrams.
+ */
+typedef struct
+{
+  uint8_t destinationMac[UDP_MAC_SIZE]; // Collector MAC, or ff:ff:ff:ff:ff:ff to broadcast
+  uint8_t sourceIp[UDP_IP_SIZE];
+  uint8_t destinationIp[UDP_IP_SIZE];   // Collector IP, or a broadcast address
+  uint16_t sourcePort;
+  uint16_t destinationPort;
+  uint8_t batchRecords;                 // Records per datagram, 1 to UDP_MAX_RECORDS
+} udpConfig_t;
+
+/**
+ * @brief Link state, progress and loss counters.
+ */
+typedef struct
+{
+  bool ready;                // Ethernet MAC initialised
+  bool linkUp;               // PHY link up, records are accepted
+  uint8_t mac[UDP_MAC_SIZE]; // Source MAC, locally administered, from the device unique ID
+  uint32_t frames;           // Datagrams handed to the MAC
+  uint32_t bytes;            // Frame bytes handed to the MAC, FCS excluded
+  uint32_t records;          // Records in those datagrams
+  uint32_t droppedRecords;   // Records lost: every frame buffer owned by the DMA
+  uint32_t txErrors;         // Frames refused by the MAC, their records are lost
+  uint32_t linkChanges;      // Link up and down transitions
+} udpStatus_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Initialises the Ethernet MAC and writes the header template into every frame buffer.
+ * @param  const udpConfig_t *udpConfig: Addresses and batching, copied.
+ * @retval bool: true if the MAC is ready.
+ */
+bool API_UDP_Init(const udpConfig_t *udpConfig);
+
+/**
+ * @brief  Writes a record into the filling frame buffer and hands the frame to the MAC once it holds
+ *         batchRecords records. Never waits. Records are ignored while the link is down.
+ * @param  uint32_t tick: Sample time in ms.
+ * @param  int32_t temperature: Temperature in 0.01 C.
+ * @param  uint32_t humidity: Humidity in %RH Q22.10.
+ * @retval bool: true if the record was written, false if it was ignored or dropped.
+ */
+bool API_UDP_Append(uint32_t tick, int32_t temperature, uint32_t humidity);
+
+/**
+ * @brief  Hands the partly filled frame, if any, to the MAC.
+ * @param  None
+ * @retval bool: true if nothing is left unsent.
+ */
+bool API_UDP_Flush(void);
+
+/**
+ * @brief  Takes back the frame buffers the DMA has sent and reads the PHY link status every
+ *         UDP_LINK_POLL_MS. Call from the main loop.
+ * @param  uint32_t now: Current tick in ms.
+ * @retval None
+ */
+void API_UDP_Process(uint32_t now);
+
+/**
+ * @brief  Port callback: the DMA has sent a frame, its buffer can be filled again.
+ * @param  uint8_t *frame: Frame buffer given to UDP_HAL_Transmit.
+ * @retval None
+ */
+void API_UDP_OnFrameSent(uint8_t *frame);
+
+/**
+ * @brief  Returns the publisher counters.
+ * @param  None
+ * @retval udpStatus_t: Counters.
+ */
+udpStatus_t API_UDP_GetStatus(void);
+
+#endif /* API_INC_API_UDP_H_ */
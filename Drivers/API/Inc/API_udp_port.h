@@ -0,0 +1,64 @@
+#ifndef API_INC_API_UDP_PORT_H_
+#define API_INC_API_UDP_PORT_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f4xx_hal.h" /* <- HAL include */
+
+/* Exported constants --------------------------------------------------------*/
+
+#define UDP_HAL_UNIQUE_ID_WORDS 3U // 96-bit device unique ID, the source of the MAC address
+
+// LAN8742A on the Nucleo-144, RMII
+#define UDP_HAL_PHY_ADDRESS 0x00U
+#define UDP_HAL_PHY_BSR 0x01U               // Basic status register
+#define UDP_HAL_PHY_BSR_LINK 0x0004U        // Link up
+#define UDP_HAL_PHY_SCSR 0x1FU              // Special control/status register
+#define UDP_HAL_PHY_SCSR_AUTODONE 0x1000U   // Auto-negotiation done
+#define UDP_HAL_PHY_SCSR_100M 0x0008U       // Speed indication: 100BASE-TX
+#define UDP_HAL_PHY_SCSR_FULL_DUPLEX 0x0010U // Speed indication: full duplex
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Initialises the MAC and its DMA in RMII mode, transmit only: no receive buffer is given to the DMA,
+ *         incoming frames are dropped. The MAC starts once UDP_HAL_IsLinkUp finds the link.
+ * @param  const uint8_t *mac: Source MAC address, 6 bytes.
+ * @retval bool: true on success.
+ */
+bool UDP_HAL_Init(const uint8_t *mac);
+
+/**
+ * @brief  Reads the PHY link status. When the link comes up, applies the negotiated speed and duplex and
+ *         starts the MAC. Blocking MDIO reads, a few tens of microseconds.
+ * @param  None
+ * @retval bool: true if the link is up.
+ */
+bool UDP_HAL_IsLinkUp(void);
+
+/**
+ * @brief  Points the next DMA transmit descriptor at a frame buffer, no copy. The buffer belongs to the DMA
+ *         until API_UDP_OnFrameSent returns it.
+ * @param  uint8_t *frame: Frame without its FCS, in SRAM (API_DMA_BSS), word aligned.
+ * @param  uint16_t length: Frame length.
+ * @retval bool: true if the descriptor was free and the transmission requested.
+ */
+bool UDP_HAL_Transmit(uint8_t *frame, uint16_t length);
+
+/**
+ * @brief  Returns the frames the DMA has sent, oldest first, through API_UDP_OnFrameSent.
+ * @param  None
+ * @retval None
+ */
+void UDP_HAL_ReleaseSent(void);
+
+/**
+ * @brief  Reads the device unique ID.
+ * @param  uint32_t *words: Filled with UDP_HAL_UNIQUE_ID_WORDS words.
+ * @retval None
+ */
+void UDP_HAL_GetUniqueId(uint32_t *words);
+
+#endif /* API_INC_API_UDP_PORT_H_ */
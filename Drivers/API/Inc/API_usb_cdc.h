@@ -0,0 +1,159 @@
+#ifndef API_INC_API_USB_CDC_H_
+#define API_INC_API_USB_CDC_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * USB CDC-ACM device class (virtual COM port) for the telemetry stream, written directly on the
+ * USB_HAL_* port (OTG_FS, full speed) without the ST device middleware.
+ *
+ * Interfaces: 0 communication (notification endpoint USBCDC_EP_NOTIFY), 1 data (bulk USBCDC_EP_DATA_OUT
+ * and USBCDC_EP_DATA_IN). Control transfers on endpoint 0 are split into max-packet chunks by this module.
+ *
+ * Transmission is double-buffered: API_USBCDC_Write copies into the filling buffer while the other one
+ * is on the bulk IN endpoint, and the buffers swap when a transfer completes. A transfer that ends on a
+ * full packet is followed by a zero-length packet so the host read returns. Output is only accepted once
+ * the host has configured the device and opened the port (DTR set): without a listener nothing is queued.
+ *
+ * The API_USBCDC_On* entry points are the PCD events, called by the port from the OTG_FS interrupt.
+ */
+
+/* Exported constants --------------------------------------------------------*/
+
+#define USBCDC_VENDOR_ID 0x0483U  // STMicroelectronics
+#define USBCDC_PRODUCT_ID 0x5740U // Virtual COM port
+#define USBCDC_DEVICE_RELEASE 0x0200U
+
+#define USBCDC_EP0_SIZE 64U           // Control endpoint max packet
+#define USBCDC_DATA_PACKET_SIZE 64U   // Bulk max packet at full speed
+#define USBCDC_NOTIFY_PACKET_SIZE 8U
+#define USBCDC_NOTIFY_INTERVAL 16U    // Frames between notification polls
+
+#define USBCDC_EP_DATA_OUT 0x01U
+#define USBCDC_EP_DATA_IN 0x81U
+#define USBCDC_EP_NOTIFY 0x82U
+#define USBCDC_EP_DIR_IN 0x80U
+
+// Endpoint types, as in the endpoint descriptor bmAttributes (and EP_TYPE_* of the HAL)
+#define USBCDC_EP_TYPE_CTRL 0U
+#define USBCDC_EP_TYPE_BULK 2U
+#define USBCDC_EP_TYPE_INTR 3U
+
+#define USBCDC_TX_BUFFER_SIZE 512U    // Each of the two bulk IN buffers, 8 packets
+#define USBCDC_TX_BUFFER_COUNT 2U
+#define USBCDC_SETUP_SIZE 8U
+#define USBCDC_LINE_CODING_SIZE 7U
+#define USBCDC_DEFAULT_BAUD 115200UL  // Reported until the host sets its own, the link ignores it
+
+#define USBCDC_CONTROL_LINE_DTR 0x01U // SET_CONTROL_LINE_STATE wValue bits
+#define USBCDC_CONTROL_LINE_RTS 0x02U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Device state, USB 2.0 chapter 9.
+ */
+typedef enum
+{
+  USBCDC_DETACHED,   // No VBUS, or not started
+  USBCDC_DEFAULT,    // Reset by the host, address 0
+  USBCDC_ADDRESSED,  // Address assigned, not configured
+  USBCDC_CONFIGURED, // Data endpoints open
+} usbcdcState_t;
+
+/**
+ * @brief Link state and traffic counters.
+ */
+typedef struct
+{
+  usbcdcState_t state;
+  bool suspended;          // Bus idle for 3 ms, nothing moves until resume
+  bool open;               // Configured, not suspended and DTR set: writes are accepted
+  uint32_t baudRate;       // Last line coding set by the host
+  uint32_t bytesSent;      // Bytes handed to completed bulk IN transfers
+  uint32_t transfers;      // Completed bulk IN transfers, zero-length packets excluded
+  uint32_t droppedBytes;   // Bytes refused while open because both buffers were busy
+  uint32_t droppedWrites;  // Writes refused for the same reason
+  uint32_t bytesReceived;  // Bytes received on the bulk OUT endpoint, discarded
+  uint32_t resets;         // Bus resets
+  uint32_t stalls;         // Control requests answered with a STALL
+} usbcdcStatus_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Starts the USB device: the port initialises the controller and connects to the bus.
+ * @param  None
+ * @retval bool: true if the controller started.
+ */
+bool API_USBCDC_Init(void);
+
+/**
+ * @brief  Queues bytes for the bulk IN endpoint. Never waits: the bytes are copied in whole into the
+ *         filling buffer, or refused and counted as dropped if it has no room for them.
+ * @param  data: Bytes to send.
+ * @param  length: Number of bytes, at most USBCDC_TX_BUFFER_SIZE.
+ * @retval bool: true if the bytes were queued, false if the port is closed or the buffers are full.
+ */
+bool API_USBCDC_Write(const uint8_t *data, uint16_t length);
+
+/**
+ * @brief  Tells whether a host listens: configured, not suspended and DTR set.
+ * @param  None
+ * @retval bool: true if API_USBCDC_Write accepts data.
+ */
+bool API_USBCDC_IsOpen(void);
+
+/**
+ * @brief  Returns the link state and counters.
+ * @param  None
+ * @retval usbcdcStatus_t: State and counters.
+ */
+usbcdcStatus_t API_USBCDC_GetStatus(void);
+
+/**
+ * @brief  PCD event, bus reset: back to the default state with only endpoint 0 open.
+ * @param  None
+ * @retval None
+ */
+void API_USBCDC_OnReset(void);
+
+/**
+ * @brief  PCD event, SETUP packet received on endpoint 0.
+ * @param  setup: The USBCDC_SETUP_SIZE bytes of the packet.
+ * @retval None
+ */
+void API_USBCDC_OnSetup(const uint8_t *setup);
+
+/**
+ * @brief  PCD event, an IN transfer completed.
+ * @param  epNumber: Endpoint number, without the direction bit.
+ * @retval None
+ */
+void API_USBCDC_OnDataIn(uint8_t epNumber);
+
+/**
+ * @brief  PCD event, an OUT transfer completed.
+ * @param  epNumber: Endpoint number.
+ * @param  length: Bytes received.
+ * @retval None
+ */
+void API_USBCDC_OnDataOut(uint8_t epNumber, uint16_t length);
+
+/**
+ * @brief  PCD event, bus suspended or resumed.
+ * @param  isSuspended: true on suspend, false on resume.
+ * @retval None
+ */
+void API_USBCDC_OnSuspend(bool isSuspended);
+
+/**
+ * @brief  PCD event, VBUS lost: the device is detached until the next reset.
+ * @param  None
+ * @retval None
+ */
+void API_USBCDC_OnDisconnect(void);
+
+#endif /* API_INC_API_USB_CDC_H_ */
@@ -0,0 +1,95 @@
+#ifndef API_INC_API_USB_CDC_PORT_H_
+#define API_INC_API_USB_CDC_PORT_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f4xx_hal.h" /* <- HAL include */
+
+/* Exported constants --------------------------------------------------------*/
+
+#define USB_HAL_DEVICE_ENDPOINTS 4U // OTG_FS device endpoints, endpoint 0 included
+#define USB_HAL_UNIQUE_ID_WORDS 3U  // 96-bit device unique ID, the serial number string
+
+// OTG_FS data FIFO: 1.25 KB (320 words) shared by the receive FIFO and one transmit FIFO per IN endpoint
+#define USB_HAL_RX_FIFO_WORDS 0x80U     // All OUT endpoints and SETUP packets
+#define USB_HAL_TX0_FIFO_WORDS 0x20U    // Endpoint 0 IN, one 64-byte packet and headroom
+#define USB_HAL_TX1_FIFO_WORDS 0x80U    // Bulk data IN, eight packets: the core refills it without waiting on the CPU
+#define USB_HAL_TX2_FIFO_WORDS 0x10U    // Notification IN
+
+#define USB_HAL_IRQ_PRIORITY 0x06 // Above the flash erase, below the SysTick time base. Same as OTG_FS_IRQn in SPI_test.ioc
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Initialises OTG_FS in device mode (embedded PHY, VBUS sensing on PA9), sizes the FIFOs,
+ *         enables the interrupt and connects to the bus.
+ * @param  None
+ * @retval bool: true on success.
+ */
+bool USB_HAL_Init(void);
+
+/**
+ * @brief  Opens an endpoint.
+ * @param  uint8_t address: Endpoint address, bit 7 set for IN.
+ * @param  uint16_t maxPacket: Max packet size.
+ * @param  uint8_t type: USBCDC_EP_TYPE_* (same values as the HAL EP_TYPE_*).
+ * @retval None
+ */
+void USB_HAL_OpenEndpoint(uint8_t address, uint16_t maxPacket, uint8_t type);
+
+/**
+ * @brief  Closes an endpoint, dropping any transfer in progress.
+ * @param  uint8_t address: Endpoint address.
+ * @retval None
+ */
+void USB_HAL_CloseEndpoint(uint8_t address);
+
+/**
+ * @brief  Starts an IN transfer. Completion is reported by API_USBCDC_OnDataIn.
+ * @param  uint8_t address: IN endpoint address.
+ * @param  const uint8_t *data: Bytes to send, untouched until completion. NULL with length 0 for a ZLP.
+ * @param  uint16_t length: Number of bytes. On endpoint 0, at most one max packet.
+ * @retval bool: true if the transfer started.
+ */
+bool USB_HAL_Transmit(uint8_t address, const uint8_t *data, uint16_t length);
+
+/**
+ * @brief  Arms an OUT transfer. Completion is reported by API_USBCDC_OnDataOut.
+ * @param  uint8_t address: OUT endpoint address.
+ * @param  uint8_t *data: Receive buffer. NULL with length 0 for a status stage.
+ * @param  uint16_t length: Buffer size.
+ * @retval bool: true if the endpoint is armed.
+ */
+bool USB_HAL_Receive(uint8_t address, uint8_t *data, uint16_t length);
+
+/**
+ * @brief  Stalls an endpoint. On endpoint 0 the stall ends with the next SETUP packet.
+ * @param  uint8_t address: Endpoint address.
+ * @retval None
+ */
+void USB_HAL_Stall(uint8_t address);
+
+/**
+ * @brief  Clears an endpoint stall (CLEAR_FEATURE ENDPOINT_HALT).
+ * @param  uint8_t address: Endpoint address.
+ * @retval None
+ */
+void USB_HAL_ClearStall(uint8_t address);
+
+/**
+ * @brief  Sets the device address. The OTG core applies it immediately, before the status stage.
+ * @param  uint8_t address: Address assigned by SET_ADDRESS.
+ * @retval None
+ */
+void USB_HAL_SetAddress(uint8_t address);
+
+/**
+ * @brief  Reads the device unique ID, used as the serial number.
+ * @param  uint32_t *words: Filled with USB_HAL_UNIQUE_ID_WORDS words.
+ * @retval None
+ */
+void USB_HAL_GetUniqueId(uint32_t *words);
+
+#endif /* API_INC_API_USB_CDC_PORT_H_ */
@@ -0,0 +1,188 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include <math.h>
+
+#include "API_adaptive.h"
+#include "API_section.h"
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  float refValue; // Reference sample for the rate of change
+  uint32_t refMs;
+  bool refValid;
+} adaptiveChannelState_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+API_CCM_BSS static adaptiveConfig_t activeConfig;
+API_CCM_BSS static adaptiveChannelState_t channels[ADAPTIVE_CHANNEL_COUNT];
+static adaptiveStatus_t status;
+static uint32_t lastStepMs; // Last move, or last sample that called for the current step
+static bool holdStarted;   // lastStepMs is set: false until the first sample
+
+/* Private Function Prototypes ---------------------------------------------- */
+static float channelUrgency(adaptiveChannel_t channel, const adaptiveInput_t *input, uint32_t nowMs);
+static uint32_t stepPeriod(uint8_t step);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Rates how fast one channel needs sampling: the larger of its rate of change against rateFullPerMin
+ *         and its closeness to an alarm limit within proximityBand.
+ *         The slope is taken against a reference renewed every ADAPTIVE_RATE_MIN_SPAN_MS, and over at least
+ *         that span, so a step of one quantum between two close samples stays small while a fast change shows at once.
+ * @param  adaptiveChannel_t channel: Channel.
+ * @param  const adaptiveInput_t *input: Filtered sample of the channel.
+ * @param  uint32_t nowMs: Sample time in milliseconds.
+ * @retval float: Urgency, 0 for a flat signal far from the limits, 1 or more for the shortest period.
+ */
+static float channelUrgency(adaptiveChannel_t channel, const adaptiveInput_t *input, uint32_t nowMs)
+{
+  const adaptiveChannelConfig_t *channelConfig = &activeConfig.channel[channel];
+  adaptiveChannelState_t *state = &channels[channel];
+  float urgency = 0.0f;
+
+  if (!state->refValid)
+  {
+    state->refValue = input->value;
+    state->refMs = nowMs;
+    state->refValid = true;
+  }
+
+  uint32_t elapsedMs = nowMs - state->refMs;
+  uint32_t spanMs = (elapsedMs > ADAPTIVE_RATE_MIN_SPAN_MS) ? elapsedMs : ADAPTIVE_RATE_MIN_SPAN_MS;
+
+  if (channelConfig->rateFullPerMin > 0.0f)
+  {
+    float ratePerMin = fabsf(input->value - state->refValue) * ADAPTIVE_MS_PER_MINUTE / (float)spanMs;
+
+    urgency = ratePerMin / channelConfig->rateFullPerMin;
+  }
+
+  if (elapsedMs >= ADAPTIVE_RATE_MIN_SPAN_MS)
+  {
+    state->refValue = input->value;
+    state->refMs = nowMs;
+  }
+
+  if (channelConfig->proximityBand > 0.0f && input->margin < channelConfig->proximityBand)
+  {
+    float proximity = 1.0f - input->margin / channelConfig->proximityBand;
+
+    if (proximity > urgency)
+    {
+      urgency = proximity;
+    }
+  }
+
+  return urgency;
+}
+
+/**
+ * @brief  Returns the period of a step: the shortest period doubled step times, capped at the longest.
+ * @param  uint8_t step: Step.
+ * @retval uint32_t: Period in microseconds.
+ */
+static uint32_t stepPeriod(uint8_t step)
+{
+  uint64_t periodUs = (uint64_t)activeConfig.minPeriodUs << step;
+
+  return (periodUs < activeConfig.maxPeriodUs) ? (uint32_t)periodUs : activeConfig.maxPeriodUs;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Installs a configuration and restarts at the shortest period.
+ * @param  config: Configuration to copy.
+ * @retval bool: false if the periods are zero or out of order, the previous configuration is kept.
+ */
+bool API_ADAPTIVE_Init(const adaptiveConfig_t *config)
+{
+  if (config == NULL || config->minPeriodUs == 0U || config->maxPeriodUs < config->minPeriodUs)
+  {
+    return false;
+  }
+
+  activeConfig = *config;
+  memset(channels, 0, sizeof(channels));
+  memset(&status, 0, sizeof(status));
+
+  while (stepPeriod(status.steps) < activeConfig.maxPeriodUs)
+  {
+    status.steps++;
+  }
+  status.periodUs = activeConfig.minPeriodUs;
+  holdStarted = false;
+
+  return true;
+}
+
+/**
+ * @brief  Feeds one filtered sample and returns the period to sample at from now on.
+ *         A shorter period is taken at once, a longer one one step per holdMs.
+ * @param  inputs: One input per channel, indexed by adaptiveChannel_t.
+ * @param  nowMs: Sample time in milliseconds (monotonic, wrap-safe).
+ * @retval uint32_t: Sampling period in microseconds.
+ */
+uint32_t API_ADAPTIVE_Update(const adaptiveInput_t inputs[ADAPTIVE_CHANNEL_COUNT], uint32_t nowMs)
+{
+  float urgency = 0.0f;
+
+  if (!holdStarted)
+  {
+    lastStepMs = nowMs;
+    holdStarted = true;
+  }
+
+  for (adaptiveChannel_t channel = 0; channel < ADAPTIVE_CHANNEL_COUNT; channel++)
+  {
+    float channelLevel = channelUrgency(channel, &inputs[channel], nowMs);
+
+    if (channelLevel > urgency)
+    {
+      urgency = channelLevel;
+    }
+  }
+
+  if (urgency > 1.0f)
+  {
+    urgency = 1.0f;
+  }
+
+  uint8_t target = (uint8_t)lroundf((1.0f - urgency) * (float)status.steps);
+
+  if (target < status.step)
+  {
+    status.step = target;
+    status.speedUps++;
+    lastStepMs = nowMs;
+  }
+  else if (target == status.step)
+  {
+    // The current step is still needed: the hold starts over
+    lastStepMs = nowMs;
+  }
+  else if ((nowMs - lastStepMs) >= activeConfig.holdMs)
+  {
+    status.step++;
+    status.backOffs++;
+    lastStepMs = nowMs;
+  }
+
+  status.periodUs = stepPeriod(status.step);
+
+  return status.periodUs;
+}
+
+/**
+ * @brief  Returns the current period and the step counters.
+ * @param  None
+ * @retval adaptiveStatus_t: Status.
+ */
+adaptiveStatus_t API_ADAPTIVE_GetStatus(void)
+{
+  return status;
+}
@@ -0,0 +1,263 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include <math.h>
+
+#include "API_alarm.h"
+#include "API_section.h"
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  alarmConfig_t config;
+  alarmSeverity_t severity;  // Committed (reported) severity
+  alarmSeverity_t pending;   // Candidate severity waiting for its dwell time
+  uint32_t pendingSinceMs;   // When the candidate first appeared
+  float rateRefValue;        // Reference sample for the rate-of-change measurement
+  uint32_t rateRefMs;
+  bool rateRefValid;
+  bool rateAlarm;
+} alarmChannelState_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+API_CCM_BSS static alarmChannelState_t channels[ALARM_CHANNEL_COUNT];
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void resetChannelState(alarmChannelState_t *state);
+static alarmSeverity_t evaluateLevel(const alarmConfig_t *config, alarmSeverity_t current, float value);
+static void evaluateRate(alarmChannelState_t *state, float value, uint32_t nowMs);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Clears the runtime state of a channel, keeping its configuration.
+ * @param  alarmChannelState_t *state: Channel state to reset.
+ * @retval None
+ */
+static void resetChannelState(alarmChannelState_t *state)
+{
+  state->severity = ALARM_SEVERITY_NONE;
+  state->pending = ALARM_SEVERITY_NONE;
+  state->pendingSinceMs = 0;
+  state->rateRefValid = false;
+  state->rateAlarm = false;
+}
+
+/**
+ * @brief  Finds the highest level whose limits are crossed by value.
+ *         Levels at or below the committed severity only clear once the value is back inside the
+ *         limit by more than the hysteresis band, so noise around a limit cannot toggle the level.
+ * @param  const alarmConfig_t *config: Channel configuration.
+ * @param  alarmSeverity_t current: Committed severity of the channel.
+ * @param  float value: Sample value.
+ * @retval alarmSeverity_t: Level the sample belongs to.
+ */
+static alarmSeverity_t evaluateLevel(const alarmConfig_t *config, alarmSeverity_t current, float value)
+{
+  alarmSeverity_t level = ALARM_SEVERITY_NONE;
+
+  for (alarmSeverity_t severity = ALARM_SEVERITY_WARNING; severity < ALARM_SEVERITY_COUNT; severity++)
+  {
+    float margin = (severity <= current) ? config->hysteresis : 0.0f;
+
+    if (value > config->highLimit[severity] - margin || value < config->lowLimit[severity] + margin)
+    {
+      level = severity;
+    }
+  }
+
+  return level;
+}
+
+/**
+ * @brief  Updates the rate-of-change condition of a channel.
+ *         The slope is taken against a reference sample that is renewed every ALARM_RATE_MIN_INTERVAL_MS,
+ *         so a single noisy sample over a short interval does not produce a huge slope.
+ * @param  alarmChannelState_t *state: Channel state.
+ * @param  float value: Sample value.
+ * @param  uint32_t nowMs: Sample time in milliseconds.
+ * @retval None
+ */
+static void evaluateRate(alarmChannelState_t *state, float value, uint32_t nowMs)
+{
+  if (state->config.rateLimitPerMin <= ALARM_RATE_DISABLED)
+  {
+    state->rateAlarm = false;
+    return;
+  }
+
+  if (!state->rateRefValid)
+  {
+    state->rateRefValue = value;
+    state->rateRefMs = nowMs;
+    state->rateRefValid = true;
+    return;
+  }
+
+  uint32_t elapsedMs = nowMs - state->rateRefMs;
+
+  if (elapsedMs >= ALARM_RATE_MIN_INTERVAL_MS)
+  {
+    float ratePerMin = (value - state->rateRefValue) * ALARM_MS_PER_MINUTE / (float)elapsedMs;
+
+    state->rateAlarm = (fabsf(ratePerMin) > state->config.rateLimitPerMin);
+    state->rateRefValue = value;
+    state->rateRefMs = nowMs;
+  }
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Resets every channel to ALARM_SEVERITY_NONE and disables it.
+ * @param  None
+ * @retval None
+ */
+void API_ALARM_Init(void)
+{
+  memset(channels, 0, sizeof(channels));
+
+  for (alarmChannel_t channel = 0; channel < ALARM_CHANNEL_COUNT; channel++)
+  {
+    resetChannelState(&channels[channel]);
+  }
+}
+
+/**
+ * @brief  Installs a channel configuration at runtime. The channel's state is reset.
+ * @param  channel: Channel to configure.
+ * @param  config: Configuration to copy.
+ * @retval bool: true on success, false if the channel or the configuration is invalid.
+ */
+bool API_ALARM_Configure(alarmChannel_t channel, const alarmConfig_t *config)
+{
+  if (channel >= ALARM_CHANNEL_COUNT || config == NULL || config->hysteresis < 0.0f)
+  {
+    return false;
+  }
+
+  // Critical limits must lie outside the warning limits, otherwise the levels would not nest
+  if (config->highLimit[ALARM_SEVERITY_CRITICAL] < config->highLimit[ALARM_SEVERITY_WARNING] ||
+      config->lowLimit[ALARM_SEVERITY_CRITICAL] > config->lowLimit[ALARM_SEVERITY_WARNING])
+  {
+    return false;
+  }
+
+  channels[channel].config = *config;
+  resetChannelState(&channels[channel]);
+
+  return true;
+}
+
+/**
+ * @brief  Feeds one sample to a channel and evaluates its limits, hysteresis, dwell time and rate.
+ *         A new level is only committed once it has been observed continuously for dwellMs,
+ *         and an event is produced only when the committed level changes.
+ * @param  channel: Channel the sample belongs to.
+ * @param  value: Sample value in the channel's unit.
+ * @param  nowMs: Sample time in milliseconds (monotonic, wrap-safe).
+ * @param  event: Filled when the committed severity changes.
+ * @retval bool: true if a transition was committed, false otherwise.
+ */
+bool API_ALARM_Update(alarmChannel_t channel, float value, uint32_t nowMs, alarmEvent_t *event)
+{
+  if (channel >= ALARM_CHANNEL_COUNT || event == NULL || !channels[channel].config.enabled)
+  {
+    return false;
+  }
+
+  alarmChannelState_t *state = &channels[channel];
+
+  evaluateRate(state, value, nowMs);
+
+  alarmSeverity_t candidate = evaluateLevel(&state->config, state->severity, value);
+
+  if (state->rateAlarm && candidate < ALARM_SEVERITY_WARNING)
+  {
+    candidate = ALARM_SEVERITY_WARNING;
+  }
+
+  if (candidate == state->severity)
+  {
+    state->pending = candidate;
+    return false;
+  }
+
+  if (candidate != state->pending)
+  {
+    state->pending = candidate;
+    state->pendingSinceMs = nowMs;
+  }
+
+  if ((nowMs - state->pendingSinceMs) < state->config.dwellMs)
+  {
+    return false;
+  }
+
+  event->channel = channel;
+  event->previous = state->severity;
+  event->current = candidate;
+  event->value = value;
+  event->rateAlarm = state->rateAlarm;
+
+  state->severity = candidate;
+
+  return true;
+}
+
+/**
+ * @brief  Returns the committed severity of a channel.
+ * @param  channel: Channel to query.
+ * @retval alarmSeverity_t: Current severity, ALARM_SEVERITY_NONE for an invalid channel.
+ */
+alarmSeverity_t API_ALARM_GetSeverity(alarmChannel_t channel)
+{
+  if (channel >= ALARM_CHANNEL_COUNT)
+  {
+    return ALARM_SEVERITY_NONE;
+  }
+
+  return channels[channel].severity;
+}
+
+/**
+ * @brief  Returns the highest committed severity across all channels.
+ * @param  None
+ * @retval alarmSeverity_t: Highest severity.
+ */
+alarmSeverity_t API_ALARM_GetHighestSeverity(void)
+{
+  alarmSeverity_t highest = ALARM_SEVERITY_NONE;
+
+  for (alarmChannel_t channel = 0; channel < ALARM_CHANNEL_COUNT; channel++)
+  {
+    if (channels[channel].severity > highest)
+    {
+      highest = channels[channel].severity;
+    }
+  }
+
+  return highest;
+}
+
+/**
+ * @brief  Returns how far a value lies inside the warning limits of a channel.
+ *         Hysteresis is ignored: this is the distance to the level being raised, not cleared.
+ * @param  channel: Channel to query.
+ * @param  value: Value in the channel's unit.
+ * @retval float: Distance to the nearest warning limit, 0 at or past it, ALARM_LIMIT_DISABLED_HIGH for a
+ *         disabled or invalid channel.
+ */
+float API_ALARM_GetMargin(alarmChannel_t channel, float value)
+{
+  if (channel >= ALARM_CHANNEL_COUNT || !channels[channel].config.enabled)
+  {
+    return ALARM_LIMIT_DISABLED_HIGH;
+  }
+
+  const alarmConfig_t *config = &channels[channel].config;
+  float margin = fminf(config->highLimit[ALARM_SEVERITY_WARNING] - value, value - config->lowLimit[ALARM_SEVERITY_WARNING]);
+
+  return (margin > 0.0f) ? margin : 0.0f;
+}
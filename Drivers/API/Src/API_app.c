@@ -1,42 +1,637 @@
 #include "API_app.h"
 
 /* Global and Static Variables -------------------------------------------------------*/
-static tempState_t currentTempState;
+// Text scratch buffers and filter/codec state are CPU-only: CCM, off the DMA-shared SRAM
+API_CCM_BSS char strbuff[SIZE];
+API_CCM_BSS char message_tem[SIZE];
+API_CCM_BSS char message_hum[SIZE];
+API_CCM_BSS char lcdTempStr[SIZE];
+API_CCM_BSS char lcdHumStr[SIZE];
+API_CCM_BSS char messageAlarm[SIZE];
+API_CCM_BSS char messageStats[APP_STATS_MSG_SIZE];
 
-char strbuff[SIZE];
-char message_tem[SIZE];
-char message_hum[SIZE];
-char lcdTempStr[SIZE];
-char lcdHumStr[SIZE];
-char messageFsm[50];
+API_CCM_BSS static filterChannel_t tempFilter;
+API_CCM_BSS static filterChannel_t humFilter;
+
+// Bus subscriptions, dispatched in this order: raw sample sinks and the filter, clock, filtered sample sinks, alarms
+API_CCM_BSS static busSubscription_t usbRawSubscription;
+API_CCM_BSS static busSubscription_t udpRawSubscription;
+API_CCM_BSS static busSubscription_t filterSubscription;
+API_CCM_BSS static busSubscription_t clockSubscription;
+API_CCM_BSS static busSubscription_t anchorSubscription;
+API_CCM_BSS static busSubscription_t statsSubscription;
+API_CCM_BSS static busSubscription_t logSubscription;
+API_CCM_BSS static busSubscription_t sdlogSubscription;
+API_CCM_BSS static busSubscription_t displaySubscription;
+API_CCM_BSS static busSubscription_t telemetrySubscription;
+API_CCM_BSS static busSubscription_t alarmSubscription;
+API_CCM_BSS static busSubscription_t rateSubscription;
+API_CCM_BSS static busSubscription_t alarmReportSubscription;
+
+// Set once the timed sampler runs; until then the sensor is read from APP_update
+static bool samplerRunning;
+static uint32_t lastPollMs; // Last sensor read from APP_update, paced by the adaptive period
+
+// Sensor fault reported on UART and LED3, and since when
+static bool sensorFaulted;
+static uint32_t faultStartMs;
+
+// Sensor reads since the last diagnostics lines, for the duty cycle and the SPI traffic
+static uint32_t rateWindowStartMs;
+static uint32_t rateWindowReads;
+
+// Calendar read on each time message, rendered on the LCD
+static RTC_TimeTypeDef clockTime;
+static RTC_DateTypeDef clockDate;
+
+// RTC time in ms and the SysTick count read together, refreshed every second: converts read ticks to RTC time
+static timestampMs_t anchorTimeMs;
+static uint32_t anchorTick;
+
+static uint32_t lastLogMs; // Time of the last record appended to the flash log
+
+static delay_t diagnosticsDelay; // Paces the diagnostics lines, whatever the samples and their report decisions
+
+// Compressed UART telemetry: one block of delta-encoded samples per line
+API_CCM_BSS static codecState_t uartCodec;
+API_CCM_BSS static uint8_t codecPacket[APP_CODEC_PACKET_SIZE]; // Sample count byte followed by the encoded samples
+static uint16_t codecPacketLength;
+API_CCM_BSS static char codecLine[APP_CODEC_LINE_SIZE];
+
+static const filterConfig_t APP_FILTER_CONFIG = {
+    .medianWindow = APP_FILTER_MEDIAN_WINDOW,
+    .decimation = APP_FILTER_DECIMATION,
+    .emaShift = APP_FILTER_EMA_SHIFT,
+};
+
+// UDP publisher: collector addresses and records per datagram
+static const udpConfig_t APP_UDP_CONFIG = {
+    .destinationMac = APP_UDP_COLLECTOR_MAC,
+    .sourceIp = APP_UDP_BOARD_IP,
+    .destinationIp = APP_UDP_COLLECTOR_IP,
+    .sourcePort = APP_UDP_BOARD_PORT,
+    .destinationPort = APP_UDP_COLLECTOR_PORT,
+    .batchRecords = APP_UDP_BATCH_RECORDS,
+};
+
+static const adaptiveConfig_t APP_ADAPTIVE_CONFIG = {
+    .minPeriodUs = APP_RATE_MIN_PERIOD_US,
+    .maxPeriodUs = APP_RATE_MAX_PERIOD_US,
+    .holdMs = APP_RATE_HOLD_MS,
+    .channel = {
+        [ADAPTIVE_CHANNEL_TEMPERATURE] = {.rateFullPerMin = APP_TEMP_RATE_FULL, .proximityBand = APP_TEMP_PROXIMITY},
+        [ADAPTIVE_CHANNEL_HUMIDITY] = {.rateFullPerMin = APP_HUM_RATE_FULL, .proximityBand = APP_HUM_PROXIMITY},
+    },
+};
+
+// Default alarm table, installed at init and replaceable at runtime through API_ALARM_Configure
+static const alarmConfig_t APP_ALARM_DEFAULTS[ALARM_CHANNEL_COUNT] = {
+    [ALARM_CHANNEL_TEMPERATURE] = {
+        .enabled = true,
+        .highLimit = {ALARM_LIMIT_DISABLED_HIGH, APP_TEMP_WARNING_HIGH, APP_TEMP_CRITICAL_HIGH},
+        .lowLimit = {ALARM_LIMIT_DISABLED_LOW, APP_TEMP_WARNING_LOW, APP_TEMP_CRITICAL_LOW},
+        .hysteresis = APP_TEMP_HYSTERESIS,
+        .dwellMs = APP_TEMP_DWELL_MS,
+        .rateLimitPerMin = APP_TEMP_RATE_LIMIT,
+    },
+    [ALARM_CHANNEL_HUMIDITY] = {
+        .enabled = true,
+        .highLimit = {ALARM_LIMIT_DISABLED_HIGH, APP_HUM_WARNING_HIGH, APP_HUM_CRITICAL_HIGH},
+        .lowLimit = {ALARM_LIMIT_DISABLED_LOW, APP_HUM_WARNING_LOW, APP_HUM_CRITICAL_LOW},
+        .hysteresis = APP_HUM_HYSTERESIS,
+        .dwellMs = APP_HUM_DWELL_MS,
+        .rateLimitPerMin = APP_HUM_RATE_LIMIT,
+    },
+    [ALARM_CHANNEL_PRESSURE] = {
+        .enabled = false,
+        .highLimit = {ALARM_LIMIT_DISABLED_HIGH, ALARM_LIMIT_DISABLED_HIGH, ALARM_LIMIT_DISABLED_HIGH},
+        .lowLimit = {ALARM_LIMIT_DISABLED_LOW, ALARM_LIMIT_DISABLED_LOW, ALARM_LIMIT_DISABLED_LOW},
+        .rateLimitPerMin = ALARM_RATE_DISABLED,
+    },
+};
+
+// UART tags for alarm transitions
+static const char *const APP_ALARM_CHANNEL_TAGS[ALARM_CHANNEL_COUNT] = {"Temperature", "Humidity", "Pressure"};
+static const char *const APP_ALARM_SEVERITY_TAGS[ALARM_SEVERITY_COUNT] = {" Normal", " Warning", " Critical"};
+
+// UART and USB tags for the sensor faults
+static const char *const APP_FAULT_TAGS[FAULT_TYPE_COUNT] = {"", "bus", "id", "stuck", "range", "recovery"};
+
+// UART tags for the rolling statistics lines
+static const char *const APP_STATS_CHANNEL_TAGS[STATS_CHANNEL_COUNT] = {"Temperature", "Humidity"};
+static const char *const APP_STATS_WINDOW_TAGS[STATS_WINDOW_COUNT] = {" 1m", " 1h", " 24h"};
 
 /* Function Prototypes -------------------------------------------------------------*/
-static void APP_FSM_init(void);
-static void APP_FSM_update(void);
+static void APP_busInit(void);
+static void APP_alarmInit(void);
+static void APP_alarmUpdate(const busMessage_t *message);
+static void APP_alarmReport(const busMessage_t *message);
 
+static void APP_reportInit(void);
+static void APP_statsInit(void);
+static void APP_statsUpdate(const busMessage_t *message);
+static void APP_uartAppendFixed(char *message, const char *tag, float value);
+static void APP_uartAppendHundredths(char *message, const char *tag, int32_t hundredths);
+static void APP_uartSendStats(void);
+static void APP_uartSendBusStats(void);
+static void APP_samplerInit(void);
+static void APP_uartSendSamplerStats(void);
+static void APP_rateInit(void);
+static void APP_rateUpdate(const busMessage_t *message);
+static filterConfig_t APP_rateFilterConfig(uint32_t periodUs);
+static void APP_uartSendRateStats(void);
+static void APP_faultInit(bme280Status_t bootStatus);
+static void APP_faultUpdate(void);
+static void APP_uartSendFaultStats(void);
+static void APP_logInit(void);
+static void APP_codecInit(void);
+static void APP_uartFlushCompressed(void);
+static void APP_uartSendCompressed(const busSample_t *sample, uint32_t now);
+static void APP_logUpdate(const busMessage_t *message);
+static logRecord_t APP_logRecord(const busSample_t *sample);
+static void APP_sdlogInit(void);
+static void APP_sdlogUpdate(const busMessage_t *message);
+static void APP_uartSendSdlogStats(void);
+static void APP_telemetrySend(uint8_t *line);
+static void APP_usbSendRawSample(const busMessage_t *message);
+static void APP_uartSendUsbStats(void);
+static void APP_udpInit(void);
+static void APP_udpAppendRawSample(const busMessage_t *message);
+static void APP_uartSendUdpStats(void);
 static void APP_uartPrepareData(float bme280_data, char *message, const char *tag, const char *unit);
-static void APP_uartPrepareSensorTempHum(char *message_tem, char *message_hum);
-static void APP_uartDisplaySensorData(char *message_tem, char *message_hum);
-static void APP_lcdPrepareSensorData(void);
+static void APP_uartSendReportCounters(void);
+static void APP_uartSendMemStats(void);
+static void APP_uartSendStackStats(void);
+static void APP_lcdPrepareSensorData(const busSample_t *sample);
 static void APP_lcdDisplaySensorData(void);
 static void APP_lcdAlarm(void);
 static void APP_lcdDisplayClock(void);
 static void APP_lcdDisplayDate(void);
-static void APP_lcdUpdateTime(void);
-static void APP_updateSensorData(void);
-static void APP_prepareAndDisplaySensorData(void);
-static void APP_prepareAndSendUARTData(void);
-static void APP_FsmErrorHandler(void);
+static void APP_lcdUpdateTime(const busMessage_t *message);
+static void APP_clockAnchor(void);
+static void APP_clockUpdateAnchor(const busMessage_t *message);
+static timestampMs_t APP_clockTickToTime(uint32_t tick);
+static bool APP_publishSensorData(void);
+static void APP_publishRawSample(uint32_t tick, bme280Status_t readStatus);
+static void APP_filterSample(const busMessage_t *message);
+static void APP_prepareAndDisplaySensorData(const busMessage_t *message);
+static void APP_prepareAndSendUARTData(const busMessage_t *message);
+static void APP_uartSendText(const busSample_t *sample, reportReason_t tempReason, reportReason_t humReason);
+static void APP_uartSendDiagnostics(void);
+static void APP_uartSendDerived(const busMessage_t *message);
 
 /* Private Function Definitions --------------------------------------------- */
 
 /**
- * @brief Initializes the finite state machine (FSM) to the default temperature state.
+ * @brief Subscribes the application consumers to the bus. The subscription order is the dispatch order, so each
+ *        sample goes through the same stages in the same order as when APP_update called them one by one.
+ *        A new sink is one more subscription here, APP_update does not change.
+ * @retval None
+ */
+void APP_busInit(void)
+{
+    API_BUS_Init();
+
+    API_BUS_Subscribe(&usbRawSubscription, BUS_TOPIC_RAW_SAMPLE, APP_usbSendRawSample, 0U);
+    API_BUS_Subscribe(&udpRawSubscription, BUS_TOPIC_RAW_SAMPLE, APP_udpAppendRawSample, 0U);
+    API_BUS_Subscribe(&filterSubscription, BUS_TOPIC_RAW_SAMPLE, APP_filterSample, 0U);
+    API_BUS_Subscribe(&clockSubscription, BUS_TOPIC_TIME, APP_lcdUpdateTime, 0U);
+    API_BUS_Subscribe(&anchorSubscription, BUS_TOPIC_TIME, APP_clockUpdateAnchor, 0U);
+    API_BUS_Subscribe(&statsSubscription, BUS_TOPIC_SAMPLE, APP_statsUpdate, 0U);
+    API_BUS_Subscribe(&logSubscription, BUS_TOPIC_SAMPLE, APP_logUpdate, 0U);
+    API_BUS_Subscribe(&sdlogSubscription, BUS_TOPIC_SAMPLE, APP_sdlogUpdate, 0U);
+    API_BUS_Subscribe(&displaySubscription, BUS_TOPIC_SAMPLE, APP_prepareAndDisplaySensorData, 0U);
+    API_BUS_Subscribe(&telemetrySubscription, BUS_TOPIC_SAMPLE, APP_prepareAndSendUARTData, 0U);
+    API_BUS_Subscribe(&alarmSubscription, BUS_TOPIC_SAMPLE, APP_alarmUpdate, 0U);
+    API_BUS_Subscribe(&rateSubscription, BUS_TOPIC_SAMPLE, APP_rateUpdate, 0U);
+    API_BUS_Subscribe(&alarmReportSubscription, BUS_TOPIC_ALARM, APP_alarmReport, 0U);
+}
+
+/**
+ * @brief Configures report-by-exception: per-channel deadbands and the heartbeat interval, and starts the
+ *        diagnostics timer on the same interval.
+ * @retval None
+ */
+void APP_reportInit(void)
+{
+    delayInit(&diagnosticsDelay, APP_REPORT_HEARTBEAT_MS);
+    API_REPORT_Init(APP_REPORT_HEARTBEAT_MS);
+    API_REPORT_SetExceptionMode(APP_REPORT_BY_EXCEPTION);
+    API_REPORT_SetDeadband(REPORT_CHANNEL_TEMPERATURE, APP_TEMP_DEADBAND);
+    API_REPORT_SetDeadband(REPORT_CHANNEL_HUMIDITY, APP_HUM_DEADBAND);
+}
+
+/**
+ * @brief Initializes the alarm engine and installs the default per-channel alarm table.
+ * @retval None
+ */
+void APP_alarmInit(void)
+{
+    API_ALARM_Init();
+
+    for (alarmChannel_t channel = 0; channel < ALARM_CHANNEL_COUNT; channel++)
+    {
+        API_ALARM_Configure(channel, &APP_ALARM_DEFAULTS[channel]);
+    }
+}
+
+/**
+ * @brief Configures the quantile histogram range of each statistics channel.
+ * @retval None
+ */
+void APP_statsInit(void)
+{
+    API_STATS_Init();
+    API_STATS_ConfigureHistogram(STATS_CHANNEL_TEMPERATURE, APP_STATS_TEMP_LOWEST, APP_STATS_TEMP_BUCKET);
+    API_STATS_ConfigureHistogram(STATS_CHANNEL_HUMIDITY, APP_STATS_HUM_LOWEST, APP_STATS_HUM_BUCKET);
+}
+
+/**
+ * @brief Feeds a filtered sample to the rolling statistics.
+ * @param message: BUS_TOPIC_SAMPLE message.
+ * @retval None
+ */
+void APP_statsUpdate(const busMessage_t *message)
+{
+    API_STATS_Push(STATS_CHANNEL_TEMPERATURE, message->sample.temperature, message->tick);
+    API_STATS_Push(STATS_CHANNEL_HUMIDITY, message->sample.humidity, message->tick);
+}
+
+/**
+ * @brief Appends a tag and a signed value with two decimals to a message.
+ * @param message: Buffer to append to.
+ * @param tag: Text placed before the value (e.g., " mean=").
+ * @param value: Value to format.
+ * @retval None
+ */
+void APP_uartAppendFixed(char *message, const char *tag, float value)
+{
+    APP_uartAppendHundredths(message, tag, (int32_t)lroundf(value * FRACTIONAL_MULTIPLIER));
+}
+
+/**
+ * @brief Appends a tag and a signed fixed-point value in hundredths, printed with two decimals, to a message.
+ * @param message: Buffer to append to.
+ * @param tag: Text placed before the value (e.g., " C abs ").
+ * @param hundredths: Value in units of 0.01.
+ * @retval None
+ */
+void APP_uartAppendHundredths(char *message, const char *tag, int32_t hundredths)
+{
+    uint32_t magnitude = (hundredths < 0) ? (uint32_t)(-hundredths) : (uint32_t)hundredths;
+    uint32_t fracPart = magnitude % FRACTIONAL_MULTIPLIER;
+
+    strcat(message, tag);
+    if (hundredths < 0)
+    {
+        strcat(message, "-");
+    }
+    utoa(magnitude / FRACTIONAL_MULTIPLIER, message + strlen(message), DECIMAL);
+    strcat(message, (fracPart < 10U) ? ".0" : ".");
+    utoa(fracPart, message + strlen(message), DECIMAL);
+}
+
+/**
+ * @brief Sends one line per channel and window with count, mean, standard deviation, min, max, and the p50 and p95
+ *        of the slot means (1 s, 1 min and 15 min slots): "... slot p50=x p95=y".
+ * @retval None
+ */
+void APP_uartSendStats(void)
+{
+    statsSummary_t summary;
+
+    for (statsChannel_t channel = 0; channel < STATS_CHANNEL_COUNT; channel++)
+    {
+        for (statsWindow_t window = 0; window < STATS_WINDOW_COUNT; window++)
+        {
+            if (!API_STATS_GetSummary(channel, window, &summary))
+            {
+                continue;
+            }
+
+            strcpy(messageStats, APP_STATS_CHANNEL_TAGS[channel]);
+            strcat(messageStats, APP_STATS_WINDOW_TAGS[window]);
+            strcat(messageStats, " n=");
+            utoa(summary.count, messageStats + strlen(messageStats), DECIMAL);
+            APP_uartAppendFixed(messageStats, " mean=", summary.mean);
+            APP_uartAppendFixed(messageStats, " sd=", summary.stddev);
+            APP_uartAppendFixed(messageStats, " min=", summary.min);
+            APP_uartAppendFixed(messageStats, " max=", summary.max);
+            APP_uartAppendFixed(messageStats, " slot p50=", summary.slotP50);
+            APP_uartAppendFixed(messageStats, " p95=", summary.slotP95);
+            strcat(messageStats, "\r\n");
+            APP_telemetrySend((uint8_t *)messageStats);
+        }
+    }
+}
+
+/**
+ * @brief Recovers the flash log and reports the scan result over UART.
+ * @retval None
+ */
+void APP_logInit(void)
+{
+    bool ready = API_LOG_Init();
+    logStatus_t logStatus = API_LOG_GetStatus();
+
+    strcpy(messageStats, ready ? "Log blocks: " : "Log error, blocks: ");
+    utoa(logStatus.blocks, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " torn: ");
+    utoa(logStatus.tornBlocks, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, "\r\n");
+    APP_telemetrySend((uint8_t *)messageStats);
+
+    lastLogMs = HAL_GetTick();
+}
+
+/**
+ * @brief Appends a filtered sample to the flash log every APP_LOG_INTERVAL_MS.
+ * @param message: BUS_TOPIC_SAMPLE message.
+ * @retval None
+ */
+void APP_logUpdate(const busMessage_t *message)
+{
+    if ((message->tick - lastLogMs) < APP_LOG_INTERVAL_MS)
+    {
+        return;
+    }
+    lastLogMs = message->tick;
+
+    logRecord_t record = APP_logRecord(&message->sample);
+    API_LOG_Append(&record);
+}
+
+/**
+ * @brief Builds a log record from a filtered sample.
+ * @param sample: Filtered sample.
+ * @retval logRecord_t: Record stamped with the RTC time of the sample.
+ */
+logRecord_t APP_logRecord(const busSample_t *sample)
+{
+    logRecord_t record = {
+        .timestamp = (timestamp_t)(sample->time / TIMESTAMP_MS_PER_SECOND),
+        .temperature = (int16_t)lroundf(sample->temperature * FRACTIONAL_MULTIPLIER),
+        .humidity = (uint16_t)lroundf(sample->humidity * FRACTIONAL_MULTIPLIER),
+    };
+
+    return record;
+}
+
+/**
+ * @brief Opens the SD card log and reports the recovery result over UART. Without a card the log stays off.
+ * @retval None
+ */
+void APP_sdlogInit(void)
+{
+    bool ready = API_SDLOG_Init();
+    sdlogStatus_t sdStatus = API_SDLOG_GetStatus();
+
+    if (!ready)
+    {
+        APP_telemetrySend((uint8_t *)"SD log off: no card\r\n");
+        return;
+    }
+
+    strcpy(messageStats, "SD log blocks: ");
+    utoa(sdStatus.blocks, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, "/");
+    utoa(sdStatus.capacity, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " recovered: ");
+    utoa(sdStatus.recovered, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, "\r\n");
+    APP_telemetrySend((uint8_t *)messageStats);
+}
+
+/**
+ * @brief Appends every filtered sample to the SD card log. Only RAM is touched: API_SDLOG_Process writes the card.
+ * @param message: BUS_TOPIC_SAMPLE message.
+ * @retval None
+ */
+void APP_sdlogUpdate(const busMessage_t *message)
+{
+    logRecord_t record = APP_logRecord(&message->sample);
+    API_SDLOG_Append(&record);
+}
+
+/**
+ * @brief Sends the SD card log progress: "SD blocks written/capacity pending n drop n err n busy n spi n".
+ *        Nothing is sent until a card has been mounted.
+ * @retval None
+ */
+void APP_uartSendSdlogStats(void)
+{
+    sdlogStatus_t sdStatus = API_SDLOG_GetStatus();
+
+    if (sdStatus.capacity == 0U)
+    {
+        return; // No card was ever mounted
+    }
+
+    strcpy(messageStats, "SD blocks ");
+    utoa(sdStatus.blocks, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, "/");
+    utoa(sdStatus.capacity, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " pending ");
+    utoa(sdStatus.pending, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " drop ");
+    utoa(sdStatus.dropped, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " err ");
+    utoa(sdStatus.errors, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " busy ");
+    utoa(sdStatus.busyPolls, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " spi ");
+    utoa(sdStatus.busWaits, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, "\r\n");
+    APP_telemetrySend((uint8_t *)messageStats);
+}
+
+/**
+ * @brief Sends a telemetry line over UART and mirrors it to the USB CDC port.
+ *        The USB copy never waits: it is dropped while no host listens or both USB buffers are busy.
+ * @param line: Null-terminated line.
+ * @retval None
+ */
+void APP_telemetrySend(uint8_t *line)
+{
+    uartSendString(line);
+    API_USBCDC_Write(line, (uint16_t)strlen((const char *)line));
+}
+
+/**
+ * @brief Streams each raw sample to the USB CDC port: "R:<ms>,<T 0.01 C>,<H Q22.10>", or "F:<ms>,<fault>" for
+ *        an invalid one. USB only, the UART has no room for the raw rate.
+ * @param message: BUS_TOPIC_RAW_SAMPLE message.
+ * @retval None
+ */
+void APP_usbSendRawSample(const busMessage_t *message)
+{
+    char line[APP_USB_RAW_LINE_SIZE];
+
+    if (!APP_USB_RAW_STREAM || !API_USBCDC_IsOpen())
+    {
+        return;
+    }
+
+    if (message->raw.fault != FAULT_TYPE_NONE)
+    {
+        strcpy(line, "F:");
+        utoa(message->tick, line + strlen(line), DECIMAL);
+        strcat(line, ",");
+        strcat(line, APP_FAULT_TAGS[message->raw.fault]);
+        strcat(line, "\r\n");
+        API_USBCDC_Write((const uint8_t *)line, (uint16_t)strlen(line));
+        return;
+    }
+
+    strcpy(line, "R:");
+    utoa(message->tick, line + strlen(line), DECIMAL);
+    strcat(line, ",");
+    itoa(message->raw.temperature, line + strlen(line), DECIMAL);
+    strcat(line, ",");
+    utoa(message->raw.humidity, line + strlen(line), DECIMAL);
+    strcat(line, "\r\n");
+    API_USBCDC_Write((const uint8_t *)line, (uint16_t)strlen(line));
+}
+
+/**
+ * @brief Sends the USB CDC port counters: "USB sent bytes/transfers drop n rx n". Nothing is sent while detached.
+ * @retval None
+ */
+void APP_uartSendUsbStats(void)
+{
+    usbcdcStatus_t usbStatus = API_USBCDC_GetStatus();
+
+    if (usbStatus.state == USBCDC_DETACHED && usbStatus.droppedBytes == 0U)
+    {
+        return;
+    }
+
+    strcpy(messageStats, "USB sent ");
+    utoa(usbStatus.bytesSent, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, "/");
+    utoa(usbStatus.transfers, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " drop ");
+    utoa(usbStatus.droppedBytes, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " rx ");
+    utoa(usbStatus.bytesReceived, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, usbStatus.open ? " open\r\n" : " closed\r\n");
+    APP_telemetrySend((uint8_t *)messageStats);
+}
+
+/**
+ * @brief Starts the Ethernet UDP publisher. Without a PHY clock the MAC does not come out of reset and the publisher stays off.
+ * @retval None
+ */
+void APP_udpInit(void)
+{
+    if (!API_UDP_Init(&APP_UDP_CONFIG))
+    {
+        APP_telemetrySend((uint8_t *)"UDP off: no Ethernet PHY\r\n");
+    }
+}
+
+/**
+ * @brief Appends each raw sample to the UDP publisher batch, an invalid one as its fault with UDP_HUMIDITY_INVALID.
+ * @param message: BUS_TOPIC_RAW_SAMPLE message.
  * @retval None
  */
-void APP_FSM_init(void)
+void APP_udpAppendRawSample(const busMessage_t *message)
 {
-    currentTempState = TEMP_NORMAL;
+    if (message->raw.fault != FAULT_TYPE_NONE)
+    {
+        API_UDP_Append(message->tick, (int32_t)message->raw.fault, UDP_HUMIDITY_INVALID);
+        return;
+    }
+
+    API_UDP_Append(message->tick, message->raw.temperature, message->raw.humidity);
+}
+
+/**
+ * @brief Sends the UDP publisher counters: "UDP sent frames/records drop n err n link up".
+ *        Nothing is sent before the link first comes up.
+ * @retval None
+ */
+void APP_uartSendUdpStats(void)
+{
+    udpStatus_t udpStatus = API_UDP_GetStatus();
+
+    if (!udpStatus.linkUp && udpStatus.frames == 0U)
+    {
+        return;
+    }
+
+    strcpy(messageStats, "UDP sent ");
+    utoa(udpStatus.frames, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, "/");
+    utoa(udpStatus.records, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " drop ");
+    utoa(udpStatus.droppedRecords, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " err ");
+    utoa(udpStatus.txErrors, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, udpStatus.linkUp ? " link up\r\n" : " link down\r\n");
+    APP_telemetrySend((uint8_t *)messageStats);
+}
+
+/**
+ * @brief Starts the first compressed telemetry block.
+ * @retval None
+ */
+void APP_codecInit(void)
+{
+    API_CODEC_Reset(&uartCodec, APP_CODEC_CHANNELS);
+    codecPacketLength = APP_CODEC_HEADER_SIZE;
+}
+
+/**
+ * @brief Sends the current compressed block as "Z:<base64>" and starts a new one.
+ *        Every block starts with an absolute sample, so each line decodes on its own.
+ * @retval None
+ */
+void APP_uartFlushCompressed(void)
+{
+    if (uartCodec.count == 0U)
+    {
+        return;
+    }
+
+    codecPacket[0] = (uint8_t)uartCodec.count;
+    strcpy(codecLine, "Z:");
+    API_CODEC_ToBase64(codecPacket, codecPacketLength, codecLine + strlen(codecLine),
+                       (uint16_t)(sizeof(codecLine) - strlen(codecLine) - strlen("\r\n")));
+    strcat(codecLine, "\r\n");
+    APP_telemetrySend((uint8_t *)codecLine);
+
+    APP_codecInit();
+}
+
+/**
+ * @brief Adds a filtered sample to the compressed block: millisecond tick, temperature and
+ *        humidity in hundredths. The block is sent when it holds APP_CODEC_BLOCK_SAMPLES samples or is full.
+ * @param sample: Filtered sample.
+ * @param now: Sample time in milliseconds.
+ * @retval None
+ */
+void APP_uartSendCompressed(const busSample_t *sample, uint32_t now)
+{
+    int32_t values[APP_CODEC_CHANNELS] = {
+        (int32_t)lroundf(sample->temperature * FRACTIONAL_MULTIPLIER),
+        (int32_t)lroundf(sample->humidity * FRACTIONAL_MULTIPLIER),
+    };
+    uint16_t written = API_CODEC_EncodeSample(&uartCodec, now, values, codecPacket + codecPacketLength,
+                                              (uint16_t)(sizeof(codecPacket) - codecPacketLength));
+
+    if (written == 0U)
+    {
+        APP_uartFlushCompressed();
+        written = API_CODEC_EncodeSample(&uartCodec, now, values, codecPacket + codecPacketLength,
+                                         (uint16_t)(sizeof(codecPacket) - codecPacketLength));
+    }
+    codecPacketLength += written;
+
+    if (uartCodec.count >= APP_CODEC_BLOCK_SAMPLES)
+    {
+        APP_uartFlushCompressed();
+    }
 }
 
 /**
@@ -66,42 +661,295 @@ void APP_uartPrepareData(float bme280_data, char *message, const char *tag, cons
 }
 
 /**
- * @brief Prepares the temperature and humidity data for UART transmission.
- * @param message_tem: Buffer to store the formatted temperature data.
- * @param message_hum: Buffer to store the formatted humidity data.
+ * @brief Sends the sent/suppressed report counters over UART.
+ * @retval None
+ */
+void APP_uartSendReportCounters(void)
+{
+    reportCounters_t totals = API_REPORT_GetTotals();
+
+    strcpy(message_tem, "Reports sent: ");
+    itoa((int)totals.sent, message_tem + strlen(message_tem), DECIMAL);
+    strcat(message_tem, " suppressed: ");
+    itoa((int)totals.suppressed, message_tem + strlen(message_tem), DECIMAL);
+    strcat(message_tem, "\r\n");
+    APP_telemetrySend((uint8_t *)message_tem);
+}
+
+/**
+ * @brief Sends the bus losses: "Bus missed n refused n". Nothing is sent while every subscriber keeps up.
+ * @retval None
+ */
+void APP_uartSendBusStats(void)
+{
+    uint32_t missed = API_BUS_GetMissed();
+    uint32_t refused = 0;
+
+    for (busTopic_t topic = 0; topic < BUS_TOPIC_COUNT; topic++)
+    {
+        refused += API_BUS_GetTopicStats(topic).refused;
+    }
+
+    if (missed == 0U && refused == 0U)
+    {
+        return;
+    }
+
+    strcpy(messageStats, "Bus missed ");
+    utoa(missed, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " refused ");
+    utoa(refused, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, "\r\n");
+    APP_telemetrySend((uint8_t *)messageStats);
+}
+
+/**
+ * @brief Starts the timer-triggered sensor reads. Last of the initialisation: SPI1 is then shared with the SD card log.
+ *        Without the timer and DMA the sensor stays polled from APP_update.
+ * @retval None
+ */
+void APP_samplerInit(void)
+{
+    if (!API_SAMPLER_Init(API_ADAPTIVE_GetStatus().periodUs))
+    {
+        APP_telemetrySend((uint8_t *)"Sampler off: sensor polled\r\n");
+        return;
+    }
+
+    API_SAMPLER_Start();
+    samplerRunning = true;
+}
+
+/**
+ * @brief Sends the sampling jitter since the last diagnostics lines and the acquisition counters:
+ *        "Sampler jitter min/max/rms ns over n" and "Sampler reads n defer n overrun n drop n err n tout n".
+ * @retval None
+ */
+void APP_uartSendSamplerStats(void)
+{
+    samplerStatus_t samplerStatus = API_SAMPLER_GetStatus();
+    samplerJitter_t jitter = API_SAMPLER_TakeJitter();
+
+    if (!samplerStatus.running)
+    {
+        return;
+    }
+
+    strcpy(messageStats, "Sampler jitter ");
+    itoa(jitter.minNs, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, "/");
+    itoa(jitter.maxNs, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, "/");
+    utoa(jitter.rmsNs, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " ns over ");
+    utoa(jitter.intervals, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, "\r\n");
+    APP_telemetrySend((uint8_t *)messageStats);
+
+    strcpy(messageStats, "Sampler reads ");
+    utoa(samplerStatus.reads, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " defer ");
+    utoa(samplerStatus.deferred, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " overrun ");
+    utoa(samplerStatus.overruns, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " drop ");
+    utoa(samplerStatus.dropped, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " err ");
+    utoa(samplerStatus.errors, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " tout ");
+    utoa(samplerStatus.timeouts, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, "\r\n");
+    APP_telemetrySend((uint8_t *)messageStats);
+}
+
+/**
+ * @brief Starts the adaptive sampling period at its shortest and opens the first duty cycle window.
+ * @retval None
+ */
+void APP_rateInit(void)
+{
+    API_ADAPTIVE_Init(&APP_ADAPTIVE_CONFIG);
+    rateWindowStartMs = HAL_GetTick();
+    rateWindowReads = 0;
+}
+
+/**
+ * @brief Feeds a filtered sample and the distances to the alarm limits to the adaptive period. When the period
+ *        changes, retimes the sampler and rescales the filter stages to it.
+ *        Subscribed after the alarms, so the limits are those just evaluated.
+ * @param message: BUS_TOPIC_SAMPLE message.
  * @retval None
  */
-void APP_uartPrepareSensorTempHum(char *message_tem, char *message_hum)
+void APP_rateUpdate(const busMessage_t *message)
 {
-    APP_uartPrepareData((float)bme280_temperature, message_tem, "Temperature: ", "C");
-    APP_uartPrepareData((float)bme280_humidity, message_hum, "Humidity: ", "%");
+    const busSample_t *sample = &message->sample;
+    adaptiveInput_t inputs[ADAPTIVE_CHANNEL_COUNT] = {
+        [ADAPTIVE_CHANNEL_TEMPERATURE] = {
+            .value = sample->temperature,
+            .margin = API_ALARM_GetMargin(ALARM_CHANNEL_TEMPERATURE, sample->temperature),
+        },
+        [ADAPTIVE_CHANNEL_HUMIDITY] = {
+            .value = sample->humidity,
+            .margin = API_ALARM_GetMargin(ALARM_CHANNEL_HUMIDITY, sample->humidity),
+        },
+    };
+    uint32_t previousUs = API_ADAPTIVE_GetStatus().periodUs;
+    uint32_t periodUs = API_ADAPTIVE_Update(inputs, message->tick);
+
+    if (periodUs == previousUs)
+    {
+        return;
+    }
+
+    if (samplerRunning)
+    {
+        API_SAMPLER_SetPeriod(periodUs);
+    }
+
+    filterConfig_t filterConfig = APP_rateFilterConfig(periodUs);
+    API_FILTER_Reconfigure(&tempFilter, &filterConfig);
+    API_FILTER_Reconfigure(&humFilter, &filterConfig);
+}
+
+/**
+ * @brief Scales the filter stages to a sampling period. Each doubling of the period from the shortest halves the
+ *        decimation, once it is gone the EMA time constant, and last narrows the median to APP_FILTER_MEDIAN_SLOW:
+ *        outputs stay APP_FILTER_DECIMATION x SAMPLER_PERIOD_US apart as long as possible, with about the same lag.
+ * @param periodUs: Sampling period.
+ * @retval filterConfig_t: Filter configuration for the period.
+ */
+filterConfig_t APP_rateFilterConfig(uint32_t periodUs)
+{
+    filterConfig_t config = APP_FILTER_CONFIG;
+
+    for (uint32_t ratio = periodUs / APP_RATE_MIN_PERIOD_US; ratio > 1U; ratio >>= 1)
+    {
+        if (config.decimation > 1U)
+        {
+            config.decimation >>= 1;
+        }
+        else if (config.emaShift > 0U)
+        {
+            config.emaShift--;
+        }
+        else
+        {
+            config.medianWindow = APP_FILTER_MEDIAN_SLOW;
+        }
+    }
+
+    return config;
 }
 
 /**
- * @brief Sends the temperature and humidity data over UART.
- * @param message_1: The formatted temperature message to send.
- * @param message_2: The formatted humidity message to send.
+ * @brief Sends the adaptive period and the sensor load since the last diagnostics lines:
+ *        "Rate period n ms up n down n duty n.nn% spi n B/min". The duty cycle is the share of the reads the
+ *        shortest period would have taken; every read is one SAMPLER_FRAME_SIZE burst on SPI1.
  * @retval None
  */
-void APP_uartDisplaySensorData(char *message_1, char *message_2)
+void APP_uartSendRateStats(void)
 {
-    uartSendString((uint8_t *)message_1);
-    uartSendString((uint8_t *)message_2);
+    adaptiveStatus_t rate = API_ADAPTIVE_GetStatus();
+    uint32_t now = HAL_GetTick();
+    uint32_t elapsedMs = now - rateWindowStartMs;
+
+    if (elapsedMs == 0U)
+    {
+        return;
+    }
+
+    float dutyPercent = (float)rateWindowReads * APP_RATE_MIN_PERIOD_US * PERCENT / ((float)elapsedMs * US_PER_MS);
+    uint32_t bytesPerMinute = (uint32_t)((uint64_t)rateWindowReads * SAMPLER_FRAME_SIZE * MS_PER_MINUTE / elapsedMs);
+
+    strcpy(messageStats, "Rate period ");
+    utoa(rate.periodUs / US_PER_MS, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " ms up ");
+    utoa(rate.speedUps, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " down ");
+    utoa(rate.backOffs, messageStats + strlen(messageStats), DECIMAL);
+    APP_uartAppendFixed(messageStats, " duty ", dutyPercent);
+    strcat(messageStats, "% spi ");
+    utoa(bytesPerMinute, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " B/min\r\n");
+    APP_telemetrySend((uint8_t *)messageStats);
+
+    rateWindowStartMs = now;
+    rateWindowReads = 0;
+}
+
+/**
+ * @brief Sends the pool and C library heap usage: "Mem msg high/capacity heap bytes fail n".
+ *        The line is built in a message pool block.
+ * @retval None
+ */
+void APP_uartSendMemStats(void)
+{
+    static const char *const poolTags[MEM_POOL_COUNT] = {" msg "};
+    char *line = API_MEM_PoolAlloc(MEM_POOL_MESSAGE);
+    memStats_t stats;
+    uint32_t failures = 0U;
+
+    if (line == NULL)
+    {
+        return;
+    }
+
+    strcpy(line, "Mem");
+
+    for (memPool_t pool = 0; pool < MEM_POOL_COUNT; pool++)
+    {
+        API_MEM_GetPoolStats(pool, &stats);
+        failures += stats.failures;
+        strcat(line, poolTags[pool]);
+        utoa(stats.highWater, line + strlen(line), DECIMAL);
+        strcat(line, "/");
+        utoa(stats.capacity, line + strlen(line), DECIMAL);
+    }
+
+    API_MEM_GetHeapStats(&stats);
+    failures += stats.failures;
+    strcat(line, " heap ");
+    utoa(stats.used, line + strlen(line), DECIMAL);
+    strcat(line, " fail ");
+    utoa(failures, line + strlen(line), DECIMAL);
+    strcat(line, "\r\n");
+    APP_telemetrySend((uint8_t *)line);
+
+    API_MEM_PoolFree(MEM_POOL_MESSAGE, line);
+}
+
+/**
+ * @brief Sends the measured main stack high-water mark against the linker budget: "Stack peak used/budget B",
+ *        to compare with the static worst case reported by Tools/stack_budget.py at build time.
+ * @retval None
+ */
+void APP_uartSendStackStats(void)
+{
+    stackUsage_t usage;
+    bool withinBudget = API_STACK_GetUsage(&usage);
+
+    strcpy(message_tem, "Stack peak ");
+    utoa(usage.peak, message_tem + strlen(message_tem), DECIMAL);
+    strcat(message_tem, "/");
+    utoa(usage.budget, message_tem + strlen(message_tem), DECIMAL);
+    strcat(message_tem, withinBudget ? " B\r\n" : " B OVER BUDGET\r\n");
+    APP_telemetrySend((uint8_t *)message_tem);
 }
 
 /**
  * @brief Prepares the temperature and humidity data for LCD display.
+ * @param sample: Filtered sample.
  * @retval None
  */
-void APP_lcdPrepareSensorData(void)
+void APP_lcdPrepareSensorData(const busSample_t *sample)
 {
-    itoa((int)bme280_temperature, lcdTempStr, DECIMAL);
+    itoa((int)sample->temperature, lcdTempStr, DECIMAL);
     strcat(lcdTempStr, ".");
-    itoa((int)((bme280_temperature - (int)bme280_temperature) * FRACTIONAL_MULTIPLIER), lcdTempStr + strlen(lcdTempStr), DECIMAL);
+    itoa((int)((sample->temperature - (int)sample->temperature) * FRACTIONAL_MULTIPLIER), lcdTempStr + strlen(lcdTempStr), DECIMAL);
 
-    itoa((int)bme280_humidity, lcdHumStr, DECIMAL);
+    itoa((int)sample->humidity, lcdHumStr, DECIMAL);
     strcat(lcdHumStr, ".");
-    itoa((int)((bme280_humidity - (int)bme280_humidity) * FRACTIONAL_MULTIPLIER), lcdHumStr + strlen(lcdHumStr), DECIMAL);
+    itoa((int)((sample->humidity - (int)sample->humidity) * FRACTIONAL_MULTIPLIER), lcdHumStr + strlen(lcdHumStr), DECIMAL);
 }
 
 /**
@@ -124,159 +972,505 @@ void APP_lcdAlarm(void)
 }
 
 /**
- * @brief Displays the current time on the LCD.
+ * @brief Displays the time read on the last time message on the LCD.
  * @retval None
  */
 void APP_lcdDisplayClock(void)
 {
     API_LCD_SetCursorLine(APP_CLOCK_CURSOR_POS, APP_LCD_LINE_1);
-    API_LCD_SendBCDData(sTime.Hours);
+    API_LCD_SendBCDData(clockTime.Hours);
     API_LCD_SendData(':');
-    API_LCD_SendBCDData(sTime.Minutes);
+    API_LCD_SendBCDData(clockTime.Minutes);
     API_LCD_SendData(':');
-    API_LCD_SendBCDData(sTime.Seconds);
+    API_LCD_SendBCDData(clockTime.Seconds);
 }
 
 /**
- * @brief Displays the current date on the LCD.
+ * @brief Displays the date read on the last time message on the LCD.
  * @retval None
  */
 void APP_lcdDisplayDate(void)
 {
     API_LCD_SetCursorLine(APP_CLOCK_CURSOR_POS, APP_LCD_LINE_2);
-    API_LCD_SendBCDData(sDate.Date);
+    API_LCD_SendBCDData(clockDate.Date);
     API_LCD_SendData('/');
-    API_LCD_SendBCDData(sDate.Month);
+    API_LCD_SendBCDData(clockDate.Month);
     API_LCD_SendData('/');
-    API_LCD_SendBCDData(sDate.Year);
+    API_LCD_SendBCDData(clockDate.Year);
 }
 
 /**
- * @brief Updates the FSM state and triggers the appropriate actions and displays based on the current state.
+ * @brief Sends an alarm transition over UART and updates the LCD alarm area.
+ *        The LCD shows the alarm banner while any channel is above ALARM_SEVERITY_NONE, the date otherwise.
+ * @param message: BUS_TOPIC_ALARM message, the committed transition.
  * @retval None
  */
-void APP_FSM_update(void)
+void APP_alarmReport(const busMessage_t *message)
 {
-    memset(messageFsm, ZEROVAL, sizeof(messageFsm)); // Clear the FSM message buffer
+    const alarmEvent_t *event = &message->alarm;
+
+    memset(messageAlarm, ZEROVAL, sizeof(messageAlarm)); // Clear the alarm message buffer
 
-    switch (currentTempState)
+    strcpy(messageAlarm, APP_ALARM_CHANNEL_TAGS[event->channel]);
+    strcat(messageAlarm, APP_ALARM_SEVERITY_TAGS[event->current]);
+    if (event->rateAlarm)
     {
-    case TEMP_NORMAL:
-        if (bme280_temperature > THRESHOLD_TEMP) // Transition to ALARM state
-        {
-            currentTempState = TEMP_ALARM;
+        strcat(messageAlarm, " Rate");
+    }
+    strcat(messageAlarm, " State.\r\n");
+    APP_telemetrySend((uint8_t *)messageAlarm);
 
-            strcpy(messageFsm, "Temperature Alarm State.\r\n");
-            uartSendString((uint8_t *)messageFsm);
-            APP_lcdAlarm();
-        }
-        else // Remain in NORMAL state
+    // Follow the state change with fresh values on every channel
+    API_REPORT_ForceNext();
+
+    if (API_ALARM_GetHighestSeverity() != ALARM_SEVERITY_NONE)
+    {
+        APP_lcdAlarm();
+    }
+    else
+    {
+        APP_lcdDisplayDate();
+    }
+}
+
+/**
+ * @brief Feeds a filtered sample to the alarm engine and publishes the committed transitions on BUS_TOPIC_ALARM.
+ * @param message: BUS_TOPIC_SAMPLE message.
+ * @retval None
+ */
+void APP_alarmUpdate(const busMessage_t *message)
+{
+    busMessage_t alarm = {.tick = message->tick};
+
+    if (API_ALARM_Update(ALARM_CHANNEL_TEMPERATURE, message->sample.temperature, message->tick, &alarm.alarm))
+    {
+        API_BUS_Publish(BUS_TOPIC_ALARM, &alarm);
+    }
+
+    if (API_ALARM_Update(ALARM_CHANNEL_HUMIDITY, message->sample.humidity, message->tick, &alarm.alarm))
+    {
+        API_BUS_Publish(BUS_TOPIC_ALARM, &alarm);
+    }
+}
+
+/**
+ * @brief Reads the calendar and re-renders it on the LCD on each second published by the RTC.
+ * @param message: BUS_TOPIC_TIME message.
+ * @retval None
+ */
+void APP_lcdUpdateTime(const busMessage_t *message)
+{
+    (void)message;
+
+    ClockGetTimeDate(&clockTime, &clockDate);
+    APP_lcdDisplayClock();
+
+    // The date shares the alarm area, refresh it only while no alarm banner is shown
+    if (API_ALARM_GetHighestSeverity() == ALARM_SEVERITY_NONE)
+    {
+        APP_lcdDisplayDate();
+    }
+}
+
+/**
+ * @brief Reads the RTC time in ms, sub-seconds included, and the SysTick count at the same moment.
+ * @retval None
+ */
+void APP_clockAnchor(void)
+{
+    anchorTimeMs = API_TIMESTAMP_NowMs();
+    anchorTick = HAL_GetTick();
+}
+
+/**
+ * @brief Refreshes the tick to RTC time anchor on each second published by the RTC, so the SysTick drift
+ *        against the RTC never builds up over more than a second or so.
+ * @param message: BUS_TOPIC_TIME message.
+ * @retval None
+ */
+void APP_clockUpdateAnchor(const busMessage_t *message)
+{
+    (void)message;
+
+    APP_clockAnchor();
+}
+
+/**
+ * @brief Converts a SysTick time to RTC time through the last anchor. The tick may be older than the anchor.
+ * @param tick: Time in ms, HAL_GetTick.
+ * @retval timestampMs_t: RTC time in ms since the epoch origin.
+ */
+timestampMs_t APP_clockTickToTime(uint32_t tick)
+{
+    return anchorTimeMs + (timestampMs_t)(int64_t)(int32_t)(tick - anchorTick);
+}
+
+/**
+ * @brief Compensates the reads taken by the timed sampler, at most BUS_QUEUE_DEPTH of them, and publishes each on
+ *        BUS_TOPIC_RAW_SAMPLE with its own read time, a faulty one too. Until the sampler runs, reads the sensor
+ *        instead, once the adaptive period has elapsed since the last read.
+ * @retval bool: true if more reads are waiting: dispatch the bus before the next call.
+ */
+bool APP_publishSensorData(void)
+{
+    samplerRead_t read;
+
+    if (!samplerRunning)
+    {
+        uint32_t now = HAL_GetTick();
+
+        if ((now - lastPollMs) < API_ADAPTIVE_GetStatus().periodUs / US_PER_MS)
         {
-            strcpy(messageFsm, "Temperature Normal State.\r\n");
-            uartSendString((uint8_t *)messageFsm);
-            APP_lcdDisplayDate();
+            return false;
         }
-        break;
+        lastPollMs = now;
+        rateWindowReads++;
 
-    case TEMP_ALARM:
-        if (bme280_temperature <= THRESHOLD_TEMP) // Transition to NORMAL state
-        {
-            currentTempState = TEMP_NORMAL;
+        APP_publishRawSample(now, API_BME280_ReadAndProcess());
+        return false;
+    }
 
-            strcpy(messageFsm, "Temperature Normal State.\r\n");
-            uartSendString((uint8_t *)messageFsm);
-            APP_lcdDisplayDate();
-        }
-        else // Remain in ALARM state
+    for (uint32_t published = 0; published < BUS_QUEUE_DEPTH; published++)
+    {
+        if (!API_SAMPLER_Read(&read))
         {
-            strcpy(messageFsm, "Temperature Alarm State.\r\n");
-            uartSendString((uint8_t *)messageFsm);
-            APP_lcdAlarm();
+            return false;
         }
-        break;
+        rateWindowReads++;
 
-    default:
-    	APP_FsmErrorHandler();
-        break;
+        APP_publishRawSample(read.tick, API_BME280_ProcessBurst(read.data));
     }
+
+    return true;
 }
 
 /**
- * @brief Updates the current time and displays it on the LCD.
+ * @brief Has the fault manager judge a read and publishes it on BUS_TOPIC_RAW_SAMPLE: the sample it compensated,
+ *        or its fault, stamped with the RTC time of the read.
+ * @param tick: Read time in ms.
+ * @param readStatus: Result of the read.
  * @retval None
  */
-void APP_lcdUpdateTime(void)
+void APP_publishRawSample(uint32_t tick, bme280Status_t readStatus)
 {
-    ClockUpdateTimeDate();
-    APP_lcdDisplayClock();
+    bme280Sample_t sample;
+    busMessage_t message = {.tick = tick};
+
+    message.raw.time = APP_clockTickToTime(tick);
+    API_BME280_GetSample(&sample);
+    message.raw.fault = API_FAULT_CheckRead(readStatus, &sample, tick);
+    if (message.raw.fault == FAULT_TYPE_NONE)
+    {
+        message.raw.temperature = sample.temperature;
+        message.raw.humidity = sample.humidity;
+    }
+
+    API_BUS_Publish(BUS_TOPIC_RAW_SAMPLE, &message);
 }
 
 /**
- * @brief Updates the sensor data by reading from the BME280 sensor.
+ * @brief Runs a raw sample through the fixed-point filter stage and publishes the output on BUS_TOPIC_SAMPLE.
+ *        One filtered output is produced every APP_FILTER_DECIMATION raw samples, stamped with the last one's time.
+ *        Invalid samples are left out: the outputs around a fault come from fewer samples.
+ * @param message: BUS_TOPIC_RAW_SAMPLE message.
  * @retval None
  */
-void APP_updateSensorData(void)
+void APP_filterSample(const busMessage_t *message)
 {
-    API_BME280_ReadAndProcess();
+    int32_t temperature;
+    int32_t humidity;
+
+    if (message->raw.fault != FAULT_TYPE_NONE)
+    {
+        return;
+    }
+
+    bool tempReady = API_FILTER_Push(&tempFilter, message->raw.temperature, &temperature);
+    bool humReady = API_FILTER_Push(&humFilter, (int32_t)message->raw.humidity, &humidity);
+
+    // Both channels share the same configuration and input cadence, so they complete blocks together
+    if (!tempReady || !humReady)
+    {
+        return;
+    }
+
+    busMessage_t filtered = {
+        .tick = message->tick,
+        .sample = {
+            .temperature = (float)temperature / TEMPERATURE_SCALE_FACTOR,
+            .humidity = (float)humidity / HUMIDITY_SCALE_FACTOR,
+            .time = message->raw.time,
+        },
+    };
+    API_BUS_Publish(BUS_TOPIC_SAMPLE, &filtered);
 }
 
 /**
  * @brief Prepares and displays the sensor data on the LCD.
+ * @param message: BUS_TOPIC_SAMPLE message.
  * @retval None
  */
-void APP_prepareAndDisplaySensorData(void)
+void APP_prepareAndDisplaySensorData(const busMessage_t *message)
 {
-    APP_lcdPrepareSensorData();
+    APP_lcdPrepareSensorData(&message->sample);
     APP_lcdDisplaySensorData();
 }
 
 /**
- * @brief Prepares and sends the sensor data over UART.
+ * @brief Prepares and sends the sensor data over UART, by exception.
+ *        A channel is sent only when it moved past its deadband, when its heartbeat is due or after a
+ *        state-change event, so the link load follows signal activity instead of the loop rate.
+ *        With APP_UART_COMPRESSED every sample goes into delta-encoded blocks instead of text lines.
+ * @param message: BUS_TOPIC_SAMPLE message.
  * @retval None
  */
-void APP_prepareAndSendUARTData(void)
+void APP_prepareAndSendUARTData(const busMessage_t *message)
 {
-    memset(message_tem, ZEROVAL, sizeof(message_tem)); // I clean the message buffer before populating it again with the data prepare function that's next.
-    memset(message_hum, ZEROVAL, sizeof(message_hum));
+    const busSample_t *sample = &message->sample;
+    uint32_t now = message->tick;
+    reportReason_t tempReason = API_REPORT_Evaluate(REPORT_CHANNEL_TEMPERATURE, sample->temperature, now);
+    reportReason_t humReason = API_REPORT_Evaluate(REPORT_CHANNEL_HUMIDITY, sample->humidity, now);
 
-    APP_uartPrepareSensorTempHum(message_tem, message_hum);
-    APP_uartDisplaySensorData(message_tem, message_hum);
+    if (APP_UART_COMPRESSED)
+    {
+        APP_uartSendCompressed(sample, now);
+    }
+    else
+    {
+        APP_uartSendText(sample, tempReason, humReason);
+
+        if (APP_DERIVED_TELEMETRY && (tempReason != REPORT_SUPPRESSED || humReason != REPORT_SUPPRESSED))
+        {
+            APP_uartSendDerived(message);
+        }
+    }
 }
 
 /**
- * @brief Handles invalid case in APP FSM.
+ * @brief Sends the diagnostics lines: report counters, rolling statistics, memory, stack, SD card, USB, UDP, bus,
+ *        sampler, rate and fault. Runs every APP_REPORT_HEARTBEAT_MS from APP_update, on its own timer, so the lines
+ *        keep coming when every sample is reported (APP_REPORT_BY_EXCEPTION 0) or when events keep resetting the
+ *        channel heartbeats.
+ * @retval None
  */
-static void APP_FsmErrorHandler()
+void APP_uartSendDiagnostics(void)
 {
-    while (1)
+    APP_uartSendReportCounters();
+    APP_uartSendStats();
+    APP_uartSendMemStats();
+    APP_uartSendStackStats();
+    APP_uartSendSdlogStats();
+    APP_uartSendUsbStats();
+    APP_uartSendUdpStats();
+    APP_uartSendBusStats();
+    APP_uartSendSamplerStats();
+    APP_uartSendRateStats();
+    APP_uartSendFaultStats();
+}
+
+/**
+ * @brief Sends the temperature and humidity lines of the channels that are not suppressed.
+ * @param sample: Filtered sample.
+ * @param tempReason: Report decision for the temperature channel.
+ * @param humReason: Report decision for the humidity channel.
+ * @retval None
+ */
+void APP_uartSendText(const busSample_t *sample, reportReason_t tempReason, reportReason_t humReason)
+{
+    if (tempReason != REPORT_SUPPRESSED)
+    {
+        memset(message_tem, ZEROVAL, sizeof(message_tem)); // I clean the message buffer before populating it again with the data prepare function that's next.
+        APP_uartPrepareData(sample->temperature, message_tem, "Temperature: ", "C");
+        APP_telemetrySend((uint8_t *)message_tem);
+    }
+
+    if (humReason != REPORT_SUPPRESSED)
+    {
+        memset(message_hum, ZEROVAL, sizeof(message_hum));
+        APP_uartPrepareData(sample->humidity, message_hum, "Humidity: ", "%");
+        APP_telemetrySend((uint8_t *)message_hum);
+    }
+}
+
+/**
+ * @brief Sends the channels derived from a filtered sample: "Derived dew n.nn C abs n.nn g/m3 heat n.nn C".
+ *        The sample goes back to the sensor's fixed point; API_DERIVED computes each channel on this request only.
+ * @param message: BUS_TOPIC_SAMPLE message.
+ * @retval None
+ */
+void APP_uartSendDerived(const busMessage_t *message)
+{
+    derivedSample_t sample = {
+        .sequence = message->sequence,
+        .temperature = (int32_t)lroundf(message->sample.temperature * TEMPERATURE_SCALE_FACTOR),
+        .humidity = (uint32_t)lroundf(message->sample.humidity * HUMIDITY_SCALE_FACTOR),
+    };
+    int32_t dewPoint;
+    int32_t absoluteHumidity;
+    int32_t heatIndex;
+
+    if (!API_DERIVED_Get(&sample, DERIVED_CHANNEL_DEW_POINT, &dewPoint) ||
+        !API_DERIVED_Get(&sample, DERIVED_CHANNEL_ABSOLUTE_HUMIDITY, &absoluteHumidity) ||
+        !API_DERIVED_Get(&sample, DERIVED_CHANNEL_HEAT_INDEX, &heatIndex))
     {
+        return;
     }
+
+    messageStats[0] = '\0';
+    APP_uartAppendHundredths(messageStats, "Derived dew ", dewPoint);
+    APP_uartAppendHundredths(messageStats, " C abs ", absoluteHumidity);
+    APP_uartAppendHundredths(messageStats, " g/m3 heat ", heatIndex);
+    strcat(messageStats, " C\r\n");
+    APP_telemetrySend((uint8_t *)messageStats);
+}
+
+/**
+ * @brief Starts the sensor fault manager from the boot initialisation. A sensor that failed it is reported by the
+ *        first APP_faultUpdate, once the UART is up.
+ * @param bootStatus: Result of API_BME280_Init.
+ * @retval None
+ */
+void APP_faultInit(bme280Status_t bootStatus)
+{
+    API_FAULT_Init(bootStatus, HAL_GetTick());
+    sensorFaulted = false;
+}
+
+/**
+ * @brief Reports the sensor fault transitions: "Sensor fault <type>: recovering" when the sensor stops giving
+ *        valid samples, "Sensor recovered after n ms" once verified again. LED3 is lit while faulted.
+ * @retval None
+ */
+void APP_faultUpdate(void)
+{
+    faultStatus_t fault = API_FAULT_GetStatus();
+    bool faulted = (fault.state != FAULT_STATE_OK);
+    uint32_t now = HAL_GetTick();
+
+    if (faulted == sensorFaulted)
+    {
+        return;
+    }
+    sensorFaulted = faulted;
+
+    // Set from the state, not toggled: the LCD error blink also drives LED3 and may leave it either way
+    if (faulted)
+    {
+        BSP_LED_On(LED3);
+    }
+    else
+    {
+        BSP_LED_Off(LED3);
+    }
+
+    if (faulted)
+    {
+        faultStartMs = now;
+        strcpy(messageStats, "Sensor fault ");
+        strcat(messageStats, APP_FAULT_TAGS[fault.lastFault]);
+        strcat(messageStats, ": recovering\r\n");
+    }
+    else
+    {
+        strcpy(messageStats, "Sensor recovered after ");
+        utoa(now - faultStartMs, messageStats + strlen(messageStats), DECIMAL);
+        strcat(messageStats, " ms\r\n");
+    }
+    APP_telemetrySend((uint8_t *)messageStats);
+}
+
+/**
+ * @brief Sends the sensor fault counters: "Fault bus n id n stuck n range n resets n recovered n", the faulty reads
+ *        per type, the soft resets and the recoveries. Nothing is sent while no fault ever occurred.
+ * @retval None
+ */
+void APP_uartSendFaultStats(void)
+{
+    faultStatus_t fault = API_FAULT_GetStatus();
+
+    if (fault.reads[FAULT_TYPE_BUS] + fault.reads[FAULT_TYPE_ID] + fault.reads[FAULT_TYPE_STUCK] +
+            fault.reads[FAULT_TYPE_RANGE] + fault.resets == 0U)
+    {
+        return;
+    }
+
+    strcpy(messageStats, "Fault bus ");
+    utoa(fault.reads[FAULT_TYPE_BUS], messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " id ");
+    utoa(fault.reads[FAULT_TYPE_ID], messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " stuck ");
+    utoa(fault.reads[FAULT_TYPE_STUCK], messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " range ");
+    utoa(fault.reads[FAULT_TYPE_RANGE], messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " resets ");
+    utoa(fault.resets, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, " recovered ");
+    utoa(fault.recoveries, messageStats + strlen(messageStats), DECIMAL);
+    strcat(messageStats, "\r\n");
+    APP_telemetrySend((uint8_t *)messageStats);
 }
 
 /* Public Function Definitions ----------------------------------------------- */
 
 /**
- * @brief Initializes all necessary components for the application, including the clock, FSM, BME280 sensor, UART, and LCD.
+ * @brief Initializes all necessary components for the application, including the bus, the clock, alarm engine, BME280 sensor and its fault manager, UART, USB, Ethernet, LCD, the adaptive period and the timed sampler.
+ *        Memory is sealed last: from then on only the fixed-block pools allocate, and heap growth is refused.
  * @retval None
  */
 void APP_init(void)
 {
+    API_MEM_Init();
+    APP_busInit();
     ClockInit();
-    APP_FSM_init();
-    API_BME280_Init();
+    APP_clockAnchor();
+    APP_alarmInit();
+    APP_reportInit();
+    APP_codecInit();
+    APP_statsInit();
+    API_DERIVED_Init();
+    API_FILTER_Init(&tempFilter, &APP_FILTER_CONFIG);
+    API_FILTER_Init(&humFilter, &APP_FILTER_CONFIG);
+    APP_faultInit(API_BME280_Init());
     uartInit();
+    API_USBCDC_Init();
+    APP_udpInit();
+    APP_logInit();
+    APP_sdlogInit();
     API_LCD_Initialize();
+    APP_rateInit();
+    APP_samplerInit();
+    API_MEM_Seal();
 }
 
 /**
- * @brief Main update function that handles sensor data acquisition, LCD updates, sensor data display, and FSM updates.
+ * @brief Main update function: publishes the sensor reads and dispatches the bus to the consumers.
+ *        The sensor is read by the timer-triggered sampler at the adaptive period, whatever the time spent here;
+ *        each call publishes the reads taken since the last one. Display, telemetry and alarms run at the decimated
+ *        filter output rate, the clock on each second published by the RTC wakeup interrupt.
+ *        The SD card log advances by at most one card operation per call, the UDP publisher takes back the sent frames
+ *        and the UART runs the line rate commands received since the last call. A sensor recovery advances by one step.
+ *        The diagnostics lines go out every APP_REPORT_HEARTBEAT_MS.
  * @retval None
  */
 void APP_update(void)
 {
-    APP_updateSensorData();
-    APP_lcdUpdateTime();
-    APP_prepareAndDisplaySensorData();
-    APP_prepareAndSendUARTData();
-    APP_FSM_update();
+    bool readsWaiting;
+
+    // A backlog of reads after a long pass is published one queue depth at a time, each batch dispatched
+    do
+    {
+        readsWaiting = APP_publishSensorData();
+        API_BUS_Dispatch(HAL_GetTick());
+    } while (readsWaiting);
+
+    API_FAULT_Process(HAL_GetTick());
+    APP_faultUpdate();
+    API_SDLOG_Process();
+    API_UDP_Process(HAL_GetTick());
+    uartProcess(HAL_GetTick());
+
+    if (delayRead(&diagnosticsDelay))
+    {
+        APP_uartSendDiagnostics();
+    }
 }
@@ -1,37 +1,38 @@
 #include "API_bme280.h"
-
-/* Global public variables ----------------------------------------------------------*/
-
-// Declare global variables for temperature and humidity, we will use them later in the finite-state machine app code.
-float bme280_temperature;
-float bme280_humidity;
+#include "API_section.h"
 
 /* Private variables ----------------------------------------------------------*/
 
-// Calibration variables
-static uint16_t dig_T1;
-static int16_t dig_T2, dig_T3;
-static uint8_t dig_H1;
-static int16_t dig_H2;
-static uint8_t dig_H3;
-static int16_t dig_H4, dig_H5;
-static int8_t dig_H6;
+// Last compensated sample, published by the application through API_BME280_GetSample
+static bme280Sample_t bme280_sample;
+
+// Calibration variables, read on every compensation: CPU-only, kept in CCM
+API_CCM_BSS static uint16_t dig_T1;
+API_CCM_BSS static int16_t dig_T2, dig_T3;
+API_CCM_BSS static uint8_t dig_H1;
+API_CCM_BSS static int16_t dig_H2;
+API_CCM_BSS static uint8_t dig_H3;
+API_CCM_BSS static int16_t dig_H4, dig_H5;
+API_CCM_BSS static int8_t dig_H6;
 
 // Type definitions for signed and unsigned 32-bit integers used in compensation calculations
 typedef int32_t BME280_S32_t;
 typedef uint32_t BME280_U32_t;
 
-static BME280_S32_t temp_adc, hum_adc;
-static BME280_S32_t t_fine;
+API_CCM_BSS static BME280_S32_t temp_adc, hum_adc;
+API_CCM_BSS static BME280_S32_t t_fine;
 
 /* Private Function Prototypes ---------------------------------------------- */
 static uint16_t combineBytes(uint8_t msb, uint8_t lsb);
 static uint8_t extractBits(uint8_t value, uint8_t mask, uint8_t shift);
-static void errorLedSignal(void);
+#ifdef DEBUG_BME280
 static void okLedSignal(void);
-static void calibrationParams(void);
+#endif
+static bool calibrationParams(void);
 static BME280_S32_t BME280_compensate_T_int32(BME280_S32_t adc_T);
 static BME280_U32_t BME280_compensate_H_int32(BME280_S32_t adc_H);
+static bool isIdleBus(const uint8_t *data, uint16_t size);
+static bme280Status_t compensateBurst(const uint8_t *sensorDataBuffer);
 
 /* Private Function Definitions --------------------------------------------- */
 
@@ -39,8 +40,9 @@ static BME280_U32_t BME280_compensate_H_int32(BME280_S32_t adc_H);
  * C will implicitly cast the 64-bit value to an 8-bit value (uint8_t) because the function parameters are explicitly
  * defined as uint8_t. This casting truncates the higher bits, leading to unexpected results if the higher bits of 64-bit
  * value contain critical data for the system.
- * To avoid this potential problem, I added control input logic in combineBytes, extractBits, BME280_compensate_T_int32 and
- * BME280_compensate_H_int32 functions.*/
+ * The parameter types bound the values, so nothing is checked at run time: a check there could only stop the system.
+ * What a faulty sensor can really return, a skipped measurement or an implausible result, is checked on the burst
+ * by compensateBurst and reported to the caller.*/
 
 /**
  * @brief  Combines two bytes into a 16-bit integer.
@@ -50,11 +52,6 @@ static BME280_U32_t BME280_compensate_H_int32(BME280_S32_t adc_H);
  */
 static uint16_t combineBytes(uint8_t msb, uint8_t lsb)
 {
-  // Safety check to ensure that inputs are 8 bits wide and are not being potentially truncated if they were bigger than uint8_t. .
-  if (msb > 0xFF || lsb > 0xFF)
-  {
-    API_BME280_ErrorHandler();
-  }
   return ((uint16_t)msb << 8) | lsb;
 }
 
@@ -67,28 +64,10 @@ static uint16_t combineBytes(uint8_t msb, uint8_t lsb)
  */
 static uint8_t extractBits(uint8_t value, uint8_t mask, uint8_t shift)
 {
-  // Safety check to ensure that inputs are 8 bits wide and are not being potentially truncated if they were bigger than uint8_t. .
-  if (value > 0xFF || mask > 0xFF || shift > 7)
-  {
-    API_BME280_ErrorHandler();
-  }
   return (value & mask) >> shift;
 }
 
-/**
- * @brief  Flashes LED to signal an error in BME280 operations.
- * @param  None
- * @retval None
- */
-static void errorLedSignal(void)
-{
-  for (int i = 0; i <= NumErrorRxBlinks; i++)
-  {
-    BME280_HAL_Blink(LED3); // Sensor error.
-    BME280_HAL_Delay(BME280_HAL_DELAY);
-  }
-}
-
+#ifdef DEBUG_BME280
 /**
  * @brief  Flashes LED to signal a successful sensor data reception.
  * @param  None
@@ -102,14 +81,15 @@ static void okLedSignal(void)
     BME280_HAL_Delay(BME280_HAL_DELAY);
   }
 }
+#endif
 
 /**
  * @brief  Reads the calibration parameters from the BME280 sensor (4.2.2 Trimming parameter readout).
  *         Each compensation word is a 16-bit signed or unsigned integer value stored in two’s complement.
  * @param  None
- * @retval None
+ * @retval bool: false if an SPI read failed, the previous parameters are kept.
  */
-static void calibrationParams(void)
+static bool calibrationParams(void)
 {
   uint8_t calibDataBuffer1[BME280_CALIBDATA_BLOCK1_SIZE];
   uint8_t calibDataBuffer2[BME280_CALIBDATA_BLOCK2_SIZE];
@@ -117,11 +97,17 @@ static void calibrationParams(void)
   /* Read the first block of calibration data from the sensor, storing the data read from memory addresses 0x88 to 0xA1.
    * This block contains the calibration values for temperature and pressure, covering a 26-byte range.
    * Although the pressure values won't be used, they will be extracted anyways.*/
-  BME280_HAL_SPI_Read(BME280_CALIB_00_ADDR, calibDataBuffer1, BME280_CALIBDATA_BLOCK1_SIZE);
+  if (!BME280_HAL_SPI_Read(BME280_CALIB_00_ADDR, calibDataBuffer1, BME280_CALIBDATA_BLOCK1_SIZE))
+  {
+    return false;
+  }
 
   /* Read the second block of calibration data from the sensor, storing the data read from memory addresses 0x88 to 0xA1.
    * This block contains the calibration values for humidity, covering a 7-byte range.*/
-  BME280_HAL_SPI_Read(BME280_CALIB_26_ADDR, calibDataBuffer2, BME280_CALIBDATA_BLOCK2_SIZE);
+  if (!BME280_HAL_SPI_Read(BME280_CALIB_26_ADDR, calibDataBuffer2, BME280_CALIBDATA_BLOCK2_SIZE))
+  {
+    return false;
+  }
 
   // The next operations rely heavily on datasheet table 16: Compensation parameter storage, naming and data type.
 
@@ -144,11 +130,12 @@ static void calibrationParams(void)
 
   // Store the final humidity calibration value directly from the corresponding byte
   dig_H6 = calibDataBuffer2[DIG_H6_INDEX];
+
+  return true;
 }
 
 /**
  * @brief  Temperature compensation formula & function taken from datasheet (please check page 25/60 for reference).
- *         Added control input to avoid possible misuse of wider types as input.
  *         Returns temperature in DegC, resolution is 0.01 DegC. Output value of “5123” equals 51.23 DegC.
  *         t_fine carries fine temperature as global value for BME280_compensate_H_int32 function to process its return humidity value.
  * @param  BME280_S32_t adc_T: Raw ADC temperature value.
@@ -156,12 +143,6 @@ static void calibrationParams(void)
  */
 static BME280_S32_t BME280_compensate_T_int32(BME280_S32_t adc_T)
 {
-  // Ensure that adc_T is within the valid 20-bit range (since temperature is typically represented by a 20-bit value).
-  if (adc_T < 0 || adc_T > 0xFFFFF) // 20-bit range check
-  {
-    API_BME280_ErrorHandler();
-  }
-
   BME280_S32_t var1, var2, T;
   var1 = ((((adc_T >> 3) - ((BME280_S32_t)dig_T1 << 1))) * ((BME280_S32_t)dig_T2)) >> 11;
   var2 = (((((adc_T >> 4) - ((BME280_S32_t)dig_T1)) * ((adc_T >> 4) - ((BME280_S32_t)dig_T1))) >> 12) * ((BME280_S32_t)dig_T3)) >> 14;
@@ -172,7 +153,6 @@ static BME280_S32_t BME280_compensate_T_int32(BME280_S32_t adc_T)
 
 /**
  * @brief  Humidity compensation formula & function taken from datasheet (please check page 25/60 for reference).
- * 		   Added control input to avoid possible misuse of wider types as input.
  *         Returns humidity in %RH as unsigned 32-bit integer in Q22.10 format (22 integer and 10 fractional bits).
  *         For example, an output value of “47445” represents 47445/1024 = 46.333 %RH.
  * @param  BME280_S32_t adc_H: Raw ADC humidity value.
@@ -180,12 +160,6 @@ static BME280_S32_t BME280_compensate_T_int32(BME280_S32_t adc_T)
  */
 static BME280_U32_t BME280_compensate_H_int32(BME280_S32_t adc_H)
 {
-  // Ensure that adc_H is within the valid 16-bit range.
-  if (adc_H < 0 || adc_H > 0xFFFF)
-  {
-    API_BME280_ErrorHandler();
-  }
-
   BME280_S32_t v_x1_u32r;
   v_x1_u32r = (t_fine - ((BME280_S32_t)76800));
   v_x1_u32r = (((((adc_H << 14) - (((BME280_S32_t)dig_H4) << 20) - (((BME280_S32_t)dig_H5) * v_x1_u32r)) + ((BME280_S32_t)16384)) >> 15) * (((((((v_x1_u32r * ((BME280_S32_t)dig_H6)) >> 10) * (((v_x1_u32r * ((BME280_S32_t)dig_H3)) >> 11) + ((BME280_S32_t)32768))) >> 10) + ((BME280_S32_t)2097152)) * ((BME280_S32_t)dig_H2) + 8192) >> 14));
@@ -195,21 +169,120 @@ static BME280_U32_t BME280_compensate_H_int32(BME280_S32_t adc_H)
   return (BME280_U32_t)(v_x1_u32r >> 12);
 }
 
+/**
+ * @brief  Checks whether a read returned only the idle bus level: nothing drives MISO.
+ * @param  const uint8_t *data: Bytes read.
+ * @param  uint16_t size: Bytes.
+ * @retval bool: true if every byte is BME280_BUS_IDLE_LEVEL.
+ */
+static bool isIdleBus(const uint8_t *data, uint16_t size)
+{
+  for (uint16_t i = 0; i < size; i++)
+  {
+    if (data[i] != BME280_BUS_IDLE_LEVEL)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief  Combines the raw temperature and humidity of a burst read from PRESSURE_MSB_REG and compensates them.
+ *         The sample is kept only if it is plausible: a measurement was made and the temperature is within the
+ *         operating range. The humidity compensation saturates by itself.
+ * @param  const uint8_t *sensorDataBuffer: RAW_OUTPUT_DATA_SIZE bytes, 0xF7 to 0xFE.
+ * @retval bme280Status_t: BME280_OK, BME280_ERROR_BUS or BME280_ERROR_RANGE.
+ */
+static bme280Status_t compensateBurst(const uint8_t *sensorDataBuffer)
+{
+  BME280_S32_t temperature;
+
+  if (isIdleBus(sensorDataBuffer, RAW_OUTPUT_DATA_SIZE))
+  {
+    return BME280_ERROR_BUS;
+  }
+
+  // The BME280 output consists of the ADC output values that have to be compensated afterwards.
+
+  // Combine the bytes to form the 20-bit temperature value (temp_adc).
+  temp_adc = (sensorDataBuffer[TEMP_MSB_INDEX] << TEMP_MSB_SHIFT) |
+             (sensorDataBuffer[TEMP_LSB_INDEX] << TEMP_LSB_SHIFT) |
+             (sensorDataBuffer[TEMP_XLSB_INDEX] >> TEMP_XLSB_SHIFT);
+
+  // Combine the bytes to form the 16-bit humidity value (hum_adc).
+  hum_adc = (sensorDataBuffer[HUM_MSB_INDEX] << HUM_MSB_SHIFT) |
+            sensorDataBuffer[HUM_LSB_INDEX];
+
+  // A sensor reset since the configuration (brown-out, glitch on the supply) sleeps and keeps its reset values
+  if (temp_adc == BME280_TEMP_ADC_SKIPPED)
+  {
+    return BME280_ERROR_RANGE;
+  }
+
+  // Apply compensation formula to temperature ADC value.
+  temperature = BME280_compensate_T_int32(temp_adc);
+  if (temperature < BME280_TEMPERATURE_MIN || temperature > BME280_TEMPERATURE_MAX)
+  {
+    return BME280_ERROR_RANGE;
+  }
+
+  bme280_sample.temperature = temperature;
+  bme280_sample.adcTemperature = (uint32_t)temp_adc;
+  bme280_sample.adcHumidity = (uint32_t)hum_adc;
+
+  // Apply compensation formula to humidity ADC value, with the t_fine of this temperature.
+  bme280_sample.humidity = BME280_compensate_H_int32(hum_adc);
+
+  return BME280_OK;
+}
+
 /* Public Function Definitions ----------------------------------------------- */
 
 /**
- * @brief  Initializes the BME280 sensor by configuring its control registers and reading calibration parameters.
+ * @brief  Resets the sensor, waits for its start-up, then configures it. Blocking: call at boot only.
  * @param  None
- * @retval None
+ * @retval bme280Status_t: BME280_OK, or the reason the sensor is not configured.
  */
-void API_BME280_Init(void)
+bme280Status_t API_BME280_Init(void)
 {
-  calibrationParams();
+  bme280Status_t status = API_BME280_SoftReset();
+
+  if (status != BME280_OK)
+  {
+    return status;
+  }
+  BME280_HAL_Delay(BME280_HAL_DELAY);
 
+  return API_BME280_Configure();
+}
+
+/**
+ * @brief  Writes the soft reset word: the sensor restarts with its power-on settings, asleep. Does not wait:
+ *         the sensor needs 2 ms (datasheet table 1, start-up time) before API_BME280_Configure.
+ * @param  None
+ * @retval bme280Status_t: BME280_OK, or BME280_ERROR_BUS.
+ */
+bme280Status_t API_BME280_SoftReset(void)
+{
   /* 5.4.2 The "reset" register contains the soft reset word reset[7:0].
   If the value 0xB6 is written to the register, the device is reset using the complete power-on-reset procedure.
   The readout value is 0x00.*/
-  uint8_t CmdReset = 0xB6;
+  uint8_t CmdReset = BME280_RESET_WORD;
+
+  return BME280_HAL_SPI_Write(BME280_RESET_REG, &CmdReset, CMD_WRITE_SIZE) ? BME280_OK : BME280_ERROR_BUS;
+}
+
+/**
+ * @brief  Checks the chip ID, reads the calibration parameters and writes the control registers: the sensor starts
+ *         measuring in normal mode. Does not wait; the first measurement is ready after its conversion time.
+ * @param  None
+ * @retval bme280Status_t: BME280_OK, BME280_ERROR_BUS or BME280_ERROR_ID.
+ */
+bme280Status_t API_BME280_Configure(void)
+{
+  uint8_t chip_Id;
 
   /* 4.3. Register 0xF2 “ctrl_hum”. The “ctrl_hum” register sets the humidity data acquisition options of the device.
    * For this system I chose humidity at oversampling x 16.*/
@@ -232,91 +305,92 @@ void API_BME280_Init(void)
    * For this system we disable 3-wire SPI interface when bit-0 set to ‘0’. Please check section 6.3 for more information on this.*/
   uint8_t CmdConfig = 0x18;
 
-  // Write reset sequence to the reset register
-  BME280_HAL_SPI_Write(BME280_RESET_REG, &CmdReset, CMD_WRITE_SIZE);
-  BME280_HAL_Delay(BME280_HAL_DELAY);
-
-  // Write control settings to the control registers
-  BME280_HAL_SPI_Write(BME280_CTRL_HUM_REG, &CmdCtrlHum, CMD_WRITE_SIZE);
-  BME280_HAL_Delay(BME280_HAL_DELAY);
+  if (!BME280_HAL_SPI_Read(CHIP_ID_REG, &chip_Id, CHIP_ID_BLOCK_SIZE) || chip_Id == BME280_BUS_IDLE_LEVEL)
+  {
+    return BME280_ERROR_BUS;
+  }
+  if (chip_Id != BME280_CHIP_ID)
+  {
+    return BME280_ERROR_ID;
+  }
 
-  BME280_HAL_SPI_Write(BME280_CTRL_MEASR_REG, &CmdCtrlMeasr, CMD_WRITE_SIZE);
-  BME280_HAL_Delay(BME280_HAL_DELAY);
+  // Config is written in sleep mode, before ctrl_meas starts the measurements; ctrl_hum takes effect with ctrl_meas
+  if (!calibrationParams() ||
+      !BME280_HAL_SPI_Write(BME280_CTRL_CONFIG_REG, &CmdConfig, CMD_WRITE_SIZE) ||
+      !BME280_HAL_SPI_Write(BME280_CTRL_HUM_REG, &CmdCtrlHum, CMD_WRITE_SIZE) ||
+      !BME280_HAL_SPI_Write(BME280_CTRL_MEASR_REG, &CmdCtrlMeasr, CMD_WRITE_SIZE))
+  {
+    return BME280_ERROR_BUS;
+  }
 
-  BME280_HAL_SPI_Write(BME280_CTRL_CONFIG_REG, &CmdConfig, CMD_WRITE_SIZE);
-  BME280_HAL_Delay(BME280_HAL_DELAY);
+  return BME280_OK;
 }
 
 /**
  * @brief  Reads raw temperature and humidity data from the BME280 sensor, applies compensation formulas, and converts the data to human readable units.
+ *         Each failure returns at once with its reason: nothing blinks or waits here.
  * @param  None
- * @retval uint8_t: Returns 0 if the read operation is successful, 1 if an error occurs.
+ * @retval bme280Status_t: BME280_OK if a sample was compensated, or why not.
  */
-uint8_t API_BME280_ReadAndProcess(void)
+bme280Status_t API_BME280_ReadAndProcess(void)
 {
-  uint8_t sensorDataBuffer[8];
+  uint8_t sensorDataBuffer[RAW_OUTPUT_DATA_SIZE];
   uint8_t chip_Id;
 
-  BME280_HAL_SPI_Read(CHIP_ID_REG, &chip_Id, CHIP_ID_BLOCK_SIZE);
-
-  if (chip_Id == BME280_CHIP_ID)
+  if (!BME280_HAL_SPI_Read(CHIP_ID_REG, &chip_Id, CHIP_ID_BLOCK_SIZE) || chip_Id == BME280_BUS_IDLE_LEVEL)
   {
+    return BME280_ERROR_BUS;
+  }
+  if (chip_Id != BME280_CHIP_ID)
+  {
+    return BME280_ERROR_ID;
+  }
+
 #ifdef DEBUG_BME280
-    // blocking delays affect clock display performance negatively (time-lcd lag)
-    okLedSignal();
+  // blocking delays affect clock display performance negatively (time-lcd lag)
+  okLedSignal();
 #endif
-    /* Data readout is done by starting a burst read from 0xF7 to 0xFE (temperature, pressure and humidity).
-     * The data are read out in an unsigned 20-bit format both for pressure and for temperature and in an
-     * unsigned 16-bit format for humidity.
-     *
-     * The sensor output data is organized as follows:
-     * - 0xF7 to 0xF9: Raw pressure data (20 bits) -> Section 5.4.7.
-     * - 0xFA to 0xFC: Raw temperature data (20 bits) -> Section 5.4.8.
-     * - 0xFD to 0xFE: Raw humidity data (16 bits) -> Section 5.4.9.
-     *
-     * This means that with 46 bits (8 bytes) we can hold all the sampled data in 1 burst read.
-     * See Table 18: Memory map for more context.
-     *
-     * BYTE 7 | BYTE 6 | BYTE 5 | BYTE 4 | BYTE 3 | BYTE 2 | BYTE 1 | BYTE 0
-     * H_LSB    H_MSB    T_XLSB   T_LSB    T_MSB    P_XLSB   P_LSB    P_MSB
-     * */
-
-    BME280_HAL_SPI_Read(PRESSURE_MSB_REG, sensorDataBuffer, RAW_OUTPUT_DATA_SIZE);
-
-    // The BME280 output consists of the ADC output values that have to be compensated afterwards.
-
-    // Combine the bytes to form the 20-bit temperature value (temp_adc).
-    temp_adc = (sensorDataBuffer[TEMP_MSB_INDEX] << TEMP_MSB_SHIFT) |
-               (sensorDataBuffer[TEMP_LSB_INDEX] << TEMP_LSB_SHIFT) |
-               (sensorDataBuffer[TEMP_XLSB_INDEX] >> TEMP_XLSB_SHIFT);
-
-    // Apply compensation formula to temperature ADC value.
-    bme280_temperature = ((float)BME280_compensate_T_int32(temp_adc)) / TEMPERATURE_SCALE_FACTOR;
-
-    // Combine the bytes to form the 16-bit humidity value (hum_adc).
-    hum_adc = (sensorDataBuffer[HUM_MSB_INDEX] << HUM_MSB_SHIFT) |
-              sensorDataBuffer[HUM_LSB_INDEX];
-
-    // Apply compensation formula to humidity ADC value.
-    bme280_humidity = ((float)BME280_compensate_H_int32(hum_adc)) / HUMIDITY_SCALE_FACTOR;
-
-    return 0;
-  }
-  else
+  /* Data readout is done by starting a burst read from 0xF7 to 0xFE (temperature, pressure and humidity).
+   * The data are read out in an unsigned 20-bit format both for pressure and for temperature and in an
+   * unsigned 16-bit format for humidity.
+   *
+   * The sensor output data is organized as follows:
+   * - 0xF7 to 0xF9: Raw pressure data (20 bits) -> Section 5.4.7.
+   * - 0xFA to 0xFC: Raw temperature data (20 bits) -> Section 5.4.8.
+   * - 0xFD to 0xFE: Raw humidity data (16 bits) -> Section 5.4.9.
+   *
+   * This means that with 46 bits (8 bytes) we can hold all the sampled data in 1 burst read.
+   * See Table 18: Memory map for more context.
+   *
+   * BYTE 7 | BYTE 6 | BYTE 5 | BYTE 4 | BYTE 3 | BYTE 2 | BYTE 1 | BYTE 0
+   * H_LSB    H_MSB    T_XLSB   T_LSB    T_MSB    P_XLSB   P_LSB    P_MSB
+   * */
+
+  if (!BME280_HAL_SPI_Read(PRESSURE_MSB_REG, sensorDataBuffer, RAW_OUTPUT_DATA_SIZE))
   {
-    errorLedSignal();
-    return 1;
+    return BME280_ERROR_BUS;
   }
+
+  return compensateBurst(sensorDataBuffer);
 }
 
 /**
- * @brief  This function is executed in case of error occurrence. Program will get stuck in this part of the code. Indicating major BME280 error.
+ * @brief  Compensates a burst read from 0xF7 to 0xFE taken outside the driver, by the timed sampler's DMA.
+ *         Without the chip ID check of API_BME280_ReadAndProcess, an absent sensor is seen as the idle bus level.
+ * @param  burst: RAW_OUTPUT_DATA_SIZE bytes, 0xF7 first.
+ * @retval bme280Status_t: BME280_OK if the burst was compensated, or why not.
+ */
+bme280Status_t API_BME280_ProcessBurst(const uint8_t *burst)
+{
+  return compensateBurst(burst);
+}
+
+/**
+ * @brief  Copies the last sample compensated by API_BME280_ReadAndProcess or API_BME280_ProcessBurst.
+ * @param  sample: Receives the sample.
  * @retval None
  */
-void API_BME280_ErrorHandler(void)
+void API_BME280_GetSample(bme280Sample_t *sample)
 {
-  while (1)
-  {
-    errorLedSignal();
-  }
+  *sample = bme280_sample;
 }
@@ -0,0 +1,212 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "API_bus.h"
+
+/* Private variables ----------------------------------------------------------*/
+
+static busSubscription_t *topicSubscriptions[BUS_TOPIC_COUNT]; // Read by the publishers, interrupts included
+static busSubscription_t *firstSubscription;                   // Dispatch order
+static busSubscription_t *lastSubscription;
+static uint32_t topicSequence[BUS_TOPIC_COUNT];                // Written by the topic's publisher only
+static uint32_t topicRefused[BUS_TOPIC_COUNT];
+
+/* Private Function Prototypes ---------------------------------------------- */
+static bool isLinked(const busSubscription_t *subscription);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Looks for a subscription in the dispatch list.
+ * @param  subscription: Subscription.
+ * @retval bool: true if already subscribed.
+ */
+static bool isLinked(const busSubscription_t *subscription)
+{
+  for (const busSubscription_t *linked = firstSubscription; linked != NULL; linked = linked->nextAll)
+  {
+    if (linked == subscription)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Removes every subscription and restarts the sequence numbers.
+ * @param  None
+ * @retval None
+ */
+void API_BUS_Init(void)
+{
+  memset(topicSubscriptions, 0, sizeof(topicSubscriptions));
+  memset(topicSequence, 0, sizeof(topicSequence));
+  memset(topicRefused, 0, sizeof(topicRefused));
+  firstSubscription = NULL;
+  lastSubscription = NULL;
+}
+
+/**
+ * @brief  Subscribes to a topic. The subscription is filled in before the single pointer store that links
+ *         it, so a publisher interrupting the call sees it either whole or not at all.
+ * @param  subscription: Consumer-owned storage.
+ * @param  topic: Topic.
+ * @param  handler: Run by API_BUS_Dispatch, NULL to read with API_BUS_Receive.
+ * @param  periodMs: Minimum time between two dispatches, 0 for every pass.
+ * @retval bool: false if the topic is invalid or the subscription already linked.
+ */
+bool API_BUS_Subscribe(busSubscription_t *subscription, busTopic_t topic, busHandler_t handler, uint32_t periodMs)
+{
+  if (subscription == NULL || topic >= BUS_TOPIC_COUNT || isLinked(subscription))
+  {
+    return false;
+  }
+
+  memset(subscription, 0, sizeof(*subscription));
+  subscription->topic = topic;
+  subscription->handler = handler;
+  subscription->periodMs = periodMs;
+  API_SPSC_Init(&subscription->queue, subscription->slots, BUS_QUEUE_DEPTH, sizeof(busMessage_t));
+
+  // Dispatch order, main loop only
+  if (lastSubscription == NULL)
+  {
+    firstSubscription = subscription;
+  }
+  else
+  {
+    lastSubscription->nextAll = subscription;
+  }
+  lastSubscription = subscription;
+
+  // Topic list, walked by the publisher: append with one store
+  busSubscription_t **link = &topicSubscriptions[topic];
+  while (*link != NULL)
+  {
+    link = &(*link)->next;
+  }
+  atomic_thread_fence(memory_order_release);
+  *link = subscription;
+
+  return true;
+}
+
+/**
+ * @brief  Numbers a message and queues a copy for every subscription of its topic.
+ * @param  topic: Topic.
+ * @param  message: Payload in; header filled in.
+ * @retval bool: true if every subscription took the message.
+ */
+bool API_BUS_Publish(busTopic_t topic, busMessage_t *message)
+{
+  bool delivered = true;
+
+  if (topic >= BUS_TOPIC_COUNT)
+  {
+    return false;
+  }
+
+  message->topic = topic;
+  message->sequence = ++topicSequence[topic];
+
+  for (busSubscription_t *subscription = topicSubscriptions[topic]; subscription != NULL;
+       subscription = subscription->next)
+  {
+    if (!API_SPSC_Push(&subscription->queue, message))
+    {
+      topicRefused[topic]++;
+      delivered = false;
+    }
+  }
+
+  return delivered;
+}
+
+/**
+ * @brief  Takes the oldest queued message of a subscription.
+ * @param  subscription: Subscription.
+ * @param  message: Receives the message.
+ * @retval bool: false if the queue is empty.
+ */
+bool API_BUS_Receive(busSubscription_t *subscription, busMessage_t *message)
+{
+  if (!API_SPSC_Pop(&subscription->queue, message))
+  {
+    return false;
+  }
+
+  // The first message received sets the reference
+  if (subscription->expected != 0U && message->sequence != subscription->expected)
+  {
+    subscription->missed += message->sequence - subscription->expected;
+  }
+  subscription->expected = message->sequence + 1U;
+
+  return true;
+}
+
+/**
+ * @brief  Runs the handler of every due subscription on each of its queued messages, in subscription order.
+ * @param  now: Current tick in ms.
+ * @retval None
+ */
+void API_BUS_Dispatch(uint32_t now)
+{
+  busMessage_t message;
+
+  for (busSubscription_t *subscription = firstSubscription; subscription != NULL;
+       subscription = subscription->nextAll)
+  {
+    if (subscription->handler == NULL ||
+        (subscription->periodMs != 0U && now - subscription->lastDispatchMs < subscription->periodMs))
+    {
+      continue;
+    }
+    subscription->lastDispatchMs = now;
+
+    while (API_BUS_Receive(subscription, &message))
+    {
+      subscription->handler(&message);
+    }
+  }
+}
+
+/**
+ * @brief  Returns the publication counters of a topic.
+ * @param  topic: Topic.
+ * @retval busTopicStats_t: Counters, zero for an invalid topic.
+ */
+busTopicStats_t API_BUS_GetTopicStats(busTopic_t topic)
+{
+  busTopicStats_t stats = {0};
+
+  if (topic < BUS_TOPIC_COUNT)
+  {
+    stats.published = topicSequence[topic];
+    stats.refused = topicRefused[topic];
+  }
+
+  return stats;
+}
+
+/**
+ * @brief  Returns the messages missed by all subscriptions together.
+ * @param  None
+ * @retval uint32_t: Missed messages.
+ */
+uint32_t API_BUS_GetMissed(void)
+{
+  uint32_t missed = 0;
+
+  for (const busSubscription_t *subscription = firstSubscription; subscription != NULL;
+       subscription = subscription->nextAll)
+  {
+    missed += subscription->missed;
+  }
+
+  return missed;
+}
@@ -3,9 +3,8 @@
 
 #include "API_clock_date.h"
 
-// Global variables for storing time and date settings
-RTC_TimeTypeDef sTime = {0}; // Structure to store time values
-RTC_DateTypeDef sDate = {0}; // Structure to store date values
+/* Private Function Prototypes ---------------------------------------------- */
+static void ClockSetDefaultTimeDate(void);
 
 /**
  * @brief  Error handler for the clock and date functions.
@@ -22,12 +21,125 @@ void Clock_Error_Handler(void)
 }
 
 /**
- * @brief  Initializes the RTC clock with a predefined time and date.
+ * @brief  Checks whether the RTC kept running through the last reset with a calendar we programmed.
+ *         The backup domain (RTC, BDCR and backup registers) survives system resets, so a warm
+ *         boot finds RTCEN set and the marker written by a previous cold boot.
+ * @param  None
+ * @retval bool: true if the calendar is valid and must not be reprogrammed.
+ */
+bool ClockIsCalendarValid(void)
+{
+    hrtc.Instance = RTC;
+
+    if ((RCC->BDCR & RCC_BDCR_RTCEN) == 0U)
+    {
+        return false;
+    }
+
+    return HAL_RTCEx_BKUPRead(&hrtc, CLOCK_BKP_VALID_REG) == CLOCK_BKP_VALID_MAGIC;
+}
+
+/**
+ * @brief  Re-attaches the HAL handle to an RTC that kept running through a warm reset.
+ *         Skips HAL_RTC_Init and its init-mode entry, which would stop the calendar for up to two
+ *         RTCCLK periods and make the boot wait for INITF. Only the MSP (clock gate and NVIC) is
+ *         restored and the shadow registers are resynchronised before the first read.
+ * @param  None
+ * @retval None
+ */
+void ClockResume(void)
+{
+    HAL_RTC_MspInit(&hrtc);
+
+    // RSF is cleared by the system reset; calendar reads are only valid once it is set again
+    __HAL_RTC_WRITEPROTECTION_DISABLE(&hrtc);
+    if (HAL_RTC_WaitForSynchro(&hrtc) != HAL_OK)
+    {
+        __HAL_RTC_WRITEPROTECTION_ENABLE(&hrtc);
+        Clock_Error_Handler();
+    }
+    __HAL_RTC_WRITEPROTECTION_ENABLE(&hrtc);
+
+    hrtc.State = HAL_RTC_STATE_READY;
+}
+
+/**
+ * @brief  Applies a drift correction through the RTC smooth calibration (32 s window).
+ *         Each CALM pulse removes one RTCCLK cycle out of 2^20, i.e. 0.954 ppm. A slow RTC is
+ *         sped up by setting CALP (+512 pulses, +488.5 ppm) and masking out the excess with CALM.
+ *         The setting lives in the backup domain and survives warm resets.
+ * @param  trimPpm: Measured RTC error in ppm, positive if the RTC runs fast (-487..+487).
+ * @retval None
+ */
+void ClockSetDriftTrim(int32_t trimPpm)
+{
+    uint32_t plusPulses = RTC_SMOOTHCALIB_PLUSPULSES_RESET;
+    int32_t minusPulses = (trimPpm * CLOCK_CALIB_PULSES_PER_PPM_X1000) / 1000;
+
+    if (minusPulses < 0)
+    {
+        plusPulses = RTC_SMOOTHCALIB_PLUSPULSES_SET;
+        minusPulses += CLOCK_CALIB_PLUS_PULSES;
+    }
+
+    if (minusPulses < 0)
+    {
+        minusPulses = 0;
+    }
+    else if (minusPulses > CLOCK_CALIB_MAX_MINUS_PULSES)
+    {
+        minusPulses = CLOCK_CALIB_MAX_MINUS_PULSES;
+    }
+
+    if (HAL_RTCEx_SetSmoothCalib(&hrtc, RTC_SMOOTHCALIB_PERIOD_32SEC, plusPulses, (uint32_t)minusPulses) != HAL_OK)
+    {
+        Clock_Error_Handler();
+    }
+}
+
+/**
+ * @brief  Initializes the RTC clock and arms the 1 Hz wakeup interrupt that publishes BUS_TOPIC_TIME.
+ *         On a cold boot the calendar is programmed with a predefined time and date, the drift trim is applied
+ *         and the backup-domain marker is written. On a warm boot the running calendar is kept untouched.
  * @param  None
  * @retval None
  */
 void ClockInit(void)
 {
+    busMessage_t message = {.tick = HAL_GetTick()};
+
+    if (!ClockIsCalendarValid())
+    {
+        ClockSetDefaultTimeDate();
+        ClockSetDriftTrim(CLOCK_RTC_DRIFT_TRIM_PPM);
+
+        HAL_PWR_EnableBkUpAccess();
+        HAL_RTCEx_BKUPWrite(&hrtc, CLOCK_BKP_VALID_REG, CLOCK_BKP_VALID_MAGIC);
+    }
+
+    // First time message, so the subscribers render the clock once. The wakeup interrupt, the topic's
+    // publisher from now on, already runs (armed by MX_RTC_Init, or kept by a warm boot): masked meanwhile
+    HAL_NVIC_DisableIRQ(RTC_WKUP_IRQn);
+    API_BUS_Publish(BUS_TOPIC_TIME, &message);
+
+    // Wakeup timer on ck_spre ticks on the same edge that increments the seconds counter
+    if (HAL_RTCEx_SetWakeUpTimer_IT(&hrtc, CLOCK_WAKEUP_COUNTER, CLOCK_WAKEUP_CLOCK) != HAL_OK)
+    {
+        Clock_Error_Handler();
+    }
+    HAL_NVIC_EnableIRQ(RTC_WKUP_IRQn);
+}
+
+/**
+ * @brief  Programs the RTC with the predefined time and date used after a cold boot.
+ * @param  None
+ * @retval None
+ */
+static void ClockSetDefaultTimeDate(void)
+{
+    RTC_TimeTypeDef sTime = {0};
+    RTC_DateTypeDef sDate = {0};
+
     // Set initial time values (in BCD format)
     sTime.Hours = 0x01;
     sTime.Minutes = 0x20;
@@ -55,17 +167,29 @@ void ClockInit(void)
 }
 
 /**
- * @brief  Updates the global time and date variables with the current RTC time and date.
- * @param  None
+ * @brief  Reads the current time and date, for a subscriber of BUS_TOPIC_TIME.
+ *         The date read after the time unlocks the shadow registers.
+ * @param  time: Receives the time, BCD.
+ * @param  date: Receives the date, BCD.
+ * @retval None
+ */
+void ClockGetTimeDate(RTC_TimeTypeDef *time, RTC_DateTypeDef *date)
+{
+    HAL_RTC_GetTime(&hrtc, time, RTC_FORMAT_BCD);
+    HAL_RTC_GetDate(&hrtc, date, RTC_FORMAT_BCD);
+}
+
+/**
+ * @brief  RTC wakeup timer callback, runs in interrupt context once per second: publishes BUS_TOPIC_TIME.
+ *         The interrupt is the topic's only publisher once ClockInit has returned.
+ * @param  hrtc: RTC handle pointer.
  * @retval None
  */
-void ClockUpdateTimeDate(void)
+void HAL_RTCEx_WakeUpTimerEventCallback(RTC_HandleTypeDef *hrtc)
 {
-    // Get the current time from the RTC
-    HAL_RTC_GetTime(&hrtc, &sTime, RTC_FORMAT_BCD);
+    busMessage_t message = {.tick = HAL_GetTick()};
 
-    // Get the current date from the RTC
-    HAL_RTC_GetDate(&hrtc, &sDate, RTC_FORMAT_BCD);
+    API_BUS_Publish(BUS_TOPIC_TIME, &message);
 }
 
 #endif /* API_SRC_API_CLOCK_DATE_C_ */
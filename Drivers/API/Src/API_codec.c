@@ -0,0 +1,248 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "API_codec.h"
+
+/* Private variables ----------------------------------------------------------*/
+
+static const char base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* Private Function Prototypes ---------------------------------------------- */
+static uint32_t zigZagEncode(int32_t value);
+static int32_t zigZagDecode(uint32_t value);
+static uint8_t putVarint(uint8_t *out, uint32_t value);
+static uint8_t getVarint(const uint8_t *in, uint16_t size, uint32_t *value);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Maps signed to unsigned so small magnitudes of either sign get short varints (0, -1, 1, -2 ...).
+ * @param  int32_t value: Signed value.
+ * @retval uint32_t: Zig-zag value.
+ */
+static uint32_t zigZagEncode(int32_t value)
+{
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+/**
+ * @brief  Inverse of zigZagEncode.
+ * @param  uint32_t value: Zig-zag value.
+ * @retval int32_t: Signed value.
+ */
+static int32_t zigZagDecode(uint32_t value)
+{
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1U);
+}
+
+/**
+ * @brief  Writes a base-128 varint, low groups first, bit 7 set on all bytes but the last.
+ * @param  uint8_t *out: Destination, at least CODEC_VARINT_MAX_SIZE bytes.
+ * @param  uint32_t value: Value.
+ * @retval uint8_t: Bytes written.
+ */
+static uint8_t putVarint(uint8_t *out, uint32_t value)
+{
+  uint8_t length = 0;
+
+  while (value >= 0x80U)
+  {
+    out[length++] = (uint8_t)(value | 0x80U);
+    value >>= 7;
+  }
+  out[length++] = (uint8_t)value;
+
+  return length;
+}
+
+/**
+ * @brief  Reads a base-128 varint.
+ * @param  const uint8_t *in: Source.
+ * @param  uint16_t size: Available bytes.
+ * @param  uint32_t *value: Decoded value.
+ * @retval uint8_t: Bytes consumed, 0 if truncated or too long.
+ */
+static uint8_t getVarint(const uint8_t *in, uint16_t size, uint32_t *value)
+{
+  uint32_t result = 0;
+
+  for (uint8_t i = 0; i < CODEC_VARINT_MAX_SIZE && i < size; i++)
+  {
+    result |= (uint32_t)(in[i] & 0x7FU) << (7U * i);
+    if ((in[i] & 0x80U) == 0U)
+    {
+      *value = result;
+      return (uint8_t)(i + 1U);
+    }
+  }
+
+  return 0;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Starts a new block. The next sample is encoded in full.
+ * @param  state: Codec state.
+ * @param  channels: Values per sample (<= CODEC_MAX_CHANNELS).
+ * @retval bool: true on success, false if the channel count is invalid.
+ */
+bool API_CODEC_Reset(codecState_t *state, uint8_t channels)
+{
+  if (state == NULL || channels == 0U || channels > CODEC_MAX_CHANNELS)
+  {
+    return false;
+  }
+
+  memset(state, 0, sizeof(*state));
+  state->channels = channels;
+
+  return true;
+}
+
+/**
+ * @brief  Encodes one sample at the end of a buffer. A steady sampling period costs one byte for the
+ *         timestamp (delta-of-delta 0) and a slow-moving value one byte per channel.
+ * @param  state: Encoder state.
+ * @param  timestamp: Sample time, in any monotonic unit.
+ * @param  values: state->channels fixed-point values.
+ * @param  out: Destination buffer.
+ * @param  size: Free bytes in the destination buffer.
+ * @retval uint16_t: Bytes written, 0 if the buffer is too small (the state is then left unchanged).
+ */
+uint16_t API_CODEC_EncodeSample(codecState_t *state, uint32_t timestamp, const int32_t *values, uint8_t *out,
+                                uint16_t size)
+{
+  uint8_t scratch[CODEC_MAX_SAMPLE_SIZE(CODEC_MAX_CHANNELS)];
+  uint16_t length = 0;
+  int32_t timeDelta = (int32_t)(timestamp - state->prevTimestamp);
+
+  if (state->count == 0U)
+  {
+    length += putVarint(&scratch[length], timestamp);
+  }
+  else if (state->count == 1U)
+  {
+    length += putVarint(&scratch[length], zigZagEncode(timeDelta));
+  }
+  else
+  {
+    length += putVarint(&scratch[length], zigZagEncode(timeDelta - state->prevTimeDelta));
+  }
+
+  for (uint8_t channel = 0; channel < state->channels; channel++)
+  {
+    // Unsigned subtraction: wraps instead of overflowing on full-range jumps, the decoder wraps back
+    int32_t delta = (state->count == 0U) ? values[channel]
+                                         : (int32_t)((uint32_t)values[channel] - (uint32_t)state->prevValues[channel]);
+    length += putVarint(&scratch[length], zigZagEncode(delta));
+  }
+
+  if (length > size)
+  {
+    return 0;
+  }
+
+  memcpy(out, scratch, length);
+  state->prevTimeDelta = (state->count == 0U) ? 0 : timeDelta;
+  state->prevTimestamp = timestamp;
+  memcpy(state->prevValues, values, state->channels * sizeof(int32_t));
+  state->count++;
+
+  return length;
+}
+
+/**
+ * @brief  Decodes one sample.
+ * @param  state: Decoder state, reset at the same block boundaries as the encoder.
+ * @param  in: Encoded bytes.
+ * @param  size: Available encoded bytes.
+ * @param  timestamp: Decoded sample time.
+ * @param  values: Decoded values, state->channels entries.
+ * @retval uint16_t: Bytes consumed, 0 on truncated input.
+ */
+uint16_t API_CODEC_DecodeSample(codecState_t *state, const uint8_t *in, uint16_t size, uint32_t *timestamp,
+                                int32_t *values)
+{
+  uint16_t offset = 0;
+  uint32_t raw;
+  uint8_t length = getVarint(in, size, &raw);
+
+  if (length == 0U)
+  {
+    return 0;
+  }
+  offset += length;
+
+  if (state->count == 0U)
+  {
+    *timestamp = raw;
+    state->prevTimeDelta = 0;
+  }
+  else
+  {
+    int32_t timeDelta = zigZagDecode(raw) + ((state->count == 1U) ? 0 : state->prevTimeDelta);
+    *timestamp = state->prevTimestamp + (uint32_t)timeDelta;
+    state->prevTimeDelta = timeDelta;
+  }
+
+  for (uint8_t channel = 0; channel < state->channels; channel++)
+  {
+    length = getVarint(in + offset, (uint16_t)(size - offset), &raw);
+    if (length == 0U)
+    {
+      return 0;
+    }
+    offset += length;
+
+    uint32_t previous = (state->count == 0U) ? 0U : (uint32_t)state->prevValues[channel];
+    values[channel] = (int32_t)((uint32_t)zigZagDecode(raw) + previous);
+    state->prevValues[channel] = values[channel];
+  }
+
+  state->prevTimestamp = *timestamp;
+  state->count++;
+
+  return offset;
+}
+
+/**
+ * @brief  Encodes bytes as null-terminated base64 text, to carry a block on a text link.
+ * @param  in: Bytes to encode.
+ * @param  length: Number of bytes.
+ * @param  out: Destination string.
+ * @param  size: Destination size, at least CODEC_BASE64_SIZE(length) + 1.
+ * @retval uint16_t: Characters written, 0 if the destination is too small.
+ */
+uint16_t API_CODEC_ToBase64(const uint8_t *in, uint16_t length, char *out, uint16_t size)
+{
+  uint16_t written = 0;
+
+  if (size < CODEC_BASE64_SIZE(length) + 1U)
+  {
+    return 0;
+  }
+
+  for (uint16_t i = 0; i < length; i += 3U)
+  {
+    uint32_t group = (uint32_t)in[i] << 16;
+    uint8_t available = (uint8_t)((length - i) < 3U ? (length - i) : 3U);
+
+    if (available > 1U)
+    {
+      group |= (uint32_t)in[i + 1U] << 8;
+    }
+    if (available > 2U)
+    {
+      group |= in[i + 2U];
+    }
+
+    out[written++] = base64Alphabet[(group >> 18) & 0x3FU];
+    out[written++] = base64Alphabet[(group >> 12) & 0x3FU];
+    out[written++] = (available > 1U) ? base64Alphabet[(group >> 6) & 0x3FU] : '=';
+    out[written++] = (available > 2U) ? base64Alphabet[group & 0x3FU] : '=';
+  }
+  out[written] = '\0';
+
+  return written;
+}
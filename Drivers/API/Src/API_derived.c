@@ -0,0 +1,397 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+
+#include "API_derived.h"
+#include "API_section.h"
+
+/* Private define ------------------------------------------------------------*/
+
+#define DERIVED_TABLE_SIZE ((DERIVED_TABLE_HIGHEST_C - DERIVED_TABLE_LOWEST_C) / DERIVED_TABLE_STEP_C + 1)
+#define DERIVED_CENTI 100
+#define DERIVED_TABLE_LOWEST (DERIVED_TABLE_LOWEST_C * DERIVED_CENTI)   // 0.01 C
+#define DERIVED_TABLE_HIGHEST (DERIVED_TABLE_HIGHEST_C * DERIVED_CENTI) // 0.01 C
+#define DERIVED_TABLE_STEP (DERIVED_TABLE_STEP_C * DERIVED_CENTI)       // 0.01 C
+#define DERIVED_HUMIDITY_FULL 102400U                                   // 100 %RH in Q22.10
+#define DERIVED_HUMIDITY_PER_PERCENT 1024                               // %RH Q22.10
+#define DERIVED_SEGMENT_ONE 65536                                       // Position within a table segment
+
+// Absolute humidity in 0.01 g/m3 = e[mPa] x 20000 / (923 x T[0.01 K]): 1000 e[Pa] / (Rv T[K]), Rv = 461.5 J/(kg K)
+#define DERIVED_ZERO_CELSIUS 27315 // 0.01 K
+#define DERIVED_AH_NUMERATOR 20000U
+#define DERIVED_AH_DENOMINATOR 923U
+
+// Heat index: temperature in 1/500 F, 9 x (0.01 C) + 32 F, exact; results in 1e-8 F
+#define DERIVED_F500_PER_CENTI_C 9
+#define DERIVED_F500_FREEZING 16000      // 32 F
+#define DERIVED_F500_PER_F 500
+#define DERIVED_F500_ADJUST_LOW 40000    // 80 F
+#define DERIVED_F500_ADJUST_CENTRE 47500 // 95 F
+#define DERIVED_F500_ADJUST_SPAN 8500    // 17 F
+#define DERIVED_F500_ADJUST_HIGH 56000   // 112 F
+#define DERIVED_F500_ADJUST_HUMID 43500  // 87 F
+#define DERIVED_HUMIDITY_DRY 13312U      // 13 %RH
+#define DERIVED_HUMIDITY_HUMID 87040U    // 85 %RH
+#define DERIVED_HI_SCALE 100000000LL     // 1e-8 F
+#define DERIVED_HI_FREEZING (32LL * DERIVED_HI_SCALE)
+#define DERIVED_HI_REGRESSION_FROM (80LL * DERIVED_HI_SCALE)
+#define DERIVED_HI_PER_CENTI_C 1800000LL // 0.01 C = 0.018 F
+#define DERIVED_SQRT_SCALE 1000000LL     // Square roots in 1e-6
+
+#define DERIVED_VALID_VAPOUR (1U << DERIVED_CHANNEL_COUNT) // Cache flag beside the channel flags
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  uint32_t sequence;
+  uint32_t vapourPressure; // mPa
+  int32_t value[DERIVED_CHANNEL_COUNT];
+  uint8_t valid; // One flag per channel, then DERIVED_VALID_VAPOUR
+} derivedCache_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+// Saturation vapour pressure over water in mPa, 611.2 Pa x exp(17.62 T / (243.12 C + T)), every degree from -60 C
+static const uint32_t saturationTable[DERIVED_TABLE_SIZE] = {
+  1901U, 2158U, 2447U, 2771U, 3134U, 3539U, 3992U, 4497U,
+  5060U, 5686U, 6382U, 7155U, 8011U, 8960U, 10010U, 11171U,
+  12452U, 13865U, 15423U, 17137U, 19021U, 21092U, 23364U, 25855U,
+  28584U, 31571U, 34836U, 38403U, 42297U, 46543U, 51169U, 56205U,
+  61683U, 67636U, 74102U, 81117U, 88723U, 96964U, 105885U, 115534U,
+  125965U, 137232U, 149392U, 162508U, 176645U, 191871U, 208259U, 225886U,
+  244833U, 265184U, 287031U, 310468U, 335593U, 362514U, 391339U, 422185U,
+  455173U, 490431U, 528093U, 568301U, 611200U, 656946U, 705700U, 757632U,
+  812918U, 871743U, 934300U, 1000793U, 1071430U, 1146433U, 1226030U, 1310462U,
+  1399976U, 1494834U, 1595306U, 1701672U, 1814226U, 1933273U, 2059129U, 2192122U,
+  2332596U, 2480904U, 2637415U, 2802511U, 2976588U, 3160057U, 3353343U, 3556889U,
+  3771149U, 3996598U, 4233724U, 4483033U, 4745050U, 5020314U, 5309386U, 5612842U,
+  5931279U, 6265314U, 6615581U, 6982737U, 7367458U, 7770442U, 8192406U, 8634094U,
+  9096266U, 9579710U, 10085234U, 10613672U, 11165880U, 11742740U, 12345158U, 12974067U,
+  13630424U, 14315214U, 15029448U, 15774163U, 16550428U, 17359335U, 18202007U, 19079598U,
+  19993287U, 20944289U, 21933843U, 22963224U, 24033735U, 25146714U, 26303529U, 27505581U,
+  28754305U, 30051169U, 31397675U, 32795361U, 34245797U, 35750593U, 37311389U, 38929867U,
+  40607743U, 42346769U, 44148737U, 46015477U, 47948855U, 49950778U, 52023192U, 54168084U,
+  56387477U, 58683439U, 61058077U, 63513540U, 66052018U, 68675743U, 71386990U,
+};
+
+// Rothfusz regression in 1e-8 F: HI = sum of c[i][j] T^i RH^j, T in F and RH in %
+static const int64_t rothfusz[3][3] = {
+  {-4237900000LL, 1014333127LL, -5481717LL},
+  {204901523LL, -22475541LL, 85282LL},
+  {-683783LL, 122874LL, -199LL},
+};
+
+API_CCM_BSS static derivedCache_t cache;
+static derivedStats_t stats;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static int64_t secondDifference(uint32_t index);
+static uint32_t vapourPressure(int32_t temperature, uint32_t humidity);
+static int32_t dewPoint(uint32_t pressure);
+static int32_t absoluteHumidity(int32_t temperature, uint32_t pressure);
+static int32_t heatIndex(int32_t temperature, uint32_t humidity);
+static int64_t divideRounded(int64_t numerator, int64_t denominator);
+static uint32_t squareRoot(uint64_t value);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Returns the second difference of the table around a segment, from its first three points, or the
+ *         last three for the last segment.
+ * @param  uint32_t index: First point of the segment.
+ * @retval int64_t: Second difference in mPa.
+ */
+static int64_t secondDifference(uint32_t index)
+{
+  if (index > DERIVED_TABLE_SIZE - 3U)
+  {
+    index = DERIVED_TABLE_SIZE - 3U;
+  }
+
+  return (int64_t)saturationTable[index + 2U] - 2 * (int64_t)saturationTable[index + 1U] + saturationTable[index];
+}
+
+/**
+ * @brief  Computes the vapour pressure RH x es(T), es interpolated in the table with Newton's quadratic term.
+ *         The temperature saturates at the ends of the table and the humidity at 100 %RH.
+ * @param  int32_t temperature: Temperature in 0.01 C.
+ * @param  uint32_t humidity: Relative humidity in %RH Q22.10.
+ * @retval uint32_t: Vapour pressure in mPa.
+ */
+static uint32_t vapourPressure(int32_t temperature, uint32_t humidity)
+{
+  if (temperature < DERIVED_TABLE_LOWEST)
+  {
+    temperature = DERIVED_TABLE_LOWEST;
+  }
+  else if (temperature > DERIVED_TABLE_HIGHEST)
+  {
+    temperature = DERIVED_TABLE_HIGHEST;
+  }
+  if (humidity > DERIVED_HUMIDITY_FULL)
+  {
+    humidity = DERIVED_HUMIDITY_FULL;
+  }
+
+  uint32_t offset = (uint32_t)(temperature - DERIVED_TABLE_LOWEST);
+  uint32_t index = offset / DERIVED_TABLE_STEP;
+  int64_t fraction = offset % DERIVED_TABLE_STEP;
+  int64_t saturation = saturationTable[index];
+
+  if (fraction != 0)
+  {
+    // y0 + u (y1 - y0) - u (1 - u) / 2 x second difference, u = fraction / step
+    int64_t rise = (int64_t)saturationTable[index + 1U] - saturation;
+    int64_t bend = fraction * (DERIVED_TABLE_STEP - fraction) * secondDifference(index);
+
+    saturation += divideRounded(2 * DERIVED_TABLE_STEP * rise * fraction - bend, 2 * DERIVED_TABLE_STEP * DERIVED_TABLE_STEP);
+  }
+
+  return (uint32_t)(((uint64_t)saturation * humidity + DERIVED_HUMIDITY_FULL / 2U) / DERIVED_HUMIDITY_FULL);
+}
+
+/**
+ * @brief  Finds the temperature at which the vapour pressure saturates: the table read backwards, the linear
+ *         estimate within the segment refined by one Newton step on the quadratic interpolation.
+ * @param  uint32_t pressure: Vapour pressure in mPa.
+ * @retval int32_t: Dew point in 0.01 C, saturated at the ends of the table.
+ */
+static int32_t dewPoint(uint32_t pressure)
+{
+  if (pressure <= saturationTable[0])
+  {
+    return DERIVED_TABLE_LOWEST;
+  }
+  if (pressure >= saturationTable[DERIVED_TABLE_SIZE - 1])
+  {
+    return DERIVED_TABLE_HIGHEST;
+  }
+
+  // saturationTable[low] < pressure <= saturationTable[high]
+  uint32_t low = 0U;
+  uint32_t high = DERIVED_TABLE_SIZE - 1U;
+
+  while (high - low > 1U)
+  {
+    uint32_t middle = (low + high) / 2U;
+
+    if (saturationTable[middle] < pressure)
+    {
+      low = middle;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+
+  // Position in the segment in 1/DERIVED_SEGMENT_ONE: the chord, then u += u (1 - u) d2 / (2 d1 - (1 - 2u) d2)
+  int64_t rise = (int64_t)saturationTable[high] - saturationTable[low];
+  int64_t bend = secondDifference(low);
+  int64_t u = ((int64_t)(pressure - saturationTable[low]) * DERIVED_SEGMENT_ONE) / rise;
+  int64_t slope = 2 * DERIVED_SEGMENT_ONE * rise - (DERIVED_SEGMENT_ONE - 2 * u) * bend;
+
+  u += u * (DERIVED_SEGMENT_ONE - u) * bend / slope;
+
+  return DERIVED_TABLE_LOWEST + (int32_t)(low * DERIVED_TABLE_STEP) +
+         (int32_t)divideRounded(u * DERIVED_TABLE_STEP, DERIVED_SEGMENT_ONE);
+}
+
+/**
+ * @brief  Computes the mass of water vapour per volume of air.
+ * @param  int32_t temperature: Temperature in 0.01 C.
+ * @param  uint32_t pressure: Vapour pressure in mPa.
+ * @retval int32_t: Absolute humidity in 0.01 g/m3.
+ */
+static int32_t absoluteHumidity(int32_t temperature, uint32_t pressure)
+{
+  if (temperature < DERIVED_TABLE_LOWEST)
+  {
+    temperature = DERIVED_TABLE_LOWEST;
+  }
+
+  uint64_t denominator = (uint64_t)DERIVED_AH_DENOMINATOR * (uint32_t)(temperature + DERIVED_ZERO_CELSIUS);
+
+  return (int32_t)(((uint64_t)pressure * DERIVED_AH_NUMERATOR + denominator / 2U) / denominator);
+}
+
+/**
+ * @brief  Computes the NWS heat index: Steadman's simple formula, or the Rothfusz regression if the simple
+ *         value is 80 F or more, with the adjustment below 13 %RH between 80 and 112 F and the one above
+ *         85 %RH between 80 and 87 F.
+ * @param  int32_t temperature: Temperature in 0.01 C.
+ * @param  uint32_t humidity: Relative humidity in %RH Q22.10, saturated at 100 %RH.
+ * @retval int32_t: Heat index in 0.01 C.
+ */
+static int32_t heatIndex(int32_t temperature, uint32_t humidity)
+{
+  if (humidity > DERIVED_HUMIDITY_FULL)
+  {
+    humidity = DERIVED_HUMIDITY_FULL;
+  }
+
+  int64_t t = (int64_t)temperature * DERIVED_F500_PER_CENTI_C + DERIVED_F500_FREEZING; // 1/500 F
+  int64_t h = (int64_t)humidity;                                                       // %RH Q22.10
+
+  // 0.5 (T + 61 + 1.2 (T - 68) + 0.094 RH) = 1.1 T - 10.3 + 0.047 RH, in 1e-8 F / 1024 to stay exact
+  int64_t simple = (220000LL * t - 1030000000LL) * DERIVED_HUMIDITY_PER_PERCENT + 4700000LL * h;
+
+  if (simple < DERIVED_HI_REGRESSION_FROM * DERIVED_HUMIDITY_PER_PERCENT)
+  {
+    return (int32_t)divideRounded(simple / DERIVED_HUMIDITY_PER_PERCENT - DERIVED_HI_FREEZING, DERIVED_HI_PER_CENTI_C);
+  }
+
+  // Coefficients of T^0, T^1 and T^2 at this humidity, then the polynomial in T
+  int64_t a[3];
+
+  for (uint32_t i = 0U; i < 3U; i++)
+  {
+    a[i] = rothfusz[i][0] + rothfusz[i][1] * h / DERIVED_HUMIDITY_PER_PERCENT +
+           rothfusz[i][2] * h * h / (DERIVED_HUMIDITY_PER_PERCENT * DERIVED_HUMIDITY_PER_PERCENT);
+  }
+
+  int64_t index = a[0] + a[1] * t / DERIVED_F500_PER_F + a[2] * t * t / (DERIVED_F500_PER_F * DERIVED_F500_PER_F);
+
+  if (h < DERIVED_HUMIDITY_DRY && t >= DERIVED_F500_ADJUST_LOW && t <= DERIVED_F500_ADJUST_HIGH)
+  {
+    // ((13 - RH) / 4) x sqrt((17 - |T - 95|) / 17)
+    int64_t distance = (t > DERIVED_F500_ADJUST_CENTRE) ? t - DERIVED_F500_ADJUST_CENTRE : DERIVED_F500_ADJUST_CENTRE - t;
+    int64_t root = squareRoot((uint64_t)((DERIVED_F500_ADJUST_SPAN - distance) * DERIVED_SQRT_SCALE *
+                                         DERIVED_SQRT_SCALE / DERIVED_F500_ADJUST_SPAN));
+
+    index -= ((int64_t)DERIVED_HUMIDITY_DRY - h) * root * (DERIVED_HI_SCALE / DERIVED_SQRT_SCALE) /
+             (4 * DERIVED_HUMIDITY_PER_PERCENT);
+  }
+  else if (h > DERIVED_HUMIDITY_HUMID && t >= DERIVED_F500_ADJUST_LOW && t <= DERIVED_F500_ADJUST_HUMID)
+  {
+    // ((RH - 85) / 10) x ((87 - T) / 5)
+    index += (h - (int64_t)DERIVED_HUMIDITY_HUMID) * (DERIVED_F500_ADJUST_HUMID - t) * DERIVED_HI_SCALE /
+             (10 * DERIVED_HUMIDITY_PER_PERCENT * 5 * DERIVED_F500_PER_F);
+  }
+
+  return (int32_t)divideRounded(index - DERIVED_HI_FREEZING, DERIVED_HI_PER_CENTI_C);
+}
+
+/**
+ * @brief  Divides, rounding half away from zero.
+ * @param  int64_t numerator: Numerator.
+ * @param  int64_t denominator: Denominator, positive.
+ * @retval int64_t: Quotient.
+ */
+static int64_t divideRounded(int64_t numerator, int64_t denominator)
+{
+  return (numerator >= 0) ? (numerator + denominator / 2) / denominator : (numerator - denominator / 2) / denominator;
+}
+
+/**
+ * @brief  Integer square root, bit by bit.
+ * @param  uint64_t value: Radicand.
+ * @retval uint32_t: floor(sqrt(value)).
+ */
+static uint32_t squareRoot(uint64_t value)
+{
+  uint64_t root = 0U;
+  uint64_t bit = 1ULL << 62;
+
+  while (bit > value)
+  {
+    bit >>= 2;
+  }
+
+  while (bit != 0U)
+  {
+    if (value >= root + bit)
+    {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+    {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+
+  return (uint32_t)root;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Empties the cache and clears the counters.
+ * @param  None
+ * @retval None
+ */
+void API_DERIVED_Init(void)
+{
+  cache.sequence = 0U;
+  cache.valid = 0U;
+  stats.computed = 0U;
+  stats.reused = 0U;
+}
+
+/**
+ * @brief  Returns one derived channel of a sample. The first request for a sample computes the channel, and
+ *         the vapour pressure if the channel needs it; later requests for the same sequence read the cache.
+ * @param  sample: Sample.
+ * @param  channel: Channel.
+ * @param  value: Receives the value in the channel's unit.
+ * @retval bool: false if an argument is invalid.
+ */
+bool API_DERIVED_Get(const derivedSample_t *sample, derivedChannel_t channel, int32_t *value)
+{
+  if (sample == NULL || value == NULL || channel >= DERIVED_CHANNEL_COUNT)
+  {
+    return false;
+  }
+
+  if (sample->sequence == 0U || sample->sequence != cache.sequence)
+  {
+    cache.sequence = sample->sequence;
+    cache.valid = 0U;
+  }
+
+  uint8_t flag = (uint8_t)(1U << channel);
+
+  if ((cache.valid & flag) != 0U)
+  {
+    stats.reused++;
+    *value = cache.value[channel];
+    return true;
+  }
+
+  if (channel != DERIVED_CHANNEL_HEAT_INDEX && (cache.valid & DERIVED_VALID_VAPOUR) == 0U)
+  {
+    cache.vapourPressure = vapourPressure(sample->temperature, sample->humidity);
+    cache.valid |= DERIVED_VALID_VAPOUR;
+  }
+
+  switch (channel)
+  {
+  case DERIVED_CHANNEL_DEW_POINT:
+    cache.value[channel] = dewPoint(cache.vapourPressure);
+    break;
+  case DERIVED_CHANNEL_ABSOLUTE_HUMIDITY:
+    cache.value[channel] = absoluteHumidity(sample->temperature, cache.vapourPressure);
+    break;
+  default:
+    cache.value[channel] = heatIndex(sample->temperature, sample->humidity);
+    break;
+  }
+
+  cache.valid |= flag;
+  stats.computed++;
+  *value = cache.value[channel];
+
+  return true;
+}
+
+/**
+ * @brief  Returns the request counters.
+ * @param  None
+ * @retval derivedStats_t: Counters.
+ */
+derivedStats_t API_DERIVED_GetStats(void)
+{
+  return stats;
+}
@@ -0,0 +1,308 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "API_fault.h"
+#include "API_sampler.h"
+
+/* Private variables ----------------------------------------------------------*/
+
+static faultStatus_t status;
+static uint8_t failuresInRow;    // Faulty reads since the last valid one, while running
+static uint32_t stateSinceMs;    // Entry in the current state
+static uint8_t verifiedReads;    // Good reads since the configuration
+static uint32_t samplerFailures; // Sampler errors and timeouts already counted
+
+// Stuck detection: last raw results, since when and over how many reads they have not changed
+static uint32_t lastAdcTemperature;
+static uint32_t lastAdcHumidity;
+static uint32_t unchangedSinceMs;
+static uint32_t unchangedReads;
+static bool lastAdcValid;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static faultType_t faultFromStatus(bme280Status_t readStatus);
+static bool isStuck(const bme280Sample_t *sample, uint32_t nowMs);
+static void enterState(faultState_t state, uint32_t nowMs);
+static void startRecovery(faultType_t fault, uint32_t nowMs);
+static void failAttempt(uint32_t nowMs);
+static void recordFailure(faultType_t fault, uint32_t nowMs);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Maps a driver result to a fault type.
+ * @param  bme280Status_t readStatus: Driver result.
+ * @retval faultType_t: FAULT_TYPE_NONE for BME280_OK.
+ */
+static faultType_t faultFromStatus(bme280Status_t readStatus)
+{
+  switch (readStatus)
+  {
+  case BME280_OK:
+    return FAULT_TYPE_NONE;
+  case BME280_ERROR_ID:
+    return FAULT_TYPE_ID;
+  case BME280_ERROR_RANGE:
+    return FAULT_TYPE_RANGE;
+  default:
+    return FAULT_TYPE_BUS;
+  }
+}
+
+/**
+ * @brief  Tracks the raw results of the valid reads and tells whether they have been frozen long enough.
+ * @param  const bme280Sample_t *sample: Valid sample.
+ * @param  uint32_t nowMs: Read time in ms.
+ * @retval bool: true once both raw results are unchanged for FAULT_STUCK_MS and FAULT_STUCK_MIN_READS reads.
+ */
+static bool isStuck(const bme280Sample_t *sample, uint32_t nowMs)
+{
+  if (!lastAdcValid || sample->adcTemperature != lastAdcTemperature || sample->adcHumidity != lastAdcHumidity)
+  {
+    lastAdcTemperature = sample->adcTemperature;
+    lastAdcHumidity = sample->adcHumidity;
+    lastAdcValid = true;
+    unchangedSinceMs = nowMs;
+    unchangedReads = 0;
+    return false;
+  }
+
+  unchangedReads++;
+
+  return unchangedReads >= FAULT_STUCK_MIN_READS && (nowMs - unchangedSinceMs) >= FAULT_STUCK_MS;
+}
+
+/**
+ * @brief  Moves to a recovery state.
+ * @param  faultState_t state: New state.
+ * @param  uint32_t nowMs: Time in ms.
+ * @retval None
+ */
+static void enterState(faultState_t state, uint32_t nowMs)
+{
+  status.state = state;
+  stateSinceMs = nowMs;
+}
+
+/**
+ * @brief  Starts a recovery at once with a soft reset.
+ * @param  faultType_t fault: Cause.
+ * @param  uint32_t nowMs: Time in ms.
+ * @retval None
+ */
+static void startRecovery(faultType_t fault, uint32_t nowMs)
+{
+  status.lastFault = fault;
+  failuresInRow = 0;
+  enterState(FAULT_STATE_RESET, nowMs);
+}
+
+/**
+ * @brief  Ends a failed recovery attempt: waits the back-off, then doubles it for the next failure.
+ * @param  uint32_t nowMs: Time in ms.
+ * @retval None
+ */
+static void failAttempt(uint32_t nowMs)
+{
+  status.attempts++;
+  enterState(FAULT_STATE_BACKOFF, nowMs);
+}
+
+/**
+ * @brief  Counts a faulty read or sampler failure and trips or fails the recovery on it. Between the reset and
+ *         the configuration it is not judged, and counts as a recovery read.
+ * @param  faultType_t fault: Fault, not FAULT_TYPE_NONE.
+ * @param  uint32_t nowMs: Time in ms.
+ * @retval None
+ */
+static void recordFailure(faultType_t fault, uint32_t nowMs)
+{
+  if (status.state == FAULT_STATE_OK)
+  {
+    status.reads[fault]++;
+    failuresInRow++;
+    if (fault == FAULT_TYPE_STUCK || failuresInRow >= FAULT_TRIP_READS)
+    {
+      startRecovery(fault, nowMs);
+    }
+  }
+  else if (status.state == FAULT_STATE_VERIFY)
+  {
+    status.reads[fault]++;
+    status.lastFault = fault;
+    failAttempt(nowMs);
+  }
+  else
+  {
+    status.reads[FAULT_TYPE_RECOVERY]++;
+  }
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Starts the fault manager from the result of the boot initialisation.
+ * @param  bootStatus: Result of API_BME280_Init, a failure starts with a back-off.
+ * @param  nowMs: Time in ms.
+ * @retval None
+ */
+void API_FAULT_Init(bme280Status_t bootStatus, uint32_t nowMs)
+{
+  memset(&status, 0, sizeof(status));
+  status.backoffMs = FAULT_BACKOFF_MIN_MS;
+  failuresInRow = 0;
+  verifiedReads = 0;
+  samplerFailures = 0;
+  lastAdcValid = false;
+  enterState(FAULT_STATE_OK, nowMs);
+
+  if (bootStatus != BME280_OK)
+  {
+    status.lastFault = faultFromStatus(bootStatus);
+    failAttempt(nowMs);
+  }
+}
+
+/**
+ * @brief  Classifies a read and advances the recovery with it. While recovering, a read that passes the driver
+ *         checks is still invalid, FAULT_TYPE_RECOVERY, until the sensor is verified.
+ * @param  readStatus: Result of the read.
+ * @param  sample: Sample compensated by the read, used only if readStatus is BME280_OK.
+ * @param  nowMs: Read time in ms.
+ * @retval faultType_t: FAULT_TYPE_NONE if the sample is valid, otherwise why it is not.
+ */
+faultType_t API_FAULT_CheckRead(bme280Status_t readStatus, const bme280Sample_t *sample, uint32_t nowMs)
+{
+  faultType_t fault = faultFromStatus(readStatus);
+
+  switch (status.state)
+  {
+  case FAULT_STATE_OK:
+    if (fault == FAULT_TYPE_NONE && isStuck(sample, nowMs))
+    {
+      fault = FAULT_TYPE_STUCK;
+    }
+    break;
+
+  case FAULT_STATE_VERIFY:
+    // The registers still hold the reset values until the first conversion completes. A queued read may have
+    // started before the configuration: signed difference
+    if ((int32_t)(nowMs - stateSinceMs) < (int32_t)FAULT_FIRST_CONVERSION_MS)
+    {
+      status.reads[FAULT_TYPE_RECOVERY]++;
+      return FAULT_TYPE_RECOVERY;
+    }
+    // Good reads stay invalid until the one that completes the verification
+    if (fault == FAULT_TYPE_NONE)
+    {
+      if (++verifiedReads < FAULT_VERIFY_READS)
+      {
+        status.reads[FAULT_TYPE_RECOVERY]++;
+        return FAULT_TYPE_RECOVERY;
+      }
+      status.recoveries++;
+      status.backoffMs = FAULT_BACKOFF_MIN_MS;
+      lastAdcValid = false;
+      enterState(FAULT_STATE_OK, nowMs);
+    }
+    break;
+
+  default:
+    // The sensor is being reset or waits for the next attempt: its reads are not judged
+    status.reads[FAULT_TYPE_RECOVERY]++;
+    return FAULT_TYPE_RECOVERY;
+  }
+
+  if (fault == FAULT_TYPE_NONE)
+  {
+    failuresInRow = 0;
+    status.reads[FAULT_TYPE_NONE]++;
+  }
+  else
+  {
+    recordFailure(fault, nowMs);
+  }
+
+  return fault;
+}
+
+/**
+ * @brief  Counts the sampler's failed and aborted reads as bus faults and runs one recovery step. Never waits:
+ *         a step that finds SPI1 busy runs on a later call.
+ * @param  nowMs: Time in ms.
+ * @retval None
+ */
+void API_FAULT_Process(uint32_t nowMs)
+{
+  samplerStatus_t samplerStatus = API_SAMPLER_GetStatus();
+  uint32_t failures = samplerStatus.errors + samplerStatus.timeouts;
+  bme280Status_t configStatus;
+
+  while (samplerFailures != failures)
+  {
+    samplerFailures++;
+    recordFailure(FAULT_TYPE_BUS, nowMs);
+  }
+
+  switch (status.state)
+  {
+  case FAULT_STATE_RESET:
+    if (!API_SAMPLER_AcquireBus())
+    {
+      break;
+    }
+    status.resets++;
+    if (API_BME280_SoftReset() == BME280_OK)
+    {
+      enterState(FAULT_STATE_CONFIGURE, nowMs);
+    }
+    else
+    {
+      status.lastFault = FAULT_TYPE_BUS;
+      failAttempt(nowMs);
+    }
+    API_SAMPLER_ReleaseBus();
+    break;
+
+  case FAULT_STATE_CONFIGURE:
+    if ((nowMs - stateSinceMs) < FAULT_RESET_SETTLE_MS || !API_SAMPLER_AcquireBus())
+    {
+      break;
+    }
+    configStatus = API_BME280_Configure();
+    API_SAMPLER_ReleaseBus();
+
+    if (configStatus == BME280_OK)
+    {
+      verifiedReads = 0;
+      enterState(FAULT_STATE_VERIFY, nowMs);
+    }
+    else
+    {
+      status.lastFault = faultFromStatus(configStatus);
+      failAttempt(nowMs);
+    }
+    break;
+
+  case FAULT_STATE_BACKOFF:
+    if ((nowMs - stateSinceMs) >= status.backoffMs)
+    {
+      status.backoffMs = (status.backoffMs >= FAULT_BACKOFF_MAX_MS / 2U) ? FAULT_BACKOFF_MAX_MS : status.backoffMs * 2U;
+      enterState(FAULT_STATE_RESET, nowMs);
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+/**
+ * @brief  Returns the recovery state and the counters.
+ * @param  None
+ * @retval faultStatus_t: Status.
+ */
+faultStatus_t API_FAULT_GetStatus(void)
+{
+  return status;
+}
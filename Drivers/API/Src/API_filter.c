@@ -0,0 +1,207 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "API_filter.h"
+
+/* Private Function Prototypes ---------------------------------------------- */
+static int32_t medianStage(filterChannel_t *channel, int32_t raw);
+static bool decimatorStage(filterChannel_t *channel, int32_t sample, int32_t *output);
+static int32_t emaStage(filterChannel_t *channel, int32_t sample);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Median-of-N spike rejector. Stores the sample in the ring and returns the median of the
+ *         samples seen so far (up to the configured window), found by insertion sort of a copy.
+ * @param  filterChannel_t *channel: Channel state.
+ * @param  int32_t raw: Raw sample.
+ * @retval int32_t: Median of the window.
+ */
+static int32_t medianStage(filterChannel_t *channel, int32_t raw)
+{
+  uint8_t window = channel->config.medianWindow;
+  int32_t sorted[FILTER_MEDIAN_MAX_WINDOW];
+
+  channel->medianRing[channel->medianHead] = raw;
+  channel->medianHead = (uint8_t)((channel->medianHead + 1U) % window);
+  if (channel->medianCount < window)
+  {
+    channel->medianCount++;
+  }
+
+  for (uint8_t i = 0; i < channel->medianCount; i++)
+  {
+    int32_t value = channel->medianRing[i];
+    int8_t j = (int8_t)i - 1;
+
+    while (j >= 0 && sorted[j] > value)
+    {
+      sorted[j + 1] = sorted[j];
+      j--;
+    }
+    sorted[j + 1] = value;
+  }
+
+  return sorted[channel->medianCount / 2U];
+}
+
+/**
+ * @brief  Moving-average decimator (first-order CIC): integrates a block of samples and emits
+ *         their mean once per block, so the output rate is the input rate / decimation.
+ * @param  filterChannel_t *channel: Channel state.
+ * @param  int32_t sample: Sample from the previous stage.
+ * @param  int32_t *output: Block mean, written when the block completes.
+ * @retval bool: true when a block completed.
+ */
+static bool decimatorStage(filterChannel_t *channel, int32_t sample, int32_t *output)
+{
+  uint8_t decimation = channel->config.decimation;
+
+  channel->decimatorSum += sample;
+  channel->decimatorCount++;
+
+  if (channel->decimatorCount < decimation)
+  {
+    return false;
+  }
+
+  // Round to nearest, symmetric for negative sums
+  int32_t half = (int32_t)(decimation / 2U);
+  *output = (channel->decimatorSum >= 0) ? (channel->decimatorSum + half) / decimation
+                                         : (channel->decimatorSum - half) / decimation;
+
+  channel->decimatorSum = 0;
+  channel->decimatorCount = 0;
+
+  return true;
+}
+
+/**
+ * @brief  Exponential smoothing y += (x - y) * 2^-shift, kept scaled by 2^shift so no precision is
+ *         lost to the shift. The first sample primes the state to avoid a start-up ramp from zero.
+ * @param  filterChannel_t *channel: Channel state.
+ * @param  int32_t sample: Sample from the previous stage.
+ * @retval int32_t: Smoothed sample.
+ */
+static int32_t emaStage(filterChannel_t *channel, int32_t sample)
+{
+  uint8_t shift = channel->config.emaShift;
+
+  if (!channel->emaPrimed)
+  {
+    channel->emaState = sample * (1L << shift);
+    channel->emaPrimed = true;
+  }
+  else
+  {
+    channel->emaState += sample - (channel->emaState >> shift);
+  }
+
+  return channel->emaState >> shift;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Initializes a filter channel with a configuration. Out-of-range fields are clamped.
+ * @param  channel: Channel state to initialize.
+ * @param  config: Stage configuration.
+ * @retval None
+ */
+void API_FILTER_Init(filterChannel_t *channel, const filterConfig_t *config)
+{
+  if (channel == NULL || config == NULL)
+  {
+    return;
+  }
+
+  memset(channel, 0, sizeof(*channel));
+  channel->config = *config;
+
+  if (channel->config.medianWindow > FILTER_MEDIAN_MAX_WINDOW)
+  {
+    channel->config.medianWindow = FILTER_MEDIAN_MAX_WINDOW;
+  }
+  channel->config.medianWindow |= 1U; // Keep the window odd so the median is a sample, 0 becomes 1 (disabled)
+
+  if (channel->config.decimation == 0U)
+  {
+    channel->config.decimation = 1U;
+  }
+  else if (channel->config.decimation > FILTER_MAX_DECIMATION)
+  {
+    channel->config.decimation = FILTER_MAX_DECIMATION;
+  }
+
+  if (channel->config.emaShift > FILTER_MAX_EMA_SHIFT)
+  {
+    channel->config.emaShift = FILTER_MAX_EMA_SHIFT;
+  }
+}
+
+/**
+ * @brief  Changes the configuration of a running channel without a restart: the median keeps its newest samples,
+ *         the EMA keeps its output, the decimator starts a new block. Out-of-range fields are clamped.
+ * @param  channel: Channel state.
+ * @param  config: New stage configuration.
+ * @retval None
+ */
+void API_FILTER_Reconfigure(filterChannel_t *channel, const filterConfig_t *config)
+{
+  filterChannel_t previous;
+  uint8_t kept;
+
+  if (channel == NULL || config == NULL)
+  {
+    return;
+  }
+
+  previous = *channel;
+  API_FILTER_Init(channel, config);
+
+  // Newest samples of the old window, oldest first, as many as the new window holds
+  kept = (previous.medianCount < channel->config.medianWindow) ? previous.medianCount : channel->config.medianWindow;
+  for (uint8_t age = kept; age > 0U; age--)
+  {
+    uint8_t window = previous.config.medianWindow;
+
+    channel->medianRing[channel->medianHead] = previous.medianRing[(previous.medianHead + window - age) % window];
+    channel->medianHead = (uint8_t)((channel->medianHead + 1U) % channel->config.medianWindow);
+    channel->medianCount++;
+  }
+
+  // The state is scaled by 2^emaShift: carry the output over at the new scale. A disabled EMA primes afresh.
+  if (previous.emaPrimed && channel->config.emaShift > 0U)
+  {
+    channel->emaState = (previous.emaState >> previous.config.emaShift) * (1L << channel->config.emaShift);
+    channel->emaPrimed = true;
+  }
+}
+
+/**
+ * @brief  Feeds one raw sample and produces a filtered output once per decimation block.
+ * @param  channel: Channel state.
+ * @param  raw: Raw sample in fixed point.
+ * @param  output: Filtered sample, written only when the function returns true.
+ * @retval bool: true when a new decimated output is available.
+ */
+bool API_FILTER_Push(filterChannel_t *channel, int32_t raw, int32_t *output)
+{
+  int32_t sample;
+
+  if (channel == NULL || output == NULL)
+  {
+    return false;
+  }
+
+  sample = (channel->config.medianWindow > 1U) ? medianStage(channel, raw) : raw;
+
+  if (!decimatorStage(channel, sample, &sample))
+  {
+    return false;
+  }
+
+  *output = (channel->config.emaShift > 0U) ? emaStage(channel, sample) : sample;
+
+  return true;
+}
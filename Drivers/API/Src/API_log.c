@@ -0,0 +1,597 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "API_log.h"
+#include "API_section.h"
+
+/* Private types -------------------------------------------------------------*/
+
+typedef enum
+{
+  BLOCK_END,     // Erased header word, nothing written from here on
+  BLOCK_VALID,   // Complete block
+  BLOCK_TORN,    // Header intact but the body failed its CRC, the write was interrupted
+  BLOCK_CORRUPT, // Unrecognisable header, the rest of the sector cannot be walked
+} logBlockState_t;
+
+typedef struct
+{
+  logBlockState_t state;
+  const uint8_t *body;
+  uint8_t count;       // Records in the block
+  uint32_t totalSize;  // Header plus padded body, in bytes
+} logBlock_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+static uint8_t headSector;
+static uint32_t writeOffset;     // Next free byte in the head sector
+static bool preEraseRequested;   // Next sector erase started for the current head sector
+static logStatus_t status;
+
+API_CCM_BSS static uint32_t stagingWords[LOG_BLOCK_MAX_BODY_WORDS]; // Word storage so the body can be programmed as is
+static uint8_t *const stagingBytes = (uint8_t *)stagingWords;
+static uint16_t stagingSize;
+static uint8_t stagingCount;
+API_CCM_BSS static logRecord_t stagingLast;  // Last staged record, reference of the next delta
+
+/* Private Function Prototypes ---------------------------------------------- */
+static uint32_t getLE32(const uint8_t *bytes);
+static uint16_t getLE16(const uint8_t *bytes);
+static void putLE32(uint8_t *bytes, uint32_t value);
+static void putLE16(uint8_t *bytes, uint16_t value);
+static uint8_t crc8(const uint8_t *data, uint16_t length);
+static uint16_t bodySize(uint8_t count);
+static bool readSectorSequence(uint8_t sector, uint32_t *sequence);
+static bool isSectorBlank(uint8_t sector);
+static void readBlock(uint8_t sector, uint32_t offset, logBlock_t *block);
+static uint32_t scanSector(uint8_t sector, bool countBlocks);
+static bool openNextSector(void);
+static void preEraseNextSector(void);
+static bool decodeBlock(const uint8_t *body, uint8_t count, timestamp_t from, timestamp_t to,
+                        logVisitor_t visitor, void *context, uint32_t *visited);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Reads a little-endian 32-bit value.
+ * @param  const uint8_t *bytes: Source bytes.
+ * @retval uint32_t: Value.
+ */
+static uint32_t getLE32(const uint8_t *bytes)
+{
+  return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+/**
+ * @brief  Reads a little-endian 16-bit value.
+ * @param  const uint8_t *bytes: Source bytes.
+ * @retval uint16_t: Value.
+ */
+static uint16_t getLE16(const uint8_t *bytes)
+{
+  return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+/**
+ * @brief  Writes a little-endian 32-bit value.
+ * @param  uint8_t *bytes: Destination bytes.
+ * @param  uint32_t value: Value.
+ * @retval None
+ */
+static void putLE32(uint8_t *bytes, uint32_t value)
+{
+  bytes[0] = (uint8_t)value;
+  bytes[1] = (uint8_t)(value >> 8);
+  bytes[2] = (uint8_t)(value >> 16);
+  bytes[3] = (uint8_t)(value >> 24);
+}
+
+/**
+ * @brief  Writes a little-endian 16-bit value.
+ * @param  uint8_t *bytes: Destination bytes.
+ * @param  uint16_t value: Value.
+ * @retval None
+ */
+static void putLE16(uint8_t *bytes, uint16_t value)
+{
+  bytes[0] = (uint8_t)value;
+  bytes[1] = (uint8_t)(value >> 8);
+}
+
+/**
+ * @brief  CRC-8 (polynomial 0x07), detects a block whose write was cut by a reset.
+ * @param  const uint8_t *data: Data to check.
+ * @param  uint16_t length: Length in bytes.
+ * @retval uint8_t: CRC.
+ */
+static uint8_t crc8(const uint8_t *data, uint16_t length)
+{
+  uint8_t crc = 0;
+
+  for (uint16_t i = 0; i < length; i++)
+  {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8U; bit++)
+    {
+      crc = (crc & 0x80U) ? (uint8_t)((crc << 1) ^ 0x07U) : (uint8_t)(crc << 1);
+    }
+  }
+
+  return crc;
+}
+
+/**
+ * @brief  Body size of a block holding count records, before padding.
+ * @param  uint8_t count: Records in the block (>= 1).
+ * @retval uint16_t: Size in bytes.
+ */
+static uint16_t bodySize(uint8_t count)
+{
+  return (uint16_t)(LOG_BLOCK_BASE_SIZE + (count - 1U) * LOG_BLOCK_DELTA_SIZE);
+}
+
+/**
+ * @brief  Reads and validates a sector header.
+ * @param  uint8_t sector: Sector index.
+ * @param  uint32_t *sequence: Sector sequence number, set when valid.
+ * @retval bool: true if the header is valid.
+ */
+static bool readSectorSequence(uint8_t sector, uint32_t *sequence)
+{
+  const uint8_t *header = LOG_HAL_Read(sector, 0);
+  uint32_t value = getLE32(header + 4);
+
+  if (getLE32(header) != LOG_SECTOR_MAGIC || getLE32(header + 8) != ~value)
+  {
+    return false;
+  }
+
+  *sequence = value;
+  return true;
+}
+
+/**
+ * @brief  Checks that a whole sector is erased, guarding against a failed or interrupted erase.
+ * @param  uint8_t sector: Sector index.
+ * @retval bool: true if every word is erased.
+ */
+static bool isSectorBlank(uint8_t sector)
+{
+  const uint32_t *words = (const uint32_t *)LOG_HAL_Read(sector, 0);
+
+  for (uint32_t i = 0; i < LOG_FLASH_SECTOR_SIZE / sizeof(uint32_t); i++)
+  {
+    if (words[i] != LOG_FLASH_ERASED_WORD)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief  Decodes the block header at an offset and checks the body CRC.
+ * @param  uint8_t sector: Sector index.
+ * @param  uint32_t offset: Offset of the block header.
+ * @param  logBlock_t *block: Filled with the block description.
+ * @retval None
+ */
+static void readBlock(uint8_t sector, uint32_t offset, logBlock_t *block)
+{
+  block->state = BLOCK_CORRUPT;
+
+  if (offset + LOG_BLOCK_HEADER_SIZE > LOG_FLASH_SECTOR_SIZE)
+  {
+    block->state = BLOCK_END;
+    return;
+  }
+
+  uint32_t header = getLE32(LOG_HAL_Read(sector, offset));
+  if (header == LOG_FLASH_ERASED_WORD)
+  {
+    block->state = BLOCK_END;
+    return;
+  }
+
+  uint8_t words = (uint8_t)(header >> 8);
+  uint8_t count = (uint8_t)(header >> 16);
+
+  if ((uint8_t)header != LOG_BLOCK_MAGIC || count == 0U || count > LOG_BLOCK_MAX_RECORDS ||
+      words != (bodySize(count) + 3U) / 4U)
+  {
+    return;
+  }
+
+  block->body = LOG_HAL_Read(sector, offset + LOG_BLOCK_HEADER_SIZE);
+  block->count = count;
+  block->totalSize = LOG_BLOCK_HEADER_SIZE + words * 4U;
+
+  if (offset + block->totalSize > LOG_FLASH_SECTOR_SIZE)
+  {
+    return;
+  }
+
+  block->state = (crc8(block->body, bodySize(count)) == (uint8_t)(header >> 24)) ? BLOCK_VALID : BLOCK_TORN;
+}
+
+/**
+ * @brief  Walks the blocks of a sector to find where the next block goes.
+ *         A corrupt header makes the rest of the sector unusable, the sector is then reported full.
+ * @param  uint8_t sector: Sector index.
+ * @param  bool countBlocks: true to add valid and torn blocks to the status counters.
+ * @retval uint32_t: Offset of the first free byte, LOG_FLASH_SECTOR_SIZE if full.
+ */
+static uint32_t scanSector(uint8_t sector, bool countBlocks)
+{
+  uint32_t offset = LOG_SECTOR_HEADER_SIZE;
+  logBlock_t block;
+
+  for (;;)
+  {
+    readBlock(sector, offset, &block);
+
+    if (block.state == BLOCK_END)
+    {
+      return offset;
+    }
+    if (block.state == BLOCK_CORRUPT)
+    {
+      return LOG_FLASH_SECTOR_SIZE;
+    }
+
+    if (countBlocks)
+    {
+      if (block.state == BLOCK_VALID)
+      {
+        status.blocks++;
+      }
+      else
+      {
+        status.tornBlocks++;
+      }
+    }
+    offset += block.totalSize;
+  }
+}
+
+/**
+ * @brief  Moves the head to the next sector, dropping its oldest data.
+ *         The sector is erased here only if the background pre-erase did not leave it blank.
+ * @param  None
+ * @retval bool: true if the new head sector is ready, false if an erase is running or failed.
+ */
+static bool openNextSector(void)
+{
+  uint8_t next = (uint8_t)((headSector + 1U) % LOG_FLASH_SECTOR_COUNT);
+  uint32_t sequence = status.headSequence + 1U;
+  uint32_t header[LOG_SECTOR_HEADER_SIZE / sizeof(uint32_t)] = {LOG_SECTOR_MAGIC, sequence, ~sequence};
+
+  if (LOG_HAL_IsEraseBusy())
+  {
+    return false;
+  }
+
+  if (!isSectorBlank(next))
+  {
+    if (!LOG_HAL_EraseSector(next, false))
+    {
+      return false;
+    }
+    status.erases++;
+  }
+
+  if (!LOG_HAL_Program(next, 0, header, LOG_SECTOR_HEADER_SIZE / sizeof(uint32_t)))
+  {
+    return false;
+  }
+
+  headSector = next;
+  status.headSequence = sequence;
+  writeOffset = LOG_SECTOR_HEADER_SIZE;
+  preEraseRequested = false;
+
+  return true;
+}
+
+/**
+ * @brief  Starts the background erase of the next sector once the head sector is mostly full,
+ *         so the sector switch does not stall the main loop for the erase time.
+ * @param  None
+ * @retval None
+ */
+static void preEraseNextSector(void)
+{
+  uint8_t next = (uint8_t)((headSector + 1U) % LOG_FLASH_SECTOR_COUNT);
+
+  if (preEraseRequested || writeOffset < (LOG_FLASH_SECTOR_SIZE / 100U) * LOG_PREERASE_THRESHOLD_PERCENT)
+  {
+    return;
+  }
+
+  preEraseRequested = true;
+  if (*(const uint32_t *)LOG_HAL_Read(next, 0) != LOG_FLASH_ERASED_WORD && LOG_HAL_EraseSector(next, true))
+  {
+    status.erases++;
+  }
+}
+
+/**
+ * @brief  Decodes a block body and visits the records inside the range.
+ * @param  const uint8_t *body: Block body.
+ * @param  uint8_t count: Records in the block.
+ * @param  timestamp_t from: First timestamp of the range.
+ * @param  timestamp_t to: Last timestamp of the range.
+ * @param  logVisitor_t visitor: Called for each record in the range.
+ * @param  void *context: Passed to the visitor.
+ * @param  uint32_t *visited: Incremented for each visited record.
+ * @retval bool: false once the range end is passed or the visitor asked to stop.
+ */
+static bool decodeBlock(const uint8_t *body, uint8_t count, timestamp_t from, timestamp_t to,
+                        logVisitor_t visitor, void *context, uint32_t *visited)
+{
+  logRecord_t record;
+
+  record.timestamp = getLE32(body);
+  record.temperature = (int16_t)getLE16(body + 4);
+  record.humidity = getLE16(body + 6);
+  body += LOG_BLOCK_BASE_SIZE;
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if (i > 0U)
+    {
+      record.timestamp += body[0];
+      record.temperature = (int16_t)(record.temperature + (int8_t)body[1]);
+      record.humidity = (uint16_t)(record.humidity + (int8_t)body[2]);
+      body += LOG_BLOCK_DELTA_SIZE;
+    }
+
+    if (record.timestamp > to)
+    {
+      return false;
+    }
+    if (record.timestamp >= from)
+    {
+      (*visited)++;
+      if (!visitor(&record, context))
+      {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Scans the log area and resumes appending after the last complete block.
+ *         The head is the valid sector with the highest sequence number; torn blocks are counted and
+ *         skipped by their length, so a reset in the middle of a write only loses that block.
+ * @param  None
+ * @retval bool: true if the log is ready, false on a flash error.
+ */
+bool API_LOG_Init(void)
+{
+  bool found = false;
+  uint32_t sequence;
+
+  memset(&status, 0, sizeof(status));
+  stagingSize = 0;
+  stagingCount = 0;
+  preEraseRequested = false;
+
+  LOG_HAL_Init();
+
+  for (uint8_t sector = 0; sector < LOG_FLASH_SECTOR_COUNT; sector++)
+  {
+    if (readSectorSequence(sector, &sequence))
+    {
+      if (!found || sequence > status.headSequence)
+      {
+        headSector = sector;
+        status.headSequence = sequence;
+      }
+      found = true;
+      scanSector(sector, true);
+    }
+  }
+
+  if (!found)
+  {
+    // Empty or foreign area: format by opening sector 0 with sequence 1
+    headSector = LOG_FLASH_SECTOR_COUNT - 1U;
+    status.headSequence = 0;
+    return openNextSector();
+  }
+
+  writeOffset = scanSector(headSector, false);
+
+  return true;
+}
+
+/**
+ * @brief  Appends a record to the RAM staging block, flushing the block first if it is full
+ *         or if the record cannot be delta-encoded against the previous one.
+ * @param  record: Record to append.
+ * @retval bool: true if the record was staged, false if it was dropped.
+ */
+bool API_LOG_Append(const logRecord_t *record)
+{
+  if (record == NULL)
+  {
+    return false;
+  }
+
+  if (stagingCount > 0U)
+  {
+    uint32_t deltaTime = record->timestamp - stagingLast.timestamp;
+    int32_t deltaTemperature = (int32_t)record->temperature - stagingLast.temperature;
+    int32_t deltaHumidity = (int32_t)record->humidity - stagingLast.humidity;
+
+    if (record->timestamp >= stagingLast.timestamp && deltaTime <= UINT8_MAX &&
+        deltaTemperature >= INT8_MIN && deltaTemperature <= INT8_MAX &&
+        deltaHumidity >= INT8_MIN && deltaHumidity <= INT8_MAX && stagingCount < LOG_BLOCK_MAX_RECORDS)
+    {
+      stagingBytes[stagingSize] = (uint8_t)deltaTime;
+      stagingBytes[stagingSize + 1U] = (uint8_t)(int8_t)deltaTemperature;
+      stagingBytes[stagingSize + 2U] = (uint8_t)(int8_t)deltaHumidity;
+      stagingSize += LOG_BLOCK_DELTA_SIZE;
+      stagingCount++;
+      stagingLast = *record;
+      return true;
+    }
+
+    if (!API_LOG_Flush())
+    {
+      status.dropped++;
+      return false;
+    }
+  }
+
+  putLE32(stagingBytes, record->timestamp);
+  putLE16(stagingBytes + 4, (uint16_t)record->temperature);
+  putLE16(stagingBytes + 6, record->humidity);
+  stagingSize = LOG_BLOCK_BASE_SIZE;
+  stagingCount = 1;
+  stagingLast = *record;
+
+  return true;
+}
+
+/**
+ * @brief  Writes the staging block to flash: header word first, then the body. A reset in between
+ *         leaves a header whose CRC does not match, which the recovery scan skips.
+ * @param  None
+ * @retval bool: true if the staging block is empty afterwards.
+ */
+bool API_LOG_Flush(void)
+{
+  if (stagingCount == 0U)
+  {
+    return true;
+  }
+
+  if (LOG_HAL_IsEraseBusy())
+  {
+    return false;
+  }
+
+  uint8_t bodyWords = (uint8_t)((stagingSize + 3U) / 4U);
+  uint32_t blockSize = LOG_BLOCK_HEADER_SIZE + bodyWords * 4U;
+
+  if (writeOffset + blockSize > LOG_FLASH_SECTOR_SIZE && !openNextSector())
+  {
+    return false;
+  }
+
+  // Pad with the erased value so the padding bytes are left unprogrammed
+  memset(stagingBytes + stagingSize, 0xFF, bodyWords * 4U - stagingSize);
+
+  uint32_t header = LOG_BLOCK_MAGIC | ((uint32_t)bodyWords << 8) | ((uint32_t)stagingCount << 16) |
+                    ((uint32_t)crc8(stagingBytes, stagingSize) << 24);
+  bool written = LOG_HAL_Program(headSector, writeOffset, &header, 1) &&
+                 LOG_HAL_Program(headSector, writeOffset + LOG_BLOCK_HEADER_SIZE, stagingWords, bodyWords);
+
+  // A failed write still consumed the space, the block is skipped as torn on the next scan
+  writeOffset += blockSize;
+  if (written)
+  {
+    status.blocks++;
+  }
+  else
+  {
+    status.dropped += stagingCount;
+  }
+  stagingSize = 0;
+  stagingCount = 0;
+
+  preEraseNextSector();
+
+  return true;
+}
+
+/**
+ * @brief  Visits the logged records with from <= timestamp <= to, oldest first, including the staged ones.
+ *         Sectors whose successor starts before the range are skipped from their header, and blocks
+ *         whose successor starts before the range are skipped without decoding.
+ * @param  from: First timestamp of the range.
+ * @param  to: Last timestamp of the range.
+ * @param  visitor: Called for each record.
+ * @param  context: Passed to the visitor.
+ * @retval uint32_t: Number of records visited.
+ */
+uint32_t API_LOG_ReadRange(timestamp_t from, timestamp_t to, logVisitor_t visitor, void *context)
+{
+  uint8_t order[LOG_FLASH_SECTOR_COUNT];
+  uint8_t sectors = 0;
+  uint32_t visited = 0;
+  uint32_t sequence;
+  logBlock_t block;
+  logBlock_t next;
+
+  if (visitor == NULL || from > to)
+  {
+    return 0;
+  }
+
+  // Oldest sector first: the ring order starts right after the head
+  for (uint8_t i = 1; i <= LOG_FLASH_SECTOR_COUNT; i++)
+  {
+    uint8_t sector = (uint8_t)((headSector + i) % LOG_FLASH_SECTOR_COUNT);
+
+    if (readSectorSequence(sector, &sequence) && sequence <= status.headSequence)
+    {
+      order[sectors++] = sector;
+    }
+  }
+
+  for (uint8_t i = 0; i < sectors; i++)
+  {
+    if (i + 1U < sectors)
+    {
+      readBlock(order[i + 1U], LOG_SECTOR_HEADER_SIZE, &next);
+      if (next.state == BLOCK_VALID && getLE32(next.body) < from)
+      {
+        continue;
+      }
+    }
+
+    uint32_t offset = LOG_SECTOR_HEADER_SIZE;
+    readBlock(order[i], offset, &block);
+
+    while (block.state == BLOCK_VALID || block.state == BLOCK_TORN)
+    {
+      readBlock(order[i], offset + block.totalSize, &next);
+
+      bool skip = (block.state == BLOCK_TORN) || (next.state == BLOCK_VALID && getLE32(next.body) < from);
+      if (!skip && !decodeBlock(block.body, block.count, from, to, visitor, context, &visited))
+      {
+        return visited;
+      }
+
+      offset += block.totalSize;
+      block = next;
+    }
+  }
+
+  if (stagingCount > 0U)
+  {
+    decodeBlock(stagingBytes, stagingCount, from, to, visitor, context, &visited);
+  }
+
+  return visited;
+}
+
+/**
+ * @brief  Returns the recovery and wear counters.
+ * @param  None
+ * @retval logStatus_t: Counters.
+ */
+logStatus_t API_LOG_GetStatus(void)
+{
+  return status;
+}
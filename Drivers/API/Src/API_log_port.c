@@ -0,0 +1,141 @@
+/* Includes ------------------------------------------------------------------*/
+#include "API_log_port.h"
+
+/* Private variable ----------------------------------------------------------*/
+
+static volatile bool eraseBusy = false;
+
+/* Public functions ----------------------------------------------------------*/
+
+/**
+ * @brief  Enables the flash interrupt used by background sector erases.
+ * @param  None
+ * @retval None
+ */
+void LOG_HAL_Init(void)
+{
+  HAL_NVIC_SetPriority(FLASH_IRQn, LOG_FLASH_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(FLASH_IRQn);
+}
+
+/**
+ * @brief  Erases one sector of the log area. The area sits in bank 2 and the code in bank 1,
+ *         so a background erase does not stall instruction fetches.
+ * @param  uint8_t sector: Sector index inside the log area (0 .. LOG_FLASH_SECTOR_COUNT - 1).
+ * @param  bool background: true to start an interrupt-driven erase and return at once, false to wait for it.
+ * @retval bool: true if the erase completed (blocking) or started (background), false on error.
+ */
+bool LOG_HAL_EraseSector(uint8_t sector, bool background)
+{
+  FLASH_EraseInitTypeDef erase = {
+      .TypeErase = FLASH_TYPEERASE_SECTORS,
+      .Banks = FLASH_BANK_2,
+      .Sector = LOG_FLASH_FIRST_SECTOR + sector,
+      .NbSectors = 1,
+      .VoltageRange = FLASH_VOLTAGE_RANGE_3,
+  };
+  uint32_t sectorError = 0;
+  HAL_StatusTypeDef status;
+
+  if (sector >= LOG_FLASH_SECTOR_COUNT || eraseBusy)
+  {
+    return false;
+  }
+
+  HAL_FLASH_Unlock();
+  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR |
+                         FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+
+  if (background)
+  {
+    eraseBusy = true;
+    status = HAL_FLASHEx_Erase_IT(&erase);
+    if (status != HAL_OK)
+    {
+      eraseBusy = false;
+      HAL_FLASH_Lock();
+    }
+    return status == HAL_OK;
+  }
+
+  status = HAL_FLASHEx_Erase(&erase, &sectorError);
+  HAL_FLASH_Lock();
+
+  return status == HAL_OK;
+}
+
+/**
+ * @brief  Tells whether a background erase is still running.
+ * @param  None
+ * @retval bool: true while the flash controller is busy with an erase.
+ */
+bool LOG_HAL_IsEraseBusy(void)
+{
+  return eraseBusy;
+}
+
+/**
+ * @brief  Programs consecutive 32-bit words. The target words must be erased.
+ * @param  uint8_t sector: Sector index inside the log area.
+ * @param  uint32_t offset: Byte offset inside the sector, word aligned.
+ * @param  const uint32_t *words: Words to program.
+ * @param  uint16_t count: Number of words.
+ * @retval bool: true on success, false on error.
+ */
+bool LOG_HAL_Program(uint8_t sector, uint32_t offset, const uint32_t *words, uint16_t count)
+{
+  uint32_t address = (uint32_t)LOG_HAL_Read(sector, offset);
+  HAL_StatusTypeDef status = HAL_OK;
+
+  if (sector >= LOG_FLASH_SECTOR_COUNT || eraseBusy)
+  {
+    return false;
+  }
+
+  HAL_FLASH_Unlock();
+  for (uint16_t i = 0; i < count && status == HAL_OK; i++)
+  {
+    status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address + i * sizeof(uint32_t), words[i]);
+  }
+  HAL_FLASH_Lock();
+
+  return status == HAL_OK;
+}
+
+/**
+ * @brief  Returns a read pointer into the memory-mapped log area.
+ * @param  uint8_t sector: Sector index inside the log area.
+ * @param  uint32_t offset: Byte offset inside the sector.
+ * @retval const uint8_t *: Address of the byte.
+ */
+const uint8_t *LOG_HAL_Read(uint8_t sector, uint32_t offset)
+{
+  return (const uint8_t *)_slogflash + (uint32_t)sector * LOG_FLASH_SECTOR_SIZE + offset;
+}
+
+/**
+ * @brief  HAL callback, end of a background erase. The sector number is reported first,
+ *         0xFFFFFFFF once the whole procedure completed.
+ * @param  uint32_t ReturnValue: Erased sector, or 0xFFFFFFFF at the end of the procedure.
+ * @retval None
+ */
+void HAL_FLASH_EndOfOperationCallback(uint32_t ReturnValue)
+{
+  if (ReturnValue == LOG_FLASH_ERASED_WORD)
+  {
+    HAL_FLASH_Lock();
+    eraseBusy = false;
+  }
+}
+
+/**
+ * @brief  HAL callback, a background erase failed. The sector is left for the next recovery scan.
+ * @param  uint32_t ReturnValue: Faulty sector.
+ * @retval None
+ */
+void HAL_FLASH_OperationErrorCallback(uint32_t ReturnValue)
+{
+  (void)ReturnValue;
+  HAL_FLASH_Lock();
+  eraseBusy = false;
+}
@@ -0,0 +1,261 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "stm32f4xx_hal.h" /* <- HAL include, CMSIS interrupt masking */
+#include "API_mem.h"
+
+/* Private macro -------------------------------------------------------------*/
+
+#define MEM_MAP_WORDS(count) (((count) + 31U) / 32U)
+
+_Static_assert(MEM_MESSAGE_BLOCK_SIZE % MEM_ALIGN == 0U, "pool block sizes must be multiples of MEM_ALIGN");
+_Static_assert(MEM_MESSAGE_BLOCK_SIZE >= sizeof(void *), "pool blocks must hold the free-list link");
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief Free blocks are chained through their own first word, so the free list costs no extra RAM.
+ */
+typedef struct memFreeBlock
+{
+  struct memFreeBlock *next;
+} memFreeBlock_t;
+
+typedef struct
+{
+  uint8_t *storage;
+  uint16_t blockSize;
+  uint16_t blockCount;
+  uint32_t *allocated; // One bit per block, catches double and foreign frees
+  memFreeBlock_t *freeList;
+  memStats_t stats;
+} memPoolState_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+// uint64_t storage: MEM_ALIGN (8) alignment without compiler attributes
+static uint64_t messageStorage[MEM_MESSAGE_BLOCK_SIZE * MEM_MESSAGE_BLOCK_COUNT / sizeof(uint64_t)];
+static uint32_t messageMap[MEM_MAP_WORDS(MEM_MESSAGE_BLOCK_COUNT)];
+
+static memPoolState_t pools[MEM_POOL_COUNT] = {
+    [MEM_POOL_MESSAGE] = {(uint8_t *)messageStorage, MEM_MESSAGE_BLOCK_SIZE, MEM_MESSAGE_BLOCK_COUNT, messageMap},
+};
+
+static memStats_t heapStats;
+static bool sealed;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void noteUse(memStats_t *stats, uint32_t used);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Updates the occupancy and its high-water mark.
+ * @param  memStats_t *stats: Statistics to update.
+ * @param  uint32_t used: New occupancy.
+ * @retval None
+ */
+static void noteUse(memStats_t *stats, uint32_t used)
+{
+  stats->used = used;
+  if (used > stats->highWater)
+  {
+    stats->highWater = used;
+  }
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Empties every pool and unseals the heap.
+ * @param  None
+ * @retval None
+ */
+void API_MEM_Init(void)
+{
+  sealed = false;
+
+  for (memPool_t pool = 0; pool < MEM_POOL_COUNT; pool++)
+  {
+    memPoolState_t *state = &pools[pool];
+
+    memset(state->allocated, 0, MEM_MAP_WORDS(state->blockCount) * sizeof(uint32_t));
+    memset(&state->stats, 0, sizeof(state->stats));
+    state->stats.capacity = state->blockCount;
+
+    // Chain the blocks in address order
+    state->freeList = NULL;
+    for (uint16_t i = state->blockCount; i > 0U; i--)
+    {
+      memFreeBlock_t *block = (memFreeBlock_t *)(state->storage + (uint32_t)(i - 1U) * state->blockSize);
+      block->next = state->freeList;
+      state->freeList = block;
+    }
+  }
+}
+
+/**
+ * @brief  Ends initialisation: no more C library heap allocations.
+ * @param  None
+ * @retval None
+ */
+void API_MEM_Seal(void)
+{
+  sealed = true;
+}
+
+/**
+ * @brief  Tells whether the heap is sealed.
+ * @param  None
+ * @retval bool: true once sealed.
+ */
+bool API_MEM_IsSealed(void)
+{
+  return sealed;
+}
+
+/**
+ * @brief  Pops the head of the pool's free list, with interrupts masked for the few instructions it takes.
+ * @param  pool: Pool.
+ * @retval void *: Block, NULL if exhausted.
+ */
+void *API_MEM_PoolAlloc(memPool_t pool)
+{
+  memPoolState_t *state;
+  memFreeBlock_t *block;
+  uint32_t primask;
+
+  if (pool >= MEM_POOL_COUNT)
+  {
+    return NULL;
+  }
+
+  state = &pools[pool];
+  primask = __get_PRIMASK();
+  __disable_irq();
+
+  block = state->freeList;
+  if (block == NULL)
+  {
+    state->stats.failures++;
+  }
+  else
+  {
+    uint32_t index = (uint32_t)((uint8_t *)block - state->storage) / state->blockSize;
+
+    state->freeList = block->next;
+    state->allocated[index / 32U] |= 1UL << (index % 32U);
+    noteUse(&state->stats, state->stats.used + 1U);
+  }
+
+  __set_PRIMASK(primask);
+
+  return block;
+}
+
+/**
+ * @brief  Pushes a block back on the pool's free list after checking it belongs to the pool and is in use.
+ * @param  pool: Pool.
+ * @param  block: Block to release.
+ * @retval bool: true on success, false for an invalid release.
+ */
+bool API_MEM_PoolFree(memPool_t pool, void *block)
+{
+  memPoolState_t *state;
+  uintptr_t offset;
+  uint32_t index;
+  uint32_t primask;
+  bool released = false;
+
+  if (pool >= MEM_POOL_COUNT)
+  {
+    return false;
+  }
+
+  state = &pools[pool];
+  offset = (uintptr_t)block - (uintptr_t)state->storage;
+  index = (uint32_t)(offset / state->blockSize);
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+
+  if ((uintptr_t)block >= (uintptr_t)state->storage && offset % state->blockSize == 0U &&
+      index < state->blockCount && (state->allocated[index / 32U] & (1UL << (index % 32U))) != 0U)
+  {
+    memFreeBlock_t *freed = block;
+
+    state->allocated[index / 32U] &= ~(1UL << (index % 32U));
+    freed->next = state->freeList;
+    state->freeList = freed;
+    state->stats.used--;
+    released = true;
+  }
+  else
+  {
+    state->stats.failures++;
+  }
+
+  __set_PRIMASK(primask);
+
+  return released;
+}
+
+/**
+ * @brief  Returns the block size of a pool.
+ * @param  pool: Pool.
+ * @retval uint16_t: Bytes per block, 0 for an invalid pool.
+ */
+uint16_t API_MEM_PoolBlockSize(memPool_t pool)
+{
+  return (pool < MEM_POOL_COUNT) ? pools[pool].blockSize : 0U;
+}
+
+/**
+ * @brief  Reads the statistics of a pool.
+ * @param  pool: Pool.
+ * @param  stats: Pool occupancy in blocks.
+ * @retval bool: true on success, false for an invalid pool.
+ */
+bool API_MEM_GetPoolStats(memPool_t pool, memStats_t *stats)
+{
+  uint32_t primask;
+
+  if (pool >= MEM_POOL_COUNT)
+  {
+    return false;
+  }
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  *stats = pools[pool].stats;
+  __set_PRIMASK(primask);
+
+  return true;
+}
+
+/**
+ * @brief  Accounts a C library heap request: granted before the seal, refused and counted after it.
+ * @param  increment: Bytes requested.
+ * @retval bool: true to grant it.
+ */
+bool API_MEM_HeapRequest(ptrdiff_t increment)
+{
+  if (sealed && increment > 0)
+  {
+    heapStats.failures++;
+    return false;
+  }
+
+  noteUse(&heapStats, (uint32_t)((ptrdiff_t)heapStats.used + increment));
+  return true;
+}
+
+/**
+ * @brief  Reads the C library heap statistics.
+ * @param  stats: Heap usage in bytes.
+ * @retval None
+ */
+void API_MEM_GetHeapStats(memStats_t *stats)
+{
+  *stats = heapStats;
+}
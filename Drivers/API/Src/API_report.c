@@ -0,0 +1,168 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include <math.h>
+
+#include "API_report.h"
+#include "API_section.h"
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  float deadband;
+  float lastSentValue;
+  uint32_t lastSentMs;
+  bool hasSent;          // False until the first report, which is always sent
+  bool forced;           // Set by API_REPORT_ForceNext
+  reportCounters_t counters;
+} reportChannelState_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+API_CCM_BSS static reportChannelState_t channels[REPORT_CHANNEL_COUNT];
+static uint32_t heartbeatIntervalMs;
+static bool exceptionMode = true;
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Resets all channels and counters and sets the heartbeat interval.
+ *         Deadbands are reset to 0, so any change is reported until they are configured.
+ * @param  heartbeatMs: Maximum time between two reports of the same channel.
+ * @retval None
+ */
+void API_REPORT_Init(uint32_t heartbeatMs)
+{
+  memset(channels, 0, sizeof(channels));
+  heartbeatIntervalMs = heartbeatMs;
+  exceptionMode = true;
+}
+
+/**
+ * @brief  Enables or disables report-by-exception. When disabled every sample is reported.
+ * @param  enabled: true to suppress unchanged samples.
+ * @retval None
+ */
+void API_REPORT_SetExceptionMode(bool enabled)
+{
+  exceptionMode = enabled;
+}
+
+/**
+ * @brief  Sets the heartbeat (maximum silent) interval.
+ * @param  heartbeatMs: Interval in milliseconds.
+ * @retval None
+ */
+void API_REPORT_SetHeartbeat(uint32_t heartbeatMs)
+{
+  heartbeatIntervalMs = heartbeatMs;
+}
+
+/**
+ * @brief  Sets the deadband of a channel, in the channel's unit.
+ * @param  channel: Channel to configure.
+ * @param  deadband: Minimum change from the last sent value that triggers a report.
+ * @retval None
+ */
+void API_REPORT_SetDeadband(reportChannel_t channel, float deadband)
+{
+  if (channel < REPORT_CHANNEL_COUNT && deadband >= 0.0f)
+  {
+    channels[channel].deadband = deadband;
+  }
+}
+
+/**
+ * @brief  Forces the next evaluation of every channel to report, used on state-change events.
+ * @param  None
+ * @retval None
+ */
+void API_REPORT_ForceNext(void)
+{
+  for (reportChannel_t channel = 0; channel < REPORT_CHANNEL_COUNT; channel++)
+  {
+    channels[channel].forced = true;
+  }
+}
+
+/**
+ * @brief  Decides whether a sample has to be sent and updates the channel's counters.
+ *         The deadband is measured against the last value actually sent, not the previous sample,
+ *         so a slow drift is still reported once it accumulates past the deadband.
+ * @param  channel: Channel the sample belongs to.
+ * @param  value: Sample value.
+ * @param  nowMs: Sample time in milliseconds.
+ * @retval reportReason_t: REPORT_SUPPRESSED if the sample must not be sent, the send reason otherwise.
+ */
+reportReason_t API_REPORT_Evaluate(reportChannel_t channel, float value, uint32_t nowMs)
+{
+  if (channel >= REPORT_CHANNEL_COUNT)
+  {
+    return REPORT_SUPPRESSED;
+  }
+
+  reportChannelState_t *state = &channels[channel];
+  reportReason_t reason = REPORT_SUPPRESSED;
+
+  if (!exceptionMode || !state->hasSent || state->forced)
+  {
+    reason = REPORT_EVENT;
+  }
+  else if (fabsf(value - state->lastSentValue) >= state->deadband)
+  {
+    reason = REPORT_CHANGE;
+  }
+  else if ((nowMs - state->lastSentMs) >= heartbeatIntervalMs)
+  {
+    reason = REPORT_HEARTBEAT;
+  }
+
+  if (reason == REPORT_SUPPRESSED)
+  {
+    state->counters.suppressed++;
+    return REPORT_SUPPRESSED;
+  }
+
+  state->lastSentValue = value;
+  state->lastSentMs = nowMs;
+  state->hasSent = true;
+  state->forced = false;
+  state->counters.sent++;
+
+  return reason;
+}
+
+/**
+ * @brief  Returns the counters of a channel.
+ * @param  channel: Channel to query.
+ * @retval reportCounters_t: Sent and suppressed report counts.
+ */
+reportCounters_t API_REPORT_GetCounters(reportChannel_t channel)
+{
+  reportCounters_t empty = {0};
+
+  if (channel >= REPORT_CHANNEL_COUNT)
+  {
+    return empty;
+  }
+
+  return channels[channel].counters;
+}
+
+/**
+ * @brief  Returns the counters summed over all channels.
+ * @param  None
+ * @retval reportCounters_t: Total sent and suppressed report counts.
+ */
+reportCounters_t API_REPORT_GetTotals(void)
+{
+  reportCounters_t totals = {0};
+
+  for (reportChannel_t channel = 0; channel < REPORT_CHANNEL_COUNT; channel++)
+  {
+    totals.sent += channels[channel].counters.sent;
+    totals.suppressed += channels[channel].counters.suppressed;
+  }
+
+  return totals;
+}
@@ -0,0 +1,457 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "API_sampler.h"
+#include "API_sampler_port.h"
+#include "API_section.h"
+
+/* Private define ------------------------------------------------------------*/
+
+#define SAMPLER_READ_COMMAND (PRESSURE_MSB_REG | READ_CMD_BIT)
+#define SAMPLER_DATA_OFFSET 1U // The byte clocked in during the address byte carries nothing
+
+// A deviation past the shortest period is a lost trigger, not jitter: clamping there also bounds the squares
+#define SAMPLER_JITTER_LIMIT_NS ((int64_t)SAMPLER_PERIOD_US * SAMPLER_NS_PER_US)
+
+// Updates after a period change whose interval may still have the old period: the change can land just after
+// an update whose interrupt has not run yet
+#define SAMPLER_PERIOD_SETTLE_TRIGGERS 2U
+
+/* Private types -------------------------------------------------------------*/
+
+typedef enum
+{
+  SAMPLER_BUS_IDLE,    // SPI1 free
+  SAMPLER_BUS_READING, // DMA read running
+  SAMPLER_BUS_HELD,    // Taken by the main loop for the SD card
+} samplerBus_t;
+
+/**
+ * @brief Ring slot, filled in place by the receive DMA.
+ */
+typedef struct
+{
+  uint32_t tick;                      // Read start in ms
+  uint8_t frame[SAMPLER_FRAME_SIZE];  // As received: address byte slot, then 0xF7 to 0xFE
+} samplerSlot_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+// Read and written by the SPI1 DMA: SRAM, never CCM
+API_DMA_BSS static samplerSlot_t slots[SAMPLER_QUEUE_DEPTH];
+API_DMA_BSS static uint8_t command[SAMPLER_FRAME_SIZE];
+
+static spscQueue_t queue; // Producer: the interrupts, consumer: API_SAMPLER_Read
+static volatile samplerBus_t busState;
+static volatile bool triggerPending; // Trigger deferred while the main loop holds SPI1
+static samplerStatus_t status;
+static bool initialised;
+
+// Period change: applied to the bookkeeping on the next updates, the timer reloads it by itself
+static uint32_t pendingPeriodUs;
+static volatile uint32_t settleTriggers;
+
+// Jitter: cycle counter at the last read start, valid while no trigger was lost since
+static uint32_t cyclesPerUs;
+static uint32_t periodCycles;
+static uint32_t lastStartCycles;
+static bool lastStartValid;
+static uint32_t readStartCycles; // Cycle counter at the start of the read running, for the hung read timeout
+
+static struct
+{
+  uint32_t intervals;
+  int32_t minNs;
+  int32_t maxNs;
+  uint64_t sumSquares; // ns^2, deviations clamped to SAMPLER_JITTER_LIMIT_NS so that a window of hours cannot overflow
+} window;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void resetWindow(void);
+static void recordStart(uint32_t cycles);
+static void startRead(void);
+static void applyPeriod(uint32_t periodUs);
+static uint32_t squareRoot(uint64_t value);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Empties the jitter window.
+ * @param  None
+ * @retval None
+ */
+static void resetWindow(void)
+{
+  window.intervals = 0;
+  window.minNs = INT32_MAX;
+  window.maxNs = INT32_MIN;
+  window.sumSquares = 0;
+}
+
+/**
+ * @brief  Adds the interval since the previous read start to the jitter window.
+ * @param  uint32_t cycles: Cycle counter at this read start.
+ * @retval None
+ */
+static void recordStart(uint32_t cycles)
+{
+  if (lastStartValid)
+  {
+    int64_t deviationNs = (int64_t)(int32_t)(cycles - lastStartCycles - periodCycles) * SAMPLER_NS_PER_US / cyclesPerUs;
+
+    if (deviationNs > SAMPLER_JITTER_LIMIT_NS)
+    {
+      deviationNs = SAMPLER_JITTER_LIMIT_NS;
+    }
+    else if (deviationNs < -SAMPLER_JITTER_LIMIT_NS)
+    {
+      deviationNs = -SAMPLER_JITTER_LIMIT_NS;
+    }
+
+    window.intervals++;
+    window.sumSquares += (uint64_t)(deviationNs * deviationNs);
+    if ((int32_t)deviationNs < window.minNs)
+    {
+      window.minNs = (int32_t)deviationNs;
+    }
+    if ((int32_t)deviationNs > window.maxNs)
+    {
+      window.maxNs = (int32_t)deviationNs;
+    }
+  }
+
+  lastStartCycles = cycles;
+  lastStartValid = true;
+}
+
+/**
+ * @brief  Claims a ring slot and starts the DMA read into it. The bus state is already SAMPLER_BUS_READING;
+ *         it returns to idle if the read cannot start. Runs in the trigger interrupt or, for a deferred
+ *         trigger, in the main loop with interrupts masked.
+ * @param  None
+ * @retval None
+ */
+static void startRead(void)
+{
+  uint32_t cycles = SAMPLER_HAL_GetCycles();
+  uint32_t count = 1U;
+  samplerSlot_t *slot = API_SPSC_ClaimWrite(&queue, &count);
+
+  if (slot == NULL)
+  {
+    status.dropped++;
+    lastStartValid = false;
+    busState = SAMPLER_BUS_IDLE;
+    return;
+  }
+
+  recordStart(cycles);
+  readStartCycles = cycles;
+  slot->tick = HAL_GetTick();
+  if (!SAMPLER_HAL_StartRead(command, slot->frame, SAMPLER_FRAME_SIZE))
+  {
+    status.errors++;
+    lastStartValid = false;
+    busState = SAMPLER_BUS_IDLE;
+  }
+}
+
+/**
+ * @brief  Takes a new period into the status and the jitter reference.
+ * @param  uint32_t periodUs: Sampling period.
+ * @retval None
+ */
+static void applyPeriod(uint32_t periodUs)
+{
+  status.periodUs = periodUs;
+  periodCycles = periodUs * cyclesPerUs;
+}
+
+/**
+ * @brief  Integer square root, without the double precision library on a single precision FPU.
+ * @param  uint64_t value: Radicand.
+ * @retval uint32_t: floor(sqrt(value)).
+ */
+static uint32_t squareRoot(uint64_t value)
+{
+  uint64_t root = 0;
+  uint64_t bit = 1ULL << 62;
+
+  while (bit > value)
+  {
+    bit >>= 2;
+  }
+
+  while (bit != 0U)
+  {
+    if (value >= root + bit)
+    {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+    {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+
+  return (uint32_t)root;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Configures the timer, the SPI DMA streams and the cycle counter. Call once the BME280 is initialised.
+ * @param  periodUs: Sampling period.
+ * @retval bool: true on success.
+ */
+bool API_SAMPLER_Init(uint32_t periodUs)
+{
+  memset(&status, 0, sizeof(status));
+  status.periodUs = periodUs;
+  busState = SAMPLER_BUS_IDLE;
+  triggerPending = false;
+  lastStartValid = false;
+  settleTriggers = 0;
+  initialised = false;
+  resetWindow();
+
+  memset(command, 0, sizeof(command));
+  command[0] = SAMPLER_READ_COMMAND;
+  API_SPSC_Init(&queue, slots, SAMPLER_QUEUE_DEPTH, sizeof(samplerSlot_t));
+
+  if (!SAMPLER_HAL_Init(periodUs))
+  {
+    return false;
+  }
+
+  cyclesPerUs = SAMPLER_HAL_GetCyclesPerUs();
+  applyPeriod(periodUs);
+  initialised = true;
+
+  return true;
+}
+
+/**
+ * @brief  Starts the timer: the first read is triggered one period later.
+ * @param  None
+ * @retval None
+ */
+void API_SAMPLER_Start(void)
+{
+  status.running = true;
+  SAMPLER_HAL_Start();
+}
+
+/**
+ * @brief  Changes the sampling period from the next timer update on.
+ * @param  periodUs: Sampling period, a multiple of SAMPLER_HAL_US_PER_COUNT up to SAMPLER_HAL_PERIOD_MAX_US.
+ * @retval bool: false if the period is out of range or the sampler is not initialised, the period is unchanged.
+ */
+bool API_SAMPLER_SetPeriod(uint32_t periodUs)
+{
+  uint32_t primask;
+
+  if (!initialised || periodUs == 0U || periodUs > SAMPLER_HAL_PERIOD_MAX_US ||
+      (periodUs % SAMPLER_HAL_US_PER_COUNT) != 0U)
+  {
+    return false;
+  }
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  SAMPLER_HAL_SetPeriod(periodUs);
+  pendingPeriodUs = periodUs;
+  settleTriggers = SAMPLER_PERIOD_SETTLE_TRIGGERS;
+  __set_PRIMASK(primask);
+
+  return true;
+}
+
+/**
+ * @brief  Takes the oldest completed read. Call from the main loop.
+ * @param  read: Receives the read.
+ * @retval bool: false if no read is waiting.
+ */
+bool API_SAMPLER_Read(samplerRead_t *read)
+{
+  uint32_t count = 1U;
+  const samplerSlot_t *slot = API_SPSC_ClaimRead(&queue, &count);
+
+  if (slot == NULL)
+  {
+    return false;
+  }
+
+  read->tick = slot->tick;
+  memcpy(read->data, &slot->frame[SAMPLER_DATA_OFFSET], RAW_OUTPUT_DATA_SIZE);
+  API_SPSC_CommitRead(&queue, 1U);
+
+  return true;
+}
+
+/**
+ * @brief  Takes SPI1 for the main loop, for one SD card operation. Triggers from now on are deferred.
+ * @param  None
+ * @retval bool: false while a read is running: try again on the next pass.
+ */
+bool API_SAMPLER_AcquireBus(void)
+{
+  bool acquired = false;
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  if (busState == SAMPLER_BUS_IDLE)
+  {
+    busState = SAMPLER_BUS_HELD;
+    acquired = true;
+  }
+  __set_PRIMASK(primask);
+
+  return acquired;
+}
+
+/**
+ * @brief  Gives SPI1 back and starts the read deferred meanwhile, if any.
+ * @param  None
+ * @retval None
+ */
+void API_SAMPLER_ReleaseBus(void)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  busState = SAMPLER_BUS_IDLE;
+  if (triggerPending)
+  {
+    triggerPending = false;
+    busState = SAMPLER_BUS_READING;
+    startRead();
+  }
+  __set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Returns the acquisition counters.
+ * @param  None
+ * @retval samplerStatus_t: Counters.
+ */
+samplerStatus_t API_SAMPLER_GetStatus(void)
+{
+  samplerStatus_t snapshot;
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  snapshot = status;
+  __set_PRIMASK(primask);
+
+  return snapshot;
+}
+
+/**
+ * @brief  Returns the jitter of the intervals measured since the last call and starts a new window.
+ * @param  None
+ * @retval samplerJitter_t: Jitter of the window.
+ */
+samplerJitter_t API_SAMPLER_TakeJitter(void)
+{
+  samplerJitter_t jitter = {0};
+  uint64_t sumSquares;
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  jitter.intervals = window.intervals;
+  jitter.minNs = window.minNs;
+  jitter.maxNs = window.maxNs;
+  sumSquares = window.sumSquares;
+  resetWindow();
+  __set_PRIMASK(primask);
+
+  if (jitter.intervals == 0U)
+  {
+    jitter.minNs = 0;
+    jitter.maxNs = 0;
+    return jitter;
+  }
+
+  jitter.rmsNs = squareRoot(sumSquares / jitter.intervals);
+
+  return jitter;
+}
+
+/**
+ * @brief  Timer update interrupt: starts a read, or defers or counts it, or aborts a hung one. Called by the port.
+ * @param  None
+ * @retval None
+ */
+void API_SAMPLER_OnTrigger(void)
+{
+  if (settleTriggers != 0U)
+  {
+    settleTriggers--;
+    applyPeriod(pendingPeriodUs);
+    lastStartValid = false;
+  }
+
+  switch (busState)
+  {
+  case SAMPLER_BUS_IDLE:
+    busState = SAMPLER_BUS_READING;
+    startRead();
+    break;
+
+  case SAMPLER_BUS_HELD:
+    // One trigger waits for the bus; a second one while it still waits is lost
+    if (!triggerPending)
+    {
+      triggerPending = true;
+      status.deferred++;
+    }
+    else
+    {
+      status.overruns++;
+      lastStartValid = false;
+    }
+    break;
+
+  default:
+    // The transfer takes microseconds: still running this late, its completion is lost. The slot stays claimed
+    // and the next read refills it.
+    if ((SAMPLER_HAL_GetCycles() - readStartCycles) >= periodCycles / SAMPLER_READ_TIMEOUT_DIV)
+    {
+      SAMPLER_HAL_AbortRead();
+      status.timeouts++;
+      busState = SAMPLER_BUS_IDLE;
+    }
+    else
+    {
+      status.overruns++;
+    }
+    lastStartValid = false;
+    break;
+  }
+}
+
+/**
+ * @brief  SPI DMA completion interrupt: releases the sensor and commits the read. Called by the port.
+ * @param  ok: false if the SPI or DMA reported an error.
+ * @retval None
+ */
+void API_SAMPLER_OnReadDone(bool ok)
+{
+  SAMPLER_HAL_EndRead();
+
+  if (ok)
+  {
+    API_SPSC_CommitWrite(&queue, 1U);
+    status.reads++;
+  }
+  else
+  {
+    status.errors++;
+    lastStartValid = false;
+  }
+
+  busState = SAMPLER_BUS_IDLE;
+}
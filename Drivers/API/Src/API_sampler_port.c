@@ -0,0 +1,159 @@
+/* Includes ------------------------------------------------------------------*/
+#include "API_sampler_port.h"
+#include "API_sampler.h"
+
+/* Private define ------------------------------------------------------------*/
+
+#define SAMPLER_HAL_HZ_PER_MHZ 1000000U
+
+/* Public functions ----------------------------------------------------------*/
+
+/**
+ * @brief  Links the SPI1 DMA streams to hspi1, loads the TIM6 period and starts the DWT cycle counter. TIM6,
+ *         the SPI1 DMA streams and their interrupts are configured by the generated code (MX_TIM6_Init,
+ *         MX_DMA_Init, HAL_SPI_MspInit). The timer is left stopped.
+ * @param  uint32_t periodUs: Update period, a multiple of SAMPLER_HAL_US_PER_COUNT up to SAMPLER_HAL_PERIOD_MAX_US.
+ * @retval bool: true on success.
+ */
+bool SAMPLER_HAL_Init(uint32_t periodUs)
+{
+  // SD_IO_Init runs HAL_SPI_MspInit on the BSP handle of the same SPI1, which links the DMA streams to it: the
+  // completion would then set that handle READY and leave hspi1 busy. Link them back to hspi1.
+  __HAL_LINKDMA(&hspi1, hdmarx, hdma_spi1_rx);
+  __HAL_LINKDMA(&hspi1, hdmatx, hdma_spi1_tx);
+
+  // Re-running the base init on the configured handle reloads ARR through an update event, without the MSP
+  htim6.Init.Period = periodUs / SAMPLER_HAL_US_PER_COUNT - 1U;
+  if (HAL_TIM_Base_Init(&htim6) != HAL_OK)
+  {
+    return false;
+  }
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  return true;
+}
+
+/**
+ * @brief  Starts TIM6. Each update calls API_SAMPLER_OnTrigger.
+ * @param  None
+ * @retval None
+ */
+void SAMPLER_HAL_Start(void)
+{
+  HAL_TIM_Base_Start_IT(&htim6);
+}
+
+/**
+ * @brief  Changes the update period through the preloaded reload register: the interval running completes
+ *         with the old period, the one after the next update uses the new one.
+ * @param  uint32_t periodUs: Update period, as for SAMPLER_HAL_Init.
+ * @retval None
+ */
+void SAMPLER_HAL_SetPeriod(uint32_t periodUs)
+{
+  __HAL_TIM_SET_AUTORELOAD(&htim6, periodUs / SAMPLER_HAL_US_PER_COUNT - 1U);
+}
+
+/**
+ * @brief  Selects the BME280 and starts a full-duplex DMA transfer on SPI1. API_SAMPLER_OnReadDone reports the end.
+ * @param  const uint8_t *tx: Bytes to send, untouched until completion.
+ * @param  uint8_t *rx: Receive buffer in SRAM (API_DMA_BSS), untouched until completion.
+ * @param  uint16_t size: Bytes.
+ * @retval bool: true if the transfer started.
+ */
+bool SAMPLER_HAL_StartRead(const uint8_t *tx, uint8_t *rx, uint16_t size)
+{
+  HAL_GPIO_WritePin(CS_GPIO_Port, CS_Pin, PinStateLow);
+
+  if (HAL_SPI_TransmitReceive_DMA(&hspi1, (uint8_t *)tx, rx, size) != HAL_OK)
+  {
+    HAL_GPIO_WritePin(CS_GPIO_Port, CS_Pin, PinStateHigh);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief  Deselects the BME280 at the end of a transfer.
+ * @param  None
+ * @retval None
+ */
+void SAMPLER_HAL_EndRead(void)
+{
+  HAL_GPIO_WritePin(CS_GPIO_Port, CS_Pin, PinStateHigh);
+}
+
+/**
+ * @brief  Aborts a transfer that never completed: stops both DMA streams and SPI1 and deselects the BME280.
+ *         No callback follows.
+ * @param  None
+ * @retval None
+ */
+void SAMPLER_HAL_AbortRead(void)
+{
+  HAL_SPI_Abort(&hspi1);
+  HAL_GPIO_WritePin(CS_GPIO_Port, CS_Pin, PinStateHigh);
+}
+
+/**
+ * @brief  Reads the core cycle counter.
+ * @param  None
+ * @retval uint32_t: Cycles, wrapping at 2^32 (25 s at 168 MHz).
+ */
+uint32_t SAMPLER_HAL_GetCycles(void)
+{
+  return DWT->CYCCNT;
+}
+
+/**
+ * @brief  Returns the cycle counter rate.
+ * @param  None
+ * @retval uint32_t: Cycles per microsecond.
+ */
+uint32_t SAMPLER_HAL_GetCyclesPerUs(void)
+{
+  return SystemCoreClock / SAMPLER_HAL_HZ_PER_MHZ;
+}
+
+/**
+ * @brief  HAL callback, timer update: the sampling trigger on TIM6.
+ * @param  TIM_HandleTypeDef *htim: Timer handle.
+ * @retval None
+ */
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+  if (htim->Instance == TIM6)
+  {
+    API_SAMPLER_OnTrigger();
+  }
+}
+
+/**
+ * @brief  HAL callback, full-duplex DMA transfer completed: the BME280 burst is in the slot.
+ * @param  SPI_HandleTypeDef *hspi: SPI handle.
+ * @retval None
+ */
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+  if (hspi->Instance == SPI1)
+  {
+    API_SAMPLER_OnReadDone(true);
+  }
+}
+
+/**
+ * @brief  HAL callback, SPI or DMA error: the transfer is aborted.
+ * @param  SPI_HandleTypeDef *hspi: SPI handle.
+ * @retval None
+ */
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+  if (hspi->Instance == SPI1)
+  {
+    API_SAMPLER_OnReadDone(false);
+  }
+}
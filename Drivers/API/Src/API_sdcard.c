@@ -0,0 +1,433 @@
+/* Includes ------------------------------------------------------------------*/
+#include "API_sdcard.h"
+#include "API_sdcard_port.h"
+
+/* Private define ------------------------------------------------------------*/
+
+#define SDCARD_CMD_FRAME_SIZE 6U // Command, 32-bit argument, CRC7 and end bit
+#define SDCARD_R7_SIZE 4U        // Trailing bytes of R3 (OCR) and R7 (interface condition)
+#define SDCARD_CSD_SIZE 16U
+#define SDCARD_CRC16_SIZE 2U     // Data block CRC, sent as 0xFFFF and ignored since CRC is off
+
+#define SDCARD_CSD_V2 1U // CSD_STRUCTURE of high capacity cards
+
+/* Private variables ----------------------------------------------------------*/
+
+static sdcardType_t cardType = SDCARD_TYPE_NONE;
+static uint32_t blockCount;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static uint8_t sdcardCommand(uint8_t command, uint32_t argument);
+static uint8_t sdcardAppCommand(uint8_t command, uint32_t argument);
+static bool sdcardWaitReady(uint32_t timeout);
+static bool sdcardReadData(uint8_t *data, uint16_t size);
+static bool sdcardSendData(uint8_t token, const uint8_t *data);
+static uint32_t sdcardAddress(uint32_t block);
+static uint32_t sdcardCsdBlocks(const uint8_t *csd);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Sends a command frame and waits up to SDCARD_RESPONSE_BYTES for its R1 response. CS must be low.
+ * @param  command: Command index.
+ * @param  argument: 32-bit argument.
+ * @retval uint8_t: R1, or 0xFF if the card did not answer.
+ */
+static uint8_t sdcardCommand(uint8_t command, uint32_t argument)
+{
+  uint8_t frame[SDCARD_CMD_FRAME_SIZE] = {
+      SDCARD_CMD_START | command,
+      (uint8_t)(argument >> 24),
+      (uint8_t)(argument >> 16),
+      (uint8_t)(argument >> 8),
+      (uint8_t)argument,
+      SDCARD_CMD_CRC_DUMMY,
+  };
+  uint8_t response = SDCARD_IDLE_BYTE;
+
+  // Only CMD0 and CMD8 are sent before the card leaves SD mode, where the CRC is checked
+  if (command == SDCARD_CMD0_GO_IDLE_STATE)
+  {
+    frame[SDCARD_CMD_FRAME_SIZE - 1U] = SDCARD_CMD0_CRC;
+  }
+  else if (command == SDCARD_CMD8_SEND_IF_COND)
+  {
+    frame[SDCARD_CMD_FRAME_SIZE - 1U] = SDCARD_CMD8_CRC;
+  }
+
+  SDCARD_HAL_Write(frame, sizeof(frame));
+
+  for (uint8_t i = 0; i < SDCARD_RESPONSE_BYTES && (response & SDCARD_R1_INVALID) != 0U; i++)
+  {
+    response = SDCARD_HAL_Exchange(SDCARD_IDLE_BYTE);
+  }
+
+  return response;
+}
+
+/**
+ * @brief  Sends an application specific command, prefixed by CMD55. CS must be low.
+ * @param  command: Application command index.
+ * @param  argument: 32-bit argument.
+ * @retval uint8_t: R1 of the application command, or of CMD55 if it failed.
+ */
+static uint8_t sdcardAppCommand(uint8_t command, uint32_t argument)
+{
+  uint8_t response = sdcardCommand(SDCARD_CMD55_APP_CMD, 0);
+
+  if ((response & ~SDCARD_R1_IDLE) != 0U)
+  {
+    return response;
+  }
+
+  return sdcardCommand(command, argument);
+}
+
+/**
+ * @brief  Waits until the card releases MISO after programming. CS must be low.
+ * @param  timeout: Milliseconds.
+ * @retval bool: true if the card is ready.
+ */
+static bool sdcardWaitReady(uint32_t timeout)
+{
+  uint32_t start = SDCARD_HAL_GetTick();
+
+  do
+  {
+    if (SDCARD_HAL_Exchange(SDCARD_IDLE_BYTE) == SDCARD_IDLE_BYTE)
+    {
+      return true;
+    }
+  } while ((SDCARD_HAL_GetTick() - start) < timeout);
+
+  return false;
+}
+
+/**
+ * @brief  Waits for the start token of a data block, then reads the block and its CRC. CS must be low.
+ * @param  data: Destination.
+ * @param  size: Block size in bytes.
+ * @retval bool: true on success, false on a timeout or an error token.
+ */
+static bool sdcardReadData(uint8_t *data, uint16_t size)
+{
+  uint8_t crc[SDCARD_CRC16_SIZE];
+  uint32_t start = SDCARD_HAL_GetTick();
+  uint8_t token;
+
+  do
+  {
+    token = SDCARD_HAL_Exchange(SDCARD_IDLE_BYTE);
+  } while (token == SDCARD_IDLE_BYTE && (SDCARD_HAL_GetTick() - start) < SDCARD_READ_TIMEOUT_MS);
+
+  if (token != SDCARD_TOKEN_START_BLOCK)
+  {
+    return false;
+  }
+
+  SDCARD_HAL_Read(data, size);
+  SDCARD_HAL_Read(crc, sizeof(crc));
+
+  return true;
+}
+
+/**
+ * @brief  Sends one data block after its token and checks the data response. CS must be low.
+ * @param  token: SDCARD_TOKEN_START_BLOCK or SDCARD_TOKEN_START_MULTI_WRITE.
+ * @param  data: SDCARD_BLOCK_SIZE bytes.
+ * @retval bool: true if the card accepted the block.
+ */
+static bool sdcardSendData(uint8_t token, const uint8_t *data)
+{
+  static const uint8_t crc[SDCARD_CRC16_SIZE] = {SDCARD_IDLE_BYTE, SDCARD_IDLE_BYTE};
+
+  SDCARD_HAL_Exchange(token);
+  SDCARD_HAL_Write(data, SDCARD_BLOCK_SIZE);
+  SDCARD_HAL_Write(crc, sizeof(crc));
+
+  return (SDCARD_HAL_Exchange(SDCARD_IDLE_BYTE) & SDCARD_DATA_RESPONSE_MASK) == SDCARD_DATA_ACCEPTED;
+}
+
+/**
+ * @brief  Converts a block number to a command argument: standard capacity cards are byte addressed.
+ * @param  block: Block number.
+ * @retval uint32_t: Command argument.
+ */
+static uint32_t sdcardAddress(uint32_t block)
+{
+  return (cardType == SDCARD_TYPE_SDHC) ? block : block * SDCARD_BLOCK_SIZE;
+}
+
+/**
+ * @brief  Decodes the capacity from a CSD register, version 1.0 or 2.0.
+ * @param  csd: SDCARD_CSD_SIZE bytes, most significant first.
+ * @retval uint32_t: Number of SDCARD_BLOCK_SIZE blocks.
+ */
+static uint32_t sdcardCsdBlocks(const uint8_t *csd)
+{
+  if ((csd[0] >> 6) == SDCARD_CSD_V2)
+  {
+    // C_SIZE [69:48], capacity (C_SIZE + 1) * 512 KB
+    uint32_t size = ((uint32_t)(csd[7] & 0x3FU) << 16) | ((uint32_t)csd[8] << 8) | csd[9];
+    return (size + 1U) * 1024U;
+  }
+
+  // C_SIZE [73:62], C_SIZE_MULT [49:47], READ_BL_LEN [83:80]
+  uint32_t size = ((uint32_t)(csd[6] & 0x03U) << 10) | ((uint32_t)csd[7] << 2) | (csd[8] >> 6);
+  uint32_t multiplier = ((uint32_t)(csd[9] & 0x03U) << 1) | (csd[10] >> 7);
+  uint32_t readBlockLength = csd[5] & 0x0FU;
+
+  return (size + 1U) << (multiplier + 2U + readBlockLength - 9U);
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Identifies the card and switches it to SPI mode data transfer: CMD0, CMD8, ACMD41, CMD58, CMD9.
+ *         Blocking, up to SDCARD_INIT_TIMEOUT_MS: call at init only.
+ * @param  None
+ * @retval bool: true if a card is ready.
+ */
+bool API_SDCARD_Init(void)
+{
+  uint8_t reply[SDCARD_CSD_SIZE];
+  uint8_t response = SDCARD_IDLE_BYTE;
+  bool version2 = false;
+  uint32_t start;
+
+  cardType = SDCARD_TYPE_NONE;
+  blockCount = 0;
+
+  SDCARD_HAL_Init();
+  SDCARD_HAL_Select();
+
+  for (uint8_t i = 0; i < SDCARD_CMD0_RETRIES && response != SDCARD_R1_IDLE; i++)
+  {
+    response = sdcardCommand(SDCARD_CMD0_GO_IDLE_STATE, 0);
+  }
+  if (response != SDCARD_R1_IDLE)
+  {
+    SDCARD_HAL_Deselect();
+    return false;
+  }
+
+  // Version 2.0 cards echo the check pattern, version 1.x cards reject CMD8
+  response = sdcardCommand(SDCARD_CMD8_SEND_IF_COND, SDCARD_CMD8_PATTERN);
+  if (response == SDCARD_R1_IDLE)
+  {
+    SDCARD_HAL_Read(reply, SDCARD_R7_SIZE);
+    if (((uint32_t)(reply[2] & 0x0FU) << 8 | reply[3]) != SDCARD_CMD8_PATTERN)
+    {
+      SDCARD_HAL_Deselect();
+      return false;
+    }
+    version2 = true;
+  }
+  else if ((response & SDCARD_R1_ILLEGAL_COMMAND) == 0U)
+  {
+    SDCARD_HAL_Deselect();
+    return false;
+  }
+
+  start = SDCARD_HAL_GetTick();
+  do
+  {
+    response = sdcardAppCommand(SDCARD_ACMD41_SD_SEND_OP_COND, version2 ? SDCARD_ACMD41_HCS : 0U);
+  } while (response == SDCARD_R1_IDLE && (SDCARD_HAL_GetTick() - start) < SDCARD_INIT_TIMEOUT_MS);
+
+  if (response != 0U)
+  {
+    SDCARD_HAL_Deselect();
+    return false;
+  }
+
+  cardType = SDCARD_TYPE_SDSC;
+  if (version2 && sdcardCommand(SDCARD_CMD58_READ_OCR, 0) == 0U)
+  {
+    SDCARD_HAL_Read(reply, SDCARD_R7_SIZE);
+    if ((((uint32_t)reply[0] << 24) & SDCARD_OCR_CCS) != 0U)
+    {
+      cardType = SDCARD_TYPE_SDHC;
+    }
+  }
+
+  if ((cardType == SDCARD_TYPE_SDSC && sdcardCommand(SDCARD_CMD16_SET_BLOCKLEN, SDCARD_BLOCK_SIZE) != 0U) ||
+      sdcardCommand(SDCARD_CMD9_SEND_CSD, 0) != 0U || !sdcardReadData(reply, SDCARD_CSD_SIZE))
+  {
+    cardType = SDCARD_TYPE_NONE;
+    SDCARD_HAL_Deselect();
+    return false;
+  }
+
+  blockCount = sdcardCsdBlocks(reply);
+  SDCARD_HAL_Deselect();
+
+  return true;
+}
+
+/**
+ * @brief  Returns the identified card type.
+ * @param  None
+ * @retval sdcardType_t: Card type, SDCARD_TYPE_NONE before a successful API_SDCARD_Init.
+ */
+sdcardType_t API_SDCARD_GetType(void)
+{
+  return cardType;
+}
+
+/**
+ * @brief  Returns the card capacity read from the CSD register.
+ * @param  None
+ * @retval uint32_t: Number of SDCARD_BLOCK_SIZE blocks.
+ */
+uint32_t API_SDCARD_GetBlockCount(void)
+{
+  return blockCount;
+}
+
+/**
+ * @brief  Reads one block. Blocking until the data arrives: for init and recovery.
+ * @param  block: Block number.
+ * @param  data: Destination, SDCARD_BLOCK_SIZE bytes.
+ * @retval bool: true on success.
+ */
+bool API_SDCARD_ReadBlock(uint32_t block, uint8_t *data)
+{
+  bool done;
+
+  if (cardType == SDCARD_TYPE_NONE || block >= blockCount)
+  {
+    return false;
+  }
+
+  SDCARD_HAL_Select();
+  done = sdcardWaitReady(SDCARD_BUSY_TIMEOUT_MS) &&
+         sdcardCommand(SDCARD_CMD17_READ_SINGLE_BLOCK, sdcardAddress(block)) == 0U &&
+         sdcardReadData(data, SDCARD_BLOCK_SIZE);
+  SDCARD_HAL_Deselect();
+
+  return done;
+}
+
+/**
+ * @brief  Writes one block with CMD24. Returns once the card accepted the data, while it programs:
+ *         poll API_SDCARD_IsBusy before the next operation.
+ * @param  block: Block number.
+ * @param  data: SDCARD_BLOCK_SIZE bytes.
+ * @retval bool: true if the card accepted the block.
+ */
+bool API_SDCARD_WriteBlock(uint32_t block, const uint8_t *data)
+{
+  bool done;
+
+  if (cardType == SDCARD_TYPE_NONE || block >= blockCount)
+  {
+    return false;
+  }
+
+  SDCARD_HAL_Select();
+  done = sdcardWaitReady(SDCARD_BUSY_TIMEOUT_MS) &&
+         sdcardCommand(SDCARD_CMD24_WRITE_BLOCK, sdcardAddress(block)) == 0U &&
+         sdcardSendData(SDCARD_TOKEN_START_BLOCK, data);
+  SDCARD_HAL_Deselect();
+
+  return done;
+}
+
+/**
+ * @brief  Opens a multiple block write (CMD25), pre-erasing count blocks (ACMD23) so the card can program them
+ *         in one go. The card must not be busy.
+ * @param  block: First block number.
+ * @param  count: Number of blocks announced, the stream may be stopped earlier.
+ * @retval bool: true if the stream is open.
+ */
+bool API_SDCARD_StartStream(uint32_t block, uint32_t count)
+{
+  bool done;
+
+  if (cardType == SDCARD_TYPE_NONE || count == 0U || block >= blockCount || count > blockCount - block)
+  {
+    return false;
+  }
+
+  SDCARD_HAL_Select();
+  // ACMD23 is only a hint: a card that rejects it still takes the stream
+  done = sdcardWaitReady(SDCARD_BUSY_TIMEOUT_MS);
+  if (done)
+  {
+    sdcardAppCommand(SDCARD_ACMD23_SET_WR_BLK_ERASE_COUNT, count);
+    done = sdcardCommand(SDCARD_CMD25_WRITE_MULTIPLE_BLOCK, sdcardAddress(block)) == 0U;
+  }
+  SDCARD_HAL_Deselect();
+
+  return done;
+}
+
+/**
+ * @brief  Sends the next block of an open stream. Returns once the card accepted the data, while it programs.
+ * @param  data: SDCARD_BLOCK_SIZE bytes.
+ * @retval bool: true if the card accepted the block.
+ */
+bool API_SDCARD_StreamBlock(const uint8_t *data)
+{
+  bool done;
+
+  SDCARD_HAL_Select();
+  done = sdcardWaitReady(SDCARD_BUSY_TIMEOUT_MS) && sdcardSendData(SDCARD_TOKEN_START_MULTI_WRITE, data);
+  SDCARD_HAL_Deselect();
+
+  return done;
+}
+
+/**
+ * @brief  Ends an open stream with the stop token. The card then programs the last block: poll API_SDCARD_IsBusy.
+ * @param  None
+ * @retval bool: true on success.
+ */
+bool API_SDCARD_StopStream(void)
+{
+  bool done;
+
+  SDCARD_HAL_Select();
+  done = sdcardWaitReady(SDCARD_BUSY_TIMEOUT_MS);
+  if (done)
+  {
+    SDCARD_HAL_Exchange(SDCARD_TOKEN_STOP_MULTI_WRITE);
+    SDCARD_HAL_Exchange(SDCARD_IDLE_BYTE); // Nbr: one byte before the card signals busy
+  }
+  SDCARD_HAL_Deselect();
+
+  return done;
+}
+
+/**
+ * @brief  Polls the card with a single byte: it holds MISO low while programming.
+ * @param  None
+ * @retval bool: true while the card is busy.
+ */
+bool API_SDCARD_IsBusy(void)
+{
+  uint8_t level;
+
+  SDCARD_HAL_Select();
+  level = SDCARD_HAL_Exchange(SDCARD_IDLE_BYTE);
+  SDCARD_HAL_Deselect();
+
+  return level != SDCARD_IDLE_BYTE;
+}
+
+/**
+ * @brief  Waits until the card has finished programming. Blocking: for init and shutdown.
+ * @param  timeout: Milliseconds.
+ * @retval bool: true if the card is ready.
+ */
+bool API_SDCARD_WaitReady(uint32_t timeout)
+{
+  bool done;
+
+  SDCARD_HAL_Select();
+  done = sdcardWaitReady(timeout);
+  SDCARD_HAL_Deselect();
+
+  return done;
+}
@@ -0,0 +1,6 @@
+/* Includes ------------------------------------------------------------------*/
+
+/* The port functions live in API_sdcard_port.h. With API_PORT_STATIC_INLINE they are inlined into
+ * the driver and this file is empty; otherwise they are compiled here, once. */
+#define API_SDCARD_PORT_IMPLEMENTATION
+#include "API_sdcard_port.h"
@@ -0,0 +1,523 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "API_sdlog.h"
+#include "API_sampler.h"
+#include "API_section.h"
+
+/* Private define ------------------------------------------------------------*/
+
+// Index block fields, little-endian words from offset 0
+#define SDLOG_INDEX_MAGIC_OFFSET 0U
+#define SDLOG_INDEX_VERSION_OFFSET 4U
+#define SDLOG_INDEX_VOLUME_OFFSET 8U
+#define SDLOG_INDEX_BLOCKS_OFFSET 12U
+#define SDLOG_INDEX_RECORDS_OFFSET 16U
+#define SDLOG_INDEX_CRC_OFFSET 20U // CRC-32 of the words before it
+
+// Data block header fields
+#define SDLOG_BLOCK_MAGIC_OFFSET 0U
+#define SDLOG_BLOCK_COUNT_OFFSET 2U
+#define SDLOG_BLOCK_VOLUME_OFFSET 4U
+#define SDLOG_BLOCK_SEQUENCE_OFFSET 8U
+#define SDLOG_BLOCK_CRC_OFFSET 12U
+
+#define SDLOG_INDEX_WRITE_TIMEOUT_MS SDCARD_BUSY_TIMEOUT_MS
+
+/* Private types -------------------------------------------------------------*/
+
+typedef enum
+{
+  SDLOG_BUFFER_FREE,    // Empty, next to fill
+  SDLOG_BUFFER_FILLING, // Receiving records
+  SDLOG_BUFFER_FULL,    // Waiting for its turn in the stream
+} sdlogBufferState_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+// SRAM1/2 rather than CCM, so the SPI transfers can move to DMA without touching the log
+API_DMA_BSS static uint8_t blockBuffers[SDLOG_BUFFER_COUNT][SDCARD_BLOCK_SIZE];
+API_DMA_BSS static uint8_t indexBlock[SDCARD_BLOCK_SIZE];
+static sdlogBufferState_t bufferState[SDLOG_BUFFER_COUNT];
+static uint16_t bufferCount[SDLOG_BUFFER_COUNT];
+static uint8_t fillIndex; // Buffer receiving records
+static uint8_t sendIndex; // Oldest full buffer, buffers fill and drain in turn
+
+static uint32_t volume;           // Identity of the region, changes at each format
+static uint32_t committedBlocks;  // Data blocks covered by the index on the card
+static uint32_t committedRecords;
+static bool streamOpen;
+static uint32_t streamBlocks;     // Blocks sent in the open stream
+static uint32_t streamLength;     // Blocks announced when the stream was opened
+static bool flushRequested;
+static uint32_t consecutiveErrors;
+static sdlogStatus_t status;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static uint32_t getLE32(const uint8_t *bytes);
+static uint16_t getLE16(const uint8_t *bytes);
+static void putLE32(uint8_t *bytes, uint32_t value);
+static void putLE16(uint8_t *bytes, uint16_t value);
+static uint32_t crc32(uint32_t crc, const uint8_t *data, uint16_t length);
+static uint32_t blockCrc(const uint8_t *block, uint16_t count);
+static bool readIndex(const uint8_t *block);
+static bool writeIndex(void);
+static bool isValidBlock(const uint8_t *block, uint32_t sequence, uint16_t *count);
+static void sealBuffer(uint8_t buffer);
+static void closeBlock(uint8_t buffer, uint32_t sequence);
+static void noteFailure(void);
+static void processCard(void);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Reads a little-endian 32-bit value.
+ * @param  const uint8_t *bytes: Source bytes.
+ * @retval uint32_t: Value.
+ */
+static uint32_t getLE32(const uint8_t *bytes)
+{
+  return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+/**
+ * @brief  Reads a little-endian 16-bit value.
+ * @param  const uint8_t *bytes: Source bytes.
+ * @retval uint16_t: Value.
+ */
+static uint16_t getLE16(const uint8_t *bytes)
+{
+  return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+/**
+ * @brief  Writes a little-endian 32-bit value.
+ * @param  uint8_t *bytes: Destination bytes.
+ * @param  uint32_t value: Value.
+ * @retval None
+ */
+static void putLE32(uint8_t *bytes, uint32_t value)
+{
+  bytes[0] = (uint8_t)value;
+  bytes[1] = (uint8_t)(value >> 8);
+  bytes[2] = (uint8_t)(value >> 16);
+  bytes[3] = (uint8_t)(value >> 24);
+}
+
+/**
+ * @brief  Writes a little-endian 16-bit value.
+ * @param  uint8_t *bytes: Destination bytes.
+ * @param  uint16_t value: Value.
+ * @retval None
+ */
+static void putLE16(uint8_t *bytes, uint16_t value)
+{
+  bytes[0] = (uint8_t)value;
+  bytes[1] = (uint8_t)(value >> 8);
+}
+
+/**
+ * @brief  CRC-32 (IEEE 802.3, reflected), four bits at a time from a 16-entry table.
+ * @param  uint32_t crc: Running value, 0 for the first call.
+ * @param  const uint8_t *data: Bytes to add.
+ * @param  uint16_t length: Number of bytes.
+ * @retval uint32_t: Updated CRC.
+ */
+static uint32_t crc32(uint32_t crc, const uint8_t *data, uint16_t length)
+{
+  static const uint32_t table[16] = {
+      0x00000000UL, 0x1DB71064UL, 0x3B6E20C8UL, 0x26D930ACUL, 0x76DC4190UL, 0x6B6B51F4UL, 0x4DB26158UL, 0x5005713CUL,
+      0xEDB88320UL, 0xF00F9344UL, 0xD6D6A3E8UL, 0xCB61B38CUL, 0x9B64C2B0UL, 0x86D3D2D4UL, 0xA00AE278UL, 0xBDBDF21CUL,
+  };
+
+  crc = ~crc;
+  for (uint16_t i = 0; i < length; i++)
+  {
+    crc ^= data[i];
+    crc = (crc >> 4) ^ table[crc & 0x0FU];
+    crc = (crc >> 4) ^ table[crc & 0x0FU];
+  }
+
+  return ~crc;
+}
+
+/**
+ * @brief  CRC of a data block: header with the CRC field zeroed, then the records in use.
+ * @param  const uint8_t *block: Data block.
+ * @param  uint16_t count: Records in the block.
+ * @retval uint32_t: CRC.
+ */
+static uint32_t blockCrc(const uint8_t *block, uint16_t count)
+{
+  static const uint8_t zero[sizeof(uint32_t)] = {0};
+  uint32_t crc = crc32(0, block, SDLOG_BLOCK_CRC_OFFSET);
+
+  crc = crc32(crc, zero, sizeof(zero));
+  return crc32(crc, block + SDLOG_BLOCK_HEADER_SIZE, (uint16_t)(count * SDLOG_RECORD_SIZE));
+}
+
+/**
+ * @brief  Checks an index block and loads the region identity and committed counters from it.
+ * @param  const uint8_t *block: Index block.
+ * @retval bool: true if the index is valid.
+ */
+static bool readIndex(const uint8_t *block)
+{
+  if (getLE32(block + SDLOG_INDEX_MAGIC_OFFSET) != SDLOG_INDEX_MAGIC ||
+      getLE32(block + SDLOG_INDEX_VERSION_OFFSET) != SDLOG_INDEX_VERSION ||
+      getLE32(block + SDLOG_INDEX_CRC_OFFSET) != crc32(0, block, SDLOG_INDEX_CRC_OFFSET) ||
+      getLE32(block + SDLOG_INDEX_BLOCKS_OFFSET) > status.capacity)
+  {
+    return false;
+  }
+
+  volume = getLE32(block + SDLOG_INDEX_VOLUME_OFFSET);
+  committedBlocks = getLE32(block + SDLOG_INDEX_BLOCKS_OFFSET);
+  committedRecords = getLE32(block + SDLOG_INDEX_RECORDS_OFFSET);
+
+  return true;
+}
+
+/**
+ * @brief  Starts writing an index that commits every block sent so far. The card programs it afterwards.
+ * @param  None
+ * @retval bool: true if the card accepted the index.
+ */
+static bool writeIndex(void)
+{
+  memset(indexBlock, 0, sizeof(indexBlock));
+  putLE32(indexBlock + SDLOG_INDEX_MAGIC_OFFSET, SDLOG_INDEX_MAGIC);
+  putLE32(indexBlock + SDLOG_INDEX_VERSION_OFFSET, SDLOG_INDEX_VERSION);
+  putLE32(indexBlock + SDLOG_INDEX_VOLUME_OFFSET, volume);
+  putLE32(indexBlock + SDLOG_INDEX_BLOCKS_OFFSET, status.blocks);
+  putLE32(indexBlock + SDLOG_INDEX_RECORDS_OFFSET, status.records);
+  putLE32(indexBlock + SDLOG_INDEX_CRC_OFFSET, crc32(0, indexBlock, SDLOG_INDEX_CRC_OFFSET));
+
+  if (!API_SDCARD_WriteBlock(SDLOG_INDEX_BLOCK, indexBlock))
+  {
+    return false;
+  }
+
+  committedBlocks = status.blocks;
+  committedRecords = status.records;
+  return true;
+}
+
+/**
+ * @brief  Checks that a block read from the card is the data block expected at a position of this region.
+ * @param  const uint8_t *block: Block read from the card.
+ * @param  uint32_t sequence: Expected data block index.
+ * @param  uint16_t *count: Records in the block, if valid.
+ * @retval bool: true if the block is valid.
+ */
+static bool isValidBlock(const uint8_t *block, uint32_t sequence, uint16_t *count)
+{
+  *count = getLE16(block + SDLOG_BLOCK_COUNT_OFFSET);
+
+  return getLE16(block + SDLOG_BLOCK_MAGIC_OFFSET) == SDLOG_BLOCK_MAGIC && *count > 0U &&
+         *count <= SDLOG_RECORDS_PER_BLOCK && getLE32(block + SDLOG_BLOCK_VOLUME_OFFSET) == volume &&
+         getLE32(block + SDLOG_BLOCK_SEQUENCE_OFFSET) == sequence &&
+         getLE32(block + SDLOG_BLOCK_CRC_OFFSET) == blockCrc(block, *count);
+}
+
+/**
+ * @brief  Queues a buffer for writing and moves the filling position to the other one.
+ * @param  uint8_t buffer: Buffer index.
+ * @retval None
+ */
+static void sealBuffer(uint8_t buffer)
+{
+  bufferState[buffer] = SDLOG_BUFFER_FULL;
+  fillIndex = (uint8_t)((buffer + 1U) % SDLOG_BUFFER_COUNT);
+}
+
+/**
+ * @brief  Completes the header of a full buffer just before it is sent, once its position is known.
+ * @param  uint8_t buffer: Buffer index.
+ * @param  uint32_t sequence: Data block index it is written to.
+ * @retval None
+ */
+static void closeBlock(uint8_t buffer, uint32_t sequence)
+{
+  uint8_t *block = blockBuffers[buffer];
+  uint16_t count = bufferCount[buffer];
+  uint32_t used = SDLOG_BLOCK_HEADER_SIZE + (uint32_t)count * SDLOG_RECORD_SIZE;
+
+  memset(block + used, 0, SDCARD_BLOCK_SIZE - used);
+  putLE16(block + SDLOG_BLOCK_MAGIC_OFFSET, SDLOG_BLOCK_MAGIC);
+  putLE16(block + SDLOG_BLOCK_COUNT_OFFSET, count);
+  putLE32(block + SDLOG_BLOCK_VOLUME_OFFSET, volume);
+  putLE32(block + SDLOG_BLOCK_SEQUENCE_OFFSET, sequence);
+  putLE32(block + SDLOG_BLOCK_CRC_OFFSET, blockCrc(block, count));
+}
+
+/**
+ * @brief  Counts a failed card operation. An open stream is ended at the next call, so the failed block is
+ *         sent again in a new one; after SDLOG_MAX_ERRORS failures in a row the card is given up.
+ * @param  None
+ * @retval None
+ */
+static void noteFailure(void)
+{
+  status.errors++;
+  streamBlocks = streamLength;
+
+  if (++consecutiveErrors >= SDLOG_MAX_ERRORS)
+  {
+    status.ready = false;
+    status.dropped += status.pending;
+    status.pending = 0;
+  }
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Identifies the card, reads the index and adopts the valid blocks written after it.
+ *         A card without a valid index is formatted. Blocking: call at init only.
+ * @param  None
+ * @retval bool: true if the log is ready.
+ */
+bool API_SDLOG_Init(void)
+{
+  uint32_t blocks;
+  bool formatted;
+
+  memset(bufferState, 0, sizeof(bufferState));
+  memset(bufferCount, 0, sizeof(bufferCount));
+  memset(&status, 0, sizeof(status));
+  fillIndex = 0;
+  sendIndex = 0;
+  streamOpen = false;
+  flushRequested = false;
+  consecutiveErrors = 0;
+
+  if (!API_SDCARD_Init())
+  {
+    return false;
+  }
+
+  blocks = API_SDCARD_GetBlockCount();
+  if (blocks <= SDLOG_FIRST_DATA_BLOCK || !API_SDCARD_ReadBlock(SDLOG_INDEX_BLOCK, indexBlock))
+  {
+    return false;
+  }
+  status.capacity = blocks - SDLOG_FIRST_DATA_BLOCK;
+
+  formatted = !readIndex(indexBlock);
+  if (formatted)
+  {
+    // New identity, so blocks left by an earlier format or by another user of the card never validate
+    volume = crc32(getLE32(indexBlock + SDLOG_INDEX_VOLUME_OFFSET) + 1U, indexBlock, SDCARD_BLOCK_SIZE);
+    committedBlocks = 0;
+    committedRecords = 0;
+  }
+  else
+  {
+    status.blocks = committedBlocks;
+    status.records = committedRecords;
+
+    // Blocks of the last stream, written after the index was
+    for (uint32_t i = 0; i < SDLOG_RECOVERY_SCAN && status.blocks < status.capacity; i++)
+    {
+      uint16_t count;
+
+      if (!API_SDCARD_ReadBlock(SDLOG_FIRST_DATA_BLOCK + status.blocks, blockBuffers[0]) ||
+          !isValidBlock(blockBuffers[0], status.blocks, &count))
+      {
+        break;
+      }
+      status.blocks++;
+      status.records += count;
+      status.recovered++;
+    }
+    memset(blockBuffers[0], 0, SDCARD_BLOCK_SIZE);
+  }
+
+  // The index must exist before the first stream, and commits the adopted blocks
+  if ((formatted || status.recovered > 0U) &&
+      (!writeIndex() || !API_SDCARD_WaitReady(SDLOG_INDEX_WRITE_TIMEOUT_MS)))
+  {
+    return false;
+  }
+
+  status.ready = true;
+  return true;
+}
+
+/**
+ * @brief  Copies a record into the filling block buffer. Never touches the card: constant time.
+ * @param  record: Record to append.
+ * @retval bool: true if the record was buffered, false if it was dropped or no card is ready.
+ */
+bool API_SDLOG_Append(const logRecord_t *record)
+{
+  uint8_t buffer = fillIndex;
+  uint8_t *slot;
+
+  if (!status.ready)
+  {
+    return false; // No card: nothing is being logged, so nothing is lost either
+  }
+
+  if (bufferState[buffer] == SDLOG_BUFFER_FULL)
+  {
+    status.dropped++;
+    return false;
+  }
+
+  slot = blockBuffers[buffer] + SDLOG_BLOCK_HEADER_SIZE + (uint32_t)bufferCount[buffer] * SDLOG_RECORD_SIZE;
+  putLE32(slot, record->timestamp);
+  putLE16(slot + 4, (uint16_t)record->temperature);
+  putLE16(slot + 6, record->humidity);
+
+  bufferState[buffer] = SDLOG_BUFFER_FILLING;
+  bufferCount[buffer]++;
+  status.pending++;
+
+  if (bufferCount[buffer] == SDLOG_RECORDS_PER_BLOCK)
+  {
+    sealBuffer(buffer);
+  }
+
+  return true;
+}
+
+/**
+ * @brief  Advances the card writes by at most one operation: returns at once while the card is programming,
+ *         otherwise sends one block, opens or closes a stream, or rewrites the index. The caller holds SPI1.
+ * @param  None
+ * @retval None
+ */
+static void processCard(void)
+{
+  bool blockWaiting;
+
+  if (API_SDCARD_IsBusy())
+  {
+    status.busyPolls++;
+    return;
+  }
+
+  blockWaiting = (bufferState[sendIndex] == SDLOG_BUFFER_FULL);
+
+  if (streamOpen && (streamBlocks >= streamLength || (flushRequested && !blockWaiting)))
+  {
+    streamOpen = false;
+    if (!API_SDCARD_StopStream())
+    {
+      noteFailure();
+    }
+    return;
+  }
+
+  if (!streamOpen && committedBlocks != status.blocks)
+  {
+    if (!writeIndex())
+    {
+      noteFailure();
+    }
+    return;
+  }
+
+  if (!blockWaiting)
+  {
+    flushRequested = false; // Stream closed and index up to date
+    return;
+  }
+
+  if (!streamOpen)
+  {
+    // A full region keeps its buffers: records are dropped from then on
+    if (status.blocks >= status.capacity)
+    {
+      return;
+    }
+
+    streamLength = status.capacity - status.blocks;
+    if (streamLength > SDLOG_STREAM_BLOCKS)
+    {
+      streamLength = SDLOG_STREAM_BLOCKS;
+    }
+    if (API_SDCARD_StartStream(SDLOG_FIRST_DATA_BLOCK + status.blocks, streamLength))
+    {
+      streamOpen = true;
+      streamBlocks = 0;
+    }
+    else
+    {
+      noteFailure();
+    }
+    return;
+  }
+
+  closeBlock(sendIndex, status.blocks);
+  if (!API_SDCARD_StreamBlock(blockBuffers[sendIndex]))
+  {
+    noteFailure();
+    return;
+  }
+
+  status.blocks++;
+  status.records += bufferCount[sendIndex];
+  status.pending -= bufferCount[sendIndex];
+  bufferCount[sendIndex] = 0;
+  bufferState[sendIndex] = SDLOG_BUFFER_FREE;
+  sendIndex = (uint8_t)((sendIndex + 1U) % SDLOG_BUFFER_COUNT);
+  streamBlocks++;
+  consecutiveErrors = 0;
+}
+
+/**
+ * @brief  Advances the card writes by at most one operation, when SPI1 is free of a timed sensor read: otherwise
+ *         returns at once and the operation waits for the next call. Call from the main loop.
+ * @param  None
+ * @retval None
+ */
+void API_SDLOG_Process(void)
+{
+  if (!status.ready)
+  {
+    return;
+  }
+
+  if (!API_SAMPLER_AcquireBus())
+  {
+    status.busWaits++;
+    return;
+  }
+
+  processCard();
+  API_SAMPLER_ReleaseBus();
+}
+
+/**
+ * @brief  Queues the partly filled block buffer and requests the stream end and the index update.
+ *         The work itself is done by API_SDLOG_Process.
+ * @param  None
+ * @retval bool: true once every appended record is committed by the index.
+ */
+bool API_SDLOG_Flush(void)
+{
+  bool idle;
+
+  if (bufferState[fillIndex] == SDLOG_BUFFER_FILLING)
+  {
+    sealBuffer(fillIndex);
+  }
+
+  idle = status.pending == 0U && !streamOpen && committedBlocks == status.blocks;
+  flushRequested = !idle && status.ready;
+
+  return idle || !status.ready;
+}
+
+/**
+ * @brief  Returns the log counters.
+ * @param  None
+ * @retval sdlogStatus_t: Counters.
+ */
+sdlogStatus_t API_SDLOG_GetStatus(void)
+{
+  return status;
+}
@@ -0,0 +1,49 @@
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f4xx_hal.h" /* <- HAL include, CMSIS __get_MSP */
+#include "API_stack.h"
+
+/* Private variables ----------------------------------------------------------*/
+
+// Linker script symbols: the stack grows down from _estack, at most to _sstackpaint (end of .ccmbss)
+extern uint32_t _sstackpaint[];
+extern uint32_t _estack[];
+extern uint8_t _Min_Stack_Size;
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Fills [_sstackpaint, SP) with the pattern. No calls inside the loop: nothing is pushed below SP.
+ * @param  None
+ * @retval None
+ */
+void API_STACK_Paint(void)
+{
+  volatile uint32_t *word = _sstackpaint;
+  uint32_t *const stackPointer = (uint32_t *)(uintptr_t)__get_MSP();
+
+  while (word < stackPointer)
+  {
+    *word++ = STACK_PAINT_PATTERN;
+  }
+}
+
+/**
+ * @brief  Measures the high-water mark of the main stack.
+ * @param  usage: Filled with the budget, capacity and peak.
+ * @retval bool: true while the peak is within the budget.
+ */
+bool API_STACK_GetUsage(stackUsage_t *usage)
+{
+  const uint32_t *word = _sstackpaint;
+
+  while (word < _estack && *word == STACK_PAINT_PATTERN)
+  {
+    word++;
+  }
+
+  usage->budget = (uint32_t)(uintptr_t)&_Min_Stack_Size;
+  usage->capacity = (uint32_t)((uintptr_t)_estack - (uintptr_t)_sstackpaint);
+  usage->peak = (uint32_t)((uintptr_t)_estack - (uintptr_t)word);
+
+  return usage->peak <= usage->budget;
+}
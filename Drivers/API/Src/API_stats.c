@@ -0,0 +1,523 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include "API_stats.h"
+#include "API_section.h"
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief Welford accumulator of one slot: running mean and sum of squared deviations, plus extremes.
+ */
+typedef struct
+{
+  uint32_t count;
+  float mean;
+  float m2;
+  float min;
+  float max;
+} statsSlot_t;
+
+typedef struct
+{
+  uint32_t seq; // Sequence number of the slot the value came from
+  float value;
+} statsDequeEntry_t;
+
+/**
+ * @brief Monotonic deque over closed slots: values are kept sorted from the front, so the window extreme
+ *        is always at the front and every slot is pushed and popped at most once.
+ */
+typedef struct
+{
+  statsDequeEntry_t *entries; // Ring storage, one entry per slot of the window
+  uint16_t capacity;
+  uint16_t head;
+  uint16_t size;
+} statsDeque_t;
+
+typedef struct
+{
+  statsSlot_t *slots;         // Ring of closed slots, indexed by sequence number modulo slotCount
+  uint32_t *histogram;        // Sample counts of the closed slots, bucketed by slot mean
+  statsDeque_t minDeque;
+  statsDeque_t maxDeque;
+  statsSlot_t current;        // Slot being filled
+  uint32_t currentSeq;
+  uint32_t currentStartMs;
+  bool started;
+} statsWindowState_t;
+
+typedef struct
+{
+  uint32_t slotMs;
+  uint16_t slotCount;
+} statsWindowConfig_t;
+
+typedef struct
+{
+  float lowest;
+  float bucketWidth;
+  statsWindowState_t windows[STATS_WINDOW_COUNT];
+} statsChannelState_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+static const statsWindowConfig_t windowConfigs[STATS_WINDOW_COUNT] = {
+    [STATS_WINDOW_1MIN] = {STATS_1MIN_SLOT_MS, STATS_1MIN_SLOTS},
+    [STATS_WINDOW_1HOUR] = {STATS_1HOUR_SLOT_MS, STATS_1HOUR_SLOTS},
+    [STATS_WINDOW_24HOUR] = {STATS_24HOUR_SLOT_MS, STATS_24HOUR_SLOTS},
+};
+
+// Window state is touched on every sample and read only by the CPU: CCM
+API_CCM_BSS static statsSlot_t slots1Min[STATS_CHANNEL_COUNT][STATS_1MIN_SLOTS];
+API_CCM_BSS static statsSlot_t slots1Hour[STATS_CHANNEL_COUNT][STATS_1HOUR_SLOTS];
+API_CCM_BSS static statsSlot_t slots24Hour[STATS_CHANNEL_COUNT][STATS_24HOUR_SLOTS];
+API_CCM_BSS static statsDequeEntry_t minEntries1Min[STATS_CHANNEL_COUNT][STATS_1MIN_SLOTS];
+API_CCM_BSS static statsDequeEntry_t maxEntries1Min[STATS_CHANNEL_COUNT][STATS_1MIN_SLOTS];
+API_CCM_BSS static statsDequeEntry_t minEntries1Hour[STATS_CHANNEL_COUNT][STATS_1HOUR_SLOTS];
+API_CCM_BSS static statsDequeEntry_t maxEntries1Hour[STATS_CHANNEL_COUNT][STATS_1HOUR_SLOTS];
+API_CCM_BSS static statsDequeEntry_t minEntries24Hour[STATS_CHANNEL_COUNT][STATS_24HOUR_SLOTS];
+API_CCM_BSS static statsDequeEntry_t maxEntries24Hour[STATS_CHANNEL_COUNT][STATS_24HOUR_SLOTS];
+API_CCM_BSS static uint32_t histograms[STATS_CHANNEL_COUNT][STATS_WINDOW_COUNT][STATS_HISTOGRAM_BUCKETS];
+
+API_CCM_BSS static statsChannelState_t channels[STATS_CHANNEL_COUNT];
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void slotReset(statsSlot_t *slot);
+static void slotAdd(statsSlot_t *slot, float value);
+static void slotMerge(statsSlot_t *into, const statsSlot_t *from);
+static void dequePush(statsDeque_t *deque, uint32_t seq, float value, bool keepMin);
+static void dequeExpire(statsDeque_t *deque, uint32_t expiredSeq);
+static uint16_t bucketOf(const statsChannelState_t *channel, float value);
+static void resetWindow(statsWindowState_t *window, uint16_t slotCount);
+static void resetChannel(statsChannel_t channel);
+static void closeSlot(statsChannelState_t *channel, statsWindowState_t *window, uint16_t slotCount);
+static void advanceWindow(statsChannelState_t *channel, statsWindowState_t *window,
+                          const statsWindowConfig_t *config, uint32_t nowMs);
+static float quantile(const statsChannelState_t *channel, const uint32_t *histogram, uint32_t total,
+                      uint16_t extraBucket, uint32_t extraCount, float q);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Empties a slot.
+ * @param  statsSlot_t *slot: Slot to reset.
+ * @retval None
+ */
+static void slotReset(statsSlot_t *slot)
+{
+  slot->count = 0;
+  slot->mean = 0.0f;
+  slot->m2 = 0.0f;
+  slot->min = FLT_MAX;
+  slot->max = -FLT_MAX;
+}
+
+/**
+ * @brief  Welford update: adds one sample without the cancellation of a naive sum of squares.
+ * @param  statsSlot_t *slot: Slot to update.
+ * @param  float value: Sample value.
+ * @retval None
+ */
+static void slotAdd(statsSlot_t *slot, float value)
+{
+  float delta = value - slot->mean;
+
+  slot->count++;
+  slot->mean += delta / (float)slot->count;
+  slot->m2 += delta * (value - slot->mean);
+
+  if (value < slot->min)
+  {
+    slot->min = value;
+  }
+  if (value > slot->max)
+  {
+    slot->max = value;
+  }
+}
+
+/**
+ * @brief  Chan's parallel combination of two Welford accumulators.
+ * @param  statsSlot_t *into: Accumulator updated in place.
+ * @param  const statsSlot_t *from: Accumulator merged into it.
+ * @retval None
+ */
+static void slotMerge(statsSlot_t *into, const statsSlot_t *from)
+{
+  if (from->count == 0U)
+  {
+    return;
+  }
+  if (into->count == 0U)
+  {
+    *into = *from;
+    return;
+  }
+
+  float total = (float)(into->count + from->count);
+  float delta = from->mean - into->mean;
+
+  into->mean += delta * (float)from->count / total;
+  into->m2 += from->m2 + delta * delta * (float)into->count * (float)from->count / total;
+  into->count += from->count;
+
+  if (from->min < into->min)
+  {
+    into->min = from->min;
+  }
+  if (from->max > into->max)
+  {
+    into->max = from->max;
+  }
+}
+
+/**
+ * @brief  Appends a closed slot extreme, first dropping the entries it dominates from the back.
+ * @param  statsDeque_t *deque: Deque to update.
+ * @param  uint32_t seq: Sequence number of the slot.
+ * @param  float value: Slot minimum or maximum.
+ * @param  bool keepMin: true for the minimum deque, false for the maximum deque.
+ * @retval None
+ */
+static void dequePush(statsDeque_t *deque, uint32_t seq, float value, bool keepMin)
+{
+  while (deque->size > 0U)
+  {
+    uint16_t back = (uint16_t)((deque->head + deque->size - 1U) % deque->capacity);
+    float backValue = deque->entries[back].value;
+
+    if (keepMin ? (backValue < value) : (backValue > value))
+    {
+      break;
+    }
+    deque->size--;
+  }
+
+  // Entries expire in order before the slot ring wraps, so the deque never holds more than capacity entries
+  uint16_t tail = (uint16_t)((deque->head + deque->size) % deque->capacity);
+  deque->entries[tail].seq = seq;
+  deque->entries[tail].value = value;
+  deque->size++;
+}
+
+/**
+ * @brief  Drops the front entry if it belongs to the slot leaving the window.
+ * @param  statsDeque_t *deque: Deque to update.
+ * @param  uint32_t expiredSeq: Sequence number of the slot that left the window.
+ * @retval None
+ */
+static void dequeExpire(statsDeque_t *deque, uint32_t expiredSeq)
+{
+  if (deque->size > 0U && deque->entries[deque->head].seq == expiredSeq)
+  {
+    deque->head = (uint16_t)((deque->head + 1U) % deque->capacity);
+    deque->size--;
+  }
+}
+
+/**
+ * @brief  Maps a value to its histogram bucket, clamping to the edge buckets.
+ * @param  const statsChannelState_t *channel: Channel holding the histogram range.
+ * @param  float value: Value to map.
+ * @retval uint16_t: Bucket index.
+ */
+static uint16_t bucketOf(const statsChannelState_t *channel, float value)
+{
+  float position = (value - channel->lowest) / channel->bucketWidth;
+
+  if (position <= 0.0f)
+  {
+    return 0;
+  }
+  if (position >= (float)(STATS_HISTOGRAM_BUCKETS - 1U))
+  {
+    return STATS_HISTOGRAM_BUCKETS - 1U;
+  }
+
+  return (uint16_t)position;
+}
+
+/**
+ * @brief  Empties a window: slots, deques and histogram.
+ * @param  statsWindowState_t *window: Window to reset.
+ * @param  uint16_t slotCount: Number of slots of the window.
+ * @retval None
+ */
+static void resetWindow(statsWindowState_t *window, uint16_t slotCount)
+{
+  for (uint16_t i = 0; i < slotCount; i++)
+  {
+    slotReset(&window->slots[i]);
+  }
+  memset(window->histogram, 0, STATS_HISTOGRAM_BUCKETS * sizeof(uint32_t));
+  window->minDeque.head = 0;
+  window->minDeque.size = 0;
+  window->maxDeque.head = 0;
+  window->maxDeque.size = 0;
+  slotReset(&window->current);
+  window->currentSeq = 0;
+  window->started = false;
+}
+
+/**
+ * @brief  Binds a channel's windows to their static storage and empties them.
+ * @param  statsChannel_t channel: Channel to reset.
+ * @retval None
+ */
+static void resetChannel(statsChannel_t channel)
+{
+  statsChannelState_t *state = &channels[channel];
+  statsSlot_t *slotStorage[STATS_WINDOW_COUNT] = {slots1Min[channel], slots1Hour[channel], slots24Hour[channel]};
+  statsDequeEntry_t *minStorage[STATS_WINDOW_COUNT] = {minEntries1Min[channel], minEntries1Hour[channel],
+                                                       minEntries24Hour[channel]};
+  statsDequeEntry_t *maxStorage[STATS_WINDOW_COUNT] = {maxEntries1Min[channel], maxEntries1Hour[channel],
+                                                       maxEntries24Hour[channel]};
+
+  for (statsWindow_t w = 0; w < STATS_WINDOW_COUNT; w++)
+  {
+    statsWindowState_t *window = &state->windows[w];
+
+    window->slots = slotStorage[w];
+    window->histogram = histograms[channel][w];
+    window->minDeque.entries = minStorage[w];
+    window->minDeque.capacity = windowConfigs[w].slotCount;
+    window->maxDeque.entries = maxStorage[w];
+    window->maxDeque.capacity = windowConfigs[w].slotCount;
+    resetWindow(window, windowConfigs[w].slotCount);
+  }
+}
+
+/**
+ * @brief  Moves the current slot into the ring and expires the slot falling out of the window.
+ *         The window spans the current slot plus the last slotCount - 1 closed slots.
+ * @param  statsChannelState_t *channel: Channel owning the window.
+ * @param  statsWindowState_t *window: Window to update.
+ * @param  uint16_t slotCount: Number of slots of the window.
+ * @retval None
+ */
+static void closeSlot(statsChannelState_t *channel, statsWindowState_t *window, uint16_t slotCount)
+{
+  uint32_t seq = window->currentSeq;
+  const statsSlot_t *closed = &window->current;
+
+  if (closed->count > 0U)
+  {
+    window->histogram[bucketOf(channel, closed->mean)] += closed->count;
+    dequePush(&window->minDeque, seq, closed->min, true);
+    dequePush(&window->maxDeque, seq, closed->max, false);
+  }
+  window->slots[seq % slotCount] = *closed;
+
+  if (seq + 1U >= slotCount)
+  {
+    uint32_t expiredSeq = seq + 1U - slotCount;
+    statsSlot_t *expired = &window->slots[expiredSeq % slotCount];
+
+    if (expired->count > 0U)
+    {
+      window->histogram[bucketOf(channel, expired->mean)] -= expired->count;
+      dequeExpire(&window->minDeque, expiredSeq);
+      dequeExpire(&window->maxDeque, expiredSeq);
+    }
+    slotReset(expired);
+  }
+
+  window->currentSeq = seq + 1U;
+  slotReset(&window->current);
+}
+
+/**
+ * @brief  Closes every slot whose time span ended before nowMs. A gap longer than the window empties it.
+ * @param  statsChannelState_t *channel: Channel owning the window.
+ * @param  statsWindowState_t *window: Window to update.
+ * @param  const statsWindowConfig_t *config: Slot length and count of the window.
+ * @param  uint32_t nowMs: Current time in milliseconds.
+ * @retval None
+ */
+static void advanceWindow(statsChannelState_t *channel, statsWindowState_t *window,
+                          const statsWindowConfig_t *config, uint32_t nowMs)
+{
+  if (!window->started)
+  {
+    window->currentStartMs = nowMs;
+    window->started = true;
+    return;
+  }
+
+  uint32_t elapsedSlots = (nowMs - window->currentStartMs) / config->slotMs;
+
+  if (elapsedSlots >= config->slotCount)
+  {
+    resetWindow(window, config->slotCount);
+    window->currentStartMs = nowMs;
+    window->started = true;
+    return;
+  }
+
+  for (uint32_t i = 0; i < elapsedSlots; i++)
+  {
+    closeSlot(channel, window, config->slotCount);
+  }
+  window->currentStartMs += elapsedSlots * config->slotMs;
+}
+
+/**
+ * @brief  Estimates a quantile from a bucketed histogram, interpolating linearly inside the bucket.
+ * @param  const statsChannelState_t *channel: Channel holding the histogram range.
+ * @param  const uint32_t *histogram: Closed-slot histogram.
+ * @param  uint32_t total: Total count, including the extra contribution.
+ * @param  uint16_t extraBucket: Bucket of the open slot, which is not in the histogram yet.
+ * @param  uint32_t extraCount: Sample count of the open slot.
+ * @param  float q: Quantile in [0, 1].
+ * @retval float: Quantile estimate.
+ */
+static float quantile(const statsChannelState_t *channel, const uint32_t *histogram, uint32_t total,
+                      uint16_t extraBucket, uint32_t extraCount, float q)
+{
+  float target = q * (float)total;
+  uint32_t cumulative = 0;
+
+  for (uint16_t bucket = 0; bucket < STATS_HISTOGRAM_BUCKETS; bucket++)
+  {
+    uint32_t count = histogram[bucket] + ((bucket == extraBucket) ? extraCount : 0U);
+
+    if (count > 0U && (float)(cumulative + count) >= target)
+    {
+      float fraction = (target - (float)cumulative) / (float)count;
+      return channel->lowest + ((float)bucket + fraction) * channel->bucketWidth;
+    }
+    cumulative += count;
+  }
+
+  return channel->lowest + (float)STATS_HISTOGRAM_BUCKETS * channel->bucketWidth;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Clears every window of every channel. Histograms default to 0 + 1.0 per bucket.
+ * @param  None
+ * @retval None
+ */
+void API_STATS_Init(void)
+{
+  for (statsChannel_t channel = 0; channel < STATS_CHANNEL_COUNT; channel++)
+  {
+    channels[channel].lowest = 0.0f;
+    channels[channel].bucketWidth = 1.0f;
+    resetChannel(channel);
+  }
+}
+
+/**
+ * @brief  Sets the value range covered by a channel's quantile histograms and clears the channel.
+ *         Quantiles are estimated from slot means, so their resolution is the larger of the bucket
+ *         width and the spread inside one slot.
+ * @param  channel: Channel to configure.
+ * @param  lowest: Lower edge of the first bucket.
+ * @param  bucketWidth: Width of each bucket, in the channel's unit.
+ * @retval bool: true on success, false if the channel or the width is invalid.
+ */
+bool API_STATS_ConfigureHistogram(statsChannel_t channel, float lowest, float bucketWidth)
+{
+  if (channel >= STATS_CHANNEL_COUNT || !(bucketWidth > 0.0f))
+  {
+    return false;
+  }
+
+  channels[channel].lowest = lowest;
+  channels[channel].bucketWidth = bucketWidth;
+  resetChannel(channel);
+
+  return true;
+}
+
+/**
+ * @brief  Adds one sample to every window of a channel. Constant time apart from slot roll-overs,
+ *         which close at most one slot per elapsed slot period.
+ * @param  channel: Channel the sample belongs to.
+ * @param  value: Sample value.
+ * @param  nowMs: Sample time in milliseconds (monotonic, wrap-safe).
+ * @retval None
+ */
+void API_STATS_Push(statsChannel_t channel, float value, uint32_t nowMs)
+{
+  if (channel >= STATS_CHANNEL_COUNT)
+  {
+    return;
+  }
+
+  statsChannelState_t *state = &channels[channel];
+
+  for (statsWindow_t w = 0; w < STATS_WINDOW_COUNT; w++)
+  {
+    advanceWindow(state, &state->windows[w], &windowConfigs[w], nowMs);
+    slotAdd(&state->windows[w].current, value);
+  }
+}
+
+/**
+ * @brief  Computes the statistics of a channel over a window, as of the last pushed sample.
+ *         Mean and variance merge the window's slots, min/max come from the deque fronts and the
+ *         open slot, quantiles of the slot means from the histogram plus the open slot.
+ * @param  channel: Channel to query.
+ * @param  window: Window to query.
+ * @param  summary: Filled with the window statistics.
+ * @retval bool: true if the window holds at least one sample.
+ */
+bool API_STATS_GetSummary(statsChannel_t channel, statsWindow_t window, statsSummary_t *summary)
+{
+  if (channel >= STATS_CHANNEL_COUNT || window >= STATS_WINDOW_COUNT || summary == NULL)
+  {
+    return false;
+  }
+
+  const statsChannelState_t *state = &channels[channel];
+  const statsWindowState_t *windowState = &state->windows[window];
+  uint16_t slotCount = windowConfigs[window].slotCount;
+  statsSlot_t total;
+
+  memset(summary, 0, sizeof(*summary));
+  slotReset(&total);
+
+  for (uint16_t i = 0; i < slotCount; i++)
+  {
+    slotMerge(&total, &windowState->slots[i]);
+  }
+  slotMerge(&total, &windowState->current);
+
+  if (total.count == 0U)
+  {
+    return false;
+  }
+
+  summary->count = total.count;
+  summary->mean = total.mean;
+  summary->stddev = (total.count > 1U) ? sqrtf(total.m2 / (float)(total.count - 1U)) : 0.0f;
+
+  summary->min = windowState->current.min;
+  summary->max = windowState->current.max;
+  if (windowState->minDeque.size > 0U)
+  {
+    summary->min = fminf(summary->min, windowState->minDeque.entries[windowState->minDeque.head].value);
+  }
+  if (windowState->maxDeque.size > 0U)
+  {
+    summary->max = fmaxf(summary->max, windowState->maxDeque.entries[windowState->maxDeque.head].value);
+  }
+
+  uint16_t openBucket = bucketOf(state, windowState->current.mean);
+  uint32_t openCount = windowState->current.count;
+  summary->slotP50 = quantile(state, windowState->histogram, total.count, openBucket, openCount, 0.50f);
+  summary->slotP95 = quantile(state, windowState->histogram, total.count, openBucket, openCount, 0.95f);
+
+  // Bucket interpolation can overshoot the observed range on sparse windows
+  summary->slotP50 = fminf(fmaxf(summary->slotP50, summary->min), summary->max);
+  summary->slotP95 = fminf(fmaxf(summary->slotP95, summary->min), summary->max);
+
+  return true;
+}
@@ -0,0 +1,178 @@
+/* Includes ------------------------------------------------------------------*/
+#include "API_timestamp.h"
+
+/* Private variables ----------------------------------------------------------*/
+
+/* Cumulative days before each month, indexed by [leap][month - 1].
+ * Precomputed so the civil date -> day count conversion is a table lookup instead of a loop over months. */
+static const uint16_t monthOffsets[2][TIMESTAMP_MONTHS_PER_YEAR + 1] = {
+    {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365},
+    {0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335, 366}};
+
+// "Same day as last call" cache for API_TIMESTAMP_FromRTC, keyed by the packed BCD date
+static uint32_t cachedDateKey = UINT32_MAX;
+static timestamp_t cachedDayStart;
+
+// "Same day as last call" cache for API_TIMESTAMP_ToRTC, keyed by the day number
+static uint32_t cachedDayNumber = UINT32_MAX;
+static RTC_DateTypeDef cachedDate;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static inline uint8_t bcdToBin(uint8_t bcd);
+static inline uint8_t binToBcd(uint8_t bin);
+static uint32_t daysFromCivil(uint8_t year, uint8_t month, uint8_t day);
+static void civilFromDays(uint32_t days, RTC_DateTypeDef *date);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Converts a packed BCD byte (two digits) to binary.
+ * @param  uint8_t bcd: BCD-encoded value.
+ * @retval uint8_t: Binary value.
+ */
+static inline uint8_t bcdToBin(uint8_t bcd)
+{
+  return (uint8_t)((bcd >> 4) * 10U + (bcd & 0x0FU));
+}
+
+/**
+ * @brief  Converts a binary value (0..99) to a packed BCD byte.
+ * @param  uint8_t bin: Binary value.
+ * @retval uint8_t: BCD-encoded value.
+ */
+static inline uint8_t binToBcd(uint8_t bin)
+{
+  return (uint8_t)(((bin / 10U) << 4) | (bin % 10U));
+}
+
+/**
+ * @brief  Counts days from 2000-01-01 to the given date (binary fields, year 0..99).
+ *         Within 2000..2099 every fourth year is a leap year (2000 included), so the leap day
+ *         count reduces to (year + 3) / 4 and no century rules are needed.
+ * @param  uint8_t year: Years since 2000.
+ * @param  uint8_t month: Month, 1..12.
+ * @param  uint8_t day: Day of month, 1..31.
+ * @retval uint32_t: Days since the epoch origin.
+ */
+static uint32_t daysFromCivil(uint8_t year, uint8_t month, uint8_t day)
+{
+  uint32_t leap = ((year & 3U) == 0U);
+
+  return (uint32_t)year * TIMESTAMP_DAYS_PER_YEAR + ((uint32_t)year + 3U) / 4U +
+         monthOffsets[leap][month - 1U] + (uint32_t)day - 1U;
+}
+
+/**
+ * @brief  Converts a day count since 2000-01-01 into a BCD RTC date, weekday included.
+ *         The year comes from the 4-year leap cycle, the month from a single estimate-and-correct
+ *         step: no month is longer than 31 days, so day_of_year / 31 is at most one month short.
+ * @param  uint32_t days: Days since the epoch origin.
+ * @param  RTC_DateTypeDef *date: Date structure to fill (BCD).
+ * @retval None
+ */
+static void civilFromDays(uint32_t days, RTC_DateTypeDef *date)
+{
+  uint32_t cycle = days / TIMESTAMP_DAYS_PER_LEAP_CYCLE;
+  uint32_t dayOfCycle = days % TIMESTAMP_DAYS_PER_LEAP_CYCLE;
+
+  // The first year of each cycle is the leap one (366 days), the other three have 365
+  uint32_t yearOfCycle = (dayOfCycle >= TIMESTAMP_DAYS_PER_YEAR + 1U) ? (dayOfCycle - 1U) / TIMESTAMP_DAYS_PER_YEAR : 0U;
+  uint32_t dayOfYear = dayOfCycle - yearOfCycle * TIMESTAMP_DAYS_PER_YEAR - (yearOfCycle != 0U);
+  uint32_t leap = (yearOfCycle == 0U);
+
+  uint32_t monthIndex = dayOfYear / TIMESTAMP_MAX_DAYS_PER_MONTH;
+  monthIndex += (dayOfYear >= monthOffsets[leap][monthIndex + 1U]);
+
+  date->Year = binToBcd((uint8_t)(cycle * 4U + yearOfCycle));
+  date->Month = binToBcd((uint8_t)(monthIndex + 1U));
+  date->Date = binToBcd((uint8_t)(dayOfYear - monthOffsets[leap][monthIndex] + 1U));
+  date->WeekDay = (uint8_t)((days + TIMESTAMP_EPOCH_WEEKDAY - 1U) % TIMESTAMP_DAYS_PER_WEEK + 1U);
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Converts a BCD RTC time/date pair into seconds since 2000-01-01.
+ *         Consecutive calls on the same calendar day reuse the cached start-of-day value.
+ * @param  time: Pointer to the BCD-encoded RTC time.
+ * @param  date: Pointer to the BCD-encoded RTC date.
+ * @retval timestamp_t: Seconds since the epoch origin.
+ */
+timestamp_t API_TIMESTAMP_FromRTC(const RTC_TimeTypeDef *time, const RTC_DateTypeDef *date)
+{
+  uint32_t dateKey = ((uint32_t)date->Year << 16) | ((uint32_t)date->Month << 8) | date->Date;
+
+  if (dateKey != cachedDateKey)
+  {
+    cachedDayStart = daysFromCivil(bcdToBin(date->Year), bcdToBin(date->Month), bcdToBin(date->Date)) * TIMESTAMP_SECONDS_PER_DAY;
+    cachedDateKey = dateKey;
+  }
+
+  return cachedDayStart +
+         bcdToBin(time->Hours) * TIMESTAMP_SECONDS_PER_HOUR +
+         bcdToBin(time->Minutes) * TIMESTAMP_SECONDS_PER_MINUTE +
+         bcdToBin(time->Seconds);
+}
+
+/**
+ * @brief  Converts seconds since 2000-01-01 back into a BCD RTC time/date pair (weekday included).
+ *         Consecutive calls on the same day number reuse the cached date.
+ * @param  timestamp: Seconds since the epoch origin.
+ * @param  time: Pointer to the BCD-encoded RTC time to fill.
+ * @param  date: Pointer to the BCD-encoded RTC date to fill.
+ * @retval None
+ */
+void API_TIMESTAMP_ToRTC(timestamp_t timestamp, RTC_TimeTypeDef *time, RTC_DateTypeDef *date)
+{
+  uint32_t dayNumber = timestamp / TIMESTAMP_SECONDS_PER_DAY;
+  uint32_t secondOfDay = timestamp % TIMESTAMP_SECONDS_PER_DAY;
+
+  if (dayNumber != cachedDayNumber)
+  {
+    civilFromDays(dayNumber, &cachedDate);
+    cachedDayNumber = dayNumber;
+  }
+  *date = cachedDate;
+
+  time->Hours = binToBcd((uint8_t)(secondOfDay / TIMESTAMP_SECONDS_PER_HOUR));
+  time->Minutes = binToBcd((uint8_t)((secondOfDay % TIMESTAMP_SECONDS_PER_HOUR) / TIMESTAMP_SECONDS_PER_MINUTE));
+  time->Seconds = binToBcd((uint8_t)(secondOfDay % TIMESTAMP_SECONDS_PER_MINUTE));
+  time->SubSeconds = 0;
+  time->DayLightSaving = RTC_DAYLIGHTSAVING_NONE;
+  time->StoreOperation = RTC_STOREOPERATION_RESET;
+}
+
+/**
+ * @brief  Returns the current RTC time as milliseconds since 2000-01-01, using RTC_SSR for the fraction.
+ *         Time and date come from one shadow register latch, so the result is coherent.
+ * @param  None
+ * @retval timestampMs_t: Milliseconds since the epoch origin.
+ */
+timestampMs_t API_TIMESTAMP_NowMs(void)
+{
+  RTC_TimeTypeDef time;
+  RTC_DateTypeDef date;
+
+  HAL_RTC_GetTime(&hrtc, &time, RTC_FORMAT_BCD);
+  HAL_RTC_GetDate(&hrtc, &date, RTC_FORMAT_BCD); // Unlock the shadow registers
+
+  uint32_t millis = ((time.SecondFraction - time.SubSeconds) * CLOCK_MS_PER_SECOND) / (time.SecondFraction + 1U);
+
+  return (timestampMs_t)API_TIMESTAMP_FromRTC(&time, &date) * TIMESTAMP_MS_PER_SECOND + millis;
+}
+
+/**
+ * @brief  Returns the current RTC time as seconds since 2000-01-01.
+ * @param  None
+ * @retval timestamp_t: Seconds since the epoch origin.
+ */
+timestamp_t API_TIMESTAMP_Now(void)
+{
+  RTC_TimeTypeDef time;
+  RTC_DateTypeDef date;
+
+  HAL_RTC_GetTime(&hrtc, &time, RTC_FORMAT_BCD);
+  HAL_RTC_GetDate(&hrtc, &date, RTC_FORMAT_BCD); // Unlock the shadow registers
+
+  return API_TIMESTAMP_FromRTC(&time, &date);
+}
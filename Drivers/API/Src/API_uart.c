@@ -1,13 +1,56 @@
 /* Includes ------------------------------------------------------------------*/
 #include "API_uart.h"
+#include "API_section.h"
+
+/* Private define ------------------------------------------------------------*/
+#define UART_CHARACTER_MASK 0x7FU    // 8-bit word with parity: the MSB is the parity bit
+#define UART_RX_ERROR 0x0100U        // Ring entry flag: parity, framing or noise error
+#define UART_RX_ERROR_FLAGS (USART_SR_PE | USART_SR_FE | USART_SR_NE)
+#define UART_REPLY_SIZE 80U
+#define UART_PERCENT_CENTI 100
+#define UART_DECIMAL 10
+#define UART_HEXADECIMAL 16
+#define UART_MAX_BAUD_DIGITS 7U
+#define UART_MIN_BRR 16U             // USARTDIV below 1 is not allowed with 16x oversampling
 
 /* Private variable ----------------------------------------------------------*/
 
 /* UART handler declaration */
 UART_HandleTypeDef UartHandle;
 
+static const uint32_t uartBaudRates[UART_BAUD_RATE_COUNT] = UART_BAUD_RATES;
+
+// Written by the interrupt, read by uartProcess; bit 8 is UART_RX_ERROR
+API_CCM_BSS static uint16_t rxRing[UART_RX_BUFFER_SIZE];
+static volatile uint16_t rxHead;
+static volatile uint16_t rxTail;
+static volatile uint32_t rxDropped;
+static volatile bool rxSettling;      // Bytes are ignored until UART_AUTOBAUD_SETTLE_MS after rxSettleStart
+static volatile uint32_t rxSettleStart;
+
+API_CCM_BSS static char command[UART_COMMAND_SIZE];
+static uint8_t commandLength;         // UART_COMMAND_SIZE once the line is too long: it is ignored
+static char reply[UART_REPLY_SIZE];
+
+static uartStatus_t uartStatus;
+static uint32_t fallbackBaud;         // Rate restored by a rollback or a failed hunt
+static uint32_t stateStart;           // Tick the confirmation wait or the hunt began
+static uint8_t errorRun;              // Errored bytes in a row
+static uint8_t syncCount;             // Clean '\r' in a row at the hunted rate
+static uint8_t huntIndex;
+
 /* Private function prototypes -----------------------------------------------*/
 static void Error_Handler(void);
+static bool applyBaudRate(uint32_t baudRate);
+static int8_t findBaudRate(uint32_t baudRate);
+static bool parseBaudRate(const char *text, uint32_t *baudRate);
+static void appendBaudInfo(char *text, const uartBaudInfo_t *info);
+static void handleByte(uint16_t entry, uint32_t now);
+static void runCommand(uint32_t now);
+static void startHunt(uint32_t now);
+static void huntNext(void);
+static void huntByte(uint16_t entry);
+static void restoreFallback(void);
 
 /* Public functions ----------------------------------------------------------*/
 
@@ -20,7 +63,7 @@ static void Error_Handler(void);
 bool_t uartInit(void)
 {
   UartHandle.Instance = USARTx;
-  UartHandle.Init.BaudRate = 9600;
+  UartHandle.Init.BaudRate = UART_BOOT_BAUD;
   UartHandle.Init.WordLength = UART_WORDLENGTH_8B;
   UartHandle.Init.StopBits = UART_STOPBITS_1;
   UartHandle.Init.Parity = UART_PARITY_ODD;
@@ -34,7 +77,23 @@ bool_t uartInit(void)
     return false;
   }
 
-  uartSendString((uint8_t *)"UART init OK -> baud rate configured = 9600 | stopbits = 1 | parity = odd.\r\n");
+  memset(&uartStatus, 0, sizeof(uartStatus));
+  uartStatus.baudRate = UART_BOOT_BAUD;
+  uartStatus.state = UART_LINK_FIXED;
+  rxHead = 0;
+  rxTail = 0;
+  rxDropped = 0;
+  rxSettling = false;
+  commandLength = 0;
+  errorRun = 0;
+  __HAL_UART_ENABLE_IT(&UartHandle, UART_IT_RXNE);
+  HAL_NVIC_SetPriority(USARTx_IRQn, UART_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(USARTx_IRQn);
+
+  strcpy(reply, "UART init OK -> baud rate configured = ");
+  utoa(UART_BOOT_BAUD, reply + strlen(reply), UART_DECIMAL);
+  strcat(reply, " | stopbits = 1 | parity = odd.\r\n");
+  uartSendString((uint8_t *)reply);
 
   return true;
 }
@@ -72,6 +131,126 @@ void uartSendStringSize(uint8_t *pstring, uint16_t size)
     Error_Handler();
 }
 
+/**
+ * @brief  Switches USART3 to another rate at once, without confirmation.
+ * @param  uint32_t baudRate: One of UART_BAUD_RATES.
+ * @retval bool_t: true if the rate is supported and within UART_MAX_ERROR_CENTI for PCLK1.
+ */
+bool_t uartSetBaudRate(uint32_t baudRate)
+{
+  uartBaudInfo_t info = uartGetBaudInfo(baudRate);
+
+  if (findBaudRate(baudRate) < 0 || info.errorCenti > UART_MAX_ERROR_CENTI || info.errorCenti < -UART_MAX_ERROR_CENTI)
+  {
+    return false;
+  }
+
+  return applyBaudRate(baudRate);
+}
+
+/**
+ * @brief  Computes the divider HAL_UART_Init programs for a rate (16x oversampling, UART_BRR_SAMPLING16)
+ *         and the rate it gives: PCLK1 / BRR.
+ * @param  uint32_t baudRate: Requested rate.
+ * @retval uartBaudInfo_t: Divider, actual rate and error. A divider below UART_MIN_BRR gives a zero rate.
+ */
+uartBaudInfo_t uartGetBaudInfo(uint32_t baudRate)
+{
+  uartBaudInfo_t info = {.requested = baudRate};
+  uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+
+  if (baudRate == 0U)
+  {
+    return info;
+  }
+
+  info.brr = UART_BRR_SAMPLING16(pclk, baudRate);
+  info.actual = info.brr >= UART_MIN_BRR ? (pclk + info.brr / 2U) / info.brr : 0U;
+  info.errorCenti = (int32_t)((((int64_t)info.actual - (int64_t)baudRate) * 10000) / (int64_t)baudRate);
+
+  return info;
+}
+
+/**
+ * @brief  Runs the received command lines, the confirmation timeout and the auto-baud hunt.
+ * @param  uint32_t now: Current tick in ms.
+ * @retval None
+ */
+void uartProcess(uint32_t now)
+{
+  while (rxTail != rxHead)
+  {
+    uint16_t entry = rxRing[rxTail];
+
+    rxTail = (uint16_t)((rxTail + 1U) % UART_RX_BUFFER_SIZE);
+    handleByte(entry, now);
+  }
+
+  if (uartStatus.state == UART_LINK_CONFIRMING && now - stateStart >= UART_CONFIRM_TIMEOUT_MS)
+  {
+    uartStatus.rollbacks++;
+    restoreFallback();
+  }
+  else if (uartStatus.state == UART_LINK_HUNTING && now - stateStart >= UART_AUTOBAUD_TIMEOUT_MS)
+  {
+    restoreFallback();
+  }
+}
+
+/**
+ * @brief  USART3 interrupt. Reading SR then DR clears RXNE and the error flags; an overrun lost a byte.
+ * @param  None
+ * @retval None
+ */
+void uartIrqHandler(void)
+{
+  uint32_t sr = USARTx->SR;
+  uint16_t entry = (uint16_t)(USARTx->DR & UART_CHARACTER_MASK);
+  uint16_t next = (uint16_t)((rxHead + 1U) % UART_RX_BUFFER_SIZE);
+
+  if ((sr & USART_SR_ORE) != 0U)
+  {
+    rxDropped++;
+  }
+  if ((sr & USART_SR_RXNE) == 0U)
+  {
+    return;
+  }
+  if (rxSettling)
+  {
+    if (HAL_GetTick() - rxSettleStart < UART_AUTOBAUD_SETTLE_MS)
+    {
+      return;
+    }
+    rxSettling = false;
+  }
+  if ((sr & UART_RX_ERROR_FLAGS) != 0U)
+  {
+    entry |= UART_RX_ERROR;
+  }
+
+  if (next == rxTail)
+  {
+    rxDropped++;
+    return;
+  }
+  rxRing[rxHead] = entry;
+  rxHead = next;
+}
+
+/**
+ * @brief  Returns the line rate and receive counters.
+ * @param  None
+ * @retval uartStatus_t: Counters.
+ */
+uartStatus_t uartGetStatus(void)
+{
+  uartStatus_t status = uartStatus;
+
+  status.rxDropped = rxDropped;
+  return status;
+}
+
 /**
  * @brief  Receive a specific number of characters via UART.
  * @param  uint8_t * pstring: pointer to the buffer where received characters will be stored.
@@ -91,6 +270,307 @@ void uartReceiveStringSize(uint8_t *pstring, uint16_t size)
 
 /* Private API code ----------------------------------------------------------*/
 
+/**
+ * @brief  Re-initialises USART3 at another rate. The blocking transmit has already waited for TC, so
+ *         nothing in flight is cut. Bytes received at the old rate are discarded.
+ * @param  uint32_t baudRate: New rate.
+ * @retval bool: true on success.
+ */
+static bool applyBaudRate(uint32_t baudRate)
+{
+  UartHandle.Init.BaudRate = baudRate;
+  if (HAL_UART_Init(&UartHandle) != HAL_OK)
+  {
+    return false;
+  }
+  __HAL_UART_ENABLE_IT(&UartHandle, UART_IT_RXNE);
+
+  rxTail = rxHead;
+  commandLength = 0;
+  errorRun = 0;
+  uartStatus.baudRate = baudRate;
+
+  return true;
+}
+
+/**
+ * @brief  Looks a rate up in UART_BAUD_RATES.
+ * @param  uint32_t baudRate: Rate.
+ * @retval int8_t: Index, or -1 if the rate is not supported.
+ */
+static int8_t findBaudRate(uint32_t baudRate)
+{
+  for (uint8_t i = 0; i < UART_BAUD_RATE_COUNT; i++)
+  {
+    if (uartBaudRates[i] == baudRate)
+    {
+      return (int8_t)i;
+    }
+  }
+
+  return -1;
+}
+
+/**
+ * @brief  Reads a decimal rate: digits only, at most UART_MAX_BAUD_DIGITS.
+ * @param  const char *text: Null-terminated text.
+ * @param  uint32_t *baudRate: Receives the rate.
+ * @retval bool: true if the text is a number.
+ */
+static bool parseBaudRate(const char *text, uint32_t *baudRate)
+{
+  uint32_t value = 0;
+  uint8_t digits = 0;
+
+  for (; *text != '\0'; text++)
+  {
+    if (*text < '0' || *text > '9' || ++digits > UART_MAX_BAUD_DIGITS)
+    {
+      return false;
+    }
+    value = value * UART_DECIMAL + (uint32_t)(*text - '0');
+  }
+
+  *baudRate = value;
+  return digits > 0U;
+}
+
+/**
+ * @brief  Appends " BRR 0x2d actual 933333 error +1.27%" to a reply.
+ * @param  char *text: Reply, with room for the info.
+ * @param  const uartBaudInfo_t *info: Rate info.
+ * @retval None
+ */
+static void appendBaudInfo(char *text, const uartBaudInfo_t *info)
+{
+  uint32_t error = (uint32_t)(info->errorCenti < 0 ? -info->errorCenti : info->errorCenti);
+
+  strcat(text, " BRR 0x");
+  utoa(info->brr, text + strlen(text), UART_HEXADECIMAL);
+  strcat(text, " actual ");
+  utoa(info->actual, text + strlen(text), UART_DECIMAL);
+  strcat(text, info->errorCenti < 0 ? " error -" : " error +");
+  utoa(error / UART_PERCENT_CENTI, text + strlen(text), UART_DECIMAL);
+  strcat(text, error % UART_PERCENT_CENTI < 10U ? ".0" : ".");
+  utoa(error % UART_PERCENT_CENTI, text + strlen(text), UART_DECIMAL);
+  strcat(text, "%");
+}
+
+/**
+ * @brief  Takes one received byte: builds the command line, or counts the errors that start a hunt.
+ * @param  uint16_t entry: Ring entry, character and UART_RX_ERROR.
+ * @param  uint32_t now: Current tick in ms.
+ * @retval None
+ */
+static void handleByte(uint16_t entry, uint32_t now)
+{
+  char character = (char)(entry & UART_CHARACTER_MASK);
+
+  uartStatus.rxBytes++;
+
+  if (uartStatus.state == UART_LINK_HUNTING)
+  {
+    huntByte(entry);
+    return;
+  }
+
+  if ((entry & UART_RX_ERROR) != 0U)
+  {
+    uartStatus.rxErrors++;
+    commandLength = 0;
+    // While confirming, errors mean the host is still at the old rate: the timeout rolls back
+    if (++errorRun >= UART_AUTOBAUD_ERRORS && uartStatus.state == UART_LINK_FIXED)
+    {
+      startHunt(now);
+    }
+    return;
+  }
+  errorRun = 0;
+
+  if (character == '\r' || character == '\n')
+  {
+    if (commandLength > 0U && commandLength < UART_COMMAND_SIZE)
+    {
+      command[commandLength] = '\0';
+      runCommand(now);
+    }
+    commandLength = 0;
+  }
+  else if (commandLength < UART_COMMAND_SIZE - 1U)
+  {
+    command[commandLength++] = character;
+  }
+  else
+  {
+    commandLength = UART_COMMAND_SIZE;
+  }
+}
+
+/**
+ * @brief  Runs a command line: "BAUD?", "BAUD <n>", or "OK" while a new rate waits for confirmation.
+ *         Anything else is ignored.
+ * @param  uint32_t now: Current tick in ms.
+ * @retval None
+ */
+static void runCommand(uint32_t now)
+{
+  uint32_t baudRate = 0;
+  uartBaudInfo_t info;
+
+  if (uartStatus.state == UART_LINK_CONFIRMING)
+  {
+    if (strcmp(command, "OK") == 0)
+    {
+      uartStatus.state = UART_LINK_FIXED;
+      uartStatus.switches++;
+      strcpy(reply, "BAUD ");
+      utoa(uartStatus.baudRate, reply + strlen(reply), UART_DECIMAL);
+      strcat(reply, " OK\r\n");
+      uartSendString((uint8_t *)reply);
+    }
+    return;
+  }
+
+  if (strcmp(command, "BAUD?") == 0)
+  {
+    info = uartGetBaudInfo(uartStatus.baudRate);
+    strcpy(reply, "BAUD ");
+    utoa(uartStatus.baudRate, reply + strlen(reply), UART_DECIMAL);
+    appendBaudInfo(reply, &info);
+    strcat(reply, "\r\n");
+    uartSendString((uint8_t *)reply);
+    return;
+  }
+
+  if (strncmp(command, "BAUD ", 5) != 0 || !parseBaudRate(command + 5, &baudRate))
+  {
+    return;
+  }
+
+  info = uartGetBaudInfo(baudRate);
+  strcpy(reply, "BAUD ");
+  utoa(baudRate, reply + strlen(reply), UART_DECIMAL);
+  if (findBaudRate(baudRate) < 0)
+  {
+    strcat(reply, " unsupported\r\n");
+    uartSendString((uint8_t *)reply);
+    return;
+  }
+  appendBaudInfo(reply, &info);
+  if (info.errorCenti > UART_MAX_ERROR_CENTI || info.errorCenti < -UART_MAX_ERROR_CENTI)
+  {
+    strcat(reply, " refused\r\n");
+    uartSendString((uint8_t *)reply);
+    return;
+  }
+  strcat(reply, " send OK\r\n");
+  uartSendString((uint8_t *)reply); // At the old rate, before the switch
+
+  fallbackBaud = uartStatus.baudRate;
+  if (applyBaudRate(baudRate))
+  {
+    uartStatus.state = UART_LINK_CONFIRMING;
+    stateStart = now;
+  }
+  else
+  {
+    restoreFallback();
+  }
+}
+
+/**
+ * @brief  Starts the auto-baud hunt at the rate after the current one.
+ * @param  uint32_t now: Current tick in ms.
+ * @retval None
+ */
+static void startHunt(uint32_t now)
+{
+  int8_t index = findBaudRate(uartStatus.baudRate);
+
+  fallbackBaud = uartStatus.baudRate;
+  huntIndex = (uint8_t)(index < 0 ? 0 : index);
+  uartStatus.state = UART_LINK_HUNTING;
+  stateStart = now;
+  huntNext();
+}
+
+/**
+ * @brief  Moves the hunt to the next rate of UART_BAUD_RATES, wrapping around, skipping the rates PCLK1
+ *         cannot make. The line settles before bytes count again: the one in flight is garbled.
+ * @param  None
+ * @retval None
+ */
+static void huntNext(void)
+{
+  for (uint8_t tries = 0; tries < UART_BAUD_RATE_COUNT; tries++)
+  {
+    huntIndex = (uint8_t)((huntIndex + 1U) % UART_BAUD_RATE_COUNT);
+    uartBaudInfo_t info = uartGetBaudInfo(uartBaudRates[huntIndex]);
+
+    if (info.errorCenti <= UART_MAX_ERROR_CENTI && info.errorCenti >= -UART_MAX_ERROR_CENTI)
+    {
+      break;
+    }
+  }
+
+  syncCount = 0;
+  rxSettleStart = HAL_GetTick();
+  rxSettling = true;
+  applyBaudRate(uartBaudRates[huntIndex]);
+}
+
+/**
+ * @brief  Judges a byte received while hunting: an error moves to the next rate, UART_AUTOBAUD_SYNC clean
+ *         '\r' in a row lock the rate. Other clean characters neither help nor hurt.
+ * @param  uint16_t entry: Ring entry.
+ * @retval None
+ */
+static void huntByte(uint16_t entry)
+{
+  if ((entry & UART_RX_ERROR) != 0U)
+  {
+    uartStatus.rxErrors++;
+    huntNext();
+    return;
+  }
+  if ((entry & UART_CHARACTER_MASK) != '\r')
+  {
+    syncCount = 0;
+    return;
+  }
+  if (++syncCount < UART_AUTOBAUD_SYNC)
+  {
+    return;
+  }
+
+  uartStatus.state = UART_LINK_FIXED;
+  uartStatus.autobauds++;
+  strcpy(reply, "BAUD ");
+  utoa(uartStatus.baudRate, reply + strlen(reply), UART_DECIMAL);
+  strcat(reply, " detected\r\n");
+  uartSendString((uint8_t *)reply);
+}
+
+/**
+ * @brief  Goes back to the rate in use before the switch or the hunt, and says so at that rate.
+ * @param  None
+ * @retval None
+ */
+static void restoreFallback(void)
+{
+  uartStatus.state = UART_LINK_FIXED;
+  rxSettling = false;
+  if (!applyBaudRate(fallbackBaud))
+  {
+    Error_Handler();
+  }
+
+  strcpy(reply, "BAUD ");
+  utoa(uartStatus.baudRate, reply + strlen(reply), UART_DECIMAL);
+  strcat(reply, " restored\r\n");
+  uartSendString((uint8_t *)reply);
+}
+
 /**
  * @brief  Handles errors by entering an infinite loop.
  * @param  None.
@@ -0,0 +1,417 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "API_udp.h"
+#include "API_udp_port.h"
+#include "API_section.h"
+
+/* Private define ------------------------------------------------------------*/
+
+// Ethernet II header
+#define UDP_ETH_DESTINATION_OFFSET 0U
+#define UDP_ETH_SOURCE_OFFSET 6U
+#define UDP_ETH_TYPE_OFFSET 12U
+#define UDP_ETH_TYPE_IPV4 0x0800U
+
+// IPv4 header, no options
+#define UDP_IP_OFFSET UDP_ETH_HEADER_SIZE
+#define UDP_IP_VERSION_IHL_OFFSET (UDP_IP_OFFSET + 0U)
+#define UDP_IP_LENGTH_OFFSET (UDP_IP_OFFSET + 2U)
+#define UDP_IP_ID_OFFSET (UDP_IP_OFFSET + 4U)
+#define UDP_IP_FLAGS_OFFSET (UDP_IP_OFFSET + 6U)
+#define UDP_IP_TTL_OFFSET (UDP_IP_OFFSET + 8U)
+#define UDP_IP_PROTOCOL_OFFSET (UDP_IP_OFFSET + 9U)
+#define UDP_IP_CHECKSUM_OFFSET (UDP_IP_OFFSET + 10U)
+#define UDP_IP_SOURCE_OFFSET (UDP_IP_OFFSET + 12U)
+#define UDP_IP_DESTINATION_OFFSET (UDP_IP_OFFSET + 16U)
+#define UDP_IP_VERSION_IHL 0x45U   // IPv4, five-word header
+#define UDP_IP_DONT_FRAGMENT 0x4000U
+#define UDP_IP_TTL 64U
+#define UDP_IP_PROTOCOL_UDP 17U
+
+// UDP header
+#define UDP_UDP_OFFSET (UDP_IP_OFFSET + UDP_IP_HEADER_SIZE)
+#define UDP_UDP_SOURCE_OFFSET (UDP_UDP_OFFSET + 0U)
+#define UDP_UDP_DESTINATION_OFFSET (UDP_UDP_OFFSET + 2U)
+#define UDP_UDP_LENGTH_OFFSET (UDP_UDP_OFFSET + 4U)
+#define UDP_UDP_CHECKSUM_OFFSET (UDP_UDP_OFFSET + 6U)
+
+// Payload header, then the records from an even offset: the checksum words never straddle two records
+#define UDP_PAYLOAD_OFFSET UDP_HEADERS_SIZE
+#define UDP_PAYLOAD_MAGIC_OFFSET (UDP_PAYLOAD_OFFSET + 0U)
+#define UDP_PAYLOAD_VERSION_OFFSET (UDP_PAYLOAD_OFFSET + 2U)
+#define UDP_PAYLOAD_COUNT_OFFSET (UDP_PAYLOAD_OFFSET + 3U)
+#define UDP_PAYLOAD_SEQUENCE_OFFSET (UDP_PAYLOAD_OFFSET + 4U)
+#define UDP_RECORDS_OFFSET (UDP_PAYLOAD_OFFSET + UDP_PAYLOAD_HEADER_SIZE)
+
+// Source MAC: ST's OUI 00:80:E1 with the locally administered bit set, then 24 bits of the unique ID
+#define UDP_MAC_OUI_0 0x02U
+#define UDP_MAC_OUI_1 0x80U
+#define UDP_MAC_OUI_2 0xE1U
+
+/* Private variables ----------------------------------------------------------*/
+
+// Read by the ETH DMA through the transmit descriptors: SRAM1/2, never CCM
+API_DMA_BSS static uint8_t frameBuffers[UDP_FRAME_COUNT][UDP_FRAME_BUFFER_SIZE];
+static bool frameBusy[UDP_FRAME_COUNT]; // Owned by the DMA, until API_UDP_OnFrameSent
+static uint8_t fillIndex;               // Frame receiving records, frames are sent and returned in turn
+static uint8_t fillCount;               // Records in it
+static uint32_t fillSum;                // Ones' complement sum of those records, carries not folded
+
+static udpConfig_t config;
+static uint32_t pseudoHeaderSum; // Addresses, protocol and ports: the constant part of every UDP checksum
+static uint16_t ipId;
+static uint32_t sequence;
+static uint32_t lastLinkPollMs;
+static bool linkPollDue;
+static udpStatus_t status;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void putBE16(uint8_t *bytes, uint16_t value);
+static uint16_t getBE16(const uint8_t *bytes);
+static void putLE32(uint8_t *bytes, uint32_t value);
+static uint32_t sumWords(uint32_t sum, const uint8_t *bytes, uint16_t length);
+static uint16_t foldSum(uint32_t sum);
+static uint16_t updateChecksum(uint16_t checksum, uint16_t oldValue, uint16_t newValue);
+static void setField(uint8_t *frame, uint16_t offset, uint16_t value);
+static void writeTemplate(uint8_t *frame);
+static void sendFrame(void);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Writes a big-endian (network order) 16-bit value.
+ * @param  uint8_t *bytes: Destination bytes.
+ * @param  uint16_t value: Value.
+ * @retval None
+ */
+static void putBE16(uint8_t *bytes, uint16_t value)
+{
+  bytes[0] = (uint8_t)(value >> 8);
+  bytes[1] = (uint8_t)value;
+}
+
+/**
+ * @brief  Reads a big-endian (network order) 16-bit value.
+ * @param  const uint8_t *bytes: Source bytes.
+ * @retval uint16_t: Value.
+ */
+static uint16_t getBE16(const uint8_t *bytes)
+{
+  return (uint16_t)(((uint16_t)bytes[0] << 8) | bytes[1]);
+}
+
+/**
+ * @brief  Writes a little-endian 32-bit value.
+ * @param  uint8_t *bytes: Destination bytes.
+ * @param  uint32_t value: Value.
+ * @retval None
+ */
+static void putLE32(uint8_t *bytes, uint32_t value)
+{
+  bytes[0] = (uint8_t)value;
+  bytes[1] = (uint8_t)(value >> 8);
+  bytes[2] = (uint8_t)(value >> 16);
+  bytes[3] = (uint8_t)(value >> 24);
+}
+
+/**
+ * @brief  Adds big-endian 16-bit words to a ones' complement sum. The carries are folded later:
+ *         a 32-bit sum holds 65535 words, far more than a frame.
+ * @param  uint32_t sum: Sum so far.
+ * @param  const uint8_t *bytes: Words, starting at an even offset of the datagram.
+ * @param  uint16_t length: Number of bytes, even.
+ * @retval uint32_t: New sum.
+ */
+static uint32_t sumWords(uint32_t sum, const uint8_t *bytes, uint16_t length)
+{
+  for (uint16_t i = 0; i < length; i += 2U)
+  {
+    sum += getBE16(&bytes[i]);
+  }
+
+  return sum;
+}
+
+/**
+ * @brief  Folds the carries of a ones' complement sum into its low 16 bits.
+ * @param  uint32_t sum: Sum with carries.
+ * @retval uint16_t: 16-bit sum, not complemented.
+ */
+static uint16_t foldSum(uint32_t sum)
+{
+  while ((sum >> 16) != 0U)
+  {
+    sum = (sum & 0xFFFFU) + (sum >> 16);
+  }
+
+  return (uint16_t)sum;
+}
+
+/**
+ * @brief  Updates an Internet checksum for one changed 16-bit field, RFC 1624 eqn. 3: HC' = ~(~HC + ~m + m').
+ * @param  uint16_t checksum: Checksum covering the old value.
+ * @param  uint16_t oldValue: Old field value m.
+ * @param  uint16_t newValue: New field value m'.
+ * @retval uint16_t: Checksum covering the new value.
+ */
+static uint16_t updateChecksum(uint16_t checksum, uint16_t oldValue, uint16_t newValue)
+{
+  uint32_t sum = (uint16_t)~checksum + (uint32_t)(uint16_t)~oldValue + newValue;
+
+  return (uint16_t)~foldSum(sum);
+}
+
+/**
+ * @brief  Changes a field of the IPv4 header and updates the header checksum from its previous value.
+ * @param  uint8_t *frame: Frame buffer.
+ * @param  uint16_t offset: Field offset in the frame.
+ * @param  uint16_t value: New field value.
+ * @retval None
+ */
+static void setField(uint8_t *frame, uint16_t offset, uint16_t value)
+{
+  uint16_t checksum = getBE16(&frame[UDP_IP_CHECKSUM_OFFSET]);
+
+  putBE16(&frame[UDP_IP_CHECKSUM_OFFSET], updateChecksum(checksum, getBE16(&frame[offset]), value));
+  putBE16(&frame[offset], value);
+}
+
+/**
+ * @brief  Writes the Ethernet, IPv4 and UDP headers and the constant payload header fields into a frame buffer.
+ *         Lengths and identification are zero, the IP checksum covers them as such.
+ * @param  uint8_t *frame: Frame buffer.
+ * @retval None
+ */
+static void writeTemplate(uint8_t *frame)
+{
+  memset(frame, 0, UDP_RECORDS_OFFSET);
+
+  memcpy(&frame[UDP_ETH_DESTINATION_OFFSET], config.destinationMac, UDP_MAC_SIZE);
+  memcpy(&frame[UDP_ETH_SOURCE_OFFSET], status.mac, UDP_MAC_SIZE);
+  putBE16(&frame[UDP_ETH_TYPE_OFFSET], UDP_ETH_TYPE_IPV4);
+
+  frame[UDP_IP_VERSION_IHL_OFFSET] = UDP_IP_VERSION_IHL;
+  putBE16(&frame[UDP_IP_FLAGS_OFFSET], UDP_IP_DONT_FRAGMENT);
+  frame[UDP_IP_TTL_OFFSET] = UDP_IP_TTL;
+  frame[UDP_IP_PROTOCOL_OFFSET] = UDP_IP_PROTOCOL_UDP;
+  memcpy(&frame[UDP_IP_SOURCE_OFFSET], config.sourceIp, UDP_IP_SIZE);
+  memcpy(&frame[UDP_IP_DESTINATION_OFFSET], config.destinationIp, UDP_IP_SIZE);
+  putBE16(&frame[UDP_IP_CHECKSUM_OFFSET],
+          (uint16_t)~foldSum(sumWords(0, &frame[UDP_IP_OFFSET], UDP_IP_HEADER_SIZE)));
+
+  putBE16(&frame[UDP_UDP_SOURCE_OFFSET], config.sourcePort);
+  putBE16(&frame[UDP_UDP_DESTINATION_OFFSET], config.destinationPort);
+
+  frame[UDP_PAYLOAD_MAGIC_OFFSET] = (uint8_t)UDP_PAYLOAD_MAGIC;
+  frame[UDP_PAYLOAD_MAGIC_OFFSET + 1U] = (uint8_t)(UDP_PAYLOAD_MAGIC >> 8);
+  frame[UDP_PAYLOAD_VERSION_OFFSET] = UDP_PAYLOAD_VERSION;
+}
+
+/**
+ * @brief  Completes the filling frame (lengths, identification, checksums, payload header) and hands it to the MAC.
+ *         A frame the MAC refuses is counted and its records are lost; its sequence number is skipped either way,
+ *         so the collector sees the gap.
+ * @param  None
+ * @retval None
+ */
+static void sendFrame(void)
+{
+  uint8_t *frame = frameBuffers[fillIndex];
+  uint16_t udpLength = (uint16_t)(UDP_UDP_HEADER_SIZE + UDP_PAYLOAD_HEADER_SIZE + fillCount * UDP_RECORD_SIZE);
+  uint16_t frameLength = (uint16_t)(UDP_ETH_HEADER_SIZE + UDP_IP_HEADER_SIZE + udpLength);
+
+  frame[UDP_PAYLOAD_COUNT_OFFSET] = fillCount;
+  putLE32(&frame[UDP_PAYLOAD_SEQUENCE_OFFSET], sequence);
+
+  setField(frame, UDP_IP_LENGTH_OFFSET, (uint16_t)(UDP_IP_HEADER_SIZE + udpLength));
+  setField(frame, UDP_IP_ID_OFFSET, ipId);
+
+  // Pseudo header length and UDP header length are the same field counted twice
+  uint32_t sum = pseudoHeaderSum + 2U * (uint32_t)udpLength + fillSum +
+                 sumWords(0, &frame[UDP_PAYLOAD_OFFSET], UDP_PAYLOAD_HEADER_SIZE);
+  uint16_t checksum = (uint16_t)~foldSum(sum);
+
+  putBE16(&frame[UDP_UDP_LENGTH_OFFSET], udpLength);
+  putBE16(&frame[UDP_UDP_CHECKSUM_OFFSET], checksum == 0U ? 0xFFFFU : checksum); // 0 means no checksum
+
+  frameBusy[fillIndex] = true;
+  if (UDP_HAL_Transmit(frame, frameLength))
+  {
+    status.frames++;
+    status.bytes += frameLength;
+    status.records += fillCount;
+    fillIndex = (uint8_t)((fillIndex + 1U) % UDP_FRAME_COUNT);
+  }
+  else
+  {
+    frameBusy[fillIndex] = false;
+    status.txErrors++;
+  }
+
+  ipId++;
+  sequence++;
+  fillCount = 0;
+  fillSum = 0;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Initialises the Ethernet MAC and writes the header template into every frame buffer.
+ *         The link is read at the first API_UDP_Process call.
+ * @param  const udpConfig_t *udpConfig: Addresses and batching, copied. batchRecords is clamped to 1..UDP_MAX_RECORDS.
+ * @retval bool: true if the MAC is ready.
+ */
+bool API_UDP_Init(const udpConfig_t *udpConfig)
+{
+  uint32_t uid[UDP_HAL_UNIQUE_ID_WORDS];
+
+  config = *udpConfig;
+  if (config.batchRecords == 0U || config.batchRecords > UDP_MAX_RECORDS)
+  {
+    config.batchRecords = (uint8_t)UDP_MAX_RECORDS;
+  }
+
+  memset(&status, 0, sizeof(status));
+  UDP_HAL_GetUniqueId(uid);
+  uint32_t id = uid[0] ^ uid[1] ^ uid[2];
+  status.mac[0] = UDP_MAC_OUI_0;
+  status.mac[1] = UDP_MAC_OUI_1;
+  status.mac[2] = UDP_MAC_OUI_2;
+  status.mac[3] = (uint8_t)(id >> 16);
+  status.mac[4] = (uint8_t)(id >> 8);
+  status.mac[5] = (uint8_t)id;
+
+  for (uint8_t i = 0; i < UDP_FRAME_COUNT; i++)
+  {
+    writeTemplate(frameBuffers[i]);
+    frameBusy[i] = false;
+  }
+
+  pseudoHeaderSum = sumWords(0, config.sourceIp, UDP_IP_SIZE) + sumWords(0, config.destinationIp, UDP_IP_SIZE) +
+                    UDP_IP_PROTOCOL_UDP + config.sourcePort + config.destinationPort;
+  fillIndex = 0;
+  fillCount = 0;
+  fillSum = 0;
+  ipId = 0;
+  sequence = 0;
+  linkPollDue = true;
+
+  status.ready = UDP_HAL_Init(status.mac);
+
+  return status.ready;
+}
+
+/**
+ * @brief  Writes a record into the filling frame buffer and hands the frame to the MAC once it holds
+ *         batchRecords records. Never waits. Records are ignored while the link is down.
+ * @param  uint32_t tick: Sample time in ms.
+ * @param  int32_t temperature: Temperature in 0.01 C.
+ * @param  uint32_t humidity: Humidity in %RH Q22.10.
+ * @retval bool: true if the record was written, false if it was ignored or dropped.
+ */
+bool API_UDP_Append(uint32_t tick, int32_t temperature, uint32_t humidity)
+{
+  if (!status.linkUp)
+  {
+    return false;
+  }
+
+  // Only an empty frame can still be on the wire: the filling one is never handed over before it is full
+  if (frameBusy[fillIndex])
+  {
+    status.droppedRecords++;
+    return false;
+  }
+
+  uint8_t *record = &frameBuffers[fillIndex][UDP_RECORDS_OFFSET + fillCount * UDP_RECORD_SIZE];
+
+  putLE32(&record[0], tick);
+  putLE32(&record[4], (uint32_t)temperature);
+  putLE32(&record[8], humidity);
+  fillSum = sumWords(fillSum, record, UDP_RECORD_SIZE);
+  fillCount++;
+
+  if (fillCount >= config.batchRecords)
+  {
+    sendFrame();
+  }
+
+  return true;
+}
+
+/**
+ * @brief  Hands the partly filled frame, if any, to the MAC.
+ * @param  None
+ * @retval bool: true if nothing is left unsent.
+ */
+bool API_UDP_Flush(void)
+{
+  if (fillCount > 0U && status.linkUp)
+  {
+    sendFrame();
+  }
+
+  return fillCount == 0U;
+}
+
+/**
+ * @brief  Takes back the frame buffers the DMA has sent and reads the PHY link status every UDP_LINK_POLL_MS.
+ *         The records of a partly filled frame are discarded when the link goes down.
+ * @param  uint32_t now: Current tick in ms.
+ * @retval None
+ */
+void API_UDP_Process(uint32_t now)
+{
+  if (!status.ready)
+  {
+    return;
+  }
+
+  UDP_HAL_ReleaseSent();
+
+  if (!linkPollDue && now - lastLinkPollMs < UDP_LINK_POLL_MS)
+  {
+    return;
+  }
+
+  linkPollDue = false;
+  lastLinkPollMs = now;
+
+  bool up = UDP_HAL_IsLinkUp();
+
+  if (up != status.linkUp)
+  {
+    status.linkChanges++;
+    status.linkUp = up;
+    fillCount = 0;
+    fillSum = 0;
+  }
+}
+
+/**
+ * @brief  Port callback: the DMA has sent a frame, its buffer can be filled again.
+ * @param  uint8_t *frame: Frame buffer given to UDP_HAL_Transmit.
+ * @retval None
+ */
+void API_UDP_OnFrameSent(uint8_t *frame)
+{
+  for (uint8_t i = 0; i < UDP_FRAME_COUNT; i++)
+  {
+    if (frame == frameBuffers[i])
+    {
+      frameBusy[i] = false;
+    }
+  }
+}
+
+/**
+ * @brief  Returns the publisher counters.
+ * @param  None
+ * @retval udpStatus_t: Counters.
+ */
+udpStatus_t API_UDP_GetStatus(void)
+{
+  return status;
+}
@@ -0,0 +1,154 @@
+/* Includes ------------------------------------------------------------------*/
+#include "API_udp_port.h"
+#include "API_udp.h"
+#include "API_section.h"
+
+/* Private variables ----------------------------------------------------------*/
+
+static ETH_HandleTypeDef heth;
+static uint8_t macAddress[UDP_MAC_SIZE]; // HAL_ETH_Init reads the address through heth.Init.MACAddr
+static bool linkUp;
+
+// Read by the ETH DMA: SRAM1/2, never CCM
+API_DMA_BSS static ETH_DMADescTypeDef txDescriptors[ETH_TX_DESC_CNT];
+API_DMA_BSS static ETH_DMADescTypeDef rxDescriptors[ETH_RX_DESC_CNT];
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void applyLinkMode(void);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Sets the MAC speed and duplex to what the PHY negotiated, then (re)starts the MAC.
+ *         Frames still owned by the DMA are sent after the restart.
+ * @param  None
+ * @retval None
+ */
+static void applyLinkMode(void)
+{
+  ETH_MACConfigTypeDef macConfig;
+  uint32_t scsr = 0;
+
+  HAL_ETH_ReadPHYRegister(&heth, UDP_HAL_PHY_ADDRESS, UDP_HAL_PHY_SCSR, &scsr);
+
+  if (heth.gState == HAL_ETH_STATE_STARTED)
+  {
+    HAL_ETH_Stop(&heth);
+  }
+
+  HAL_ETH_GetMACConfig(&heth, &macConfig);
+  macConfig.Speed = (scsr & UDP_HAL_PHY_SCSR_100M) != 0U ? ETH_SPEED_100M : ETH_SPEED_10M;
+  macConfig.DuplexMode = (scsr & UDP_HAL_PHY_SCSR_FULL_DUPLEX) != 0U ? ETH_FULLDUPLEX_MODE : ETH_HALFDUPLEX_MODE;
+  HAL_ETH_SetMACConfig(&heth, &macConfig);
+  HAL_ETH_Start(&heth);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+/**
+ * @brief  Initialises the MAC and its DMA in RMII mode, transmit only: no receive buffer is given to the DMA,
+ *         incoming frames are dropped. The MAC starts once UDP_HAL_IsLinkUp finds the link.
+ *         Pins and clock are set by HAL_ETH_MspInit (stm32f4xx_hal_msp.c).
+ * @param  const uint8_t *mac: Source MAC address, 6 bytes.
+ * @retval bool: true on success.
+ */
+bool UDP_HAL_Init(const uint8_t *mac)
+{
+  for (uint8_t i = 0; i < UDP_MAC_SIZE; i++)
+  {
+    macAddress[i] = mac[i];
+  }
+
+  heth.Instance = ETH;
+  heth.Init.MACAddr = macAddress;
+  heth.Init.MediaInterface = HAL_ETH_RMII_MODE;
+  heth.Init.TxDesc = txDescriptors;
+  heth.Init.RxDesc = rxDescriptors;
+  heth.Init.RxBuffLen = ETH_RX_BUF_SIZE;
+  linkUp = false;
+
+  // Fails after ETH_SWRESET_TIMEOUT when the PHY provides no 50 MHz reference clock
+  return HAL_ETH_Init(&heth) == HAL_OK;
+}
+
+/**
+ * @brief  Reads the PHY link status. When the link comes up, applies the negotiated speed and duplex and
+ *         starts the MAC. Blocking MDIO reads, a few tens of microseconds.
+ * @param  None
+ * @retval bool: true if the link is up.
+ */
+bool UDP_HAL_IsLinkUp(void)
+{
+  uint32_t bsr = 0;
+  uint32_t scsr = 0;
+
+  // The link bit latches low: the second read gives the current state
+  HAL_ETH_ReadPHYRegister(&heth, UDP_HAL_PHY_ADDRESS, UDP_HAL_PHY_BSR, &bsr);
+  HAL_ETH_ReadPHYRegister(&heth, UDP_HAL_PHY_ADDRESS, UDP_HAL_PHY_BSR, &bsr);
+  HAL_ETH_ReadPHYRegister(&heth, UDP_HAL_PHY_ADDRESS, UDP_HAL_PHY_SCSR, &scsr);
+
+  bool up = (bsr & UDP_HAL_PHY_BSR_LINK) != 0U && (scsr & UDP_HAL_PHY_SCSR_AUTODONE) != 0U;
+
+  if (up && !linkUp)
+  {
+    applyLinkMode();
+  }
+  linkUp = up;
+
+  return up;
+}
+
+/**
+ * @brief  Points the next DMA transmit descriptor at a frame buffer, no copy. The buffer belongs to the DMA
+ *         until API_UDP_OnFrameSent returns it. The checksums are already in the frame: insertion by the MAC is off.
+ * @param  uint8_t *frame: Frame without its FCS, in SRAM (API_DMA_BSS), word aligned.
+ * @param  uint16_t length: Frame length.
+ * @retval bool: true if the descriptor was free and the transmission requested.
+ */
+bool UDP_HAL_Transmit(uint8_t *frame, uint16_t length)
+{
+  ETH_BufferTypeDef buffer = {.buffer = frame, .len = length, .next = NULL};
+  ETH_TxPacketConfig packet = {0};
+
+  packet.Attributes = ETH_TX_PACKETS_FEATURES_CSUM | ETH_TX_PACKETS_FEATURES_CRCPAD;
+  packet.Length = length;
+  packet.TxBuffer = &buffer; // Read while the descriptor is prepared, not kept
+  packet.ChecksumCtrl = ETH_CHECKSUM_DISABLE;
+  packet.CRCPadCtrl = ETH_CRC_PAD_INSERT;
+  packet.pData = frame; // Handed back by HAL_ETH_TxFreeCallback
+
+  return HAL_ETH_Transmit_IT(&heth, &packet) == HAL_OK;
+}
+
+/**
+ * @brief  Returns the frames the DMA has sent, oldest first, through API_UDP_OnFrameSent.
+ *         Polled: the ETH interrupt stays disabled.
+ * @param  None
+ * @retval None
+ */
+void UDP_HAL_ReleaseSent(void)
+{
+  HAL_ETH_ReleaseTxPacket(&heth);
+}
+
+/**
+ * @brief  Reads the device unique ID.
+ * @param  uint32_t *words: Filled with UDP_HAL_UNIQUE_ID_WORDS words.
+ * @retval None
+ */
+void UDP_HAL_GetUniqueId(uint32_t *words)
+{
+  words[0] = HAL_GetUIDw0();
+  words[1] = HAL_GetUIDw1();
+  words[2] = HAL_GetUIDw2();
+}
+
+/**
+ * @brief  HAL callback from HAL_ETH_ReleaseTxPacket, a transmitted frame: its buffer is free again.
+ * @param  uint32_t *buff: pData of the frame's ETH_TxPacketConfig.
+ * @retval None
+ */
+void HAL_ETH_TxFreeCallback(uint32_t *buff)
+{
+  API_UDP_OnFrameSent((uint8_t *)buff);
+}
@@ -0,0 +1,823 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "API_usb_cdc.h"
+#include "API_usb_cdc_port.h"
+#include "API_section.h"
+
+/* Private define ------------------------------------------------------------*/
+
+// bmRequestType fields
+#define USB_REQ_TYPE_MASK 0x60U
+#define USB_REQ_TYPE_STANDARD 0x00U
+#define USB_REQ_TYPE_CLASS 0x20U
+#define USB_REQ_RECIPIENT_MASK 0x1FU
+#define USB_REQ_RECIPIENT_DEVICE 0x00U
+#define USB_REQ_RECIPIENT_INTERFACE 0x01U
+#define USB_REQ_RECIPIENT_ENDPOINT 0x02U
+
+// Standard requests (USB 2.0 table 9-4)
+#define USB_REQ_GET_STATUS 0x00U
+#define USB_REQ_CLEAR_FEATURE 0x01U
+#define USB_REQ_SET_FEATURE 0x03U
+#define USB_REQ_SET_ADDRESS 0x05U
+#define USB_REQ_GET_DESCRIPTOR 0x06U
+#define USB_REQ_GET_CONFIGURATION 0x08U
+#define USB_REQ_SET_CONFIGURATION 0x09U
+#define USB_REQ_GET_INTERFACE 0x0AU
+#define USB_REQ_SET_INTERFACE 0x0BU
+#define USB_FEATURE_ENDPOINT_HALT 0x00U
+
+// CDC PSTN requests
+#define CDC_REQ_SET_LINE_CODING 0x20U
+#define CDC_REQ_GET_LINE_CODING 0x21U
+#define CDC_REQ_SET_CONTROL_LINE_STATE 0x22U
+#define CDC_REQ_SEND_BREAK 0x23U
+
+// Descriptor types
+#define USB_DESC_DEVICE 0x01U
+#define USB_DESC_CONFIGURATION 0x02U
+#define USB_DESC_STRING 0x03U
+#define USB_DESC_INTERFACE 0x04U
+#define USB_DESC_ENDPOINT 0x05U
+#define USB_DESC_CS_INTERFACE 0x24U
+
+#define USB_DEVICE_DESC_SIZE 18U
+#define USB_CONFIG_DESC_SIZE 67U
+#define USB_CONFIGURATION_VALUE 1U
+#define USB_INTERFACE_COUNT 2U
+#define USB_STATUS_SIZE 2U
+
+#define USB_STRING_LANGUAGE 0U
+#define USB_STRING_MANUFACTURER 1U
+#define USB_STRING_PRODUCT 2U
+#define USB_STRING_SERIAL 3U
+#define USB_STRING_MAX_CHARS 31U      // Longest string descriptor, UTF-16 characters
+#define USB_LANGUAGE_EN_US 0x0409U
+#define USB_EP_NUMBER_MASK 0x0FU
+
+#define USBCDC_EP0_BUFFER_SIZE (2U + 2U * USB_STRING_MAX_CHARS) // Largest built answer, a string descriptor
+#define USBCDC_NO_BUFFER 0xFFU
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief Control transfer stage on endpoint 0.
+ */
+typedef enum
+{
+  EP0_IDLE,       // Waiting for a SETUP packet
+  EP0_DATA_IN,    // Sending the answer, one max packet per completion
+  EP0_DATA_OUT,   // Receiving the request data
+  EP0_STATUS_IN,  // Zero-length IN handshake after a request without or with OUT data
+  EP0_STATUS_OUT, // Zero-length OUT handshake after IN data
+} ep0Stage_t;
+
+/**
+ * @brief Decoded SETUP packet.
+ */
+typedef struct
+{
+  uint8_t requestType;
+  uint8_t request;
+  uint16_t value;
+  uint16_t index;
+  uint16_t length;
+} usbSetup_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+static const uint8_t deviceDescriptor[USB_DEVICE_DESC_SIZE] = {
+    USB_DEVICE_DESC_SIZE, USB_DESC_DEVICE,
+    0x00, 0x02,       // bcdUSB 2.00
+    0x02, 0x00, 0x00, // Class defined at device level: CDC
+    USBCDC_EP0_SIZE,
+    (uint8_t)USBCDC_VENDOR_ID, (uint8_t)(USBCDC_VENDOR_ID >> 8),
+    (uint8_t)USBCDC_PRODUCT_ID, (uint8_t)(USBCDC_PRODUCT_ID >> 8),
+    (uint8_t)USBCDC_DEVICE_RELEASE, (uint8_t)(USBCDC_DEVICE_RELEASE >> 8),
+    USB_STRING_MANUFACTURER, USB_STRING_PRODUCT, USB_STRING_SERIAL,
+    1, // One configuration
+};
+
+static const uint8_t configDescriptor[USB_CONFIG_DESC_SIZE] = {
+    // Configuration: two interfaces, self-powered (the board), 100 mA
+    9, USB_DESC_CONFIGURATION, USB_CONFIG_DESC_SIZE, 0x00, USB_INTERFACE_COUNT, USB_CONFIGURATION_VALUE, 0, 0xC0, 50,
+    // Interface 0: communication class, abstract control model, AT commands
+    9, USB_DESC_INTERFACE, 0, 0, 1, 0x02, 0x02, 0x01, 0,
+    // Header functional descriptor, CDC 1.10
+    5, USB_DESC_CS_INTERFACE, 0x00, 0x10, 0x01,
+    // Call management: no call management, data interface 1
+    5, USB_DESC_CS_INTERFACE, 0x01, 0x00, 1,
+    // Abstract control management: line coding and serial state requests
+    4, USB_DESC_CS_INTERFACE, 0x02, 0x02,
+    // Union: interface 0 controls interface 1
+    5, USB_DESC_CS_INTERFACE, 0x06, 0, 1,
+    // Notification endpoint
+    7, USB_DESC_ENDPOINT, USBCDC_EP_NOTIFY, USBCDC_EP_TYPE_INTR, USBCDC_NOTIFY_PACKET_SIZE, 0x00,
+    USBCDC_NOTIFY_INTERVAL,
+    // Interface 1: data class
+    9, USB_DESC_INTERFACE, 1, 0, 2, 0x0A, 0x00, 0x00, 0,
+    // Bulk OUT and IN
+    7, USB_DESC_ENDPOINT, USBCDC_EP_DATA_OUT, USBCDC_EP_TYPE_BULK, USBCDC_DATA_PACKET_SIZE, 0x00, 0,
+    7, USB_DESC_ENDPOINT, USBCDC_EP_DATA_IN, USBCDC_EP_TYPE_BULK, USBCDC_DATA_PACKET_SIZE, 0x00, 0,
+};
+
+static const char *const stringDescriptors[] = {
+    [USB_STRING_MANUFACTURER] = "STMicroelectronics",
+    [USB_STRING_PRODUCT] = "BME280 telemetry port",
+};
+
+static volatile usbcdcState_t state = USBCDC_DETACHED;
+static volatile bool suspended;
+static volatile uint8_t controlLines; // USBCDC_CONTROL_LINE_* bits of the last SET_CONTROL_LINE_STATE
+static uint8_t configuration;
+static uint8_t lineCoding[USBCDC_LINE_CODING_SIZE];
+
+// Endpoint 0: the answer being sent, or the request data being received
+static ep0Stage_t ep0Stage;
+static usbSetup_t ep0Setup;
+static const uint8_t *ep0Data;
+static uint16_t ep0Remaining;
+static bool ep0Zlp; // Answer shorter than requested and ending on a full packet
+static uint8_t ep0Buffer[USBCDC_EP0_BUFFER_SIZE];
+
+// Bulk IN: txFill collects API_USBCDC_Write data while txActive (if not USBCDC_NO_BUFFER) is on the endpoint.
+// The OTG_FS core has no DMA: its FIFOs are filled by the CPU, so the buffers can stay in CCM.
+API_CCM_BSS static uint8_t txBuffer[USBCDC_TX_BUFFER_COUNT][USBCDC_TX_BUFFER_SIZE];
+static volatile uint16_t txLength[USBCDC_TX_BUFFER_COUNT];
+static volatile uint8_t txFill;
+static volatile uint8_t txActive = USBCDC_NO_BUFFER;
+static volatile bool txZlp; // The active transfer is the zero-length packet closing a full-packet one
+
+static uint8_t rxBuffer[USBCDC_DATA_PACKET_SIZE];
+
+static usbcdcStatus_t counters;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void ep0Send(const uint8_t *data, uint16_t length);
+static void ep0SendNext(void);
+static void ep0Receive(uint16_t length);
+static void ep0Status(void);
+static void ep0Stall(void);
+static bool getDescriptor(void);
+static bool standardRequest(void);
+static bool classRequest(void);
+static void setConfiguration(uint8_t value);
+static void closeDataEndpoints(void);
+static void txReset(void);
+static void txStart(void);
+static uint16_t buildString(uint8_t index);
+static char hexDigit(uint32_t nibble);
+
+/* Private Function Definitions ----------------------------------------------*/
+
+/**
+ * @brief  Starts the IN data stage of a control read, truncated to the requested length.
+ * @param  data: Answer, kept valid until the transfer ends.
+ * @param  length: Answer length.
+ * @retval None
+ */
+static void ep0Send(const uint8_t *data, uint16_t length)
+{
+  if (length > ep0Setup.length)
+  {
+    length = ep0Setup.length;
+  }
+
+  ep0Data = data;
+  ep0Remaining = length;
+  ep0Zlp = length < ep0Setup.length && (length % USBCDC_EP0_SIZE) == 0U;
+  ep0Stage = EP0_DATA_IN;
+  ep0SendNext();
+}
+
+/**
+ * @brief  Sends the next packet of the control read, its closing zero-length packet, or moves on to the
+ *         status stage once everything went out.
+ * @param  None
+ * @retval None
+ */
+static void ep0SendNext(void)
+{
+  uint16_t chunk = ep0Remaining > USBCDC_EP0_SIZE ? USBCDC_EP0_SIZE : ep0Remaining;
+
+  if (chunk == 0U && !ep0Zlp)
+  {
+    ep0Stage = EP0_STATUS_OUT;
+    USB_HAL_Receive(0x00U, NULL, 0U);
+    return;
+  }
+
+  if (chunk == 0U)
+  {
+    ep0Zlp = false;
+  }
+
+  USB_HAL_Transmit(USBCDC_EP_DIR_IN, ep0Data, chunk);
+  ep0Data += chunk;
+  ep0Remaining -= chunk;
+}
+
+/**
+ * @brief  Arms endpoint 0 for the OUT data stage of a control write.
+ * @param  length: Request data length, at most USBCDC_EP0_BUFFER_SIZE.
+ * @retval None
+ */
+static void ep0Receive(uint16_t length)
+{
+  ep0Stage = EP0_DATA_OUT;
+  USB_HAL_Receive(0x00U, ep0Buffer, length);
+}
+
+/**
+ * @brief  Acknowledges a request with a zero-length IN status stage.
+ * @param  None
+ * @retval None
+ */
+static void ep0Status(void)
+{
+  ep0Stage = EP0_STATUS_IN;
+  USB_HAL_Transmit(USBCDC_EP_DIR_IN, NULL, 0U);
+}
+
+/**
+ * @brief  Refuses a request: both directions of endpoint 0 stall until the next SETUP packet.
+ * @param  None
+ * @retval None
+ */
+static void ep0Stall(void)
+{
+  ep0Stage = EP0_IDLE;
+  counters.stalls++;
+  USB_HAL_Stall(USBCDC_EP_DIR_IN);
+  USB_HAL_Stall(0x00U);
+}
+
+/**
+ * @brief  GET_DESCRIPTOR: device, configuration and string descriptors. Anything else, the device qualifier
+ *         included (full-speed only device), is refused.
+ * @param  None
+ * @retval bool: true if the answer was started.
+ */
+static bool getDescriptor(void)
+{
+  uint8_t type = (uint8_t)(ep0Setup.value >> 8);
+  uint8_t index = (uint8_t)ep0Setup.value;
+  uint16_t length;
+
+  switch (type)
+  {
+  case USB_DESC_DEVICE:
+    ep0Send(deviceDescriptor, sizeof(deviceDescriptor));
+    return true;
+
+  case USB_DESC_CONFIGURATION:
+    if (index != 0U)
+    {
+      return false;
+    }
+    ep0Send(configDescriptor, sizeof(configDescriptor));
+    return true;
+
+  case USB_DESC_STRING:
+    length = buildString(index);
+    if (length == 0U)
+    {
+      return false;
+    }
+    ep0Send(ep0Buffer, length);
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief  Chapter 9 requests.
+ * @param  None
+ * @retval bool: true if the request was handled, false to stall it.
+ */
+static bool standardRequest(void)
+{
+  uint8_t recipient = ep0Setup.requestType & USB_REQ_RECIPIENT_MASK;
+  uint8_t endpoint = (uint8_t)ep0Setup.index;
+
+  switch (ep0Setup.request)
+  {
+  case USB_REQ_GET_DESCRIPTOR:
+    return getDescriptor();
+
+  case USB_REQ_SET_ADDRESS:
+    if (recipient != USB_REQ_RECIPIENT_DEVICE || ep0Setup.value > 127U || state == USBCDC_CONFIGURED)
+    {
+      return false;
+    }
+    USB_HAL_SetAddress((uint8_t)ep0Setup.value);
+    state = ep0Setup.value != 0U ? USBCDC_ADDRESSED : USBCDC_DEFAULT;
+    ep0Status();
+    return true;
+
+  case USB_REQ_SET_CONFIGURATION:
+    if (ep0Setup.value > USB_CONFIGURATION_VALUE || state == USBCDC_DEFAULT)
+    {
+      return false;
+    }
+    setConfiguration((uint8_t)ep0Setup.value);
+    ep0Status();
+    return true;
+
+  case USB_REQ_GET_CONFIGURATION:
+    ep0Buffer[0] = configuration;
+    ep0Send(ep0Buffer, 1U);
+    return true;
+
+  case USB_REQ_GET_STATUS:
+    // Device: self-powered, no remote wakeup. Interface: reserved zero. Endpoint: halt not tracked.
+    ep0Buffer[0] = recipient == USB_REQ_RECIPIENT_DEVICE ? 0x01U : 0x00U;
+    ep0Buffer[1] = 0x00U;
+    ep0Send(ep0Buffer, USB_STATUS_SIZE);
+    return true;
+
+  case USB_REQ_CLEAR_FEATURE:
+  case USB_REQ_SET_FEATURE:
+    if (recipient != USB_REQ_RECIPIENT_ENDPOINT || ep0Setup.value != USB_FEATURE_ENDPOINT_HALT ||
+        state != USBCDC_CONFIGURED)
+    {
+      return false;
+    }
+    if ((endpoint & USB_EP_NUMBER_MASK) != 0U)
+    {
+      if (ep0Setup.request == USB_REQ_SET_FEATURE)
+      {
+        USB_HAL_Stall(endpoint);
+      }
+      else
+      {
+        USB_HAL_ClearStall(endpoint);
+      }
+    }
+    ep0Status();
+    return true;
+
+  case USB_REQ_GET_INTERFACE:
+    if (state != USBCDC_CONFIGURED || ep0Setup.index >= USB_INTERFACE_COUNT)
+    {
+      return false;
+    }
+    ep0Buffer[0] = 0U; // Single alternate setting
+    ep0Send(ep0Buffer, 1U);
+    return true;
+
+  case USB_REQ_SET_INTERFACE:
+    if (state != USBCDC_CONFIGURED || ep0Setup.index >= USB_INTERFACE_COUNT || ep0Setup.value != 0U)
+    {
+      return false;
+    }
+    ep0Status();
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief  CDC requests addressed to the communication interface.
+ * @param  None
+ * @retval bool: true if the request was handled, false to stall it.
+ */
+static bool classRequest(void)
+{
+  if ((ep0Setup.requestType & USB_REQ_RECIPIENT_MASK) != USB_REQ_RECIPIENT_INTERFACE || ep0Setup.index != 0U)
+  {
+    return false;
+  }
+
+  switch (ep0Setup.request)
+  {
+  case CDC_REQ_SET_LINE_CODING:
+    if (ep0Setup.length != USBCDC_LINE_CODING_SIZE)
+    {
+      return false;
+    }
+    ep0Receive(USBCDC_LINE_CODING_SIZE);
+    return true;
+
+  case CDC_REQ_GET_LINE_CODING:
+    ep0Send(lineCoding, USBCDC_LINE_CODING_SIZE);
+    return true;
+
+  case CDC_REQ_SET_CONTROL_LINE_STATE:
+    controlLines = (uint8_t)ep0Setup.value;
+    ep0Status();
+    return true;
+
+  case CDC_REQ_SEND_BREAK:
+    ep0Status();
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief  Applies SET_CONFIGURATION: configuration 1 opens the data and notification endpoints,
+ *         0 closes them and returns to the addressed state.
+ * @param  value: Configuration value.
+ * @retval None
+ */
+static void setConfiguration(uint8_t value)
+{
+  closeDataEndpoints();
+  configuration = value;
+
+  if (value == 0U)
+  {
+    state = USBCDC_ADDRESSED;
+    return;
+  }
+
+  USB_HAL_OpenEndpoint(USBCDC_EP_DATA_IN, USBCDC_DATA_PACKET_SIZE, USBCDC_EP_TYPE_BULK);
+  USB_HAL_OpenEndpoint(USBCDC_EP_DATA_OUT, USBCDC_DATA_PACKET_SIZE, USBCDC_EP_TYPE_BULK);
+  USB_HAL_OpenEndpoint(USBCDC_EP_NOTIFY, USBCDC_NOTIFY_PACKET_SIZE, USBCDC_EP_TYPE_INTR);
+  USB_HAL_Receive(USBCDC_EP_DATA_OUT, rxBuffer, sizeof(rxBuffer));
+  state = USBCDC_CONFIGURED;
+}
+
+/**
+ * @brief  Closes the data and notification endpoints if open, and forgets the queued output and DTR.
+ * @param  None
+ * @retval None
+ */
+static void closeDataEndpoints(void)
+{
+  if (configuration != 0U)
+  {
+    USB_HAL_CloseEndpoint(USBCDC_EP_DATA_IN);
+    USB_HAL_CloseEndpoint(USBCDC_EP_DATA_OUT);
+    USB_HAL_CloseEndpoint(USBCDC_EP_NOTIFY);
+  }
+
+  configuration = 0U;
+  controlLines = 0U;
+  txReset();
+}
+
+/**
+ * @brief  Empties both transmit buffers, nothing on the endpoint.
+ * @param  None
+ * @retval None
+ */
+static void txReset(void)
+{
+  txLength[0] = 0U;
+  txLength[1] = 0U;
+  txFill = 0U;
+  txActive = USBCDC_NO_BUFFER;
+  txZlp = false;
+}
+
+/**
+ * @brief  Puts the filling buffer on the bulk IN endpoint and makes the other one the filling buffer.
+ *         Called with the endpoint idle, from the interrupt or with interrupts masked.
+ * @param  None
+ * @retval None
+ */
+static void txStart(void)
+{
+  uint8_t buffer = txFill;
+
+  txActive = buffer;
+  txFill = (uint8_t)(buffer ^ 1U);
+  txLength[txFill] = 0U;
+  USB_HAL_Transmit(USBCDC_EP_DATA_IN, txBuffer[buffer], txLength[buffer]);
+}
+
+/**
+ * @brief  Builds a string descriptor in ep0Buffer: UTF-16LE of the ASCII string, the serial number being
+ *         the hexadecimal unique ID.
+ * @param  index: String index, USB_STRING_LANGUAGE for the language list.
+ * @retval uint16_t: Descriptor length, 0 if the index is unknown.
+ */
+static uint16_t buildString(uint8_t index)
+{
+  uint32_t uniqueId[USB_HAL_UNIQUE_ID_WORDS];
+  char serial[2U * sizeof(uniqueId) + 1U];
+  const char *text;
+  uint16_t count = 0;
+
+  if (index == USB_STRING_LANGUAGE)
+  {
+    ep0Buffer[0] = 4U;
+    ep0Buffer[1] = USB_DESC_STRING;
+    ep0Buffer[2] = (uint8_t)USB_LANGUAGE_EN_US;
+    ep0Buffer[3] = (uint8_t)(USB_LANGUAGE_EN_US >> 8);
+    return 4U;
+  }
+
+  if (index == USB_STRING_SERIAL)
+  {
+    USB_HAL_GetUniqueId(uniqueId);
+    for (uint16_t i = 0; i < 2U * sizeof(uniqueId); i++)
+    {
+      serial[i] = hexDigit(uniqueId[i / 8U] >> (28U - 4U * (i % 8U)));
+    }
+    serial[2U * sizeof(uniqueId)] = '\0';
+    text = serial;
+  }
+  else if (index < sizeof(stringDescriptors) / sizeof(stringDescriptors[0]) && stringDescriptors[index] != NULL)
+  {
+    text = stringDescriptors[index];
+  }
+  else
+  {
+    return 0U;
+  }
+
+  while (text[count] != '\0' && count < USB_STRING_MAX_CHARS)
+  {
+    ep0Buffer[2U + 2U * count] = (uint8_t)text[count];
+    ep0Buffer[3U + 2U * count] = 0U;
+    count++;
+  }
+  ep0Buffer[0] = (uint8_t)(2U + 2U * count);
+  ep0Buffer[1] = USB_DESC_STRING;
+
+  return ep0Buffer[0];
+}
+
+/**
+ * @brief  Upper-case hexadecimal digit of the low nibble.
+ * @param  nibble: Value, only the 4 low bits are used.
+ * @retval char: '0'-'9' or 'A'-'F'.
+ */
+static char hexDigit(uint32_t nibble)
+{
+  nibble &= 0x0FU;
+  return (char)(nibble < 10U ? '0' + nibble : 'A' + nibble - 10U);
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Starts the USB device: the port initialises the controller and connects to the bus.
+ * @param  None
+ * @retval bool: true if the controller started.
+ */
+bool API_USBCDC_Init(void)
+{
+  uint32_t baud = USBCDC_DEFAULT_BAUD;
+
+  memset(&counters, 0, sizeof(counters));
+  lineCoding[0] = (uint8_t)baud;
+  lineCoding[1] = (uint8_t)(baud >> 8);
+  lineCoding[2] = (uint8_t)(baud >> 16);
+  lineCoding[3] = (uint8_t)(baud >> 24);
+  lineCoding[4] = 0U; // 1 stop bit
+  lineCoding[5] = 0U; // No parity
+  lineCoding[6] = 8U; // 8 data bits
+
+  state = USBCDC_DETACHED;
+  suspended = false;
+  configuration = 0U;
+  controlLines = 0U;
+  ep0Stage = EP0_IDLE;
+  txReset();
+
+  return USB_HAL_Init();
+}
+
+/**
+ * @brief  Queues bytes for the bulk IN endpoint. Never waits: the bytes are copied in whole into the
+ *         filling buffer, or refused and counted as dropped if it has no room for them.
+ *         With the endpoint idle the transfer starts at once; otherwise the completion interrupt sends
+ *         everything collected meanwhile as one transfer.
+ * @param  data: Bytes to send.
+ * @param  length: Number of bytes, at most USBCDC_TX_BUFFER_SIZE.
+ * @retval bool: true if the bytes were queued, false if the port is closed or the buffers are full.
+ */
+bool API_USBCDC_Write(const uint8_t *data, uint16_t length)
+{
+  uint32_t primask;
+  bool queued = false;
+
+  if (!API_USBCDC_IsOpen())
+  {
+    return false;
+  }
+
+  // The completion interrupt swaps the buffers: keep it out while the filling one is chosen and written
+  primask = __get_PRIMASK();
+  __disable_irq();
+
+  if (txLength[txFill] + length <= USBCDC_TX_BUFFER_SIZE)
+  {
+    memcpy(&txBuffer[txFill][txLength[txFill]], data, length);
+    txLength[txFill] += length;
+    queued = true;
+
+    if (txActive == USBCDC_NO_BUFFER)
+    {
+      txStart();
+    }
+  }
+  else
+  {
+    counters.droppedBytes += length;
+    counters.droppedWrites++;
+  }
+
+  __set_PRIMASK(primask);
+
+  return queued;
+}
+
+/**
+ * @brief  Tells whether a host listens: configured, not suspended and DTR set.
+ * @param  None
+ * @retval bool: true if API_USBCDC_Write accepts data.
+ */
+bool API_USBCDC_IsOpen(void)
+{
+  return state == USBCDC_CONFIGURED && !suspended && (controlLines & USBCDC_CONTROL_LINE_DTR) != 0U;
+}
+
+/**
+ * @brief  Returns the link state and counters.
+ * @param  None
+ * @retval usbcdcStatus_t: State and counters.
+ */
+usbcdcStatus_t API_USBCDC_GetStatus(void)
+{
+  usbcdcStatus_t status = counters;
+
+  status.state = state;
+  status.suspended = suspended;
+  status.open = API_USBCDC_IsOpen();
+  status.baudRate = (uint32_t)lineCoding[0] | ((uint32_t)lineCoding[1] << 8) | ((uint32_t)lineCoding[2] << 16) |
+                    ((uint32_t)lineCoding[3] << 24);
+
+  return status;
+}
+
+/**
+ * @brief  PCD event, bus reset: back to the default state with only endpoint 0 open.
+ * @param  None
+ * @retval None
+ */
+void API_USBCDC_OnReset(void)
+{
+  closeDataEndpoints();
+  suspended = false;
+  ep0Stage = EP0_IDLE;
+  state = USBCDC_DEFAULT;
+  counters.resets++;
+
+  USB_HAL_OpenEndpoint(0x00U, USBCDC_EP0_SIZE, USBCDC_EP_TYPE_CTRL);
+  USB_HAL_OpenEndpoint(USBCDC_EP_DIR_IN, USBCDC_EP0_SIZE, USBCDC_EP_TYPE_CTRL);
+}
+
+/**
+ * @brief  PCD event, SETUP packet received on endpoint 0. Aborts any control transfer in progress.
+ * @param  setup: The USBCDC_SETUP_SIZE bytes of the packet.
+ * @retval None
+ */
+void API_USBCDC_OnSetup(const uint8_t *setup)
+{
+  bool handled = false;
+
+  ep0Setup.requestType = setup[0];
+  ep0Setup.request = setup[1];
+  ep0Setup.value = (uint16_t)(setup[2] | (setup[3] << 8));
+  ep0Setup.index = (uint16_t)(setup[4] | (setup[5] << 8));
+  ep0Setup.length = (uint16_t)(setup[6] | (setup[7] << 8));
+  ep0Stage = EP0_IDLE;
+
+  switch (ep0Setup.requestType & USB_REQ_TYPE_MASK)
+  {
+  case USB_REQ_TYPE_STANDARD:
+    handled = standardRequest();
+    break;
+
+  case USB_REQ_TYPE_CLASS:
+    handled = classRequest();
+    break;
+
+  default:
+    break;
+  }
+
+  if (!handled)
+  {
+    ep0Stall();
+  }
+}
+
+/**
+ * @brief  PCD event, an IN transfer completed: next control packet, or next bulk buffer.
+ * @param  epNumber: Endpoint number, without the direction bit.
+ * @retval None
+ */
+void API_USBCDC_OnDataIn(uint8_t epNumber)
+{
+  uint16_t sent;
+
+  if (epNumber == 0U)
+  {
+    if (ep0Stage == EP0_DATA_IN)
+    {
+      ep0SendNext();
+    }
+    else if (ep0Stage == EP0_STATUS_IN)
+    {
+      ep0Stage = EP0_IDLE;
+    }
+    return;
+  }
+
+  if (epNumber != (USBCDC_EP_DATA_IN & USB_EP_NUMBER_MASK) || txActive == USBCDC_NO_BUFFER)
+  {
+    return;
+  }
+
+  if (!txZlp)
+  {
+    sent = txLength[txActive];
+    counters.bytesSent += sent;
+    counters.transfers++;
+
+    // A transfer ending on a full packet leaves the host read open: close it with a zero-length packet
+    if (sent != 0U && (sent % USBCDC_DATA_PACKET_SIZE) == 0U)
+    {
+      txZlp = true;
+      USB_HAL_Transmit(USBCDC_EP_DATA_IN, NULL, 0U);
+      return;
+    }
+  }
+
+  txZlp = false;
+  txLength[txActive] = 0U;
+  txActive = USBCDC_NO_BUFFER;
+
+  if (txLength[txFill] != 0U)
+  {
+    txStart();
+  }
+}
+
+/**
+ * @brief  PCD event, an OUT transfer completed: control write data, status handshake, or bulk data.
+ * @param  epNumber: Endpoint number.
+ * @param  length: Bytes received.
+ * @retval None
+ */
+void API_USBCDC_OnDataOut(uint8_t epNumber, uint16_t length)
+{
+  if (epNumber == 0U)
+  {
+    if (ep0Stage == EP0_DATA_OUT)
+    {
+      if (ep0Setup.request == CDC_REQ_SET_LINE_CODING && length == USBCDC_LINE_CODING_SIZE)
+      {
+        memcpy(lineCoding, ep0Buffer, USBCDC_LINE_CODING_SIZE);
+      }
+      ep0Status();
+    }
+    else if (ep0Stage == EP0_STATUS_OUT)
+    {
+      ep0Stage = EP0_IDLE;
+    }
+    return;
+  }
+
+  if (epNumber == USBCDC_EP_DATA_OUT && state == USBCDC_CONFIGURED)
+  {
+    // No command channel: host data is counted and dropped, the endpoint is re-armed
+    counters.bytesReceived += length;
+    USB_HAL_Receive(USBCDC_EP_DATA_OUT, rxBuffer, sizeof(rxBuffer));
+  }
+}
+
+/**
+ * @brief  PCD event, bus suspended or resumed. Writes are refused while suspended.
+ * @param  isSuspended: true on suspend, false on resume.
+ * @retval None
+ */
+void API_USBCDC_OnSuspend(bool isSuspended)
+{
+  suspended = isSuspended;
+}
+
+/**
+ * @brief  PCD event, VBUS lost: the device is detached until the next reset.
+ * @param  None
+ * @retval None
+ */
+void API_USBCDC_OnDisconnect(void)
+{
+  closeDataEndpoints();
+  ep0Stage = EP0_IDLE;
+  state = USBCDC_DETACHED;
+}
@@ -0,0 +1,211 @@
+/* Includes ------------------------------------------------------------------*/
+#include "API_usb_cdc_port.h"
+#include "API_usb_cdc.h"
+
+/* Public variable -----------------------------------------------------------*/
+
+// Used by OTG_FS_IRQHandler (stm32f4xx_it.c)
+PCD_HandleTypeDef hpcd_USB_OTG_FS;
+
+/* Public functions ----------------------------------------------------------*/
+
+/**
+ * @brief  Initialises OTG_FS in device mode (embedded PHY, VBUS sensing on PA9), sizes the FIFOs,
+ *         enables the interrupt and connects to the bus. The 48 MHz clock comes from PLLQ.
+ * @param  None
+ * @retval bool: true on success.
+ */
+bool USB_HAL_Init(void)
+{
+  hpcd_USB_OTG_FS.Instance = USB_OTG_FS;
+  hpcd_USB_OTG_FS.Init.dev_endpoints = USB_HAL_DEVICE_ENDPOINTS;
+  hpcd_USB_OTG_FS.Init.speed = PCD_SPEED_FULL;
+  hpcd_USB_OTG_FS.Init.dma_enable = DISABLE;
+  hpcd_USB_OTG_FS.Init.phy_itface = PCD_PHY_EMBEDDED;
+  hpcd_USB_OTG_FS.Init.Sof_enable = DISABLE;
+  hpcd_USB_OTG_FS.Init.low_power_enable = DISABLE;
+  hpcd_USB_OTG_FS.Init.lpm_enable = DISABLE;
+  hpcd_USB_OTG_FS.Init.vbus_sensing_enable = ENABLE;
+  hpcd_USB_OTG_FS.Init.use_dedicated_ep1 = DISABLE;
+
+  if (HAL_PCD_Init(&hpcd_USB_OTG_FS) != HAL_OK)
+  {
+    return false;
+  }
+
+  HAL_PCDEx_SetRxFiFo(&hpcd_USB_OTG_FS, USB_HAL_RX_FIFO_WORDS);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 0, USB_HAL_TX0_FIFO_WORDS);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 1, USB_HAL_TX1_FIFO_WORDS);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 2, USB_HAL_TX2_FIFO_WORDS);
+
+  HAL_NVIC_SetPriority(OTG_FS_IRQn, USB_HAL_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(OTG_FS_IRQn);
+
+  return HAL_PCD_Start(&hpcd_USB_OTG_FS) == HAL_OK;
+}
+
+/**
+ * @brief  Opens an endpoint.
+ * @param  uint8_t address: Endpoint address, bit 7 set for IN.
+ * @param  uint16_t maxPacket: Max packet size.
+ * @param  uint8_t type: USBCDC_EP_TYPE_* (same values as the HAL EP_TYPE_*).
+ * @retval None
+ */
+void USB_HAL_OpenEndpoint(uint8_t address, uint16_t maxPacket, uint8_t type)
+{
+  HAL_PCD_EP_Open(&hpcd_USB_OTG_FS, address, maxPacket, type);
+}
+
+/**
+ * @brief  Closes an endpoint, dropping any transfer in progress.
+ * @param  uint8_t address: Endpoint address.
+ * @retval None
+ */
+void USB_HAL_CloseEndpoint(uint8_t address)
+{
+  HAL_PCD_EP_Close(&hpcd_USB_OTG_FS, address);
+}
+
+/**
+ * @brief  Starts an IN transfer. The core splits it into packets and refills the FIFO from the
+ *         interrupt; HAL_PCD_DataInStageCallback reports the end of the whole transfer.
+ * @param  uint8_t address: IN endpoint address.
+ * @param  const uint8_t *data: Bytes to send, untouched until completion. NULL with length 0 for a ZLP.
+ * @param  uint16_t length: Number of bytes. On endpoint 0, at most one max packet.
+ * @retval bool: true if the transfer started.
+ */
+bool USB_HAL_Transmit(uint8_t address, const uint8_t *data, uint16_t length)
+{
+  return HAL_PCD_EP_Transmit(&hpcd_USB_OTG_FS, address, (uint8_t *)data, length) == HAL_OK;
+}
+
+/**
+ * @brief  Arms an OUT transfer. Completion is reported by API_USBCDC_OnDataOut.
+ * @param  uint8_t address: OUT endpoint address.
+ * @param  uint8_t *data: Receive buffer. NULL with length 0 for a status stage.
+ * @param  uint16_t length: Buffer size.
+ * @retval bool: true if the endpoint is armed.
+ */
+bool USB_HAL_Receive(uint8_t address, uint8_t *data, uint16_t length)
+{
+  return HAL_PCD_EP_Receive(&hpcd_USB_OTG_FS, address, data, length) == HAL_OK;
+}
+
+/**
+ * @brief  Stalls an endpoint. On endpoint 0 the stall ends with the next SETUP packet.
+ * @param  uint8_t address: Endpoint address.
+ * @retval None
+ */
+void USB_HAL_Stall(uint8_t address)
+{
+  HAL_PCD_EP_SetStall(&hpcd_USB_OTG_FS, address);
+}
+
+/**
+ * @brief  Clears an endpoint stall (CLEAR_FEATURE ENDPOINT_HALT).
+ * @param  uint8_t address: Endpoint address.
+ * @retval None
+ */
+void USB_HAL_ClearStall(uint8_t address)
+{
+  HAL_PCD_EP_ClrStall(&hpcd_USB_OTG_FS, address);
+}
+
+/**
+ * @brief  Sets the device address. The OTG core applies it immediately, before the status stage.
+ * @param  uint8_t address: Address assigned by SET_ADDRESS.
+ * @retval None
+ */
+void USB_HAL_SetAddress(uint8_t address)
+{
+  HAL_PCD_SetAddress(&hpcd_USB_OTG_FS, address);
+}
+
+/**
+ * @brief  Reads the device unique ID, used as the serial number.
+ * @param  uint32_t *words: Filled with USB_HAL_UNIQUE_ID_WORDS words.
+ * @retval None
+ */
+void USB_HAL_GetUniqueId(uint32_t *words)
+{
+  words[0] = HAL_GetUIDw0();
+  words[1] = HAL_GetUIDw1();
+  words[2] = HAL_GetUIDw2();
+}
+
+/**
+ * @brief  HAL callback, SETUP packet received: the packet is in the handle.
+ * @param  PCD_HandleTypeDef *hpcd: PCD handle.
+ * @retval None
+ */
+void HAL_PCD_SetupStageCallback(PCD_HandleTypeDef *hpcd)
+{
+  API_USBCDC_OnSetup((const uint8_t *)hpcd->Setup);
+}
+
+/**
+ * @brief  HAL callback, OUT transfer completed.
+ * @param  PCD_HandleTypeDef *hpcd: PCD handle.
+ * @param  uint8_t epnum: Endpoint number.
+ * @retval None
+ */
+void HAL_PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+{
+  API_USBCDC_OnDataOut(epnum, (uint16_t)HAL_PCD_EP_GetRxCount(hpcd, epnum));
+}
+
+/**
+ * @brief  HAL callback, IN transfer completed.
+ * @param  PCD_HandleTypeDef *hpcd: PCD handle.
+ * @param  uint8_t epnum: Endpoint number.
+ * @retval None
+ */
+void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+{
+  (void)hpcd;
+  API_USBCDC_OnDataIn(epnum);
+}
+
+/**
+ * @brief  HAL callback, bus reset.
+ * @param  PCD_HandleTypeDef *hpcd: PCD handle.
+ * @retval None
+ */
+void HAL_PCD_ResetCallback(PCD_HandleTypeDef *hpcd)
+{
+  (void)hpcd;
+  API_USBCDC_OnReset();
+}
+
+/**
+ * @brief  HAL callback, bus suspended: the PHY clock is gated until resume.
+ * @param  PCD_HandleTypeDef *hpcd: PCD handle.
+ * @retval None
+ */
+void HAL_PCD_SuspendCallback(PCD_HandleTypeDef *hpcd)
+{
+  __HAL_PCD_GATE_PHYCLOCK(hpcd);
+  API_USBCDC_OnSuspend(true);
+}
+
+/**
+ * @brief  HAL callback, bus resumed.
+ * @param  PCD_HandleTypeDef *hpcd: PCD handle.
+ * @retval None
+ */
+void HAL_PCD_ResumeCallback(PCD_HandleTypeDef *hpcd)
+{
+  __HAL_PCD_UNGATE_PHYCLOCK(hpcd);
+  API_USBCDC_OnSuspend(false);
+}
+
+/**
+ * @brief  HAL callback, VBUS lost (session end).
+ * @param  PCD_HandleTypeDef *hpcd: PCD handle.
+ * @retval None
+ */
+void HAL_PCD_DisconnectCallback(PCD_HandleTypeDef *hpcd)
+{
+  (void)hpcd;
+  API_USBCDC_OnDisconnect();
+}
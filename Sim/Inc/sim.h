@@ -0,0 +1,172 @@
+#ifndef SIM_INC_SIM_H_
+#define SIM_INC_SIM_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "stm32f4xx_hal.h"
+#include "stm32f4xx_nucleo_144.h"
+
+/* Exported constants --------------------------------------------------------*/
+
+#define SIM_US_PER_MS 1000ULL
+#define SIM_US_PER_SECOND 1000000ULL
+
+// Bus speeds used to charge virtual time for blocking transfers
+#define SIM_UART_BITS_PER_BYTE 10U // Start, 7 data, parity, stop (8-bit word with odd parity, as configured by uartInit)
+#define SIM_PCLK1_HZ 42000000U     // APB1, HCLK / 4: USART3 kernel clock
+#define SIM_I2C_HZ 100000U         // hi2c1 standard mode
+#define SIM_I2C_BITS_PER_BYTE 9U   // 8 data bits and the acknowledge
+#define SIM_SPI_HZ 1312500U        // hspi1, PCLK2 84 MHz / 64
+#define SIM_CORE_CYCLES_PER_US 168U // SYSCLK 168 MHz: DWT cycle counter rate
+
+#define SIM_LCD_ROWS 2U
+#define SIM_LCD_COLUMNS 16U
+
+#define SIM_BME280_TRACE_MAX_POINTS 100000U
+
+#define SIM_USB_STALL (-1)          // Control request refused by the device
+#define SIM_USB_PROTOCOL_ERROR (-2) // Missing or unexpected handshake
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Peripheral event run at a virtual time, in place of an interrupt.
+ */
+typedef void (*simEvent_t)(void);
+
+/**
+ * @brief Background USB host reader: receives the bytes of each completed IN transfer.
+ */
+typedef void (*simUsbReader_t)(const uint8_t *data, uint16_t length);
+
+/**
+ * @brief Collector on the Ethernet link: receives each frame as it leaves the wire, FCS excluded.
+ */
+typedef void (*simEthReader_t)(const uint8_t *frame, uint16_t length);
+
+/**
+ * @brief BME280 trimming parameters, as stored in the sensor's calibration registers.
+ */
+typedef struct
+{
+  uint16_t T1;
+  int16_t T2;
+  int16_t T3;
+  uint8_t H1;
+  int16_t H2;
+  uint8_t H3;
+  int16_t H4;
+  int16_t H5;
+  int8_t H6;
+} simBme280Calib_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/* Firmware start-up and super loop, as in Core/Src/main.c */
+
+void SIM_BOARD_Init(void);
+bool SIM_BOARD_Step(void);
+
+/* Virtual time: advances only when the firmware waits or transfers, never with the wall clock */
+
+void SIM_TIME_Reset(void);
+uint64_t SIM_TIME_NowUs(void);
+void SIM_TIME_AdvanceUs(uint64_t us);
+bool SIM_TIME_Schedule(uint64_t atUs, simEvent_t event);
+
+/* RTC and backup domain */
+
+void SIM_RTC_PowerOnReset(void);
+void SIM_RTC_SetDriftPpm(int32_t ppm);
+
+/* USART3: capture sink for the firmware output, host transmitter for its input */
+
+void SIM_UART_SetCapture(FILE *out);
+uint32_t SIM_UART_GetBytesSent(void);
+uint64_t SIM_UART_GetBusyUs(void);
+uint32_t SIM_UART_GetBaudRate(void);
+bool SIM_UART_HostSend(const uint8_t *data, uint16_t length, uint32_t baudRate);
+
+/* Nucleo LEDs behind the BSP */
+
+bool SIM_LED_IsOn(Led_TypeDef led);
+
+/* BME280 register model behind the BME280_HAL_* port */
+
+void SIM_BME280_Reset(const simBme280Calib_t *calib);
+void SIM_BME280_SetEnvironment(float temperature, float humidity);
+bool SIM_BME280_LoadTrace(const char *path);
+bool SIM_BME280_LoadRawTrace(const char *path);
+uint32_t SIM_BME280_GetTraceEndMs(void);
+void SIM_BME280_SetPresent(bool present);
+void SIM_BME280_SetChipId(uint8_t id);
+void SIM_BME280_SetStuck(bool stuck);
+void SIM_BME280_PowerOnReset(void);
+uint32_t SIM_BME280_GetSpiTransfers(void);
+uint32_t SIM_BME280_GetSpiBytes(void);
+void SIM_BME280_Exchange(const uint8_t *tx, uint8_t *rx, uint16_t size);
+
+/* TIM6, SPI1 DMA streams and DWT cycle counter behind the SAMPLER_HAL_* port */
+
+bool SIM_SAMPLER_IsReading(void);
+void SIM_SAMPLER_SetHung(bool hung);
+uint32_t SIM_SAMPLER_GetTriggers(void);
+
+/* HD44780 behind a PCF8574 I2C expander, behind the LCD_HAL_* port */
+
+void SIM_LCD_Reset(void);
+void SIM_LCD_GetRow(uint8_t row, char *text);
+void SIM_LCD_Print(FILE *out);
+uint32_t SIM_LCD_GetI2cWrites(void);
+
+/* Internal flash log area behind the LOG_HAL_* port */
+
+void SIM_FLASH_EraseAll(void);
+bool SIM_FLASH_Load(const char *path);
+bool SIM_FLASH_Save(const char *path);
+uint32_t SIM_FLASH_GetEraseCount(void);
+
+/* SD card in SPI mode behind the SDCARD_HAL_* port */
+
+void SIM_SD_Reset(uint32_t blocks);
+void SIM_SD_PowerCycle(void);
+void SIM_SD_SetTiming(uint32_t busyUs, uint32_t periodBlocks, uint32_t extraUs);
+bool SIM_SD_Load(const char *path);
+bool SIM_SD_Save(const char *path);
+const uint8_t *SIM_SD_GetBlock(uint32_t block);
+uint32_t SIM_SD_GetBlocksWritten(void);
+uint32_t SIM_SD_GetBlocksRead(void);
+bool SIM_SD_IsSelected(void);
+
+/* OTG_FS device behind the USB_HAL_* port, the SIM_USB_* calls being the host */
+
+bool SIM_USB_Reset(void);
+int32_t SIM_USB_ControlRead(const uint8_t *setup, uint8_t *data);
+int32_t SIM_USB_ControlWrite(const uint8_t *setup, const uint8_t *data);
+int32_t SIM_USB_PendingIn(uint8_t address);
+int32_t SIM_USB_BulkIn(uint8_t address, uint8_t *data);
+bool SIM_USB_BulkOut(uint8_t address, const uint8_t *data, uint16_t length);
+void SIM_USB_Suspend(bool suspended);
+void SIM_USB_Disconnect(void);
+uint8_t SIM_USB_GetAddress(void);
+bool SIM_USB_IsEndpointOpen(uint8_t address, uint8_t *type, uint16_t *maxPacket);
+bool SIM_USB_IsArmed(uint8_t address);
+uint32_t SIM_USB_GetControllerErrors(void);
+void SIM_USB_SetHostReader(uint8_t address, simUsbReader_t reader);
+void SIM_USB_Tick(uint64_t nowUs);
+
+/* Ethernet MAC, transmit DMA and 100 Mbit/s link behind the UDP_HAL_* port */
+
+void SIM_ETH_Reset(void);
+void SIM_ETH_SetLink(bool up);
+void SIM_ETH_SetCapture(FILE *out);
+void SIM_ETH_SetReader(simEthReader_t frameReader);
+void SIM_ETH_GetMac(uint8_t *mac);
+uint32_t SIM_ETH_GetFramesSent(void);
+uint32_t SIM_ETH_GetOwnershipErrors(void);
+uint32_t SIM_ETH_GetRefusedFrames(void);
+
+#endif /* SIM_INC_SIM_H_ */
@@ -0,0 +1,52 @@
+#ifndef SIM_INC_SIM_CHECK_H_
+#define SIM_INC_SIM_CHECK_H_
+
+/*
+ * Checks of the test programs: a failed check is printed and counted, a section ends with "ok" or "FAILED".
+ * Header only, each program has its own counter:
+ *
+ *   uint32_t failuresBefore = failures;
+ *   check(count == 3U, "three records");
+ *   return checkSection(failuresBefore);
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Exported variables --------------------------------------------------------*/
+
+static uint32_t failures; // Failed checks so far
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Counts a failed check and prints it.
+ * @param  condition: false on failure.
+ * @param  what: What was expected.
+ * @retval None
+ */
+static inline void check(bool condition, const char *what)
+{
+  if (!condition)
+  {
+    printf("  check failed: %s\n", what);
+    failures++;
+  }
+}
+
+/**
+ * @brief  Prints the verdict of a section: "ok" if none of its checks failed, otherwise "FAILED".
+ * @param  failuresBefore: failures when the section started.
+ * @retval bool: true if none of its checks failed.
+ */
+static inline bool checkSection(uint32_t failuresBefore)
+{
+  bool passed = (failures == failuresBefore);
+
+  printf("  %s\n", passed ? "ok" : "FAILED");
+  return passed;
+}
+
+#endif /* SIM_INC_SIM_CHECK_H_ */
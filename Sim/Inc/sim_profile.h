@@ -0,0 +1,60 @@
+#ifndef SIM_INC_SIM_PROFILE_H_
+#define SIM_INC_SIM_PROFILE_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Pipeline stages measured by the replay harness, one per wrapped Drivers/API entry point group.
+ */
+typedef enum
+{
+  SIM_STAGE_APP = 0, // APP_update itself: glue and formatting
+  SIM_STAGE_SENSOR,  // Compensation of the timed DMA reads
+  SIM_STAGE_FILTER,
+  SIM_STAGE_STATS,
+  SIM_STAGE_REPORT,
+  SIM_STAGE_ALARM,
+  SIM_STAGE_CODEC,
+  SIM_STAGE_LOG,
+  SIM_STAGE_CLOCK,
+  SIM_STAGE_LCD,
+  SIM_STAGE_UART,
+  SIM_STAGE_COUNT,
+} simStage_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+ * @brief  Opens the hardware cycle and instruction counters, or falls back to a nanosecond clock.
+ * @param  None
+ * @retval bool: true if hardware counters are available.
+ */
+bool SIM_PROFILE_Init(void);
+
+/**
+ * @brief  Starts measuring a stage. Stages nest: time spent in an inner stage is not charged to the outer one.
+ * @param  stage: Stage entered.
+ * @retval None
+ */
+void SIM_PROFILE_Enter(simStage_t stage);
+
+/**
+ * @brief  Stops measuring the innermost stage.
+ * @param  None
+ * @retval None
+ */
+void SIM_PROFILE_Exit(void);
+
+/**
+ * @brief  Prints calls and exclusive per-call cost of each stage.
+ * @param  out: Stream.
+ * @retval None
+ */
+void SIM_PROFILE_Report(FILE *out);
+
+#endif /* SIM_INC_SIM_PROFILE_H_ */
@@ -0,0 +1,12 @@
+#ifndef SIM_INC_SIM_STDLIB_H_
+#define SIM_INC_SIM_STDLIB_H_
+
+/*
+ * newlib extensions used by Drivers/API that the host C library does not provide.
+ * Force-included in every simulation translation unit (see Sim/CMakeLists.txt).
+ */
+
+char *itoa(int value, char *str, int base);
+char *utoa(unsigned value, char *str, int base);
+
+#endif /* SIM_INC_SIM_STDLIB_H_ */
@@ -0,0 +1,333 @@
+#ifndef SIM_INC_STM32F4XX_HAL_H_
+#define SIM_INC_STM32F4XX_HAL_H_
+
+/*
+ * Host stand-in for the STM32F4 HAL, shadowing the real header in the simulation build.
+ * Only the types, constants and functions referenced by Drivers/API are declared; the
+ * functions are implemented by the virtual peripherals in Sim/Src.
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Exported types ------------------------------------------------------------*/
+
+typedef enum
+{
+  HAL_OK = 0x00U,
+  HAL_ERROR = 0x01U,
+  HAL_BUSY = 0x02U,
+  HAL_TIMEOUT = 0x03U,
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+  HAL_RTC_STATE_RESET = 0x00U,
+  HAL_RTC_STATE_READY = 0x01U,
+  HAL_RTC_STATE_BUSY = 0x02U,
+} HAL_RTCStateTypeDef;
+
+typedef struct
+{
+  uint32_t BDCR;
+} RCC_TypeDef;
+
+typedef struct
+{
+  uint32_t SSR;
+  uint32_t WPR;
+} RTC_TypeDef;
+
+typedef struct
+{
+  uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef struct
+{
+  uint32_t SR;
+  uint32_t DR;
+  uint32_t BRR;
+} USART_TypeDef;
+
+typedef struct
+{
+  uint8_t Hours;
+  uint8_t Minutes;
+  uint8_t Seconds;
+  uint8_t TimeFormat;
+  uint32_t SubSeconds;
+  uint32_t SecondFraction;
+  uint32_t DayLightSaving;
+  uint32_t StoreOperation;
+} RTC_TimeTypeDef;
+
+typedef struct
+{
+  uint8_t WeekDay;
+  uint8_t Month;
+  uint8_t Date;
+  uint8_t Year;
+} RTC_DateTypeDef;
+
+typedef struct
+{
+  uint32_t HourFormat;
+  uint32_t AsynchPrediv;
+  uint32_t SynchPrediv;
+} RTC_InitTypeDef;
+
+typedef struct
+{
+  RTC_TypeDef *Instance;
+  RTC_InitTypeDef Init;
+  HAL_RTCStateTypeDef State;
+} RTC_HandleTypeDef;
+
+typedef struct
+{
+  uint32_t BaudRate;
+  uint32_t WordLength;
+  uint32_t StopBits;
+  uint32_t Parity;
+  uint32_t Mode;
+  uint32_t HwFlowCtl;
+  uint32_t OverSampling;
+} UART_InitTypeDef;
+
+typedef struct
+{
+  USART_TypeDef *Instance;
+  UART_InitTypeDef Init;
+} UART_HandleTypeDef;
+
+typedef enum
+{
+  HAL_SPI_STATE_RESET = 0x00U,
+  HAL_SPI_STATE_READY = 0x01U,
+  HAL_SPI_STATE_BUSY = 0x02U,
+  HAL_SPI_STATE_BUSY_TX = 0x03U,
+  HAL_SPI_STATE_BUSY_RX = 0x04U,
+  HAL_SPI_STATE_BUSY_TX_RX = 0x05U,
+  HAL_SPI_STATE_ERROR = 0x06U,
+  HAL_SPI_STATE_ABORT = 0x07U,
+} HAL_SPI_StateTypeDef;
+
+typedef struct __DMA_HandleTypeDef DMA_HandleTypeDef;
+
+typedef struct
+{
+  void *Instance;
+  struct __DMA_HandleTypeDef *hdmatx;
+  struct __DMA_HandleTypeDef *hdmarx;
+  HAL_SPI_StateTypeDef State;
+} SPI_HandleTypeDef;
+
+typedef struct
+{
+  void *Instance;
+} I2C_HandleTypeDef;
+
+typedef struct
+{
+  uint32_t Prescaler;
+  uint32_t Period;
+} TIM_Base_InitTypeDef;
+
+typedef struct
+{
+  void *Instance;
+  TIM_Base_InitTypeDef Init;
+} TIM_HandleTypeDef;
+
+struct __DMA_HandleTypeDef
+{
+  void *Instance;
+  void *Parent; // Handle the stream completes for, set by __HAL_LINKDMA
+};
+
+typedef struct
+{
+  uint32_t CTRL;
+  uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+  uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef enum
+{
+  GPIO_PIN_RESET = 0,
+  GPIO_PIN_SET,
+} GPIO_PinState;
+
+typedef struct
+{
+  uint32_t TypeErase;
+  uint32_t Banks;
+  uint32_t Sector;
+  uint32_t NbSectors;
+  uint32_t VoltageRange;
+} FLASH_EraseInitTypeDef;
+
+typedef int32_t IRQn_Type;
+
+/* Exported constants --------------------------------------------------------*/
+
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+
+extern RCC_TypeDef simRcc;
+extern RTC_TypeDef simRtc;
+extern GPIO_TypeDef simGpioB;
+extern GPIO_TypeDef simGpioD;
+extern USART_TypeDef simUsart3;
+extern uint32_t simSpi1; // Instance tags only, no registers behind them
+extern uint32_t simTim6;
+extern DWT_Type simDwt;
+extern CoreDebug_Type simCoreDebug;
+extern uint32_t SystemCoreClock;
+
+#define RCC (&simRcc)
+#define RTC (&simRtc)
+#define GPIOB (&simGpioB)
+#define GPIOD (&simGpioD)
+#define USART3 (&simUsart3)
+#define SPI1 ((void *)&simSpi1)
+#define TIM6 ((void *)&simTim6)
+#define DWT (&simDwt)
+#define CoreDebug (&simCoreDebug)
+
+#define DWT_CTRL_CYCCNTENA_Msk 0x00000001U
+#define CoreDebug_DEMCR_TRCENA_Msk 0x01000000U
+
+#define RCC_BDCR_RTCEN 0x00008000U
+#define RCC_RTCCLKSOURCE_LSE 0x00000100U
+#define RCC_RTCCLKSOURCE_LSI 0x00000200U
+
+#define GPIO_PIN_3 ((uint16_t)0x0008)
+#define GPIO_PIN_8 ((uint16_t)0x0100)
+#define GPIO_PIN_9 ((uint16_t)0x0200)
+#define GPIO_AF7_USART3 ((uint8_t)0x07)
+
+#define UART_WORDLENGTH_8B 0x00000000U
+#define UART_STOPBITS_1 0x00000000U
+#define UART_PARITY_NONE 0x00000000U
+#define UART_PARITY_ODD 0x00000600U
+#define UART_MODE_TX_RX 0x0000000CU
+#define UART_HWCONTROL_NONE 0x00000000U
+#define UART_OVERSAMPLING_16 0x00000000U
+#define UART_IT_RXNE 0x10000020U
+
+#define USART_SR_PE 0x00000001U
+#define USART_SR_FE 0x00000002U
+#define USART_SR_NE 0x00000004U
+#define USART_SR_ORE 0x00000008U
+#define USART_SR_RXNE 0x00000020U
+
+// Divider of stm32f4xx_hal_uart.h, 16x oversampling
+#define UART_DIV_SAMPLING16(_PCLK_, _BAUD_) ((uint32_t)((((uint64_t)(_PCLK_)) * 25U) / (4U * ((uint64_t)(_BAUD_)))))
+#define UART_DIVMANT_SAMPLING16(_PCLK_, _BAUD_) (UART_DIV_SAMPLING16((_PCLK_), (_BAUD_)) / 100U)
+#define UART_DIVFRAQ_SAMPLING16(_PCLK_, _BAUD_)                                                                  \
+  ((((UART_DIV_SAMPLING16((_PCLK_), (_BAUD_)) - (UART_DIVMANT_SAMPLING16((_PCLK_), (_BAUD_)) * 100U)) * 16U) + \
+    50U) / 100U)
+#define UART_BRR_SAMPLING16(_PCLK_, _BAUD_)                                                                    \
+  ((UART_DIVMANT_SAMPLING16((_PCLK_), (_BAUD_)) << 4U) + (UART_DIVFRAQ_SAMPLING16((_PCLK_), (_BAUD_)) & 0xF0U) + \
+   (UART_DIVFRAQ_SAMPLING16((_PCLK_), (_BAUD_)) & 0x0FU))
+
+#define RTC_FORMAT_BIN 0x00000000U
+#define RTC_FORMAT_BCD 0x00000001U
+#define RTC_DAYLIGHTSAVING_NONE 0x00000000U
+#define RTC_STOREOPERATION_RESET 0x00000000U
+#define RTC_WEEKDAY_MONDAY ((uint8_t)0x01)
+#define RTC_WEEKDAY_SATURDAY ((uint8_t)0x06)
+#define RTC_WEEKDAY_SUNDAY ((uint8_t)0x07)
+#define RTC_MONTH_AUGUST ((uint8_t)0x08)
+#define RTC_BKP_DR0 0x00000000U
+#define RTC_BKP_NUMBER 20U
+#define RTC_WAKEUPCLOCK_CK_SPRE_16BITS 0x00000004U
+#define RTC_SMOOTHCALIB_PERIOD_32SEC 0x00000000U
+#define RTC_SMOOTHCALIB_PLUSPULSES_SET 0x00008000U
+#define RTC_SMOOTHCALIB_PLUSPULSES_RESET 0x00000000U
+
+#define FLASH_TYPEERASE_SECTORS 0x00000000U
+#define FLASH_TYPEPROGRAM_WORD 0x00000002U
+#define FLASH_VOLTAGE_RANGE_3 0x00000002U
+#define FLASH_BANK_2 2U
+#define FLASH_SECTOR_20 20U
+#define RTC_WKUP_IRQn ((IRQn_Type)3)
+#define FLASH_IRQn ((IRQn_Type)4)
+#define USART3_IRQn ((IRQn_Type)39)
+
+#define __HAL_RTC_WRITEPROTECTION_DISABLE(__HANDLE__) ((__HANDLE__)->Instance->WPR = 0xCAU)
+#define __HAL_RTC_WRITEPROTECTION_ENABLE(__HANDLE__) ((__HANDLE__)->Instance->WPR = 0xFFU)
+#define __HAL_RCC_GPIOD_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_USART3_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_USART3_FORCE_RESET() ((void)0)
+#define __HAL_RCC_USART3_RELEASE_RESET() ((void)0)
+#define __HAL_UART_ENABLE_IT(__HANDLE__, __INTERRUPT__) ((void)(__HANDLE__), (void)(__INTERRUPT__))
+#define __HAL_TIM_SET_AUTORELOAD(__HANDLE__, __AUTORELOAD__) ((__HANDLE__)->Init.Period = (__AUTORELOAD__))
+#define __HAL_LINKDMA(__HANDLE__, __PPP_DMA_FIELD__, __DMA_HANDLE__) \
+  do                                                                \
+  {                                                                 \
+    (__HANDLE__)->__PPP_DMA_FIELD__ = &(__DMA_HANDLE__);            \
+    (__DMA_HANDLE__).Parent = (__HANDLE__);                         \
+  } while (0U)
+
+/* Exported functions ------------------------------------------------------- */
+
+// CMSIS interrupt masking: the host build is single threaded, so there is nothing to mask
+static inline uint32_t __get_PRIMASK(void) { return 0U; }
+static inline void __set_PRIMASK(uint32_t priMask) { (void)priMask; }
+static inline void __disable_irq(void) {}
+
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef *hspi);
+void HAL_SPI_MspInit(SPI_HandleTypeDef *hspi);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData,
+                                              uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi);
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi);
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, const uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, const uint8_t *pData,
+                                          uint16_t Size, uint32_t Timeout);
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+
+void HAL_PWR_EnableBkUpAccess(void);
+
+void HAL_RTC_MspInit(RTC_HandleTypeDef *hrtc);
+HAL_StatusTypeDef HAL_RTC_WaitForSynchro(RTC_HandleTypeDef *hrtc);
+HAL_StatusTypeDef HAL_RTC_SetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *sTime, uint32_t Format);
+HAL_StatusTypeDef HAL_RTC_GetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *sTime, uint32_t Format);
+HAL_StatusTypeDef HAL_RTC_SetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *sDate, uint32_t Format);
+HAL_StatusTypeDef HAL_RTC_GetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *sDate, uint32_t Format);
+HAL_StatusTypeDef HAL_RTCEx_SetWakeUpTimer_IT(RTC_HandleTypeDef *hrtc, uint32_t WakeUpCounter, uint32_t WakeUpClock);
+HAL_StatusTypeDef HAL_RTCEx_SetSmoothCalib(RTC_HandleTypeDef *hrtc, uint32_t SmoothCalibPeriod,
+                                           uint32_t SmoothCalibPlusPulses, uint32_t SmoothCalibMinusPulsesValue);
+void HAL_RTCEx_BKUPWrite(RTC_HandleTypeDef *hrtc, uint32_t BackupRegister, uint32_t Data);
+uint32_t HAL_RTCEx_BKUPRead(RTC_HandleTypeDef *hrtc, uint32_t BackupRegister);
+void HAL_RTCEx_WakeUpTimerEventCallback(RTC_HandleTypeDef *hrtc);
+
+#endif /* SIM_INC_STM32F4XX_HAL_H_ */
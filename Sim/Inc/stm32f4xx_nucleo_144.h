@@ -0,0 +1,32 @@
+#ifndef SIM_INC_STM32F4XX_NUCLEO_144_H_
+#define SIM_INC_STM32F4XX_NUCLEO_144_H_
+
+/*
+ * Host stand-in for the Nucleo-144 BSP, shadowing the real header in the simulation build.
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+
+typedef enum
+{
+  LED1 = 0,
+  LED2 = 1,
+  LED3 = 2,
+  LED_GREEN = LED1,
+  LED_BLUE = LED2,
+  LED_RED = LED3,
+} Led_TypeDef;
+
+#define LEDn 3
+
+/* Exported functions ------------------------------------------------------- */
+
+void BSP_LED_Init(Led_TypeDef Led);
+void BSP_LED_On(Led_TypeDef Led);
+void BSP_LED_Off(Led_TypeDef Led);
+void BSP_LED_Toggle(Led_TypeDef Led);
+
+#endif /* SIM_INC_STM32F4XX_NUCLEO_144_H_ */
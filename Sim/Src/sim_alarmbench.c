@@ -0,0 +1,534 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "API_app.h" /* <- APP_TEMP_* and APP_HUM_* alarm table values */
+#include "API_alarm.h"
+#include "sim_check.h"
+
+/*
+ * API_alarm.h engine against scripted traces with known transitions, then against a recorded trace, then
+ * throughput.
+ *
+ *   sim_alarmbench [-t trace.csv] [-n calls]
+ *
+ *   -t  Recorded environment trace, "ms,temperature,humidity" per line ('#' lines are comments), fed point by
+ *       point to both channels with the firmware's alarm table.
+ *   -n  Calls of the throughput run, default 10 million.
+ *
+ * Scripted traces: 50 ms samples of a waveform on the temperature channel, with the firmware's limits. Each one
+ * lists the transitions it must produce, in order, each inside a time window: noise around a limit that the
+ * dwell time and the hysteresis band must absorb, a spike shorter than the dwell, a ramp through both levels and
+ * back on each side, a rate of change inside the limits, and a dwell that spans the 32-bit millisecond wrap.
+ *
+ * Every trace, scripted or recorded, is also checked for what holds on any input: an event is a change of the
+ * committed severity, its previous severity is the one committed before it, and two events on one channel are
+ * at least the dwell time apart. The recorded trace prints its events next to the crossings of the warning
+ * limits a bare threshold compare (the former THRESHOLD_TEMP FSM) would have reported.
+ *
+ * Throughput: ns per API_ALARM_Update, host wall time, compare runs on one machine only.
+ *
+ * Exit status 1 if a transition is missing, extra, outside its window, or an invariant fails.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define ALARMBENCH_DEFAULT_CALLS 10000000U
+#define ALARMBENCH_SAMPLE_MS 50U
+#define ALARMBENCH_WINDOW_MS 200U    // Slack after the expected commit time: sampling and rate reference steps
+#define ALARMBENCH_MAX_EVENTS 8U
+#define ALARMBENCH_SAMPLES 4096U     // Throughput inputs, a power of two
+#define ALARMBENCH_NS_PER_SECOND 1e9
+#define ALARMBENCH_LINE_SIZE 128U
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief Transition a scripted trace must produce, committed within [atMs, atMs + ALARMBENCH_WINDOW_MS].
+ */
+typedef struct
+{
+  alarmSeverity_t previous;
+  alarmSeverity_t current;
+  uint32_t atMs; // From the start of the trace
+} expectedEvent_t;
+
+/**
+ * @brief Scripted trace: a waveform sampled every ALARMBENCH_SAMPLE_MS on the temperature channel.
+ */
+typedef struct
+{
+  const char *name;
+  float (*waveform)(uint32_t ms);
+  uint32_t durationMs;
+  uint32_t startMs; // Clock value of the first sample
+  bool rateEnabled;
+  expectedEvent_t events[ALARMBENCH_MAX_EVENTS];
+  uint32_t eventCount;
+} scenario_t;
+
+/**
+ * @brief Committed state seen by the invariant checks, per channel.
+ */
+typedef struct
+{
+  alarmSeverity_t severity;
+  uint32_t lastEventMs;
+  bool hasEvent;
+  uint32_t dwellMs;
+} channelTrack_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+static float samples[ALARMBENCH_SAMPLES];
+static volatile uint32_t sink; // Keeps the timed results alive
+
+/* Private Function Prototypes ---------------------------------------------- */
+static float noise(float amplitude);
+static float noisyLimit(uint32_t ms);
+static float shortSpike(uint32_t ms);
+static float rampHigh(uint32_t ms);
+static float rampLow(uint32_t ms);
+static float fastRise(uint32_t ms);
+static float stepAcrossWrap(uint32_t ms);
+static alarmConfig_t defaultConfig(alarmChannel_t channel);
+static void trackEvent(channelTrack_t *track, const alarmEvent_t *event, uint32_t nowMs);
+static bool runScenario(const scenario_t *scenario);
+static void checkConfiguration(void);
+static bool runRecorded(const char *path);
+static double nowNs(void);
+static double timeUpdate(uint32_t calls);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Uniform noise, from the seeded C library generator so every run sees the same trace.
+ * @param  float amplitude: Half width.
+ * @retval float: Value in [-amplitude, amplitude].
+ */
+static float noise(float amplitude)
+{
+  return amplitude * (2.0f * (float)rand() / (float)RAND_MAX - 1.0f);
+}
+
+/**
+ * @brief  Around the warning limit: crossing it in and out for 2 min, above it for 1 min, inside the hysteresis
+ *         band for 2 min, then well below it.
+ * @param  uint32_t ms: Time from the start.
+ * @retval float: Degrees Celsius.
+ */
+static float noisyLimit(uint32_t ms)
+{
+  if (ms < 120000U)
+  {
+    return APP_TEMP_WARNING_HIGH - 0.1f + noise(0.15f);
+  }
+  if (ms < 180000U)
+  {
+    return APP_TEMP_WARNING_HIGH + 0.3f + noise(0.15f);
+  }
+  if (ms < 300000U)
+  {
+    return APP_TEMP_WARNING_HIGH - APP_TEMP_HYSTERESIS + 0.3f + noise(0.15f);
+  }
+  return APP_TEMP_WARNING_HIGH - 1.0f + noise(0.15f);
+}
+
+/**
+ * @brief  Past the critical limit for less than the dwell time, once.
+ * @param  uint32_t ms: Time from the start.
+ * @retval float: Degrees Celsius.
+ */
+static float shortSpike(uint32_t ms)
+{
+  return (ms >= 10000U && ms < 10000U + APP_TEMP_DWELL_MS - 100U) ? APP_TEMP_CRITICAL_HIGH + 5.0f : 20.0f;
+}
+
+/**
+ * @brief  20 C to 32 C and back at 0.1 C/s.
+ * @param  uint32_t ms: Time from the start.
+ * @retval float: Degrees Celsius.
+ */
+static float rampHigh(uint32_t ms)
+{
+  float seconds = (float)ms / 1000.0f;
+
+  return (seconds < 120.0f) ? 20.0f + 0.1f * seconds : 32.0f - 0.1f * (seconds - 120.0f);
+}
+
+/**
+ * @brief  15 C to 3 C and back at 0.1 C/s.
+ * @param  uint32_t ms: Time from the start.
+ * @retval float: Degrees Celsius.
+ */
+static float rampLow(uint32_t ms)
+{
+  float seconds = (float)ms / 1000.0f;
+
+  return (seconds < 120.0f) ? 15.0f - 0.1f * seconds : 3.0f + 0.1f * (seconds - 120.0f);
+}
+
+/**
+ * @brief  12 C to 18 C at 3 C/min, inside the limits, then flat.
+ * @param  uint32_t ms: Time from the start.
+ * @retval float: Degrees Celsius.
+ */
+static float fastRise(uint32_t ms)
+{
+  return (ms < 120000U) ? 12.0f + 3.0f * (float)ms / 60000.0f : 18.0f;
+}
+
+/**
+ * @brief  Steps past the warning limit 500 ms before the millisecond clock wraps.
+ * @param  uint32_t ms: Time from the start.
+ * @retval float: Degrees Celsius.
+ */
+static float stepAcrossWrap(uint32_t ms)
+{
+  return (ms >= 4500U) ? APP_TEMP_WARNING_HIGH + 1.0f : 20.0f;
+}
+
+/**
+ * @brief  The firmware's alarm table entry of a channel, from the API_app.h values.
+ * @param  alarmChannel_t channel: Temperature or humidity.
+ * @retval alarmConfig_t: Configuration.
+ */
+static alarmConfig_t defaultConfig(alarmChannel_t channel)
+{
+  if (channel == ALARM_CHANNEL_HUMIDITY)
+  {
+    return (alarmConfig_t){
+        .enabled = true,
+        .highLimit = {ALARM_LIMIT_DISABLED_HIGH, APP_HUM_WARNING_HIGH, APP_HUM_CRITICAL_HIGH},
+        .lowLimit = {ALARM_LIMIT_DISABLED_LOW, APP_HUM_WARNING_LOW, APP_HUM_CRITICAL_LOW},
+        .hysteresis = APP_HUM_HYSTERESIS,
+        .dwellMs = APP_HUM_DWELL_MS,
+        .rateLimitPerMin = APP_HUM_RATE_LIMIT,
+    };
+  }
+
+  return (alarmConfig_t){
+      .enabled = true,
+      .highLimit = {ALARM_LIMIT_DISABLED_HIGH, APP_TEMP_WARNING_HIGH, APP_TEMP_CRITICAL_HIGH},
+      .lowLimit = {ALARM_LIMIT_DISABLED_LOW, APP_TEMP_WARNING_LOW, APP_TEMP_CRITICAL_LOW},
+      .hysteresis = APP_TEMP_HYSTERESIS,
+      .dwellMs = APP_TEMP_DWELL_MS,
+      .rateLimitPerMin = APP_TEMP_RATE_LIMIT,
+  };
+}
+
+/**
+ * @brief  Checks the invariants of an event against the channel's committed state, then commits it.
+ * @param  channelTrack_t *track: Channel state seen so far.
+ * @param  const alarmEvent_t *event: Event returned by API_ALARM_Update.
+ * @param  uint32_t nowMs: Time of the sample.
+ * @retval None
+ */
+static void trackEvent(channelTrack_t *track, const alarmEvent_t *event, uint32_t nowMs)
+{
+  check(event->current != event->previous, "an event changes the severity");
+  check(event->previous == track->severity, "an event starts from the committed severity");
+  check(!track->hasEvent || nowMs - track->lastEventMs >= track->dwellMs, "events on a channel a dwell apart");
+  check(API_ALARM_GetSeverity(event->channel) == event->current, "the event's severity is committed");
+
+  track->severity = event->current;
+  track->lastEventMs = nowMs;
+  track->hasEvent = true;
+}
+
+/**
+ * @brief  Feeds a scripted trace and compares its transitions with the expected ones.
+ * @param  const scenario_t *scenario: Trace.
+ * @retval bool: true if every check passed.
+ */
+static bool runScenario(const scenario_t *scenario)
+{
+  static const char *const severityNames[ALARM_SEVERITY_COUNT] = {"none", "warning", "critical"};
+  alarmConfig_t config = defaultConfig(ALARM_CHANNEL_TEMPERATURE);
+  channelTrack_t track = {.dwellMs = config.dwellMs};
+  uint32_t failuresBefore = failures;
+  uint32_t seen = 0;
+  uint32_t crossings = 0;
+  bool above = false;
+
+  if (!scenario->rateEnabled)
+  {
+    config.rateLimitPerMin = ALARM_RATE_DISABLED;
+  }
+  API_ALARM_Init();
+  API_ALARM_Configure(ALARM_CHANNEL_TEMPERATURE, &config);
+  srand(1);
+
+  printf("%s\n", scenario->name);
+  for (uint32_t ms = 0; ms <= scenario->durationMs; ms += ALARMBENCH_SAMPLE_MS)
+  {
+    float value = scenario->waveform(ms);
+    bool outside = value > config.highLimit[ALARM_SEVERITY_WARNING] || value < config.lowLimit[ALARM_SEVERITY_WARNING];
+    alarmEvent_t event;
+
+    crossings += (outside != above) ? 1U : 0U;
+    above = outside;
+
+    if (!API_ALARM_Update(ALARM_CHANNEL_TEMPERATURE, value, scenario->startMs + ms, &event))
+    {
+      continue;
+    }
+
+    printf("  %7u ms %-8s -> %-8s at %6.2f C%s\n", ms, severityNames[event.previous], severityNames[event.current],
+           event.value, event.rateAlarm ? ", rate" : "");
+    trackEvent(&track, &event, scenario->startMs + ms);
+
+    if (seen < scenario->eventCount)
+    {
+      const expectedEvent_t *expected = &scenario->events[seen];
+
+      check(event.previous == expected->previous && event.current == expected->current, "expected transition");
+      check(ms >= expected->atMs && ms <= expected->atMs + ALARMBENCH_WINDOW_MS, "transition inside its window");
+    }
+    seen++;
+  }
+
+  check(seen == scenario->eventCount, "as many transitions as expected");
+  printf("  %u transitions, %u expected, %u warning limit crossings by a bare compare\n", seen, scenario->eventCount,
+         crossings);
+  return checkSection(failuresBefore);
+}
+
+/**
+ * @brief  Configuration checks: invalid tables refused, disabled channels silent, margins.
+ * @param  None
+ * @retval None
+ */
+static void checkConfiguration(void)
+{
+  uint32_t failuresBefore = failures;
+  alarmConfig_t config = defaultConfig(ALARM_CHANNEL_TEMPERATURE);
+  alarmConfig_t invalid;
+  alarmEvent_t event;
+
+  API_ALARM_Init();
+  check(!API_ALARM_Update(ALARM_CHANNEL_PRESSURE, 2000.0f, 0U, &event), "disabled channel reports nothing");
+  check(API_ALARM_GetMargin(ALARM_CHANNEL_PRESSURE, 0.0f) == ALARM_LIMIT_DISABLED_HIGH, "disabled channel margin");
+  check(!API_ALARM_Configure(ALARM_CHANNEL_COUNT, &config), "invalid channel refused");
+  check(!API_ALARM_Configure(ALARM_CHANNEL_TEMPERATURE, NULL), "missing configuration refused");
+
+  invalid = config;
+  invalid.hysteresis = -1.0f;
+  check(!API_ALARM_Configure(ALARM_CHANNEL_TEMPERATURE, &invalid), "negative hysteresis refused");
+  invalid = config;
+  invalid.highLimit[ALARM_SEVERITY_CRITICAL] = config.highLimit[ALARM_SEVERITY_WARNING] - 1.0f;
+  check(!API_ALARM_Configure(ALARM_CHANNEL_TEMPERATURE, &invalid), "critical high limit inside the warning one");
+  invalid = config;
+  invalid.lowLimit[ALARM_SEVERITY_CRITICAL] = config.lowLimit[ALARM_SEVERITY_WARNING] + 1.0f;
+  check(!API_ALARM_Configure(ALARM_CHANNEL_TEMPERATURE, &invalid), "critical low limit inside the warning one");
+
+  check(API_ALARM_Configure(ALARM_CHANNEL_TEMPERATURE, &config), "firmware table accepted");
+  check(API_ALARM_GetMargin(ALARM_CHANNEL_TEMPERATURE, APP_TEMP_WARNING_HIGH - 2.0f) == 2.0f, "margin to the high limit");
+  check(API_ALARM_GetMargin(ALARM_CHANNEL_TEMPERATURE, APP_TEMP_WARNING_LOW + 1.0f) == 1.0f, "margin to the low limit");
+  check(API_ALARM_GetMargin(ALARM_CHANNEL_TEMPERATURE, APP_TEMP_CRITICAL_HIGH) == 0.0f, "no margin past a limit");
+
+  // Reconfiguring resets a committed level
+  for (uint32_t ms = 0; ms <= 2U * APP_TEMP_DWELL_MS; ms += ALARMBENCH_SAMPLE_MS)
+  {
+    API_ALARM_Update(ALARM_CHANNEL_TEMPERATURE, APP_TEMP_CRITICAL_HIGH + 1.0f, ms, &event);
+  }
+  check(API_ALARM_GetHighestSeverity() == ALARM_SEVERITY_CRITICAL, "critical committed");
+  API_ALARM_Configure(ALARM_CHANNEL_TEMPERATURE, &config);
+  check(API_ALARM_GetSeverity(ALARM_CHANNEL_TEMPERATURE) == ALARM_SEVERITY_NONE, "reconfiguring resets the level");
+
+  printf("configuration\n");
+  checkSection(failuresBefore);
+}
+
+/**
+ * @brief  Feeds a recorded environment trace to both channels with the firmware's table.
+ * @param  const char *path: "ms,temperature,humidity" CSV.
+ * @retval bool: true if the file was read.
+ */
+static bool runRecorded(const char *path)
+{
+  static const alarmChannel_t recorded[] = {ALARM_CHANNEL_TEMPERATURE, ALARM_CHANNEL_HUMIDITY};
+  FILE *in = fopen(path, "r");
+  channelTrack_t tracks[ALARM_CHANNEL_COUNT] = {0};
+  uint32_t events[ALARM_CHANNEL_COUNT] = {0};
+  uint32_t crossings[ALARM_CHANNEL_COUNT] = {0};
+  bool outside[ALARM_CHANNEL_COUNT] = {false};
+  alarmConfig_t configs[ALARM_CHANNEL_COUNT];
+  char line[ALARMBENCH_LINE_SIZE];
+  uint32_t points = 0;
+  uint32_t failuresBefore = failures;
+
+  if (in == NULL)
+  {
+    perror(path);
+    return false;
+  }
+
+  API_ALARM_Init();
+  for (uint32_t i = 0; i < sizeof(recorded) / sizeof(recorded[0]); i++)
+  {
+    configs[recorded[i]] = defaultConfig(recorded[i]);
+    tracks[recorded[i]].dwellMs = configs[recorded[i]].dwellMs;
+    API_ALARM_Configure(recorded[i], &configs[recorded[i]]);
+  }
+
+  while (fgets(line, sizeof(line), in) != NULL)
+  {
+    unsigned long ms;
+    float values[ALARM_CHANNEL_COUNT];
+
+    if (line[0] == '#' || sscanf(line, "%lu,%f,%f", &ms, &values[ALARM_CHANNEL_TEMPERATURE],
+                                 &values[ALARM_CHANNEL_HUMIDITY]) != 3)
+    {
+      continue;
+    }
+    points++;
+
+    for (uint32_t i = 0; i < sizeof(recorded) / sizeof(recorded[0]); i++)
+    {
+      alarmChannel_t channel = recorded[i];
+      const alarmConfig_t *config = &configs[channel];
+      float value = values[channel];
+      bool isOutside = value > config->highLimit[ALARM_SEVERITY_WARNING] || value < config->lowLimit[ALARM_SEVERITY_WARNING];
+      alarmEvent_t event;
+
+      crossings[channel] += (isOutside != outside[channel]) ? 1U : 0U;
+      outside[channel] = isOutside;
+
+      if (API_ALARM_Update(channel, value, (uint32_t)ms, &event))
+      {
+        trackEvent(&tracks[channel], &event, (uint32_t)ms);
+        events[channel]++;
+      }
+    }
+  }
+  fclose(in);
+
+  printf("recorded %s: %u points\n", path, points);
+  printf("  temperature %u transitions, %u warning limit crossings by a bare compare\n",
+         events[ALARM_CHANNEL_TEMPERATURE], crossings[ALARM_CHANNEL_TEMPERATURE]);
+  printf("  humidity    %u transitions, %u warning limit crossings by a bare compare\n", events[ALARM_CHANNEL_HUMIDITY],
+         crossings[ALARM_CHANNEL_HUMIDITY]);
+  checkSection(failuresBefore);
+
+  return true;
+}
+
+/**
+ * @brief  Monotonic host time.
+ * @param  None
+ * @retval double: ns.
+ */
+static double nowNs(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec * ALARMBENCH_NS_PER_SECOND + (double)now.tv_nsec;
+}
+
+/**
+ * @brief  Times API_ALARM_Update on the temperature channel with the firmware's table.
+ * @param  uint32_t calls: Calls.
+ * @retval double: ns per call.
+ */
+static double timeUpdate(uint32_t calls)
+{
+  alarmConfig_t config = defaultConfig(ALARM_CHANNEL_TEMPERATURE);
+  alarmEvent_t event;
+  uint32_t events = 0;
+
+  API_ALARM_Init();
+  API_ALARM_Configure(ALARM_CHANNEL_TEMPERATURE, &config);
+
+  double start = nowNs();
+  for (uint32_t call = 0; call < calls; call++)
+  {
+    events += API_ALARM_Update(ALARM_CHANNEL_TEMPERATURE, samples[call & (ALARMBENCH_SAMPLES - 1U)],
+                               call * ALARMBENCH_SAMPLE_MS, &event) ? 1U : 0U;
+  }
+  double elapsed = nowNs() - start;
+
+  sink = events;
+  return elapsed / calls;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+  static const scenario_t scenarios[] = {
+      {"noise at the warning limit", noisyLimit, 360000U, 0U, false,
+       {{ALARM_SEVERITY_NONE, ALARM_SEVERITY_WARNING, 120000U + APP_TEMP_DWELL_MS},
+        {ALARM_SEVERITY_WARNING, ALARM_SEVERITY_NONE, 300000U + APP_TEMP_DWELL_MS}},
+       2U},
+      {"spike shorter than the dwell", shortSpike, 30000U, 0U, false, {{0}}, 0U},
+      {"ramp through both high levels and back", rampHigh, 240000U, 0U, false,
+       {{ALARM_SEVERITY_NONE, ALARM_SEVERITY_WARNING, 20000U + APP_TEMP_DWELL_MS},
+        {ALARM_SEVERITY_WARNING, ALARM_SEVERITY_CRITICAL, 100000U + APP_TEMP_DWELL_MS},
+        {ALARM_SEVERITY_CRITICAL, ALARM_SEVERITY_WARNING, 145000U + APP_TEMP_DWELL_MS},
+        {ALARM_SEVERITY_WARNING, ALARM_SEVERITY_NONE, 225000U + APP_TEMP_DWELL_MS}},
+       4U},
+      {"ramp through both low levels and back", rampLow, 240000U, 0U, false,
+       {{ALARM_SEVERITY_NONE, ALARM_SEVERITY_WARNING, 50000U + APP_TEMP_DWELL_MS},
+        {ALARM_SEVERITY_WARNING, ALARM_SEVERITY_CRITICAL, 100000U + APP_TEMP_DWELL_MS},
+        {ALARM_SEVERITY_CRITICAL, ALARM_SEVERITY_WARNING, 145000U + APP_TEMP_DWELL_MS},
+        {ALARM_SEVERITY_WARNING, ALARM_SEVERITY_NONE, 195000U + APP_TEMP_DWELL_MS}},
+       4U},
+      {"rate of change inside the limits", fastRise, 180000U, 0U, true,
+       {{ALARM_SEVERITY_NONE, ALARM_SEVERITY_WARNING, ALARM_RATE_MIN_INTERVAL_MS + APP_TEMP_DWELL_MS},
+        {ALARM_SEVERITY_WARNING, ALARM_SEVERITY_NONE, 130000U + APP_TEMP_DWELL_MS}},
+       2U},
+      {"dwell across the millisecond wrap", stepAcrossWrap, 10000U, UINT32_MAX - 4999U, false,
+       {{ALARM_SEVERITY_NONE, ALARM_SEVERITY_WARNING, 4500U + APP_TEMP_DWELL_MS}},
+       1U},
+  };
+  const char *tracePath = NULL;
+  uint32_t calls = ALARMBENCH_DEFAULT_CALLS;
+  int option;
+
+  while ((option = getopt(argc, argv, "t:n:")) != -1)
+  {
+    switch (option)
+    {
+    case 't':
+      tracePath = optarg;
+      break;
+    case 'n':
+      calls = (uint32_t)strtoul(optarg, NULL, 10);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-t trace.csv] [-n calls]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  for (uint32_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+  {
+    runScenario(&scenarios[i]);
+  }
+  checkConfiguration();
+  if (tracePath != NULL && !runRecorded(tracePath))
+  {
+    return EXIT_FAILURE;
+  }
+
+  srand(2);
+  for (uint32_t i = 0; i < ALARMBENCH_SAMPLES; i++)
+  {
+    samples[i] = APP_TEMP_WARNING_HIGH + noise(1.0f);
+  }
+  printf("\nAPI_ALARM_Update %.1f ns/call\n", timeUpdate(calls));
+
+  if (failures != 0U)
+  {
+    printf("FAIL: %u checks\n", failures);
+    return EXIT_FAILURE;
+  }
+
+  printf("OK: every transition as expected\n");
+  return EXIT_SUCCESS;
+}
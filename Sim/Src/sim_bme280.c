@@ -0,0 +1,585 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "sim.h"
+#include "API_bme280_port.h"
+
+/* Private constants ---------------------------------------------------------*/
+
+#define SIM_BME280_REG_COUNT 256U
+#define SIM_BME280_NOT_PRESENT 0xFFU   // MISO idles high when nothing drives it
+#define SIM_BME280_SKIPPED_MSB 0x80U   // Output of a skipped measurement (0x80000 / 0x8000)
+#define SIM_BME280_TEMP_ADC_MAX 0xFFFFF // 20-bit temperature result
+#define SIM_BME280_HUM_ADC_MAX 0xFFFF   // 16-bit humidity result
+#define SIM_BME280_HUM_ADC_SKIPPED 0x8000 // Humidity output of a skipped measurement
+#define SIM_BME280_MODE_MASK 0x03U      // ctrl_meas mode bits, 00 is sleep
+#define SIM_BME280_NOISE_MASK 0x03U     // Conversion noise on the raw temperature, in LSB
+#define SIM_BME280_NOISE_SEED 12345U
+#define SIM_BME280_LINE_SIZE 128U
+
+// Memory map (datasheet table 18)
+#define SIM_REG_CALIB_T1 0x88U
+#define SIM_REG_CALIB_T2 0x8AU
+#define SIM_REG_CALIB_T3 0x8CU
+#define SIM_REG_CALIB_H1 0xA1U
+#define SIM_REG_CALIB_H2 0xE1U
+#define SIM_REG_CALIB_H3 0xE3U
+#define SIM_REG_CALIB_H4 0xE4U
+#define SIM_REG_CALIB_H45 0xE5U
+#define SIM_REG_CALIB_H5 0xE6U
+#define SIM_REG_CALIB_H6 0xE7U
+#define SIM_REG_PRESS_MSB 0xF7U
+#define SIM_REG_TEMP_MSB 0xFAU
+#define SIM_REG_TEMP_LSB 0xFBU
+#define SIM_REG_TEMP_XLSB 0xFCU
+#define SIM_REG_HUM_MSB 0xFDU
+#define SIM_REG_HUM_LSB 0xFEU
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  uint32_t ms;
+  float temperature;
+  float humidity;
+  int32_t adcT; // Raw traces only
+  int32_t adcH;
+} simTracePoint_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+// Typical values of a production part, used when no calibration is given
+static const simBme280Calib_t defaultCalib = {
+    .T1 = 27504, .T2 = 26435, .T3 = -1000, .H1 = 75, .H2 = 362, .H3 = 0, .H4 = 313, .H5 = 50, .H6 = 30};
+
+static uint8_t registers[SIM_BME280_REG_COUNT];
+static simBme280Calib_t calibration;
+static bool present = true;
+static bool stuck;                 // Conversions stopped: the data registers keep their last values
+static uint32_t noiseState;        // Linear congruential generator of the conversion noise
+
+static float environmentTemperature = 25.0f;
+static float environmentHumidity = 50.0f;
+
+static simTracePoint_t trace[SIM_BME280_TRACE_MAX_POINTS];
+static uint32_t traceLength;
+static bool traceRaw; // Points hold ADC values, replayed as is without interpolation
+
+static uint32_t spiTransfers;
+static uint32_t spiBytes;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static int32_t compensateTemperature(int32_t adcT, int32_t *tFine);
+static uint32_t compensateHumidity(int32_t adcH, int32_t tFine);
+static uint32_t traceIndexAt(uint32_t ms);
+static void environmentAt(uint32_t ms, float *temperature, float *humidity);
+static bool loadTrace(const char *path, bool raw);
+static void updateOutputRegisters(void);
+static void writeOutputRegisters(int32_t adcT, int32_t adcH);
+static void resetControl(void);
+static void chargeTransfer(uint16_t size);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Datasheet temperature compensation, evaluated on the simulated trimming values.
+ * @param  int32_t adcT: Raw 20-bit temperature.
+ * @param  int32_t *tFine: Fine temperature for the humidity compensation.
+ * @retval int32_t: Temperature in 0.01 DegC.
+ */
+static int32_t compensateTemperature(int32_t adcT, int32_t *tFine)
+{
+  int32_t var1 = ((((adcT >> 3) - ((int32_t)calibration.T1 << 1))) * ((int32_t)calibration.T2)) >> 11;
+  int32_t var2 = (((((adcT >> 4) - ((int32_t)calibration.T1)) * ((adcT >> 4) - ((int32_t)calibration.T1))) >> 12) *
+                  ((int32_t)calibration.T3)) >> 14;
+
+  *tFine = var1 + var2;
+  return (*tFine * 5 + 128) >> 8;
+}
+
+/**
+ * @brief  Datasheet humidity compensation, evaluated on the simulated trimming values.
+ * @param  int32_t adcH: Raw 16-bit humidity.
+ * @param  int32_t tFine: Fine temperature.
+ * @retval uint32_t: Humidity in %RH as Q22.10.
+ */
+static uint32_t compensateHumidity(int32_t adcH, int32_t tFine)
+{
+  int32_t v = tFine - 76800;
+
+  v = (((((adcH << 14) - (((int32_t)calibration.H4) << 20) - (((int32_t)calibration.H5) * v)) + 16384) >> 15) *
+       (((((((v * ((int32_t)calibration.H6)) >> 10) * (((v * ((int32_t)calibration.H3)) >> 11) + 32768)) >> 10) +
+          2097152) * ((int32_t)calibration.H2) + 8192) >> 14));
+  v = v - (((((v >> 15) * (v >> 15)) >> 7) * ((int32_t)calibration.H1)) >> 4);
+  v = (v < 0) ? 0 : v;
+  v = (v > 419430400) ? 419430400 : v;
+
+  return (uint32_t)(v >> 12);
+}
+
+/**
+ * @brief  Finds the last trace point at or before a time, the first one if the trace starts later.
+ * @param  uint32_t ms: Virtual time.
+ * @retval uint32_t: Point index.
+ */
+static uint32_t traceIndexAt(uint32_t ms)
+{
+  uint32_t low = 0;
+  uint32_t high = traceLength;
+
+  while (high - low > 1U)
+  {
+    uint32_t middle = (low + high) / 2U;
+
+    if (trace[middle].ms <= ms)
+    {
+      low = middle;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+
+  return low;
+}
+
+/**
+ * @brief  Environment seen by the sensor: the trace, linearly interpolated and held past its ends, or the constant values.
+ * @param  uint32_t ms: Virtual time.
+ * @param  float *temperature: DegC.
+ * @param  float *humidity: %RH.
+ * @retval None
+ */
+static void environmentAt(uint32_t ms, float *temperature, float *humidity)
+{
+  uint32_t low;
+
+  if (traceLength == 0U)
+  {
+    *temperature = environmentTemperature;
+    *humidity = environmentHumidity;
+    return;
+  }
+
+  low = traceIndexAt(ms);
+  if (ms <= trace[low].ms || low == traceLength - 1U)
+  {
+    *temperature = trace[low].temperature;
+    *humidity = trace[low].humidity;
+    return;
+  }
+
+  const simTracePoint_t *next = &trace[low + 1U];
+  float fraction = (float)(ms - trace[low].ms) / (float)(next->ms - trace[low].ms);
+  *temperature = trace[low].temperature + fraction * (next->temperature - trace[low].temperature);
+  *humidity = trace[low].humidity + fraction * (next->humidity - trace[low].humidity);
+}
+
+/**
+ * @brief  Reads a CSV trace with ascending times, '#' lines are comments.
+ * @param  const char *path: CSV file.
+ * @param  bool raw: true for "ms,adc_T,adc_H" lines, false for "ms,temperature,humidity".
+ * @retval bool: true if at least one point was loaded.
+ */
+static bool loadTrace(const char *path, bool raw)
+{
+  char line[SIM_BME280_LINE_SIZE];
+  FILE *in = fopen(path, "r");
+
+  traceLength = 0;
+  traceRaw = raw;
+  if (in == NULL)
+  {
+    return false;
+  }
+
+  while (traceLength < SIM_BME280_TRACE_MAX_POINTS && fgets(line, sizeof(line), in) != NULL)
+  {
+    simTracePoint_t point = {0};
+    int fields;
+
+    if (line[0] == '#')
+    {
+      continue;
+    }
+
+    fields = raw ? sscanf(line, "%u,%d,%d", &point.ms, &point.adcT, &point.adcH)
+                 : sscanf(line, "%u,%f,%f", &point.ms, &point.temperature, &point.humidity);
+    if (fields == 3 && (traceLength == 0U || point.ms > trace[traceLength - 1U].ms))
+    {
+      trace[traceLength++] = point;
+    }
+  }
+  fclose(in);
+
+  return traceLength > 0U;
+}
+
+/**
+ * @brief  Loads the data registers with the raw values whose compensation gives the current environment,
+ *         found by bisection since both compensations are monotonic in the raw value.
+ * @param  None
+ * @retval None
+ */
+static void updateOutputRegisters(void)
+{
+  float temperature;
+  float humidity;
+  int32_t targetTemperature;
+  uint32_t targetHumidity;
+  int32_t tFine;
+  int32_t low = 0;
+  int32_t high = SIM_BME280_TEMP_ADC_MAX;
+  int32_t adcT;
+  int32_t adcH;
+  uint32_t ms = (uint32_t)(SIM_TIME_NowUs() / SIM_US_PER_MS);
+
+  // No conversion in sleep mode, nor once the sensor is stuck
+  if (stuck || (registers[BME280_CTRL_MEASR_REG] & SIM_BME280_MODE_MASK) == 0U)
+  {
+    return;
+  }
+
+  if (traceRaw && traceLength > 0U)
+  {
+    const simTracePoint_t *point = &trace[traceIndexAt(ms)];
+
+    adcT = point->adcT & SIM_BME280_TEMP_ADC_MAX;
+    adcH = point->adcH & SIM_BME280_HUM_ADC_MAX;
+    writeOutputRegisters(adcT, adcH);
+    return;
+  }
+
+  environmentAt(ms, &temperature, &humidity);
+  targetTemperature = (int32_t)(temperature * 100.0f + ((temperature < 0.0f) ? -0.5f : 0.5f));
+  targetHumidity = (uint32_t)(humidity * 1024.0f + 0.5f);
+
+  // Smallest raw temperature reaching the target
+  while (low < high)
+  {
+    int32_t middle = (low + high) / 2;
+
+    if (compensateTemperature(middle, &tFine) < targetTemperature)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+  adcT = low;
+  compensateTemperature(adcT, &tFine);
+
+  low = 0;
+  high = SIM_BME280_HUM_ADC_MAX;
+  while (low < high)
+  {
+    int32_t middle = (low + high) / 2;
+
+    if (compensateHumidity(middle, tFine) < targetHumidity)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+  adcH = low;
+
+  // A few LSB of conversion noise: a real part never repeats its output for long, even in a constant environment
+  noiseState = noiseState * 1103515245U + 12345U;
+  adcT += (int32_t)((noiseState >> 16) & SIM_BME280_NOISE_MASK);
+  if (adcT > SIM_BME280_TEMP_ADC_MAX)
+  {
+    adcT = SIM_BME280_TEMP_ADC_MAX;
+  }
+
+  writeOutputRegisters(adcT, adcH);
+}
+
+/**
+ * @brief  Stores raw results in the data registers, in the burst read layout.
+ * @param  int32_t adcT: 20-bit temperature.
+ * @param  int32_t adcH: 16-bit humidity.
+ * @retval None
+ */
+static void writeOutputRegisters(int32_t adcT, int32_t adcH)
+{
+  registers[SIM_REG_PRESS_MSB] = SIM_BME280_SKIPPED_MSB; // Pressure oversampling is skipped by the driver
+  registers[SIM_REG_PRESS_MSB + 1U] = 0;
+  registers[SIM_REG_PRESS_MSB + 2U] = 0;
+  registers[SIM_REG_TEMP_MSB] = (uint8_t)(adcT >> 12);
+  registers[SIM_REG_TEMP_LSB] = (uint8_t)(adcT >> 4);
+  registers[SIM_REG_TEMP_XLSB] = (uint8_t)((adcT & 0x0F) << 4);
+  registers[SIM_REG_HUM_MSB] = (uint8_t)(adcH >> 8);
+  registers[SIM_REG_HUM_LSB] = (uint8_t)adcH;
+}
+
+/**
+ * @brief  Power-on values of the control and data registers: the sensor sleeps and reads as skipped measurements.
+ * @param  None
+ * @retval None
+ */
+static void resetControl(void)
+{
+  registers[BME280_RESET_REG] = 0;
+  registers[BME280_CTRL_HUM_REG] = 0;
+  registers[BME280_CTRL_MEASR_REG] = 0;
+  registers[BME280_CTRL_CONFIG_REG] = 0;
+  writeOutputRegisters(BME280_TEMP_ADC_SKIPPED, SIM_BME280_HUM_ADC_SKIPPED);
+}
+
+/**
+ * @brief  Charges the SPI transfer time of the address byte and the data bytes.
+ * @param  uint16_t size: Data bytes.
+ * @retval None
+ */
+static void chargeTransfer(uint16_t size)
+{
+  spiTransfers++;
+  spiBytes += size + 1U;
+  SIM_TIME_AdvanceUs(((uint64_t)(size + 1U) * 8U * SIM_US_PER_SECOND) / SIM_SPI_HZ);
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Power-on state of the sensor with the given trimming values.
+ * @param  calib: Trimming values, NULL for typical ones.
+ * @retval None
+ */
+void SIM_BME280_Reset(const simBme280Calib_t *calib)
+{
+  calibration = (calib != NULL) ? *calib : defaultCalib;
+
+  memset(registers, 0, sizeof(registers));
+  spiTransfers = 0;
+  spiBytes = 0;
+  stuck = false;
+  noiseState = SIM_BME280_NOISE_SEED;
+  registers[CHIP_ID_REG] = BME280_CHIP_ID;
+  resetControl();
+
+  // Trimming parameters, little endian, laid out as in datasheet table 16
+  registers[SIM_REG_CALIB_T1] = (uint8_t)calibration.T1;
+  registers[SIM_REG_CALIB_T1 + 1U] = (uint8_t)(calibration.T1 >> 8);
+  registers[SIM_REG_CALIB_T2] = (uint8_t)calibration.T2;
+  registers[SIM_REG_CALIB_T2 + 1U] = (uint8_t)((uint16_t)calibration.T2 >> 8);
+  registers[SIM_REG_CALIB_T3] = (uint8_t)calibration.T3;
+  registers[SIM_REG_CALIB_T3 + 1U] = (uint8_t)((uint16_t)calibration.T3 >> 8);
+  registers[SIM_REG_CALIB_H1] = calibration.H1;
+  registers[SIM_REG_CALIB_H2] = (uint8_t)calibration.H2;
+  registers[SIM_REG_CALIB_H2 + 1U] = (uint8_t)((uint16_t)calibration.H2 >> 8);
+  registers[SIM_REG_CALIB_H3] = calibration.H3;
+  registers[SIM_REG_CALIB_H4] = (uint8_t)(calibration.H4 >> 4);                               // H4[11:4]
+  registers[SIM_REG_CALIB_H45] = (uint8_t)((calibration.H4 & 0x0F) | ((calibration.H5 & 0x0F) << 4)); // H4[3:0], H5[3:0]
+  registers[SIM_REG_CALIB_H5] = (uint8_t)(calibration.H5 >> 4);                               // H5[11:4]
+  registers[SIM_REG_CALIB_H6] = (uint8_t)calibration.H6;
+}
+
+/**
+ * @brief  Sets a constant environment, used when no trace is loaded.
+ * @param  temperature: DegC.
+ * @param  humidity: %RH.
+ * @retval None
+ */
+void SIM_BME280_SetEnvironment(float temperature, float humidity)
+{
+  environmentTemperature = temperature;
+  environmentHumidity = humidity;
+  traceLength = 0;
+  traceRaw = false;
+}
+
+/**
+ * @brief  Loads an environment trace: one "ms,temperature,humidity" line per point, ascending times,
+ *         '#' lines are comments. Values between points are interpolated.
+ * @param  path: CSV file.
+ * @retval bool: true if at least one point was loaded.
+ */
+bool SIM_BME280_LoadTrace(const char *path)
+{
+  return loadTrace(path, false);
+}
+
+/**
+ * @brief  Loads a raw trace: one "ms,adc_T,adc_H" line per point. Each point is returned unchanged by the
+ *         data registers until the next one, so recorded sensor output replays bit for bit.
+ * @param  path: CSV file.
+ * @retval bool: true if at least one point was loaded.
+ */
+bool SIM_BME280_LoadRawTrace(const char *path)
+{
+  return loadTrace(path, true);
+}
+
+/**
+ * @brief  Returns the time of the last trace point.
+ * @param  None
+ * @retval uint32_t: Milliseconds, 0 without a trace.
+ */
+uint32_t SIM_BME280_GetTraceEndMs(void)
+{
+  return (traceLength > 0U) ? trace[traceLength - 1U].ms : 0U;
+}
+
+/**
+ * @brief  Connects or disconnects the sensor from the bus.
+ * @param  value: false to make every read return the idle bus level.
+ * @retval None
+ */
+void SIM_BME280_SetPresent(bool value)
+{
+  present = value;
+}
+
+/**
+ * @brief  Replaces the chip ID register, as a different part on the bus would read.
+ * @param  id: Chip ID, BME280_CHIP_ID for a BME280.
+ * @retval None
+ */
+void SIM_BME280_SetChipId(uint8_t id)
+{
+  registers[CHIP_ID_REG] = id;
+}
+
+/**
+ * @brief  Stops or restarts the conversions: while stuck, the data registers keep their last values.
+ *         A soft reset or a power-on reset restarts them.
+ * @param  value: true to stop the conversions.
+ * @retval None
+ */
+void SIM_BME280_SetStuck(bool value)
+{
+  stuck = value;
+}
+
+/**
+ * @brief  Brown-out: the sensor restarts with its power-on settings and sleeps until configured again.
+ *         The trimming values and the chip ID are kept, as in the sensor's NVM.
+ * @param  None
+ * @retval None
+ */
+void SIM_BME280_PowerOnReset(void)
+{
+  stuck = false;
+  resetControl();
+}
+
+/**
+ * @brief  Returns the number of SPI transactions (chip select cycles).
+ * @param  None
+ * @retval uint32_t: Transaction count.
+ */
+uint32_t SIM_BME280_GetSpiTransfers(void)
+{
+  return spiTransfers;
+}
+
+/**
+ * @brief  Returns the number of SPI bytes clocked, address bytes included.
+ * @param  None
+ * @retval uint32_t: Byte count.
+ */
+uint32_t SIM_BME280_GetSpiBytes(void)
+{
+  return spiBytes;
+}
+
+/**
+ * @brief  Burst read as the SPI DMA clocks it, full duplex: the address byte, then the data. No time is charged,
+ *         the caller schedules the completion. The byte received during the address byte is the idle level.
+ * @param  tx: Address byte with the read bit, then dummy bytes.
+ * @param  rx: Receives size bytes.
+ * @param  size: Bytes, address byte included.
+ * @retval None
+ */
+void SIM_BME280_Exchange(const uint8_t *tx, uint8_t *rx, uint16_t size)
+{
+  uint8_t reg = tx[0] | READ_CMD_BIT; // The read bit replaces address bit 7: the data registers are all above 0x80
+  uint16_t dataSize = size - 1U;
+
+  spiTransfers++;
+  spiBytes += size;
+  rx[0] = SIM_BME280_NOT_PRESENT;
+
+  if (!present)
+  {
+    memset(&rx[1], SIM_BME280_NOT_PRESENT, dataSize);
+    return;
+  }
+
+  if ((uint16_t)reg + dataSize > SIM_REG_PRESS_MSB)
+  {
+    updateOutputRegisters();
+  }
+
+  for (uint16_t i = 0; i < dataSize; i++)
+  {
+    rx[1U + i] = registers[(uint8_t)(reg + i)];
+  }
+}
+
+/* BME280 port --------------------------------------------------------------*/
+
+bool BME280_HAL_SPI_Write(uint8_t reg, uint8_t *data, uint16_t size)
+{
+  chargeTransfer(size);
+
+  // Nothing acknowledges an SPI write: a missing sensor only shows on reads
+  if (!present)
+  {
+    return true;
+  }
+
+  for (uint16_t i = 0; i < size; i++)
+  {
+    registers[(uint8_t)(reg + i)] = data[i];
+  }
+
+  // Soft reset: registers read back 0, the control settings are lost and the conversions restart once configured
+  if (reg == BME280_RESET_REG && data[0] == BME280_RESET_WORD)
+  {
+    stuck = false;
+    resetControl();
+  }
+
+  return true;
+}
+
+bool BME280_HAL_SPI_Read(uint8_t reg, uint8_t *data, uint16_t size)
+{
+  chargeTransfer(size);
+
+  if (!present)
+  {
+    memset(data, SIM_BME280_NOT_PRESENT, size);
+    return true;
+  }
+
+  if ((uint16_t)reg + size > SIM_REG_PRESS_MSB)
+  {
+    updateOutputRegisters();
+  }
+
+  // Burst read, the address auto-increments
+  for (uint16_t i = 0; i < size; i++)
+  {
+    data[i] = registers[(uint8_t)(reg + i)];
+  }
+
+  return true;
+}
+
+void BME280_HAL_Delay(uint32_t delay)
+{
+  HAL_Delay(delay);
+}
+
+void BME280_HAL_Blink(Led_TypeDef Led)
+{
+  BSP_LED_Toggle(Led);
+}
@@ -0,0 +1,93 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+
+#include "sim.h"
+#include "API_app.h"
+
+/* Private constants ---------------------------------------------------------*/
+
+#define SIM_LOOP_STEP_US 1000U   // Super loop granularity: delayRead is polled once per virtual millisecond
+#define SIM_DELAY_SYS_MS 50U     // DELAYsys in Core/Src/main.c
+#define SIM_STACK_BUDGET 0x1000U // _Min_Stack_Size in STM32F429ZITX_FLASH.ld
+
+/* Public variables ----------------------------------------------------------*/
+
+// Handles defined by Core/Src/main.c on the target
+delay_t delaySys;
+I2C_HandleTypeDef hi2c1;
+SPI_HandleTypeDef hspi1;
+RTC_HandleTypeDef hrtc;
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Fatal errors of the firmware stop the simulation instead of spinning forever.
+ * @param  None
+ * @retval None
+ */
+void Error_Handler(void)
+{
+  fprintf(stderr, "Error_Handler at %llu ms\n", (unsigned long long)(SIM_TIME_NowUs() / SIM_US_PER_MS));
+  exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief  Stack painting needs the target memory map (API_stack.c is not built for the host): no-op.
+ * @param  None
+ * @retval None
+ */
+void API_STACK_Paint(void)
+{
+}
+
+/**
+ * @brief  Reports the target budget and no measured use: host stack depth says nothing about the target.
+ * @param  usage: Filled with the budget, capacity and a zero peak.
+ * @retval bool: Always true.
+ */
+bool API_STACK_GetUsage(stackUsage_t *usage)
+{
+  usage->budget = SIM_STACK_BUDGET;
+  usage->capacity = SIM_STACK_BUDGET;
+  usage->peak = 0;
+
+  return true;
+}
+
+/**
+ * @brief  Core/Src/main.c from the BSP initialisation on, with the RTC handle settings of MX_RTC_Init.
+ * @param  None
+ * @retval None
+ */
+void SIM_BOARD_Init(void)
+{
+  hrtc.Instance = RTC;
+  hrtc.Init.AsynchPrediv = CLOCK_RTC_ASYNCH_PREDIV;
+  hrtc.Init.SynchPrediv = CLOCK_RTC_SYNCH_PREDIV;
+
+  BSP_LED_Init(LED1);
+  BSP_LED_Init(LED2);
+  BSP_LED_Init(LED3);
+  delayInit(&delaySys, SIM_DELAY_SYS_MS);
+  APP_init();
+}
+
+/**
+ * @brief  One pass of the super loop, then one virtual millisecond.
+ * @param  None
+ * @retval bool: true if APP_update ran.
+ */
+bool SIM_BOARD_Step(void)
+{
+  bool updated = false;
+
+  if (delayRead(&delaySys))
+  {
+    APP_update();
+    BSP_LED_Toggle(LED1);
+    updated = true;
+  }
+  SIM_TIME_AdvanceUs(SIM_LOOP_STEP_US);
+
+  return updated;
+}
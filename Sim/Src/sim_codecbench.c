@@ -0,0 +1,758 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "API_app.h" /* <- APP_CODEC_* telemetry framing */
+#include "API_codec.h"
+#include "sim_check.h"
+
+/*
+ * API_codec.h sample stream codec: a host encoder and decoder of the "Z:<base64>" telemetry lines, edge cases,
+ * compression ratio on synthetic and recorded traces, then throughput.
+ *
+ *   sim_codecbench [-t trace.csv] [-n samples]
+ *   sim_codecbench -d uart.txt
+ *
+ *   -t  Recorded environment trace, "ms,temperature,humidity" per line ('#' lines are comments), encoded as well.
+ *   -n  Samples per throughput run, default 10 million.
+ *   -d  Decodes the "Z:" lines of a UART capture (APP_UART_COMPRESSED 1) to "ms,temperature,humidity" on stdout,
+ *       other lines are skipped. Exit status 1 on a malformed line.
+ *
+ * Host encoder: the framing of APP_uartSendCompressed, a sample count byte then up to APP_CODEC_BLOCK_SAMPLES
+ * samples in APP_CODEC_PACKET_SIZE bytes, millisecond tick and hundredths, base64 with "Z:" and CRLF. Host decoder:
+ * every line on its own from a fresh decoder state, which is what block resets buy, and the decoded samples must
+ * equal the encoded ones bit for bit.
+ *
+ * Edge cases: invalid channel counts, a destination too small (nothing written, state unchanged), truncated input
+ * at every length, full-range values and jumps, a tick wrapping past 2^32, base64 against the RFC 4648 vectors.
+ *
+ * Traces: one hour at the filter output period (APP_CODEC_BLOCK_SAMPLES per 5 s), a slow swing of both channels:
+ * steady, with tick jitter, and with 0.05 rms noise; a full-range random trace for correctness only. Per trace:
+ * encoded bytes per sample, line bytes per sample, and the text lines the same samples cost when every one is
+ * reported ("Temperature: 22.5 C" and "Humidity: 55.0 %"), next to a fixed 12-byte record.
+ * The steady trace must stay under CODECBENCH_MAX_STEADY_BYTES encoded bytes per sample.
+ *
+ * Throughput: ns per encoded and decoded sample, host wall time, compare runs on one machine only.
+ *
+ * Exit status 1 if any check fails.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define CODECBENCH_DEFAULT_SAMPLES 10000000U
+#define CODECBENCH_PERIOD_MS 200U              // Filter output period: APP_CODEC_BLOCK_SAMPLES per 5 s block
+#define CODECBENCH_TRACE_SAMPLES 18000U        // One hour
+#define CODECBENCH_MAX_TRACE_SAMPLES 1000000U  // Recorded trace limit
+#define CODECBENCH_JITTER_MS 3                 // Super loop tick jitter, either side
+#define CODECBENCH_NOISE_RMS 5.0               // 0.05 C and 0.05 %
+#define CODECBENCH_TEMP_BASE 2200              // 22.00 C
+#define CODECBENCH_TEMP_SWING 150.0            // 1.5 C peak
+#define CODECBENCH_HUM_BASE 5500               // 55.00 %
+#define CODECBENCH_HUM_SWING 400.0             // 4 % peak
+#define CODECBENCH_SWING_PERIOD_MS 3600000.0
+#define CODECBENCH_FIXED_RECORD_SIZE 12U       // uint32_t tick and two int32_t values
+#define CODECBENCH_MAX_STEADY_BYTES 4.0        // Encoded bytes per steady sample, count byte included
+#define CODECBENCH_LINE_SIZE 512U
+#define CODECBENCH_NS_PER_SECOND 1e9
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief One telemetry sample, as APP_uartSendCompressed encodes it.
+ */
+typedef struct
+{
+  uint32_t tick;                       // ms
+  int32_t values[APP_CODEC_CHANNELS]; // Temperature and humidity, hundredths
+} codecSample_t;
+
+/**
+ * @brief Samples of one trace.
+ */
+typedef struct
+{
+  codecSample_t *samples;
+  uint32_t count;
+} codecTrace_t;
+
+/**
+ * @brief Encoded size of one trace.
+ */
+typedef struct
+{
+  uint32_t lines;
+  uint64_t packetBytes; // Count byte and encoded samples
+  uint64_t lineBytes;   // "Z:", base64 and CRLF
+  uint64_t textBytes;   // Text lines of the same samples
+} codecSize_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+static volatile uint32_t sink; // Keeps the timed results alive
+
+/* Private Function Prototypes ---------------------------------------------- */
+static double nowNs(void);
+static double noise(void);
+static int8_t base64Value(char c);
+static int32_t fromBase64(const char *in, uint8_t *out, uint16_t size);
+static char *encodeLines(const codecTrace_t *trace, codecSize_t *size);
+static int32_t decodeLine(const char *line, codecSample_t *out, uint32_t room);
+static uint32_t textSize(int32_t hundredths, const char *tag, const char *unit);
+static codecTrace_t makeTrace(uint32_t count, int32_t jitterMs, double noiseRms);
+static codecTrace_t makeRandomTrace(uint32_t count);
+static bool loadTrace(const char *path, codecTrace_t *trace);
+static void runTrace(const char *name, const codecTrace_t *trace, double maxPacketBytes);
+static void checkEdges(void);
+static void checkBase64(void);
+static void runThroughput(const codecTrace_t *trace, uint32_t samples);
+static int decodeCapture(const char *path);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Monotonic host time.
+ * @param  None
+ * @retval double: ns.
+ */
+static double nowNs(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec * CODECBENCH_NS_PER_SECOND + (double)now.tv_nsec;
+}
+
+/**
+ * @brief  Gaussian noise of unit variance (Box-Muller), from the seeded C library generator so every run sees
+ *         the same trace.
+ * @param  None
+ * @retval double: Noise.
+ */
+static double noise(void)
+{
+  double u1 = ((double)rand() + 1.0) / ((double)RAND_MAX + 2.0);
+  double u2 = ((double)rand() + 1.0) / ((double)RAND_MAX + 2.0);
+
+  return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+/**
+ * @brief  Value of a base64 character.
+ * @param  char c: Character.
+ * @retval int8_t: 0..63, -1 if not in the alphabet.
+ */
+static int8_t base64Value(char c)
+{
+  if (c >= 'A' && c <= 'Z')
+  {
+    return (int8_t)(c - 'A');
+  }
+  if (c >= 'a' && c <= 'z')
+  {
+    return (int8_t)(c - 'a' + 26);
+  }
+  if (c >= '0' && c <= '9')
+  {
+    return (int8_t)(c - '0' + 52);
+  }
+  if (c == '+')
+  {
+    return 62;
+  }
+  if (c == '/')
+  {
+    return 63;
+  }
+
+  return -1;
+}
+
+/**
+ * @brief  Decodes padded base64 text, up to the first character outside the alphabet and padding.
+ * @param  const char *in: Text.
+ * @param  uint8_t *out: Destination.
+ * @param  uint16_t size: Destination size.
+ * @retval int32_t: Bytes decoded, -1 on a malformed group or a destination too small.
+ */
+static int32_t fromBase64(const char *in, uint8_t *out, uint16_t size)
+{
+  int32_t length = 0;
+
+  while (base64Value(in[0]) >= 0)
+  {
+    int8_t a = base64Value(in[0]);
+    int8_t b = base64Value(in[1]);
+    int8_t c = (in[2] == '=') ? 0 : base64Value(in[2]);
+    int8_t d = (in[3] == '=') ? 0 : base64Value(in[3]);
+    uint8_t available = (in[2] == '=') ? 1U : (in[3] == '=') ? 2U : 3U;
+    uint32_t group;
+
+    if (b < 0 || c < 0 || d < 0 || (in[2] == '=' && in[3] != '=') || length + available > size)
+    {
+      return -1;
+    }
+
+    group = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | (uint32_t)d;
+    out[length++] = (uint8_t)(group >> 16);
+    if (available > 1U)
+    {
+      out[length++] = (uint8_t)(group >> 8);
+    }
+    if (available > 2U)
+    {
+      out[length++] = (uint8_t)group;
+    }
+
+    in += 4;
+    if (available < 3U)
+    {
+      break;
+    }
+  }
+
+  return length;
+}
+
+/**
+ * @brief  Host encoder: the telemetry lines APP_uartSendCompressed sends for a trace.
+ * @param  const codecTrace_t *trace: Samples.
+ * @param  codecSize_t *size: Encoded size and the text size of the same samples.
+ * @retval char *: Lines, malloc'ed, NULL on failure.
+ */
+static char *encodeLines(const codecTrace_t *trace, codecSize_t *size)
+{
+  size_t capacity = ((size_t)trace->count + 1U) * APP_CODEC_LINE_SIZE;
+  char *lines = malloc(capacity);
+  size_t used = 0;
+  codecState_t state;
+  uint8_t packet[APP_CODEC_PACKET_SIZE];
+  uint16_t packetLength = APP_CODEC_HEADER_SIZE;
+
+  memset(size, 0, sizeof(*size));
+  if (lines == NULL)
+  {
+    return NULL;
+  }
+  lines[0] = '\0';
+  API_CODEC_Reset(&state, APP_CODEC_CHANNELS);
+
+  for (uint32_t i = 0; i <= trace->count; i++)
+  {
+    uint16_t written = 0;
+
+    if (i < trace->count)
+    {
+      const codecSample_t *sample = &trace->samples[i];
+
+      written = API_CODEC_EncodeSample(&state, sample->tick, sample->values, packet + packetLength,
+                                       (uint16_t)(sizeof(packet) - packetLength));
+      size->textBytes += textSize(sample->values[0], "Temperature: ", "C") + textSize(sample->values[1], "Humidity: ", "%");
+    }
+
+    // Block full, at its sample count or at the end of the trace: one line, then a fresh block
+    if (state.count > 0U && (written == 0U || state.count >= APP_CODEC_BLOCK_SAMPLES))
+    {
+      if (written != 0U)
+      {
+        packetLength += written;
+      }
+      packet[0] = (uint8_t)state.count;
+      used += (size_t)sprintf(lines + used, "Z:");
+      used += API_CODEC_ToBase64(packet, packetLength, lines + used, APP_CODEC_LINE_SIZE);
+      used += (size_t)sprintf(lines + used, "\r\n");
+      size->lines++;
+      size->packetBytes += packetLength;
+
+      API_CODEC_Reset(&state, APP_CODEC_CHANNELS);
+      packetLength = APP_CODEC_HEADER_SIZE;
+      if (written == 0U && i < trace->count)
+      {
+        i--; // Encode the sample again into the fresh block
+      }
+    }
+    else
+    {
+      packetLength += written;
+    }
+  }
+  size->lineBytes = used;
+
+  return lines;
+}
+
+/**
+ * @brief  Host decoder: one "Z:" line, from a fresh decoder state.
+ * @param  const char *line: Line, from "Z:".
+ * @param  codecSample_t *out: Decoded samples.
+ * @param  uint32_t room: Room in out.
+ * @retval int32_t: Samples decoded, -1 if the line is malformed or out too small.
+ */
+static int32_t decodeLine(const char *line, codecSample_t *out, uint32_t room)
+{
+  uint8_t packet[APP_CODEC_PACKET_SIZE];
+  int32_t length;
+  uint16_t offset = APP_CODEC_HEADER_SIZE;
+  codecState_t state;
+
+  if (strncmp(line, "Z:", 2) != 0)
+  {
+    return -1;
+  }
+  length = fromBase64(line + 2, packet, sizeof(packet));
+  if (length < (int32_t)APP_CODEC_HEADER_SIZE || packet[0] == 0U || packet[0] > room)
+  {
+    return -1;
+  }
+
+  API_CODEC_Reset(&state, APP_CODEC_CHANNELS);
+  for (uint8_t i = 0; i < packet[0]; i++)
+  {
+    uint16_t consumed = API_CODEC_DecodeSample(&state, packet + offset, (uint16_t)(length - offset), &out[i].tick,
+                                               out[i].values);
+    if (consumed == 0U)
+    {
+      return -1;
+    }
+    offset += consumed;
+  }
+
+  // Every byte belongs to a sample
+  return (offset == length) ? packet[0] : -1;
+}
+
+/**
+ * @brief  Length of the text line APP_uartPrepareData builds for a value.
+ * @param  int32_t hundredths: Value.
+ * @param  const char *tag: Line tag.
+ * @param  const char *unit: Unit.
+ * @retval uint32_t: Bytes.
+ */
+static uint32_t textSize(int32_t hundredths, const char *tag, const char *unit)
+{
+  char line[CODECBENCH_LINE_SIZE];
+
+  // Integer part, '.', fraction without leading zeros, as itoa writes them
+  return (uint32_t)snprintf(line, sizeof(line), "%s%d.%d %s\r\n", tag, (int)(hundredths / 100),
+                            abs((int)(hundredths % 100)), unit);
+}
+
+/**
+ * @brief  Synthetic trace at the filter output period: a slow swing of both channels.
+ * @param  uint32_t count: Samples.
+ * @param  int32_t jitterMs: Tick jitter either side, 0 for a steady period.
+ * @param  double noiseRms: Noise added to both channels, hundredths.
+ * @retval codecTrace_t: Trace, malloc'ed.
+ */
+static codecTrace_t makeTrace(uint32_t count, int32_t jitterMs, double noiseRms)
+{
+  codecTrace_t trace = {malloc((size_t)count * sizeof(codecSample_t)), count};
+
+  srand(1);
+  for (uint32_t i = 0; i < count && trace.samples != NULL; i++)
+  {
+    uint32_t ms = i * CODECBENCH_PERIOD_MS;
+    double phase = 2.0 * M_PI * ms / CODECBENCH_SWING_PERIOD_MS;
+    int32_t jitter = (jitterMs > 0) ? rand() % (2 * jitterMs + 1) - jitterMs : 0;
+
+    trace.samples[i].tick = ms + (uint32_t)jitter;
+    trace.samples[i].values[0] = (int32_t)lround(CODECBENCH_TEMP_BASE + CODECBENCH_TEMP_SWING * sin(phase) + noiseRms * noise());
+    trace.samples[i].values[1] = (int32_t)lround(CODECBENCH_HUM_BASE - CODECBENCH_HUM_SWING * sin(phase) + noiseRms * noise());
+  }
+
+  return trace;
+}
+
+/**
+ * @brief  Full-range trace: random ticks steps that wrap past 2^32, random values of any magnitude.
+ * @param  uint32_t count: Samples.
+ * @retval codecTrace_t: Trace, malloc'ed.
+ */
+static codecTrace_t makeRandomTrace(uint32_t count)
+{
+  codecTrace_t trace = {malloc((size_t)count * sizeof(codecSample_t)), count};
+  uint32_t tick = UINT32_MAX - count / 2U * CODECBENCH_PERIOD_MS;
+
+  srand(2);
+  for (uint32_t i = 0; i < count && trace.samples != NULL; i++)
+  {
+    tick += (uint32_t)rand() % (2U * CODECBENCH_PERIOD_MS);
+    trace.samples[i].tick = tick;
+    for (uint32_t channel = 0; channel < APP_CODEC_CHANNELS; channel++)
+    {
+      trace.samples[i].values[channel] = (int32_t)(((uint32_t)rand() << 16) ^ (uint32_t)rand() ^ ((uint32_t)rand() << 31));
+    }
+  }
+
+  return trace;
+}
+
+/**
+ * @brief  Recorded environment trace, values rounded to hundredths as APP_uartSendCompressed does.
+ * @param  const char *path: "ms,temperature,humidity" CSV.
+ * @param  codecTrace_t *trace: Trace, malloc'ed.
+ * @retval bool: true if the file was read.
+ */
+static bool loadTrace(const char *path, codecTrace_t *trace)
+{
+  FILE *in = fopen(path, "r");
+  char line[CODECBENCH_LINE_SIZE];
+
+  if (in == NULL)
+  {
+    perror(path);
+    return false;
+  }
+
+  trace->samples = malloc(CODECBENCH_MAX_TRACE_SAMPLES * sizeof(codecSample_t));
+  trace->count = 0;
+  while (trace->samples != NULL && trace->count < CODECBENCH_MAX_TRACE_SAMPLES && fgets(line, sizeof(line), in) != NULL)
+  {
+    unsigned long ms;
+    float temperature;
+    float humidity;
+
+    if (line[0] == '#' || sscanf(line, "%lu,%f,%f", &ms, &temperature, &humidity) != 3)
+    {
+      continue;
+    }
+    trace->samples[trace->count].tick = (uint32_t)ms;
+    trace->samples[trace->count].values[0] = (int32_t)lroundf(temperature * FRACTIONAL_MULTIPLIER);
+    trace->samples[trace->count].values[1] = (int32_t)lroundf(humidity * FRACTIONAL_MULTIPLIER);
+    trace->count++;
+  }
+  fclose(in);
+
+  return trace->samples != NULL;
+}
+
+/**
+ * @brief  Encodes a trace to telemetry lines, decodes them back line by line and prints the sizes.
+ * @param  const char *name: Trace name.
+ * @param  const codecTrace_t *trace: Samples.
+ * @param  double maxPacketBytes: Encoded bytes per sample not to exceed, 0 for no bound.
+ * @retval None
+ */
+static void runTrace(const char *name, const codecTrace_t *trace, double maxPacketBytes)
+{
+  uint32_t failuresBefore = failures;
+  codecSize_t size;
+  char *lines = encodeLines(trace, &size);
+  codecSample_t *decoded = malloc(((size_t)trace->count + APP_CODEC_BLOCK_SAMPLES) * sizeof(codecSample_t));
+  uint32_t count = 0;
+  bool wellFormed = true;
+
+  if (lines == NULL || decoded == NULL || trace->count == 0U)
+  {
+    check(false, "trace encoded");
+    free(lines);
+    free(decoded);
+    return;
+  }
+
+  for (char *line = strtok(lines, "\r\n"); line != NULL; line = strtok(NULL, "\r\n"))
+  {
+    int32_t samples = decodeLine(line, decoded + count, trace->count + APP_CODEC_BLOCK_SAMPLES - count);
+
+    wellFormed = wellFormed && samples > 0;
+    count += (samples > 0) ? (uint32_t)samples : 0U;
+  }
+  check(wellFormed, "every line decodes on its own");
+  check(count == trace->count && memcmp(decoded, trace->samples, count * sizeof(codecSample_t)) == 0,
+        "decoded samples equal the encoded ones");
+
+  double packetPerSample = (double)size.packetBytes / trace->count;
+  double linePerSample = (double)size.lineBytes / trace->count;
+  double textPerSample = (double)size.textBytes / trace->count;
+  if (maxPacketBytes > 0.0)
+  {
+    check(packetPerSample <= maxPacketBytes, "encoded size within bound");
+  }
+
+  printf("%s: %u samples in %u lines, %.2f B/sample encoded, %.2f B/sample as lines; text %.2f B/sample "
+         "(%.1fx), fixed record %u B/sample (%.1fx)\n",
+         name, trace->count, size.lines, packetPerSample, linePerSample, textPerSample, textPerSample / linePerSample,
+         CODECBENCH_FIXED_RECORD_SIZE, CODECBENCH_FIXED_RECORD_SIZE / packetPerSample);
+  checkSection(failuresBefore);
+
+  free(lines);
+  free(decoded);
+}
+
+/**
+ * @brief  Channel counts, short destinations, truncated input, full-range values and a wrapping tick.
+ * @param  None
+ * @retval None
+ */
+static void checkEdges(void)
+{
+  uint32_t failuresBefore = failures;
+  codecState_t encoder;
+  codecState_t decoder;
+  codecState_t before;
+  uint8_t out[CODEC_MAX_SAMPLE_SIZE(CODEC_MAX_CHANNELS)];
+  int32_t extremes[CODEC_MAX_CHANNELS] = {INT32_MIN, INT32_MAX, INT32_MIN, INT32_MAX};
+  int32_t flipped[CODEC_MAX_CHANNELS] = {INT32_MAX, INT32_MIN, INT32_MAX, INT32_MIN};
+  int32_t values[CODEC_MAX_CHANNELS];
+  uint32_t tick;
+  uint16_t length;
+
+  check(!API_CODEC_Reset(&encoder, 0) && !API_CODEC_Reset(&encoder, CODEC_MAX_CHANNELS + 1U) &&
+            !API_CODEC_Reset(NULL, 1),
+        "invalid channel counts refused");
+
+  // Widest first sample: every varint at its maximum size
+  API_CODEC_Reset(&encoder, CODEC_MAX_CHANNELS);
+  before = encoder;
+  check(API_CODEC_EncodeSample(&encoder, UINT32_MAX, extremes, out, CODEC_MAX_SAMPLE_SIZE(CODEC_MAX_CHANNELS) - 1U) == 0U &&
+            memcmp(&encoder, &before, sizeof(before)) == 0,
+        "short destination: nothing written, state unchanged");
+  length = API_CODEC_EncodeSample(&encoder, UINT32_MAX, extremes, out, sizeof(out));
+  check(length == CODEC_MAX_SAMPLE_SIZE(CODEC_MAX_CHANNELS), "widest sample takes CODEC_MAX_SAMPLE_SIZE");
+
+  API_CODEC_Reset(&decoder, CODEC_MAX_CHANNELS);
+  for (uint16_t size = 0; size < length; size++)
+  {
+    before = decoder;
+    check(API_CODEC_DecodeSample(&decoder, out, size, &tick, values) == 0U, "truncated sample refused");
+    decoder = before; // A refused sample may have updated part of the state, the caller drops the block
+  }
+  check(API_CODEC_DecodeSample(&decoder, out, length, &tick, values) == length && tick == UINT32_MAX &&
+            memcmp(values, extremes, sizeof(values)) == 0,
+        "full-range first sample round trip");
+
+  // Full-range jumps either way, the tick wrapping past 2^32 with a changing period
+  for (uint32_t i = 0; i < 4U; i++)
+  {
+    const int32_t *next = (i % 2U == 0U) ? flipped : extremes;
+    uint32_t nextTick = UINT32_MAX + (i + 1U) * (i + 1U) * CODECBENCH_PERIOD_MS;
+
+    length = API_CODEC_EncodeSample(&encoder, nextTick, next, out, sizeof(out));
+    check(length != 0U && API_CODEC_DecodeSample(&decoder, out, length, &tick, values) == length &&
+              tick == nextTick && memcmp(values, next, sizeof(values)) == 0,
+          "full-range jump and wrapping tick round trip");
+  }
+
+  // Steady period and value: one byte per number
+  API_CODEC_Reset(&encoder, 1);
+  values[0] = 2200;
+  for (uint32_t i = 0; i < 3U; i++)
+  {
+    length = API_CODEC_EncodeSample(&encoder, 1000U + i * CODECBENCH_PERIOD_MS, values, out, sizeof(out));
+  }
+  check(length == 2U, "steady sample costs one byte per number");
+
+  printf("edge cases\n");
+  checkSection(failuresBefore);
+}
+
+/**
+ * @brief  API_CODEC_ToBase64 against the RFC 4648 test vectors, and the host decoder back.
+ * @param  None
+ * @retval None
+ */
+static void checkBase64(void)
+{
+  static const char *const vectors[][2] = {
+      {"", ""},         {"f", "Zg=="},         {"fo", "Zm8="},        {"foo", "Zm9v"},
+      {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="}, {"foobar", "Zm9vYmFy"},
+  };
+  uint32_t failuresBefore = failures;
+  char text[CODEC_BASE64_SIZE(6U) + 1U];
+  uint8_t bytes[6];
+
+  for (uint32_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++)
+  {
+    uint16_t length = (uint16_t)strlen(vectors[i][0]);
+
+    check(API_CODEC_ToBase64((const uint8_t *)vectors[i][0], length, text, sizeof(text)) == strlen(vectors[i][1]) &&
+              strcmp(text, vectors[i][1]) == 0,
+          "RFC 4648 vector");
+    check(fromBase64(text, bytes, sizeof(bytes)) == length && memcmp(bytes, vectors[i][0], length) == 0,
+          "host decoder inverts the vector");
+    check(API_CODEC_ToBase64((const uint8_t *)vectors[i][0], length, text, (uint16_t)CODEC_BASE64_SIZE(length)) == 0U,
+          "destination without room for the terminator refused");
+  }
+
+  printf("base64\n");
+  checkSection(failuresBefore);
+}
+
+/**
+ * @brief  Encode and decode cost per sample on a trace, blocks of APP_CODEC_BLOCK_SAMPLES.
+ * @param  const codecTrace_t *trace: Samples, cycled over.
+ * @param  uint32_t samples: Samples per run.
+ * @retval None
+ */
+static void runThroughput(const codecTrace_t *trace, uint32_t samples)
+{
+  uint8_t packets[CODECBENCH_TRACE_SAMPLES / APP_CODEC_BLOCK_SAMPLES][APP_CODEC_PACKET_SIZE];
+  uint16_t lengths[CODECBENCH_TRACE_SAMPLES / APP_CODEC_BLOCK_SAMPLES] = {0};
+  uint32_t blocks = trace->count / APP_CODEC_BLOCK_SAMPLES;
+  codecState_t state;
+  uint32_t tick;
+  int32_t values[APP_CODEC_CHANNELS];
+
+  if (blocks == 0U || blocks > CODECBENCH_TRACE_SAMPLES / APP_CODEC_BLOCK_SAMPLES)
+  {
+    return;
+  }
+  samples -= samples % APP_CODEC_BLOCK_SAMPLES;
+
+  double start = nowNs();
+  for (uint32_t i = 0; i < samples; i++)
+  {
+    uint32_t index = i % (blocks * APP_CODEC_BLOCK_SAMPLES);
+    uint32_t block = index / APP_CODEC_BLOCK_SAMPLES;
+
+    if (index % APP_CODEC_BLOCK_SAMPLES == 0U)
+    {
+      API_CODEC_Reset(&state, APP_CODEC_CHANNELS);
+      lengths[block] = 0;
+    }
+    lengths[block] += API_CODEC_EncodeSample(&state, trace->samples[index].tick, trace->samples[index].values,
+                                             packets[block] + lengths[block], (uint16_t)(APP_CODEC_PACKET_SIZE - lengths[block]));
+  }
+  double encodeNs = (nowNs() - start) / samples;
+
+  start = nowNs();
+  for (uint32_t i = 0; i < samples / APP_CODEC_BLOCK_SAMPLES; i++)
+  {
+    uint32_t block = i % blocks;
+    uint16_t offset = 0;
+
+    API_CODEC_Reset(&state, APP_CODEC_CHANNELS);
+    for (uint32_t j = 0; j < APP_CODEC_BLOCK_SAMPLES; j++)
+    {
+      offset += API_CODEC_DecodeSample(&state, packets[block] + offset, (uint16_t)(lengths[block] - offset), &tick, values);
+      sink += tick;
+    }
+  }
+  double decodeNs = (nowNs() - start) / samples;
+
+  printf("throughput: %u samples, %.1f ns per encoded sample, %.1f ns per decoded sample\n", samples, encodeNs,
+         decodeNs);
+}
+
+/**
+ * @brief  Decodes the "Z:" lines of a UART capture to CSV on stdout.
+ * @param  const char *path: Capture.
+ * @retval int: Exit status.
+ */
+static int decodeCapture(const char *path)
+{
+  FILE *in = fopen(path, "r");
+  char line[CODECBENCH_LINE_SIZE];
+  codecSample_t samples[APP_CODEC_PACKET_SIZE]; // Every sample takes at least one byte
+  uint32_t lineNumber = 0;
+  int status = EXIT_SUCCESS;
+
+  if (in == NULL)
+  {
+    perror(path);
+    return EXIT_FAILURE;
+  }
+
+  printf("# ms,temperature,humidity\n");
+  while (fgets(line, sizeof(line), in) != NULL)
+  {
+    lineNumber++;
+    if (strncmp(line, "Z:", 2) != 0)
+    {
+      continue;
+    }
+
+    int32_t count = decodeLine(line, samples, APP_CODEC_PACKET_SIZE);
+    if (count < 0)
+    {
+      fprintf(stderr, "%s:%u: malformed block\n", path, lineNumber);
+      status = EXIT_FAILURE;
+      continue;
+    }
+    for (int32_t i = 0; i < count; i++)
+    {
+      printf("%u,%.2f,%.2f\n", samples[i].tick, samples[i].values[0] / (double)FRACTIONAL_MULTIPLIER,
+             samples[i].values[1] / (double)FRACTIONAL_MULTIPLIER);
+    }
+  }
+  fclose(in);
+
+  return status;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+  uint32_t samples = CODECBENCH_DEFAULT_SAMPLES;
+  const char *tracePath = NULL;
+  const char *capturePath = NULL;
+  int option;
+
+  while ((option = getopt(argc, argv, "t:n:d:")) != -1)
+  {
+    switch (option)
+    {
+    case 't':
+      tracePath = optarg;
+      break;
+    case 'n':
+      samples = (uint32_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'd':
+      capturePath = optarg;
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-t trace.csv] [-n samples] | -d uart.txt\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (capturePath != NULL)
+  {
+    return decodeCapture(capturePath);
+  }
+
+  checkEdges();
+  checkBase64();
+
+  codecTrace_t steady = makeTrace(CODECBENCH_TRACE_SAMPLES, 0, 0.0);
+  codecTrace_t jitter = makeTrace(CODECBENCH_TRACE_SAMPLES, CODECBENCH_JITTER_MS, 0.0);
+  codecTrace_t noisy = makeTrace(CODECBENCH_TRACE_SAMPLES, CODECBENCH_JITTER_MS, CODECBENCH_NOISE_RMS);
+  codecTrace_t fullRange = makeRandomTrace(CODECBENCH_TRACE_SAMPLES);
+  runTrace("steady", &steady, CODECBENCH_MAX_STEADY_BYTES);
+  runTrace("jitter", &jitter, 0.0);
+  runTrace("noisy", &noisy, 0.0);
+  runTrace("full range", &fullRange, 0.0);
+
+  if (tracePath != NULL)
+  {
+    codecTrace_t recorded;
+
+    if (!loadTrace(tracePath, &recorded))
+    {
+      return EXIT_FAILURE;
+    }
+    runTrace(tracePath, &recorded, 0.0);
+    free(recorded.samples);
+  }
+
+  runThroughput(&noisy, samples);
+
+  free(steady.samples);
+  free(jitter.samples);
+  free(noisy.samples);
+  free(fullRange.samples);
+
+  if (failures != 0U)
+  {
+    printf("FAIL: %u checks\n", failures);
+    return EXIT_FAILURE;
+  }
+
+  printf("OK: codec round trips and sizes\n");
+  return EXIT_SUCCESS;
+}
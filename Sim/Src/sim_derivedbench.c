@@ -0,0 +1,340 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "API_derived.h"
+
+/*
+ * API_derived.h fixed-point channels against the same formulas in double precision: accuracy, then throughput.
+ *
+ *   sim_derivedbench [-n calls]
+ *
+ *   -n  Calls per throughput run, default 10 million.
+ *
+ * Accuracy: every 0.05 C from -40 to 85 C and every 1/16 %RH from 0 to 100 %RH, the three channels computed
+ * without the cache against the Magnus formula with log and exp, the ideal gas absolute humidity and the NWS
+ * heat index. Maximum and RMS error in the channel units, and where the maximum is. The cache is checked
+ * along: a second request for the same sequence must be reused and equal.
+ *
+ * Throughput: each channel computed, each channel from the cache and each double precision reference, over a
+ * table of pseudo-random samples, in ns per call. Host wall time, compare runs on one machine only.
+ *
+ * Exit status 1 if an error exceeds its DERIVED_*_MAX_ERROR bound or the cache returns a different value.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define DERIVEDBENCH_DEFAULT_CALLS 10000000U
+#define DERIVEDBENCH_TEMPERATURE_FROM (-4000) // 0.01 C
+#define DERIVEDBENCH_TEMPERATURE_TO 8500
+#define DERIVEDBENCH_TEMPERATURE_STEP 5
+#define DERIVEDBENCH_HUMIDITY_TO 102400U // 100 %RH in Q22.10
+#define DERIVEDBENCH_HUMIDITY_STEP 64U   // 1/16 %RH
+#define DERIVEDBENCH_SAMPLES 4096U       // Throughput inputs, a power of two
+#define DERIVEDBENCH_NS_PER_SECOND 1e9
+
+#define MAGNUS_A 611.2 // Pa
+#define MAGNUS_B 17.62
+#define MAGNUS_C 243.12          // C
+#define WATER_GAS_CONSTANT 461.5 // J/(kg K)
+#define ZERO_CELSIUS 273.15      // K
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  double maxError;
+  double sumSquares;
+  double maxTemperature; // Where the maximum is
+  double maxHumidity;
+} benchError_t;
+
+typedef enum
+{
+  BENCH_PATH_COMPUTED,  // API_DERIVED_Get, new sequence on every call
+  BENCH_PATH_CACHED,    // API_DERIVED_Get, one sequence
+  BENCH_PATH_REFERENCE, // Double precision
+  BENCH_PATH_COUNT,
+} benchPath_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+static derivedSample_t samples[DERIVEDBENCH_SAMPLES];
+static volatile double sink; // Keeps the timed results alive
+
+/* Private Function Prototypes ---------------------------------------------- */
+static double referenceVapourPressure(double temperature, double humidity);
+static double referenceDewPoint(double temperature, double humidity);
+static double referenceAbsoluteHumidity(double temperature, double humidity);
+static double referenceHeatIndex(double temperature, double humidity);
+static double reference(derivedChannel_t channel, double temperature, double humidity);
+static double nowNs(void);
+static double timeChannel(derivedChannel_t channel, benchPath_t path, uint32_t calls);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Vapour pressure RH x es(T), es from the Magnus formula.
+ * @param  double temperature: C.
+ * @param  double humidity: %RH.
+ * @retval double: Pa.
+ */
+static double referenceVapourPressure(double temperature, double humidity)
+{
+  return MAGNUS_A * exp(MAGNUS_B * temperature / (MAGNUS_C + temperature)) * humidity / 100.0;
+}
+
+/**
+ * @brief  Magnus dew point, saturated at the ends of the module's table.
+ * @param  double temperature: C.
+ * @param  double humidity: %RH.
+ * @retval double: C.
+ */
+static double referenceDewPoint(double temperature, double humidity)
+{
+  double pressure = referenceVapourPressure(temperature, humidity);
+
+  if (pressure <= referenceVapourPressure(DERIVED_TABLE_LOWEST_C, 100.0))
+  {
+    return DERIVED_TABLE_LOWEST_C;
+  }
+
+  double gamma = log(pressure / MAGNUS_A);
+  double dewPoint = MAGNUS_C * gamma / (MAGNUS_B - gamma);
+
+  return (dewPoint > DERIVED_TABLE_HIGHEST_C) ? DERIVED_TABLE_HIGHEST_C : dewPoint;
+}
+
+/**
+ * @brief  Absolute humidity of water vapour as an ideal gas.
+ * @param  double temperature: C.
+ * @param  double humidity: %RH.
+ * @retval double: g/m3.
+ */
+static double referenceAbsoluteHumidity(double temperature, double humidity)
+{
+  return 1000.0 * referenceVapourPressure(temperature, humidity) / (WATER_GAS_CONSTANT * (temperature + ZERO_CELSIUS));
+}
+
+/**
+ * @brief  NWS heat index: Steadman, or Rothfusz with its adjustments from 80 F.
+ * @param  double temperature: C.
+ * @param  double humidity: %RH.
+ * @retval double: C.
+ */
+static double referenceHeatIndex(double temperature, double humidity)
+{
+  double t = temperature * 1.8 + 32.0;
+  double r = humidity;
+  double index = 0.5 * (t + 61.0 + (t - 68.0) * 1.2 + r * 0.094);
+
+  if (index >= 80.0)
+  {
+    index = -42.379 + 2.04901523 * t + 10.14333127 * r - 0.22475541 * t * r - 0.00683783 * t * t -
+            0.05481717 * r * r + 0.00122874 * t * t * r + 0.00085282 * t * r * r - 0.00000199 * t * t * r * r;
+
+    if (r < 13.0 && t >= 80.0 && t <= 112.0)
+    {
+      index -= ((13.0 - r) / 4.0) * sqrt((17.0 - fabs(t - 95.0)) / 17.0);
+    }
+    else if (r > 85.0 && t >= 80.0 && t <= 87.0)
+    {
+      index += ((r - 85.0) / 10.0) * ((87.0 - t) / 5.0);
+    }
+  }
+
+  return (index - 32.0) / 1.8;
+}
+
+/**
+ * @brief  Reference value of a channel.
+ * @param  derivedChannel_t channel: Channel.
+ * @param  double temperature: C.
+ * @param  double humidity: %RH.
+ * @retval double: Value in the channel's unit, not scaled.
+ */
+static double reference(derivedChannel_t channel, double temperature, double humidity)
+{
+  switch (channel)
+  {
+  case DERIVED_CHANNEL_DEW_POINT:
+    return referenceDewPoint(temperature, humidity);
+  case DERIVED_CHANNEL_ABSOLUTE_HUMIDITY:
+    return referenceAbsoluteHumidity(temperature, humidity);
+  default:
+    return referenceHeatIndex(temperature, humidity);
+  }
+}
+
+/**
+ * @brief  Monotonic host time.
+ * @param  None
+ * @retval double: ns.
+ */
+static double nowNs(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec * DERIVEDBENCH_NS_PER_SECOND + (double)now.tv_nsec;
+}
+
+/**
+ * @brief  Times one channel along one path over the sample table.
+ * @param  derivedChannel_t channel: Channel.
+ * @param  benchPath_t path: Computed, cached or reference.
+ * @param  uint32_t calls: Calls.
+ * @retval double: ns per call.
+ */
+static double timeChannel(derivedChannel_t channel, benchPath_t path, uint32_t calls)
+{
+  double sum = 0.0;
+  int32_t value;
+
+  API_DERIVED_Init();
+  double start = nowNs();
+
+  for (uint32_t call = 0; call < calls; call++)
+  {
+    derivedSample_t *sample = &samples[call & (DERIVEDBENCH_SAMPLES - 1U)];
+
+    switch (path)
+    {
+    case BENCH_PATH_COMPUTED:
+      sample->sequence = call + 1U;
+      API_DERIVED_Get(sample, channel, &value);
+      sum += value;
+      break;
+    case BENCH_PATH_CACHED:
+      API_DERIVED_Get(&samples[0], channel, &value);
+      sum += value;
+      break;
+    default:
+      sum += reference(channel, sample->temperature / 100.0, sample->humidity / 1024.0);
+      break;
+    }
+  }
+
+  double elapsed = nowNs() - start;
+
+  sink = sum;
+  return elapsed / calls;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+  static const char *const channelNames[DERIVED_CHANNEL_COUNT] = {"dew point", "absolute", "heat index"};
+  static const char *const channelUnits[DERIVED_CHANNEL_COUNT] = {"C", "g/m3", "C"};
+  static const uint32_t bounds[DERIVED_CHANNEL_COUNT] = {
+    DERIVED_DEW_POINT_MAX_ERROR, DERIVED_ABSOLUTE_HUMIDITY_MAX_ERROR, DERIVED_HEAT_INDEX_MAX_ERROR};
+  benchError_t errors[DERIVED_CHANNEL_COUNT] = {0};
+  uint32_t calls = DERIVEDBENCH_DEFAULT_CALLS;
+  uint32_t points = 0;
+  uint32_t cacheErrors = 0;
+  int option;
+
+  while ((option = getopt(argc, argv, "n:")) != -1)
+  {
+    switch (option)
+    {
+    case 'n':
+      calls = (uint32_t)strtoul(optarg, NULL, 10);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-n calls]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  API_DERIVED_Init();
+  for (int32_t temperature = DERIVEDBENCH_TEMPERATURE_FROM; temperature <= DERIVEDBENCH_TEMPERATURE_TO;
+       temperature += DERIVEDBENCH_TEMPERATURE_STEP)
+  {
+    for (uint32_t humidity = 0; humidity <= DERIVEDBENCH_HUMIDITY_TO; humidity += DERIVEDBENCH_HUMIDITY_STEP)
+    {
+      derivedSample_t sample = {++points, temperature, humidity};
+      double celsius = temperature / 100.0;
+      double percent = humidity / 1024.0;
+
+      for (derivedChannel_t channel = 0; channel < DERIVED_CHANNEL_COUNT; channel++)
+      {
+        int32_t value;
+        int32_t again;
+
+        API_DERIVED_Get(&sample, channel, &value);
+        API_DERIVED_Get(&sample, channel, &again);
+        if (again != value)
+        {
+          cacheErrors++;
+        }
+
+        double error = fabs(value - reference(channel, celsius, percent) * 100.0);
+        benchError_t *channelError = &errors[channel];
+
+        channelError->sumSquares += error * error;
+        if (error > channelError->maxError)
+        {
+          channelError->maxError = error;
+          channelError->maxTemperature = celsius;
+          channelError->maxHumidity = percent;
+        }
+      }
+    }
+  }
+
+  derivedStats_t stats = API_DERIVED_GetStats();
+  if (stats.computed != points * DERIVED_CHANNEL_COUNT || stats.reused != points * DERIVED_CHANNEL_COUNT)
+  {
+    cacheErrors++;
+  }
+
+  bool withinBounds = true;
+  printf("accuracy %u points, -40 to 85 C, 0 to 100 %%RH, errors in 0.01 of the unit\n", points);
+  printf("%-11s %6s %8s %8s %6s %18s\n", "channel", "unit", "max", "rms", "bound", "max at");
+  for (derivedChannel_t channel = 0; channel < DERIVED_CHANNEL_COUNT; channel++)
+  {
+    benchError_t *channelError = &errors[channel];
+
+    printf("%-11s %6s %8.3f %8.3f %6u %8.2f C %5.2f %%\n", channelNames[channel], channelUnits[channel],
+           channelError->maxError, sqrt(channelError->sumSquares / points), bounds[channel],
+           channelError->maxTemperature, channelError->maxHumidity);
+    if (channelError->maxError > bounds[channel])
+    {
+      withinBounds = false;
+    }
+  }
+  printf("cache    %u computed, %u reused, %u mismatches\n", stats.computed, stats.reused, cacheErrors);
+
+  srand(1);
+  for (uint32_t i = 0; i < DERIVEDBENCH_SAMPLES; i++)
+  {
+    samples[i].temperature = DERIVEDBENCH_TEMPERATURE_FROM + rand() % (DERIVEDBENCH_TEMPERATURE_TO - DERIVEDBENCH_TEMPERATURE_FROM + 1);
+    samples[i].humidity = (uint32_t)rand() % (DERIVEDBENCH_HUMIDITY_TO + 1U);
+  }
+  samples[0].sequence = 1U;
+
+  printf("\n%-11s %10s %10s %10s\n", "ns/call", "computed", "cached", "double");
+  for (derivedChannel_t channel = 0; channel < DERIVED_CHANNEL_COUNT; channel++)
+  {
+    printf("%-11s", channelNames[channel]);
+    for (benchPath_t path = BENCH_PATH_COMPUTED; path < BENCH_PATH_COUNT; path++)
+    {
+      printf(" %10.1f", timeChannel(channel, path, calls));
+    }
+    printf("\n");
+  }
+
+  if (!withinBounds || cacheErrors != 0U)
+  {
+    printf("FAIL: %s\n", withinBounds ? "cache mismatch" : "error above its bound");
+    return EXIT_FAILURE;
+  }
+
+  printf("OK: every channel within its bound, cache consistent\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,268 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "sim.h"
+#include "API_udp.h"
+#include "API_udp_port.h"
+
+/*
+ * Ethernet MAC, its transmit DMA and a 100 Mbit/s full-duplex link behind the UDP_HAL_* port.
+ *
+ * UDP_HAL_Transmit takes one of SIM_ETH_TX_DESCRIPTORS descriptors, as the ETH DMA ring does, and
+ * snapshots the frame. Frames go on the wire one after the other at the link rate, in virtual time;
+ * UDP_HAL_ReleaseSent returns those whose last bit has left, oldest first, like HAL_ETH_ReleaseTxPacket.
+ * A frame whose buffer changed between the two calls was written while the DMA owned it: counted as an
+ * ownership error, the host side sees the snapshot.
+ *
+ * Sent frames go to the pcap capture file and to the reader, if set, stamped with the time their
+ * last bit left.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define SIM_ETH_TX_DESCRIPTORS UDP_FRAME_COUNT // ETH_TX_DESC_CNT of the HAL
+#define SIM_ETH_NS_PER_BYTE 80ULL              // 100 Mbit/s
+#define SIM_ETH_NS_PER_US 1000ULL
+#define SIM_ETH_MIN_FRAME 60U                  // Shorter frames are padded by the MAC
+#define SIM_ETH_WIRE_OVERHEAD 24U              // Preamble and SFD (8), FCS (4), inter-frame gap (12)
+
+// pcap file format, native byte order
+#define SIM_ETH_PCAP_MAGIC 0xA1B2C3D4UL
+#define SIM_ETH_PCAP_VERSION_MAJOR 2U
+#define SIM_ETH_PCAP_VERSION_MINOR 4U
+#define SIM_ETH_PCAP_SNAPLEN 65535UL
+#define SIM_ETH_PCAP_LINKTYPE_ETHERNET 1UL
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  uint8_t *frame;       // Buffer owned by the DMA
+  uint16_t length;
+  uint64_t doneNs;      // Virtual time the last bit leaves
+  uint8_t snapshot[UDP_FRAME_BUFFER_SIZE];
+} simEthDescriptor_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+static simEthDescriptor_t descriptors[SIM_ETH_TX_DESCRIPTORS];
+static uint8_t releaseIndex; // Oldest descriptor in use
+static uint8_t usedCount;
+static uint64_t wireFreeNs;  // Virtual time the link finishes the frames queued so far
+static bool initialised;
+static bool linkUp;
+static uint8_t macAddress[UDP_MAC_SIZE];
+static uint32_t framesSent;
+static uint32_t ownershipErrors;
+static uint32_t refusedFrames;
+static FILE *capture;
+static simEthReader_t reader;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void writePcapWord(uint32_t value);
+static void writePcapHalf(uint16_t value);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Writes a 32-bit pcap field, native byte order like the magic number.
+ * @param  value: Field value.
+ * @retval None
+ */
+static void writePcapWord(uint32_t value)
+{
+  fwrite(&value, sizeof(value), 1, capture);
+}
+
+/**
+ * @brief  Writes a 16-bit pcap field.
+ * @param  value: Field value.
+ * @retval None
+ */
+static void writePcapHalf(uint16_t value)
+{
+  fwrite(&value, sizeof(value), 1, capture);
+}
+
+/* Port Function Definitions ------------------------------------------------ */
+
+bool UDP_HAL_Init(const uint8_t *mac)
+{
+  memcpy(macAddress, mac, UDP_MAC_SIZE);
+  initialised = true;
+
+  return true;
+}
+
+bool UDP_HAL_IsLinkUp(void)
+{
+  return linkUp;
+}
+
+bool UDP_HAL_Transmit(uint8_t *frame, uint16_t length)
+{
+  uint64_t nowNs = SIM_TIME_NowUs() * SIM_ETH_NS_PER_US;
+  uint16_t wireLength = length < SIM_ETH_MIN_FRAME ? SIM_ETH_MIN_FRAME : length;
+
+  if (!initialised || usedCount == SIM_ETH_TX_DESCRIPTORS || length > UDP_MAX_FRAME_SIZE ||
+      ((uintptr_t)frame & 3U) != 0U)
+  {
+    refusedFrames++;
+    return false;
+  }
+
+  simEthDescriptor_t *descriptor = &descriptors[(releaseIndex + usedCount) % SIM_ETH_TX_DESCRIPTORS];
+
+  descriptor->frame = frame;
+  descriptor->length = length;
+  memcpy(descriptor->snapshot, frame, length);
+  wireFreeNs = (wireFreeNs > nowNs ? wireFreeNs : nowNs) +
+               (uint64_t)(wireLength + SIM_ETH_WIRE_OVERHEAD) * SIM_ETH_NS_PER_BYTE;
+  descriptor->doneNs = wireFreeNs;
+  usedCount++;
+
+  return true;
+}
+
+void UDP_HAL_ReleaseSent(void)
+{
+  uint64_t nowNs = SIM_TIME_NowUs() * SIM_ETH_NS_PER_US;
+
+  while (usedCount > 0U && descriptors[releaseIndex].doneNs <= nowNs)
+  {
+    simEthDescriptor_t *descriptor = &descriptors[releaseIndex];
+
+    if (memcmp(descriptor->snapshot, descriptor->frame, descriptor->length) != 0)
+    {
+      ownershipErrors++;
+    }
+
+    if (capture != NULL)
+    {
+      writePcapWord((uint32_t)(descriptor->doneNs / (SIM_US_PER_SECOND * SIM_ETH_NS_PER_US)));
+      writePcapWord((uint32_t)(descriptor->doneNs / SIM_ETH_NS_PER_US % SIM_US_PER_SECOND));
+      writePcapWord(descriptor->length);
+      writePcapWord(descriptor->length);
+      fwrite(descriptor->snapshot, 1, descriptor->length, capture);
+    }
+    if (reader != NULL)
+    {
+      reader(descriptor->snapshot, descriptor->length);
+    }
+
+    framesSent++;
+    releaseIndex = (uint8_t)((releaseIndex + 1U) % SIM_ETH_TX_DESCRIPTORS);
+    usedCount--;
+    API_UDP_OnFrameSent(descriptor->frame);
+  }
+}
+
+void UDP_HAL_GetUniqueId(uint32_t *words)
+{
+  // Same device as the USB serial number of sim_usb.c
+  words[0] = 0x00350041UL;
+  words[1] = 0x3530510AUL;
+  words[2] = 0x38363331UL;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Unplugs the cable and empties the descriptor ring, as after a board reset.
+ * @param  None
+ * @retval None
+ */
+void SIM_ETH_Reset(void)
+{
+  memset(descriptors, 0, sizeof(descriptors));
+  releaseIndex = 0;
+  usedCount = 0;
+  wireFreeNs = 0;
+  initialised = false;
+  linkUp = false;
+  framesSent = 0;
+  ownershipErrors = 0;
+  refusedFrames = 0;
+}
+
+/**
+ * @brief  Plugs or unplugs the cable. Frames already queued still leave.
+ * @param  up: true for link up.
+ * @retval None
+ */
+void SIM_ETH_SetLink(bool up)
+{
+  linkUp = up;
+}
+
+/**
+ * @brief  Starts a pcap capture of the sent frames (Ethernet link type), or stops it.
+ * @param  out: Capture file, opened for binary writing, NULL to stop. Left open.
+ * @retval None
+ */
+void SIM_ETH_SetCapture(FILE *out)
+{
+  capture = out;
+  if (capture == NULL)
+  {
+    return;
+  }
+
+  writePcapWord(SIM_ETH_PCAP_MAGIC);
+  writePcapHalf(SIM_ETH_PCAP_VERSION_MAJOR);
+  writePcapHalf(SIM_ETH_PCAP_VERSION_MINOR);
+  writePcapWord(0); // Time zone offset
+  writePcapWord(0); // Timestamp accuracy
+  writePcapWord(SIM_ETH_PCAP_SNAPLEN);
+  writePcapWord(SIM_ETH_PCAP_LINKTYPE_ETHERNET);
+}
+
+/**
+ * @brief  Sets the receiver of the sent frames: the collector side of the link.
+ * @param  frameReader: Called with each frame as it leaves, NULL for none.
+ * @retval None
+ */
+void SIM_ETH_SetReader(simEthReader_t frameReader)
+{
+  reader = frameReader;
+}
+
+/**
+ * @brief  Source MAC address given to UDP_HAL_Init.
+ * @param  mac: Receives the 6 bytes.
+ * @retval None
+ */
+void SIM_ETH_GetMac(uint8_t *mac)
+{
+  memcpy(mac, macAddress, UDP_MAC_SIZE);
+}
+
+/**
+ * @brief  Number of frames that left the wire.
+ * @param  None
+ * @retval uint32_t: Frames.
+ */
+uint32_t SIM_ETH_GetFramesSent(void)
+{
+  return framesSent;
+}
+
+/**
+ * @brief  Number of frames written while the DMA owned their buffer.
+ * @param  None
+ * @retval uint32_t: Frames.
+ */
+uint32_t SIM_ETH_GetOwnershipErrors(void)
+{
+  return ownershipErrors;
+}
+
+/**
+ * @brief  Number of UDP_HAL_Transmit calls refused: ring full, MAC not initialised, bad length or alignment.
+ * @param  None
+ * @retval uint32_t: Calls.
+ */
+uint32_t SIM_ETH_GetRefusedFrames(void)
+{
+  return refusedFrames;
+}
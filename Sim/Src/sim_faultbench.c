@@ -0,0 +1,361 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "API_app.h"
+#include "API_fault.h"
+#include "sim_check.h"
+
+/*
+ * BME280 fault injection against the firmware: each scenario breaks the sensor model or the SPI DMA while the
+ * firmware runs, then repairs it, and checks that the fault manager detected and classified the fault, marked
+ * the faulty reads invalid on the bus (a hung DMA read delivers none: the sampler counts its timeout), published
+ * no valid sample until the sensor was verified again, recovered by itself and put LED3 out again.
+ *
+ *   sim_faultbench [-d seconds]
+ *
+ *   -d  Virtual duration of the fault-free runs before and after the scenarios, default 20 s.
+ *
+ * Every recovery step (API_FAULT_Process, wrapped) is timed: none may take more than FAULTBENCH_STEP_MAX_US,
+ * so a fault never stalls the super loop. Every verdict (API_FAULT_CheckRead, wrapped) is checked against the
+ * state it leaves: a valid read only while running. Each scenario prints its counters and "ok" or "FAILED".
+ * Exit status 1 if any check fails.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define FAULTBENCH_DEFAULT_DURATION_S 20U
+#define FAULTBENCH_TEMPERATURE 22.0f
+#define FAULTBENCH_HUMIDITY 40.0f
+#define FAULTBENCH_RECOVERY_MS 15000U // Longest back-off and a verification
+#define FAULTBENCH_STEP_MAX_US 2000U  // Longest recovery step: a few short SPI exchanges, never a wait
+#define FAULTBENCH_OTHER_CHIP_ID 0x58U // BMP280
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief Fault scenario: inject, run faultMs, repair, then wait for the recovery.
+ */
+typedef struct
+{
+  const char *name;
+  void (*inject)(void);
+  void (*repair)(void); // NULL if the recovery itself repairs the sensor
+  uint32_t faultMs;
+  faultType_t expected; // Cause of the recovery
+  bool delivered;       // The faulty reads reach the bus, otherwise the sampler times them out
+} faultScenario_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+static busSubscription_t rawSubscription;
+static uint32_t validSamples;
+static uint32_t validWhileRecovering; // Reads judged valid before the sensor was verified
+static uint32_t invalidSamples[FAULT_TYPE_COUNT];
+static uint64_t longestStepUs;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void collect(const busMessage_t *message);
+static uint32_t countInvalid(void);
+static uint32_t countFaultyReads(const faultStatus_t *status);
+static void runFor(uint32_t ms);
+static bool runNormal(const char *name, uint32_t seconds);
+static bool runScenario(const faultScenario_t *scenario);
+static void disconnect(void);
+static void reconnect(void);
+static void otherChip(void);
+static void rightChip(void);
+static void freeze(void);
+static void brownOut(void);
+static void hangDma(void);
+static void releaseDma(void);
+
+/* Stage wrapper (-Wl,--wrap) ----------------------------------------------- */
+
+void __real_API_FAULT_Process(uint32_t nowMs);
+faultType_t __real_API_FAULT_CheckRead(bme280Status_t readStatus, const bme280Sample_t *sample, uint32_t nowMs);
+void __wrap_API_FAULT_Process(uint32_t nowMs);
+faultType_t __wrap_API_FAULT_CheckRead(bme280Status_t readStatus, const bme280Sample_t *sample, uint32_t nowMs);
+
+void __wrap_API_FAULT_Process(uint32_t nowMs)
+{
+  uint64_t startUs = SIM_TIME_NowUs();
+
+  __real_API_FAULT_Process(nowMs);
+  if (SIM_TIME_NowUs() - startUs > longestStepUs)
+  {
+    longestStepUs = SIM_TIME_NowUs() - startUs;
+  }
+}
+
+faultType_t __wrap_API_FAULT_CheckRead(bme280Status_t readStatus, const bme280Sample_t *sample, uint32_t nowMs)
+{
+  faultType_t fault = __real_API_FAULT_CheckRead(readStatus, sample, nowMs);
+
+  if (fault == FAULT_TYPE_NONE && API_FAULT_GetStatus().state != FAULT_STATE_OK)
+  {
+    validWhileRecovering++;
+  }
+
+  return fault;
+}
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  BUS_TOPIC_RAW_SAMPLE subscriber: counts the valid samples and the invalid ones per fault.
+ * @param  message: Raw sample.
+ * @retval None
+ */
+static void collect(const busMessage_t *message)
+{
+  if (message->raw.fault == FAULT_TYPE_NONE)
+  {
+    validSamples++;
+  }
+  else if (message->raw.fault < FAULT_TYPE_COUNT)
+  {
+    invalidSamples[message->raw.fault]++;
+  }
+}
+
+/**
+ * @brief  Invalid samples published so far, every fault.
+ * @param  None
+ * @retval uint32_t: Samples.
+ */
+static uint32_t countInvalid(void)
+{
+  uint32_t count = 0;
+
+  for (faultType_t type = FAULT_TYPE_BUS; type < FAULT_TYPE_COUNT; type++)
+  {
+    count += invalidSamples[type];
+  }
+
+  return count;
+}
+
+/**
+ * @brief  Faulty reads counted by the fault manager, recovery reads aside.
+ * @param  status: Fault manager status.
+ * @retval uint32_t: Reads.
+ */
+static uint32_t countFaultyReads(const faultStatus_t *status)
+{
+  return status->reads[FAULT_TYPE_BUS] + status->reads[FAULT_TYPE_ID] + status->reads[FAULT_TYPE_STUCK] +
+         status->reads[FAULT_TYPE_RANGE];
+}
+
+/**
+ * @brief  Runs the super loop for a virtual duration.
+ * @param  ms: Duration.
+ * @retval None
+ */
+static void runFor(uint32_t ms)
+{
+  uint64_t end = SIM_TIME_NowUs() + (uint64_t)ms * SIM_US_PER_MS;
+
+  while (SIM_TIME_NowUs() < end)
+  {
+    SIM_BOARD_Step();
+  }
+}
+
+/**
+ * @brief  Fault-free run: every sample must be valid and LED3 must stay off.
+ * @param  name: Run name.
+ * @param  seconds: Duration.
+ * @retval bool: true if every check passed.
+ */
+static bool runNormal(const char *name, uint32_t seconds)
+{
+  uint32_t failuresBefore = failures;
+  uint32_t validBefore = validSamples;
+  uint32_t invalidBefore = countInvalid();
+  uint32_t invalidAfter;
+
+  runFor(seconds * 1000U);
+  invalidAfter = countInvalid();
+
+  check(validSamples > validBefore, "valid samples published");
+  check(invalidAfter == invalidBefore, "no invalid sample");
+  check(API_FAULT_GetStatus().state == FAULT_STATE_OK, "sensor running");
+  check(!SIM_LED_IsOn(LED3), "LED3 off");
+
+  printf("%s %u s: %u valid samples, %u invalid\n", name, seconds, validSamples - validBefore,
+         invalidAfter - invalidBefore);
+  return checkSection(failuresBefore);
+}
+
+/**
+ * @brief  Injects a fault, repairs it after faultMs and waits for the recovery.
+ * @param  scenario: Scenario.
+ * @retval bool: true if every check passed.
+ */
+static bool runScenario(const faultScenario_t *scenario)
+{
+  uint32_t failuresBefore = failures;
+  faultStatus_t before = API_FAULT_GetStatus();
+  samplerStatus_t samplerBefore = API_SAMPLER_GetStatus();
+  uint32_t invalidBefore = countInvalid();
+  uint32_t validBefore = validSamples;
+  uint32_t validRecoveringBefore = validWhileRecovering;
+  uint64_t repairUs;
+  faultStatus_t after;
+  bool recovered = false;
+  bool faulted = false;
+
+  scenario->inject();
+  for (uint32_t ms = 0; ms < scenario->faultMs; ms++)
+  {
+    SIM_BOARD_Step();
+    faulted = faulted || API_FAULT_GetStatus().state != FAULT_STATE_OK;
+  }
+  check(API_FAULT_GetStatus().state == FAULT_STATE_OK || SIM_LED_IsOn(LED3), "LED3 lit while faulted");
+  if (scenario->repair != NULL)
+  {
+    scenario->repair();
+  }
+
+  repairUs = SIM_TIME_NowUs();
+  for (uint32_t ms = 0; ms < FAULTBENCH_RECOVERY_MS && !recovered; ms++)
+  {
+    SIM_BOARD_Step();
+    faulted = faulted || API_FAULT_GetStatus().state != FAULT_STATE_OK;
+    recovered = API_FAULT_GetStatus().recoveries > before.recoveries &&
+                API_FAULT_GetStatus().state == FAULT_STATE_OK;
+  }
+  after = API_FAULT_GetStatus();
+
+  check(faulted, "fault detected");
+  check(after.lastFault == scenario->expected, "fault classified");
+  check(countFaultyReads(&after) > countFaultyReads(&before), "faulty reads counted");
+  if (scenario->delivered)
+  {
+    check(countInvalid() > invalidBefore, "invalid samples flagged on the bus");
+  }
+  else
+  {
+    check(API_SAMPLER_GetStatus().timeouts > samplerBefore.timeouts, "hung reads aborted");
+  }
+  check(validWhileRecovering == validRecoveringBefore, "no valid sample before the verification");
+  check(after.resets > before.resets, "sensor reset");
+  check(recovered, "recovered");
+  check(!SIM_LED_IsOn(LED3), "LED3 off after the recovery");
+
+  // A few more samples: the sensor must deliver valid ones again
+  runFor(1000U);
+  check(validSamples > validBefore, "valid samples after the recovery");
+
+  printf("%s %u ms: %u faulty reads, %u invalid samples, %u resets, %u failed attempts, %u sampler timeouts, "
+         "recovered %.1f s after the repair\n",
+         scenario->name, scenario->faultMs, countFaultyReads(&after) - countFaultyReads(&before),
+         countInvalid() - invalidBefore, after.resets - before.resets,
+         after.attempts - before.attempts, API_SAMPLER_GetStatus().timeouts - samplerBefore.timeouts,
+         recovered ? (double)(SIM_TIME_NowUs() - repairUs - 1000U * SIM_US_PER_MS) / SIM_US_PER_SECOND : -1.0);
+  return checkSection(failuresBefore);
+}
+
+/**
+ * @brief  Scenario hooks on the sensor and sampler models.
+ * @param  None
+ * @retval None
+ */
+static void disconnect(void)
+{
+  SIM_BME280_SetPresent(false);
+}
+
+static void reconnect(void)
+{
+  SIM_BME280_SetPresent(true);
+}
+
+static void otherChip(void)
+{
+  // Another part after a power cycle: it sleeps with reset values, and answers the configuration with its ID
+  SIM_BME280_SetChipId(FAULTBENCH_OTHER_CHIP_ID);
+  SIM_BME280_PowerOnReset();
+}
+
+static void rightChip(void)
+{
+  SIM_BME280_SetChipId(BME280_CHIP_ID);
+}
+
+static void freeze(void)
+{
+  SIM_BME280_SetStuck(true);
+}
+
+static void brownOut(void)
+{
+  SIM_BME280_PowerOnReset();
+}
+
+static void hangDma(void)
+{
+  SIM_SAMPLER_SetHung(true);
+}
+
+static void releaseDma(void)
+{
+  SIM_SAMPLER_SetHung(false);
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+  static const faultScenario_t scenarios[] = {
+      {"disconnect", disconnect, reconnect, 5000U, FAULT_TYPE_BUS, true},
+      {"wrong id", otherChip, rightChip, 3000U, FAULT_TYPE_ID, true},
+      {"stuck", freeze, NULL, FAULT_STUCK_MS + 5000U, FAULT_TYPE_STUCK, true},
+      {"brown-out", brownOut, NULL, 0U, FAULT_TYPE_RANGE, true},
+      {"dma hang", hangDma, releaseDma, 2000U, FAULT_TYPE_BUS, false},
+  };
+  uint32_t seconds = FAULTBENCH_DEFAULT_DURATION_S;
+  bool ok = true;
+  int option;
+
+  while ((option = getopt(argc, argv, "d:")) != -1)
+  {
+    switch (option)
+    {
+    case 'd':
+      seconds = (uint32_t)strtoul(optarg, NULL, 10);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-d seconds]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  SIM_RTC_PowerOnReset();
+  SIM_TIME_Reset();
+  SIM_UART_SetCapture(NULL);
+  SIM_LCD_Reset();
+  SIM_BME280_Reset(NULL);
+  SIM_BME280_SetEnvironment(FAULTBENCH_TEMPERATURE, FAULTBENCH_HUMIDITY);
+  SIM_FLASH_EraseAll();
+  SIM_SD_Reset(0);
+  SIM_BOARD_Init();
+  API_BUS_Subscribe(&rawSubscription, BUS_TOPIC_RAW_SAMPLE, collect, 0U);
+
+  ok = runNormal("normal", seconds) && ok;
+  for (uint32_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+  {
+    ok = runScenario(&scenarios[i]) && ok;
+  }
+  ok = runNormal("after", seconds) && ok;
+
+  check(longestStepUs <= FAULTBENCH_STEP_MAX_US, "recovery steps never wait");
+  printf("longest recovery step %llu us\n", (unsigned long long)longestStepUs);
+  ok = ok && failures == 0U;
+  printf("%s\n", ok ? "ok" : "FAILED");
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
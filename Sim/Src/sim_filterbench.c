@@ -0,0 +1,353 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "API_app.h" /* <- APP_FILTER_* firmware configuration */
+#include "API_filter.h"
+#include "sim_check.h"
+
+/*
+ * API_filter.h fixed-point chain on synthetic noisy traces: noise and spike rejection, step response, then
+ * throughput, for the firmware's configuration next to each stage alone.
+ *
+ *   sim_filterbench [-n calls]
+ *
+ *   -n  Pushes per throughput run, default 10 million.
+ *
+ * Traces: 10 minutes of 50 ms raw samples (SAMPLER_PERIOD_US) in 0.01 C, the unit API_BME280 hands to the filter:
+ * a slow 3 C swing with 0.05 C rms white noise, a flat signal with the same noise and 5 C spikes on 1 % of the
+ * samples, and a 5 C step with the same noise. Each output is compared with the clean signal at the time it is
+ * produced, so the figures include the lag each stage costs: rms and maximum error, and for the step the time
+ * from the step to the last output still more than 10 % of it away.
+ *
+ * Checks: every configuration passes a constant through unchanged and emits one output per decimation block; a
+ * reconfiguration keeps the EMA output; the firmware's chain divides the rms noise of the flat trace by at
+ * least FILTERBENCH_MIN_NOISE_GAIN, keeps every spike under FILTERBENCH_MAX_SPIKE_ERROR and settles the step in
+ * FILTERBENCH_MAX_SETTLE_MS.
+ *
+ * Throughput: ns per API_FILTER_Push, host wall time, compare runs on one machine only.
+ *
+ * Exit status 1 if a check fails.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define FILTERBENCH_DEFAULT_CALLS 10000000U
+#define FILTERBENCH_SAMPLE_MS 50U
+#define FILTERBENCH_SAMPLES 12000U            // 10 minutes
+#define FILTERBENCH_BASE 2200                 // 22.00 C
+#define FILTERBENCH_SWING 300.0               // 3 C peak
+#define FILTERBENCH_SWING_PERIOD_MS 600000.0  // One swing over the trace
+#define FILTERBENCH_NOISE_RMS 5.0             // 0.05 C
+#define FILTERBENCH_SPIKE 500                 // 5 C
+#define FILTERBENCH_SPIKE_PERCENT 1
+#define FILTERBENCH_STEP 500                  // 5 C
+#define FILTERBENCH_STEP_MS 60000U
+#define FILTERBENCH_SETTLE_FRACTION 0.1       // Within 10 % of the step
+#define FILTERBENCH_MIN_NOISE_GAIN 4.0        // Firmware chain: rms noise divided by at least this
+#define FILTERBENCH_MAX_SPIKE_ERROR 50.0      // Firmware chain: 0.5 C, a tenth of a spike
+#define FILTERBENCH_MAX_SETTLE_MS 2500U       // Firmware chain: decimation block plus EMA time constant
+#define FILTERBENCH_NS_PER_SECOND 1e9
+
+/* Private types -------------------------------------------------------------*/
+
+typedef enum
+{
+  TRACE_SWING,  // Slow swing plus white noise
+  TRACE_SPIKES, // Flat plus white noise and spikes
+  TRACE_STEP,   // Step plus white noise
+  TRACE_COUNT,
+} trace_t;
+
+/**
+ * @brief Error of one configuration on one trace.
+ */
+typedef struct
+{
+  double rms;
+  double max;
+  uint32_t outputs;
+  uint32_t settleMs; // TRACE_STEP only: from the step to the last output outside 10 % of it
+} traceError_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+static int32_t clean[TRACE_COUNT][FILTERBENCH_SAMPLES];
+static int32_t noisy[TRACE_COUNT][FILTERBENCH_SAMPLES];
+static volatile int32_t sink; // Keeps the timed results alive
+
+/* Private Function Prototypes ---------------------------------------------- */
+static double gaussian(void);
+static void buildTraces(void);
+static traceError_t runTrace(const filterConfig_t *config, trace_t trace);
+static void checkExactness(const filterConfig_t *config);
+static void checkReconfigure(void);
+static double nowNs(void);
+static double timePush(const filterConfig_t *config, uint32_t calls);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Standard normal sample (Box-Muller), from the seeded C library generator.
+ * @param  None
+ * @retval double: Sample.
+ */
+static double gaussian(void)
+{
+  double u1 = ((double)rand() + 1.0) / ((double)RAND_MAX + 2.0);
+  double u2 = (double)rand() / (double)RAND_MAX;
+
+  return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+/**
+ * @brief  Fills the clean and noisy traces, the same on every run.
+ * @param  None
+ * @retval None
+ */
+static void buildTraces(void)
+{
+  srand(1);
+
+  for (uint32_t i = 0; i < FILTERBENCH_SAMPLES; i++)
+  {
+    double ms = (double)i * FILTERBENCH_SAMPLE_MS;
+
+    clean[TRACE_SWING][i] = FILTERBENCH_BASE + (int32_t)lround(FILTERBENCH_SWING * sin(2.0 * M_PI * ms / FILTERBENCH_SWING_PERIOD_MS));
+    clean[TRACE_SPIKES][i] = FILTERBENCH_BASE;
+    clean[TRACE_STEP][i] = FILTERBENCH_BASE + ((ms >= FILTERBENCH_STEP_MS) ? FILTERBENCH_STEP : 0);
+
+    for (trace_t trace = 0; trace < TRACE_COUNT; trace++)
+    {
+      noisy[trace][i] = clean[trace][i] + (int32_t)lround(FILTERBENCH_NOISE_RMS * gaussian());
+    }
+    if (rand() % 100 < FILTERBENCH_SPIKE_PERCENT)
+    {
+      noisy[TRACE_SPIKES][i] += (rand() % 2 == 0) ? FILTERBENCH_SPIKE : -FILTERBENCH_SPIKE;
+    }
+  }
+}
+
+/**
+ * @brief  Filters one trace and measures the outputs against the clean signal at their time.
+ * @param  const filterConfig_t *config: Chain configuration.
+ * @param  trace_t trace: Trace.
+ * @retval traceError_t: Errors.
+ */
+static traceError_t runTrace(const filterConfig_t *config, trace_t trace)
+{
+  traceError_t error = {0};
+  filterChannel_t channel;
+  double sumSquares = 0.0;
+
+  API_FILTER_Init(&channel, config);
+
+  for (uint32_t i = 0; i < FILTERBENCH_SAMPLES; i++)
+  {
+    int32_t output;
+
+    if (!API_FILTER_Push(&channel, noisy[trace][i], &output))
+    {
+      continue;
+    }
+
+    double deviation = fabs((double)(output - clean[trace][i]));
+
+    sumSquares += deviation * deviation;
+    error.max = fmax(error.max, deviation);
+    error.outputs++;
+
+    uint32_t ms = i * FILTERBENCH_SAMPLE_MS;
+    if (trace == TRACE_STEP && ms >= FILTERBENCH_STEP_MS && deviation > FILTERBENCH_SETTLE_FRACTION * FILTERBENCH_STEP)
+    {
+      error.settleMs = ms - FILTERBENCH_STEP_MS + FILTERBENCH_SAMPLE_MS;
+    }
+  }
+
+  error.rms = (error.outputs > 0U) ? sqrt(sumSquares / error.outputs) : 0.0;
+  return error;
+}
+
+/**
+ * @brief  A constant comes out unchanged, one output per decimation block, at both signs.
+ * @param  const filterConfig_t *config: Chain configuration.
+ * @retval None
+ */
+static void checkExactness(const filterConfig_t *config)
+{
+  static const int32_t constants[] = {FILTERBENCH_BASE, -FILTERBENCH_BASE, 0, 102400}; // Q22.10 100 %RH last
+  filterChannel_t channel;
+
+  for (uint32_t c = 0; c < sizeof(constants) / sizeof(constants[0]); c++)
+  {
+    uint32_t outputs = 0;
+    bool exact = true;
+
+    API_FILTER_Init(&channel, config);
+    for (uint32_t i = 0; i < FILTER_MAX_DECIMATION * 10U; i++)
+    {
+      int32_t output;
+
+      if (API_FILTER_Push(&channel, constants[c], &output))
+      {
+        outputs++;
+        exact = exact && output == constants[c];
+      }
+    }
+    check(exact, "a constant passes unchanged");
+    check(outputs == FILTER_MAX_DECIMATION * 10U / channel.config.decimation, "one output per decimation block");
+  }
+}
+
+/**
+ * @brief  A reconfiguration carries the EMA output over to the new coefficient: a constant stays unchanged.
+ * @param  None
+ * @retval None
+ */
+static void checkReconfigure(void)
+{
+  static const filterConfig_t wide = {FILTER_MEDIAN_MAX_WINDOW, FILTER_MAX_DECIMATION, FILTER_MAX_EMA_SHIFT};
+  static const filterConfig_t firmware = {APP_FILTER_MEDIAN_WINDOW, APP_FILTER_DECIMATION, APP_FILTER_EMA_SHIFT};
+  filterChannel_t channel;
+  int32_t output;
+  bool exact = true;
+
+  API_FILTER_Init(&channel, &firmware);
+  for (uint32_t i = 0; i < APP_FILTER_DECIMATION * 4U; i++)
+  {
+    API_FILTER_Push(&channel, FILTERBENCH_BASE, &output);
+  }
+  API_FILTER_Reconfigure(&channel, &wide);
+  for (uint32_t i = 0; i < FILTER_MAX_DECIMATION * 4U; i++)
+  {
+    if (API_FILTER_Push(&channel, FILTERBENCH_BASE, &output))
+    {
+      exact = exact && output == FILTERBENCH_BASE;
+    }
+  }
+  API_FILTER_Reconfigure(&channel, &firmware);
+  for (uint32_t i = 0; i < APP_FILTER_DECIMATION * 4U; i++)
+  {
+    if (API_FILTER_Push(&channel, FILTERBENCH_BASE, &output))
+    {
+      exact = exact && output == FILTERBENCH_BASE;
+    }
+  }
+  check(exact, "reconfiguration keeps the output");
+}
+
+/**
+ * @brief  Monotonic host time.
+ * @param  None
+ * @retval double: ns.
+ */
+static double nowNs(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec * FILTERBENCH_NS_PER_SECOND + (double)now.tv_nsec;
+}
+
+/**
+ * @brief  Times API_FILTER_Push over the spike trace.
+ * @param  const filterConfig_t *config: Chain configuration.
+ * @param  uint32_t calls: Pushes.
+ * @retval double: ns per push.
+ */
+static double timePush(const filterConfig_t *config, uint32_t calls)
+{
+  filterChannel_t channel;
+  int32_t sum = 0;
+  int32_t output;
+
+  API_FILTER_Init(&channel, config);
+
+  double start = nowNs();
+  for (uint32_t call = 0; call < calls; call++)
+  {
+    if (API_FILTER_Push(&channel, noisy[TRACE_SPIKES][call % FILTERBENCH_SAMPLES], &output))
+    {
+      sum += output;
+    }
+  }
+  double elapsed = nowNs() - start;
+
+  sink = sum;
+  return elapsed / calls;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+  static const struct
+  {
+    const char *name;
+    filterConfig_t config;
+  } chains[] = {
+      {"raw", {1, 1, 0}},
+      {"median 5", {5, 1, 0}},
+      {"average 4", {1, 4, 0}},
+      {"ema 1/4", {1, 1, 2}},
+      {"firmware", {APP_FILTER_MEDIAN_WINDOW, APP_FILTER_DECIMATION, APP_FILTER_EMA_SHIFT}},
+      {"widest", {FILTER_MEDIAN_MAX_WINDOW, FILTER_MAX_DECIMATION, FILTER_MAX_EMA_SHIFT}},
+  };
+  static const uint32_t firmwareChain = 4U; // "firmware" in chains
+  traceError_t errors[sizeof(chains) / sizeof(chains[0])][TRACE_COUNT];
+  uint32_t calls = FILTERBENCH_DEFAULT_CALLS;
+  int option;
+
+  while ((option = getopt(argc, argv, "n:")) != -1)
+  {
+    switch (option)
+    {
+    case 'n':
+      calls = (uint32_t)strtoul(optarg, NULL, 10);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-n calls]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  buildTraces();
+
+  printf("errors in 0.01 C against the clean signal, %u raw samples every %u ms\n", FILTERBENCH_SAMPLES,
+         FILTERBENCH_SAMPLE_MS);
+  printf("%-10s %6s | %7s %7s | %7s %7s | %7s %7s %8s | %8s\n", "chain", "out/s", "swing", "max", "spikes", "max",
+         "step", "max", "settle", "ns/push");
+  for (uint32_t c = 0; c < sizeof(chains) / sizeof(chains[0]); c++)
+  {
+    for (trace_t trace = 0; trace < TRACE_COUNT; trace++)
+    {
+      errors[c][trace] = runTrace(&chains[c].config, trace);
+    }
+    checkExactness(&chains[c].config);
+
+    printf("%-10s %6.1f | %7.2f %7.0f | %7.2f %7.0f | %7.2f %7.0f %5u ms | %8.1f\n", chains[c].name,
+           errors[c][TRACE_SWING].outputs * 1000.0 / (FILTERBENCH_SAMPLES * FILTERBENCH_SAMPLE_MS),
+           errors[c][TRACE_SWING].rms, errors[c][TRACE_SWING].max, errors[c][TRACE_SPIKES].rms,
+           errors[c][TRACE_SPIKES].max, errors[c][TRACE_STEP].rms, errors[c][TRACE_STEP].max,
+           errors[c][TRACE_STEP].settleMs, timePush(&chains[c].config, calls));
+  }
+  checkReconfigure();
+
+  const traceError_t *firmware = errors[firmwareChain];
+  check(firmware[TRACE_SPIKES].rms * FILTERBENCH_MIN_NOISE_GAIN <= errors[0][TRACE_SPIKES].rms,
+        "firmware chain divides the noise by FILTERBENCH_MIN_NOISE_GAIN");
+  check(firmware[TRACE_SPIKES].max <= FILTERBENCH_MAX_SPIKE_ERROR, "firmware chain rejects the spikes");
+  check(firmware[TRACE_STEP].settleMs <= FILTERBENCH_MAX_SETTLE_MS, "firmware chain settles the step in time");
+
+  if (failures != 0U)
+  {
+    printf("FAIL: %u checks\n", failures);
+    return EXIT_FAILURE;
+  }
+
+  printf("OK: constants exact, firmware chain within its noise, spike and settling bounds\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "sim.h"
+#include "API_log_port.h"
+
+/* Private constants ---------------------------------------------------------*/
+
+#define SIM_FLASH_WORDS (LOG_FLASH_SECTOR_COUNT * LOG_FLASH_SECTOR_SIZE / sizeof(uint32_t))
+#define SIM_FLASH_SECTOR_ERASE_US 1000000ULL // 128 KB sector, typical at x32 parallelism
+#define SIM_FLASH_WORD_PROGRAM_US 16U         // Typical word program time
+
+/* Public variables ----------------------------------------------------------*/
+
+// Stands in for the LOGFLASH region of the linker script
+uint32_t _slogflash[SIM_FLASH_WORDS];
+
+/* Private variables ----------------------------------------------------------*/
+
+static uint64_t eraseDoneUs;
+static bool eraseBusy;
+static uint32_t eraseCount;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void eraseWords(uint8_t sector);
+
+/* Private Function Definitions --------------------------------------------- */
+
+static void eraseWords(uint8_t sector)
+{
+  memset((uint8_t *)_slogflash + (uint32_t)sector * LOG_FLASH_SECTOR_SIZE, 0xFF, LOG_FLASH_SECTOR_SIZE);
+  eraseCount++;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Erases the whole log area, as a fresh chip.
+ * @param  None
+ * @retval None
+ */
+void SIM_FLASH_EraseAll(void)
+{
+  memset(_slogflash, 0xFF, sizeof(_slogflash));
+  eraseBusy = false;
+}
+
+/**
+ * @brief  Restores the log area from an image written by SIM_FLASH_Save, to simulate a reboot.
+ * @param  path: Image file.
+ * @retval bool: true if a full image was read.
+ */
+bool SIM_FLASH_Load(const char *path)
+{
+  FILE *in = fopen(path, "rb");
+  size_t read;
+
+  if (in == NULL)
+  {
+    return false;
+  }
+  read = fread(_slogflash, 1, sizeof(_slogflash), in);
+  fclose(in);
+
+  return read == sizeof(_slogflash);
+}
+
+/**
+ * @brief  Writes the log area to an image file.
+ * @param  path: Image file.
+ * @retval bool: true on success.
+ */
+bool SIM_FLASH_Save(const char *path)
+{
+  FILE *out = fopen(path, "wb");
+  size_t written;
+
+  if (out == NULL)
+  {
+    return false;
+  }
+  written = fwrite(_slogflash, 1, sizeof(_slogflash), out);
+  fclose(out);
+
+  return written == sizeof(_slogflash);
+}
+
+/**
+ * @brief  Returns the number of sector erases since start-up, for wear estimates.
+ * @param  None
+ * @retval uint32_t: Erase count.
+ */
+uint32_t SIM_FLASH_GetEraseCount(void)
+{
+  return eraseCount;
+}
+
+/* Log port -----------------------------------------------------------------*/
+
+void LOG_HAL_Init(void)
+{
+  eraseBusy = false;
+}
+
+/**
+ * @brief  The content is cleared at once; a background erase then keeps the controller busy
+ *         for the sector erase time, a blocking one charges that time.
+ */
+bool LOG_HAL_EraseSector(uint8_t sector, bool background)
+{
+  if (sector >= LOG_FLASH_SECTOR_COUNT || LOG_HAL_IsEraseBusy())
+  {
+    return false;
+  }
+
+  eraseWords(sector);
+  if (background)
+  {
+    eraseBusy = true;
+    eraseDoneUs = SIM_TIME_NowUs() + SIM_FLASH_SECTOR_ERASE_US;
+  }
+  else
+  {
+    SIM_TIME_AdvanceUs(SIM_FLASH_SECTOR_ERASE_US);
+  }
+
+  return true;
+}
+
+bool LOG_HAL_IsEraseBusy(void)
+{
+  if (eraseBusy && SIM_TIME_NowUs() >= eraseDoneUs)
+  {
+    eraseBusy = false;
+  }
+
+  return eraseBusy;
+}
+
+/**
+ * @brief  Programming can only clear bits, as on the real cells.
+ */
+bool LOG_HAL_Program(uint8_t sector, uint32_t offset, const uint32_t *words, uint16_t count)
+{
+  uint32_t first = ((uint32_t)sector * LOG_FLASH_SECTOR_SIZE + offset) / sizeof(uint32_t);
+
+  if (sector >= LOG_FLASH_SECTOR_COUNT || LOG_HAL_IsEraseBusy() || (offset % sizeof(uint32_t)) != 0U ||
+      offset + (uint32_t)count * sizeof(uint32_t) > LOG_FLASH_SECTOR_SIZE)
+  {
+    return false;
+  }
+
+  for (uint16_t i = 0; i < count; i++)
+  {
+    _slogflash[first + i] &= words[i];
+  }
+  SIM_TIME_AdvanceUs((uint64_t)count * SIM_FLASH_WORD_PROGRAM_US);
+
+  return true;
+}
+
+const uint8_t *LOG_HAL_Read(uint8_t sector, uint32_t offset)
+{
+  return (const uint8_t *)_slogflash + (uint32_t)sector * LOG_FLASH_SECTOR_SIZE + offset;
+}
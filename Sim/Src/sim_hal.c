@@ -0,0 +1,631 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "sim.h"
+#include "stm32f4xx_nucleo_144.h"
+#include "API_timestamp.h"
+#include "API_uart.h"
+
+/* Private constants ---------------------------------------------------------*/
+
+#define SIM_RTC_DEFAULT_SYNCH_PREDIV 255U
+#define SIM_CALIB_PPM_PER_PULSE 0.953674 // One RTCCLK cycle out of 2^20
+#define SIM_CALIB_PLUS_PULSES 512U
+#define SIM_UART_HOST_QUEUE 1024U      // Host bytes on their way to USART3
+#define SIM_UART_TOLERANCE_PERCENT 3U  // Rate mismatch the receiver still samples correctly
+#define SIM_UART_GARBLE 0x55U          // Mixed into a byte received at the wrong rate
+#define SIM_EVENT_SLOTS 8U             // Peripheral events pending at once
+
+/* Public variables ----------------------------------------------------------*/
+
+RCC_TypeDef simRcc;
+RTC_TypeDef simRtc;
+GPIO_TypeDef simGpioB;
+GPIO_TypeDef simGpioD;
+USART_TypeDef simUsart3;
+
+/* Private variables ----------------------------------------------------------*/
+
+static uint64_t nowUs;
+
+// Calendar: seconds since 2000-01-01 at rtcBaseUs, running at (1 + rate error) of virtual time
+static timestamp_t rtcBaseSeconds;
+static uint64_t rtcBaseUs;
+static double rtcDriftPpm;
+static double rtcCalibPpm;
+static bool rtcWakeupArmed;
+static uint32_t rtcBackup[RTC_BKP_NUMBER];
+
+static FILE *uartCapture;
+static uint32_t uartBytesSent;
+static uint32_t uartBaudRate = 9600U;  // Requested by HAL_UART_Init
+static uint32_t uartActualRate = 9600U; // PCLK1 / BRR: the rate on the wire
+static bool uartInitialised;
+static uint64_t uartBusyUs;
+
+// Host transmitter: each byte reaches the receiver at atUs, sent at the host's rate
+static struct
+{
+  uint64_t atUs;
+  uint32_t baudRate;
+  uint8_t data;
+} uartHostQueue[SIM_UART_HOST_QUEUE];
+static uint16_t uartHostHead;
+static uint16_t uartHostCount;
+static uint64_t uartHostFreeUs;
+
+static bool ledLit[LEDn];
+
+// Scheduled peripheral events, in the order they were scheduled
+static struct
+{
+  uint64_t atUs;
+  simEvent_t event;
+} events[SIM_EVENT_SLOTS];
+static uint32_t eventCount;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static uint64_t rtcElapsedUs(uint64_t atUs);
+static timestamp_t rtcSeconds(uint64_t atUs);
+static void rtcRebase(timestamp_t seconds);
+static uint8_t bcdToBin(uint8_t bcd);
+static uint8_t binToBcd(uint8_t bin);
+static void uartReceive(uint64_t untilUs);
+static bool runNextEvent(uint64_t untilUs);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  RTC time elapsed since the last calendar write, including the crystal drift and the smooth calibration.
+ * @param  uint64_t atUs: Virtual time.
+ * @retval uint64_t: Elapsed RTC microseconds.
+ */
+static uint64_t rtcElapsedUs(uint64_t atUs)
+{
+  double rate = 1.0 + (rtcDriftPpm + rtcCalibPpm) / 1e6;
+
+  return (uint64_t)((double)(atUs - rtcBaseUs) * rate);
+}
+
+/**
+ * @brief  Calendar seconds at a virtual time.
+ * @param  uint64_t atUs: Virtual time.
+ * @retval timestamp_t: Seconds since 2000-01-01.
+ */
+static timestamp_t rtcSeconds(uint64_t atUs)
+{
+  return rtcBaseSeconds + (timestamp_t)(rtcElapsedUs(atUs) / SIM_US_PER_SECOND);
+}
+
+/**
+ * @brief  Loads a new calendar value; like the init mode of the real RTC this restarts the prescalers.
+ * @param  timestamp_t seconds: New calendar value.
+ * @retval None
+ */
+static void rtcRebase(timestamp_t seconds)
+{
+  rtcBaseSeconds = seconds;
+  rtcBaseUs = nowUs;
+}
+
+static uint8_t bcdToBin(uint8_t bcd)
+{
+  return (uint8_t)((bcd >> 4) * 10U + (bcd & 0x0FU));
+}
+
+static uint8_t binToBcd(uint8_t bin)
+{
+  return (uint8_t)(((bin / 10U) << 4) | (bin % 10U));
+}
+
+/**
+ * @brief  Delivers the host bytes whose stop bit falls before a virtual time, each at its own time, through the
+ *         USART3 interrupt. A byte sent more than SIM_UART_TOLERANCE_PERCENT off the receiver rate is a framing error.
+ * @param  uint64_t untilUs: Virtual time.
+ * @retval None
+ */
+static void uartReceive(uint64_t untilUs)
+{
+  while (uartHostCount > 0U && uartHostQueue[uartHostHead].atUs <= untilUs)
+  {
+    uint32_t hostRate = uartHostQueue[uartHostHead].baudRate;
+    uint32_t mismatch = hostRate > uartActualRate ? hostRate - uartActualRate : uartActualRate - hostRate;
+
+    nowUs = uartHostQueue[uartHostHead].atUs;
+    simUsart3.SR = USART_SR_RXNE;
+    simUsart3.DR = uartHostQueue[uartHostHead].data;
+    if ((uint64_t)mismatch * 100U > (uint64_t)uartActualRate * SIM_UART_TOLERANCE_PERCENT)
+    {
+      simUsart3.SR |= USART_SR_FE;
+      simUsart3.DR ^= SIM_UART_GARBLE;
+    }
+    uartHostHead = (uint16_t)((uartHostHead + 1U) % SIM_UART_HOST_QUEUE);
+    uartHostCount--;
+
+    if (uartInitialised)
+    {
+      uartIrqHandler();
+    }
+    simUsart3.SR = 0;
+  }
+}
+
+/**
+ * @brief  Runs the earliest event due at or before a virtual time, the first scheduled on a tie, after the
+ *         USART3 host bytes that come before it. Virtual time moves to the event time.
+ * @param  uint64_t untilUs: Virtual time.
+ * @retval bool: false if no event is due.
+ */
+static bool runNextEvent(uint64_t untilUs)
+{
+  uint32_t next = 0;
+
+  for (uint32_t i = 1; i < eventCount; i++)
+  {
+    if (events[i].atUs < events[next].atUs)
+    {
+      next = i;
+    }
+  }
+
+  if (eventCount == 0U || events[next].atUs > untilUs)
+  {
+    return false;
+  }
+
+  uint64_t atUs = events[next].atUs;
+  simEvent_t event = events[next].event;
+
+  eventCount--;
+  memmove(&events[next], &events[next + 1U], (eventCount - next) * sizeof(events[0]));
+
+  uartReceive(atUs);
+  if (atUs > nowUs)
+  {
+    nowUs = atUs;
+  }
+  event();
+
+  return true;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Restarts virtual time at 0. The backup domain is left as is, like a system reset.
+ * @param  None
+ * @retval None
+ */
+void SIM_TIME_Reset(void)
+{
+  timestamp_t calendar = rtcSeconds(nowUs);
+
+  nowUs = 0;
+  rtcRebase(calendar);
+  rtcWakeupArmed = false;
+  uartHostCount = 0;
+  uartHostFreeUs = 0;
+  eventCount = 0;
+}
+
+/**
+ * @brief  Returns the virtual time.
+ * @param  None
+ * @retval uint64_t: Microseconds since SIM_TIME_Reset.
+ */
+uint64_t SIM_TIME_NowUs(void)
+{
+  return nowUs;
+}
+
+/**
+ * @brief  Advances virtual time and delivers the scheduled peripheral events, USART3 host bytes, RTC wakeup events
+ *         and USB host frames that fall inside the step.
+ * @param  us: Step in microseconds.
+ * @retval None
+ */
+void SIM_TIME_AdvanceUs(uint64_t us)
+{
+  timestamp_t before = rtcSeconds(nowUs);
+  uint64_t endUs = nowUs + us;
+
+  while (runNextEvent(endUs))
+  {
+  }
+  uartReceive(endUs);
+  nowUs = endUs;
+
+  if (rtcWakeupArmed && rtcSeconds(nowUs) != before)
+  {
+    HAL_RTCEx_WakeUpTimerEventCallback(NULL);
+  }
+
+  SIM_USB_Tick(nowUs);
+}
+
+/**
+ * @brief  Schedules a peripheral event: SIM_TIME_AdvanceUs runs it, as its interrupt, once virtual time reaches it.
+ *         An event may schedule the next one.
+ * @param  atUs: Virtual time, an earlier one runs at the next step.
+ * @param  event: Handler.
+ * @retval bool: false if SIM_EVENT_SLOTS events are already pending.
+ */
+bool SIM_TIME_Schedule(uint64_t atUs, simEvent_t event)
+{
+  if (eventCount == SIM_EVENT_SLOTS)
+  {
+    return false;
+  }
+
+  events[eventCount].atUs = atUs;
+  events[eventCount].event = event;
+  eventCount++;
+
+  return true;
+}
+
+/**
+ * @brief  Clears the backup domain, as when VBAT and VDD are both removed.
+ * @param  None
+ * @retval None
+ */
+void SIM_RTC_PowerOnReset(void)
+{
+  memset(rtcBackup, 0, sizeof(rtcBackup));
+  simRcc.BDCR = 0;
+  rtcCalibPpm = 0.0;
+  rtcWakeupArmed = false;
+  rtcRebase(0);
+}
+
+/**
+ * @brief  Sets the error of the simulated RTC crystal.
+ * @param  ppm: Frequency error, positive if the RTC runs fast.
+ * @retval None
+ */
+void SIM_RTC_SetDriftPpm(int32_t ppm)
+{
+  timestamp_t calendar = rtcSeconds(nowUs);
+
+  rtcRebase(calendar);
+  rtcDriftPpm = ppm;
+}
+
+/**
+ * @brief  Sets where USART3 output goes, NULL to discard it.
+ * @param  out: Capture stream.
+ * @retval None
+ */
+void SIM_UART_SetCapture(FILE *out)
+{
+  uartCapture = out;
+}
+
+/**
+ * @brief  Returns the number of bytes transmitted on USART3.
+ * @param  None
+ * @retval uint32_t: Byte count.
+ */
+uint32_t SIM_UART_GetBytesSent(void)
+{
+  return uartBytesSent;
+}
+
+/**
+ * @brief  Time USART3 spent transmitting.
+ * @param  None
+ * @retval uint64_t: Microseconds since start-up.
+ */
+uint64_t SIM_UART_GetBusyUs(void)
+{
+  return uartBusyUs;
+}
+
+/**
+ * @brief  Rate USART3 was last initialised with.
+ * @param  None
+ * @retval uint32_t: Requested baud rate; the wire runs at PCLK1 / BRR.
+ */
+uint32_t SIM_UART_GetBaudRate(void)
+{
+  return uartBaudRate;
+}
+
+/**
+ * @brief  The host sends bytes to USART3 at its own rate, after those it already queued. Each byte takes
+ *         SIM_UART_BITS_PER_BYTE bit times and reaches the firmware as virtual time passes it.
+ * @param  data: Bytes.
+ * @param  length: Byte count.
+ * @param  baudRate: Host rate.
+ * @retval bool: false if the host queue is full, nothing is queued.
+ */
+bool SIM_UART_HostSend(const uint8_t *data, uint16_t length, uint32_t baudRate)
+{
+  if (uartHostCount + length > SIM_UART_HOST_QUEUE || baudRate == 0U)
+  {
+    return false;
+  }
+
+  if (uartHostFreeUs < nowUs)
+  {
+    uartHostFreeUs = nowUs;
+  }
+  for (uint16_t i = 0; i < length; i++)
+  {
+    uint16_t slot = (uint16_t)((uartHostHead + uartHostCount) % SIM_UART_HOST_QUEUE);
+
+    uartHostFreeUs += (SIM_UART_BITS_PER_BYTE * SIM_US_PER_SECOND + baudRate / 2U) / baudRate;
+    uartHostQueue[slot].atUs = uartHostFreeUs;
+    uartHostQueue[slot].baudRate = baudRate;
+    uartHostQueue[slot].data = data[i];
+    uartHostCount++;
+  }
+
+  return true;
+}
+
+/**
+ * @brief  State of a Nucleo LED.
+ * @param  led: LED.
+ * @retval bool: true while it is lit.
+ */
+bool SIM_LED_IsOn(Led_TypeDef led)
+{
+  return ledLit[led];
+}
+
+/* HAL ----------------------------------------------------------------------*/
+
+uint32_t HAL_GetTick(void)
+{
+  return (uint32_t)(nowUs / SIM_US_PER_MS);
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+  SIM_TIME_AdvanceUs((uint64_t)Delay * SIM_US_PER_MS);
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+  (void)IRQn;
+  (void)PreemptPriority;
+  (void)SubPriority;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+  (void)IRQn;
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+  (void)IRQn;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+  return SIM_PCLK1_HZ;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+  if (PinState == GPIO_PIN_SET)
+  {
+    GPIOx->ODR |= GPIO_Pin;
+  }
+  else
+  {
+    GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+  }
+}
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart)
+{
+  if (huart == NULL || huart->Init.BaudRate == 0U)
+  {
+    return HAL_ERROR;
+  }
+
+  huart->Instance->BRR = UART_BRR_SAMPLING16(SIM_PCLK1_HZ, huart->Init.BaudRate);
+  if (huart->Instance->BRR == 0U)
+  {
+    return HAL_ERROR;
+  }
+
+  uartBaudRate = huart->Init.BaudRate;
+  uartActualRate = (SIM_PCLK1_HZ + huart->Instance->BRR / 2U) / huart->Instance->BRR;
+  uartInitialised = true;
+  return HAL_OK;
+}
+
+/**
+ * @brief  Blocking transmit: the bytes go to the capture sink and the line time is charged to virtual time.
+ */
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+  uint64_t lineUs = ((uint64_t)Size * SIM_UART_BITS_PER_BYTE * SIM_US_PER_SECOND) / uartActualRate;
+
+  (void)huart;
+  (void)Timeout;
+
+  if (uartCapture != NULL)
+  {
+    fwrite(pData, 1, Size, uartCapture);
+  }
+
+  uartBytesSent += Size;
+  uartBusyUs += lineUs;
+  SIM_TIME_AdvanceUs(lineUs);
+
+  return HAL_OK;
+}
+
+/**
+ * @brief  Nothing is ever received: waits for the timeout like an idle line.
+ */
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+  (void)huart;
+  (void)pData;
+  (void)Size;
+
+  HAL_Delay(Timeout);
+  return HAL_TIMEOUT;
+}
+
+void HAL_PWR_EnableBkUpAccess(void)
+{
+}
+
+void HAL_RTC_MspInit(RTC_HandleTypeDef *hrtc)
+{
+  (void)hrtc;
+  simRcc.BDCR |= RCC_BDCR_RTCEN;
+}
+
+HAL_StatusTypeDef HAL_RTC_WaitForSynchro(RTC_HandleTypeDef *hrtc)
+{
+  (void)hrtc;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTC_SetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *sTime, uint32_t Format)
+{
+  timestamp_t now = rtcSeconds(nowUs);
+  uint32_t hours = (Format == RTC_FORMAT_BCD) ? bcdToBin(sTime->Hours) : sTime->Hours;
+  uint32_t minutes = (Format == RTC_FORMAT_BCD) ? bcdToBin(sTime->Minutes) : sTime->Minutes;
+  uint32_t seconds = (Format == RTC_FORMAT_BCD) ? bcdToBin(sTime->Seconds) : sTime->Seconds;
+
+  (void)hrtc;
+  simRcc.BDCR |= RCC_BDCR_RTCEN;
+  rtcRebase(now - (now % TIMESTAMP_SECONDS_PER_DAY) +
+            (hours * TIMESTAMP_SECONDS_PER_HOUR) + (minutes * TIMESTAMP_SECONDS_PER_MINUTE) + seconds);
+
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTC_GetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *sTime, uint32_t Format)
+{
+  RTC_DateTypeDef date;
+  uint32_t synchPrediv = (hrtc != NULL && hrtc->Init.SynchPrediv != 0U) ? hrtc->Init.SynchPrediv
+                                                                          : SIM_RTC_DEFAULT_SYNCH_PREDIV;
+  uint64_t fractionUs = rtcElapsedUs(nowUs) % SIM_US_PER_SECOND;
+
+  API_TIMESTAMP_ToRTC(rtcSeconds(nowUs), sTime, &date);
+  sTime->SecondFraction = synchPrediv;
+  sTime->SubSeconds = synchPrediv - (uint32_t)((fractionUs * (synchPrediv + 1U)) / SIM_US_PER_SECOND);
+
+  if (Format == RTC_FORMAT_BIN)
+  {
+    sTime->Hours = bcdToBin(sTime->Hours);
+    sTime->Minutes = bcdToBin(sTime->Minutes);
+    sTime->Seconds = bcdToBin(sTime->Seconds);
+  }
+
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTC_SetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *sDate, uint32_t Format)
+{
+  RTC_TimeTypeDef time;
+  RTC_DateTypeDef date = *sDate;
+  RTC_DateTypeDef unused;
+
+  if (Format == RTC_FORMAT_BIN)
+  {
+    date.Year = binToBcd(date.Year);
+    date.Month = binToBcd(date.Month);
+    date.Date = binToBcd(date.Date);
+  }
+
+  (void)hrtc;
+  API_TIMESTAMP_ToRTC(rtcSeconds(nowUs), &time, &unused);
+  rtcRebase(API_TIMESTAMP_FromRTC(&time, &date));
+
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTC_GetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *sDate, uint32_t Format)
+{
+  RTC_TimeTypeDef time;
+
+  (void)hrtc;
+  API_TIMESTAMP_ToRTC(rtcSeconds(nowUs), &time, sDate);
+
+  if (Format == RTC_FORMAT_BIN)
+  {
+    sDate->Year = bcdToBin(sDate->Year);
+    sDate->Month = bcdToBin(sDate->Month);
+    sDate->Date = bcdToBin(sDate->Date);
+  }
+
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTCEx_SetWakeUpTimer_IT(RTC_HandleTypeDef *hrtc, uint32_t WakeUpCounter, uint32_t WakeUpClock)
+{
+  (void)hrtc;
+  (void)WakeUpCounter;
+  (void)WakeUpClock;
+
+  rtcWakeupArmed = true;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTCEx_SetSmoothCalib(RTC_HandleTypeDef *hrtc, uint32_t SmoothCalibPeriod,
+                                           uint32_t SmoothCalibPlusPulses, uint32_t SmoothCalibMinusPulsesValue)
+{
+  timestamp_t calendar = rtcSeconds(nowUs);
+  int32_t pulses = -(int32_t)SmoothCalibMinusPulsesValue;
+
+  (void)hrtc;
+  (void)SmoothCalibPeriod;
+
+  if (SmoothCalibPlusPulses == RTC_SMOOTHCALIB_PLUSPULSES_SET)
+  {
+    pulses += (int32_t)SIM_CALIB_PLUS_PULSES;
+  }
+
+  rtcRebase(calendar);
+  rtcCalibPpm = pulses * SIM_CALIB_PPM_PER_PULSE;
+
+  return HAL_OK;
+}
+
+void HAL_RTCEx_BKUPWrite(RTC_HandleTypeDef *hrtc, uint32_t BackupRegister, uint32_t Data)
+{
+  (void)hrtc;
+  if (BackupRegister < RTC_BKP_NUMBER)
+  {
+    rtcBackup[BackupRegister] = Data;
+  }
+}
+
+uint32_t HAL_RTCEx_BKUPRead(RTC_HandleTypeDef *hrtc, uint32_t BackupRegister)
+{
+  (void)hrtc;
+  return (BackupRegister < RTC_BKP_NUMBER) ? rtcBackup[BackupRegister] : 0U;
+}
+
+/* BSP ----------------------------------------------------------------------*/
+
+void BSP_LED_Init(Led_TypeDef Led)
+{
+  ledLit[Led] = false;
+}
+
+void BSP_LED_On(Led_TypeDef Led)
+{
+  ledLit[Led] = true;
+}
+
+void BSP_LED_Off(Led_TypeDef Led)
+{
+  ledLit[Led] = false;
+}
+
+void BSP_LED_Toggle(Led_TypeDef Led)
+{
+  ledLit[Led] = !ledLit[Led];
+}
@@ -0,0 +1,178 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "sim.h"
+#include "API_lcd_port.h"
+
+/* Private constants ---------------------------------------------------------*/
+
+// PCF8574 outputs as wired on the LCD backpack
+#define SIM_LCD_PIN_RS 0x01U
+#define SIM_LCD_PIN_EN 0x04U
+#define SIM_LCD_DATA_MASK 0xF0U // P4-P7 drive D4-D7
+
+#define SIM_LCD_FUNCTION_DL 0x10U   // Function set: 8-bit interface
+#define SIM_LCD_LINE_2_ADDRESS 0x40U // DDRAM address of the second row
+#define SIM_LCD_DDRAM_SIZE 0x80U
+#define SIM_LCD_BLANK ' '
+
+/* Private variables ----------------------------------------------------------*/
+
+static uint8_t ddram[SIM_LCD_DDRAM_SIZE];
+static uint8_t address;
+static uint8_t lastPort;
+static bool fourBitMode;
+static bool highNibblePending; // In 4-bit mode, the first nibble of a byte was latched
+static uint8_t pendingByte;
+static uint32_t i2cWrites;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void execute(uint8_t value, bool data);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Executes one instruction or stores one character, as the HD44780 does once a full byte is latched.
+ * @param  uint8_t value: Byte.
+ * @param  bool data: true if RS was high (data register).
+ * @retval None
+ */
+static void execute(uint8_t value, bool data)
+{
+  if (data)
+  {
+    ddram[address] = value;
+    address = (uint8_t)((address + 1U) % SIM_LCD_DDRAM_SIZE);
+  }
+  else if (value & LCD_SET_DDRAM_CMD)
+  {
+    address = value & (SIM_LCD_DDRAM_SIZE - 1U);
+  }
+  else if (value & LCD_SET_CGRAM_CMD)
+  {
+    // Custom characters are not modelled
+  }
+  else if (value & LCD_FUNCTION_SET_CMD)
+  {
+    fourBitMode = (value & SIM_LCD_FUNCTION_DL) == 0U;
+  }
+  else if (value & LCD_RETURN_HOME_CMD)
+  {
+    address = 0;
+  }
+  else if (value & LCD_CLEAR_CMD)
+  {
+    memset(ddram, SIM_LCD_BLANK, sizeof(ddram));
+    address = 0;
+  }
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Power-on state: 8-bit interface, blank display.
+ * @param  None
+ * @retval None
+ */
+void SIM_LCD_Reset(void)
+{
+  memset(ddram, SIM_LCD_BLANK, sizeof(ddram));
+  address = 0;
+  lastPort = 0;
+  fourBitMode = false;
+  highNibblePending = false;
+  pendingByte = 0;
+  i2cWrites = 0;
+}
+
+/**
+ * @brief  Copies the visible characters of one row.
+ * @param  row: 0 or 1.
+ * @param  text: Destination, SIM_LCD_COLUMNS + 1 characters.
+ * @retval None
+ */
+void SIM_LCD_GetRow(uint8_t row, char *text)
+{
+  uint8_t start = (row == 0U) ? 0U : SIM_LCD_LINE_2_ADDRESS;
+
+  for (uint8_t column = 0; column < SIM_LCD_COLUMNS; column++)
+  {
+    uint8_t character = ddram[start + column];
+    text[column] = (character >= ' ' && character < 0x7FU) ? (char)character : '?';
+  }
+  text[SIM_LCD_COLUMNS] = '\0';
+}
+
+/**
+ * @brief  Prints the display as a framed grid.
+ * @param  out: Stream.
+ * @retval None
+ */
+void SIM_LCD_Print(FILE *out)
+{
+  char text[SIM_LCD_COLUMNS + 1U];
+
+  fprintf(out, "+----------------+\n");
+  for (uint8_t row = 0; row < SIM_LCD_ROWS; row++)
+  {
+    SIM_LCD_GetRow(row, text);
+    fprintf(out, "|%s|\n", text);
+  }
+  fprintf(out, "+----------------+\n");
+}
+
+/**
+ * @brief  Returns the number of I2C transactions to the expander, each an address and a data byte.
+ * @param  None
+ * @retval uint32_t: Transaction count.
+ */
+uint32_t SIM_LCD_GetI2cWrites(void)
+{
+  return i2cWrites;
+}
+
+/* LCD port -----------------------------------------------------------------*/
+
+/**
+ * @brief  One byte to the PCF8574: the HD44780 samples D4-D7 and RS on the falling edge of EN.
+ */
+void LCD_HAL_I2C_Write(uint8_t valor)
+{
+  // Address byte and data byte
+  i2cWrites++;
+  SIM_TIME_AdvanceUs((2ULL * SIM_I2C_BITS_PER_BYTE * SIM_US_PER_SECOND) / SIM_I2C_HZ);
+
+  if ((lastPort & SIM_LCD_PIN_EN) && !(valor & SIM_LCD_PIN_EN))
+  {
+    uint8_t nibble = valor & SIM_LCD_DATA_MASK;
+    bool data = (valor & SIM_LCD_PIN_RS) != 0U;
+
+    if (!fourBitMode)
+    {
+      // D0-D3 are not wired: they read as 0 during the 8-bit part of the init sequence
+      execute(nibble, data);
+    }
+    else if (!highNibblePending)
+    {
+      pendingByte = nibble;
+      highNibblePending = true;
+    }
+    else
+    {
+      highNibblePending = false;
+      execute((uint8_t)(pendingByte | (nibble >> 4)), data);
+    }
+  }
+
+  lastPort = valor;
+}
+
+void LCD_HAL_Delay(uint32_t delay)
+{
+  HAL_Delay(delay);
+}
+
+void LCD_HAL_Blink(Led_TypeDef Led)
+{
+  BSP_LED_Toggle(Led);
+}
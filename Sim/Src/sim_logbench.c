@@ -0,0 +1,555 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "API_log.h"
+#include "sim_check.h"
+
+/*
+ * Flash sample log against the flash model: port geometry, formatting, wrap-around, recovery and range reads.
+ *
+ *   sim_logbench [-n records] [-f flash.bin]
+ *
+ *   -n  Records appended, one per virtual second, at least 200000 so the sectors wrap, default 400000.
+ *   -f  Image file: the log area is written to it at exit, for inspection with the firmware's -f option.
+ *
+ * Geometry: the LOG_HAL_* port model covers LOG_FLASH_SECTOR_COUNT contiguous sectors of LOG_FLASH_SECTOR_SIZE,
+ * refuses out-of-range, misaligned and cross-sector programs, only clears bits, and refuses programs while a
+ * background erase runs for its erase time.
+ *
+ * Wrap: a blank area formats to sector 0 with sequence 1. The records walk slowly, with a temperature jump and a
+ * time gap now and then that no delta can hold, so blocks of every length are written. After the sectors wrapped,
+ * the sector sequences are consecutive in ring order (every sector erased in turn), every erase but the first
+ * opening of each sector is counted, nothing is dropped, and a full range read returns the newest records in
+ * order and bit for bit, at least three sectors of them.
+ *
+ * Recovery: a reboot (API_LOG_Init on the same flash) finds the same head and records. A reset between a block's
+ * header and its body (LOG_HAL_Program wrapped) leaves a torn block that the next boot counts and skips, and the
+ * log goes on after it.
+ *
+ * Range reads: random ranges against a binary search of the expected records, then the cost of a one-minute
+ * read, which skips sectors and blocks from their first timestamp. Host wall time, compare runs on one machine only.
+ *
+ * Exit status 1 if any check fails.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define LOGBENCH_DEFAULT_RECORDS 400000U      // About 2.5 times the area at 32 records per block
+#define LOGBENCH_MIN_RECORDS 200000U          // Enough to open every sector and reuse the first one
+#define LOGBENCH_START 776136000U             // 2024-08-05 01:20:00, the cold boot calendar
+#define LOGBENCH_JUMP_PERIOD 997U             // Records between temperature jumps, prime so jumps drift across blocks
+#define LOGBENCH_GAP_PERIOD 1499U             // Records between time gaps
+#define LOGBENCH_JUMP 300                     // 3 C, past an int8 delta
+#define LOGBENCH_GAP_S 600U                   // Past a uint8 delta
+#define LOGBENCH_RANGE_READS 1000U
+#define LOGBENCH_TIMED_READS 1000U
+#define LOGBENCH_TIMED_RANGE_S 60U
+#define LOGBENCH_TORN_RECORDS 10U
+#define LOGBENCH_NS_PER_SECOND 1e9
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief Range read state: the visited records are checked against the expected ones as they come.
+ */
+typedef struct
+{
+  const logRecord_t *expected; // Next expected record
+  uint32_t left;               // Expected records left
+  uint32_t mismatches;
+} readCheck_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+static logRecord_t *records; // Everything appended and not torn, in order
+static uint32_t recordCount;
+static bool tearArmed;        // Drops half the body of the next block, as a reset after its header would
+static bool tearHeaderPassed;
+static uint64_t programmedBytes;
+
+/* Private Function Prototypes ---------------------------------------------- */
+bool __real_LOG_HAL_Program(uint8_t sector, uint32_t offset, const uint32_t *words, uint16_t count);
+bool __wrap_LOG_HAL_Program(uint8_t sector, uint32_t offset, const uint32_t *words, uint16_t count);
+static logRecord_t makeRecord(uint32_t index, const logRecord_t *previous);
+static void appendRecords(uint32_t count);
+static bool visitCheck(const logRecord_t *record, void *context);
+static bool visitFirst(const logRecord_t *record, void *context);
+static bool visitCount(const logRecord_t *record, void *context);
+static uint32_t firstAtOrAfter(timestamp_t timestamp, uint32_t from);
+static uint32_t readAll(void);
+static int findHead(uint32_t *sequence);
+static void checkGeometry(void);
+static uint32_t checkWrap(uint32_t count);
+static void checkRecovery(uint32_t retainedFirst);
+static void checkTornBlock(void);
+static void checkRanges(uint32_t retainedFirst);
+static double nowNs(void);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Port program call, wrapped: counts the programmed bytes and, when armed, lets only half of the next
+ *         block body reach the cells and fails, as a reset between the header and the body would.
+ * @param  uint8_t sector: Sector index inside the log area.
+ * @param  uint32_t offset: Byte offset inside the sector.
+ * @param  const uint32_t *words: Words to program.
+ * @param  uint16_t count: Number of words.
+ * @retval bool: true on success.
+ */
+bool __wrap_LOG_HAL_Program(uint8_t sector, uint32_t offset, const uint32_t *words, uint16_t count)
+{
+  if (tearArmed && tearHeaderPassed)
+  {
+    tearArmed = false;
+    tearHeaderPassed = false;
+    __real_LOG_HAL_Program(sector, offset, words, (uint16_t)(count / 2U));
+    return false;
+  }
+  if (tearArmed && count == 1U && offset >= LOG_SECTOR_HEADER_SIZE && (words[0] & 0xFFU) == LOG_BLOCK_MAGIC)
+  {
+    tearHeaderPassed = true;
+  }
+
+  programmedBytes += (uint64_t)count * sizeof(uint32_t);
+  return __real_LOG_HAL_Program(sector, offset, words, count);
+}
+
+/**
+ * @brief  Next record of the test stream: one second and a small walk after the previous one, with a
+ *         temperature jump every LOGBENCH_JUMP_PERIOD and a time gap every LOGBENCH_GAP_PERIOD records.
+ * @param  uint32_t index: Record index.
+ * @param  const logRecord_t *previous: Previous record, NULL for the first.
+ * @retval logRecord_t: Record.
+ */
+static logRecord_t makeRecord(uint32_t index, const logRecord_t *previous)
+{
+  logRecord_t record = {LOGBENCH_START, 2200, 5000};
+
+  if (previous != NULL)
+  {
+    record = *previous;
+    record.timestamp += (index % LOGBENCH_GAP_PERIOD == 0U) ? LOGBENCH_GAP_S : 1U;
+    record.temperature = (int16_t)(record.temperature + (int16_t)((index * 7U) % 5U) - 2);
+    record.humidity = (uint16_t)(record.humidity + (index * 13U) % 7U - 3U);
+    if (index % LOGBENCH_JUMP_PERIOD == 0U)
+    {
+      record.temperature = (int16_t)(record.temperature + ((record.temperature > 2200) ? -LOGBENCH_JUMP : LOGBENCH_JUMP));
+    }
+  }
+
+  return record;
+}
+
+/**
+ * @brief  Appends records from the test stream, one virtual second apart, and keeps them for the checks.
+ * @param  uint32_t count: Records.
+ * @retval None
+ */
+static void appendRecords(uint32_t count)
+{
+  for (uint32_t i = 0; i < count; i++)
+  {
+    records[recordCount] = makeRecord(recordCount, (recordCount > 0U) ? &records[recordCount - 1U] : NULL);
+    API_LOG_Append(&records[recordCount]);
+    recordCount++;
+    SIM_TIME_AdvanceUs(SIM_US_PER_SECOND);
+  }
+}
+
+/**
+ * @brief  Visitor comparing each record with the next expected one.
+ * @param  const logRecord_t *record: Visited record.
+ * @param  void *context: readCheck_t.
+ * @retval bool: true to go on.
+ */
+static bool visitCheck(const logRecord_t *record, void *context)
+{
+  readCheck_t *state = context;
+
+  if (state->left == 0U || memcmp(record, state->expected, sizeof(*record)) != 0)
+  {
+    state->mismatches++;
+  }
+  else
+  {
+    state->expected++;
+    state->left--;
+  }
+
+  return true;
+}
+
+/**
+ * @brief  Visitor keeping the first record and stopping there.
+ * @param  const logRecord_t *record: Visited record.
+ * @param  void *context: logRecord_t receiving it.
+ * @retval bool: false, one record is enough.
+ */
+static bool visitFirst(const logRecord_t *record, void *context)
+{
+  *(logRecord_t *)context = *record;
+  return false;
+}
+
+/**
+ * @brief  Visitor that only lets the records be counted.
+ * @param  const logRecord_t *record: Visited record.
+ * @param  void *context: Unused.
+ * @retval bool: true to go on.
+ */
+static bool visitCount(const logRecord_t *record, void *context)
+{
+  (void)record;
+  (void)context;
+  return true;
+}
+
+/**
+ * @brief  First kept record at or after a timestamp (binary search, records are in time order).
+ * @param  timestamp_t timestamp: Timestamp.
+ * @param  uint32_t from: First index to consider.
+ * @retval uint32_t: Index, recordCount if none.
+ */
+static uint32_t firstAtOrAfter(timestamp_t timestamp, uint32_t from)
+{
+  uint32_t low = from;
+  uint32_t high = recordCount;
+
+  while (low < high)
+  {
+    uint32_t middle = low + (high - low) / 2U;
+
+    if (records[middle].timestamp < timestamp)
+    {
+      low = middle + 1U;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+
+  return low;
+}
+
+/**
+ * @brief  Reads the whole log and checks it against the kept records, from the oldest one it still holds.
+ * @param  None
+ * @retval uint32_t: Index of the oldest record read.
+ */
+static uint32_t readAll(void)
+{
+  logRecord_t oldest = {0};
+  readCheck_t state = {0};
+  uint32_t first;
+  uint32_t visited;
+
+  API_LOG_ReadRange(0, UINT32_MAX, visitFirst, &oldest);
+  first = firstAtOrAfter(oldest.timestamp, 0);
+
+  state.expected = &records[first];
+  state.left = recordCount - first;
+  visited = API_LOG_ReadRange(0, UINT32_MAX, visitCheck, &state);
+
+  check(state.mismatches == 0U, "records read back in order, bit for bit");
+  check(state.left == 0U && visited == recordCount - first, "every record since the oldest kept one read");
+
+  return first;
+}
+
+/**
+ * @brief  Finds the head sector from the sector headers.
+ * @param  uint32_t *sequence: Head sequence number.
+ * @retval int: Head sector, -1 without a valid header.
+ */
+static int findHead(uint32_t *sequence)
+{
+  int head = -1;
+
+  for (uint8_t sector = 0; sector < LOG_FLASH_SECTOR_COUNT; sector++)
+  {
+    const uint32_t *header = (const uint32_t *)LOG_HAL_Read(sector, 0);
+
+    if (header[0] == LOG_SECTOR_MAGIC && header[2] == ~header[1] && (head < 0 || header[1] > *sequence))
+    {
+      head = sector;
+      *sequence = header[1];
+    }
+  }
+
+  return head;
+}
+
+/**
+ * @brief  The port model against the flash geometry the log relies on.
+ * @param  None
+ * @retval None
+ */
+static void checkGeometry(void)
+{
+  uint32_t failuresBefore = failures;
+  uint32_t word = 0xF0F0FFFFUL;
+  uint32_t mask = 0x0FF0FF00UL;
+
+  SIM_FLASH_EraseAll();
+  for (uint8_t sector = 0; sector < LOG_FLASH_SECTOR_COUNT; sector++)
+  {
+    check(LOG_HAL_Read(sector, 0) == (const uint8_t *)_slogflash + (uint32_t)sector * LOG_FLASH_SECTOR_SIZE,
+          "sectors contiguous from _slogflash");
+    check(*(const uint32_t *)LOG_HAL_Read(sector, LOG_FLASH_SECTOR_SIZE - 4U) == LOG_FLASH_ERASED_WORD,
+          "erased area reads LOG_FLASH_ERASED_WORD");
+  }
+
+  check(!LOG_HAL_Program(LOG_FLASH_SECTOR_COUNT, 0, &word, 1), "program past the last sector refused");
+  check(!LOG_HAL_Program(0, 2, &word, 1), "misaligned program refused");
+  check(!LOG_HAL_Program(0, LOG_FLASH_SECTOR_SIZE - 4U, &word, 2), "program across a sector end refused");
+  check(LOG_HAL_Program(1, 0, &word, 1) && LOG_HAL_Program(1, 0, &mask, 1), "programs accepted");
+  check(*(const uint32_t *)LOG_HAL_Read(1, 0) == (word & mask), "programming only clears bits");
+  check(*(const uint32_t *)LOG_HAL_Read(0, LOG_FLASH_SECTOR_SIZE - 4U) == LOG_FLASH_ERASED_WORD &&
+            *(const uint32_t *)LOG_HAL_Read(1, 4) == LOG_FLASH_ERASED_WORD,
+        "program leaves its neighbours alone");
+
+  check(!LOG_HAL_EraseSector(LOG_FLASH_SECTOR_COUNT, false), "erase past the last sector refused");
+  check(LOG_HAL_EraseSector(1, true), "background erase started");
+  check(LOG_HAL_IsEraseBusy(), "controller busy during the erase");
+  check(!LOG_HAL_Program(2, 0, &word, 1), "program refused during an erase");
+  check(!LOG_HAL_EraseSector(2, true), "second erase refused during an erase");
+  SIM_TIME_AdvanceUs(SIM_US_PER_SECOND);
+  check(!LOG_HAL_IsEraseBusy(), "erase done after its erase time");
+  check(*(const uint32_t *)LOG_HAL_Read(1, 0) == LOG_FLASH_ERASED_WORD, "erase sets every bit");
+
+  printf("geometry: %u sectors of %lu KB\n", LOG_FLASH_SECTOR_COUNT, LOG_FLASH_SECTOR_SIZE / 1024UL);
+  checkSection(failuresBefore);
+}
+
+/**
+ * @brief  Formats a blank area, appends until the sectors wrapped, and checks sequences, erases and records.
+ * @param  uint32_t count: Records to append.
+ * @retval uint32_t: Index of the oldest record the log holds.
+ */
+static uint32_t checkWrap(uint32_t count)
+{
+  uint32_t failuresBefore = failures;
+  uint32_t minBlocksPerSector = (LOG_FLASH_SECTOR_SIZE - LOG_SECTOR_HEADER_SIZE) /
+                                (LOG_BLOCK_HEADER_SIZE + LOG_BLOCK_MAX_BODY_WORDS * 4U);
+  uint32_t sequence = 0;
+  int head;
+
+  SIM_FLASH_EraseAll();
+  uint32_t erasesBefore = SIM_FLASH_GetEraseCount();
+  check(API_LOG_Init(), "blank area formatted");
+  head = findHead(&sequence);
+  check(head == 0 && sequence == 1U && API_LOG_GetStatus().headSequence == 1U, "format opens sector 0, sequence 1");
+
+  double start = nowNs();
+  appendRecords(count);
+  double appendNs = (nowNs() - start) / count;
+  check(API_LOG_Flush(), "staging block flushed");
+
+  logStatus_t status = API_LOG_GetStatus();
+  head = findHead(&sequence);
+  check(head >= 0 && sequence == status.headSequence, "head found from the sector headers");
+  check(status.headSequence > LOG_FLASH_SECTOR_COUNT, "sectors wrapped");
+  for (uint32_t back = 1; back < LOG_FLASH_SECTOR_COUNT - 1U; back++)
+  {
+    const uint32_t *header = (const uint32_t *)LOG_HAL_Read((uint8_t)((head + LOG_FLASH_SECTOR_COUNT - back) % LOG_FLASH_SECTOR_COUNT), 0);
+
+    check(header[0] == LOG_SECTOR_MAGIC && header[1] == status.headSequence - back,
+          "sector sequences consecutive in ring order");
+  }
+
+  // The sector after the head holds the oldest data, unless the pre-erase already cleared it
+  const uint32_t *next = (const uint32_t *)LOG_HAL_Read((uint8_t)((head + 1) % LOG_FLASH_SECTOR_COUNT), 0);
+  bool preErased = next[0] == LOG_FLASH_ERASED_WORD;
+  check(preErased || next[1] == status.headSequence - (LOG_FLASH_SECTOR_COUNT - 1U), "oldest sector next to the head");
+  uint32_t expectedErases = status.headSequence - LOG_FLASH_SECTOR_COUNT + (preErased ? 1U : 0U);
+  check(status.erases == expectedErases && SIM_FLASH_GetEraseCount() - erasesBefore == expectedErases,
+        "one erase per sector reuse");
+  check(status.dropped == 0U, "nothing dropped");
+
+  uint32_t first = readAll();
+
+  check(API_LOG_Init(), "reboot");
+  status = API_LOG_GetStatus();
+  check(status.blocks >= (LOG_FLASH_SECTOR_COUNT - 1U) * minBlocksPerSector, "at least three sectors of blocks kept");
+
+  printf("wrap: %u records, %u sectors opened, %u erases, %u records kept, %.2f bytes per record, "
+         "%.0f ns per append\n",
+         count, status.headSequence, expectedErases, recordCount - first, (double)programmedBytes / count, appendNs);
+  checkSection(failuresBefore);
+
+  return first;
+}
+
+/**
+ * @brief  A reboot finds the same head and records, and the log goes on.
+ * @param  uint32_t retainedFirst: Oldest record before the reboot.
+ * @retval None
+ */
+static void checkRecovery(uint32_t retainedFirst)
+{
+  uint32_t failuresBefore = failures;
+  uint32_t sequence = API_LOG_GetStatus().headSequence;
+
+  check(API_LOG_Init(), "reboot");
+  check(API_LOG_GetStatus().headSequence == sequence, "same head after the reboot");
+  check(API_LOG_GetStatus().tornBlocks == 0U, "no torn block after a clean stop");
+  check(readAll() == retainedFirst, "same records after the reboot");
+
+  appendRecords(LOG_BLOCK_MAX_RECORDS * 3U + 5U);
+  check(readAll() >= retainedFirst, "appends go on after the reboot, staged records included");
+
+  printf("reboot: head sequence %u\n", sequence);
+  checkSection(failuresBefore);
+}
+
+/**
+ * @brief  A reset between a block's header and its body: the next boot counts the torn block and skips it.
+ * @param  None
+ * @retval None
+ */
+static void checkTornBlock(void)
+{
+  uint32_t failuresBefore = failures;
+
+  check(API_LOG_Flush(), "staging block flushed");
+  appendRecords(LOGBENCH_TORN_RECORDS);
+  tearArmed = true;
+  API_LOG_Flush();
+  check(!tearArmed, "block body torn");
+  check(API_LOG_GetStatus().dropped == LOGBENCH_TORN_RECORDS, "torn records counted as dropped");
+
+  // The torn records never made it, the stream goes on from the last record written
+  recordCount -= LOGBENCH_TORN_RECORDS;
+  check(API_LOG_Init(), "reboot");
+  check(API_LOG_GetStatus().tornBlocks == 1U, "torn block found by the recovery scan");
+
+  appendRecords(LOG_BLOCK_MAX_RECORDS * 2U);
+  check(API_LOG_Flush(), "staging block flushed");
+  readAll();
+
+  printf("torn block: %u records lost, %u torn block after the reboot\n", LOGBENCH_TORN_RECORDS,
+         API_LOG_GetStatus().tornBlocks);
+  checkSection(failuresBefore);
+}
+
+/**
+ * @brief  Random range reads against the kept records, then the cost of a one-minute read.
+ * @param  uint32_t retainedFirst: Oldest record the log holds.
+ * @retval None
+ */
+static void checkRanges(uint32_t retainedFirst)
+{
+  uint32_t failuresBefore = failures;
+  timestamp_t oldest = records[retainedFirst].timestamp;
+  timestamp_t span = records[recordCount - 1U].timestamp - oldest;
+  uint32_t visitedMinute = 0;
+
+  srand(1);
+  for (uint32_t i = 0; i < LOGBENCH_RANGE_READS; i++)
+  {
+    timestamp_t from = oldest - 100U + (timestamp_t)((uint64_t)rand() * (span + 200U) / RAND_MAX);
+    timestamp_t to = from + (timestamp_t)(rand() % 5000);
+    uint32_t begin = firstAtOrAfter(from, retainedFirst);
+    uint32_t end = firstAtOrAfter(to + 1U, retainedFirst);
+    readCheck_t state = {&records[begin], end - begin, 0};
+
+    uint32_t visited = API_LOG_ReadRange(from, to, visitCheck, &state);
+    check(state.mismatches == 0U && state.left == 0U && visited == end - begin, "range read matches");
+  }
+
+  double start = nowNs();
+  for (uint32_t i = 0; i < LOGBENCH_TIMED_READS; i++)
+  {
+    timestamp_t from = oldest + (timestamp_t)((uint64_t)rand() * span / RAND_MAX);
+
+    visitedMinute += API_LOG_ReadRange(from, from + LOGBENCH_TIMED_RANGE_S - 1U, visitCount, NULL);
+  }
+  double minuteNs = (nowNs() - start) / LOGBENCH_TIMED_READS;
+
+  start = nowNs();
+  uint32_t visitedAll = API_LOG_ReadRange(0, UINT32_MAX, visitCount, NULL);
+  double allNs = nowNs() - start;
+
+  printf("range reads: %u checked; one minute %.0f ns (%.1f records), everything %.0f ns (%u records)\n",
+         LOGBENCH_RANGE_READS, minuteNs, (double)visitedMinute / LOGBENCH_TIMED_READS, allNs, visitedAll);
+  checkSection(failuresBefore);
+}
+
+/**
+ * @brief  Monotonic host time.
+ * @param  None
+ * @retval double: ns.
+ */
+static double nowNs(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec * LOGBENCH_NS_PER_SECOND + (double)now.tv_nsec;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+  uint32_t count = LOGBENCH_DEFAULT_RECORDS;
+  const char *imagePath = NULL;
+  uint32_t first;
+  int option;
+
+  while ((option = getopt(argc, argv, "n:f:")) != -1)
+  {
+    switch (option)
+    {
+    case 'n':
+      count = (uint32_t)strtoul(optarg, NULL, 10);
+      if (count < LOGBENCH_MIN_RECORDS)
+      {
+        fprintf(stderr, "-n: at least %u records to wrap the sectors\n", LOGBENCH_MIN_RECORDS);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'f':
+      imagePath = optarg;
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-n records] [-f flash.bin]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Room for the wrap run and the records appended after it
+  records = malloc(((size_t)count + LOG_BLOCK_MAX_RECORDS * 8U) * sizeof(logRecord_t));
+  if (records == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+
+  SIM_TIME_Reset();
+  checkGeometry();
+  first = checkWrap(count);
+  checkRecovery(first);
+  checkTornBlock();
+  checkRanges(readAll());
+
+  if (imagePath != NULL && !SIM_FLASH_Save(imagePath))
+  {
+    perror(imagePath);
+  }
+  free(records);
+
+  if (failures != 0U)
+  {
+    printf("FAIL: %u checks\n", failures);
+    return EXIT_FAILURE;
+  }
+
+  printf("OK: geometry, wrap, recovery and range reads\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,236 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "API_app.h"
+
+/*
+ * Runs the firmware super loop of Core/Src/main.c against the virtual peripherals.
+ *
+ *   sim_firmware [-d seconds] [-t trace.csv | -T degC -H %RH] [-c T1,T2,T3,H1,H2,H3,H4,H5,H6] [-u uart.txt]
+ *                [-l seconds] [-f flash.bin] [-s sd.bin] [-p ppm] [-e udp.pcap]
+ *
+ *   -d  Virtual run time, default one day.
+ *   -t  Environment trace, "ms,temperature,humidity" per line.
+ *   -T  Constant temperature, when no trace is given.
+ *   -H  Constant humidity, when no trace is given.
+ *   -c  BME280 trimming parameters, default typical values.
+ *   -u  USART3 capture file, "-" for stdout.
+ *   -l  Print the LCD every given virtual seconds, 0 for only at the end.
+ *   -f  Flash image: loaded at start if it exists, written at exit (simulates reboots across runs).
+ *   -s  SD card image: loaded at start if it exists (a blank card otherwise), written at exit. No card without it.
+ *   -p  RTC crystal error in ppm.
+ *   -e  Plugs the Ethernet cable and writes the UDP telemetry frames to a pcap file. Unplugged without it.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define SIM_DEFAULT_DURATION_S 86400U
+#define SIM_DEFAULT_SD_BLOCKS 16384U // 8 MB blank card
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void usage(const char *program);
+static bool parseCalibration(const char *text, simBme280Calib_t *calib);
+
+/* Private Function Definitions --------------------------------------------- */
+
+static void usage(const char *program)
+{
+  fprintf(stderr,
+          "usage: %s [-d seconds] [-t trace.csv | -T degC -H %%RH] [-c T1,T2,T3,H1,H2,H3,H4,H5,H6] [-u uart.txt]\n"
+          "       [-l seconds] [-f flash.bin] [-s sd.bin] [-p ppm] [-e udp.pcap]\n",
+          program);
+  exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief  Parses "T1,T2,T3,H1,H2,H3,H4,H5,H6" trimming values.
+ * @param  const char *text: Option argument.
+ * @param  simBme280Calib_t *calib: Parsed values.
+ * @retval bool: true if all nine values were given.
+ */
+static bool parseCalibration(const char *text, simBme280Calib_t *calib)
+{
+  int value[9];
+
+  if (sscanf(text, "%d,%d,%d,%d,%d,%d,%d,%d,%d", &value[0], &value[1], &value[2], &value[3], &value[4], &value[5],
+             &value[6], &value[7], &value[8]) != 9)
+  {
+    return false;
+  }
+
+  calib->T1 = (uint16_t)value[0];
+  calib->T2 = (int16_t)value[1];
+  calib->T3 = (int16_t)value[2];
+  calib->H1 = (uint8_t)value[3];
+  calib->H2 = (int16_t)value[4];
+  calib->H3 = (uint8_t)value[5];
+  calib->H4 = (int16_t)value[6];
+  calib->H5 = (int16_t)value[7];
+  calib->H6 = (int8_t)value[8];
+
+  return true;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+  uint64_t durationUs = SIM_DEFAULT_DURATION_S * SIM_US_PER_SECOND;
+  uint64_t lcdIntervalUs = 0;
+  uint64_t nextLcdUs;
+  const char *tracePath = NULL;
+  const char *uartPath = NULL;
+  const char *flashPath = NULL;
+  const char *sdPath = NULL;
+  const char *pcapPath = NULL;
+  float temperature = 25.0f;
+  float humidity = 50.0f;
+  int32_t driftPpm = 0;
+  simBme280Calib_t calib;
+  const simBme280Calib_t *customCalib = NULL;
+  FILE *uart = NULL;
+  FILE *pcap = NULL;
+  int option;
+
+  while ((option = getopt(argc, argv, "d:t:T:H:c:u:l:f:s:p:e:")) != -1)
+  {
+    switch (option)
+    {
+    case 'd':
+      durationUs = strtoull(optarg, NULL, 10) * SIM_US_PER_SECOND;
+      break;
+    case 't':
+      tracePath = optarg;
+      break;
+    case 'T':
+      temperature = strtof(optarg, NULL);
+      break;
+    case 'H':
+      humidity = strtof(optarg, NULL);
+      break;
+    case 'c':
+      if (!parseCalibration(optarg, &calib))
+      {
+        usage(argv[0]);
+      }
+      customCalib = &calib;
+      break;
+    case 'u':
+      uartPath = optarg;
+      break;
+    case 'l':
+      lcdIntervalUs = strtoull(optarg, NULL, 10) * SIM_US_PER_SECOND;
+      break;
+    case 'f':
+      flashPath = optarg;
+      break;
+    case 's':
+      sdPath = optarg;
+      break;
+    case 'p':
+      driftPpm = (int32_t)strtol(optarg, NULL, 10);
+      break;
+    case 'e':
+      pcapPath = optarg;
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  if (uartPath != NULL)
+  {
+    uart = (strcmp(uartPath, "-") == 0) ? stdout : fopen(uartPath, "w");
+    if (uart == NULL)
+    {
+      perror(uartPath);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (pcapPath != NULL)
+  {
+    pcap = fopen(pcapPath, "wb");
+    if (pcap == NULL)
+    {
+      perror(pcapPath);
+      return EXIT_FAILURE;
+    }
+  }
+
+  SIM_RTC_PowerOnReset();
+  SIM_RTC_SetDriftPpm(driftPpm);
+  SIM_TIME_Reset();
+  SIM_UART_SetCapture(uart);
+  SIM_LCD_Reset();
+  SIM_BME280_Reset(customCalib);
+  SIM_BME280_SetEnvironment(temperature, humidity);
+  if (tracePath != NULL && !SIM_BME280_LoadTrace(tracePath))
+  {
+    fprintf(stderr, "%s: no trace points\n", tracePath);
+    return EXIT_FAILURE;
+  }
+  SIM_FLASH_EraseAll();
+  if (flashPath != NULL)
+  {
+    SIM_FLASH_Load(flashPath);
+  }
+  SIM_SD_Reset(0);
+  if (sdPath != NULL && !SIM_SD_Load(sdPath))
+  {
+    SIM_SD_Reset(SIM_DEFAULT_SD_BLOCKS);
+  }
+  SIM_ETH_Reset();
+  SIM_ETH_SetLink(pcap != NULL);
+  SIM_ETH_SetCapture(pcap);
+
+  clock_t wallStart = clock();
+
+  SIM_BOARD_Init();
+
+  nextLcdUs = lcdIntervalUs;
+  while (SIM_TIME_NowUs() < durationUs)
+  {
+    SIM_BOARD_Step();
+
+    if (lcdIntervalUs != 0U && SIM_TIME_NowUs() >= nextLcdUs)
+    {
+      fprintf(stderr, "t=%llu s\n", (unsigned long long)(SIM_TIME_NowUs() / SIM_US_PER_SECOND));
+      SIM_LCD_Print(stderr);
+      nextLcdUs += lcdIntervalUs;
+    }
+  }
+
+  double wallSeconds = (double)(clock() - wallStart) / CLOCKS_PER_SEC;
+  double virtualSeconds = (double)SIM_TIME_NowUs() / SIM_US_PER_SECOND;
+
+  if (flashPath != NULL && !SIM_FLASH_Save(flashPath))
+  {
+    perror(flashPath);
+  }
+  if (sdPath != NULL && !SIM_SD_Save(sdPath))
+  {
+    perror(sdPath);
+  }
+  if (uart != NULL && uart != stdout)
+  {
+    fclose(uart);
+  }
+  if (pcap != NULL)
+  {
+    SIM_ETH_SetCapture(NULL);
+    fclose(pcap);
+  }
+
+  SIM_LCD_Print(stderr);
+  fprintf(stderr, "virtual %.0f s, wall %.2f s, speed-up %.0fx\n", virtualSeconds, wallSeconds,
+          (wallSeconds > 0.0) ? virtualSeconds / wallSeconds : 0.0);
+  fprintf(stderr, "uart %u bytes, flash erases %u, sd blocks written %u, udp frames %u\n", SIM_UART_GetBytesSent(),
+          SIM_FLASH_GetEraseCount(), SIM_SD_GetBlocksWritten(), SIM_ETH_GetFramesSent());
+
+  return EXIT_SUCCESS;
+}
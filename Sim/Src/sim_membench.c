@@ -0,0 +1,285 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "API_mem.h"
+#include "sim_check.h"
+
+/*
+ * API_mem.h fixed-block pools and heap seal against their contract, then alloc/free throughput.
+ *
+ *   sim_membench [-n cycles]
+ *
+ *   -n  Random alloc/free steps, default 1 million.
+ *
+ * Per pool: every block can be taken, blocks are distinct, MEM_ALIGN-aligned and do not overlap, and one more
+ * request fails and is counted (exhaustion). A block freed twice, a pointer into the middle of a block, one past
+ * the pool, one outside it and NULL are all refused and counted without changing the occupancy. Random alloc/free
+ * steps then keep a pattern in every block in use and check it on free, so two owners of one block show; after
+ * them every block can be taken again (no leak, no fragmentation). The heap grows before API_MEM_Seal and is
+ * refused after it.
+ *
+ * Throughput: alloc and free pairs in ns, host wall time, compare runs on one machine only.
+ *
+ * Exit status 1 if any check fails.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define MEMBENCH_DEFAULT_CYCLES 1000000U
+#define MEMBENCH_PAIRS 10000000U
+#define MEMBENCH_NS_PER_SECOND 1e9
+
+/* Private variables ----------------------------------------------------------*/
+
+static void *volatile sink; // Keeps the timed blocks alive
+
+/* Private Function Prototypes ---------------------------------------------- */
+static double nowNs(void);
+static uint8_t pattern(void *block);
+static bool holdsPattern(void *block, uint16_t size);
+static void checkPool(memPool_t pool, uint32_t cycles);
+static void checkHeap(void);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Monotonic host time.
+ * @param  None
+ * @retval double: ns.
+ */
+static double nowNs(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec * MEMBENCH_NS_PER_SECOND + (double)now.tv_nsec;
+}
+
+/**
+ * @brief  Fill byte owned by a block, derived from its address.
+ * @param  block: Block.
+ * @retval uint8_t: Fill byte.
+ */
+static uint8_t pattern(void *block)
+{
+  uintptr_t address = (uintptr_t)block;
+
+  return (uint8_t)((address >> 3) ^ (address >> 11) ^ 0xA5U);
+}
+
+/**
+ * @brief  Checks that a block still holds its own fill byte everywhere.
+ * @param  block: Block.
+ * @param  size: Block size.
+ * @retval bool: true if untouched by any other owner.
+ */
+static bool holdsPattern(void *block, uint16_t size)
+{
+  const uint8_t *bytes = block;
+  uint8_t fill = pattern(block);
+
+  for (uint16_t i = 0; i < size; i++)
+  {
+    if (bytes[i] != fill)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief  Exhaustion, invalid frees, random alloc/free steps and throughput on one pool.
+ * @param  pool: Pool.
+ * @param  cycles: Random alloc/free steps.
+ * @retval None
+ */
+static void checkPool(memPool_t pool, uint32_t cycles)
+{
+  uint16_t size = API_MEM_PoolBlockSize(pool);
+  memStats_t stats;
+  uint32_t count;
+  uint32_t failuresBefore = failures;
+  uint8_t outside[MEM_ALIGN * 2U];
+
+  API_MEM_Init();
+  API_MEM_GetPoolStats(pool, &stats);
+  count = stats.capacity;
+
+  void **blocks = calloc(count, sizeof(void *));
+  uint8_t *lowest = NULL;
+
+  // Exhaustion
+  for (uint32_t i = 0; i < count; i++)
+  {
+    blocks[i] = API_MEM_PoolAlloc(pool);
+    check(blocks[i] != NULL, "every block can be taken");
+    if (blocks[i] == NULL)
+    {
+      free(blocks);
+      return;
+    }
+    check((uintptr_t)blocks[i] % MEM_ALIGN == 0U, "block aligned to MEM_ALIGN");
+    memset(blocks[i], pattern(blocks[i]), size);
+    if (lowest == NULL || (uint8_t *)blocks[i] < lowest)
+    {
+      lowest = blocks[i];
+    }
+  }
+  for (uint32_t i = 0; i < count; i++)
+  {
+    check(holdsPattern(blocks[i], size), "blocks distinct and not overlapping");
+  }
+  check(API_MEM_PoolAlloc(pool) == NULL, "exhausted pool refuses a request");
+  API_MEM_GetPoolStats(pool, &stats);
+  check(stats.used == count && stats.highWater == count, "exhausted pool fully used");
+  check(stats.failures == 1U, "exhaustion counted once");
+
+  // Double free
+  check(API_MEM_PoolFree(pool, blocks[0]), "block released");
+  check(!API_MEM_PoolFree(pool, blocks[0]), "double free refused");
+
+  // Foreign pointers, the occupancy must not change
+  check(!API_MEM_PoolFree(pool, (uint8_t *)blocks[1] + MEM_ALIGN), "pointer inside a block refused");
+  check(!API_MEM_PoolFree(pool, lowest + (size_t)count * size), "pointer past the pool refused");
+  check(!API_MEM_PoolFree(pool, lowest - size), "pointer before the pool refused");
+  check(!API_MEM_PoolFree(pool, outside), "pointer outside the pool refused");
+  check(!API_MEM_PoolFree(pool, NULL), "NULL refused");
+  check(!API_MEM_PoolFree(MEM_POOL_COUNT, blocks[1]), "invalid pool refused");
+  API_MEM_GetPoolStats(pool, &stats);
+  check(stats.used == count - 1U, "refused frees leave the occupancy alone");
+  check(stats.failures == 7U, "every refused free counted");
+  check(holdsPattern(blocks[1], size), "refused frees leave the blocks alone");
+
+  for (uint32_t i = 1; i < count; i++)
+  {
+    check(API_MEM_PoolFree(pool, blocks[i]), "block released");
+  }
+
+  // Random alloc/free steps with a shadow of the blocks in use
+  uint32_t held = 0;
+  uint32_t refused = 0;
+
+  srand(1);
+  for (uint32_t step = 0; step < cycles; step++)
+  {
+    if (held < count && (held == 0U || rand() % 2 == 0))
+    {
+      void *block = API_MEM_PoolAlloc(pool);
+
+      check(block != NULL, "free block available");
+      if (block != NULL)
+      {
+        memset(block, pattern(block), size);
+        blocks[held++] = block;
+      }
+    }
+    else
+    {
+      uint32_t victim = (uint32_t)rand() % held;
+
+      check(holdsPattern(blocks[victim], size), "block kept by its single owner");
+      check(API_MEM_PoolFree(pool, blocks[victim]), "held block released");
+      blocks[victim] = blocks[--held];
+    }
+    if (held == count)
+    {
+      refused += (API_MEM_PoolAlloc(pool) == NULL) ? 1U : 0U;
+    }
+  }
+  API_MEM_GetPoolStats(pool, &stats);
+  check(stats.used == held, "occupancy follows the alloc/free steps");
+  while (held > 0U)
+  {
+    check(API_MEM_PoolFree(pool, blocks[--held]), "held block released");
+  }
+  for (uint32_t i = 0; i < count; i++)
+  {
+    blocks[i] = API_MEM_PoolAlloc(pool);
+    check(blocks[i] != NULL, "every block can be taken again after the steps");
+  }
+  for (uint32_t i = 0; i < count; i++)
+  {
+    API_MEM_PoolFree(pool, blocks[i]);
+  }
+
+  // Throughput
+  double start = nowNs();
+  for (uint32_t pair = 0; pair < MEMBENCH_PAIRS; pair++)
+  {
+    sink = API_MEM_PoolAlloc(pool);
+    API_MEM_PoolFree(pool, sink);
+  }
+  double pairNs = (nowNs() - start) / MEMBENCH_PAIRS;
+
+  printf("pool %u: %u x %u B, %u steps, %u refused while full, %.1f ns per alloc/free pair\n", pool, count, size,
+         cycles, refused, pairNs);
+  checkSection(failuresBefore);
+  free(blocks);
+}
+
+/**
+ * @brief  C library heap accounting around the seal.
+ * @param  None
+ * @retval None
+ */
+static void checkHeap(void)
+{
+  uint32_t failuresBefore = failures;
+  memStats_t stats;
+
+  API_MEM_Init();
+  check(!API_MEM_IsSealed(), "unsealed after init");
+  check(API_MEM_HeapRequest(64), "heap grows before the seal");
+  API_MEM_Seal();
+  check(API_MEM_IsSealed(), "sealed");
+  check(!API_MEM_HeapRequest(64), "heap growth refused after the seal");
+  check(API_MEM_HeapRequest(-64), "heap shrink granted after the seal");
+  API_MEM_GetHeapStats(&stats);
+  check(stats.failures == 1U, "refused growth counted");
+  check(stats.highWater == 64U, "heap high-water mark");
+
+  printf("heap seal\n");
+  checkSection(failuresBefore);
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+  uint32_t cycles = MEMBENCH_DEFAULT_CYCLES;
+  int option;
+
+  while ((option = getopt(argc, argv, "n:")) != -1)
+  {
+    switch (option)
+    {
+    case 'n':
+      cycles = (uint32_t)strtoul(optarg, NULL, 10);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-n cycles]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  for (memPool_t pool = 0; pool < MEM_POOL_COUNT; pool++)
+  {
+    checkPool(pool, cycles);
+  }
+  checkHeap();
+
+  if (failures != 0U)
+  {
+    printf("FAIL: %u checks\n", failures);
+    return EXIT_FAILURE;
+  }
+
+  printf("OK: pools and heap seal behave\n");
+  return EXIT_SUCCESS;
+}
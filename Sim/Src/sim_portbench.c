@@ -0,0 +1,154 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <time.h>
+
+#include "API_lcd_port.h"
+
+/*
+ * Cost of one LCD expander write through each way of binding the port:
+ *
+ *   direct   HAL_I2C_Master_Transmit called in place, the baseline
+ *   inline   LCD_HAL_I2C_Write from API_lcd_port.h with API_PORT_STATIC_INLINE = 1
+ *   extern   out-of-line port function, the API_PORT_STATIC_INLINE = 0 binding
+ *   vtable   call through a table of function pointers, the run-time alternative
+ *
+ * Exit status 1 if the inline port is more than SIM_BENCH_TOLERANCE slower than the direct call.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define SIM_BENCH_ITERATIONS 20000000U
+#define SIM_BENCH_REPEATS 7U        // Best of, to reject scheduling noise
+#define SIM_BENCH_TOLERANCE 1.05    // Allowed inline / direct ratio
+#define SIM_BENCH_NS_PER_SECOND 1e9
+
+/* Private types -------------------------------------------------------------*/
+
+typedef enum
+{
+  BENCH_DIRECT = 0,
+  BENCH_INLINE,
+  BENCH_EXTERN,
+  BENCH_VTABLE,
+  BENCH_BINDING_COUNT,
+} benchBinding_t;
+
+typedef struct
+{
+  void (*write)(uint8_t valor);
+} benchBus_t;
+
+typedef void (*benchLoop_t)(uint32_t iterations);
+
+/* Private variables ----------------------------------------------------------*/
+
+void benchExternWrite(uint8_t valor);
+
+static const benchBus_t externBus = {.write = benchExternWrite};
+static const benchBus_t *volatile bus = &externBus; // volatile: the call cannot be devirtualised
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void loopDirect(uint32_t iterations);
+static void loopInline(uint32_t iterations);
+static void loopExtern(uint32_t iterations);
+static void loopVtable(uint32_t iterations);
+static double measure(benchLoop_t loop);
+
+/* Private Function Definitions --------------------------------------------- */
+
+__attribute__((noinline)) static void loopDirect(uint32_t iterations)
+{
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    uint8_t valor = (uint8_t)i;
+    HAL_I2C_Master_Transmit(&hi2c1, LCD_I2C_ADDRESS << LCD_WRITE_CMD, &valor, sizeof(valor), HAL_MAX_DELAY);
+  }
+}
+
+__attribute__((noinline)) static void loopInline(uint32_t iterations)
+{
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    LCD_HAL_I2C_Write((uint8_t)i);
+  }
+}
+
+__attribute__((noinline)) static void loopExtern(uint32_t iterations)
+{
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    benchExternWrite((uint8_t)i);
+  }
+}
+
+__attribute__((noinline)) static void loopVtable(uint32_t iterations)
+{
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    bus->write((uint8_t)i);
+  }
+}
+
+/**
+ * @brief  Per-call time of one run of a loop.
+ * @param  benchLoop_t loop: Loop under test.
+ * @retval double: Nanoseconds per write.
+ */
+static double measure(benchLoop_t loop)
+{
+  struct timespec start;
+  struct timespec end;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  loop(SIM_BENCH_ITERATIONS);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  return ((double)(end.tv_sec - start.tv_sec) * SIM_BENCH_NS_PER_SECOND + (double)(end.tv_nsec - start.tv_nsec)) /
+         SIM_BENCH_ITERATIONS;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+int main(void)
+{
+  static const benchLoop_t loops[BENCH_BINDING_COUNT] = {
+      [BENCH_DIRECT] = loopDirect,
+      [BENCH_INLINE] = loopInline,
+      [BENCH_EXTERN] = loopExtern,
+      [BENCH_VTABLE] = loopVtable,
+  };
+  double best[BENCH_BINDING_COUNT];
+
+  // Each repeat runs every binding in turn, so a frequency or scheduling change hits them all alike
+  for (uint32_t repeat = 0; repeat < SIM_BENCH_REPEATS; repeat++)
+  {
+    for (benchBinding_t binding = 0; binding < BENCH_BINDING_COUNT; binding++)
+    {
+      double ns = measure(loops[binding]);
+      if (repeat == 0U || ns < best[binding])
+      {
+        best[binding] = ns;
+      }
+    }
+  }
+
+  double direct = best[BENCH_DIRECT];
+  double inlined = best[BENCH_INLINE];
+  double external = best[BENCH_EXTERN];
+  double vtable = best[BENCH_VTABLE];
+
+  printf("%-8s %10s %8s\n", "binding", "ns/write", "ratio");
+  printf("%-8s %10.3f %8.3f\n", "direct", direct, 1.0);
+  printf("%-8s %10.3f %8.3f\n", "inline", inlined, inlined / direct);
+  printf("%-8s %10.3f %8.3f\n", "extern", external, external / direct);
+  printf("%-8s %10.3f %8.3f\n", "vtable", vtable, vtable / direct);
+
+  if (inlined > direct * SIM_BENCH_TOLERANCE)
+  {
+    printf("FAIL: static inline port slower than the direct HAL call\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("OK: static inline port within %.0f %% of the direct HAL call\n", (SIM_BENCH_TOLERANCE - 1.0) * 100.0);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,36 @@
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f4xx_hal.h"
+
+/*
+ * Out-of-line side of sim_portbench: the HAL call and the link-time port live in their own
+ * translation unit, as on the target, so the compiler cannot inline them into the benchmark loop.
+ */
+
+/* Public variables ----------------------------------------------------------*/
+
+I2C_HandleTypeDef hi2c1;
+volatile uint32_t benchSink; // Keeps the transfers observable
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Stand-in for the blocking HAL transfer: consumes the byte and returns.
+ */
+__attribute__((noinline)) HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+                                                                    const uint8_t *pData, uint16_t Size,
+                                                                    uint32_t Timeout)
+{
+  (void)hi2c;
+  (void)Timeout;
+
+  benchSink += (uint32_t)DevAddress + pData[Size - 1U];
+  return HAL_OK;
+}
+
+/**
+ * @brief  The port function as compiled by API_lcd_port.c with API_PORT_STATIC_INLINE = 0.
+ */
+__attribute__((noinline)) void benchExternWrite(uint8_t valor)
+{
+  HAL_I2C_Master_Transmit(&hi2c1, 0x27 << 1, &valor, sizeof(valor), HAL_MAX_DELAY);
+}
@@ -0,0 +1,222 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "sim_profile.h"
+
+/* Private constants ---------------------------------------------------------*/
+
+#define SIM_PROFILE_COUNTERS 2U        // Cycles and instructions, or nanoseconds only
+#define SIM_PROFILE_MAX_DEPTH 8U       // Deepest stage nesting
+#define SIM_PROFILE_CALIBRATION 10000U // Empty enter/exit pairs timed to estimate the probe cost
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  uint64_t calls;
+  uint64_t exclusive[SIM_PROFILE_COUNTERS];
+} simStageTotals_t;
+
+typedef struct
+{
+  simStage_t stage;
+  uint64_t start[SIM_PROFILE_COUNTERS];
+  uint64_t children[SIM_PROFILE_COUNTERS];
+} simStageFrame_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+static const char *const stageNames[SIM_STAGE_COUNT] = {
+    "app", "sensor", "filter", "stats", "report", "alarm", "codec", "log", "clock", "lcd", "uart",
+};
+
+static int cyclesFd = -1;
+static int instructionsFd = -1;
+static bool hardware;
+
+static simStageTotals_t totals[SIM_STAGE_COUNT];
+static simStageFrame_t frames[SIM_PROFILE_MAX_DEPTH];
+static uint8_t depth;
+static uint64_t probeCost[SIM_PROFILE_COUNTERS];
+
+/* Private Function Prototypes ---------------------------------------------- */
+static int openCounter(uint64_t config, int group);
+static void readCounters(uint64_t *values);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Opens one user-space hardware counter of this thread.
+ * @param  uint64_t config: PERF_COUNT_HW_* event.
+ * @param  int group: Group leader, -1 to create a group.
+ * @retval int: File descriptor, -1 if not available.
+ */
+static int openCounter(uint64_t config, int group)
+{
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = config;
+  attr.disabled = (group == -1);
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+
+  return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+/**
+ * @brief  Samples the counters: cycles and instructions, or the monotonic clock in ns and 0.
+ * @param  uint64_t *values: SIM_PROFILE_COUNTERS values.
+ * @retval None
+ */
+static void readCounters(uint64_t *values)
+{
+  if (hardware)
+  {
+    struct
+    {
+      uint64_t count;
+      uint64_t value[SIM_PROFILE_COUNTERS];
+    } group;
+
+    if (read(cyclesFd, &group, sizeof(group)) == (ssize_t)sizeof(group))
+    {
+      values[0] = group.value[0];
+      values[1] = group.value[1];
+      return;
+    }
+  }
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  values[0] = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+  values[1] = 0;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+bool SIM_PROFILE_Init(void)
+{
+  cyclesFd = openCounter(PERF_COUNT_HW_CPU_CYCLES, -1);
+  if (cyclesFd >= 0)
+  {
+    instructionsFd = openCounter(PERF_COUNT_HW_INSTRUCTIONS, cyclesFd);
+  }
+
+  hardware = (cyclesFd >= 0 && instructionsFd >= 0);
+  if (hardware)
+  {
+    ioctl(cyclesFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(cyclesFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+
+  // Cost of an empty probe pair, taken off every call
+  memset(probeCost, 0, sizeof(probeCost));
+  for (uint32_t i = 0; i < SIM_PROFILE_CALIBRATION; i++)
+  {
+    SIM_PROFILE_Enter(SIM_STAGE_APP);
+    SIM_PROFILE_Exit();
+  }
+  for (uint8_t counter = 0; counter < SIM_PROFILE_COUNTERS; counter++)
+  {
+    probeCost[counter] = totals[SIM_STAGE_APP].exclusive[counter] / SIM_PROFILE_CALIBRATION;
+  }
+  memset(totals, 0, sizeof(totals));
+
+  return hardware;
+}
+
+void SIM_PROFILE_Enter(simStage_t stage)
+{
+  simStageFrame_t *frame;
+
+  if (depth >= SIM_PROFILE_MAX_DEPTH)
+  {
+    return;
+  }
+
+  frame = &frames[depth++];
+  frame->stage = stage;
+  memset(frame->children, 0, sizeof(frame->children));
+  readCounters(frame->start);
+}
+
+void SIM_PROFILE_Exit(void)
+{
+  uint64_t now[SIM_PROFILE_COUNTERS];
+  simStageFrame_t *frame;
+
+  readCounters(now);
+  if (depth == 0U)
+  {
+    return;
+  }
+
+  frame = &frames[--depth];
+  totals[frame->stage].calls++;
+  for (uint8_t counter = 0; counter < SIM_PROFILE_COUNTERS; counter++)
+  {
+    uint64_t elapsed = now[counter] - frame->start[counter];
+    uint64_t own = elapsed - frame->children[counter];
+
+    totals[frame->stage].exclusive[counter] += (own > probeCost[counter]) ? own - probeCost[counter] : 0U;
+    if (depth > 0U)
+    {
+      frames[depth - 1U].children[counter] += elapsed;
+    }
+  }
+}
+
+void SIM_PROFILE_Report(FILE *out)
+{
+  uint64_t sum[SIM_PROFILE_COUNTERS] = {0};
+
+  if (hardware)
+  {
+    fprintf(out, "%-8s %10s %14s %14s %14s\n", "stage", "calls", "cycles/call", "instr/call", "instr total");
+  }
+  else
+  {
+    fprintf(out, "%-8s %10s %14s %14s (no hardware counters, host ns)\n", "stage", "calls", "ns/call", "ns total");
+  }
+
+  for (uint8_t stage = 0; stage < SIM_STAGE_COUNT; stage++)
+  {
+    uint64_t calls = totals[stage].calls;
+    uint64_t divisor = (calls > 0U) ? calls : 1U;
+
+    if (hardware)
+    {
+      fprintf(out, "%-8s %10llu %14llu %14llu %14llu\n", stageNames[stage], (unsigned long long)calls,
+              (unsigned long long)(totals[stage].exclusive[0] / divisor),
+              (unsigned long long)(totals[stage].exclusive[1] / divisor),
+              (unsigned long long)totals[stage].exclusive[1]);
+    }
+    else
+    {
+      fprintf(out, "%-8s %10llu %14llu %14llu\n", stageNames[stage], (unsigned long long)calls,
+              (unsigned long long)(totals[stage].exclusive[0] / divisor),
+              (unsigned long long)totals[stage].exclusive[0]);
+    }
+
+    sum[0] += totals[stage].exclusive[0];
+    sum[1] += totals[stage].exclusive[1];
+  }
+
+  if (hardware)
+  {
+    fprintf(out, "%-8s %10s %14s %14s %14llu\n", "total", "", "", "", (unsigned long long)sum[1]);
+  }
+  else
+  {
+    fprintf(out, "%-8s %10s %14s %14llu\n", "total", "", "", (unsigned long long)sum[0]);
+  }
+}
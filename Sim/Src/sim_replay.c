@@ -0,0 +1,497 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "sim_profile.h"
+#include "API_app.h"
+
+/*
+ * Replays a raw BME280 trace through the real firmware: compensation, filter, statistics, report,
+ * alarm, log, formatters, LCD and UART. Prints the cost of every stage and the traffic of every bus,
+ * and optionally checks the UART and LCD output against golden files.
+ *
+ *   sim_replay -r raw.csv [-d seconds] [-w golden_dir | -g golden_dir]
+ *
+ *   -r  Raw trace, "ms,adc_T,adc_H" per line, replayed sample-and-hold.
+ *   -d  Virtual run time, default up to the last trace point.
+ *   -w  Write <dir>/uart.txt and <dir>/lcd.txt as the new golden output.
+ *   -g  Compare against <dir>/uart.txt and <dir>/lcd.txt, exit status 1 on any difference.
+ *
+ * The run is deterministic: same trace, same firmware, same output byte for byte. The stages are
+ * measured by wrapping the Drivers/API entry points that API_app.c calls (see Sim/CMakeLists.txt),
+ * so the firmware is not modified; "app" is what remains in APP_update itself (glue and formatting).
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define SIM_REPLAY_TAIL_MS 1000U   // Run this long past the last trace point by default
+#define SIM_REPLAY_PATH_SIZE 512U
+#define SIM_REPLAY_SHOWN_DIFFS 10U // Differing lines printed per file
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  char *data;
+  size_t size;
+} simBuffer_t;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void usage(const char *program);
+static void lcdFrameLog(FILE *out, char previous[SIM_LCD_ROWS][SIM_LCD_COLUMNS + 1U]);
+static bool readFile(const char *path, simBuffer_t *buffer);
+static bool writeFile(const char *path, const simBuffer_t *buffer);
+static uint32_t compareLines(const char *name, const simBuffer_t *golden, const simBuffer_t *actual);
+static bool nextLine(const simBuffer_t *buffer, size_t *offset, const char **line, size_t *length);
+
+/* Stage wrappers (-Wl,--wrap) ---------------------------------------------- */
+
+bme280Status_t __real_API_BME280_ProcessBurst(const uint8_t *burst);
+bool __real_API_FILTER_Push(filterChannel_t *channel, int32_t raw, int32_t *output);
+void __real_API_STATS_Push(statsChannel_t channel, float value, uint32_t nowMs);
+bool __real_API_STATS_GetSummary(statsChannel_t channel, statsWindow_t window, statsSummary_t *summary);
+reportReason_t __real_API_REPORT_Evaluate(reportChannel_t channel, float value, uint32_t nowMs);
+bool __real_API_ALARM_Update(alarmChannel_t channel, float value, uint32_t nowMs, alarmEvent_t *event);
+uint16_t __real_API_CODEC_EncodeSample(codecState_t *state, uint32_t timestamp, const int32_t *values, uint8_t *out,
+                                       uint16_t size);
+bool __real_API_LOG_Append(const logRecord_t *record);
+bool __real_API_SDLOG_Append(const logRecord_t *record);
+void __real_API_SDLOG_Process(void);
+void __real_ClockGetTimeDate(RTC_TimeTypeDef *time, RTC_DateTypeDef *date);
+void __real_API_LCD_SendData(uint8_t data);
+void __real_API_LCD_SendBCDData(uint8_t data);
+void __real_API_LCD_SetCursorLine(uint8_t position, uint8_t lcd_line);
+void __real_API_LCD_DisplayTwoMsgs(uint8_t init_pos, uint8_t lcd_line, uint8_t *message1, uint8_t *message2);
+void __real_API_LCD_DisplayMsg(uint8_t init_pos, uint8_t lcd_line, uint8_t *message);
+void __real_uartSendString(uint8_t *pstring);
+void __real_APP_update(void);
+
+bme280Status_t __wrap_API_BME280_ProcessBurst(const uint8_t *burst);
+bool __wrap_API_FILTER_Push(filterChannel_t *channel, int32_t raw, int32_t *output);
+void __wrap_API_STATS_Push(statsChannel_t channel, float value, uint32_t nowMs);
+bool __wrap_API_STATS_GetSummary(statsChannel_t channel, statsWindow_t window, statsSummary_t *summary);
+reportReason_t __wrap_API_REPORT_Evaluate(reportChannel_t channel, float value, uint32_t nowMs);
+bool __wrap_API_ALARM_Update(alarmChannel_t channel, float value, uint32_t nowMs, alarmEvent_t *event);
+uint16_t __wrap_API_CODEC_EncodeSample(codecState_t *state, uint32_t timestamp, const int32_t *values, uint8_t *out,
+                                       uint16_t size);
+bool __wrap_API_LOG_Append(const logRecord_t *record);
+bool __wrap_API_SDLOG_Append(const logRecord_t *record);
+void __wrap_API_SDLOG_Process(void);
+void __wrap_ClockGetTimeDate(RTC_TimeTypeDef *time, RTC_DateTypeDef *date);
+void __wrap_API_LCD_SendData(uint8_t data);
+void __wrap_API_LCD_SendBCDData(uint8_t data);
+void __wrap_API_LCD_SetCursorLine(uint8_t position, uint8_t lcd_line);
+void __wrap_API_LCD_DisplayTwoMsgs(uint8_t init_pos, uint8_t lcd_line, uint8_t *message1, uint8_t *message2);
+void __wrap_API_LCD_DisplayMsg(uint8_t init_pos, uint8_t lcd_line, uint8_t *message);
+void __wrap_uartSendString(uint8_t *pstring);
+void __wrap_APP_update(void);
+
+bme280Status_t __wrap_API_BME280_ProcessBurst(const uint8_t *burst)
+{
+  SIM_PROFILE_Enter(SIM_STAGE_SENSOR);
+  bme280Status_t result = __real_API_BME280_ProcessBurst(burst);
+  SIM_PROFILE_Exit();
+  return result;
+}
+
+bool __wrap_API_FILTER_Push(filterChannel_t *channel, int32_t raw, int32_t *output)
+{
+  SIM_PROFILE_Enter(SIM_STAGE_FILTER);
+  bool result = __real_API_FILTER_Push(channel, raw, output);
+  SIM_PROFILE_Exit();
+  return result;
+}
+
+void __wrap_API_STATS_Push(statsChannel_t channel, float value, uint32_t nowMs)
+{
+  SIM_PROFILE_Enter(SIM_STAGE_STATS);
+  __real_API_STATS_Push(channel, value, nowMs);
+  SIM_PROFILE_Exit();
+}
+
+bool __wrap_API_STATS_GetSummary(statsChannel_t channel, statsWindow_t window, statsSummary_t *summary)
+{
+  SIM_PROFILE_Enter(SIM_STAGE_STATS);
+  bool result = __real_API_STATS_GetSummary(channel, window, summary);
+  SIM_PROFILE_Exit();
+  return result;
+}
+
+reportReason_t __wrap_API_REPORT_Evaluate(reportChannel_t channel, float value, uint32_t nowMs)
+{
+  SIM_PROFILE_Enter(SIM_STAGE_REPORT);
+  reportReason_t result = __real_API_REPORT_Evaluate(channel, value, nowMs);
+  SIM_PROFILE_Exit();
+  return result;
+}
+
+bool __wrap_API_ALARM_Update(alarmChannel_t channel, float value, uint32_t nowMs, alarmEvent_t *event)
+{
+  SIM_PROFILE_Enter(SIM_STAGE_ALARM);
+  bool result = __real_API_ALARM_Update(channel, value, nowMs, event);
+  SIM_PROFILE_Exit();
+  return result;
+}
+
+uint16_t __wrap_API_CODEC_EncodeSample(codecState_t *state, uint32_t timestamp, const int32_t *values, uint8_t *out,
+                                       uint16_t size)
+{
+  SIM_PROFILE_Enter(SIM_STAGE_CODEC);
+  uint16_t result = __real_API_CODEC_EncodeSample(state, timestamp, values, out, size);
+  SIM_PROFILE_Exit();
+  return result;
+}
+
+bool __wrap_API_LOG_Append(const logRecord_t *record)
+{
+  SIM_PROFILE_Enter(SIM_STAGE_LOG);
+  bool result = __real_API_LOG_Append(record);
+  SIM_PROFILE_Exit();
+  return result;
+}
+
+bool __wrap_API_SDLOG_Append(const logRecord_t *record)
+{
+  SIM_PROFILE_Enter(SIM_STAGE_LOG);
+  bool result = __real_API_SDLOG_Append(record);
+  SIM_PROFILE_Exit();
+  return result;
+}
+
+void __wrap_API_SDLOG_Process(void)
+{
+  SIM_PROFILE_Enter(SIM_STAGE_LOG);
+  __real_API_SDLOG_Process();
+  SIM_PROFILE_Exit();
+}
+
+void __wrap_ClockGetTimeDate(RTC_TimeTypeDef *time, RTC_DateTypeDef *date)
+{
+  SIM_PROFILE_Enter(SIM_STAGE_CLOCK);
+  __real_ClockGetTimeDate(time, date);
+  SIM_PROFILE_Exit();
+}
+
+void __wrap_API_LCD_SendData(uint8_t data)
+{
+  SIM_PROFILE_Enter(SIM_STAGE_LCD);
+  __real_API_LCD_SendData(data);
+  SIM_PROFILE_Exit();
+}
+
+void __wrap_API_LCD_SendBCDData(uint8_t data)
+{
+  SIM_PROFILE_Enter(SIM_STAGE_LCD);
+  __real_API_LCD_SendBCDData(data);
+  SIM_PROFILE_Exit();
+}
+
+void __wrap_API_LCD_SetCursorLine(uint8_t position, uint8_t lcd_line)
+{
+  SIM_PROFILE_Enter(SIM_STAGE_LCD);
+  __real_API_LCD_SetCursorLine(position, lcd_line);
+  SIM_PROFILE_Exit();
+}
+
+void __wrap_API_LCD_DisplayTwoMsgs(uint8_t init_pos, uint8_t lcd_line, uint8_t *message1, uint8_t *message2)
+{
+  SIM_PROFILE_Enter(SIM_STAGE_LCD);
+  __real_API_LCD_DisplayTwoMsgs(init_pos, lcd_line, message1, message2);
+  SIM_PROFILE_Exit();
+}
+
+void __wrap_API_LCD_DisplayMsg(uint8_t init_pos, uint8_t lcd_line, uint8_t *message)
+{
+  SIM_PROFILE_Enter(SIM_STAGE_LCD);
+  __real_API_LCD_DisplayMsg(init_pos, lcd_line, message);
+  SIM_PROFILE_Exit();
+}
+
+void __wrap_uartSendString(uint8_t *pstring)
+{
+  SIM_PROFILE_Enter(SIM_STAGE_UART);
+  __real_uartSendString(pstring);
+  SIM_PROFILE_Exit();
+}
+
+void __wrap_APP_update(void)
+{
+  SIM_PROFILE_Enter(SIM_STAGE_APP);
+  __real_APP_update();
+  SIM_PROFILE_Exit();
+}
+
+/* Private Function Definitions --------------------------------------------- */
+
+static void usage(const char *program)
+{
+  fprintf(stderr, "usage: %s -r raw.csv [-d seconds] [-w golden_dir | -g golden_dir]\n", program);
+  exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief  Appends the display to the LCD log when it changed: "ms |row 1|row 2|".
+ * @param  FILE *out: LCD log.
+ * @param  previous: Rows last logged, updated.
+ * @retval None
+ */
+static void lcdFrameLog(FILE *out, char previous[SIM_LCD_ROWS][SIM_LCD_COLUMNS + 1U])
+{
+  char rows[SIM_LCD_ROWS][SIM_LCD_COLUMNS + 1U];
+
+  for (uint8_t row = 0; row < SIM_LCD_ROWS; row++)
+  {
+    SIM_LCD_GetRow(row, rows[row]);
+  }
+  if (memcmp(rows, previous, sizeof(rows)) == 0)
+  {
+    return;
+  }
+
+  memcpy(previous, rows, sizeof(rows));
+  fprintf(out, "%llu |%s|%s|\n", (unsigned long long)(SIM_TIME_NowUs() / SIM_US_PER_MS), rows[0], rows[1]);
+}
+
+static bool readFile(const char *path, simBuffer_t *buffer)
+{
+  FILE *in = fopen(path, "rb");
+  long size;
+
+  if (in == NULL || fseek(in, 0, SEEK_END) != 0 || (size = ftell(in)) < 0)
+  {
+    if (in != NULL)
+    {
+      fclose(in);
+    }
+    return false;
+  }
+
+  rewind(in);
+  buffer->data = malloc((size_t)size + 1U);
+  buffer->size = (buffer->data != NULL) ? fread(buffer->data, 1, (size_t)size, in) : 0U;
+  fclose(in);
+
+  return buffer->data != NULL && buffer->size == (size_t)size;
+}
+
+static bool writeFile(const char *path, const simBuffer_t *buffer)
+{
+  FILE *out = fopen(path, "wb");
+  bool ok;
+
+  if (out == NULL)
+  {
+    return false;
+  }
+  ok = fwrite(buffer->data, 1, buffer->size, out) == buffer->size;
+
+  return (fclose(out) == 0) && ok;
+}
+
+/**
+ * @brief  Returns the next line of a buffer, without its terminator.
+ * @retval bool: false at the end of the buffer.
+ */
+static bool nextLine(const simBuffer_t *buffer, size_t *offset, const char **line, size_t *length)
+{
+  const char *end;
+
+  if (*offset >= buffer->size)
+  {
+    return false;
+  }
+
+  *line = buffer->data + *offset;
+  end = memchr(*line, '\n', buffer->size - *offset);
+  *length = (end != NULL) ? (size_t)(end - *line) : buffer->size - *offset;
+  *offset += *length + 1U;
+
+  return true;
+}
+
+/**
+ * @brief  Line by line comparison, printing the first differences.
+ * @param  const char *name: File name for the report.
+ * @param  golden: Expected output.
+ * @param  actual: Output of this run.
+ * @retval uint32_t: Number of differing lines, missing and extra lines included.
+ */
+static uint32_t compareLines(const char *name, const simBuffer_t *golden, const simBuffer_t *actual)
+{
+  size_t goldenOffset = 0;
+  size_t actualOffset = 0;
+  uint32_t lineNumber = 0;
+  uint32_t differences = 0;
+
+  for (;;)
+  {
+    const char *goldenLine = "";
+    const char *actualLine = "";
+    size_t goldenLength = 0;
+    size_t actualLength = 0;
+    bool hasGolden = nextLine(golden, &goldenOffset, &goldenLine, &goldenLength);
+    bool hasActual = nextLine(actual, &actualOffset, &actualLine, &actualLength);
+
+    if (!hasGolden && !hasActual)
+    {
+      break;
+    }
+    lineNumber++;
+
+    if (hasGolden != hasActual || goldenLength != actualLength || memcmp(goldenLine, actualLine, goldenLength) != 0)
+    {
+      if (differences < SIM_REPLAY_SHOWN_DIFFS)
+      {
+        fprintf(stderr, "%s:%u\n  - %.*s\n  + %.*s\n", name, lineNumber, (int)goldenLength, goldenLine,
+                (int)actualLength, actualLine);
+      }
+      differences++;
+    }
+  }
+
+  return differences;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+  const char *rawPath = NULL;
+  const char *writeDir = NULL;
+  const char *goldenDir = NULL;
+  uint64_t durationUs = 0;
+  simBuffer_t uart = {0};
+  simBuffer_t lcd = {0};
+  char lcdRows[SIM_LCD_ROWS][SIM_LCD_COLUMNS + 1U] = {{0}};
+  int option;
+  int status = EXIT_SUCCESS;
+
+  while ((option = getopt(argc, argv, "r:d:w:g:")) != -1)
+  {
+    switch (option)
+    {
+    case 'r':
+      rawPath = optarg;
+      break;
+    case 'd':
+      durationUs = strtoull(optarg, NULL, 10) * SIM_US_PER_SECOND;
+      break;
+    case 'w':
+      writeDir = optarg;
+      break;
+    case 'g':
+      goldenDir = optarg;
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  if (rawPath == NULL || (writeDir != NULL && goldenDir != NULL))
+  {
+    usage(argv[0]);
+  }
+
+  FILE *uartStream = open_memstream(&uart.data, &uart.size);
+  FILE *lcdStream = open_memstream(&lcd.data, &lcd.size);
+
+  SIM_RTC_PowerOnReset();
+  SIM_TIME_Reset();
+  SIM_UART_SetCapture(uartStream);
+  SIM_LCD_Reset();
+  SIM_BME280_Reset(NULL);
+  if (!SIM_BME280_LoadRawTrace(rawPath))
+  {
+    fprintf(stderr, "%s: no trace points\n", rawPath);
+    return EXIT_FAILURE;
+  }
+  SIM_FLASH_EraseAll();
+
+  if (durationUs == 0U)
+  {
+    durationUs = ((uint64_t)SIM_BME280_GetTraceEndMs() + SIM_REPLAY_TAIL_MS) * SIM_US_PER_MS;
+  }
+
+  bool hardware = SIM_PROFILE_Init();
+
+  SIM_BOARD_Init();
+  lcdFrameLog(lcdStream, lcdRows);
+  while (SIM_TIME_NowUs() < durationUs)
+  {
+    if (SIM_BOARD_Step())
+    {
+      lcdFrameLog(lcdStream, lcdRows);
+    }
+  }
+
+  fclose(uartStream);
+  fclose(lcdStream);
+
+  fprintf(stdout, "virtual time %llu ms\n\n", (unsigned long long)(SIM_TIME_NowUs() / SIM_US_PER_MS));
+  SIM_PROFILE_Report(stdout);
+  fprintf(stdout, "\n%-8s %10s %10s\n", "bus", "transfers", "bytes");
+  fprintf(stdout, "%-8s %10s %10u\n", "uart", "", SIM_UART_GetBytesSent());
+  fprintf(stdout, "%-8s %10u %10u\n", "i2c", SIM_LCD_GetI2cWrites(), 2U * SIM_LCD_GetI2cWrites());
+  fprintf(stdout, "%-8s %10u %10u\n", "spi", SIM_BME280_GetSpiTransfers(), SIM_BME280_GetSpiBytes());
+  fprintf(stdout, "%-8s %10u %10s\n", "flash", SIM_FLASH_GetEraseCount(), "(erases)");
+  if (!hardware)
+  {
+    fprintf(stdout, "\nperf_event_open unavailable: stage costs are host wall time, compare runs on one machine only\n");
+  }
+
+  if (writeDir != NULL)
+  {
+    char path[SIM_REPLAY_PATH_SIZE];
+
+    snprintf(path, sizeof(path), "%s/uart.txt", writeDir);
+    if (!writeFile(path, &uart))
+    {
+      perror(path);
+      status = EXIT_FAILURE;
+    }
+    snprintf(path, sizeof(path), "%s/lcd.txt", writeDir);
+    if (!writeFile(path, &lcd))
+    {
+      perror(path);
+      status = EXIT_FAILURE;
+    }
+  }
+
+  if (goldenDir != NULL)
+  {
+    char path[SIM_REPLAY_PATH_SIZE];
+    simBuffer_t golden = {0};
+    uint32_t differences = 0;
+
+    snprintf(path, sizeof(path), "%s/uart.txt", goldenDir);
+    if (!readFile(path, &golden))
+    {
+      perror(path);
+      return EXIT_FAILURE;
+    }
+    differences += compareLines("uart.txt", &golden, &uart);
+    free(golden.data);
+
+    snprintf(path, sizeof(path), "%s/lcd.txt", goldenDir);
+    if (!readFile(path, &golden))
+    {
+      perror(path);
+      return EXIT_FAILURE;
+    }
+    differences += compareLines("lcd.txt", &golden, &lcd);
+    free(golden.data);
+
+    fprintf(stdout, "\ngolden: %u differing lines\n", differences);
+    if (differences != 0U)
+    {
+      status = EXIT_FAILURE;
+    }
+  }
+
+  free(uart.data);
+  free(lcd.data);
+
+  return status;
+}
@@ -0,0 +1,161 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+
+#include "sim.h"
+#include "API_sampler.h"
+#include "API_sampler_port.h"
+
+/*
+ * TIM6, the SPI1 DMA streams and the DWT cycle counter behind the SAMPLER_HAL_* port. The timer update is an
+ * event on an exact grid of periods from the start; a new period is preloaded like the reload register and
+ * spaces the updates from the next one on. A DMA read takes the sensor registers when it starts and
+ * completes after its bytes at the SPI1 clock. The cycle counter follows virtual time.
+ *
+ * A read started while the SD card holds SPI1 is a firmware fault: the simulation stops.
+ *
+ * SIM_SAMPLER_SetHung loses the completion of the reads started meanwhile, as a DMA stream that never finishes.
+ */
+
+/* Private variables ----------------------------------------------------------*/
+
+static uint64_t periodUs;
+static uint64_t preloadUs; // Reload register, taken on the next update
+static uint64_t nextTriggerUs;
+static bool reading;
+static bool hung; // Reads started now never complete
+static uint32_t triggers;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void triggerEvent(void);
+static void readDoneEvent(void);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  TIM6 update: loads the preloaded period, re-arms the next update, then runs the interrupt.
+ * @param  None
+ * @retval None
+ */
+static void triggerEvent(void)
+{
+  periodUs = preloadUs;
+  nextTriggerUs += periodUs;
+  SIM_TIME_Schedule(nextTriggerUs, triggerEvent);
+  triggers++;
+  API_SAMPLER_OnTrigger();
+}
+
+/**
+ * @brief  End of the receive DMA: runs the transfer complete interrupt.
+ * @param  None
+ * @retval None
+ */
+static void readDoneEvent(void)
+{
+  // Aborted meanwhile
+  if (!reading)
+  {
+    return;
+  }
+  reading = false;
+  API_SAMPLER_OnReadDone(true);
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Returns whether a DMA read holds SPI1.
+ * @param  None
+ * @retval bool: true from SAMPLER_HAL_StartRead to its completion.
+ */
+bool SIM_SAMPLER_IsReading(void)
+{
+  return reading;
+}
+
+/**
+ * @brief  Loses or restores the DMA completion: reads started while hung hold SPI1 until aborted.
+ * @param  value: true to lose the completions.
+ * @retval None
+ */
+void SIM_SAMPLER_SetHung(bool value)
+{
+  hung = value;
+}
+
+/**
+ * @brief  Returns the number of TIM6 updates since SAMPLER_HAL_Init.
+ * @param  None
+ * @retval uint32_t: Updates.
+ */
+uint32_t SIM_SAMPLER_GetTriggers(void)
+{
+  return triggers;
+}
+
+/* Sampler port --------------------------------------------------------------*/
+
+bool SAMPLER_HAL_Init(uint32_t period)
+{
+  periodUs = period;
+  preloadUs = period;
+  reading = false;
+  hung = false;
+  triggers = 0;
+
+  return true;
+}
+
+void SAMPLER_HAL_Start(void)
+{
+  nextTriggerUs = SIM_TIME_NowUs() + periodUs;
+  SIM_TIME_Schedule(nextTriggerUs, triggerEvent);
+}
+
+void SAMPLER_HAL_SetPeriod(uint32_t period)
+{
+  preloadUs = period;
+}
+
+bool SAMPLER_HAL_StartRead(const uint8_t *tx, uint8_t *rx, uint16_t size)
+{
+  if (reading)
+  {
+    return false;
+  }
+
+  if (SIM_SD_IsSelected())
+  {
+    fprintf(stderr, "SPI1 conflict: sensor DMA read started with the SD card selected at %llu us\n",
+            (unsigned long long)SIM_TIME_NowUs());
+    exit(EXIT_FAILURE);
+  }
+
+  reading = true;
+  SIM_BME280_Exchange(tx, rx, size);
+  if (!hung)
+  {
+    SIM_TIME_Schedule(SIM_TIME_NowUs() + ((uint64_t)size * 8U * SIM_US_PER_SECOND) / SIM_SPI_HZ, readDoneEvent);
+  }
+
+  return true;
+}
+
+void SAMPLER_HAL_EndRead(void)
+{
+}
+
+void SAMPLER_HAL_AbortRead(void)
+{
+  reading = false;
+}
+
+uint32_t SAMPLER_HAL_GetCycles(void)
+{
+  return (uint32_t)(SIM_TIME_NowUs() * SIM_CORE_CYCLES_PER_US);
+}
+
+uint32_t SAMPLER_HAL_GetCyclesPerUs(void)
+{
+  return SIM_CORE_CYCLES_PER_US;
+}
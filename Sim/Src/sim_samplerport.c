@@ -0,0 +1,208 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "API_sampler.h"
+#include "API_sampler_port.h"
+#include "sim_check.h"
+
+/*
+ * The real SAMPLER_HAL_* port (API_sampler_port.c) against a model of the HAL SPI and DMA handles, in the boot
+ * order of the firmware: MX_SPI1_Init, then the SD card port (SD_IO_Init initialises the BSP handle of the same
+ * SPI1, which runs HAL_SPI_MspInit on it), then SAMPLER_HAL_Init.
+ *
+ *   sim_samplerport
+ *
+ * The model keeps what the HAL does with the handles: HAL_SPI_Init runs HAL_SPI_MspInit on a handle in RESET
+ * state, HAL_SPI_MspInit links the SPI1 DMA streams to the handle it gets (as Core/Src/stm32f4xx_hal_msp.c does),
+ * a DMA transfer is refused unless its handle is READY, and the receive stream completion sets the handle it is
+ * linked to READY before the callback.
+ *
+ * Checks: the streams point at hspi1 after SAMPLER_HAL_Init, hspi1 is READY again after every completion
+ * callback, and every read after the first one starts and completes.
+ *
+ * Exit status 1 if any check fails.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define SAMPLERPORT_PERIOD_US 50000U
+#define SAMPLERPORT_READS 3U
+#define SAMPLERPORT_BURST 9U
+
+/* Public variables ----------------------------------------------------------*/
+
+// Handles of the generated code and of the BSP, and the peripheral tags of the HAL stand-in
+SPI_HandleTypeDef hspi1;
+SPI_HandleTypeDef hnucleo_Spi;
+DMA_HandleTypeDef hdma_spi1_rx;
+DMA_HandleTypeDef hdma_spi1_tx;
+TIM_HandleTypeDef htim6;
+GPIO_TypeDef simGpioB;
+uint32_t simSpi1;
+uint32_t simTim6;
+DWT_Type simDwt;
+CoreDebug_Type simCoreDebug;
+uint32_t SystemCoreClock = 168000000U;
+
+/* Private variables ----------------------------------------------------------*/
+
+static uint32_t readsDone;
+static uint32_t readsFailed;
+static bool selected;  // BME280 chip select low
+static bool streaming; // A DMA transfer runs
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void sdIoInit(void);
+static void dmaReceiveComplete(void);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  SD_IO_Init as far as the handles go: SPIx_Init on the BSP handle, still in RESET state.
+ * @param  None
+ * @retval None
+ */
+static void sdIoInit(void)
+{
+  if (hnucleo_Spi.State == HAL_SPI_STATE_RESET)
+  {
+    hnucleo_Spi.Instance = SPI1;
+    HAL_SPI_Init(&hnucleo_Spi);
+  }
+}
+
+/**
+ * @brief  SPI_DMATransmitReceiveCplt, if a transfer runs: the handle the receive stream is linked to is READY,
+ *         then the callback.
+ * @param  None
+ * @retval None
+ */
+static void dmaReceiveComplete(void)
+{
+  SPI_HandleTypeDef *parent = hdma_spi1_rx.Parent;
+
+  if (!streaming)
+  {
+    return;
+  }
+  streaming = false;
+  parent->State = HAL_SPI_STATE_READY;
+  HAL_SPI_TxRxCpltCallback(parent);
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef *hspi)
+{
+  if (hspi->State == HAL_SPI_STATE_RESET)
+  {
+    HAL_SPI_MspInit(hspi);
+  }
+  hspi->State = HAL_SPI_STATE_READY;
+
+  return HAL_OK;
+}
+
+void HAL_SPI_MspInit(SPI_HandleTypeDef *hspi)
+{
+  if (hspi->Instance == SPI1)
+  {
+    __HAL_LINKDMA(hspi, hdmarx, hdma_spi1_rx);
+    __HAL_LINKDMA(hspi, hdmatx, hdma_spi1_tx);
+  }
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData,
+                                              uint16_t Size)
+{
+  (void)pTxData;
+  (void)pRxData;
+  (void)Size;
+
+  if (hspi->State != HAL_SPI_STATE_READY)
+  {
+    return HAL_BUSY;
+  }
+  hspi->State = HAL_SPI_STATE_BUSY_TX_RX;
+  streaming = true;
+
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi)
+{
+  hspi->State = HAL_SPI_STATE_READY;
+  streaming = false;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim)
+{
+  (void)htim;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim)
+{
+  (void)htim;
+  return HAL_OK;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+  if (GPIOx == CS_GPIO_Port && GPIO_Pin == CS_Pin)
+  {
+    selected = (PinState == GPIO_PIN_RESET);
+  }
+}
+
+void API_SAMPLER_OnTrigger(void)
+{
+}
+
+void API_SAMPLER_OnReadDone(bool ok)
+{
+  SAMPLER_HAL_EndRead();
+  readsDone += ok ? 1U : 0U;
+  readsFailed += ok ? 0U : 1U;
+}
+
+int main(void)
+{
+  static const uint8_t tx[SAMPLERPORT_BURST];
+  static uint8_t rx[SAMPLERPORT_BURST];
+
+  // MX_SPI1_Init, then the SD card port init of APP_sdlogInit
+  hspi1.Instance = SPI1;
+  HAL_SPI_Init(&hspi1);
+  sdIoInit();
+  check(hdma_spi1_rx.Parent == &hnucleo_Spi, "model: the SD init links the streams to the BSP handle");
+
+  check(SAMPLER_HAL_Init(SAMPLERPORT_PERIOD_US), "port init");
+  check(hdma_spi1_rx.Parent == &hspi1 && hdma_spi1_tx.Parent == &hspi1 && hspi1.hdmarx == &hdma_spi1_rx &&
+            hspi1.hdmatx == &hdma_spi1_tx,
+        "DMA streams linked to hspi1");
+
+  for (uint32_t read = 0; read < SAMPLERPORT_READS; read++)
+  {
+    check(SAMPLER_HAL_StartRead(tx, rx, sizeof(rx)), "read started");
+    check(selected, "BME280 selected during the read");
+    dmaReceiveComplete();
+    check(hspi1.State == HAL_SPI_STATE_READY, "hspi1 READY again after the completion callback");
+    check(!selected, "BME280 deselected after the read");
+  }
+  check(readsDone == SAMPLERPORT_READS && readsFailed == 0U, "every read completed");
+
+  printf("sampler port: %u reads, %u completed\n", SAMPLERPORT_READS, readsDone);
+  checkSection(0U);
+
+  if (failures != 0U)
+  {
+    printf("FAIL: %u checks\n", failures);
+    return EXIT_FAILURE;
+  }
+
+  printf("OK: SPI1 DMA completions reach hspi1\n");
+  return EXIT_SUCCESS;
+}
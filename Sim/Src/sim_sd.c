@@ -0,0 +1,505 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "API_sdcard_port.h"
+
+/*
+ * SDHC card in SPI mode, byte by byte behind the SDCARD_HAL_* port, backed by an in-memory image.
+ * Commands CMD0, 8, 9, 16, 17, 24, 25, 55, 58 and ACMD23, 41; CRC is ignored. Every byte costs its
+ * SPI clock time; a written block keeps the card busy (MISO low) for the programming time, with a
+ * longer internal stall every few blocks, as flash translation layers do.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define SIM_SD_SPI_HZ 10500000U         // SD link: PCLK2 84 MHz / 8
+#define SIM_SD_ACMD41_POLLS 3U          // ACMD41 calls before the card leaves idle
+#define SIM_SD_OCR 0xC0FF8000UL         // Powered up, CCS set, 2.7-3.6 V
+#define SIM_SD_CSD_SIZE 16U
+#define SIM_SD_BLOCKS_PER_CSIZE 1024U   // CSD version 2.0 capacity unit, 512 KB
+#define SIM_SD_OUT_SIZE (SDCARD_BLOCK_SIZE + 8U)
+#define SIM_SD_R1_PARAMETER_ERROR 0x40U
+#define SIM_SD_DATA_REJECTED_WRITE 0x0DU // Write error data response
+#define SIM_SD_STOP_BUSY_US 100U         // Programming after a stop token
+
+/* Private types -------------------------------------------------------------*/
+
+typedef enum
+{
+  SIM_SD_COMMAND,     // Waiting for a command start byte
+  SIM_SD_FRAME,       // Receiving the rest of a command frame
+  SIM_SD_WRITE_TOKEN, // CMD24 accepted, waiting for the start block token
+  SIM_SD_STREAM,      // CMD25 accepted, waiting for a block or the stop token
+  SIM_SD_DATA,        // Receiving a data block and its CRC
+} simSdState_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+static uint8_t *image;
+static uint32_t imageBlocks;
+static bool present;
+static bool selected;
+
+static simSdState_t state;
+static bool streaming; // Data block belongs to a CMD25 stream
+static bool idle;
+static bool appCommand;
+static uint8_t acmd41Polls;
+static uint8_t frame[6];
+static uint8_t frameLength;
+static uint32_t dataBlock;      // Block receiving the next data
+static uint16_t dataLength;
+static uint8_t dataBuffer[SDCARD_BLOCK_SIZE + 2U];
+
+static uint8_t out[SIM_SD_OUT_SIZE];
+static uint16_t outHead;
+static uint16_t outTail;
+static uint64_t busyUntilUs;
+
+static uint32_t blockBusyUs = 250U;      // Programming time of one block
+static uint32_t stallPeriodBlocks = 128U; // Internal housekeeping every this many blocks
+static uint32_t stallUs = 20000U;
+static uint32_t blocksWritten;
+static uint32_t blocksRead;
+static uint64_t bitsClocked;
+static uint64_t chargedUs;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void chargeBytes(uint32_t count);
+static void queueByte(uint8_t value);
+static void queueR1(uint8_t r1);
+static void executeCommand(void);
+static void finishData(void);
+static uint8_t exchange(uint8_t value);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Advances virtual time by the SPI clock time of the bytes, carrying the fraction of a microsecond.
+ */
+static void chargeBytes(uint32_t count)
+{
+  uint64_t us;
+
+  bitsClocked += (uint64_t)count * 8U;
+  us = (bitsClocked * SIM_US_PER_SECOND) / SIM_SD_SPI_HZ;
+  SIM_TIME_AdvanceUs(us - chargedUs);
+  chargedUs = us;
+}
+
+static void queueByte(uint8_t value)
+{
+  if (outTail < SIM_SD_OUT_SIZE)
+  {
+    out[outTail++] = value;
+  }
+}
+
+/**
+ * @brief  Queues an R1 response after one byte of NCR delay.
+ */
+static void queueR1(uint8_t r1)
+{
+  outHead = 0;
+  outTail = 0;
+  queueByte(SDCARD_IDLE_BYTE);
+  queueByte(r1);
+}
+
+static void executeCommand(void)
+{
+  uint8_t command = frame[0] & 0x3FU;
+  uint32_t argument = ((uint32_t)frame[1] << 24) | ((uint32_t)frame[2] << 16) | ((uint32_t)frame[3] << 8) | frame[4];
+  uint8_t r1 = idle ? SDCARD_R1_IDLE : 0U;
+  bool application = appCommand;
+
+  appCommand = false;
+  state = SIM_SD_COMMAND;
+
+  if (application && command == SDCARD_ACMD41_SD_SEND_OP_COND)
+  {
+    if (++acmd41Polls >= SIM_SD_ACMD41_POLLS)
+    {
+      idle = false;
+    }
+    queueR1(idle ? SDCARD_R1_IDLE : 0U);
+    return;
+  }
+  if (application && command == SDCARD_ACMD23_SET_WR_BLK_ERASE_COUNT)
+  {
+    queueR1(r1);
+    return;
+  }
+
+  switch (command)
+  {
+  case SDCARD_CMD0_GO_IDLE_STATE:
+    idle = true;
+    acmd41Polls = 0;
+    streaming = false;
+    queueR1(SDCARD_R1_IDLE);
+    break;
+  case SDCARD_CMD8_SEND_IF_COND:
+    queueR1(r1);
+    queueByte(0x00);
+    queueByte(0x00);
+    queueByte((uint8_t)((argument >> 8) & 0x0FU));
+    queueByte((uint8_t)argument);
+    break;
+  case SDCARD_CMD55_APP_CMD:
+    appCommand = true;
+    queueR1(r1);
+    break;
+  case SDCARD_CMD58_READ_OCR:
+    queueR1(r1);
+    queueByte((uint8_t)(SIM_SD_OCR >> 24));
+    queueByte((uint8_t)(SIM_SD_OCR >> 16));
+    queueByte((uint8_t)(SIM_SD_OCR >> 8));
+    queueByte((uint8_t)SIM_SD_OCR);
+    break;
+  case SDCARD_CMD9_SEND_CSD:
+  {
+    uint8_t csd[SIM_SD_CSD_SIZE] = {0x40, 0x0E, 0x00, 0x32, 0x5B, 0x59};
+    uint32_t size = imageBlocks / SIM_SD_BLOCKS_PER_CSIZE - 1U;
+
+    csd[7] = (uint8_t)((size >> 16) & 0x3FU);
+    csd[8] = (uint8_t)(size >> 8);
+    csd[9] = (uint8_t)size;
+    queueR1(r1);
+    queueByte(SDCARD_IDLE_BYTE);
+    queueByte(SDCARD_TOKEN_START_BLOCK);
+    for (uint8_t i = 0; i < SIM_SD_CSD_SIZE; i++)
+    {
+      queueByte(csd[i]);
+    }
+    queueByte(SDCARD_IDLE_BYTE);
+    queueByte(SDCARD_IDLE_BYTE);
+    break;
+  }
+  case SDCARD_CMD16_SET_BLOCKLEN:
+    queueR1(r1);
+    break;
+  case SDCARD_CMD17_READ_SINGLE_BLOCK:
+    if (idle || argument >= imageBlocks)
+    {
+      queueR1(r1 | SIM_SD_R1_PARAMETER_ERROR);
+      break;
+    }
+    queueR1(r1);
+    queueByte(SDCARD_IDLE_BYTE);
+    queueByte(SDCARD_TOKEN_START_BLOCK);
+    for (uint16_t i = 0; i < SDCARD_BLOCK_SIZE; i++)
+    {
+      queueByte(image[(uint64_t)argument * SDCARD_BLOCK_SIZE + i]);
+    }
+    queueByte(SDCARD_IDLE_BYTE);
+    queueByte(SDCARD_IDLE_BYTE);
+    blocksRead++;
+    break;
+  case SDCARD_CMD24_WRITE_BLOCK:
+  case SDCARD_CMD25_WRITE_MULTIPLE_BLOCK:
+    if (idle || argument >= imageBlocks)
+    {
+      queueR1(r1 | SIM_SD_R1_PARAMETER_ERROR);
+      break;
+    }
+    queueR1(r1);
+    dataBlock = argument;
+    streaming = (command == SDCARD_CMD25_WRITE_MULTIPLE_BLOCK);
+    state = streaming ? SIM_SD_STREAM : SIM_SD_WRITE_TOKEN;
+    break;
+  default:
+    queueR1(r1 | SDCARD_R1_ILLEGAL_COMMAND);
+    break;
+  }
+}
+
+/**
+ * @brief  Stores a received block, answers with the data response and starts the programming time.
+ */
+static void finishData(void)
+{
+  uint64_t busyUs = blockBusyUs;
+
+  outHead = 0;
+  outTail = 0;
+
+  if (dataBlock >= imageBlocks)
+  {
+    queueByte(0xE0U | SIM_SD_DATA_REJECTED_WRITE);
+    streaming = false;
+    state = SIM_SD_COMMAND;
+    return;
+  }
+
+  memcpy(image + (uint64_t)dataBlock * SDCARD_BLOCK_SIZE, dataBuffer, SDCARD_BLOCK_SIZE);
+  queueByte(0xE0U | SDCARD_DATA_ACCEPTED);
+  dataBlock++;
+  blocksWritten++;
+  if (stallPeriodBlocks != 0U && blocksWritten % stallPeriodBlocks == 0U)
+  {
+    busyUs += stallUs;
+  }
+  busyUntilUs = SIM_TIME_NowUs() + busyUs;
+  state = streaming ? SIM_SD_STREAM : SIM_SD_COMMAND;
+}
+
+/**
+ * @brief  One byte on the bus while CS is low: MISO is the next queued response byte, then the busy level.
+ */
+static uint8_t exchange(uint8_t value)
+{
+  uint8_t miso = SDCARD_IDLE_BYTE;
+  bool busy = SIM_TIME_NowUs() < busyUntilUs;
+
+  chargeBytes(1);
+  if (!present || !selected)
+  {
+    return SDCARD_IDLE_BYTE;
+  }
+
+  if (outHead < outTail)
+  {
+    miso = out[outHead++];
+  }
+  else if (busy)
+  {
+    miso = SDCARD_BUSY_BYTE;
+  }
+
+  switch (state)
+  {
+  case SIM_SD_COMMAND:
+    if (!busy && (value & 0xC0U) == SDCARD_CMD_START)
+    {
+      frame[0] = value;
+      frameLength = 1;
+      state = SIM_SD_FRAME;
+    }
+    break;
+  case SIM_SD_FRAME:
+    frame[frameLength++] = value;
+    if (frameLength == sizeof(frame))
+    {
+      executeCommand();
+    }
+    break;
+  case SIM_SD_WRITE_TOKEN:
+  case SIM_SD_STREAM:
+    if (busy)
+    {
+      break;
+    }
+    if ((state == SIM_SD_WRITE_TOKEN && value == SDCARD_TOKEN_START_BLOCK) ||
+        (state == SIM_SD_STREAM && value == SDCARD_TOKEN_START_MULTI_WRITE))
+    {
+      dataLength = 0;
+      state = SIM_SD_DATA;
+    }
+    else if (state == SIM_SD_STREAM && value == SDCARD_TOKEN_STOP_MULTI_WRITE)
+    {
+      streaming = false;
+      state = SIM_SD_COMMAND;
+      outHead = 0;
+      outTail = 0;
+      queueByte(SDCARD_IDLE_BYTE); // Nbr
+      busyUntilUs = SIM_TIME_NowUs() + SIM_SD_STOP_BUSY_US;
+    }
+    break;
+  case SIM_SD_DATA:
+    dataBuffer[dataLength++] = value;
+    if (dataLength == sizeof(dataBuffer))
+    {
+      finishData();
+    }
+    break;
+  }
+
+  return miso;
+}
+
+/* Port Function Definitions ------------------------------------------------ */
+
+void SDCARD_HAL_Init(void)
+{
+  chargeBytes(10); // 80 clocks with CS high
+}
+
+void SDCARD_HAL_Select(void)
+{
+  // Both devices on SPI1 at once would garble the sensor read and the card command alike
+  if (SIM_SAMPLER_IsReading())
+  {
+    fprintf(stderr, "SPI1 conflict: SD card selected during a sensor DMA read at %llu us\n",
+            (unsigned long long)SIM_TIME_NowUs());
+    exit(EXIT_FAILURE);
+  }
+  selected = true;
+}
+
+void SDCARD_HAL_Deselect(void)
+{
+  selected = false;
+  chargeBytes(1);
+  // A command interrupted by CS is abandoned; a stream or a busy period survives it
+  outHead = 0;
+  outTail = 0;
+  if (state == SIM_SD_FRAME || state == SIM_SD_DATA)
+  {
+    state = streaming ? SIM_SD_STREAM : SIM_SD_COMMAND;
+  }
+}
+
+uint8_t SDCARD_HAL_Exchange(uint8_t value)
+{
+  return exchange(value);
+}
+
+void SDCARD_HAL_Write(const uint8_t *data, uint16_t size)
+{
+  for (uint16_t i = 0; i < size; i++)
+  {
+    exchange(data[i]);
+  }
+}
+
+void SDCARD_HAL_Read(uint8_t *data, uint16_t size)
+{
+  for (uint16_t i = 0; i < size; i++)
+  {
+    data[i] = exchange(SDCARD_IDLE_BYTE);
+  }
+}
+
+uint32_t SDCARD_HAL_GetTick(void)
+{
+  return HAL_GetTick();
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Inserts a blank (zero-filled) card, or removes the card.
+ * @param  blocks: Capacity in blocks, rounded down to 512 KB; 0 removes the card.
+ * @retval None
+ */
+void SIM_SD_Reset(uint32_t blocks)
+{
+  blocks -= blocks % SIM_SD_BLOCKS_PER_CSIZE;
+  free(image);
+  image = (blocks != 0U) ? calloc(blocks, SDCARD_BLOCK_SIZE) : NULL;
+  imageBlocks = (image != NULL) ? blocks : 0U;
+  present = (image != NULL);
+  blocksWritten = 0;
+  blocksRead = 0;
+  SIM_SD_PowerCycle();
+}
+
+/**
+ * @brief  Power cycle with the card in place: the image survives, everything in flight is lost.
+ * @param  None
+ * @retval None
+ */
+void SIM_SD_PowerCycle(void)
+{
+  selected = false;
+  state = SIM_SD_COMMAND;
+  streaming = false;
+  idle = true;
+  appCommand = false;
+  acmd41Polls = 0;
+  outHead = 0;
+  outTail = 0;
+  busyUntilUs = 0;
+}
+
+/**
+ * @brief  Sets the card programming model.
+ * @param  busyUs: Busy time after each block.
+ * @param  periodBlocks: A stall is added every this many blocks, 0 for none.
+ * @param  extraUs: Stall length.
+ * @retval None
+ */
+void SIM_SD_SetTiming(uint32_t busyUs, uint32_t periodBlocks, uint32_t extraUs)
+{
+  blockBusyUs = busyUs;
+  stallPeriodBlocks = periodBlocks;
+  stallUs = extraUs;
+}
+
+/**
+ * @brief  Loads a card image file; its size sets the capacity.
+ * @param  path: Image file.
+ * @retval bool: true if a non-empty image was read.
+ */
+bool SIM_SD_Load(const char *path)
+{
+  FILE *in = fopen(path, "rb");
+  long size;
+  bool loaded = false;
+
+  if (in == NULL)
+  {
+    return false;
+  }
+  if (fseek(in, 0, SEEK_END) == 0 && (size = ftell(in)) >= (long)(SIM_SD_BLOCKS_PER_CSIZE * SDCARD_BLOCK_SIZE))
+  {
+    SIM_SD_Reset((uint32_t)(size / SDCARD_BLOCK_SIZE));
+    rewind(in);
+    loaded = image != NULL && fread(image, SDCARD_BLOCK_SIZE, imageBlocks, in) == imageBlocks;
+  }
+  fclose(in);
+
+  return loaded;
+}
+
+/**
+ * @brief  Writes the card image to a file.
+ * @param  path: Image file.
+ * @retval bool: true on success.
+ */
+bool SIM_SD_Save(const char *path)
+{
+  FILE *output;
+  size_t written;
+
+  if (image == NULL || (output = fopen(path, "wb")) == NULL)
+  {
+    return false;
+  }
+  written = fwrite(image, SDCARD_BLOCK_SIZE, imageBlocks, output);
+
+  return fclose(output) == 0 && written == imageBlocks;
+}
+
+/**
+ * @brief  Direct access to a block of the image, bypassing the bus.
+ * @param  block: Block number.
+ * @retval const uint8_t *: Block, NULL if out of range.
+ */
+const uint8_t *SIM_SD_GetBlock(uint32_t block)
+{
+  return (block < imageBlocks) ? image + (uint64_t)block * SDCARD_BLOCK_SIZE : NULL;
+}
+
+uint32_t SIM_SD_GetBlocksWritten(void)
+{
+  return blocksWritten;
+}
+
+uint32_t SIM_SD_GetBlocksRead(void)
+{
+  return blocksRead;
+}
+
+/**
+ * @brief  Returns whether the card holds SPI1: CS low.
+ * @param  None
+ * @retval bool: true between SDCARD_HAL_Select and SDCARD_HAL_Deselect.
+ */
+bool SIM_SD_IsSelected(void)
+{
+  return selected;
+}
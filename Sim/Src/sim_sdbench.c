@@ -0,0 +1,393 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "API_sdlog.h"
+
+/*
+ * SD card log against the card model: throughput, cost per call, loss under load and recovery.
+ *
+ *   sim_sdbench [-b blocks] [-n records] [-s busy_us] [-i image.bin]
+ *
+ *   -b  Card capacity in blocks, default 8 MB.
+ *   -n  Records of the throughput run.
+ *   -s  Card busy time per block in microseconds (a stall of 80 times that every 128 blocks).
+ *   -i  Image file: the last card state is written to it at exit, for inspection.
+ *
+ * Virtual times are the firmware's view (SPI clock and card busy time at the SD link speed);
+ * host times are the cost of the calls on this machine, for relative comparison only.
+ * Exit status 1 if records are lost where none should be, or if recovery or the image check fails.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define SDBENCH_DEFAULT_BLOCKS 16384U     // 8 MB
+#define SDBENCH_DEFAULT_RECORDS 62000U    // 1000 blocks
+#define SDBENCH_DEFAULT_BUSY_US 250U
+#define SDBENCH_STALL_PERIOD_BLOCKS 128U
+#define SDBENCH_STALL_FACTOR 80U
+#define SDBENCH_LOOP_US 1000U             // Super loop pass of the rate runs
+#define SDBENCH_RATE_SECONDS 10U
+#define SDBENCH_RECOVERY_BLOCKS 10U       // Blocks streamed before the simulated power loss
+#define SDBENCH_FLUSH_PASSES 100000U
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  uint64_t calls;
+  uint64_t hostNs;
+  uint64_t maxHostNs;
+  uint64_t maxVirtualUs;
+} callCost_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+static uint32_t cardBlocks = SDBENCH_DEFAULT_BLOCKS;
+static uint32_t nextRecord; // Records carry their index, so the image can be checked for gaps
+
+/* Private Function Prototypes ---------------------------------------------- */
+static uint64_t hostNowNs(void);
+static logRecord_t makeRecord(uint32_t index);
+static void account(callCost_t *cost, uint64_t hostNs, uint64_t virtualUs);
+static bool append(callCost_t *cost);
+static void process(callCost_t *cost);
+static bool drain(callCost_t *cost);
+static bool insertBlankCard(void);
+static bool checkImage(uint32_t expectedRecords);
+static bool runThroughput(uint32_t records);
+static bool runRate(uint32_t recordsPerSecond, uint32_t loopUs, bool expectLoss);
+static bool runRecovery(void);
+
+/* Private Function Definitions --------------------------------------------- */
+
+static uint64_t hostNowNs(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+static logRecord_t makeRecord(uint32_t index)
+{
+  logRecord_t record = {
+      .timestamp = index,
+      .temperature = (int16_t)(index & 0x7FFFU),
+      .humidity = (uint16_t)(index * 3U),
+  };
+
+  return record;
+}
+
+static void account(callCost_t *cost, uint64_t hostNs, uint64_t virtualUs)
+{
+  cost->calls++;
+  cost->hostNs += hostNs;
+  if (hostNs > cost->maxHostNs)
+  {
+    cost->maxHostNs = hostNs;
+  }
+  if (virtualUs > cost->maxVirtualUs)
+  {
+    cost->maxVirtualUs = virtualUs;
+  }
+}
+
+static bool append(callCost_t *cost)
+{
+  logRecord_t record = makeRecord(nextRecord);
+  uint64_t start = hostNowNs();
+  bool stored = API_SDLOG_Append(&record);
+
+  account(cost, hostNowNs() - start, 0);
+  nextRecord++;
+
+  return stored;
+}
+
+static void process(callCost_t *cost)
+{
+  uint64_t virtualStart = SIM_TIME_NowUs();
+  uint64_t start = hostNowNs();
+
+  API_SDLOG_Process();
+  account(cost, hostNowNs() - start, SIM_TIME_NowUs() - virtualStart);
+}
+
+/**
+ * @brief  Flushes and runs the log until every record is committed.
+ */
+static bool drain(callCost_t *cost)
+{
+  for (uint32_t pass = 0; pass < SDBENCH_FLUSH_PASSES; pass++)
+  {
+    if (API_SDLOG_Flush())
+    {
+      return true;
+    }
+    process(cost);
+    SIM_TIME_AdvanceUs(SDBENCH_LOOP_US);
+  }
+
+  return false;
+}
+
+static bool insertBlankCard(void)
+{
+  SIM_SD_Reset(cardBlocks);
+  nextRecord = 0;
+
+  return API_SDLOG_Init();
+}
+
+/**
+ * @brief  Walks the data blocks of the image directly and checks that they hold records 0 .. expected - 1.
+ */
+static bool checkImage(uint32_t expectedRecords)
+{
+  uint32_t seen = 0;
+
+  for (uint32_t block = 0; seen < expectedRecords; block++)
+  {
+    const uint8_t *data = SIM_SD_GetBlock(SDLOG_FIRST_DATA_BLOCK + block);
+    uint16_t count;
+
+    if (data == NULL || (data[0] | (data[1] << 8)) != SDLOG_BLOCK_MAGIC ||
+        (uint32_t)(data[8] | (data[9] << 8) | (data[10] << 16) | ((uint32_t)data[11] << 24)) != block)
+    {
+      printf("  image: block %u is not data block %u\n", SDLOG_FIRST_DATA_BLOCK + block, block);
+      return false;
+    }
+
+    count = (uint16_t)(data[2] | (data[3] << 8));
+    for (uint16_t i = 0; i < count; i++, seen++)
+    {
+      const uint8_t *slot = data + SDLOG_BLOCK_HEADER_SIZE + i * SDLOG_RECORD_SIZE;
+      uint32_t timestamp = slot[0] | (slot[1] << 8) | (slot[2] << 16) | ((uint32_t)slot[3] << 24);
+
+      if (timestamp != seen)
+      {
+        printf("  image: record %u found where %u was expected\n", timestamp, seen);
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief  Appends as fast as the buffers accept and processes back to back: the card and link limit.
+ */
+static bool runThroughput(uint32_t records)
+{
+  callCost_t appendCost = {0};
+  callCost_t processCost = {0};
+  uint64_t virtualStart;
+  sdlogStatus_t status;
+  double seconds;
+  bool ok;
+
+  if (!insertBlankCard())
+  {
+    printf("throughput: card init failed\n");
+    return false;
+  }
+
+  virtualStart = SIM_TIME_NowUs();
+  while (nextRecord < records)
+  {
+    // Offer records only while a buffer has room, as a producer that never blocks
+    sdlogStatus_t before = API_SDLOG_GetStatus();
+    if (before.pending < SDLOG_BUFFER_COUNT * SDLOG_RECORDS_PER_BLOCK)
+    {
+      if (!append(&appendCost))
+      {
+        nextRecord--;
+        process(&processCost);
+      }
+      continue;
+    }
+    process(&processCost);
+  }
+  ok = drain(&processCost);
+  seconds = (double)(SIM_TIME_NowUs() - virtualStart) / SIM_US_PER_SECOND;
+  status = API_SDLOG_GetStatus();
+
+  printf("throughput: %u records in %u blocks, %.2f s virtual, %.1f KB/s, %u busy polls\n", status.records,
+         status.blocks, seconds, status.blocks * (SDCARD_BLOCK_SIZE / 1024.0) / seconds, status.busyPolls);
+  printf("  append  %.0f ns/call host (max %llu ns)\n", (double)appendCost.hostNs / appendCost.calls,
+         (unsigned long long)appendCost.maxHostNs);
+  printf("  process %.0f ns/call host (max %llu ns), max %llu us virtual per call, %llu calls\n",
+         (double)processCost.hostNs / processCost.calls, (unsigned long long)processCost.maxHostNs,
+         (unsigned long long)processCost.maxVirtualUs, (unsigned long long)processCost.calls);
+
+  ok = ok && status.records == records && status.dropped == 0U && checkImage(records);
+  printf("  %s\n", ok ? "ok" : "FAILED");
+
+  return ok;
+}
+
+/**
+ * @brief  Fixed ingest rate with one Process call per super loop pass.
+ */
+static bool runRate(uint32_t recordsPerSecond, uint32_t loopUs, bool expectLoss)
+{
+  callCost_t appendCost = {0};
+  callCost_t processCost = {0};
+  uint64_t end;
+  uint64_t due = 0; // Records owed, in records per second times microseconds
+  sdlogStatus_t status;
+  bool ok;
+
+  if (!insertBlankCard())
+  {
+    printf("rate %u/s: card init failed\n", recordsPerSecond);
+    return false;
+  }
+
+  end = SIM_TIME_NowUs() + SDBENCH_RATE_SECONDS * SIM_US_PER_SECOND;
+  while (SIM_TIME_NowUs() < end)
+  {
+    uint64_t passStart = SIM_TIME_NowUs();
+
+    for (due += (uint64_t)recordsPerSecond * loopUs; due >= SIM_US_PER_SECOND; due -= SIM_US_PER_SECOND)
+    {
+      append(&appendCost);
+    }
+    process(&processCost);
+
+    // The rest of the pass is spent elsewhere in the loop
+    if (SIM_TIME_NowUs() - passStart < loopUs)
+    {
+      SIM_TIME_AdvanceUs(loopUs - (SIM_TIME_NowUs() - passStart));
+    }
+  }
+  ok = drain(&processCost);
+  status = API_SDLOG_GetStatus();
+
+  printf("rate %6u records/s, pass %5u us: %u offered, %u stored, %u dropped, max %llu us virtual per process\n",
+         recordsPerSecond, loopUs, nextRecord, status.records, status.dropped,
+         (unsigned long long)processCost.maxVirtualUs);
+
+  ok = ok && status.records + status.dropped == nextRecord && (expectLoss || status.dropped == 0U);
+  if (!expectLoss)
+  {
+    ok = ok && checkImage(status.records);
+  }
+  printf("  %s\n", ok ? "ok" : "FAILED");
+
+  return ok;
+}
+
+/**
+ * @brief  Power loss in the middle of a stream, before the index is rewritten: the blocks already on the card
+ *         must be adopted at the next init, and the log must carry on after them.
+ */
+static bool runRecovery(void)
+{
+  callCost_t cost = {0};
+  sdlogStatus_t status;
+  uint32_t written;
+  bool ok;
+
+  if (!insertBlankCard())
+  {
+    printf("recovery: card init failed\n");
+    return false;
+  }
+
+  while (API_SDLOG_GetStatus().blocks < SDBENCH_RECOVERY_BLOCKS)
+  {
+    if (!append(&cost))
+    {
+      nextRecord--;
+    }
+    process(&cost);
+    SIM_TIME_AdvanceUs(SDBENCH_LOOP_US);
+  }
+  written = API_SDLOG_GetStatus().records;
+
+  // Power loss: RAM buffers and the open stream are gone, the card keeps what it programmed
+  SIM_SD_PowerCycle();
+  SIM_TIME_AdvanceUs(SIM_US_PER_SECOND);
+  ok = API_SDLOG_Init();
+  status = API_SDLOG_GetStatus();
+  printf("recovery: %u blocks on the card, %u adopted, %u records\n", SDBENCH_RECOVERY_BLOCKS, status.recovered,
+         status.records);
+  ok = ok && status.recovered == SDBENCH_RECOVERY_BLOCKS && status.records == written;
+
+  // Resume from the last record that made it to the card, then check the whole image
+  nextRecord = written;
+  for (uint32_t i = 0; i < SDLOG_RECORDS_PER_BLOCK * 3U; i++)
+  {
+    append(&cost);
+    process(&cost);
+  }
+  ok = ok && drain(&cost) && checkImage(API_SDLOG_GetStatus().records);
+
+  // A second boot finds everything committed by the index
+  SIM_SD_PowerCycle();
+  ok = ok && API_SDLOG_Init() && API_SDLOG_GetStatus().recovered == 0U &&
+       API_SDLOG_GetStatus().records == nextRecord;
+  printf("  %s\n", ok ? "ok" : "FAILED");
+
+  return ok;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+  uint32_t records = SDBENCH_DEFAULT_RECORDS;
+  uint32_t busyUs = SDBENCH_DEFAULT_BUSY_US;
+  const char *imagePath = NULL;
+  bool ok = true;
+  int option;
+
+  while ((option = getopt(argc, argv, "b:n:s:i:")) != -1)
+  {
+    switch (option)
+    {
+    case 'b':
+      cardBlocks = (uint32_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'n':
+      records = (uint32_t)strtoul(optarg, NULL, 10);
+      break;
+    case 's':
+      busyUs = (uint32_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'i':
+      imagePath = optarg;
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-b blocks] [-n records] [-s busy_us] [-i image.bin]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  SIM_TIME_Reset();
+  SIM_SD_SetTiming(busyUs, SDBENCH_STALL_PERIOD_BLOCKS, busyUs * SDBENCH_STALL_FACTOR);
+
+  ok = runThroughput(records) && ok;
+  // 5 records/s is the application rate; the others probe where two buffers stop absorbing the card latency
+  ok = runRate(5U, SDBENCH_LOOP_US, false) && ok;
+  ok = runRate(5U, 50000U, false) && ok;
+  ok = runRate(1000U, SDBENCH_LOOP_US, false) && ok;
+  ok = runRate(1000U, 50000U, true) && ok;
+  ok = runRate(20000U, SDBENCH_LOOP_US, true) && ok;
+  ok = runRecovery() && ok;
+
+  if (imagePath != NULL && !SIM_SD_Save(imagePath))
+  {
+    perror(imagePath);
+    ok = false;
+  }
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,322 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "API_spsc.h"
+
+/*
+ * API_spsc.h ring between two host threads: a stress run that checks every element, then throughput.
+ *
+ *   sim_spscbench [-n elements]
+ *
+ *   -n  Elements per run, default 20 million.
+ *
+ * Stress: a small ring so that it runs full and empty all the time. The producer rotates through push,
+ * batch push of 1 to SPSCBENCH_MAX_BATCH elements and claim/commit; the consumer through pop, batch pop
+ * and claim/commit. Each element carries its sequence number and its complement: the consumer checks
+ * the order and that no element is read half written.
+ *
+ * Throughput: single push/pop, batches of SPSCBENCH_BATCH and claim/commit on a larger ring, in million
+ * elements per second. Host wall time, compare runs on one machine only. A side that finds the ring
+ * full or empty yields, so the runs also complete on a single core.
+ *
+ * Exit status 1 if the stress run finds an element out of order or torn.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define SPSCBENCH_DEFAULT_ELEMENTS 20000000U
+#define SPSCBENCH_STRESS_CAPACITY 16U   // Small: full and empty on most calls
+#define SPSCBENCH_BENCH_CAPACITY 1024U
+#define SPSCBENCH_MAX_BATCH 17U         // Stress batches, not a divisor of the capacity: batches wrap
+#define SPSCBENCH_BATCH 32U             // Throughput batches
+#define SPSCBENCH_NS_PER_SECOND 1e9
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  uint32_t sequence;
+  uint32_t check;    // ~sequence
+  uint32_t payload[2];
+} benchElement_t;
+
+typedef enum
+{
+  BENCH_MODE_STRESS, // Rotating calls, every element checked
+  BENCH_MODE_SINGLE, // Push / Pop
+  BENCH_MODE_BATCH,  // PushBatch / PopBatch of SPSCBENCH_BATCH
+  BENCH_MODE_CLAIM,  // ClaimWrite / ClaimRead of up to SPSCBENCH_BATCH
+} benchMode_t;
+
+typedef struct
+{
+  spscQueue_t queue;
+  benchMode_t mode;
+  uint32_t elements;
+  uint32_t errors;    // Consumer: elements out of order or torn
+  uint32_t waits;     // Both sides: calls that found the ring full or empty
+} benchRun_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+static benchElement_t storage[SPSCBENCH_BENCH_CAPACITY];
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void fill(benchElement_t *element, uint32_t sequence);
+static uint32_t produce(benchRun_t *run, uint32_t sequence, uint32_t call);
+static uint32_t consume(benchRun_t *run, uint32_t sequence, uint32_t call);
+static void *producerThread(void *argument);
+static void *consumerThread(void *argument);
+static double runBench(benchRun_t *run, benchMode_t mode, uint32_t capacity, uint32_t elements);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Writes an element for a sequence number.
+ * @param  element: Element.
+ * @param  sequence: Sequence number.
+ * @retval None
+ */
+static void fill(benchElement_t *element, uint32_t sequence)
+{
+  element->sequence = sequence;
+  element->payload[0] = sequence * 3U;
+  element->payload[1] = sequence * 7U;
+  element->check = ~sequence;
+}
+
+/**
+ * @brief  One producer call of the run's mode.
+ * @param  run: Run.
+ * @param  sequence: Next sequence number to write.
+ * @param  call: Call counter, selects the call in the stress mode.
+ * @retval uint32_t: Elements pushed.
+ */
+static uint32_t produce(benchRun_t *run, uint32_t sequence, uint32_t call)
+{
+  benchElement_t batch[SPSCBENCH_BATCH];
+  uint32_t wanted = run->elements - sequence;
+  uint32_t kind = (run->mode == BENCH_MODE_STRESS) ? call % 3U : (uint32_t)run->mode - BENCH_MODE_SINGLE;
+  uint32_t limit = (run->mode == BENCH_MODE_STRESS) ? 1U + call % SPSCBENCH_MAX_BATCH : SPSCBENCH_BATCH;
+  uint32_t count;
+
+  if (wanted > limit)
+  {
+    wanted = limit;
+  }
+
+  switch (kind)
+  {
+  case 0:
+    fill(&batch[0], sequence);
+    return API_SPSC_Push(&run->queue, &batch[0]) ? 1U : 0U;
+
+  case 1:
+    for (uint32_t i = 0; i < wanted; i++)
+    {
+      fill(&batch[i], sequence + i);
+    }
+    return API_SPSC_PushBatch(&run->queue, batch, wanted);
+
+  default:
+    count = wanted;
+    benchElement_t *slots = API_SPSC_ClaimWrite(&run->queue, &count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+      fill(&slots[i], sequence + i);
+    }
+    API_SPSC_CommitWrite(&run->queue, count);
+    return count;
+  }
+}
+
+/**
+ * @brief  One consumer call of the run's mode. Checks each element in the stress mode.
+ * @param  run: Run.
+ * @param  sequence: Next sequence number expected.
+ * @param  call: Call counter, selects the call in the stress mode.
+ * @retval uint32_t: Elements popped.
+ */
+static uint32_t consume(benchRun_t *run, uint32_t sequence, uint32_t call)
+{
+  benchElement_t batch[SPSCBENCH_BATCH];
+  const benchElement_t *elements = batch;
+  uint32_t wanted = run->elements - sequence;
+  uint32_t kind = (run->mode == BENCH_MODE_STRESS) ? (call / 2U) % 3U : (uint32_t)run->mode - BENCH_MODE_SINGLE;
+  uint32_t limit = (run->mode == BENCH_MODE_STRESS) ? 1U + call % SPSCBENCH_MAX_BATCH : SPSCBENCH_BATCH;
+  uint32_t count;
+
+  if (wanted > limit)
+  {
+    wanted = limit;
+  }
+
+  switch (kind)
+  {
+  case 0:
+    count = API_SPSC_Pop(&run->queue, &batch[0]) ? 1U : 0U;
+    break;
+
+  case 1:
+    count = API_SPSC_PopBatch(&run->queue, batch, wanted);
+    break;
+
+  default:
+    count = wanted;
+    elements = API_SPSC_ClaimRead(&run->queue, &count);
+    break;
+  }
+
+  if (run->mode == BENCH_MODE_STRESS)
+  {
+    for (uint32_t i = 0; i < count; i++)
+    {
+      const benchElement_t *element = &elements[i];
+
+      if (element->sequence != sequence + i || element->check != ~element->sequence ||
+          element->payload[0] != element->sequence * 3U || element->payload[1] != element->sequence * 7U)
+      {
+        run->errors++;
+      }
+    }
+  }
+
+  if (kind == 2U)
+  {
+    API_SPSC_CommitRead(&run->queue, count);
+  }
+
+  return count;
+}
+
+/**
+ * @brief  Producer thread: pushes run->elements elements.
+ * @param  argument: Run.
+ * @retval void *: NULL.
+ */
+static void *producerThread(void *argument)
+{
+  benchRun_t *run = argument;
+  uint32_t sequence = 0;
+
+  for (uint32_t call = 0; sequence < run->elements; call++)
+  {
+    uint32_t pushed = produce(run, sequence, call);
+
+    if (pushed == 0U)
+    {
+      __atomic_fetch_add(&run->waits, 1U, __ATOMIC_RELAXED);
+      sched_yield();
+    }
+    sequence += pushed;
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief  Consumer thread: pops run->elements elements.
+ * @param  argument: Run.
+ * @retval void *: NULL.
+ */
+static void *consumerThread(void *argument)
+{
+  benchRun_t *run = argument;
+  uint32_t sequence = 0;
+
+  for (uint32_t call = 0; sequence < run->elements; call++)
+  {
+    uint32_t popped = consume(run, sequence, call);
+
+    if (popped == 0U)
+    {
+      __atomic_fetch_add(&run->waits, 1U, __ATOMIC_RELAXED);
+      sched_yield();
+    }
+    sequence += popped;
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief  Runs the producer and consumer threads on a fresh ring.
+ * @param  run: Run, filled in.
+ * @param  mode: Calls used.
+ * @param  capacity: Ring capacity.
+ * @param  elements: Elements to transfer.
+ * @retval double: Million elements per second.
+ */
+static double runBench(benchRun_t *run, benchMode_t mode, uint32_t capacity, uint32_t elements)
+{
+  pthread_t producer;
+  pthread_t consumer;
+  struct timespec start;
+  struct timespec end;
+
+  API_SPSC_Init(&run->queue, storage, capacity, sizeof(benchElement_t));
+  run->mode = mode;
+  run->elements = elements;
+  run->errors = 0;
+  run->waits = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  pthread_create(&consumer, NULL, consumerThread, run);
+  pthread_create(&producer, NULL, producerThread, run);
+  pthread_join(producer, NULL);
+  pthread_join(consumer, NULL);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  double ns = (double)(end.tv_sec - start.tv_sec) * SPSCBENCH_NS_PER_SECOND + (double)(end.tv_nsec - start.tv_nsec);
+
+  return (double)elements * 1000.0 / ns;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+  static benchRun_t run; // Aligned to the cache line through its queue
+  uint32_t elements = SPSCBENCH_DEFAULT_ELEMENTS;
+  int option;
+
+  while ((option = getopt(argc, argv, "n:")) != -1)
+  {
+    switch (option)
+    {
+    case 'n':
+      elements = (uint32_t)strtoul(optarg, NULL, 10);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-n elements]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  double rate = runBench(&run, BENCH_MODE_STRESS, SPSCBENCH_STRESS_CAPACITY, elements);
+  uint32_t errors = run.errors;
+  printf("stress   %u elements, capacity %u: %u errors, %u full/empty, %.1f M/s\n", elements,
+         SPSCBENCH_STRESS_CAPACITY, errors, run.waits, rate);
+
+  static const char *const modeNames[] = {"stress", "single", "batch", "claim"};
+  printf("\n%-8s %10s %12s\n", "mode", "M elem/s", "full/empty");
+  for (benchMode_t mode = BENCH_MODE_SINGLE; mode <= BENCH_MODE_CLAIM; mode++)
+  {
+    rate = runBench(&run, mode, SPSCBENCH_BENCH_CAPACITY, elements);
+    printf("%-8s %10.1f %12u\n", modeNames[mode], rate, run.waits);
+  }
+
+  if (errors != 0U)
+  {
+    printf("FAIL: %u elements out of order or torn\n", errors);
+    return EXIT_FAILURE;
+  }
+
+  printf("OK: every element in order and whole\n");
+  return EXIT_SUCCESS;
+}
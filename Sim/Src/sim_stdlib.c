@@ -0,0 +1,58 @@
+/* Includes ------------------------------------------------------------------*/
+#include "sim_stdlib.h"
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  newlib utoa: unsigned value to text in bases 2 to 36.
+ * @param  value: Value.
+ * @param  str: Destination, large enough for the digits and the terminator.
+ * @param  base: Radix.
+ * @retval char *: str.
+ */
+char *utoa(unsigned value, char *str, int base)
+{
+  static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+  char reversed[sizeof(unsigned) * 8U];
+  int length = 0;
+  int i = 0;
+
+  if (base < 2 || base > 36)
+  {
+    str[0] = '\0';
+    return str;
+  }
+
+  do
+  {
+    reversed[length++] = digits[value % (unsigned)base];
+    value /= (unsigned)base;
+  } while (value != 0U);
+
+  while (length > 0)
+  {
+    str[i++] = reversed[--length];
+  }
+  str[i] = '\0';
+
+  return str;
+}
+
+/**
+ * @brief  newlib itoa: the sign is only written in base 10, other bases print the two's complement.
+ * @param  value: Value.
+ * @param  str: Destination, large enough for the sign, the digits and the terminator.
+ * @param  base: Radix.
+ * @retval char *: str.
+ */
+char *itoa(int value, char *str, int base)
+{
+  if (base == 10 && value < 0)
+  {
+    str[0] = '-';
+    utoa(0U - (unsigned)value, str + 1, base);
+    return str;
+  }
+
+  return utoa((unsigned)value, str, base);
+}
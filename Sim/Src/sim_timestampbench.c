@@ -0,0 +1,367 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "API_timestamp.h"
+
+/*
+ * API_timestamp.h conversions against the host C library calendar over the RTC's whole range, then throughput.
+ *
+ *   sim_timestampbench [-n calls]
+ *
+ *   -n  Calls per throughput run, default 10 million.
+ *
+ * Round trip: every day from 2000-01-01 to 2099-12-31, every minute of the day with the seconds cycling through
+ * 0..59, so every hour, minute and second field is seen on every day. Each timestamp goes through
+ * API_TIMESTAMP_ToRTC, whose date, weekday and time must match gmtime_r, then back through API_TIMESTAMP_FromRTC,
+ * which must return it unchanged. The days run in order, so the "same day" caches hit, then every hour again
+ * with a new day on every call, so they miss. API_TIMESTAMP_NowMs is checked against a stub RTC at several
+ * sub-second counts.
+ *
+ * Throughput: each direction on the same day and on a new day per call, and gmtime_r/timegm for reference, over
+ * a table of pseudo-random timestamps, in ns per call. Host wall time, compare runs on one machine only.
+ *
+ * Exit status 1 on any mismatch.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define TIMESTAMPBENCH_DEFAULT_CALLS 10000000U
+#define TIMESTAMPBENCH_EPOCH_UNIX 946684800LL // 2000-01-01 00:00:00 UTC in Unix time
+#define TIMESTAMPBENCH_DAYS 36525U           // 2000-01-01 .. 2099-12-31
+#define TIMESTAMPBENCH_MINUTES_PER_DAY 1440U
+#define TIMESTAMPBENCH_HOURS_PER_DAY 24U
+#define TIMESTAMPBENCH_SAMPLES 4096U         // Throughput inputs, a power of two
+#define TIMESTAMPBENCH_STRIDE_DAYS 7919U     // Prime, coprime with the day count: visits every day, never twice in a row
+#define TIMESTAMPBENCH_NS_PER_SECOND 1e9
+#define TIMESTAMPBENCH_REPORTED_ERRORS 5U
+
+/* Private types -------------------------------------------------------------*/
+
+typedef enum
+{
+  BENCH_PATH_TO_SAME_DAY,    // API_TIMESTAMP_ToRTC, cache hit
+  BENCH_PATH_TO_NEW_DAY,     // API_TIMESTAMP_ToRTC, cache miss
+  BENCH_PATH_TO_REFERENCE,   // gmtime_r
+  BENCH_PATH_FROM_SAME_DAY,  // API_TIMESTAMP_FromRTC, cache hit
+  BENCH_PATH_FROM_NEW_DAY,   // API_TIMESTAMP_FromRTC, cache miss
+  BENCH_PATH_FROM_REFERENCE, // timegm
+  BENCH_PATH_COUNT,
+} benchPath_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+RTC_HandleTypeDef hrtc;
+static RTC_TimeTypeDef stubTime; // Read by the HAL_RTC_GetTime stub
+static RTC_DateTypeDef stubDate;
+
+static timestamp_t samples[TIMESTAMPBENCH_SAMPLES];
+static RTC_TimeTypeDef sampleTimes[TIMESTAMPBENCH_SAMPLES];
+static RTC_DateTypeDef sampleDates[TIMESTAMPBENCH_SAMPLES];
+static struct tm sampleTms[TIMESTAMPBENCH_SAMPLES];
+static volatile uint32_t sink; // Keeps the timed results alive
+static uint32_t mismatches;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static uint8_t bcd(int value);
+static void mismatch(timestamp_t timestamp, const char *what);
+static void checkTimestamp(timestamp_t timestamp);
+static uint32_t sweepInOrder(void);
+static uint32_t sweepNewDays(void);
+static void checkNowMs(void);
+static double nowNs(void);
+static double timePath(benchPath_t path, uint32_t calls);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Binary to packed BCD.
+ * @param  int value: 0..99.
+ * @retval uint8_t: BCD.
+ */
+static uint8_t bcd(int value)
+{
+  return (uint8_t)(((value / 10) << 4) | (value % 10));
+}
+
+/**
+ * @brief  Counts a mismatch and prints the first few.
+ * @param  timestamp_t timestamp: Offending timestamp.
+ * @param  const char *what: Which check failed.
+ * @retval None
+ */
+static void mismatch(timestamp_t timestamp, const char *what)
+{
+  if (mismatches++ < TIMESTAMPBENCH_REPORTED_ERRORS)
+  {
+    time_t unixTime = (time_t)(timestamp + TIMESTAMPBENCH_EPOCH_UNIX);
+    struct tm utc;
+    char text[32];
+
+    gmtime_r(&unixTime, &utc);
+    strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &utc);
+    printf("  mismatch at %u (%s): %s\n", timestamp, text, what);
+  }
+}
+
+/**
+ * @brief  One round trip, checked against gmtime_r.
+ * @param  timestamp_t timestamp: Seconds since 2000-01-01.
+ * @retval None
+ */
+static void checkTimestamp(timestamp_t timestamp)
+{
+  time_t unixTime = (time_t)(timestamp + TIMESTAMPBENCH_EPOCH_UNIX);
+  RTC_TimeTypeDef time;
+  RTC_DateTypeDef date;
+  struct tm utc;
+
+  gmtime_r(&unixTime, &utc);
+  API_TIMESTAMP_ToRTC(timestamp, &time, &date);
+
+  if (date.Year != bcd(utc.tm_year - 100) || date.Month != bcd(utc.tm_mon + 1) || date.Date != bcd(utc.tm_mday))
+  {
+    mismatch(timestamp, "date");
+  }
+  // RTC weekdays run Monday = 1 .. Sunday = 7, tm_wday Sunday = 0 .. Saturday = 6
+  if (date.WeekDay != (utc.tm_wday == 0 ? RTC_WEEKDAY_SUNDAY : utc.tm_wday))
+  {
+    mismatch(timestamp, "weekday");
+  }
+  if (time.Hours != bcd(utc.tm_hour) || time.Minutes != bcd(utc.tm_min) || time.Seconds != bcd(utc.tm_sec))
+  {
+    mismatch(timestamp, "time");
+  }
+  if (API_TIMESTAMP_FromRTC(&time, &date) != timestamp)
+  {
+    mismatch(timestamp, "round trip");
+  }
+}
+
+/**
+ * @brief  Checks every minute of every day of 2000..2099 in order, the seconds cycling through 0..59.
+ * @param  None
+ * @retval uint32_t: Timestamps checked.
+ */
+static uint32_t sweepInOrder(void)
+{
+  uint32_t checked = 0;
+
+  for (uint32_t day = 0; day < TIMESTAMPBENCH_DAYS; day++)
+  {
+    for (uint32_t minute = 0; minute < TIMESTAMPBENCH_MINUTES_PER_DAY; minute++)
+    {
+      checkTimestamp(day * TIMESTAMP_SECONDS_PER_DAY + minute * TIMESTAMP_SECONDS_PER_MINUTE + (minute + day) % 60U);
+      checked++;
+    }
+  }
+
+  return checked;
+}
+
+/**
+ * @brief  Checks every hour of every day of 2000..2099, each call on another day than the previous one.
+ * @param  None
+ * @retval uint32_t: Timestamps checked.
+ */
+static uint32_t sweepNewDays(void)
+{
+  uint32_t checked = 0;
+  uint32_t day = 0;
+
+  for (uint32_t hour = 0; hour < TIMESTAMPBENCH_HOURS_PER_DAY; hour++)
+  {
+    for (uint32_t step = 0; step < TIMESTAMPBENCH_DAYS; step++)
+    {
+      checkTimestamp(day * TIMESTAMP_SECONDS_PER_DAY + hour * TIMESTAMP_SECONDS_PER_HOUR + (hour * 7U + day) % 3600U);
+      day = (day + TIMESTAMPBENCH_STRIDE_DAYS) % TIMESTAMPBENCH_DAYS;
+      checked++;
+    }
+  }
+
+  return checked;
+}
+
+/**
+ * @brief  API_TIMESTAMP_NowMs against the stub RTC: the fraction counts down from SecondFraction.
+ * @param  None
+ * @retval None
+ */
+static void checkNowMs(void)
+{
+  static const uint32_t subSeconds[] = {CLOCK_RTC_SYNCH_PREDIV, 192U, 128U, 64U, 1U, 0U};
+  timestamp_t timestamp = 776136000U; // 2024-08-05 01:20:00, the cold boot calendar
+
+  API_TIMESTAMP_ToRTC(timestamp, &stubTime, &stubDate);
+  stubTime.SecondFraction = CLOCK_RTC_SYNCH_PREDIV;
+
+  for (uint32_t i = 0; i < sizeof(subSeconds) / sizeof(subSeconds[0]); i++)
+  {
+    uint32_t expected = ((CLOCK_RTC_SYNCH_PREDIV - subSeconds[i]) * 1000U) / (CLOCK_RTC_SYNCH_PREDIV + 1U);
+
+    stubTime.SubSeconds = subSeconds[i];
+    if (API_TIMESTAMP_NowMs() != (timestampMs_t)timestamp * TIMESTAMP_MS_PER_SECOND + expected)
+    {
+      mismatch(timestamp, "milliseconds");
+    }
+  }
+  if (API_TIMESTAMP_Now() != timestamp)
+  {
+    mismatch(timestamp, "now");
+  }
+}
+
+/**
+ * @brief  Monotonic host time.
+ * @param  None
+ * @retval double: ns.
+ */
+static double nowNs(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec * TIMESTAMPBENCH_NS_PER_SECOND + (double)now.tv_nsec;
+}
+
+/**
+ * @brief  Times one conversion path over the sample table.
+ * @param  benchPath_t path: Direction, cache hit or miss, or reference.
+ * @param  uint32_t calls: Calls.
+ * @retval double: ns per call.
+ */
+static double timePath(benchPath_t path, uint32_t calls)
+{
+  RTC_TimeTypeDef time;
+  RTC_DateTypeDef date;
+  struct tm utc;
+  uint32_t sum = 0;
+  double start = nowNs();
+
+  for (uint32_t call = 0; call < calls; call++)
+  {
+    uint32_t i = call & (TIMESTAMPBENCH_SAMPLES - 1U);
+    time_t unixTime;
+
+    switch (path)
+    {
+    case BENCH_PATH_TO_SAME_DAY:
+      API_TIMESTAMP_ToRTC(samples[0] + i % TIMESTAMP_SECONDS_PER_DAY / 64U, &time, &date);
+      sum += time.Seconds;
+      break;
+    case BENCH_PATH_TO_NEW_DAY:
+      API_TIMESTAMP_ToRTC(samples[i], &time, &date);
+      sum += date.Date;
+      break;
+    case BENCH_PATH_TO_REFERENCE:
+      unixTime = (time_t)(samples[i] + TIMESTAMPBENCH_EPOCH_UNIX);
+      gmtime_r(&unixTime, &utc);
+      sum += (uint32_t)utc.tm_mday;
+      break;
+    case BENCH_PATH_FROM_SAME_DAY:
+      sum += API_TIMESTAMP_FromRTC(&sampleTimes[i], &sampleDates[0]);
+      break;
+    case BENCH_PATH_FROM_NEW_DAY:
+      sum += API_TIMESTAMP_FromRTC(&sampleTimes[i], &sampleDates[i]);
+      break;
+    default:
+      sum += (uint32_t)timegm(&sampleTms[i]);
+      break;
+    }
+  }
+
+  double elapsed = nowNs() - start;
+
+  sink = sum;
+  return elapsed / calls;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Stub RTC time, set by checkNowMs.
+ * @param  handle: Unused.
+ * @param  sTime: Receives the stub time.
+ * @param  Format: Unused, always BCD.
+ * @retval HAL_StatusTypeDef: HAL_OK.
+ */
+HAL_StatusTypeDef HAL_RTC_GetTime(RTC_HandleTypeDef *handle, RTC_TimeTypeDef *sTime, uint32_t Format)
+{
+  (void)handle;
+  (void)Format;
+  *sTime = stubTime;
+  return HAL_OK;
+}
+
+/**
+ * @brief  Stub RTC date, set by checkNowMs.
+ * @param  handle: Unused.
+ * @param  sDate: Receives the stub date.
+ * @param  Format: Unused, always BCD.
+ * @retval HAL_StatusTypeDef: HAL_OK.
+ */
+HAL_StatusTypeDef HAL_RTC_GetDate(RTC_HandleTypeDef *handle, RTC_DateTypeDef *sDate, uint32_t Format)
+{
+  (void)handle;
+  (void)Format;
+  *sDate = stubDate;
+  return HAL_OK;
+}
+
+int main(int argc, char **argv)
+{
+  static const char *const pathNames[BENCH_PATH_COUNT] = {"to RTC, same day", "to RTC, new day", "gmtime_r",
+                                                          "from RTC, same day", "from RTC, new day", "timegm"};
+  uint32_t calls = TIMESTAMPBENCH_DEFAULT_CALLS;
+  uint32_t checked;
+  int option;
+
+  while ((option = getopt(argc, argv, "n:")) != -1)
+  {
+    switch (option)
+    {
+    case 'n':
+      calls = (uint32_t)strtoul(optarg, NULL, 10);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-n calls]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  checked = sweepInOrder();
+  printf("round trip, days in order: %u timestamps over %u days\n", checked, TIMESTAMPBENCH_DAYS);
+  checked = sweepNewDays();
+  printf("round trip, new day per call: %u timestamps\n", checked);
+  checkNowMs();
+  printf("mismatches: %u\n", mismatches);
+
+  srand(1);
+  for (uint32_t i = 0; i < TIMESTAMPBENCH_SAMPLES; i++)
+  {
+    time_t unixTime;
+
+    samples[i] = (timestamp_t)(((uint64_t)rand() << 16 ^ (uint64_t)rand()) %
+                               ((uint64_t)TIMESTAMPBENCH_DAYS * TIMESTAMP_SECONDS_PER_DAY));
+    API_TIMESTAMP_ToRTC(samples[i], &sampleTimes[i], &sampleDates[i]);
+    unixTime = (time_t)(samples[i] + TIMESTAMPBENCH_EPOCH_UNIX);
+    gmtime_r(&unixTime, &sampleTms[i]);
+  }
+
+  printf("\n%-20s %10s\n", "conversion", "ns/call");
+  for (benchPath_t path = 0; path < BENCH_PATH_COUNT; path++)
+  {
+    printf("%-20s %10.1f\n", pathNames[path], timePath(path, calls));
+  }
+
+  if (mismatches != 0U)
+  {
+    printf("FAIL: %u mismatches\n", mismatches);
+    return EXIT_FAILURE;
+  }
+
+  printf("OK: 2000..2099 round trip matches the host calendar\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,427 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "API_app.h"
+#include "API_uart.h"
+#include "sim_check.h"
+
+/*
+ * USART3 line rates: the dividers for PCLK1, the BAUD command with its confirmation and rollback, auto-baud,
+ * then the throughput at each rate, raw and with the firmware running.
+ *
+ *   sim_uartbench [-d seconds]
+ *
+ *   -d  Virtual duration of the firmware run at each rate, default 60 s.
+ *
+ * The raw run sends back-to-back text sample sets; the firmware run shows what the link costs the super
+ * loop with the telemetry the firmware actually sends.
+ *
+ * The host side is the USART3 transmitter of sim_hal.c: bytes sent more than 3 % off the firmware rate
+ * arrive with a framing error. Each run prints its checks and "ok" or "FAILED". Exit status 1 if any
+ * check fails.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define UARTBENCH_DEFAULT_DURATION_S 60U
+#define UARTBENCH_LOOP_STEP_US 1000U  // One SIM_BOARD_Step pass, APP_update excluded
+#define UARTBENCH_SET_SIZE 90U        // Text telemetry of one sample set
+#define UARTBENCH_RAW_US 1000000U     // Virtual duration of the raw throughput run
+#define UARTBENCH_BOOT_MS 1000U       // Firmware start-up before the host talks
+#define UARTBENCH_REPLY_MS 500U       // Longest wait for a reply or a rate change
+#define UARTBENCH_SYNC_PERIOD_MS 20U  // '\r' period of a host waiting for auto-baud
+#define UARTBENCH_HUNT_MS 6000U       // Longest auto-baud wait
+#define UARTBENCH_TEMPERATURE 21.0f
+#define UARTBENCH_HUMIDITY 45.0f
+#define UARTBENCH_SWING_PERIOD_S 60U // Triangle swing of the environment: telemetry is sent on change
+
+/* Private variables ----------------------------------------------------------*/
+
+static const uint32_t rates[UART_BAUD_RATE_COUNT] = UART_BAUD_RATES;
+
+// Firmware output, as read by the host
+static char *captureText;
+static size_t captureSize;
+static FILE *capture;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void bootFirmware(void);
+static bool captured(const char *text);
+static void hostSend(const char *text, uint32_t baudRate);
+static void stepMs(uint32_t ms);
+static bool switchRate(uint32_t from, uint32_t to);
+static bool runDividers(void);
+static bool runRenegotiation(void);
+static bool runAutobaud(void);
+static bool runRaw(void);
+static bool runFirmware(uint32_t seconds);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Powers the board up with a sensor and no card, and starts a new capture of the UART output.
+ * @param  None
+ * @retval None
+ */
+static void bootFirmware(void)
+{
+  if (capture != NULL)
+  {
+    fclose(capture);
+    free(captureText);
+  }
+  capture = open_memstream(&captureText, &captureSize);
+
+  SIM_RTC_PowerOnReset();
+  SIM_TIME_Reset();
+  SIM_UART_SetCapture(capture);
+  SIM_LCD_Reset();
+  SIM_BME280_Reset(NULL);
+  SIM_BME280_SetEnvironment(UARTBENCH_TEMPERATURE, UARTBENCH_HUMIDITY);
+  SIM_FLASH_EraseAll();
+  SIM_SD_Reset(0);
+  SIM_ETH_Reset();
+  SIM_BOARD_Init();
+  stepMs(UARTBENCH_BOOT_MS);
+}
+
+/**
+ * @brief  Looks for a text in the UART output captured so far.
+ * @param  text: Text.
+ * @retval bool: true if found.
+ */
+static bool captured(const char *text)
+{
+  fflush(capture);
+  return captureText != NULL && strstr(captureText, text) != NULL;
+}
+
+/**
+ * @brief  The host sends a text at its rate.
+ * @param  text: Null-terminated text.
+ * @param  baudRate: Host rate.
+ * @retval None
+ */
+static void hostSend(const char *text, uint32_t baudRate)
+{
+  check(SIM_UART_HostSend((const uint8_t *)text, (uint16_t)strlen(text), baudRate), "host queue has room");
+}
+
+/**
+ * @brief  Runs the super loop for a while.
+ * @param  ms: Virtual duration.
+ * @retval None
+ */
+static void stepMs(uint32_t ms)
+{
+  uint64_t end = SIM_TIME_NowUs() + (uint64_t)ms * SIM_US_PER_MS;
+
+  while (SIM_TIME_NowUs() < end)
+  {
+    SIM_BOARD_Step();
+  }
+}
+
+/**
+ * @brief  The host asks for a new rate, waits for the firmware to switch, moves to it and confirms.
+ * @param  from: Current rate.
+ * @param  to: New rate.
+ * @retval bool: true if the firmware confirmed the new rate.
+ */
+static bool switchRate(uint32_t from, uint32_t to)
+{
+  char request[UART_COMMAND_SIZE];
+  uint32_t waited = 0;
+
+  snprintf(request, sizeof(request), "BAUD %u\r", to);
+  hostSend(request, from);
+  while (SIM_UART_GetBaudRate() != to && waited++ < UARTBENCH_REPLY_MS)
+  {
+    stepMs(1);
+  }
+
+  hostSend("OK\r", to);
+  for (waited = 0; uartGetStatus().state != UART_LINK_FIXED && waited < UARTBENCH_REPLY_MS; waited++)
+  {
+    stepMs(1);
+  }
+
+  return uartGetStatus().state == UART_LINK_FIXED && SIM_UART_GetBaudRate() == to;
+}
+
+/**
+ * @brief  Dividers of every supported rate, recomputed from the reference manual formula:
+ *         USARTDIV = PCLK1 / (16 x rate), 4 fraction bits, rounded.
+ * @param  None
+ * @retval bool: true if every divider matches and every rate is within UART_MAX_ERROR_CENTI.
+ */
+static bool runDividers(void)
+{
+  uint32_t before = failures;
+
+  printf("dividers, PCLK1 %u Hz, 16x oversampling\n", HAL_RCC_GetPCLK1Freq());
+  printf("  %8s %6s %10s %8s %8s\n", "rate", "BRR", "USARTDIV", "actual", "error");
+
+  for (uint8_t i = 0; i < UART_BAUD_RATE_COUNT; i++)
+  {
+    uartBaudInfo_t info = uartGetBaudInfo(rates[i]);
+    double ideal = (double)HAL_RCC_GetPCLK1Freq() / rates[i]; // 16 x USARTDIV
+    double actual = (double)HAL_RCC_GetPCLK1Freq() / info.brr;
+    double error = (actual - rates[i]) * 100.0 / rates[i];
+
+    printf("  %8u 0x%04x %5u+%2u/16 %8u %+7.2f%%\n", rates[i], info.brr, info.brr >> 4, info.brr & 0x0FU, info.actual,
+           info.errorCenti / 100.0);
+
+    check(info.brr >= (uint32_t)ideal - 1U && info.brr <= (uint32_t)ideal + 1U, "BRR within one step of the ideal");
+    check(info.actual == (uint32_t)(actual + 0.5), "actual rate is PCLK1 / BRR");
+    check(info.errorCenti / 100.0 - error < 0.01 && error - info.errorCenti / 100.0 < 0.01, "error in 0.01 %");
+    check(info.errorCenti <= UART_MAX_ERROR_CENTI && info.errorCenti >= -UART_MAX_ERROR_CENTI, "within 2 %");
+  }
+
+  uartBaudInfo_t tooFast = uartGetBaudInfo(HAL_RCC_GetPCLK1Freq() / 8U);
+  check(tooFast.errorCenti > UART_MAX_ERROR_CENTI || tooFast.errorCenti < -UART_MAX_ERROR_CENTI,
+        "PCLK1 / 8 is out of reach");
+  check(!uartSetBaudRate(12345U), "rate outside the table refused");
+
+  return checkSection(before);
+}
+
+/**
+ * @brief  BAUD command: a confirmed switch, a switch the host never follows, an unsupported rate, a query.
+ * @param  None
+ * @retval bool: true if the rate follows the protocol in every case.
+ */
+static bool runRenegotiation(void)
+{
+  uint32_t before = failures;
+
+  bootFirmware();
+  check(captured("UART init OK -> baud rate configured = 9600 | stopbits = 1 | parity = odd.\r\n"),
+        "start-up line unchanged");
+
+  // Confirmed switch
+  check(switchRate(9600U, 115200U), "115200 confirmed");
+  check(captured("BAUD 115200 BRR 0x16c actual 115385 error +0.16% send OK\r\n"), "switch reply with the divider");
+  check(captured("BAUD 115200 OK\r\n"), "confirmation reply");
+  stepMs(UART_CONFIRM_TIMEOUT_MS * 2U);
+  check(SIM_UART_GetBaudRate() == 115200U && uartGetStatus().switches == 1U, "confirmed rate kept");
+
+  // The host cannot follow: its "OK" still goes at the old rate and arrives garbled
+  hostSend("BAUD 921600\r", 115200U);
+  stepMs(UARTBENCH_REPLY_MS);
+  check(SIM_UART_GetBaudRate() == 921600U && uartGetStatus().state == UART_LINK_CONFIRMING, "921600 waiting for OK");
+  hostSend("OK\r", 115200U);
+  stepMs(UART_CONFIRM_TIMEOUT_MS);
+  check(SIM_UART_GetBaudRate() == 115200U && uartGetStatus().rollbacks == 1U, "rolled back after the timeout");
+  check(captured("BAUD 115200 restored\r\n"), "rollback reply");
+  check(uartGetStatus().state == UART_LINK_FIXED && uartGetStatus().autobauds == 0U,
+        "garbled OK does not start auto-baud");
+
+  // Unsupported rate and query
+  hostSend("BAUD 12345\r", 115200U);
+  hostSend("BAUD?\r", 115200U);
+  stepMs(UARTBENCH_REPLY_MS);
+  check(captured("BAUD 12345 unsupported\r\n"), "unsupported rate refused");
+  check(captured("BAUD 115200 BRR 0x16c actual 115385 error +0.16%\r\n"), "query reply");
+  check(SIM_UART_GetBaudRate() == 115200U, "rate unchanged by a refusal");
+
+  uartStatus_t status = uartGetStatus();
+  printf("renegotiation: %u switch, %u rollback, %u bytes received, %u errors\n", status.switches, status.rollbacks,
+         status.rxBytes, status.rxErrors);
+  return checkSection(before);
+}
+
+/**
+ * @brief  A host at 230400 sends '\r' until the firmware finds its rate; then a host at a rate outside the
+ *         table gives up, and the firmware goes back to its rate.
+ * @param  None
+ * @retval bool: true if the rate is found and the failed hunt restores the boot rate.
+ */
+static bool runAutobaud(void)
+{
+  uint32_t before = failures;
+
+  bootFirmware();
+
+  uint64_t start = SIM_TIME_NowUs();
+  uint64_t end = start + (uint64_t)UARTBENCH_HUNT_MS * SIM_US_PER_MS;
+  while (uartGetStatus().autobauds == 0U && SIM_TIME_NowUs() < end)
+  {
+    hostSend("\r", 230400U);
+    stepMs(UARTBENCH_SYNC_PERIOD_MS);
+  }
+  check(uartGetStatus().autobauds == 1U && SIM_UART_GetBaudRate() == 230400U, "230400 detected");
+  check(captured("BAUD 230400 detected\r\n"), "detection reply");
+  printf("auto-baud: 230400 found in %llu ms\n", (unsigned long long)((SIM_TIME_NowUs() - start) / SIM_US_PER_MS));
+
+  hostSend("BAUD?\r", 230400U);
+  stepMs(UARTBENCH_REPLY_MS);
+  check(captured("BAUD 230400 BRR 0xb6 actual 230769 error +0.16%\r\n"), "commands at the found rate");
+
+  // 250000 is more than 3 % from every rate of the table
+  bootFirmware();
+  end = SIM_TIME_NowUs() + (uint64_t)(UART_AUTOBAUD_TIMEOUT_MS - UARTBENCH_REPLY_MS) * SIM_US_PER_MS;
+  while (SIM_TIME_NowUs() < end)
+  {
+    hostSend("\r", 250000U);
+    stepMs(UARTBENCH_SYNC_PERIOD_MS);
+  }
+  check(uartGetStatus().state == UART_LINK_HUNTING, "still hunting");
+  stepMs(UARTBENCH_REPLY_MS * 2U);
+  check(uartGetStatus().state == UART_LINK_FIXED && SIM_UART_GetBaudRate() == UART_BOOT_BAUD, "boot rate restored");
+  check(captured("BAUD 9600 restored\r\n"), "failed hunt reply");
+
+  printf("auto-baud: unknown rate, %u errors, back to %u\n", uartGetStatus().rxErrors, SIM_UART_GetBaudRate());
+  return checkSection(before);
+}
+
+/**
+ * @brief  Saturated link: back-to-back sample sets through uartSendStringSize at each rate.
+ * @param  None
+ * @retval bool: true if every rate carries its line rate.
+ */
+static bool runRaw(void)
+{
+  uint8_t set[UARTBENCH_SET_SIZE];
+  uint32_t before = failures;
+
+  memset(set, 'x', sizeof(set));
+  SIM_TIME_Reset();
+  SIM_UART_SetCapture(NULL);
+  uartInit();
+
+  printf("raw throughput, %u-byte sets\n", UARTBENCH_SET_SIZE);
+  printf("  %8s %10s %10s %10s\n", "rate", "sets/s", "ms/set", "bytes/s");
+
+  for (uint8_t i = 0; i < UART_BAUD_RATE_COUNT; i++)
+  {
+    uint32_t sets = 0;
+
+    check(uartSetBaudRate(rates[i]), "rate set");
+
+    uint64_t start = SIM_TIME_NowUs();
+    while (SIM_TIME_NowUs() - start < UARTBENCH_RAW_US)
+    {
+      uartSendStringSize(set, UARTBENCH_SET_SIZE);
+      sets++;
+    }
+
+    double seconds = (double)(SIM_TIME_NowUs() - start) / SIM_US_PER_SECOND;
+    double bytesPerSecond = sets * UARTBENCH_SET_SIZE / seconds;
+    uint32_t lineRate = uartGetBaudInfo(rates[i]).actual / SIM_UART_BITS_PER_BYTE;
+
+    printf("  %8u %10.1f %10.3f %10.0f\n", rates[i], sets / seconds, 1000.0 / (sets / seconds), bytesPerSecond);
+    check(bytesPerSecond > lineRate * 0.99 && bytesPerSecond < lineRate * 1.01, "line rate reached");
+  }
+
+  return checkSection(before);
+}
+
+/**
+ * @brief  The firmware at each rate, switched with the BAUD command: UART busy time, and the part of each
+ *         APP_update spent transmitting next to its whole duration.
+ * @param  seconds: Virtual duration at each rate.
+ * @retval bool: true if every switch is confirmed and a faster link never transmits longer.
+ */
+static bool runFirmware(uint32_t seconds)
+{
+  uint32_t before = failures;
+  uint64_t previousWorstUart = UINT64_MAX;
+
+  printf("firmware, %u s at each rate\n", seconds);
+  printf("  %8s %8s %8s %15s %15s\n", "rate", "busy", "bytes/s", "uart mean/worst", "update mean/worst");
+
+  for (uint8_t i = 0; i < UART_BAUD_RATE_COUNT; i++)
+  {
+    uint64_t updateTotalUs = 0;
+    uint64_t updateWorstUs = 0;
+    uint64_t uartTotalUs = 0;
+    uint64_t uartWorstUs = 0;
+    uint32_t updates = 0;
+
+    bootFirmware();
+    if (rates[i] != UART_BOOT_BAUD)
+    {
+      check(switchRate(UART_BOOT_BAUD, rates[i]), "switch confirmed");
+    }
+
+    uint64_t start = SIM_TIME_NowUs();
+    uint64_t busyStart = SIM_UART_GetBusyUs();
+    uint32_t bytesStart = SIM_UART_GetBytesSent();
+    uint64_t end = start + (uint64_t)seconds * SIM_US_PER_SECOND;
+
+    while (SIM_TIME_NowUs() < end)
+    {
+      uint64_t stepStart = SIM_TIME_NowUs();
+      uint64_t busyBefore = SIM_UART_GetBusyUs();
+      uint32_t second = (uint32_t)((stepStart - start) / SIM_US_PER_SECOND);
+      float phase = (float)(second % UARTBENCH_SWING_PERIOD_S) / UARTBENCH_SWING_PERIOD_S;
+      float swing = phase < 0.5f ? phase : 1.0f - phase;
+
+      SIM_BME280_SetEnvironment(UARTBENCH_TEMPERATURE + 4.0f * swing, UARTBENCH_HUMIDITY + 10.0f * swing);
+      if (SIM_BOARD_Step())
+      {
+        uint64_t updateUs = SIM_TIME_NowUs() - stepStart - UARTBENCH_LOOP_STEP_US;
+        uint64_t uartUs = SIM_UART_GetBusyUs() - busyBefore;
+
+        updateTotalUs += updateUs;
+        updateWorstUs = updateUs > updateWorstUs ? updateUs : updateWorstUs;
+        uartTotalUs += uartUs;
+        uartWorstUs = uartUs > uartWorstUs ? uartUs : uartWorstUs;
+        updates++;
+      }
+    }
+
+    double elapsed = (double)(SIM_TIME_NowUs() - start);
+    double busy = (double)(SIM_UART_GetBusyUs() - busyStart) * 100.0 / elapsed;
+    double bytesPerSecond = (SIM_UART_GetBytesSent() - bytesStart) * (double)SIM_US_PER_SECOND / elapsed;
+    double count = updates > 0U ? updates : 1U;
+
+    printf("  %8u %7.2f%% %8.0f %6.2f/%6.2f ms %6.2f/%6.2f ms\n", rates[i], busy, bytesPerSecond,
+           uartTotalUs / 1000.0 / count, uartWorstUs / 1000.0, updateTotalUs / 1000.0 / count, updateWorstUs / 1000.0);
+    check(SIM_UART_GetBaudRate() == rates[i] && uartGetStatus().rollbacks == 0U, "rate held for the whole run");
+    check(uartWorstUs <= previousWorstUart, "worst transmit time no longer than at the slower rate");
+    previousWorstUart = uartWorstUs;
+  }
+
+  return checkSection(before);
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+  uint32_t seconds = UARTBENCH_DEFAULT_DURATION_S;
+  bool ok = true;
+  int option;
+
+  while ((option = getopt(argc, argv, "d:")) != -1)
+  {
+    switch (option)
+    {
+    case 'd':
+      seconds = (uint32_t)strtoul(optarg, NULL, 10);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-d seconds]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  ok = runDividers() && ok;
+  ok = runRenegotiation() && ok;
+  ok = runAutobaud() && ok;
+  ok = runRaw() && ok;
+  ok = runFirmware(seconds) && ok;
+
+  if (capture != NULL)
+  {
+    fclose(capture);
+    free(captureText);
+  }
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
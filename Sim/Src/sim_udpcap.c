@@ -0,0 +1,535 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "API_app.h"
+#include "API_udp.h"
+#include "sim_check.h"
+
+/*
+ * UDP publisher against a collector decoding every frame on its own, on the Ethernet MAC stub: the
+ * header templates and their checksums, batching and the descriptor ring, then the firmware itself.
+ *
+ *   sim_udpcap [-d seconds] [-o capture.pcap]
+ *
+ *   -d  Virtual duration of the firmware run, default 600 s.
+ *   -o  pcap capture of the firmware run, readable by tcpdump or Wireshark.
+ *
+ * Every frame is checked from scratch: Ethernet, IPv4 and UDP fields, both checksums, payload header,
+ * then its records against the ones appended. Each run prints its checks and "ok" or "FAILED".
+ * Exit status 1 if any check fails.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define UDPCAP_DEFAULT_DURATION_S 600U
+#define UDPCAP_MAX_RECORDS 2000000U      // Records kept by the collector
+#define UDPCAP_BUILDER_RECORDS 1000U
+#define UDPCAP_BUILDER_BATCH 7U          // Not a divisor of the record count: the last frame is flushed
+#define UDPCAP_BUILDER_PASS_US 100U
+#define UDPCAP_THROUGHPUT_US 1000000U    // Virtual duration of the throughput run
+#define UDPCAP_WRITER_PASS_US 10U        // Writer loop period of the throughput run
+#define UDPCAP_WRITER_RECORDS 50U        // Records offered per pass, more than the link carries
+#define UDPCAP_WIRE_BITS_PER_SECOND 100000000.0
+#define UDPCAP_WIRE_OVERHEAD 24U         // Preamble and SFD, FCS, inter-frame gap
+#define UDPCAP_TEMPERATURE 21.0f
+#define UDPCAP_HUMIDITY 45.0f
+#define UDPCAP_SWING_PERIOD_S 120U
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  uint32_t tick;
+  int32_t temperature;
+  uint32_t humidity;
+} udpcapRecord_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+static udpConfig_t expectedConfig;
+static uint8_t expectedMac[UDP_MAC_SIZE];
+
+// Collector side
+static udpcapRecord_t *received;
+static uint32_t receivedCount;
+static uint32_t receivedFrames;
+static uint32_t wireBytes;
+static uint32_t badFrames;
+static uint32_t expectedSequence;
+static uint16_t expectedId;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static uint16_t getBE16(const uint8_t *bytes);
+static uint32_t getLE32(const uint8_t *bytes);
+static uint16_t checksum(uint32_t sum, const uint8_t *bytes, uint16_t length);
+static bool decodeFrame(const uint8_t *frame, uint16_t length);
+static void collect(const uint8_t *frame, uint16_t length);
+static void startCollector(const udpConfig_t *config);
+static udpConfig_t makeConfig(bool broadcast, uint8_t batchRecords);
+static void drain(void);
+static bool runBuilder(void);
+static bool runBroadcast(void);
+static bool runThroughput(void);
+static bool runFirmware(uint32_t seconds, FILE *pcap);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Reads a big-endian 16-bit value.
+ * @param  bytes: Source bytes.
+ * @retval uint16_t: Value.
+ */
+static uint16_t getBE16(const uint8_t *bytes)
+{
+  return (uint16_t)((bytes[0] << 8) | bytes[1]);
+}
+
+/**
+ * @brief  Reads a little-endian 32-bit value.
+ * @param  bytes: Source bytes.
+ * @retval uint32_t: Value.
+ */
+static uint32_t getLE32(const uint8_t *bytes)
+{
+  return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+/**
+ * @brief  Internet checksum computed from scratch, odd lengths padded with a zero byte.
+ * @param  sum: Initial sum (pseudo header).
+ * @param  bytes: Covered bytes.
+ * @param  length: Number of bytes.
+ * @retval uint16_t: Folded sum, 0xFFFF when the covered bytes include a correct checksum.
+ */
+static uint16_t checksum(uint32_t sum, const uint8_t *bytes, uint16_t length)
+{
+  for (uint16_t i = 0; i + 1U < length; i += 2U)
+  {
+    sum += getBE16(&bytes[i]);
+  }
+  if ((length & 1U) != 0U)
+  {
+    sum += (uint32_t)bytes[length - 1U] << 8;
+  }
+  while ((sum >> 16) != 0U)
+  {
+    sum = (sum & 0xFFFFU) + (sum >> 16);
+  }
+
+  return (uint16_t)sum;
+}
+
+/**
+ * @brief  Decodes a frame as the collector would and keeps its records.
+ * @param  frame: Frame, FCS excluded.
+ * @param  length: Frame length.
+ * @retval bool: true if every field and both checksums are as expected.
+ */
+static bool decodeFrame(const uint8_t *frame, uint16_t length)
+{
+  const uint8_t *ip = frame + UDP_ETH_HEADER_SIZE;
+  const uint8_t *udp = ip + UDP_IP_HEADER_SIZE;
+  const uint8_t *payload = udp + UDP_UDP_HEADER_SIZE;
+
+  if (length < UDP_HEADERS_SIZE + UDP_PAYLOAD_HEADER_SIZE || length > UDP_MAX_FRAME_SIZE)
+  {
+    return false;
+  }
+
+  uint16_t ipLength = getBE16(&ip[2]);
+  uint16_t udpLength = getBE16(&udp[4]);
+  uint8_t count = payload[3];
+
+  // Ethernet II
+  bool ok = memcmp(&frame[0], expectedConfig.destinationMac, UDP_MAC_SIZE) == 0 &&
+            memcmp(&frame[6], expectedMac, UDP_MAC_SIZE) == 0 && getBE16(&frame[12]) == 0x0800U;
+
+  // IPv4: version, lengths, identification, don't fragment, TTL, protocol, addresses, header checksum
+  ok = ok && ip[0] == 0x45U && ipLength == length - UDP_ETH_HEADER_SIZE && getBE16(&ip[4]) == expectedId &&
+       getBE16(&ip[6]) == 0x4000U && ip[8] == 64U && ip[9] == 17U &&
+       memcmp(&ip[12], expectedConfig.sourceIp, UDP_IP_SIZE) == 0 &&
+       memcmp(&ip[16], expectedConfig.destinationIp, UDP_IP_SIZE) == 0 &&
+       checksum(0, ip, UDP_IP_HEADER_SIZE) == 0xFFFFU;
+
+  // UDP: ports, length, checksum over the pseudo header and the datagram
+  uint32_t pseudo = checksum(0, &ip[12], 2U * UDP_IP_SIZE) + 17U + udpLength;
+  ok = ok && getBE16(&udp[0]) == expectedConfig.sourcePort && getBE16(&udp[2]) == expectedConfig.destinationPort &&
+       udpLength == ipLength - UDP_IP_HEADER_SIZE && getBE16(&udp[6]) != 0U &&
+       checksum(pseudo, udp, udpLength) == 0xFFFFU;
+
+  // Payload header and records
+  ok = ok && payload[0] == (uint8_t)UDP_PAYLOAD_MAGIC && payload[1] == (uint8_t)(UDP_PAYLOAD_MAGIC >> 8) &&
+       payload[2] == UDP_PAYLOAD_VERSION && count > 0U && count <= expectedConfig.batchRecords &&
+       udpLength == UDP_UDP_HEADER_SIZE + UDP_PAYLOAD_HEADER_SIZE + count * UDP_RECORD_SIZE &&
+       getLE32(&payload[4]) == expectedSequence;
+  if (!ok)
+  {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < count && receivedCount < UDPCAP_MAX_RECORDS; i++)
+  {
+    const uint8_t *record = payload + UDP_PAYLOAD_HEADER_SIZE + i * UDP_RECORD_SIZE;
+
+    received[receivedCount].tick = getLE32(&record[0]);
+    received[receivedCount].temperature = (int32_t)getLE32(&record[4]);
+    received[receivedCount].humidity = getLE32(&record[8]);
+    receivedCount++;
+  }
+
+  return true;
+}
+
+/**
+ * @brief  Collector: decodes each frame leaving the wire. Sequence and identification follow the frames sent.
+ * @param  frame: Frame.
+ * @param  length: Frame length.
+ * @retval None
+ */
+static void collect(const uint8_t *frame, uint16_t length)
+{
+  if (!decodeFrame(frame, length))
+  {
+    badFrames++;
+  }
+  receivedFrames++;
+  wireBytes += (length < 60U ? 60U : length) + UDPCAP_WIRE_OVERHEAD;
+  expectedSequence++;
+  expectedId++;
+}
+
+/**
+ * @brief  Clears the collector and sets what it expects.
+ * @param  config: Publisher configuration.
+ * @retval None
+ */
+static void startCollector(const udpConfig_t *config)
+{
+  expectedConfig = *config;
+  SIM_ETH_GetMac(expectedMac);
+  receivedCount = 0;
+  receivedFrames = 0;
+  wireBytes = 0;
+  badFrames = 0;
+  expectedSequence = 0;
+  expectedId = 0;
+  SIM_ETH_SetReader(collect);
+}
+
+/**
+ * @brief  Collector at 192.168.1.10:5005 behind a static ARP entry, or the subnet broadcast.
+ * @param  broadcast: true for the broadcast MAC and address.
+ * @param  batchRecords: Records per datagram.
+ * @retval udpConfig_t: Configuration.
+ */
+static udpConfig_t makeConfig(bool broadcast, uint8_t batchRecords)
+{
+  udpConfig_t config = {
+      .destinationMac = {0x00, 0x1B, 0x21, 0x3A, 0x4C, 0x5E},
+      .sourceIp = {192, 168, 1, 50},
+      .destinationIp = {192, 168, 1, 10},
+      .sourcePort = 49152U,
+      .destinationPort = 5005U,
+      .batchRecords = batchRecords,
+  };
+
+  if (broadcast)
+  {
+    memset(config.destinationMac, 0xFF, UDP_MAC_SIZE);
+    config.destinationIp[3] = 255U;
+  }
+
+  return config;
+}
+
+/**
+ * @brief  Lets every queued frame leave the wire and returns the buffers.
+ * @param  None
+ * @retval None
+ */
+static void drain(void)
+{
+  SIM_TIME_AdvanceUs(SIM_US_PER_MS);
+  API_UDP_Process((uint32_t)(SIM_TIME_NowUs() / SIM_US_PER_MS));
+}
+
+/**
+ * @brief  Unicast datagrams of UDPCAP_BUILDER_BATCH records with values exercising the checksum carries,
+ *         the last one flushed part full.
+ * @param  None
+ * @retval bool: true if the collector decoded every record, in order.
+ */
+static bool runBuilder(void)
+{
+  udpConfig_t config = makeConfig(false, UDPCAP_BUILDER_BATCH);
+  udpcapRecord_t *sent = malloc(UDPCAP_BUILDER_RECORDS * sizeof(udpcapRecord_t));
+  uint32_t before = failures;
+
+  SIM_TIME_Reset();
+  SIM_ETH_Reset();
+  SIM_ETH_SetLink(true);
+  check(API_UDP_Init(&config), "MAC ready");
+  startCollector(&config);
+  API_UDP_Process(0);
+  check(API_UDP_GetStatus().linkUp, "link up at the first poll");
+
+  for (uint32_t i = 0; i < UDPCAP_BUILDER_RECORDS; i++)
+  {
+    sent[i].tick = 0xFFFF0000UL + i * 97U;
+    sent[i].temperature = (int32_t)(i * 37U) - 4000;
+    sent[i].humidity = 0xFFFFU - i * 29U;
+    check(API_UDP_Append(sent[i].tick, sent[i].temperature, sent[i].humidity), "record accepted");
+    SIM_TIME_AdvanceUs(UDPCAP_BUILDER_PASS_US);
+    API_UDP_Process((uint32_t)(SIM_TIME_NowUs() / SIM_US_PER_MS));
+  }
+  check(API_UDP_Flush(), "last frame flushed");
+  drain();
+
+  udpStatus_t status = API_UDP_GetStatus();
+  uint32_t frames = (UDPCAP_BUILDER_RECORDS + UDPCAP_BUILDER_BATCH - 1U) / UDPCAP_BUILDER_BATCH;
+
+  check(status.frames == frames && receivedFrames == frames, "one frame per batch");
+  check(badFrames == 0U, "every frame decodes, both checksums correct");
+  check(receivedCount == UDPCAP_BUILDER_RECORDS &&
+            memcmp(received, sent, UDPCAP_BUILDER_RECORDS * sizeof(udpcapRecord_t)) == 0,
+        "records arrive unchanged and in order");
+  check(status.droppedRecords == 0U && status.txErrors == 0U, "nothing dropped");
+  check(SIM_ETH_GetOwnershipErrors() == 0U && SIM_ETH_GetRefusedFrames() == 0U, "no buffer written while owned");
+  check(expectedMac[0] == 0x02U && expectedMac[1] == 0x80U && expectedMac[2] == 0xE1U, "locally administered MAC");
+
+  printf("builder: %u records in %u frames of up to %u, %u bad\n", receivedCount, receivedFrames,
+         UDPCAP_BUILDER_BATCH, badFrames);
+  bool passed = checkSection(before);
+
+  SIM_ETH_SetReader(NULL);
+  free(sent);
+
+  return passed;
+}
+
+/**
+ * @brief  Broadcast datagrams of a single record, the shortest frames, across a link down and up.
+ * @param  None
+ * @retval bool: true if records are ignored while the link is down and the stream resumes after.
+ */
+static bool runBroadcast(void)
+{
+  udpConfig_t config = makeConfig(true, 1U);
+  uint32_t before = failures;
+  uint32_t nowMs;
+
+  SIM_TIME_Reset();
+  SIM_ETH_Reset();
+  SIM_ETH_SetLink(true);
+  check(API_UDP_Init(&config), "MAC ready");
+  startCollector(&config);
+  API_UDP_Process(0);
+
+  for (uint32_t i = 0; i < 10U; i++)
+  {
+    check(API_UDP_Append(i, -(int32_t)i, i), "record accepted");
+    drain();
+  }
+
+  // Cable out: the next poll sees it, records are ignored until the link is back
+  SIM_ETH_SetLink(false);
+  nowMs = (uint32_t)(SIM_TIME_NowUs() / SIM_US_PER_MS) + UDP_LINK_POLL_MS;
+  SIM_TIME_AdvanceUs((uint64_t)UDP_LINK_POLL_MS * SIM_US_PER_MS);
+  API_UDP_Process(nowMs);
+  check(!API_UDP_GetStatus().linkUp, "link down seen");
+  check(!API_UDP_Append(100U, 0, 0), "record ignored while down");
+
+  SIM_ETH_SetLink(true);
+  SIM_TIME_AdvanceUs((uint64_t)UDP_LINK_POLL_MS * SIM_US_PER_MS);
+  API_UDP_Process(nowMs + UDP_LINK_POLL_MS);
+  for (uint32_t i = 10; i < 20U; i++)
+  {
+    check(API_UDP_Append(i, -(int32_t)i, i), "record accepted after the link is back");
+    drain();
+  }
+
+  udpStatus_t status = API_UDP_GetStatus();
+
+  check(receivedFrames == 20U && receivedCount == 20U && badFrames == 0U, "20 broadcast frames decode");
+  check(status.linkChanges == 3U, "up, down, up");
+  check(status.droppedRecords == 0U, "ignored records are not counted as dropped");
+
+  printf("broadcast: %u frames of %u bytes, %u link changes\n", receivedFrames,
+         UDP_HEADERS_SIZE + UDP_PAYLOAD_HEADER_SIZE + UDP_RECORD_SIZE, status.linkChanges);
+  bool passed = checkSection(before);
+
+  SIM_ETH_SetReader(NULL);
+
+  return passed;
+}
+
+/**
+ * @brief  Saturated output: a writer offering more records than the link carries, in full datagrams.
+ * @param  None
+ * @retval bool: true if the wire stays busy and every frame sent decodes.
+ */
+static bool runThroughput(void)
+{
+  udpConfig_t config = makeConfig(false, (uint8_t)UDP_MAX_RECORDS);
+  uint32_t before = failures;
+  uint32_t tick = 0;
+
+  SIM_TIME_Reset();
+  SIM_ETH_Reset();
+  SIM_ETH_SetLink(true);
+  API_UDP_Init(&config);
+  startCollector(&config);
+  API_UDP_Process(0);
+
+  while (SIM_TIME_NowUs() < UDPCAP_THROUGHPUT_US)
+  {
+    for (uint32_t i = 0; i < UDPCAP_WRITER_RECORDS; i++)
+    {
+      API_UDP_Append(tick++, 2100, 46080U);
+    }
+    SIM_TIME_AdvanceUs(UDPCAP_WRITER_PASS_US);
+    API_UDP_Process((uint32_t)(SIM_TIME_NowUs() / SIM_US_PER_MS));
+  }
+  drain();
+
+  udpStatus_t status = API_UDP_GetStatus();
+  double seconds = (double)UDPCAP_THROUGHPUT_US / SIM_US_PER_SECOND;
+  double load = (double)wireBytes * 8.0 / (UDPCAP_WIRE_BITS_PER_SECOND * seconds);
+
+  check(badFrames == 0U && receivedCount == status.records, "every frame decodes");
+  check(load > 0.95, "wire busy more than 95 % of the time");
+  check(SIM_ETH_GetOwnershipErrors() == 0U && status.txErrors == 0U, "no buffer written while owned");
+
+  printf("throughput: %u frames, %.0f records/s, %.1f Mbit/s of payload, wire %.1f %% busy, %u records dropped\n",
+         receivedFrames, receivedCount / seconds, receivedCount * UDP_RECORD_SIZE * 8.0 / seconds / 1e6,
+         load * 100.0, status.droppedRecords);
+  bool passed = checkSection(before);
+
+  SIM_ETH_SetReader(NULL);
+
+  return passed;
+}
+
+/**
+ * @brief  The firmware with the cable plugged in and a collector on the subnet broadcast.
+ * @param  seconds: Virtual duration.
+ * @param  pcap: Capture file, NULL for none.
+ * @retval bool: true if every raw sample arrives once and in order.
+ */
+static bool runFirmware(uint32_t seconds, FILE *pcap)
+{
+  udpConfig_t config = makeConfig(true, APP_UDP_BATCH_RECORDS);
+  uint64_t end = (uint64_t)seconds * SIM_US_PER_SECOND;
+  uint32_t before = failures;
+  uint32_t disorders = 0;
+
+  // The collector expects what API_app.h configures
+  uint8_t mac[UDP_MAC_SIZE] = APP_UDP_COLLECTOR_MAC;
+  uint8_t destinationIp[UDP_IP_SIZE] = APP_UDP_COLLECTOR_IP;
+  uint8_t sourceIp[UDP_IP_SIZE] = APP_UDP_BOARD_IP;
+  memcpy(config.destinationMac, mac, UDP_MAC_SIZE);
+  memcpy(config.destinationIp, destinationIp, UDP_IP_SIZE);
+  memcpy(config.sourceIp, sourceIp, UDP_IP_SIZE);
+  config.sourcePort = APP_UDP_BOARD_PORT;
+  config.destinationPort = APP_UDP_COLLECTOR_PORT;
+
+  SIM_RTC_PowerOnReset();
+  SIM_TIME_Reset();
+  SIM_UART_SetCapture(NULL);
+  SIM_LCD_Reset();
+  SIM_BME280_Reset(NULL);
+  SIM_BME280_SetEnvironment(UDPCAP_TEMPERATURE, UDPCAP_HUMIDITY);
+  SIM_FLASH_EraseAll();
+  SIM_SD_Reset(0);
+  SIM_ETH_Reset();
+  SIM_ETH_SetLink(true);
+  SIM_ETH_SetCapture(pcap);
+  SIM_BOARD_Init();
+  startCollector(&config);
+
+  while (SIM_TIME_NowUs() < end)
+  {
+    uint32_t second = (uint32_t)(SIM_TIME_NowUs() / SIM_US_PER_SECOND);
+    float phase = (float)(second % UDPCAP_SWING_PERIOD_S) / UDPCAP_SWING_PERIOD_S;
+    float swing = phase < 0.5f ? phase : 1.0f - phase;
+
+    SIM_BME280_SetEnvironment(UDPCAP_TEMPERATURE + 4.0f * swing, UDPCAP_HUMIDITY + 10.0f * swing);
+    SIM_BOARD_Step();
+  }
+  SIM_ETH_SetCapture(NULL);
+  SIM_ETH_SetReader(NULL);
+
+  udpStatus_t status = API_UDP_GetStatus();
+
+  for (uint32_t i = 1; i < receivedCount; i++)
+  {
+    if (received[i].tick <= received[i - 1U].tick)
+    {
+      disorders++;
+    }
+  }
+
+  check(badFrames == 0U && receivedFrames == status.frames, "every frame decodes, no sequence gap");
+  check(receivedCount == status.records && receivedCount == receivedFrames * APP_UDP_BATCH_RECORDS,
+        "every datagram full");
+  check(disorders == 0U, "samples in time order, none repeated");
+  check(status.droppedRecords == 0U && status.txErrors == 0U && SIM_ETH_GetOwnershipErrors() == 0U,
+        "nothing dropped, no buffer written while owned");
+
+  printf("firmware %u s: %u records in %u frames, %u out of order, %u dropped\n", seconds, receivedCount,
+         receivedFrames, disorders, status.droppedRecords);
+  return checkSection(before);
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+  uint32_t seconds = UDPCAP_DEFAULT_DURATION_S;
+  FILE *pcap = NULL;
+  bool ok = true;
+  int option;
+
+  while ((option = getopt(argc, argv, "d:o:")) != -1)
+  {
+    switch (option)
+    {
+    case 'd':
+      seconds = (uint32_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'o':
+      pcap = fopen(optarg, "wb");
+      if (pcap == NULL)
+      {
+        perror(optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-d seconds] [-o capture.pcap]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  received = malloc(UDPCAP_MAX_RECORDS * sizeof(udpcapRecord_t));
+  if (received == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+
+  ok = runBuilder() && ok;
+  ok = runBroadcast() && ok;
+  ok = runThroughput() && ok;
+  ok = runFirmware(seconds, pcap) && ok;
+
+  if (pcap != NULL)
+  {
+    fclose(pcap);
+  }
+  free(received);
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
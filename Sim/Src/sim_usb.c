@@ -0,0 +1,500 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "sim.h"
+#include "API_usb_cdc.h"
+#include "API_usb_cdc_port.h"
+
+/*
+ * OTG_FS device controller behind the USB_HAL_* port, driven by a scripted host.
+ * The SIM_USB_* calls play the host side: each one raises the PCD events the HAL would report
+ * (reset, SETUP, IN and OUT completions, suspend, VBUS loss) by calling API_USBCDC_On* directly,
+ * as HAL_PCD_IRQHandler does through the callbacks of API_usb_cdc_port.c.
+ * An IN transfer completes as a whole (the HAL reports the end of the transfer, not packets);
+ * on endpoint 0 the class sends one max packet per transfer, as the HAL requires.
+ *
+ * With a host reader set, the bulk IN endpoint is also read in the background as virtual time passes
+ * (SIM_USB_Tick, called by SIM_TIME_AdvanceUs like the RTC wake-up interrupt): at most
+ * SIM_USB_PACKETS_PER_FRAME packets per 1 ms frame, a zero-length packet taking a packet slot.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define SIM_USB_EP_MASK 0x0FU
+#define SIM_USB_DIR_IN 0x80U
+#define SIM_USB_MAX_TRANSFER 1024U // Largest IN transfer copied for the host
+#define SIM_USB_NS_PER_US 1000ULL
+#define SIM_USB_PACKETS_PER_FRAME 19U // Bulk 64-byte packets a 1 ms full-speed frame can carry at most
+#define SIM_USB_PACKET_SLOT_NS (1000000ULL / SIM_USB_PACKETS_PER_FRAME)
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct
+{
+  bool open;
+  bool stalled;
+  bool pending;         // IN: transfer started. OUT: endpoint armed
+  uint8_t type;
+  uint16_t maxPacket;
+  const uint8_t *inData; // IN: bytes of the pending transfer
+  uint8_t *outData;      // OUT: receive buffer
+  uint16_t length;
+} simEndpoint_t;
+
+/* Private variables ----------------------------------------------------------*/
+
+static simEndpoint_t inEndpoints[USB_HAL_DEVICE_ENDPOINTS];
+static simEndpoint_t outEndpoints[USB_HAL_DEVICE_ENDPOINTS];
+static uint8_t deviceAddress;
+static bool started;
+static uint32_t controllerErrors; // Port calls the real controller would refuse
+
+static simUsbReader_t hostReader; // Background reader of the bulk IN endpoint, NULL if none
+static uint8_t hostReaderEndpoint;
+static uint64_t hostCursorNs;     // Bus time up to which the reader is busy
+static uint8_t hostBuffer[SIM_USB_MAX_TRANSFER];
+
+/* Private Function Prototypes ---------------------------------------------- */
+static simEndpoint_t *endpoint(uint8_t address);
+static void clearEndpoints(void);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Endpoint record of an address, NULL if out of range.
+ * @param  address: Endpoint address, bit 7 set for IN.
+ * @retval simEndpoint_t *: Record.
+ */
+static simEndpoint_t *endpoint(uint8_t address)
+{
+  uint8_t number = address & SIM_USB_EP_MASK;
+
+  if (number >= USB_HAL_DEVICE_ENDPOINTS)
+  {
+    return NULL;
+  }
+
+  return (address & SIM_USB_DIR_IN) != 0U ? &inEndpoints[number] : &outEndpoints[number];
+}
+
+/**
+ * @brief  Forgets every endpoint and the address, as a bus reset does.
+ * @param  None
+ * @retval None
+ */
+static void clearEndpoints(void)
+{
+  memset(inEndpoints, 0, sizeof(inEndpoints));
+  memset(outEndpoints, 0, sizeof(outEndpoints));
+  deviceAddress = 0U;
+}
+
+/* Port Function Definitions ------------------------------------------------ */
+
+bool USB_HAL_Init(void)
+{
+  clearEndpoints();
+  controllerErrors = 0U;
+  started = true;
+  return true;
+}
+
+void USB_HAL_OpenEndpoint(uint8_t address, uint16_t maxPacket, uint8_t type)
+{
+  simEndpoint_t *ep = endpoint(address);
+
+  if (ep == NULL)
+  {
+    controllerErrors++;
+    return;
+  }
+
+  memset(ep, 0, sizeof(*ep));
+  ep->open = true;
+  ep->maxPacket = maxPacket;
+  ep->type = type;
+}
+
+void USB_HAL_CloseEndpoint(uint8_t address)
+{
+  simEndpoint_t *ep = endpoint(address);
+
+  if (ep != NULL)
+  {
+    memset(ep, 0, sizeof(*ep));
+  }
+}
+
+bool USB_HAL_Transmit(uint8_t address, const uint8_t *data, uint16_t length)
+{
+  simEndpoint_t *ep = endpoint(address);
+
+  // A transfer on a closed or busy endpoint, or more than one packet on endpoint 0, is a class bug
+  if (ep == NULL || !ep->open || ep->pending || ((address & SIM_USB_EP_MASK) == 0U && length > ep->maxPacket) ||
+      length > SIM_USB_MAX_TRANSFER)
+  {
+    controllerErrors++;
+    return false;
+  }
+
+  ep->pending = true;
+  ep->inData = data;
+  ep->length = length;
+  return true;
+}
+
+bool USB_HAL_Receive(uint8_t address, uint8_t *data, uint16_t length)
+{
+  simEndpoint_t *ep = endpoint(address);
+
+  if (ep == NULL || !ep->open)
+  {
+    controllerErrors++;
+    return false;
+  }
+
+  ep->pending = true;
+  ep->outData = data;
+  ep->length = length;
+  return true;
+}
+
+void USB_HAL_Stall(uint8_t address)
+{
+  simEndpoint_t *ep = endpoint(address);
+
+  if (ep != NULL)
+  {
+    ep->stalled = true;
+    ep->pending = false;
+  }
+}
+
+void USB_HAL_ClearStall(uint8_t address)
+{
+  simEndpoint_t *ep = endpoint(address);
+
+  if (ep != NULL)
+  {
+    ep->stalled = false;
+  }
+}
+
+void USB_HAL_SetAddress(uint8_t address)
+{
+  deviceAddress = address;
+}
+
+void USB_HAL_GetUniqueId(uint32_t *words)
+{
+  words[0] = 0x00350041UL;
+  words[1] = 0x3530510AUL;
+  words[2] = 0x38363331UL;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+/**
+ * @brief  Host: bus reset, then the reset event. The controller forgets its endpoints and address.
+ * @param  None
+ * @retval bool: false if the firmware never started the controller.
+ */
+bool SIM_USB_Reset(void)
+{
+  if (!started)
+  {
+    return false;
+  }
+
+  clearEndpoints();
+  API_USBCDC_OnReset();
+  return true;
+}
+
+/**
+ * @brief  Host: control read. SETUP, IN data packets until a short packet or wLength, then the OUT status.
+ * @param  setup: The 8 SETUP bytes.
+ * @param  data: Receives the answer, wLength bytes at most.
+ * @retval int32_t: Answer length, SIM_USB_STALL if refused, SIM_USB_PROTOCOL_ERROR on a handshake error.
+ */
+int32_t SIM_USB_ControlRead(const uint8_t *setup, uint8_t *data)
+{
+  uint16_t requested = (uint16_t)(setup[6] | (setup[7] << 8));
+  uint16_t received = 0;
+  uint16_t packet;
+
+  // A SETUP packet clears the endpoint 0 stall and aborts whatever transfer was in progress
+  inEndpoints[0].stalled = false;
+  inEndpoints[0].pending = false;
+  outEndpoints[0].stalled = false;
+  outEndpoints[0].pending = false;
+  API_USBCDC_OnSetup(setup);
+
+  do
+  {
+    if (inEndpoints[0].stalled)
+    {
+      return SIM_USB_STALL;
+    }
+    if (!inEndpoints[0].pending)
+    {
+      return SIM_USB_PROTOCOL_ERROR;
+    }
+
+    packet = inEndpoints[0].length;
+    if (packet > requested - received)
+    {
+      return SIM_USB_PROTOCOL_ERROR; // Babble
+    }
+    memcpy(data + received, inEndpoints[0].inData, packet);
+    received += packet;
+    inEndpoints[0].pending = false;
+    API_USBCDC_OnDataIn(0U);
+  } while (packet == inEndpoints[0].maxPacket && received < requested);
+
+  // Status stage: a zero-length OUT packet, the device must have armed endpoint 0
+  if (!outEndpoints[0].pending || inEndpoints[0].pending)
+  {
+    return SIM_USB_PROTOCOL_ERROR;
+  }
+  outEndpoints[0].pending = false;
+  API_USBCDC_OnDataOut(0U, 0U);
+
+  return received;
+}
+
+/**
+ * @brief  Host: control write. SETUP, the OUT data if any, then the IN status.
+ * @param  setup: The 8 SETUP bytes, wLength being the data length.
+ * @param  data: Request data, NULL if wLength is 0.
+ * @retval int32_t: 0 on success, SIM_USB_STALL if refused, SIM_USB_PROTOCOL_ERROR on a handshake error.
+ */
+int32_t SIM_USB_ControlWrite(const uint8_t *setup, const uint8_t *data)
+{
+  uint16_t length = (uint16_t)(setup[6] | (setup[7] << 8));
+
+  // A SETUP packet clears the endpoint 0 stall and aborts whatever transfer was in progress
+  inEndpoints[0].stalled = false;
+  inEndpoints[0].pending = false;
+  outEndpoints[0].stalled = false;
+  outEndpoints[0].pending = false;
+  API_USBCDC_OnSetup(setup);
+
+  if (length != 0U)
+  {
+    if (inEndpoints[0].stalled || outEndpoints[0].stalled)
+    {
+      return SIM_USB_STALL;
+    }
+    if (!outEndpoints[0].pending || outEndpoints[0].length < length)
+    {
+      return SIM_USB_PROTOCOL_ERROR;
+    }
+    memcpy(outEndpoints[0].outData, data, length);
+    outEndpoints[0].pending = false;
+    API_USBCDC_OnDataOut(0U, length);
+  }
+
+  if (inEndpoints[0].stalled)
+  {
+    return SIM_USB_STALL;
+  }
+  if (!inEndpoints[0].pending || inEndpoints[0].length != 0U)
+  {
+    return SIM_USB_PROTOCOL_ERROR;
+  }
+  inEndpoints[0].pending = false;
+  API_USBCDC_OnDataIn(0U);
+
+  return 0;
+}
+
+/**
+ * @brief  Host: length of the IN transfer waiting on an endpoint.
+ * @param  address: IN endpoint address.
+ * @retval int32_t: Transfer length (0 for a ZLP), -1 if nothing is pending.
+ */
+int32_t SIM_USB_PendingIn(uint8_t address)
+{
+  simEndpoint_t *ep = endpoint(address | SIM_USB_DIR_IN);
+
+  return (ep != NULL && ep->pending) ? (int32_t)ep->length : -1;
+}
+
+/**
+ * @brief  Host: completes the IN transfer waiting on an endpoint, then the completion event.
+ * @param  address: IN endpoint address.
+ * @param  data: Receives the bytes, SIM_USB_MAX_TRANSFER at most. May be NULL.
+ * @retval int32_t: Bytes transferred (0 for a ZLP), -1 if nothing was pending.
+ */
+int32_t SIM_USB_BulkIn(uint8_t address, uint8_t *data)
+{
+  simEndpoint_t *ep = endpoint(address | SIM_USB_DIR_IN);
+  uint16_t length;
+
+  if (ep == NULL || !ep->pending || ep->stalled)
+  {
+    return -1;
+  }
+
+  length = ep->length;
+  if (data != NULL && length != 0U)
+  {
+    memcpy(data, ep->inData, length);
+  }
+  ep->pending = false;
+  API_USBCDC_OnDataIn(address & SIM_USB_EP_MASK);
+
+  return length;
+}
+
+/**
+ * @brief  Host: sends one OUT transfer to an armed endpoint, then the completion event.
+ * @param  address: OUT endpoint address.
+ * @param  data: Bytes to send.
+ * @param  length: Number of bytes, at most the armed buffer size.
+ * @retval bool: false if the endpoint was not armed or too small (the host would get a NAK).
+ */
+bool SIM_USB_BulkOut(uint8_t address, const uint8_t *data, uint16_t length)
+{
+  simEndpoint_t *ep = endpoint(address & SIM_USB_EP_MASK);
+
+  if (ep == NULL || !ep->pending || ep->stalled || ep->length < length)
+  {
+    return false;
+  }
+
+  memcpy(ep->outData, data, length);
+  ep->pending = false;
+  API_USBCDC_OnDataOut(address & SIM_USB_EP_MASK, length);
+
+  return true;
+}
+
+/**
+ * @brief  Host: bus suspend (3 ms idle) or resume signalling.
+ * @param  suspended: true to suspend, false to resume.
+ * @retval None
+ */
+void SIM_USB_Suspend(bool suspended)
+{
+  API_USBCDC_OnSuspend(suspended);
+}
+
+/**
+ * @brief  Host: cable unplugged, VBUS lost.
+ * @param  None
+ * @retval None
+ */
+void SIM_USB_Disconnect(void)
+{
+  clearEndpoints();
+  API_USBCDC_OnDisconnect();
+}
+
+/**
+ * @brief  Address last set by the firmware.
+ * @param  None
+ * @retval uint8_t: Device address.
+ */
+uint8_t SIM_USB_GetAddress(void)
+{
+  return deviceAddress;
+}
+
+/**
+ * @brief  Tells whether an endpoint is open, and with which type and max packet.
+ * @param  address: Endpoint address.
+ * @param  type: Receives the type if open. May be NULL.
+ * @param  maxPacket: Receives the max packet if open. May be NULL.
+ * @retval bool: true if open.
+ */
+bool SIM_USB_IsEndpointOpen(uint8_t address, uint8_t *type, uint16_t *maxPacket)
+{
+  simEndpoint_t *ep = endpoint(address);
+
+  if (ep == NULL || !ep->open)
+  {
+    return false;
+  }
+  if (type != NULL)
+  {
+    *type = ep->type;
+  }
+  if (maxPacket != NULL)
+  {
+    *maxPacket = ep->maxPacket;
+  }
+  return true;
+}
+
+/**
+ * @brief  Tells whether an OUT endpoint is armed.
+ * @param  address: OUT endpoint address.
+ * @retval bool: true if a receive is pending.
+ */
+bool SIM_USB_IsArmed(uint8_t address)
+{
+  simEndpoint_t *ep = endpoint(address & SIM_USB_EP_MASK);
+
+  return ep != NULL && ep->pending;
+}
+
+/**
+ * @brief  Port calls the real controller would refuse: transfers on closed or busy endpoints,
+ *         oversized endpoint 0 packets.
+ * @param  None
+ * @retval uint32_t: Count since USB_HAL_Init.
+ */
+uint32_t SIM_USB_GetControllerErrors(void)
+{
+  return controllerErrors;
+}
+
+/**
+ * @brief  Host: reads an IN endpoint in the background as virtual time passes, passing every transfer to
+ *         the reader. NULL stops it.
+ * @param  address: IN endpoint address.
+ * @param  reader: Called with the bytes of each completed transfer (length 0 for a ZLP).
+ * @retval None
+ */
+void SIM_USB_SetHostReader(uint8_t address, simUsbReader_t reader)
+{
+  hostReader = reader;
+  hostReaderEndpoint = address;
+  hostCursorNs = SIM_TIME_NowUs() * SIM_USB_NS_PER_US;
+}
+
+/**
+ * @brief  Serves the background reader up to now: the waiting transfers complete one after the other, each
+ *         taking one packet slot per max packet (a ZLP one slot), from the time the endpoint was found busy.
+ *         Called by SIM_TIME_AdvanceUs.
+ * @param  nowUs: Virtual time.
+ * @retval None
+ */
+void SIM_USB_Tick(uint64_t nowUs)
+{
+  uint64_t nowNs = nowUs * SIM_USB_NS_PER_US;
+  uint32_t maxPacket = inEndpoints[hostReaderEndpoint & SIM_USB_EP_MASK].maxPacket;
+  int32_t length;
+  uint32_t packets;
+
+  if (hostReader == NULL)
+  {
+    return;
+  }
+
+  while ((length = SIM_USB_PendingIn(hostReaderEndpoint)) >= 0)
+  {
+    packets = length == 0 ? 1U : ((uint32_t)length + maxPacket - 1U) / maxPacket;
+    if (hostCursorNs + packets * SIM_USB_PACKET_SLOT_NS > nowNs)
+    {
+      return;
+    }
+    hostCursorNs += packets * SIM_USB_PACKET_SLOT_NS;
+    SIM_USB_BulkIn(hostReaderEndpoint, hostBuffer);
+    hostReader(hostBuffer, (uint16_t)length);
+  }
+
+  hostCursorNs = nowNs; // Idle endpoint: the next transfer cannot start before now
+}
@@ -0,0 +1,519 @@
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "API_app.h"
+#include "API_usb_cdc.h"
+#include "sim_check.h"
+
+/*
+ * USB CDC class against a scripted host on the PCD stub: enumeration, CDC requests, the double-buffered
+ * bulk IN path, then the firmware itself with a host reading the port.
+ *
+ *   sim_usbhost [-d seconds]
+ *
+ *   -d  Virtual duration of the firmware run, default 600 s.
+ *
+ * Each run prints its checks and "ok" or "FAILED". The firmware run compares the USB stream, raw sample
+ * lines aside, with the UART output sent while the port was open: they must be identical.
+ * Exit status 1 if any check fails.
+ */
+
+/* Private constants ---------------------------------------------------------*/
+
+#define USBHOST_ADDRESS 5U
+#define USBHOST_SERIAL "003500413530510A38363331" // Unique ID of the PCD stub, in hexadecimal
+#define USBHOST_SERIAL_CHARS 24U
+#define USBHOST_LINE_SIZE 48U                 // Writes of the throughput run
+#define USBHOST_THROUGHPUT_US 1000000U        // Virtual duration of the throughput run
+#define USBHOST_WRITER_PASS_US 100U           // Writer loop period of the throughput run
+#define USBHOST_DEFAULT_DURATION_S 600U
+#define USBHOST_STREAM_SIZE (4U * 1024U * 1024U)
+#define USBHOST_UART_BAUD 9600U               // USART3, for the bandwidth ratio
+#define USBHOST_RAW_TAG "R:"
+#define USBHOST_TEMPERATURE 21.0f
+#define USBHOST_HUMIDITY 45.0f
+#define USBHOST_SWING_PERIOD_S 120U           // Environment ramp, so reports by exception keep coming
+
+/* Private variables ----------------------------------------------------------*/
+
+static uint8_t *usbStream;
+static uint32_t usbStreamLength;
+static uint32_t usbTransfers;
+
+/* Private Function Prototypes ---------------------------------------------- */
+static void setup(uint8_t *packet, uint8_t requestType, uint8_t request, uint16_t value, uint16_t index,
+                  uint16_t length);
+static bool enumerate(void);
+static bool isSerial(const uint8_t *descriptor);
+static bool openPort(uint32_t baud);
+static void collect(const uint8_t *data, uint16_t length);
+static bool runEnumeration(void);
+static bool runBuffering(void);
+static bool runThroughput(void);
+static bool runFirmware(uint32_t seconds);
+static uint32_t stripRawLines(uint8_t *stream, uint32_t length, uint32_t *rawLines);
+
+/* Private Function Definitions --------------------------------------------- */
+
+/**
+ * @brief  Builds a SETUP packet.
+ * @param  packet: Receives the 8 bytes.
+ * @param  requestType, request, value, index, length: bmRequestType, bRequest, wValue, wIndex, wLength.
+ * @retval None
+ */
+static void setup(uint8_t *packet, uint8_t requestType, uint8_t request, uint16_t value, uint16_t index,
+                  uint16_t length)
+{
+  packet[0] = requestType;
+  packet[1] = request;
+  packet[2] = (uint8_t)value;
+  packet[3] = (uint8_t)(value >> 8);
+  packet[4] = (uint8_t)index;
+  packet[5] = (uint8_t)(index >> 8);
+  packet[6] = (uint8_t)length;
+  packet[7] = (uint8_t)(length >> 8);
+}
+
+/**
+ * @brief  Minimal enumeration, as a host driver does it: reset, device descriptor, address, configuration.
+ * @param  None
+ * @retval bool: true if every step was accepted.
+ */
+static bool enumerate(void)
+{
+  uint8_t packet[USBCDC_SETUP_SIZE];
+  uint8_t answer[256];
+
+  if (!SIM_USB_Reset())
+  {
+    return false;
+  }
+  setup(packet, 0x80, 0x06, 0x0100, 0, 64);
+  if (SIM_USB_ControlRead(packet, answer) != 18)
+  {
+    return false;
+  }
+  setup(packet, 0x00, 0x05, USBHOST_ADDRESS, 0, 0);
+  if (SIM_USB_ControlWrite(packet, NULL) != 0)
+  {
+    return false;
+  }
+  setup(packet, 0x80, 0x06, 0x0200, 0, 255);
+  if (SIM_USB_ControlRead(packet, answer) <= 0)
+  {
+    return false;
+  }
+  setup(packet, 0x00, 0x09, 1, 0, 0);
+  return SIM_USB_ControlWrite(packet, NULL) == 0;
+}
+
+/**
+ * @brief  Compares a string descriptor with USBHOST_SERIAL.
+ * @param  descriptor: String descriptor, UTF-16LE.
+ * @retval bool: true if it holds the expected serial number.
+ */
+static bool isSerial(const uint8_t *descriptor)
+{
+  for (uint16_t i = 0; i < USBHOST_SERIAL_CHARS; i++)
+  {
+    if (descriptor[2U + 2U * i] != (uint8_t)USBHOST_SERIAL[i] || descriptor[3U + 2U * i] != 0U)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief  Opens the port as a terminal program does: line coding, then DTR and RTS.
+ * @param  baud: Line coding baud rate.
+ * @retval bool: true if both requests were accepted.
+ */
+static bool openPort(uint32_t baud)
+{
+  uint8_t packet[USBCDC_SETUP_SIZE];
+  uint8_t coding[USBCDC_LINE_CODING_SIZE] = {(uint8_t)baud, (uint8_t)(baud >> 8), (uint8_t)(baud >> 16),
+                                             (uint8_t)(baud >> 24), 0, 0, 8};
+
+  setup(packet, 0x21, 0x20, 0, 0, USBCDC_LINE_CODING_SIZE);
+  if (SIM_USB_ControlWrite(packet, coding) != 0)
+  {
+    return false;
+  }
+  setup(packet, 0x21, 0x22, USBCDC_CONTROL_LINE_DTR | USBCDC_CONTROL_LINE_RTS, 0, 0);
+  return SIM_USB_ControlWrite(packet, NULL) == 0;
+}
+
+/**
+ * @brief  Background reader: appends every bulk IN transfer to the captured stream.
+ * @param  data: Transfer bytes.
+ * @param  length: Transfer length, 0 for a ZLP.
+ * @retval None
+ */
+static void collect(const uint8_t *data, uint16_t length)
+{
+  if (usbStream != NULL && usbStreamLength + length <= USBHOST_STREAM_SIZE)
+  {
+    memcpy(usbStream + usbStreamLength, data, length);
+  }
+  usbStreamLength += length;
+  usbTransfers++;
+}
+
+/**
+ * @brief  Enumeration and control requests: descriptors, address, configuration, CDC requests and refusals.
+ * @param  None
+ * @retval bool: true if every check passed.
+ */
+static bool runEnumeration(void)
+{
+  uint8_t packet[USBCDC_SETUP_SIZE];
+  uint8_t answer[256];
+  uint8_t coding[USBCDC_LINE_CODING_SIZE] = {0x00, 0x10, 0x0E, 0x00, 0, 0, 8}; // 921600 8N1
+  uint8_t type;
+  uint16_t maxPacket;
+  int32_t length;
+  uint32_t before = failures;
+
+  API_USBCDC_Init();
+  check(!API_USBCDC_Write((const uint8_t *)"x", 1), "write refused before enumeration");
+  check(SIM_USB_Reset(), "bus reset");
+  check(SIM_USB_IsEndpointOpen(0x00, &type, &maxPacket) && type == USBCDC_EP_TYPE_CTRL && maxPacket == 64,
+        "endpoint 0 open after reset");
+
+  // First device descriptor read of Windows: 64 bytes asked, one packet expected
+  setup(packet, 0x80, 0x06, 0x0100, 0, 64);
+  length = SIM_USB_ControlRead(packet, answer);
+  check(length == 18 && answer[0] == 18 && answer[1] == 0x01, "device descriptor");
+  check(answer[7] == USBCDC_EP0_SIZE && answer[8] == 0x83 && answer[9] == 0x04 && answer[10] == 0x40 &&
+            answer[11] == 0x57,
+        "max packet, vendor and product ids");
+  setup(packet, 0x80, 0x06, 0x0100, 0, 8);
+  check(SIM_USB_ControlRead(packet, answer) == 8, "device descriptor truncated to wLength");
+
+  setup(packet, 0x00, 0x05, USBHOST_ADDRESS, 0, 0);
+  check(SIM_USB_ControlWrite(packet, NULL) == 0 && SIM_USB_GetAddress() == USBHOST_ADDRESS, "set address");
+  check(API_USBCDC_GetStatus().state == USBCDC_ADDRESSED, "addressed state");
+
+  // Configuration: header first, then the whole set (64 + 3 bytes, two packets)
+  setup(packet, 0x80, 0x06, 0x0200, 0, 9);
+  length = SIM_USB_ControlRead(packet, answer);
+  check(length == 9 && answer[2] == 67 && answer[4] == 2, "configuration header");
+  setup(packet, 0x80, 0x06, 0x0200, 0, 255);
+  length = SIM_USB_ControlRead(packet, answer);
+  check(length == 67, "configuration descriptor, two packets");
+  check(answer[14] == 0x02 && answer[15] == 0x02 && answer[49] == 0x0A, "CDC ACM and data interfaces");
+  check(answer[39] == USBCDC_EP_NOTIFY && answer[55] == USBCDC_EP_DATA_OUT && answer[62] == USBCDC_EP_DATA_IN,
+        "endpoint addresses");
+
+  // A 64-byte answer to a longer request ends with a zero-length packet
+  setup(packet, 0x80, 0x06, 0x0200, 0, 64);
+  check(SIM_USB_ControlRead(packet, answer) == 64, "configuration truncated to one full packet");
+
+  setup(packet, 0x80, 0x06, 0x0300, 0, 255);
+  length = SIM_USB_ControlRead(packet, answer);
+  check(length == 4 && answer[2] == 0x09 && answer[3] == 0x04, "language string");
+  setup(packet, 0x80, 0x06, 0x0303, 0x0409, 255);
+  length = SIM_USB_ControlRead(packet, answer);
+  check(length == 2 + 2 * USBHOST_SERIAL_CHARS && isSerial(answer), "serial number string from the unique ID");
+  setup(packet, 0x80, 0x06, 0x0304, 0x0409, 255);
+  check(SIM_USB_ControlRead(packet, answer) == SIM_USB_STALL, "unknown string stalled");
+  setup(packet, 0x80, 0x06, 0x0600, 0, 10);
+  check(SIM_USB_ControlRead(packet, answer) == SIM_USB_STALL, "device qualifier stalled (full-speed only)");
+
+  setup(packet, 0x00, 0x09, 1, 0, 0);
+  check(SIM_USB_ControlWrite(packet, NULL) == 0, "set configuration");
+  check(API_USBCDC_GetStatus().state == USBCDC_CONFIGURED, "configured state");
+  check(SIM_USB_IsEndpointOpen(USBCDC_EP_DATA_IN, &type, &maxPacket) && type == USBCDC_EP_TYPE_BULK &&
+            maxPacket == 64,
+        "bulk IN open");
+  check(SIM_USB_IsEndpointOpen(USBCDC_EP_NOTIFY, &type, NULL) && type == USBCDC_EP_TYPE_INTR, "notification open");
+  check(SIM_USB_IsArmed(USBCDC_EP_DATA_OUT), "bulk OUT armed");
+  setup(packet, 0x80, 0x08, 0, 0, 1);
+  check(SIM_USB_ControlRead(packet, answer) == 1 && answer[0] == 1, "get configuration");
+
+  setup(packet, 0x21, 0x20, 0, 0, USBCDC_LINE_CODING_SIZE);
+  check(SIM_USB_ControlWrite(packet, coding) == 0, "set line coding");
+  setup(packet, 0xA1, 0x21, 0, 0, USBCDC_LINE_CODING_SIZE);
+  check(SIM_USB_ControlRead(packet, answer) == USBCDC_LINE_CODING_SIZE && memcmp(answer, coding, sizeof(coding)) == 0,
+        "get line coding");
+  check(API_USBCDC_GetStatus().baudRate == 921600U, "baud rate reported");
+
+  check(!API_USBCDC_IsOpen(), "closed until DTR");
+  setup(packet, 0x21, 0x22, USBCDC_CONTROL_LINE_DTR | USBCDC_CONTROL_LINE_RTS, 0, 0);
+  check(SIM_USB_ControlWrite(packet, NULL) == 0 && API_USBCDC_IsOpen(), "open on DTR");
+
+  setup(packet, 0x21, 0x7F, 0, 0, 0);
+  check(SIM_USB_ControlWrite(packet, NULL) == SIM_USB_STALL, "unknown class request stalled");
+  setup(packet, 0x00, 0x05, 9, 0, 0);
+  check(SIM_USB_ControlWrite(packet, NULL) == SIM_USB_STALL, "set address refused once configured");
+  check(API_USBCDC_GetStatus().stalls == 4, "stall count");
+
+  setup(packet, 0x00, 0x09, 0, 0, 0);
+  check(SIM_USB_ControlWrite(packet, NULL) == 0 && !SIM_USB_IsEndpointOpen(USBCDC_EP_DATA_IN, NULL, NULL) &&
+            !API_USBCDC_IsOpen(),
+        "deconfigure closes the data endpoints");
+  check(SIM_USB_GetControllerErrors() == 0, "no invalid controller call");
+
+  printf("enumeration: descriptors, address, configuration, line coding, DTR, stalls\n");
+  return checkSection(before);
+}
+
+/**
+ * @brief  Bulk IN double buffering: immediate start, aggregation while busy, ZLP, overflow, OUT data,
+ *         suspend and cable loss.
+ * @param  None
+ * @retval bool: true if every check passed.
+ */
+static bool runBuffering(void)
+{
+  uint8_t data[USBCDC_TX_BUFFER_SIZE];
+  uint8_t answer[1024];
+  usbcdcStatus_t status;
+  uint32_t before = failures;
+
+  for (uint16_t i = 0; i < sizeof(data); i++)
+  {
+    data[i] = (uint8_t)i;
+  }
+
+  API_USBCDC_Init();
+  check(enumerate() && openPort(115200U), "enumerate and open");
+
+  // Idle endpoint: the first write goes out at once
+  check(API_USBCDC_Write(data, 100), "first write");
+  check(SIM_USB_PendingIn(USBCDC_EP_DATA_IN) == 100, "first write on the endpoint");
+
+  // Busy endpoint: writes gather in the other buffer and leave as one transfer
+  check(API_USBCDC_Write(data, 30) && API_USBCDC_Write(data + 30, 30) && API_USBCDC_Write(data + 60, 40),
+        "writes while busy");
+  check(SIM_USB_BulkIn(USBCDC_EP_DATA_IN, answer) == 100 && memcmp(answer, data, 100) == 0, "first transfer");
+  check(SIM_USB_BulkIn(USBCDC_EP_DATA_IN, answer) == 100 && memcmp(answer, data, 100) == 0, "gathered transfer");
+  check(SIM_USB_PendingIn(USBCDC_EP_DATA_IN) < 0, "endpoint idle");
+
+  // A transfer of whole packets is closed by a zero-length packet
+  check(API_USBCDC_Write(data, 128), "two-packet write");
+  check(API_USBCDC_Write(data, 10), "write behind it");
+  check(SIM_USB_BulkIn(USBCDC_EP_DATA_IN, answer) == 128, "full-packet transfer");
+  check(SIM_USB_BulkIn(USBCDC_EP_DATA_IN, answer) == 0, "zero-length packet");
+  check(SIM_USB_BulkIn(USBCDC_EP_DATA_IN, answer) == 10, "next transfer after the ZLP");
+
+  // Host not reading: one buffer on the endpoint, one full, then writes are dropped whole
+  check(API_USBCDC_Write(data, 200), "write on idle endpoint");
+  check(API_USBCDC_Write(data, 500), "fill the other buffer");
+  check(!API_USBCDC_Write(data, 20), "write dropped when both buffers are busy");
+  status = API_USBCDC_GetStatus();
+  check(status.droppedBytes == 20 && status.droppedWrites == 1, "drop counters");
+  check(SIM_USB_BulkIn(USBCDC_EP_DATA_IN, answer) == 200 && SIM_USB_BulkIn(USBCDC_EP_DATA_IN, answer) == 500,
+        "both buffers delivered after the stall");
+  check(API_USBCDC_Write(data, 12) && SIM_USB_BulkIn(USBCDC_EP_DATA_IN, answer) == 12, "writes resume");
+
+  // Host data is counted and the endpoint re-armed
+  check(SIM_USB_BulkOut(USBCDC_EP_DATA_OUT, data, 10) && SIM_USB_BulkOut(USBCDC_EP_DATA_OUT, data, 64),
+        "bulk OUT accepted twice");
+  check(API_USBCDC_GetStatus().bytesReceived == 74, "received bytes counted");
+
+  SIM_USB_Suspend(true);
+  check(!API_USBCDC_IsOpen() && !API_USBCDC_Write(data, 1), "writes refused while suspended");
+  SIM_USB_Suspend(false);
+  check(API_USBCDC_IsOpen(), "open again on resume");
+
+  SIM_USB_Disconnect();
+  status = API_USBCDC_GetStatus();
+  check(status.state == USBCDC_DETACHED && !status.open, "detached on VBUS loss");
+  check(enumerate() && openPort(115200U) && API_USBCDC_Write(data, 5) &&
+            SIM_USB_BulkIn(USBCDC_EP_DATA_IN, answer) == 5,
+        "enumerated again after reconnection");
+
+  status = API_USBCDC_GetStatus();
+  check(status.resets == 2, "reset count");
+  check(SIM_USB_GetControllerErrors() == 0, "no invalid controller call");
+
+  printf("buffering: %u bytes in %u transfers, %u dropped\n", status.bytesSent, status.transfers,
+         status.droppedBytes);
+  return checkSection(before);
+}
+
+/**
+ * @brief  Saturated output: a writer offering lines every USBHOST_WRITER_PASS_US against a host reading up
+ *         to SIM_USB_PACKETS_PER_FRAME packets per frame.
+ * @param  None
+ * @retval bool: true if the port kept up to the byte with what the host received.
+ */
+static bool runThroughput(void)
+{
+  uint8_t line[USBHOST_LINE_SIZE];
+  uint64_t start;
+  uint32_t offered = 0;
+  usbcdcStatus_t status;
+  double rate;
+  bool ok;
+
+  memset(line, 'x', sizeof(line));
+  line[sizeof(line) - 2] = '\r';
+  line[sizeof(line) - 1] = '\n';
+
+  SIM_TIME_Reset();
+  API_USBCDC_Init();
+  ok = enumerate() && openPort(115200U);
+
+  usbStreamLength = 0;
+  usbTransfers = 0;
+  SIM_USB_SetHostReader(USBCDC_EP_DATA_IN, collect);
+  start = SIM_TIME_NowUs();
+  while (SIM_TIME_NowUs() - start < USBHOST_THROUGHPUT_US)
+  {
+    while (API_USBCDC_Write(line, sizeof(line)))
+    {
+      offered += sizeof(line);
+    }
+    SIM_TIME_AdvanceUs(USBHOST_WRITER_PASS_US);
+  }
+  SIM_USB_SetHostReader(USBCDC_EP_DATA_IN, NULL);
+
+  status = API_USBCDC_GetStatus();
+  rate = (double)status.bytesSent / ((double)USBHOST_THROUGHPUT_US / SIM_US_PER_SECOND);
+  ok = ok && status.bytesSent == usbStreamLength && offered - status.bytesSent <= 2U * USBCDC_TX_BUFFER_SIZE;
+
+  printf("throughput: %u bytes in %u transfers, %.1f KB/s, %.0f times USART3 at %u baud\n", status.bytesSent,
+         status.transfers, rate / 1024.0, rate / (USBHOST_UART_BAUD / SIM_UART_BITS_PER_BYTE), USBHOST_UART_BAUD);
+  printf("  %s\n", ok ? "ok" : "FAILED");
+
+  return ok;
+}
+
+/**
+ * @brief  The firmware with a host that opens the port after boot and keeps reading it.
+ * @param  seconds: Virtual duration.
+ * @retval bool: true if the USB stream carries exactly the UART telemetry, plus the raw samples.
+ */
+static bool runFirmware(uint32_t seconds)
+{
+  char *uartText = NULL;
+  size_t uartSize = 0;
+  FILE *uart = open_memstream(&uartText, &uartSize);
+  uint64_t end = (uint64_t)seconds * SIM_US_PER_SECOND;
+  uint32_t rawLines = 0;
+  uint32_t telemetryLength;
+  usbcdcStatus_t status;
+  bool ok;
+
+  usbStream = malloc(USBHOST_STREAM_SIZE);
+  usbStreamLength = 0;
+  usbTransfers = 0;
+
+  SIM_RTC_PowerOnReset();
+  SIM_TIME_Reset();
+  SIM_UART_SetCapture(NULL);
+  SIM_LCD_Reset();
+  SIM_BME280_Reset(NULL);
+  SIM_BME280_SetEnvironment(USBHOST_TEMPERATURE, USBHOST_HUMIDITY);
+  SIM_FLASH_EraseAll();
+  SIM_SD_Reset(0);
+  SIM_BOARD_Init();
+
+  // The host enumerates after boot; from then on UART and USB must carry the same telemetry
+  ok = uart != NULL && usbStream != NULL && enumerate() && openPort(115200U);
+  SIM_UART_SetCapture(uart);
+  SIM_USB_SetHostReader(USBCDC_EP_DATA_IN, collect);
+
+  while (SIM_TIME_NowUs() < end)
+  {
+    uint32_t second = (uint32_t)(SIM_TIME_NowUs() / SIM_US_PER_SECOND);
+    float phase = (float)(second % USBHOST_SWING_PERIOD_S) / USBHOST_SWING_PERIOD_S;
+    float swing = phase < 0.5f ? phase : 1.0f - phase;
+
+    SIM_BME280_SetEnvironment(USBHOST_TEMPERATURE + 4.0f * swing, USBHOST_HUMIDITY + 10.0f * swing);
+    SIM_BOARD_Step();
+  }
+
+  // Let the host read what is still queued
+  SIM_TIME_AdvanceUs(10U * SIM_US_PER_MS);
+  SIM_USB_SetHostReader(USBCDC_EP_DATA_IN, NULL);
+  SIM_UART_SetCapture(NULL);
+  fclose(uart);
+
+  status = API_USBCDC_GetStatus();
+  telemetryLength = stripRawLines(usbStream, usbStreamLength, &rawLines);
+  ok = ok && usbStreamLength <= USBHOST_STREAM_SIZE && status.droppedBytes == 0 && telemetryLength == uartSize &&
+       memcmp(usbStream, uartText, uartSize) == 0 && rawLines > 0;
+
+  printf("firmware %u s: uart %zu bytes, usb %u bytes in %u transfers (%u raw sample lines), %u dropped\n", seconds,
+         uartSize, usbStreamLength, usbTransfers, rawLines, status.droppedBytes);
+  printf("  %s\n", ok ? "ok" : "FAILED");
+
+  free(uartText);
+  free(usbStream);
+  usbStream = NULL;
+
+  return ok;
+}
+
+/**
+ * @brief  Removes the raw sample lines from a captured stream, in place.
+ * @param  stream: Captured bytes.
+ * @param  length: Captured length.
+ * @param  rawLines: Receives the number of lines removed.
+ * @retval uint32_t: Remaining length.
+ */
+static uint32_t stripRawLines(uint8_t *stream, uint32_t length, uint32_t *rawLines)
+{
+  uint32_t in = 0;
+  uint32_t out = 0;
+
+  while (in < length)
+  {
+    uint32_t end = in;
+    while (end < length && stream[end] != '\n')
+    {
+      end++;
+    }
+    end = end < length ? end + 1U : end;
+
+    if (end - in >= 2U && memcmp(stream + in, USBHOST_RAW_TAG, 2U) == 0)
+    {
+      (*rawLines)++;
+    }
+    else
+    {
+      memmove(stream + out, stream + in, end - in);
+      out += end - in;
+    }
+    in = end;
+  }
+
+  return out;
+}
+
+/* Public Function Definitions ----------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+  uint32_t seconds = USBHOST_DEFAULT_DURATION_S;
+  bool ok = true;
+  int option;
+
+  while ((option = getopt(argc, argv, "d:")) != -1)
+  {
+    switch (option)
+    {
+    case 'd':
+      seconds = (uint32_t)strtoul(optarg, NULL, 10);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-d seconds]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  SIM_TIME_Reset();
+  ok = runEnumeration() && ok;
+  ok = runBuffering() && ok;
+  ok = runThroughput() && ok;
+  ok = runFirmware(seconds) && ok;
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,265 @@
+#!/usr/bin/env python3
+"""Worst-case stack depth of a firmware image, checked against the linker script budget.
+
+Frame sizes come from the GCC -fstack-usage files (*.su) and cyclomatic complexity from the
+-fcyclomatic-complexity files (*.cyclo) of the build directory. The call graph comes from the
+disassembly of the ELF: every bl/blx/b to the start of another function is an edge, so tail calls
+are counted as calls (an overestimate of one frame). Indirect calls cannot be followed; they are
+listed so the paths behind them can be checked by hand.
+
+Entry points are Reset_Handler (or main) and every exception/IRQ handler in the image. The
+budget must hold the main path plus the deepest --irq-nesting handlers, each preempting the one
+before with its own exception frame. Handlers given the same --irq-priority level cannot preempt
+each other, so only the deepest of each level is nested; a handler without a level is a level of
+its own.
+
+Exit status: 0 within budget, 1 over budget, recursive, or unbounded dynamic frame, 2 bad usage.
+
+    python3 ../Tools/stack_budget.py --elf SPI_test.elf --su-dir . --ld ../STM32F429ZITX_FLASH.ld \
+        --irq-nesting 2 --irq-priority TIM6_DAC_IRQHandler=4 --irq-priority DMA2_Stream0_IRQHandler=4
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+HEADER_RE = re.compile(r"^\s*([0-9a-f]+) <([^>]+)>:\s*$")
+INSN_RE = re.compile(r"^\s*[0-9a-f]+:\s+(?:[0-9a-f]{2,8}\s+)*\s*([a-z][\w.]*)\s*(.*)$")
+TARGET_RE = re.compile(r"<([^>+]+)>(?:\s|$)")
+# Calls and branches that may leave the function: ARM bl/blx/b<cond>[.n|.w], x86 call/jmp/j<cc> (host builds)
+BRANCH_RE = re.compile(r"^(bl|blx|b|b[a-z]{2})(\.[nw])?$|^(call|jmp)q?$|^j[a-z]{1,3}$")
+INDIRECT_RE = re.compile(r"^blx\s+r\d+|^call[q]?\s+\*")
+SU_RE = re.compile(r"^(.*):(\d+):(\d+):(\S+)\s+(\d+)\s+(\S+)\s*$")
+CYCLO_RE = re.compile(r"^(.*):(\d+):(\d+):(\S+)\s+(\d+)\s*$")
+STACK_SIZE_RE = re.compile(r"^\s*_Min_Stack_Size\s*=\s*(0x[0-9a-fA-F]+|\d+)\s*;")
+# CMSIS exception names and STM32 IRQ handler names, as in the startup vector table
+HANDLER_RE = re.compile(r"^(NMI|HardFault|MemManage|BusFault|UsageFault|SVC|DebugMon|PendSV|SysTick)_Handler$"
+                        r"|^\w+_IRQHandler$")
+
+ARM_FPU_EXCEPTION_FRAME = 104  # Bytes stacked on exception entry with the FPU context (26 words)
+
+
+def base_name(name):
+    """GCC clones (foo.constprop.0, foo.isra.0, foo.part.0) share the frame record of foo."""
+    return name.split(".", 1)[0]
+
+
+def read_records(root, extension, pattern):
+    """Reads every *.su or *.cyclo under root into {function: [match, ...]}."""
+    records = {}
+    for directory, _, files in os.walk(root):
+        for file_name in files:
+            if not file_name.endswith(extension):
+                continue
+            with open(os.path.join(directory, file_name), encoding="utf-8", errors="replace") as stream:
+                for line in stream:
+                    match = pattern.match(line.strip())
+                    if match:
+                        records.setdefault(match.group(4), []).append(match)
+    return records
+
+
+def read_frames(root):
+    """Frame bytes per function and the set of functions with an unbounded dynamic frame.
+
+    Static functions with the same name in several units keep the largest frame.
+    """
+    frames, unbounded, duplicates = {}, set(), set()
+    for name, matches in read_records(root, ".su", SU_RE).items():
+        frames[name] = max(int(match.group(5)) for match in matches)
+        if len(matches) > 1:
+            duplicates.add(name)
+        for match in matches:
+            qualifiers = match.group(6).split(",")
+            if "dynamic" in qualifiers and "bounded" not in qualifiers:
+                unbounded.add(name)
+    return frames, unbounded, duplicates
+
+
+def read_cyclo(root):
+    return {name: max(int(match.group(5)) for match in matches)
+            for name, matches in read_records(root, ".cyclo", CYCLO_RE).items()}
+
+
+def read_budget(linker_script):
+    with open(linker_script, encoding="utf-8") as stream:
+        for line in stream:
+            match = STACK_SIZE_RE.match(line)
+            if match:
+                return int(match.group(1), 0)
+    sys.exit("stack_budget: no _Min_Stack_Size in %s" % linker_script)
+
+
+def read_call_graph(objdump, elf):
+    """Disassembles the ELF into {function: set(callees)} and {function: indirect call count}."""
+    try:
+        listing = subprocess.run([objdump, "-d", "--no-show-raw-insn", elf], check=True,
+                                 capture_output=True, text=True).stdout
+    except (OSError, subprocess.CalledProcessError) as error:
+        sys.exit("stack_budget: %s failed: %s" % (objdump, error))
+
+    graph, indirect, current = {}, {}, None
+    for line in listing.splitlines():
+        header = HEADER_RE.match(line)
+        if header:
+            current = header.group(2)
+            graph.setdefault(current, set())
+            continue
+        insn = INSN_RE.match(line)
+        if current is None or not insn:
+            continue
+        mnemonic, operands = insn.group(1), insn.group(2)
+        if INDIRECT_RE.match(mnemonic + " " + operands):
+            indirect[current] = indirect.get(current, 0) + 1
+            continue
+        target = TARGET_RE.search(operands)
+        if target and BRANCH_RE.match(mnemonic):
+            callee = target.group(1).split("@", 1)[0]
+            if callee != current:
+                graph[current].add(callee)
+    return graph, indirect
+
+
+class Analyser:
+    def __init__(self, graph, frames, unbounded):
+        self.graph = graph
+        self.frames = frames
+        self.unbounded = unbounded
+        self.depth = {}
+        self.next_hop = {}
+        self.unknown = set()
+        self.cycles = []
+        self.visiting = []
+
+    def frame(self, name):
+        for key in (name, base_name(name)):
+            if key in self.frames:
+                return self.frames[key]
+        self.unknown.add(name)
+        return 0
+
+    def worst(self, name):
+        """Deepest stack from the entry of name, memoised. A cycle is recorded and cut."""
+        if name in self.depth:
+            return self.depth[name]
+        if name in self.visiting:
+            self.cycles.append(self.visiting[self.visiting.index(name):] + [name])
+            return 0
+        self.visiting.append(name)
+        best, hop = 0, None
+        for callee in sorted(self.graph.get(name, ())):
+            depth = self.worst(callee)
+            if depth > best:
+                best, hop = depth, callee
+        self.visiting.pop()
+        self.depth[name] = self.frame(name) + best
+        self.next_hop[name] = hop
+        return self.depth[name]
+
+    def path(self, name):
+        hops = []
+        while name is not None:
+            hops.append(name)
+            name = self.next_hop.get(name)
+        return hops
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--elf", required=True, help="linked image")
+    parser.add_argument("--su-dir", default=".", help="build directory holding the *.su and *.cyclo files")
+    parser.add_argument("--ld", help="linker script, the budget is its _Min_Stack_Size")
+    parser.add_argument("--budget", type=lambda text: int(text, 0), help="budget in bytes, overrides --ld")
+    parser.add_argument("--objdump", default="arm-none-eabi-objdump")
+    parser.add_argument("--irq-nesting", type=int, help="handlers that can be active at once (default: all)")
+    parser.add_argument("--irq-priority", action="append", default=[], metavar="HANDLER=LEVEL",
+                        help="preemption level of a handler, repeatable; one handler per level is nested")
+    parser.add_argument("--exception-frame", type=int, default=ARM_FPU_EXCEPTION_FRAME,
+                        help="bytes stacked per exception entry (default %(default)s, FPU context)")
+    parser.add_argument("--top", type=int, default=8, help="functions listed by frame size and complexity")
+    args = parser.parse_args()
+
+    if args.budget is None and args.ld is None:
+        parser.error("one of --budget or --ld is required")
+    budget = args.budget if args.budget is not None else read_budget(args.ld)
+    levels = {}
+    for item in args.irq_priority:
+        name, _, level = item.partition("=")
+        try:
+            levels[name] = int(level, 0)
+        except ValueError:
+            parser.error("--irq-priority expects HANDLER=LEVEL, got %s" % item)
+
+    frames, unbounded, duplicates = read_frames(args.su_dir)
+    cyclo = read_cyclo(args.su_dir)
+    graph, indirect = read_call_graph(args.objdump, args.elf)
+    if not frames:
+        sys.exit("stack_budget: no .su files under %s (build with -fstack-usage)" % args.su_dir)
+
+    analyser = Analyser(graph, frames, unbounded)
+    reset = "Reset_Handler" if "Reset_Handler" in graph else "main"
+    handlers = sorted(name for name in graph
+                      if HANDLER_RE.match(name) and name not in ("Reset_Handler", "Default_Handler"))
+
+    def describe(name):
+        hops = analyser.path(name)
+        return " > ".join("%s(%d%s)" % (hop, analyser.frame(hop),
+                                         "/c%d" % cyclo[hop] if hop in cyclo else "") for hop in hops)
+
+    print("Stack budget: %d B" % budget)
+    print("%-28s %7s  %s" % ("Entry", "Worst", "Path: function(frame bytes/cyclomatic complexity)"))
+    print("%-28s %7d  %s" % (reset, analyser.worst(reset), describe(reset)))
+    deepest = {}  # Deepest handler of each preemption level: (depth, name)
+    for name in handlers:
+        depth = analyser.worst(name) + args.exception_frame
+        group = ("level", levels[name]) if name in levels else ("handler", name)
+        deepest[group] = max(deepest.get(group, (0, "")), (depth, name))
+        print("%-28s %7d  %s" % (name, depth, describe(name)))
+
+    nesting = len(deepest) if args.irq_nesting is None else min(args.irq_nesting, len(deepest))
+    nested = sorted(deepest.values(), reverse=True)[:nesting]
+    total = analyser.worst(reset) + sum(depth for depth, _ in nested)
+    print("\nWorst case: %s + %d nested handler(s) incl. %d B exception frames = %d B of %d B (%d%%)"
+          % (reset, nesting, args.exception_frame, total, budget, 100 * total // max(budget, 1)))
+    if nested:
+        print("Nested:     " + " > ".join(name for _, name in nested))
+
+    reachable = set(analyser.depth)
+    ranked = sorted(reachable & set(frames), key=lambda name: frames[name], reverse=True)[:args.top]
+    print("\nLargest frames: " + ", ".join("%s %d" % (name, frames[name]) for name in ranked))
+    ranked = sorted(reachable & set(cyclo), key=lambda name: cyclo[name], reverse=True)[:args.top]
+    if ranked:
+        print("Most complex:   " + ", ".join("%s %d" % (name, cyclo[name]) for name in ranked))
+
+    warnings = []
+    if set(levels) - set(handlers):
+        warnings.append("--irq-priority handlers not in the image: " + ", ".join(sorted(set(levels) - set(handlers))))
+    if analyser.unknown & reachable:
+        warnings.append("no frame record, counted as 0 B (assembly or libraries): "
+                        + ", ".join(sorted(analyser.unknown & reachable)))
+    if set(indirect) & reachable:
+        warnings.append("indirect calls not followed: "
+                        + ", ".join("%s x%d" % (name, indirect[name]) for name in sorted(set(indirect) & reachable)))
+    if duplicates & reachable:
+        warnings.append("static functions sharing a name, largest frame used: "
+                        + ", ".join(sorted(duplicates & reachable)))
+    for warning in warnings:
+        print("warning: " + warning)
+
+    errors = []
+    if analyser.cycles:
+        errors.extend("recursion, depth unbounded: " + " > ".join(cycle) for cycle in analyser.cycles)
+    if unbounded & reachable:
+        errors.append("dynamic stack allocation (alloca/VLA): " + ", ".join(sorted(unbounded & reachable)))
+    if total > budget:
+        errors.append("worst case %d B exceeds the %d B stack budget" % (total, budget))
+    for error in errors:
+        print("error: " + error)
+
+    return 1 if errors else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())